@@ -0,0 +1,364 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * binary_format.c - Compact binary event format
+ * Shared encoding helpers and the decoder behind "crypto-tracer decode"
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/binary_format.h"
+#include "include/string_arena.h"
+#include "include/logger.h"
+
+size_t binary_varint_size(uint64_t value) {
+    size_t n = 1;
+    
+    while (value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+size_t binary_put_varint(uint8_t *dst, uint64_t value) {
+    size_t n = 0;
+    
+    while (value >= 0x80) {
+        dst[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    dst[n++] = (uint8_t)value;
+    return n;
+}
+
+uint64_t binary_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t binary_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+struct binary_decoder {
+    FILE *input;
+    string_arena_t *arena;        /* Dictionary strings */
+    const char **dict;            /* Dictionary by id */
+    size_t dict_count;
+    size_t dict_capacity;
+    uint8_t *record;              /* Payload of the current record */
+    size_t record_capacity;
+    char *strings;                /* NUL-terminated inline strings of the current event */
+    size_t strings_capacity;
+    uint64_t last_timestamp_ns;
+    uint64_t offset;              /* File offset of the current record */
+};
+
+/* Cursor over a record payload */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} payload_cursor_t;
+
+static int read_varint(payload_cursor_t *cur, uint64_t *value) {
+    uint64_t result = 0;
+    
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (cur->p >= cur->end) {
+            return -1;
+        }
+        uint8_t byte = *cur->p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int read_byte(payload_cursor_t *cur, uint8_t *value) {
+    if (cur->p >= cur->end) {
+        return -1;
+    }
+    *value = *cur->p++;
+    return 0;
+}
+
+/**
+ * Read a varint straight from the input (record framing)
+ * Returns 0 on success, -1 on truncation
+ */
+static int read_stream_varint(binary_decoder_t *dec, uint64_t *value) {
+    uint64_t result = 0;
+    
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int c = getc(dec->input);
+        if (c == EOF) {
+            return -1;
+        }
+        result |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Create a decoder and check the file header
+ *
+ * @param input Open binary capture
+ * @return Decoder, or NULL if the input is not a supported capture
+ */
+binary_decoder_t *binary_decoder_create(FILE *input) {
+    uint8_t header[BINARY_HEADER_SIZE];
+    binary_decoder_t *dec;
+    
+    if (!input) {
+        return NULL;
+    }
+    
+    if (fread(header, 1, sizeof(header), input) != sizeof(header) ||
+        memcmp(header, BINARY_MAGIC, 4) != 0) {
+        log_error("Input is not a crypto-tracer binary capture");
+        return NULL;
+    }
+    if (header[4] != BINARY_VERSION) {
+        log_error("Unsupported binary capture version %u", header[4]);
+        return NULL;
+    }
+    
+    dec = calloc(1, sizeof(*dec));
+    if (!dec) {
+        log_error("Failed to allocate binary decoder");
+        return NULL;
+    }
+    
+    dec->arena = string_arena_create(0);
+    if (!dec->arena) {
+        free(dec);
+        return NULL;
+    }
+    
+    dec->input = input;
+    dec->offset = BINARY_HEADER_SIZE;
+    return dec;
+}
+
+void binary_decoder_destroy(binary_decoder_t *dec) {
+    if (!dec) {
+        return;
+    }
+    
+    string_arena_destroy(dec->arena);
+    free(dec->dict);
+    free(dec->record);
+    free(dec->strings);
+    free(dec);
+}
+
+/**
+ * Add a STRING record's payload to the dictionary
+ */
+static int add_dict_string(binary_decoder_t *dec, const uint8_t *data, size_t len) {
+    char *copy;
+    
+    if (dec->dict_count >= dec->dict_capacity) {
+        size_t new_capacity = dec->dict_capacity ? dec->dict_capacity * 2 : 256;
+        const char **dict = realloc(dec->dict, new_capacity * sizeof(*dict));
+        if (!dict) {
+            return -1;
+        }
+        dec->dict = dict;
+        dec->dict_capacity = new_capacity;
+    }
+    
+    copy = string_arena_strndup(dec->arena, (const char *)data, len);
+    if (!copy) {
+        return -1;
+    }
+    dec->dict[dec->dict_count++] = copy;
+    return 0;
+}
+
+/**
+ * Resolve one string reference of an event record
+ * Inline strings are copied, NUL-terminated, to *inline_pos
+ */
+static int read_string_ref(binary_decoder_t *dec, payload_cursor_t *cur, char **inline_pos,
+                           const char **str) {
+    uint64_t ref, len;
+    
+    if (read_varint(cur, &ref) != 0) {
+        return -1;
+    }
+    
+    if (ref == BINARY_REF_NULL) {
+        *str = NULL;
+    } else if (ref == BINARY_REF_INLINE) {
+        if (read_varint(cur, &len) != 0 || len > (uint64_t)(cur->end - cur->p)) {
+            return -1;
+        }
+        memcpy(*inline_pos, cur->p, len);
+        (*inline_pos)[len] = '\0';
+        *str = *inline_pos;
+        *inline_pos += len + 1;
+        cur->p += len;
+    } else {
+        if (ref - BINARY_REF_DICT_BASE >= dec->dict_count) {
+            return -1;
+        }
+        *str = dec->dict[ref - BINARY_REF_DICT_BASE];
+    }
+    return 0;
+}
+
+/**
+ * Decode an EVENT record payload
+ */
+static int decode_event(binary_decoder_t *dec, size_t len, processed_event_t *event) {
+    payload_cursor_t cur = { dec->record, dec->record + len };
+    const char *strings[BINARY_EVENT_STRINGS + BINARY_EVENT_TRAILING_STRINGS] = { NULL };
+    const size_t string_count = BINARY_EVENT_STRINGS + BINARY_EVENT_TRAILING_STRINGS;
+    uint64_t delta, pid, uid, result, exit_code, count = 0, cgroup_id = 0, inode = 0, dev = 0;
+    uint64_t tid = 0;
+    uint8_t code, file_type;
+    char *inline_pos;
+    
+    /* Inline strings are never longer than the payload that holds them */
+    if (len + string_count > dec->strings_capacity) {
+        char *buf = realloc(dec->strings, len + string_count);
+        if (!buf) {
+            return -1;
+        }
+        dec->strings = buf;
+        dec->strings_capacity = len + string_count;
+    }
+    inline_pos = dec->strings;
+    
+    if (read_byte(&cur, &code) != 0 || !event_kind_name((event_kind_t)code) ||
+        read_varint(&cur, &delta) != 0 ||
+        read_varint(&cur, &pid) != 0 ||
+        read_varint(&cur, &uid) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < BINARY_EVENT_STRINGS; i++) {
+        if (read_string_ref(dec, &cur, &inline_pos, &strings[i]) != 0) {
+            return -1;
+        }
+    }
+    if (read_byte(&cur, &file_type) != 0 ||
+        read_varint(&cur, &result) != 0 ||
+        read_varint(&cur, &exit_code) != 0) {
+        return -1;
+    }
+    /* Optional trailing fields, absent from older captures */
+    if ((cur.p < cur.end && read_varint(&cur, &count) != 0) ||
+        (cur.p < cur.end && read_varint(&cur, &cgroup_id) != 0)) {
+        return -1;
+    }
+    for (size_t i = BINARY_EVENT_STRINGS; i < string_count && cur.p < cur.end; i++) {
+        if (read_string_ref(dec, &cur, &inline_pos, &strings[i]) != 0) {
+            return -1;
+        }
+    }
+    if ((cur.p < cur.end && read_varint(&cur, &inode) != 0) ||
+        (cur.p < cur.end && read_varint(&cur, &dev) != 0) ||
+        (cur.p < cur.end && read_varint(&cur, &tid) != 0)) {
+        return -1;
+    }
+    
+    dec->last_timestamp_ns += (uint64_t)binary_unzigzag(delta);
+    
+    memset(event, 0, sizeof(*event));
+    processed_event_set_kind(event, (event_kind_t)code);
+    event->timestamp_ns = dec->last_timestamp_ns;
+    event->pid = (uint32_t)pid;
+    event->uid = (uint32_t)uid;
+    event->process = strings[0];
+    event->exe = strings[1];
+    event->cmdline = strings[2];
+    event->file = strings[3];
+    event->library = strings[4];
+    event->library_name = strings[5];
+    event->function_name = strings[6];
+    event->flags = strings[7];
+    event->file_type = file_type <= FILE_TYPE_UNKNOWN ? (file_type_t)file_type : FILE_TYPE_UNKNOWN;
+    event->result = (int32_t)binary_unzigzag(result);
+    event->exit_code = (int32_t)binary_unzigzag(exit_code);
+    event->count = count > UINT32_MAX ? UINT32_MAX : (uint32_t)count;
+    event->cgroup_id = cgroup_id;
+    event->container = strings[8];
+    event->pod = strings[9];
+    event->inode = inode;
+    event->dev = dev;
+    event->tid = tid > UINT32_MAX ? 0 : (uint32_t)tid;
+    return 0;
+}
+
+/**
+ * Decode the next event
+ *
+ * @param dec Decoder
+ * @param event Filled with the event (strings owned by the decoder)
+ * @return 1 if an event was decoded, 0 at end of input, -1 on error
+ */
+int binary_decoder_next(binary_decoder_t *dec, processed_event_t *event) {
+    if (!dec || !event) {
+        return -1;
+    }
+    
+    for (;;) {
+        uint64_t len;
+        int type = getc(dec->input);
+        int ret;
+        
+        if (type == EOF) {
+            return 0;
+        }
+        
+        ret = read_stream_varint(dec, &len);
+        if (ret != 0 || len > SIZE_MAX - BINARY_EVENT_STRINGS) {
+            log_error("Truncated record at offset %llu", (unsigned long long)dec->offset);
+            return -1;
+        }
+        
+        if (len > dec->record_capacity) {
+            uint8_t *buf = realloc(dec->record, len);
+            if (!buf) {
+                log_error("Failed to allocate %llu byte record", (unsigned long long)len);
+                return -1;
+            }
+            dec->record = buf;
+            dec->record_capacity = len;
+        }
+        if (fread(dec->record, 1, len, dec->input) != len) {
+            log_error("Truncated record at offset %llu", (unsigned long long)dec->offset);
+            return -1;
+        }
+        dec->offset += 1 + binary_varint_size(len) + len;
+        
+        if (type == BINARY_RECORD_STRING) {
+            if (add_dict_string(dec, dec->record, len) != 0) {
+                log_error("Failed to grow string dictionary");
+                return -1;
+            }
+        } else if (type == BINARY_RECORD_EVENT) {
+            if (decode_event(dec, len, event) != 0) {
+                log_error("Malformed event record before offset %llu",
+                          (unsigned long long)dec->offset);
+                return -1;
+            }
+            return 1;
+        }
+        /* Unknown record types are skipped */
+    }
+}
@@ -0,0 +1,517 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * cgroup_cache.c - cgroup v2 id to container attribution cache
+ * A cgroup's id is the inode number of its cgroupfs directory, so one
+ * walk of the tree maps every live id to its path. Entries are never
+ * freed before the cache, which lets events borrow their strings; ids of
+ * removed cgroups are never reused, so stale entries are harmless.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include "include/cgroup_cache.h"
+#include "include/logger.h"
+
+#ifndef CGROUP2_SUPER_MAGIC
+#define CGROUP2_SUPER_MAGIC 0x63677270
+#endif
+
+/* Initial hash table size (power of two) */
+#define CGROUP_TABLE_INITIAL 1024
+
+/* Deepest directory the walk descends into */
+#define CGROUP_WALK_MAX_DEPTH 32
+
+/* Cached cgroup; info strings are stored after the entry */
+typedef struct cgroup_entry {
+    cgroup_info_t info;
+    const struct cgroup_entry *parent;
+} cgroup_entry_t;
+
+struct cgroup_cache {
+    char *root;
+    cgroup_entry_t **slots;        /* Open addressing on the id */
+    size_t mask;
+    size_t count;
+    uint64_t last_scan_ns;         /* 0 = never scanned */
+    bool full_warned;
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static size_t slot_of(const cgroup_cache_t *cache, uint64_t id) {
+    return (size_t)((id * 0x9E3779B97F4A7C15ULL) >> 32) & cache->mask;
+}
+
+static cgroup_entry_t *find_entry(const cgroup_cache_t *cache, uint64_t id) {
+    size_t i = slot_of(cache, id);
+    
+    while (cache->slots[i]) {
+        if (cache->slots[i]->info.id == id) {
+            return cache->slots[i];
+        }
+        i = (i + 1) & cache->mask;
+    }
+    return NULL;
+}
+
+static int grow_table(cgroup_cache_t *cache) {
+    cgroup_entry_t **old = cache->slots;
+    size_t old_size = cache->mask + 1;
+    
+    cache->slots = calloc(old_size * 2, sizeof(*cache->slots));
+    if (!cache->slots) {
+        cache->slots = old;
+        return -1;
+    }
+    cache->mask = old_size * 2 - 1;
+    
+    for (size_t i = 0; i < old_size; i++) {
+        if (old[i]) {
+            size_t j = slot_of(cache, old[i]->info.id);
+            
+            while (cache->slots[j]) {
+                j = (j + 1) & cache->mask;
+            }
+            cache->slots[j] = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+static bool is_hex(const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!isxdigit((unsigned char)s[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Length of name without suffix, if it ends with it */
+static size_t strip_suffix(const char *name, size_t len, const char *suffix) {
+    size_t suffix_len = strlen(suffix);
+    
+    if (len > suffix_len && memcmp(name + len - suffix_len, suffix, suffix_len) == 0) {
+        return len - suffix_len;
+    }
+    return len;
+}
+
+/**
+ * Find a container id or pod UID in one cgroup path component
+ * Container runtimes name the cgroup after the container: with the
+ * systemd driver "<runtime>-<64 hex>.scope" (docker, cri-containerd,
+ * crio, libpod), with the cgroupfs driver just "<64 hex>". Kubernetes
+ * names pod cgroups "kubepods-<qos>-pod<uid>.slice" with the dashes of
+ * the UID turned into underscores, or "pod<uid>".
+ */
+bool cgroup_parse_component(const char *name, char *container, char *pod) {
+    size_t len = strlen(name);
+    size_t id_start = 0;
+    size_t end;
+    
+    container[0] = '\0';
+    pod[0] = '\0';
+    
+    /* crio-conmon-<id>.scope holds the runtime's monitor, not the container */
+    end = strip_suffix(name, len, ".scope");
+    for (size_t i = 0; i < end; i++) {
+        if (name[i] == '-') {
+            id_start = i + 1;
+        }
+    }
+    if (end - id_start == 64 && is_hex(name + id_start, 64) && !strstr(name, "conmon")) {
+        for (size_t i = 0; i < CGROUP_CONTAINER_ID_LEN; i++) {
+            container[i] = (char)tolower((unsigned char)name[id_start + i]);
+        }
+        container[CGROUP_CONTAINER_ID_LEN] = '\0';
+    }
+    
+    end = strip_suffix(name, len, ".slice");
+    for (size_t i = 0; i + 3 < end; i++) {
+        size_t uid_len = end - i - 3;
+        bool valid = uid_len >= 32 && uid_len <= CGROUP_POD_UID_MAX;
+        
+        if ((i > 0 && name[i - 1] != '-') || strncmp(name + i, "pod", 3) != 0) {
+            continue;
+        }
+        for (size_t j = 0; valid && j < uid_len; j++) {
+            char c = name[i + 3 + j];
+            valid = isxdigit((unsigned char)c) || c == '-' || c == '_';
+        }
+        if (!valid) {
+            continue;
+        }
+        for (size_t j = 0; j < uid_len; j++) {
+            char c = name[i + 3 + j];
+            pod[j] = c == '_' ? '-' : (char)tolower((unsigned char)c);
+        }
+        pod[uid_len] = '\0';
+        break;
+    }
+    
+    return container[0] || pod[0];
+}
+
+/**
+ * Cache a cgroup, attributing it to the container and pod it or its
+ * parent is named after
+ *
+ * @return The entry (existing or new), or NULL if the cache is full
+ */
+static const cgroup_entry_t *add_entry(cgroup_cache_t *cache, uint64_t id, const char *path,
+                                       const char *name, const cgroup_entry_t *parent) {
+    char container[CGROUP_CONTAINER_ID_LEN + 1];
+    char pod[CGROUP_POD_UID_MAX + 1];
+    const char *container_src, *pod_src;
+    size_t path_len, container_len, pod_len;
+    cgroup_entry_t *entry;
+    char *strings;
+    size_t i;
+    
+    entry = find_entry(cache, id);
+    if (entry) {
+        return entry;
+    }
+    
+    if (cache->count >= CGROUP_CACHE_MAX_ENTRIES ||
+        ((cache->count + 1) * 10 > (cache->mask + 1) * 7 && grow_table(cache) != 0)) {
+        if (!cache->full_warned) {
+            log_warn("cgroup cache full, further containers are not attributed");
+            cache->full_warned = true;
+        }
+        return NULL;
+    }
+    
+    cgroup_parse_component(name, container, pod);
+    container_src = container[0] ? container : parent ? parent->info.container : NULL;
+    pod_src = pod[0] ? pod : parent ? parent->info.pod : NULL;
+    path_len = strlen(path);
+    container_len = container_src ? strlen(container_src) : 0;
+    pod_len = pod_src ? strlen(pod_src) : 0;
+    
+    entry = malloc(sizeof(*entry) + path_len + container_len + pod_len + 3);
+    if (!entry) {
+        return NULL;
+    }
+    strings = (char *)(entry + 1);
+    entry->info.id = id;
+    entry->parent = parent;
+    
+    memcpy(strings, path, path_len + 1);
+    entry->info.path = strings;
+    strings += path_len + 1;
+    
+    entry->info.container = NULL;
+    if (container_src) {
+        memcpy(strings, container_src, container_len + 1);
+        entry->info.container = strings;
+        strings += container_len + 1;
+    }
+    entry->info.pod = NULL;
+    if (pod_src) {
+        memcpy(strings, pod_src, pod_len + 1);
+        entry->info.pod = strings;
+    }
+    
+    i = slot_of(cache, id);
+    while (cache->slots[i]) {
+        i = (i + 1) & cache->mask;
+    }
+    cache->slots[i] = entry;
+    cache->count++;
+    return entry;
+}
+
+/**
+ * Cache every cgroup below the directory dir_fd (consumed)
+ */
+static void scan_dir(cgroup_cache_t *cache, int dir_fd, const char *path,
+                     const cgroup_entry_t *parent, int depth) {
+    char child_path[4096];
+    struct dirent *de;
+    struct stat st;
+    DIR *dir;
+    
+    dir = fdopendir(dir_fd);
+    if (!dir) {
+        close(dir_fd);
+        return;
+    }
+    
+    while ((de = readdir(dir)) != NULL) {
+        const cgroup_entry_t *entry;
+        int child_fd;
+        int len;
+        
+        if (de->d_name[0] == '.' || (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN)) {
+            continue;
+        }
+        child_fd = openat(dirfd(dir), de->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (child_fd < 0) {
+            continue;
+        }
+        len = snprintf(child_path, sizeof(child_path), "%s/%s",
+                       strcmp(path, "/") == 0 ? "" : path, de->d_name);
+        if (fstat(child_fd, &st) != 0 || len < 0 || (size_t)len >= sizeof(child_path) ||
+            !(entry = add_entry(cache, (uint64_t)st.st_ino, child_path, de->d_name, parent))) {
+            close(child_fd);
+            continue;
+        }
+        
+        if (depth < CGROUP_WALK_MAX_DEPTH) {
+            scan_dir(cache, child_fd, child_path, entry, depth + 1);
+        } else {
+            close(child_fd);
+        }
+    }
+    
+    closedir(dir);
+}
+
+/**
+ * Walk the cgroup tree and cache the cgroups not seen yet
+ */
+static void rescan(cgroup_cache_t *cache) {
+    const cgroup_entry_t *root;
+    struct stat st;
+    int fd;
+    
+    cache->last_scan_ns = monotonic_ns();
+    
+    fd = open(cache->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    if (fstat(fd, &st) != 0 || !(root = add_entry(cache, (uint64_t)st.st_ino, "/", "", NULL))) {
+        close(fd);
+        return;
+    }
+    scan_dir(cache, fd, "/", root, 1);
+}
+
+/* Whether path is a cgroup v2 mount */
+static bool is_cgroup2(const char *path) {
+    struct statfs fs;
+    
+    return statfs(path, &fs) == 0 && fs.f_type == CGROUP2_SUPER_MAGIC;
+}
+
+/**
+ * Create a cgroup cache
+ * The tree is scanned on the first lookup.
+ *
+ * @param root cgroup v2 mount, or NULL to find it
+ * @return Cache, or NULL if there is no cgroup v2 hierarchy
+ */
+cgroup_cache_t *cgroup_cache_create(const char *root) {
+    cgroup_cache_t *cache;
+    
+    if (!root) {
+        root = is_cgroup2(CGROUP_V2_ROOT) ? CGROUP_V2_ROOT :
+               is_cgroup2(CGROUP_V2_HYBRID_ROOT) ? CGROUP_V2_HYBRID_ROOT : NULL;
+        if (!root) {
+            log_debug("No cgroup v2 hierarchy, events are not attributed to containers");
+            return NULL;
+        }
+    }
+    
+    cache = calloc(1, sizeof(*cache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->root = strdup(root);
+    cache->slots = calloc(CGROUP_TABLE_INITIAL, sizeof(*cache->slots));
+    cache->mask = CGROUP_TABLE_INITIAL - 1;
+    if (!cache->root || !cache->slots) {
+        cgroup_cache_destroy(cache);
+        return NULL;
+    }
+    
+    return cache;
+}
+
+void cgroup_cache_destroy(cgroup_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    
+    if (cache->slots) {
+        for (size_t i = 0; i <= cache->mask; i++) {
+            free(cache->slots[i]);
+        }
+    }
+    free(cache->slots);
+    free(cache->root);
+    free(cache);
+}
+
+/**
+ * Look up a cgroup by id
+ * An unknown id triggers a rescan unless one ran within the last
+ * CGROUP_RESCAN_INTERVAL_NS, so a burst of events from a new container
+ * costs one walk of the tree.
+ */
+const cgroup_info_t *cgroup_cache_lookup(cgroup_cache_t *cache, uint64_t id) {
+    cgroup_entry_t *entry;
+    
+    if (!cache || id == 0) {
+        return NULL;
+    }
+    
+    entry = find_entry(cache, id);
+    if (entry) {
+        return &entry->info;
+    }
+    
+    if (cache->last_scan_ns != 0 &&
+        monotonic_ns() - cache->last_scan_ns < CGROUP_RESCAN_INTERVAL_NS) {
+        return NULL;
+    }
+    rescan(cache);
+    
+    entry = find_entry(cache, id);
+    return entry ? &entry->info : NULL;
+}
+
+size_t cgroup_cache_select(cgroup_cache_t *cache, const cgroup_selector_t *sel,
+                           uint64_t *ids, size_t max) {
+    size_t count = 0;
+    
+    if (!cache || !sel) {
+        return 0;
+    }
+    
+    rescan(cache);
+    
+    for (size_t i = 0; i <= cache->mask; i++) {
+        const cgroup_entry_t *entry = cache->slots[i];
+        
+        if (!entry || !cgroup_selector_matches(sel, &entry->info) ||
+            (entry->parent && cgroup_selector_matches(sel, &entry->parent->info))) {
+            continue;
+        }
+        if (count < max) {
+            ids[count] = entry->info.id;
+        }
+        count++;
+    }
+    
+    return count;
+}
+
+/**
+ * Create a selector
+ * path may name the cgroup as mounted (/sys/fs/cgroup/...) or relative
+ * to the mount; container is a container id prefix or a pod UID.
+ */
+cgroup_selector_t *cgroup_selector_create(const char *path, const char *container) {
+    static const char *const mounts[] = { CGROUP_V2_HYBRID_ROOT, CGROUP_V2_ROOT };
+    cgroup_selector_t *sel;
+    size_t len;
+    
+    sel = calloc(1, sizeof(*sel));
+    if (!sel) {
+        return NULL;
+    }
+    
+    if (path) {
+        for (size_t i = 0; i < sizeof(mounts) / sizeof(mounts[0]); i++) {
+            len = strlen(mounts[i]);
+            if (strncmp(path, mounts[i], len) == 0 && (path[len] == '/' || path[len] == '\0')) {
+                path += len;
+                break;
+            }
+        }
+        while (*path == '/') {
+            path++;
+        }
+        
+        len = strlen(path);
+        while (len > 0 && path[len - 1] == '/') {
+            len--;
+        }
+        sel->path = malloc(len + 2);
+        if (!sel->path) {
+            cgroup_selector_destroy(sel);
+            return NULL;
+        }
+        sel->path[0] = '/';
+        memcpy(sel->path + 1, path, len);
+        sel->path[len + 1] = '\0';
+    }
+    
+    if (container) {
+        sel->container = strdup(container);
+        if (!sel->container) {
+            cgroup_selector_destroy(sel);
+            return NULL;
+        }
+        for (char *c = sel->container; *c; c++) {
+            *c = *c == '_' ? '-' : (char)tolower((unsigned char)*c);
+        }
+    }
+    
+    return sel;
+}
+
+bool cgroup_selector_matches(const cgroup_selector_t *sel, const cgroup_info_t *info) {
+    size_t len;
+    
+    if (!sel || !info) {
+        return false;
+    }
+    
+    if (sel->path && strcmp(sel->path, "/") != 0) {
+        len = strlen(sel->path);
+        if (strncmp(info->path, sel->path, len) != 0 ||
+            (info->path[len] != '/' && info->path[len] != '\0')) {
+            return false;
+        }
+    }
+    
+    if (sel->container && sel->container[0]) {
+        /* Full ids match on the short id every container is cached by */
+        len = strlen(sel->container);
+        if (len > CGROUP_CONTAINER_ID_LEN && is_hex(sel->container, len)) {
+            len = CGROUP_CONTAINER_ID_LEN;
+        }
+        if (!(info->container && strncmp(info->container, sel->container, len) == 0) &&
+            !(info->pod && strcmp(info->pod, sel->container) == 0)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void cgroup_selector_destroy(cgroup_selector_t *sel) {
+    if (!sel) {
+        return;
+    }
+    
+    free(sel->path);
+    free(sel->container);
+    free(sel);
+}
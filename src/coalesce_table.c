@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * coalesce_table.c - Records behind the kernel's coalescing windows
+ * Chained hash table keyed like the kernel's coalesce map, with a second
+ * set of chains by PID so a process's keys can be visited when it exits.
+ * Only the polling thread touches it, so there is no locking.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/coalesce_table.h"
+#include "include/logger.h"
+
+/* Initial number of hash buckets (power of two) */
+#define COALESCE_INITIAL_BUCKETS 256
+
+struct coalesce_table {
+    coalesce_entry_t **buckets;
+    coalesce_entry_t **pid_buckets; /* Same size as buckets */
+    size_t bucket_mask;
+    size_t count;
+};
+
+static size_t hash_key(const coalesce_key_t *key) {
+    uint64_t hash = key->path_hash ^ ((uint64_t)key->pid << 32 | key->event_type);
+    
+    /* The path hash is already well mixed; fold in pid and type */
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 32;
+    return (size_t)hash;
+}
+
+static size_t hash_pid(uint32_t pid) {
+    return (size_t)(pid * 0x9e3779b1U);
+}
+
+static int keys_equal(const coalesce_key_t *a, const coalesce_key_t *b) {
+    return a->pid == b->pid && a->event_type == b->event_type && a->path_hash == b->path_hash;
+}
+
+/**
+ * Create an empty table
+ *
+ * @return Pointer to table, or NULL on failure
+ */
+coalesce_table_t *coalesce_table_create(void) {
+    coalesce_table_t *table = calloc(1, sizeof(*table));
+    
+    if (!table) {
+        log_error("Failed to allocate coalesce table");
+        return NULL;
+    }
+    
+    table->buckets = calloc(COALESCE_INITIAL_BUCKETS, sizeof(*table->buckets));
+    table->pid_buckets = calloc(COALESCE_INITIAL_BUCKETS, sizeof(*table->pid_buckets));
+    if (!table->buckets || !table->pid_buckets) {
+        log_error("Failed to allocate coalesce table");
+        free(table->buckets);
+        free(table->pid_buckets);
+        free(table);
+        return NULL;
+    }
+    
+    table->bucket_mask = COALESCE_INITIAL_BUCKETS - 1;
+    return table;
+}
+
+static void free_entry(coalesce_entry_t *entry) {
+    free(entry->record);
+    free(entry);
+}
+
+/**
+ * Destroy a table and every record it holds
+ */
+void coalesce_table_destroy(coalesce_table_t *table) {
+    if (!table) {
+        return;
+    }
+    
+    for (size_t i = 0; i <= table->bucket_mask; i++) {
+        coalesce_entry_t *entry = table->buckets[i];
+        while (entry) {
+            coalesce_entry_t *next = entry->next;
+            free_entry(entry);
+            entry = next;
+        }
+    }
+    
+    free(table->buckets);
+    free(table->pid_buckets);
+    free(table);
+}
+
+/**
+ * Double both bucket arrays and relink every entry
+ */
+static int grow_buckets(coalesce_table_t *table) {
+    size_t new_size = (table->bucket_mask + 1) * 2;
+    coalesce_entry_t **buckets = calloc(new_size, sizeof(*buckets));
+    coalesce_entry_t **pid_buckets = calloc(new_size, sizeof(*pid_buckets));
+    
+    if (!buckets || !pid_buckets) {
+        free(buckets);
+        free(pid_buckets);
+        return -1;
+    }
+    
+    for (size_t i = 0; i <= table->bucket_mask; i++) {
+        coalesce_entry_t *entry = table->buckets[i];
+        while (entry) {
+            coalesce_entry_t *next = entry->next;
+            size_t slot = hash_key(&entry->key) & (new_size - 1);
+            size_t pid_slot = hash_pid(entry->key.pid) & (new_size - 1);
+            entry->next = buckets[slot];
+            buckets[slot] = entry;
+            entry->pid_next = pid_buckets[pid_slot];
+            pid_buckets[pid_slot] = entry;
+            entry = next;
+        }
+    }
+    
+    free(table->buckets);
+    free(table->pid_buckets);
+    table->buckets = buckets;
+    table->pid_buckets = pid_buckets;
+    table->bucket_mask = new_size - 1;
+    return 0;
+}
+
+coalesce_entry_t *coalesce_table_find(coalesce_table_t *table, const coalesce_key_t *key) {
+    coalesce_entry_t *entry;
+    
+    if (!table || !key) {
+        return NULL;
+    }
+    
+    for (entry = table->buckets[hash_key(key) & table->bucket_mask]; entry; entry = entry->next) {
+        if (keys_equal(&entry->key, key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Remember the record that opened a key's window
+ *
+ * @param table Coalesce table
+ * @param key Kernel coalesce map key of the record
+ * @param record Raw ring buffer record
+ * @param size Record size
+ * @return 0 on success, -1 on failure
+ */
+int coalesce_table_put(coalesce_table_t *table, const coalesce_key_t *key,
+                       const void *record, size_t size) {
+    coalesce_entry_t *entry;
+    
+    if (!table || !key || !record || size == 0) {
+        return -1;
+    }
+    
+    entry = coalesce_table_find(table, key);
+    if (!entry) {
+        /* Keep the load factor at or under 1 */
+        if (table->count + 1 > table->bucket_mask + 1 && grow_buckets(table) != 0) {
+            return -1;
+        }
+        
+        entry = calloc(1, sizeof(*entry));
+        if (!entry) {
+            return -1;
+        }
+        entry->key = *key;
+        
+        size_t slot = hash_key(key) & table->bucket_mask;
+        size_t pid_slot = hash_pid(key->pid) & table->bucket_mask;
+        entry->next = table->buckets[slot];
+        table->buckets[slot] = entry;
+        entry->pid_next = table->pid_buckets[pid_slot];
+        table->pid_buckets[pid_slot] = entry;
+        table->count++;
+    }
+    
+    if (size > entry->capacity) {
+        void *buf = realloc(entry->record, size);
+        if (!buf) {
+            return -1;
+        }
+        entry->record = buf;
+        entry->capacity = size;
+    }
+    
+    memcpy(entry->record, record, size);
+    entry->size = size;
+    return 0;
+}
+
+/**
+ * Visit every entry
+ * The next entry is looked up before fn runs, so fn may have its own
+ * entry removed
+ */
+void coalesce_table_for_each(coalesce_table_t *table, coalesce_entry_fn fn, void *ctx) {
+    if (!table || !fn) {
+        return;
+    }
+    
+    for (size_t i = 0; i <= table->bucket_mask; i++) {
+        coalesce_entry_t *entry = table->buckets[i];
+        while (entry) {
+            coalesce_entry_t *next = entry->next;
+            if (fn(entry, ctx)) {
+                coalesce_table_remove(table, &entry->key);
+            }
+            entry = next;
+        }
+    }
+}
+
+void coalesce_table_for_each_pid(coalesce_table_t *table, uint32_t pid,
+                                 coalesce_entry_fn fn, void *ctx) {
+    if (!table || !fn) {
+        return;
+    }
+    
+    coalesce_entry_t *entry = table->pid_buckets[hash_pid(pid) & table->bucket_mask];
+    while (entry) {
+        coalesce_entry_t *next = entry->pid_next;
+        if (entry->key.pid == pid && fn(entry, ctx)) {
+            coalesce_table_remove(table, &entry->key);
+        }
+        entry = next;
+    }
+}
+
+void coalesce_table_remove(coalesce_table_t *table, const coalesce_key_t *key) {
+    coalesce_entry_t **link;
+    coalesce_entry_t *entry = NULL;
+    
+    if (!table || !key) {
+        return;
+    }
+    
+    for (link = &table->buckets[hash_key(key) & table->bucket_mask]; *link; link = &(*link)->next) {
+        if (keys_equal(&(*link)->key, key)) {
+            entry = *link;
+            *link = entry->next;
+            break;
+        }
+    }
+    if (!entry) {
+        return;
+    }
+    
+    for (link = &table->pid_buckets[hash_pid(key->pid) & table->bucket_mask]; *link;
+         link = &(*link)->pid_next) {
+        if (*link == entry) {
+            *link = entry->pid_next;
+            break;
+        }
+    }
+    
+    free_entry(entry);
+    table->count--;
+}
+
+size_t coalesce_table_count(const coalesce_table_t *table) {
+    return table ? table->count : 0;
+}
@@ -0,0 +1,538 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * crypto_classifier.c - Compiled crypto file and library classifier
+ * Extensions are compiled into a trie of reversed, lower-cased suffixes
+ * that is walked from the end of the path; library names are compiled
+ * into an Aho-Corasick automaton with a full transition table, so a
+ * path is matched against every name in one pass.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "include/crypto_classifier.h"
+#include "include/logger.h"
+#include "ebpf/common.h"
+
+/* Upper bound on automaton states (transitions are 16-bit) */
+#define MAX_LIBRARY_STATES 65535
+
+/* Longest rule file line */
+#define MAX_RULE_LINE 512
+
+/* Built-in rules */
+static const char *const builtin_libraries[] = {
+    "libssl",
+    "libcrypto",
+    "libgnutls",
+    "libsodium",
+    "libnss3",
+    "libmbedtls",
+    NULL
+};
+
+static const struct {
+    const char *suffix;
+    file_type_t type;
+} builtin_extensions[] = {
+    /* Requirement 17.1: .pem files are classified as "certificate" (v1.0 simplification) */
+    { ".crt", FILE_TYPE_CERTIFICATE },
+    { ".cer", FILE_TYPE_CERTIFICATE },
+    { ".pem", FILE_TYPE_CERTIFICATE },
+    { ".key", FILE_TYPE_PRIVATE_KEY },
+    { ".p12", FILE_TYPE_KEYSTORE },
+    { ".pfx", FILE_TYPE_KEYSTORE },
+    { ".jks", FILE_TYPE_KEYSTORE },
+    { ".keystore", FILE_TYPE_KEYSTORE },
+    { NULL, FILE_TYPE_UNKNOWN }
+};
+
+/* Reversed-suffix trie node (node 0 is the root) */
+typedef struct {
+    int32_t child;             /* First child, -1 = none */
+    int32_t sibling;           /* Next sibling, -1 = none */
+    unsigned char c;
+    int8_t type;               /* Type of a suffix ending here, -1 = none */
+} suffix_node_t;
+
+struct crypto_classifier {
+    suffix_node_t *suffix_nodes;
+    size_t suffix_count;
+    size_t suffix_capacity;
+    
+    uint16_t (*library_next)[256];  /* DFA transitions by state and byte */
+    bool *library_accept;           /* A library name ends in this state */
+    size_t library_states;
+    size_t library_capacity;
+};
+
+static crypto_classifier_t *builtin_classifier;
+static crypto_classifier_t *installed_classifier;
+static pthread_once_t builtin_once = PTHREAD_ONCE_INIT;
+
+static crypto_classifier_t *classifier_alloc(void) {
+    crypto_classifier_t *classifier = calloc(1, sizeof(*classifier));
+    
+    if (!classifier) {
+        log_error("Failed to allocate crypto classifier");
+        return NULL;
+    }
+    
+    /* Root of the suffix trie and start state of the automaton */
+    classifier->suffix_nodes = malloc(16 * sizeof(*classifier->suffix_nodes));
+    classifier->library_next = calloc(16, sizeof(*classifier->library_next));
+    classifier->library_accept = calloc(16, sizeof(*classifier->library_accept));
+    if (!classifier->suffix_nodes || !classifier->library_next || !classifier->library_accept) {
+        log_error("Failed to allocate crypto classifier");
+        crypto_classifier_destroy(classifier);
+        return NULL;
+    }
+    
+    classifier->suffix_nodes[0] = (suffix_node_t){ .child = -1, .sibling = -1, .type = -1 };
+    classifier->suffix_count = 1;
+    classifier->suffix_capacity = 16;
+    classifier->library_states = 1;
+    classifier->library_capacity = 16;
+    return classifier;
+}
+
+void crypto_classifier_destroy(crypto_classifier_t *classifier) {
+    if (!classifier) {
+        return;
+    }
+    
+    free(classifier->suffix_nodes);
+    free(classifier->library_next);
+    free(classifier->library_accept);
+    free(classifier);
+}
+
+/**
+ * Add an extension rule to the suffix trie
+ */
+static int add_extension(crypto_classifier_t *classifier, const char *suffix, file_type_t type) {
+    size_t len = strlen(suffix);
+    int32_t node = 0;
+    
+    if (len == 0) {
+        return -1;
+    }
+    
+    for (size_t i = len; i-- > 0;) {
+        unsigned char c = (unsigned char)tolower((unsigned char)suffix[i]);
+        int32_t child = classifier->suffix_nodes[node].child;
+        
+        while (child >= 0 && classifier->suffix_nodes[child].c != c) {
+            child = classifier->suffix_nodes[child].sibling;
+        }
+        
+        if (child < 0) {
+            if (classifier->suffix_count == classifier->suffix_capacity) {
+                size_t new_capacity = classifier->suffix_capacity * 2;
+                suffix_node_t *nodes = realloc(classifier->suffix_nodes,
+                                               new_capacity * sizeof(*nodes));
+                if (!nodes) {
+                    return -1;
+                }
+                classifier->suffix_nodes = nodes;
+                classifier->suffix_capacity = new_capacity;
+            }
+            
+            child = (int32_t)classifier->suffix_count++;
+            classifier->suffix_nodes[child] = (suffix_node_t){
+                .child = -1,
+                .sibling = classifier->suffix_nodes[node].child,
+                .c = c,
+                .type = -1,
+            };
+            classifier->suffix_nodes[node].child = child;
+        }
+        node = child;
+    }
+    
+    classifier->suffix_nodes[node].type = (int8_t)type;
+    return 0;
+}
+
+/**
+ * Add a library name to the automaton's trie (finalized by
+ * build_library_automaton)
+ */
+static int add_library(crypto_classifier_t *classifier, const char *name) {
+    size_t state = 0;
+    
+    if (name[0] == '\0') {
+        return -1;
+    }
+    
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        if (classifier->library_next[state][*p] == 0) {
+            if (classifier->library_states == MAX_LIBRARY_STATES) {
+                return -1;
+            }
+            if (classifier->library_states == classifier->library_capacity) {
+                size_t new_capacity = classifier->library_capacity * 2;
+                uint16_t (*next)[256] = realloc(classifier->library_next,
+                                                new_capacity * sizeof(*next));
+                bool *accept;
+                
+                if (!next) {
+                    return -1;
+                }
+                classifier->library_next = next;
+                accept = realloc(classifier->library_accept, new_capacity * sizeof(*accept));
+                if (!accept) {
+                    return -1;
+                }
+                classifier->library_accept = accept;
+                memset(next + classifier->library_capacity, 0,
+                       (new_capacity - classifier->library_capacity) * sizeof(*next));
+                memset(accept + classifier->library_capacity, 0,
+                       (new_capacity - classifier->library_capacity) * sizeof(*accept));
+                classifier->library_capacity = new_capacity;
+            }
+            classifier->library_next[state][*p] = (uint16_t)classifier->library_states++;
+        }
+        state = classifier->library_next[state][*p];
+    }
+    
+    classifier->library_accept[state] = true;
+    return 0;
+}
+
+/**
+ * Turn the library trie into a DFA: breadth-first, each missing
+ * transition is pointed at the failure state's transition
+ */
+static int build_library_automaton(crypto_classifier_t *classifier) {
+    uint16_t *fail = calloc(classifier->library_states, sizeof(*fail));
+    uint16_t *queue = malloc(classifier->library_states * sizeof(*queue));
+    size_t head = 0, tail = 0;
+    
+    if (!fail || !queue) {
+        free(fail);
+        free(queue);
+        return -1;
+    }
+    
+    for (int c = 0; c < 256; c++) {
+        uint16_t s = classifier->library_next[0][c];
+        if (s != 0) {
+            queue[tail++] = s;
+        }
+    }
+    
+    while (head < tail) {
+        uint16_t r = queue[head++];
+        
+        classifier->library_accept[r] |= classifier->library_accept[fail[r]];
+        for (int c = 0; c < 256; c++) {
+            uint16_t s = classifier->library_next[r][c];
+            if (s != 0) {
+                fail[s] = classifier->library_next[fail[r]][c];
+                queue[tail++] = s;
+            } else {
+                classifier->library_next[r][c] = classifier->library_next[fail[r]][c];
+            }
+        }
+    }
+    
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+crypto_classifier_t *crypto_classifier_create(void) {
+    crypto_classifier_t *classifier = classifier_alloc();
+    
+    if (!classifier) {
+        return NULL;
+    }
+    
+    for (size_t i = 0; builtin_libraries[i]; i++) {
+        if (add_library(classifier, builtin_libraries[i]) != 0) {
+            goto fail;
+        }
+    }
+    for (size_t i = 0; builtin_extensions[i].suffix; i++) {
+        if (add_extension(classifier, builtin_extensions[i].suffix,
+                          builtin_extensions[i].type) != 0) {
+            goto fail;
+        }
+    }
+    if (build_library_automaton(classifier) != 0) {
+        goto fail;
+    }
+    
+    return classifier;
+    
+fail:
+    log_error("Failed to compile built-in crypto rules");
+    crypto_classifier_destroy(classifier);
+    return NULL;
+}
+
+/**
+ * Parse a rule file file type name
+ */
+static int parse_rule_type(const char *name, file_type_t *type) {
+    if (strcmp(name, "certificate") == 0) {
+        *type = FILE_TYPE_CERTIFICATE;
+    } else if (strcmp(name, "private_key") == 0) {
+        *type = FILE_TYPE_PRIVATE_KEY;
+    } else if (strcmp(name, "keystore") == 0) {
+        *type = FILE_TYPE_KEYSTORE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Compile a rule file
+ *
+ * @param rules_path Path of the rule file
+ * @return Classifier, or NULL if the file cannot be read or has errors
+ */
+crypto_classifier_t *crypto_classifier_load(const char *rules_path) {
+    crypto_classifier_t *classifier;
+    char line[MAX_RULE_LINE];
+    int line_no = 0;
+    int rules = 0;
+    FILE *fp;
+    
+    fp = fopen(rules_path, "r");
+    if (!fp) {
+        log_error("Cannot open crypto rules file: %s", rules_path);
+        return NULL;
+    }
+    
+    classifier = classifier_alloc();
+    if (!classifier) {
+        fclose(fp);
+        return NULL;
+    }
+    
+    while (fgets(line, sizeof(line), fp)) {
+        char *saveptr = NULL;
+        char *comment = strchr(line, '#');
+        char *keyword, *pattern, *type_name, *extra;
+        file_type_t type;
+        int ret;
+        
+        line_no++;
+        if (comment) {
+            *comment = '\0';
+        }
+        
+        keyword = strtok_r(line, " \t\r\n", &saveptr);
+        if (!keyword) {
+            continue;
+        }
+        pattern = strtok_r(NULL, " \t\r\n", &saveptr);
+        type_name = strtok_r(NULL, " \t\r\n", &saveptr);
+        extra = type_name ? strtok_r(NULL, " \t\r\n", &saveptr) : NULL;
+        
+        if (strcmp(keyword, "library") == 0 && pattern && !type_name) {
+            ret = add_library(classifier, pattern);
+        } else if (strcmp(keyword, "extension") == 0 && pattern && type_name && !extra) {
+            if (parse_rule_type(type_name, &type) != 0) {
+                log_error("%s:%d: unknown file type: %s", rules_path, line_no, type_name);
+                goto fail;
+            }
+            ret = add_extension(classifier, pattern, type);
+        } else {
+            log_error("%s:%d: expected 'library NAME' or 'extension SUFFIX TYPE'",
+                      rules_path, line_no);
+            goto fail;
+        }
+        
+        if (ret != 0) {
+            log_error("%s:%d: cannot add rule", rules_path, line_no);
+            goto fail;
+        }
+        rules++;
+    }
+    
+    if (build_library_automaton(classifier) != 0) {
+        log_error("Failed to compile crypto rules from %s", rules_path);
+        goto fail;
+    }
+    
+    fclose(fp);
+    log_debug("Loaded %d crypto rules from %s", rules, rules_path);
+    return classifier;
+    
+fail:
+    fclose(fp);
+    crypto_classifier_destroy(classifier);
+    return NULL;
+}
+
+/**
+ * Classify a file by its longest matching extension
+ */
+file_type_t crypto_classifier_file_type(const crypto_classifier_t *classifier, const char *path) {
+    const suffix_node_t *nodes;
+    int best = -1;
+    int32_t node = 0;
+    size_t len;
+    
+    if (!classifier || !path) {
+        return FILE_TYPE_UNKNOWN;
+    }
+    
+    nodes = classifier->suffix_nodes;
+    len = strlen(path);
+    while (len > 0) {
+        unsigned char c = (unsigned char)tolower((unsigned char)path[--len]);
+        int32_t child = nodes[node].child;
+        
+        while (child >= 0 && nodes[child].c != c) {
+            child = nodes[child].sibling;
+        }
+        if (child < 0) {
+            break;
+        }
+        
+        node = child;
+        if (nodes[node].type >= 0) {
+            best = nodes[node].type;
+        }
+    }
+    
+    return best >= 0 ? (file_type_t)best : FILE_TYPE_UNKNOWN;
+}
+
+/**
+ * Check whether a path contains any crypto library name
+ */
+bool crypto_classifier_is_library(const crypto_classifier_t *classifier, const char *path) {
+    uint16_t state = 0;
+    
+    if (!classifier || !path) {
+        return false;
+    }
+    
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        state = classifier->library_next[state][*p];
+        if (classifier->library_accept[state]) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * Depth-first walk of the suffix trie below node; buf holds the
+ * reversed suffix so far and suffix is scratch for the reported one
+ */
+static void walk_suffixes(const crypto_classifier_t *classifier, int32_t node, char *buf,
+                          char *suffix, size_t depth, crypto_extension_fn fn, void *ctx) {
+    const suffix_node_t *nodes = classifier->suffix_nodes;
+    
+    if (nodes[node].type >= 0 && depth > 0) {
+        for (size_t i = 0; i < depth; i++) {
+            suffix[i] = buf[depth - 1 - i];
+        }
+        suffix[depth] = '\0';
+        fn(suffix, (file_type_t)nodes[node].type, ctx);
+    }
+    
+    if (depth + 1 >= MAX_RULE_LINE) {
+        return;
+    }
+    for (int32_t child = nodes[node].child; child >= 0; child = nodes[child].sibling) {
+        buf[depth] = (char)nodes[child].c;
+        walk_suffixes(classifier, child, buf, suffix, depth + 1, fn, ctx);
+    }
+}
+
+/**
+ * Call fn for every extension rule (lower-cased), e.g. to build a
+ * kernel-side prefilter that follows the loaded rules
+ */
+void crypto_classifier_for_each_extension(const crypto_classifier_t *classifier,
+                                          crypto_extension_fn fn, void *ctx) {
+    char buf[MAX_RULE_LINE];
+    char suffix[MAX_RULE_LINE];
+    
+    if (!classifier || !fn) {
+        return;
+    }
+    
+    walk_suffixes(classifier, 0, buf, suffix, 0, fn, ctx);
+}
+
+/* Kernel table being filled by crypto_classifier_kernel_extensions() */
+typedef struct {
+    struct ct_crypto_extension *entries;
+    int count;
+    bool fits;
+} kernel_extensions_t;
+
+static void gather_kernel_extension(const char *suffix, file_type_t type, void *ctx) {
+    kernel_extensions_t *exts = ctx;
+    size_t len = strlen(suffix);
+    
+    (void)type;
+    if (exts->count >= MAX_CRYPTO_EXTENSIONS || len > MAX_EXTENSION_LEN) {
+        exts->fits = false;
+        return;
+    }
+    
+    memset(&exts->entries[exts->count], 0, sizeof(exts->entries[exts->count]));
+    exts->entries[exts->count].len = (__u32)len;
+    memcpy(exts->entries[exts->count].suffix, suffix, len);
+    exts->count++;
+}
+
+/**
+ * Fill a kernel-side prefilter table from the extension rules, so the
+ * kernel drops exactly the opens the classifier would not report
+ */
+int crypto_classifier_kernel_extensions(const crypto_classifier_t *classifier,
+                                        struct ct_crypto_extension *table) {
+    kernel_extensions_t exts = { .entries = table, .fits = true };
+    
+    if (!classifier || !table) {
+        return -1;
+    }
+    
+    crypto_classifier_for_each_extension(classifier, gather_kernel_extension, &exts);
+    return exts.fits ? exts.count : -1;
+}
+
+static void create_builtin_classifier(void) {
+    builtin_classifier = crypto_classifier_create();
+}
+
+const crypto_classifier_t *crypto_classifier_default(void) {
+    if (installed_classifier) {
+        return installed_classifier;
+    }
+    
+    pthread_once(&builtin_once, create_builtin_classifier);
+    return builtin_classifier;
+}
+
+/**
+ * Install the process-wide classifier (takes ownership; NULL restores the
+ * built-in rules)
+ */
+void crypto_classifier_set_default(crypto_classifier_t *classifier) {
+    crypto_classifier_t *previous = installed_classifier;
+    
+    installed_classifier = classifier;
+    crypto_classifier_destroy(previous);
+}
@@ -0,0 +1,530 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * daemon.c - Event fan-out of "crypto-tracer daemon"
+ * Every client gets its own binary formatter, writing through a
+ * non-blocking stream on its socket: the polling thread never waits for
+ * a client, and one that cannot take a flush is dropped. The accept
+ * thread only takes the client list lock to add a client.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "include/daemon.h"
+#include "include/ebpf_manager.h"
+#include "include/event_processor.h"
+#include "include/output_formatter.h"
+#include "include/logger.h"
+
+/* How long a client gets to send its request */
+#define REQUEST_TIMEOUT_MS 1000
+
+/* Socket send buffer per client: how far a client may fall behind */
+#define CLIENT_SNDBUF (4 << 20)
+
+/* Event kind of each source */
+static const event_kind_t source_event_kinds[EBPF_SOURCE_COUNT] = {
+    [EBPF_SOURCE_FILE_OPEN] = EVENT_FILE_OPEN,
+    [EBPF_SOURCE_LIB_LOAD] = EVENT_LIB_LOAD,
+    [EBPF_SOURCE_PROCESS_EXEC] = EVENT_PROCESS_EXEC,
+    [EBPF_SOURCE_PROCESS_EXIT] = EVENT_PROCESS_EXIT,
+    [EBPF_SOURCE_OPENSSL_API] = EVENT_API_CALL,
+};
+
+struct daemon_client {
+    unsigned int id;
+    int fd;
+    FILE *stream;                  /* Non-blocking writes to fd */
+    output_formatter_t *formatter; /* Binary format, batched */
+    daemon_request_t request;
+    bool failed;                   /* A write failed: drop at the next flush */
+    struct daemon_client *next;
+};
+
+struct daemon_server {
+    char *path;
+    int listen_fd;
+    int stop_pipe[2];
+    pthread_t thread;
+    pthread_mutex_t lock;
+    struct daemon_client *clients; /* Protected by lock */
+    atomic_uint client_count;
+    unsigned int next_id;
+};
+
+/**
+ * Encode a request
+ *
+ * @return Length of the request, or -1 if it does not fit in size
+ */
+int daemon_request_format(const daemon_request_t *req, char *buf, size_t size) {
+    int len;
+    
+    if (!req || !buf) {
+        return -1;
+    }
+    
+    len = snprintf(buf, size, "sources %u\n", req->sources);
+    if (len >= 0 && (size_t)len < size && req->pid > 0) {
+        len += snprintf(buf + len, size - (size_t)len, "pid %u\n", req->pid);
+    }
+    if (len >= 0 && (size_t)len < size && req->comm[0]) {
+        len += snprintf(buf + len, size - (size_t)len, "comm %s\n", req->comm);
+    }
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(buf + len, size - (size_t)len, "\n");
+    }
+    
+    return len >= 0 && (size_t)len < size ? len : -1;
+}
+
+/**
+ * Decode a request; unknown keys are skipped
+ *
+ * @return 0 on success, -1 on a malformed request
+ */
+int daemon_request_parse(const char *text, daemon_request_t *req) {
+    const char *line = text;
+    const char *end;
+    const char *value;
+    char *num_end;
+    unsigned long num;
+    size_t key_len;
+    size_t value_len;
+    
+    if (!text || !req) {
+        return -1;
+    }
+    memset(req, 0, sizeof(*req));
+    req->sources = EBPF_SOURCES_ALL;
+    
+    while ((end = strchr(line, '\n')) != NULL && end != line) {
+        value = memchr(line, ' ', (size_t)(end - line));
+        if (!value) {
+            return -1;
+        }
+        key_len = (size_t)(value - line);
+        value++;
+        value_len = (size_t)(end - value);
+        
+        if (key_len == 4 && strncmp(line, "comm", 4) == 0) {
+            if (value_len >= sizeof(req->comm)) {
+                return -1;
+            }
+            memcpy(req->comm, value, value_len);
+            req->comm[value_len] = '\0';
+        } else if ((key_len == 7 && strncmp(line, "sources", 7) == 0) ||
+                   (key_len == 3 && strncmp(line, "pid", 3) == 0)) {
+            errno = 0;
+            num = strtoul(value, &num_end, 10);
+            if (errno != 0 || num_end != end || num > UINT32_MAX) {
+                return -1;
+            }
+            if (key_len == 3) {
+                req->pid = (uint32_t)num;
+            } else {
+                req->sources = (uint32_t)num & EBPF_SOURCES_ALL;
+            }
+        }
+        line = end + 1;
+    }
+    
+    /* The request ends with an empty line */
+    return end == line ? 0 : -1;
+}
+
+/**
+ * Whether an event is one a client asked for
+ * An event without a process name is passed on: the client's own
+ * filters decide once it has enriched it.
+ */
+bool daemon_request_matches(const daemon_request_t *req, const processed_event_t *event) {
+    event_kind_t kind;
+    bool typed = false;
+    
+    if (!req || !event || !event->event_type) {
+        return false;
+    }
+    
+    kind = processed_event_kind(event);
+    for (int source = 0; source < EBPF_SOURCE_COUNT && !typed; source++) {
+        typed = (req->sources & EBPF_SOURCE_BIT(source)) && source_event_kinds[source] == kind;
+    }
+    if (!typed) {
+        return false;
+    }
+    if (req->pid > 0 && event->pid != req->pid) {
+        return false;
+    }
+    if (req->comm[0] && event->process && !substring_match(req->comm, event->process)) {
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Connect to the daemon and send the request
+ *
+ * @return Connected socket, or -1 on failure (logged)
+ */
+int daemon_connect(const char *path, const daemon_request_t *req) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    char request[DAEMON_REQUEST_MAX];
+    int len;
+    int fd;
+    
+    if (!path || strlen(path) >= sizeof(addr.sun_path)) {
+        log_error("Invalid daemon socket path: %s", path ? path : "(null)");
+        return -1;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    
+    len = daemon_request_format(req, request, sizeof(request));
+    if (len < 0) {
+        log_error("Daemon request too long");
+        return -1;
+    }
+    
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        log_system_error("socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        log_error("crypto-tracer daemon not reachable at %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (send(fd, request, (size_t)len, MSG_NOSIGNAL) != len) {
+        log_error("Failed to send request to crypto-tracer daemon: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+/* Stream write: never block the polling thread, never raise SIGPIPE */
+static ssize_t client_stream_write(void *cookie, const char *buf, size_t len) {
+    struct daemon_client *client = cookie;
+    size_t done = 0;
+    
+    while (done < len) {
+        ssize_t n = send(client->fd, buf + done, len - done, MSG_NOSIGNAL | MSG_DONTWAIT);
+        
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            client->failed = true;
+            return done > 0 ? (ssize_t)done : -1;
+        }
+        done += (size_t)n;
+    }
+    
+    return (ssize_t)done;
+}
+
+static void client_destroy(struct daemon_client *client) {
+    output_formatter_destroy(client->formatter);
+    if (client->stream) {
+        fclose(client->stream);
+    }
+    close(client->fd);
+    free(client);
+}
+
+/**
+ * Read a client's request and set up its stream
+ *
+ * @return Client, or NULL if it sent no valid request in time
+ */
+static struct daemon_client *client_accept(int fd) {
+    static const cookie_io_functions_t stream_io = { .write = client_stream_write };
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    char request[DAEMON_REQUEST_MAX];
+    struct daemon_client *client;
+    int sndbuf = CLIENT_SNDBUF;
+    size_t len = 0;
+    ssize_t n;
+    
+    /* Up to the empty line that ends the request */
+    while (len < 2 || request[len - 1] != '\n' || request[len - 2] != '\n') {
+        if (len == sizeof(request) - 1 || poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0) {
+            return NULL;
+        }
+        n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+        if (n <= 0) {
+            return NULL;
+        }
+        len += (size_t)n;
+        request[len] = '\0';
+    }
+    
+    client = calloc(1, sizeof(*client));
+    if (!client) {
+        return NULL;
+    }
+    client->fd = fd;
+    if (daemon_request_parse(request, &client->request) != 0) {
+        log_warn("Malformed daemon client request");
+        free(client);
+        return NULL;
+    }
+    
+    /* Root may raise the buffer past net.core.wmem_max */
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &sndbuf, sizeof(sndbuf)) != 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    }
+    
+    client->stream = fopencookie(client, "w", stream_io);
+    if (client->stream) {
+        setvbuf(client->stream, NULL, _IONBF, 0);
+        client->formatter = output_formatter_create(FORMAT_BINARY, client->stream);
+    }
+    if (!client->formatter) {
+        log_warn("Failed to set up daemon client stream");
+        client->fd = -1;
+        client_destroy(client);
+        return NULL;
+    }
+    output_formatter_set_batching(client->formatter, true);
+    
+    return client;
+}
+
+static void *daemon_server_main(void *arg) {
+    daemon_server_t *server = arg;
+    struct pollfd fds[2] = {
+        { .fd = server->listen_fd, .events = POLLIN },
+        { .fd = server->stop_pipe[0], .events = POLLIN },
+    };
+    struct daemon_client *client;
+    sigset_t mask;
+    
+    /* Leave SIGINT/SIGTERM to the capture thread */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    for (;;) {
+        int fd;
+        
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_warn("Daemon server stopped: %s", strerror(errno));
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        
+        fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        client = client_accept(fd);
+        if (!client) {
+            close(fd);
+            continue;
+        }
+        
+        pthread_mutex_lock(&server->lock);
+        client->id = ++server->next_id;
+        client->next = server->clients;
+        server->clients = client;
+        atomic_fetch_add(&server->client_count, 1);
+        pthread_mutex_unlock(&server->lock);
+        
+        log_info("Daemon client %u connected (sources 0x%x, pid %u, name '%s')", client->id,
+                 client->request.sources, client->request.pid, client->request.comm);
+    }
+    
+    return NULL;
+}
+
+/**
+ * Create the daemon socket and start accepting clients
+ *
+ * @return Server, or NULL on failure (logged)
+ */
+daemon_server_t *daemon_server_start(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    daemon_server_t *server;
+    struct stat st;
+    mode_t old_umask;
+    
+    if (!path || strlen(path) >= sizeof(addr.sun_path)) {
+        log_error("Invalid daemon socket path: %s", path ? path : "(null)");
+        return NULL;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    
+    /* Replace the socket of a previous run, but nothing else */
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            log_error("Daemon socket path exists and is not a socket: %s", path);
+            return NULL;
+        }
+        unlink(path);
+    }
+    
+    server = calloc(1, sizeof(*server));
+    if (!server) {
+        log_error("Failed to allocate daemon server");
+        return NULL;
+    }
+    server->listen_fd = -1;
+    server->stop_pipe[0] = server->stop_pipe[1] = -1;
+    atomic_init(&server->client_count, 0);
+    pthread_mutex_init(&server->lock, NULL);
+    
+    server->path = strdup(path);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (!server->path || server->listen_fd < 0 || pipe2(server->stop_pipe, O_CLOEXEC) != 0) {
+        log_system_error("daemon socket");
+        goto fail;
+    }
+    
+    old_umask = umask(0177);
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        umask(old_umask);
+        log_error("Failed to bind daemon socket: %s", path);
+        log_system_error("bind");
+        goto fail;
+    }
+    umask(old_umask);
+    
+    if (listen(server->listen_fd, 32) != 0 ||
+        pthread_create(&server->thread, NULL, daemon_server_main, server) != 0) {
+        log_system_error("daemon server");
+        unlink(path);
+        goto fail;
+    }
+    
+    log_info("Serving events on %s", path);
+    return server;
+
+fail:
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->stop_pipe[0] >= 0) {
+        close(server->stop_pipe[0]);
+        close(server->stop_pipe[1]);
+    }
+    pthread_mutex_destroy(&server->lock);
+    free(server->path);
+    free(server);
+    return NULL;
+}
+
+unsigned int daemon_server_client_count(daemon_server_t *server) {
+    return server ? atomic_load(&server->client_count) : 0;
+}
+
+/**
+ * Queue an event for every client whose request it matches
+ * Written out by the next daemon_server_flush()
+ */
+void daemon_server_publish(daemon_server_t *server, processed_event_t *event) {
+    struct daemon_client *client;
+    
+    if (!server || !event || atomic_load(&server->client_count) == 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&server->lock);
+    for (client = server->clients; client; client = client->next) {
+        if (!client->failed && daemon_request_matches(&client->request, event) &&
+            output_formatter_write_event(client->formatter, event) != 0) {
+            client->failed = true;
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+}
+
+/**
+ * Send the events published since the last flush, and drop the clients
+ * that went away or could not take them
+ */
+void daemon_server_flush(daemon_server_t *server) {
+    struct daemon_client **link;
+    struct daemon_client *client;
+    char byte;
+    
+    if (!server || atomic_load(&server->client_count) == 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&server->lock);
+    link = &server->clients;
+    while ((client = *link) != NULL) {
+        if (output_formatter_flush(client->formatter) != 0) {
+            client->failed = true;
+        }
+        /* Clients only ever send their request: readable means closed */
+        if (!client->failed && recv(client->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0) {
+            client->failed = true;
+        }
+        if (!client->failed) {
+            link = &client->next;
+            continue;
+        }
+        
+        *link = client->next;
+        atomic_fetch_sub(&server->client_count, 1);
+        log_info("Daemon client %u disconnected", client->id);
+        client_destroy(client);
+    }
+    pthread_mutex_unlock(&server->lock);
+}
+
+void daemon_server_stop(daemon_server_t *server) {
+    struct daemon_client *client;
+    
+    if (!server) {
+        return;
+    }
+    
+    if (write(server->stop_pipe[1], "", 1) < 0) {
+        log_debug("Failed to signal daemon server: %s", strerror(errno));
+    }
+    pthread_join(server->thread, NULL);
+    
+    while ((client = server->clients) != NULL) {
+        server->clients = client->next;
+        output_formatter_flush(client->formatter);
+        client_destroy(client);
+    }
+    
+    close(server->listen_fd);
+    close(server->stop_pipe[0]);
+    close(server->stop_pipe[1]);
+    unlink(server->path);
+    
+    pthread_mutex_destroy(&server->lock);
+    free(server->path);
+    free(server);
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * coalesce.h - Kernel-side dedupe of repeated (process, path) events
+ * Kernel-side only; include after probe_common.h
+ *
+ * With a window configured, the first file open or library load of a
+ * path by a process is submitted as usual and opens a window; repeats
+ * inside the window only bump a counter in an LRU map. User-space reads
+ * the counters (see ebpf_manager_flush_coalesced) and reports them as
+ * one aggregated event per key, so a worker pool reopening the same CA
+ * bundle costs a map update per open instead of a ring buffer record.
+ */
+
+#ifndef __COALESCE_H__
+#define __COALESCE_H__
+
+/* Coalescing window, set from user-space before load (0 = off) */
+const volatile __u64 coalesce_window_ns = 0;
+
+/* Open windows; least recently used keys are evicted under pressure */
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_COALESCE_KEYS);
+    __type(key, struct ct_coalesce_key);
+    __type(value, struct ct_coalesce_value);
+} coalesce SEC(".maps");
+
+/* FNV-1a hash of the first len bytes of path
+ * Bounded by MAX_FILENAME_LEN; the index is masked for the verifier */
+static __always_inline __u64 coalesce_path_hash(const char *path, __u32 len) {
+    __u64 hash = 14695981039346656037ULL;
+    __u32 i;
+    
+    for (i = 0; i < MAX_FILENAME_LEN; i++) {
+        if (i >= len) {
+            break;
+        }
+        hash ^= (unsigned char)path[i & (MAX_FILENAME_LEN - 1)];
+        hash *= 1099511628211ULL;
+    }
+    
+    return hash;
+}
+
+/* Decide whether an event is submitted or folded into an open window
+ * path_len excludes the NUL and weight is the number of events the
+ * event stands for (see rate_limit_weight). Sets *path_hash to the key
+ * hash (0 when coalescing is off) and returns false for repeats, which
+ * are counted in stats[CT_STAT_COALESCED].
+ */
+static __always_inline bool coalesce_submit(__u32 event_type, const char *path, __u32 path_len,
+                                            __u32 weight, __u64 now, __u64 *path_hash) {
+    struct ct_coalesce_value *value;
+    struct ct_coalesce_key key = {};
+    
+    *path_hash = 0;
+    if (coalesce_window_ns == 0) {
+        return true;
+    }
+    
+    key.pid = bpf_get_current_pid_tgid() >> 32;
+    key.event_type = event_type;
+    key.path_hash = coalesce_path_hash(path, path_len);
+    *path_hash = key.path_hash;
+    
+    value = bpf_map_lookup_elem(&coalesce, &key);
+    if (!value) {
+        struct ct_coalesce_value fresh = { .window_start_ns = now };
+        
+        bpf_map_update_elem(&coalesce, &key, &fresh, BPF_NOEXIST);
+        return true;
+    }
+    
+    if (now - value->window_start_ns < coalesce_window_ns) {
+        __sync_fetch_and_add(&value->repeats, weight);
+        count_stat(CT_STAT_COALESCED);
+        return false;
+    }
+    
+    /* Window closed: this event opens the next one; repeats keeps
+     * counting up so none are lost before user-space reads them */
+    value->window_start_ns = now;
+    return true;
+}
+
+#endif /* __COALESCE_H__ */
@@ -17,12 +17,61 @@
 #include <linux/types.h>
 #endif
 
-/* Maximum string lengths */
-#define MAX_FILENAME_LEN 256
+/* Maximum string lengths
+ * Path lengths are capacities, not record sizes: path records are
+ * variable length and only carry the bytes actually used */
+#define MAX_FILENAME_LEN 4096
 #define MAX_COMM_LEN 16
-#define MAX_CMDLINE_LEN 256
-#define MAX_LIBPATH_LEN 256
+#define MAX_LIBPATH_LEN 4096
 #define MAX_FUNCNAME_LEN 64
+#define MAX_EXEC_ARGS_LEN 512      /* argv bytes captured per exec (power of two) */
+
+/* Default size of each program's ring buffer (power of two, resized at load) */
+#define CT_RINGBUF_DEFAULT_SIZE (1U << 20)
+
+/* Sharded ring buffer layout limits (see probe_common.h) */
+#define CT_MAX_RING_SHARDS 256
+#define CT_MAX_CPUS 4096
+
+/* Kernel-side crypto file prefilter limits */
+#define MAX_CRYPTO_EXTENSIONS 16
+#define MAX_EXTENSION_LEN 16
+
+/* Kernel-side process filter limits */
+#define MAX_FILTER_PIDS 8192
+#define MAX_FILTER_COMMS 4
+#define MAX_FILTER_UIDS 64
+#define MAX_FILTER_CGROUPS 256
+
+/* Deepest cgroup v2 level the cgroup filter looks at for an ancestor */
+#define CT_MAX_CGROUP_DEPTH 16
+
+/* (process, function) pairs counted in the kernel in API aggregation mode */
+#define MAX_API_COUNT_KEYS 16384
+
+/* TLS handshake latency: (process, function) histograms, and handshakes
+ * and handshake calls in progress */
+#define MAX_HANDSHAKE_KEYS 4096
+#define MAX_HANDSHAKES_IN_FLIGHT 16384
+
+/* Buckets of a handshake latency histogram: bucket i counts handshakes
+ * that took [2^i, 2^(i+1)) microseconds, bucket 0 also shorter ones,
+ * the last one also longer ones */
+#define CT_LATENCY_BUCKETS 32
+
+/* (process, event type, path) keys tracked in --coalesce mode */
+#define MAX_COALESCE_KEYS 16384
+
+/* Longest dentry name the snapshot iterator matches extensions against */
+#define MAX_DNAME_LEN 256
+
+/* Process filter flags (struct ct_filter_config.flags) */
+#define CT_FILTER_PID             (1U << 0)
+#define CT_FILTER_COMM            (1U << 1)
+#define CT_FILTER_UID             (1U << 2)
+#define CT_FILTER_FOLLOW_CHILDREN (1U << 3)
+#define CT_FILTER_CGROUP          (1U << 4)
+#define CT_FILTER_STOPPED         (1U << 5)  /* Shutting down: submit nothing */
 
 /* Event types */
 enum ct_event_type {
@@ -31,42 +80,191 @@ enum ct_event_type {
     CT_EVENT_PROCESS_EXEC = 3,
     CT_EVENT_PROCESS_EXIT = 4,
     CT_EVENT_API_CALL = 5,
+    CT_EVENT_TYPE_MAX,
+};
+
+/* OpenSSL functions traced by openssl_api_trace (ct_api_count_key.function_id) */
+enum ct_api_function {
+    CT_API_SSL_CTX_NEW = 0,
+    CT_API_SSL_CONNECT,
+    CT_API_SSL_ACCEPT,
+    CT_API_SSL_DO_HANDSHAKE,       /* Handshake latency only, never an api_call */
+    CT_API_FUNCTION_COUNT,
+};
+
+/* Per-program kernel-side counters (index into a program's stats map) */
+enum ct_stat_id {
+    CT_STAT_FILTERED = 0,          /* Events dropped by a program-specific prefilter */
+    CT_STAT_PROCESS_FILTERED,      /* Events dropped by the PID/comm/UID/cgroup filter */
+    CT_STAT_RINGBUF_FULL,          /* Events lost because the ring buffer was full */
+    CT_STAT_COALESCED,             /* Repeats folded into a coalescing window */
+    CT_STAT_SAMPLED_OUT,           /* Events skipped by 1-in-N sampling */
+    CT_STAT_RATE_LIMITED,          /* Events over the token bucket rate limit */
+    CT_STAT_MAX,
+};
+
+/* Crypto file extension entry for the kernel-side prefilter
+ * Suffixes are stored lower-case; len == 0 marks an unused slot */
+struct ct_crypto_extension {
+    __u32 len;
+    char suffix[MAX_EXTENSION_LEN];
+};
+
+/* Snapshot iterator record kinds (struct ct_iter_record.kind) */
+enum ct_iter_kind {
+    CT_ITER_LIBRARY = 1,           /* Executable file mapping */
+    CT_ITER_FILE = 2,              /* Open file with a crypto extension */
+};
+
+/* Record written by the snapshot iterators, followed by path_len bytes
+ * of NUL-terminated path; records are packed back to back */
+struct ct_iter_record {
+    __u32 pid;                     /* TGID */
+    __u32 kind;
+    __s32 fd;                      /* CT_ITER_FILE: descriptor number, otherwise -1 */
+    __u32 path_len;                /* Including the NUL */
+    __u64 ino;
+};
+
+/* Process filter configuration; flags == 0 lets every process through */
+struct ct_filter_config {
+    __u32 flags;
+};
+
+/* Rate limit and sampling of one event type (rate_config map, indexed
+ * by enum ct_event_type). rate is this CPU's share of the limit in events
+ * per second and burst its bucket size; 0 means no limit. With
+ * sample_every > 1 only every Nth event is considered at all. */
+struct ct_rate_config {
+    __u32 rate;
+    __u32 burst;
+    __u32 sample_every;
+    __u32 reserved;
+};
+
+/* Per-CPU token bucket and sampling state (rate_state map) */
+struct ct_rate_state {
+    __u64 credit;                  /* Tokens in units of 1e-9 events */
+    __u64 last_ns;                 /* Last refill, 0 = bucket not started */
+    __u64 suppressed;              /* Events skipped since the last submitted one */
+    __u32 seen;                    /* Events seen, for 1-in-N sampling */
+    __u32 reserved;
+};
+
+/* Comm substring for the process filter
+ * Patterns are stored lower-case and matched case-insensitively,
+ * like the user-space --name filter; len == 0 marks an unused slot */
+struct ct_comm_pattern {
+    __u32 len;
+    char pattern[MAX_COMM_LEN];
 };
 
 /* Base event header - prefixed with ct_ to avoid conflicts with kernel types */
 struct ct_event_header {
-    __u64 timestamp_ns;
+    __u64 timestamp_ns;            /* bpf_ktime_get_boot_ns(): CLOCK_BOOTTIME, survives suspend */
+    __u64 start_time_ns;           /* Process start time; (pid, start_time_ns) survives PID reuse */
+    __u64 cgroup_id;               /* bpf_get_current_cgroup_id(): the task's cgroup v2 */
     __u32 pid;
     __u32 uid;
     char comm[MAX_COMM_LEN];
     __u32 event_type;
+    __u32 weight;                  /* Events the record stands for, itself included,
+                                    * after sampling and rate limiting (0 = one) */
 };
 
-/* File open event */
+/* Size of a variable-length record whose trailing payload is len bytes */
+#define CT_RECORD_SIZE(type, payload, len) (offsetof(type, payload) + (len))
+
+/* File open event (variable length)
+ * filename_len counts the NUL; only CT_RECORD_SIZE(..., filename,
+ * filename_len) bytes are submitted. The security_file_open flavor
+ * sends the absolute path of the opened file, with its inode and device;
+ * the others send the name as passed to open, and ino 0.
+ */
 struct ct_file_open_event {
     struct ct_event_header header;
-    char filename[MAX_FILENAME_LEN];
+    __u64 path_hash;               /* Coalescing key hash (0 when coalescing is off) */
+    __u64 ino;                     /* Inode of the opened file (0 = not resolved) */
+    __u32 dev;                     /* Its device, kernel encoding (MAJOR << 20 | MINOR) */
+    __u32 count;                   /* Opens the record stands for (0 = one) */
     __u32 flags;
     __s32 result;
+    __u32 filename_len;
+    char filename[MAX_FILENAME_LEN];
 };
 
-/* Library load event */
+/* Library load event (variable length, see ct_file_open_event) */
 struct ct_lib_load_event {
     struct ct_event_header header;
+    __u64 path_hash;               /* Coalescing key hash (0 when coalescing is off) */
+    __u32 count;                   /* Loads the record stands for (0 = one) */
+    __u32 lib_path_len;
     char lib_path[MAX_LIBPATH_LEN];
 };
 
-/* Process execution event */
+/* Process execution event (variable length)
+ * data holds the NUL-terminated exec filename (filename_len bytes,
+ * including the NUL) followed by args_len bytes of NUL-separated argv.
+ * Only offsetof(data) + filename_len + args_len bytes are submitted.
+ */
 struct ct_process_exec_event {
     struct ct_event_header header;
     __u32 ppid;
-    char cmdline[MAX_CMDLINE_LEN];
+    __u16 filename_len;
+    __u16 args_len;
+    char data[MAX_FILENAME_LEN + MAX_EXEC_ARGS_LEN];
 };
 
 /* Process exit event */
 struct ct_process_exit_event {
     struct ct_event_header header;
     __s32 exit_code;
+    __u32 tid;                     /* Exiting thread; the process exits with its
+                                    * leader (tid == header.pid) */
+};
+
+/* Key of the per-CPU API call count map; the value is a __u64 count */
+struct ct_api_count_key {
+    __u32 pid;                     /* TGID */
+    __u32 function_id;             /* enum ct_api_function */
+};
+
+/* A TLS handshake in progress, by SSL object */
+struct ct_handshake_key {
+    __u64 ssl;                     /* SSL * */
+    __u32 pid;                     /* TGID */
+    __u32 pad;
+};
+
+struct ct_handshake_start {
+    __u64 start_ns;                /* First call of the handshake */
+    __u32 function_id;             /* enum ct_api_function */
+    __u32 pad;
+};
+
+/* Handshake latencies of one (process, function) pair, keyed by
+ * struct ct_api_count_key; the counters only grow */
+struct ct_handshake_hist {
+    __u64 buckets[CT_LATENCY_BUCKETS];   /* Completed handshakes */
+    __u64 errors;                  /* Failed handshakes */
+    __u64 total_ns;                /* Sum of the completed durations */
+    char comm[MAX_COMM_LEN];
+};
+
+/* Key of the coalescing map (file_open and lib_load in --coalesce mode) */
+struct ct_coalesce_key {
+    __u32 pid;                     /* TGID */
+    __u32 event_type;              /* enum ct_event_type */
+    __u64 path_hash;               /* FNV-1a of the path */
+};
+
+/* Coalescing window of one key
+ * The first event of a window is submitted; repeats until the window
+ * closes only bump repeats, which never decreases, so user-space reports
+ * the growth since its last read */
+struct ct_coalesce_value {
+    __u64 window_start_ns;
+    __u64 repeats;
 };
 
 /* API call event */
@@ -5,80 +5,248 @@
 
 /**
  * file_open_trace.bpf.c - eBPF program for tracing file open operations
- * Monitors sys_enter_open and sys_enter_openat for crypto file access
+ * Monitors security_file_open or do_sys_openat2/do_sys_open for crypto
+ * file access
+ *
+ * Three flavors share the event path; user-space loads one of them. The
+ * security_file_open program (5.10+) runs once the path has been walked
+ * and reports the opened file itself: its absolute path from bpf_d_path,
+ * with relative names, dirfds and symlinks resolved, and its inode and
+ * device. The do_sys_openat2 fexit program (BTF trampolines) sees the
+ * name as passed to open and the returned fd. Both only report opens
+ * that succeeded so far, so ENOENT probes from certificate search loops
+ * are dropped here. The kprobes are the fallback for kernels without
+ * trampolines; they run before the open and report result 0.
  */
 
 #include "vmlinux.h"
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_core_read.h>
 #include <bpf/bpf_tracing.h>
-#include "common.h"
+#include "probe_common.h"
+#include "coalesce.h"
 
 char LICENSE[] SEC("license") = "GPL";
 
 /* Ring buffer for events */
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, 1 << 20); /* 1MB */
+    __uint(max_entries, CT_RINGBUF_DEFAULT_SIZE); /* Resized from user-space before load */
 } events SEC(".maps");
 
-/* Common function to handle file open events
- * NOTE: Filtering moved to user-space to avoid BPF verifier issues
- * with complex string operations
+/* Crypto file extensions, populated by user-space after load */
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_CRYPTO_EXTENSIONS);
+    __type(key, __u32);
+    __type(value, struct ct_crypto_extension);
+} crypto_extensions SEC(".maps");
+
+/* Per-CPU scratch event, so the ring buffer is only touched for candidates */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct ct_file_open_event);
+} scratch SEC(".maps");
+
+/* Check if the filename ends with one of the configured crypto extensions
+ * (case-insensitive). Loops are bounded by MAX_CRYPTO_EXTENSIONS and
+ * MAX_EXTENSION_LEN; indices are masked to keep the verifier happy.
+ * An empty extension table disables the prefilter.
  */
-static __always_inline int handle_file_open(const char *filename_ptr, __u32 flags) {
-    struct ct_file_open_event *event;
-    int len;
+static __always_inline bool is_crypto_candidate(const char *filename, __u32 name_len) {
+    struct ct_crypto_extension *ext;
+    __u32 i, j, idx;
+    char c;
     
-    if (!filename_ptr) {
+    for (i = 0; i < MAX_CRYPTO_EXTENSIONS; i++) {
+        __u32 key = i;
+        bool matched = true;
+        
+        ext = bpf_map_lookup_elem(&crypto_extensions, &key);
+        if (!ext || ext->len == 0) {
+            /* End of table; an empty table means "no prefilter" */
+            return i == 0;
+        }
+        
+        if (ext->len > MAX_EXTENSION_LEN || ext->len > name_len) {
+            continue;
+        }
+        
+        for (j = 0; j < MAX_EXTENSION_LEN; j++) {
+            if (j >= ext->len) {
+                break;
+            }
+            idx = (name_len - ext->len + j) & (MAX_FILENAME_LEN - 1);
+            c = filename[idx];
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+            if (c != ext->suffix[j]) {
+                matched = false;
+                break;
+            }
+        }
+        
+        if (matched) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/* Start a file open event in per-CPU scratch space
+ * Only successful opens (result >= 0) get one; failed ones are counted
+ * in stats[CT_STAT_FILTERED]
+ */
+static __always_inline struct ct_file_open_event *start_file_open(__s32 result) {
+    __u32 zero = 0;
+    
+    if (!process_allowed()) {
+        return NULL;
+    }
+    
+    if (result < 0) {
+        count_stat(CT_STAT_FILTERED);
+        return NULL;
+    }
+    
+    return bpf_map_lookup_elem(&scratch, &zero);
+}
+
+/* Submit a file open event whose filename (len bytes with the NUL),
+ * ino and dev are filled in
+ * Only files with a crypto extension are submitted; everything else is
+ * counted in stats[CT_STAT_FILTERED] and never reaches the ring buffer
+ */
+static __always_inline int submit_file_open(struct ct_file_open_event *event, int len,
+                                            __u32 flags, __s32 result) {
+    __u32 weight;
+    __u64 now;
+    
+    if (len <= 1 || len > MAX_FILENAME_LEN) {
+        /* Empty or error - discard */
         return 0;
     }
     
-    /* Reserve space in ring buffer */
-    event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
-    if (!event) {
+    /* Kernel-side prefilter on file extension */
+    if (!is_crypto_candidate(event->filename, (__u32)(len - 1))) {
+        count_stat(CT_STAT_FILTERED);
         return 0;
     }
     
-    /* Read filename directly into event structure */
-    len = bpf_probe_read_user_str(event->filename, sizeof(event->filename), filename_ptr);
-    if (len <= 1) {
-        /* Empty or error - discard */
-        bpf_ringbuf_discard(event, 0);
+    now = bpf_ktime_get_boot_ns();
+    weight = rate_limit_weight(CT_EVENT_FILE_OPEN, now);
+    if (weight == 0) {
+        return 0;
+    }
+    
+    /* Repeats inside a --coalesce window only bump a counter */
+    if (!coalesce_submit(CT_EVENT_FILE_OPEN, event->filename, (__u32)(len - 1), weight, now,
+                         &event->path_hash)) {
         return 0;
     }
     
     /* Fill event header */
-    event->header.timestamp_ns = bpf_ktime_get_ns();
+    event->header.timestamp_ns = now;
+    event->header.start_time_ns = current_start_time();
+    event->header.cgroup_id = bpf_get_current_cgroup_id();
     event->header.pid = bpf_get_current_pid_tgid() >> 32;
     event->header.uid = bpf_get_current_uid_gid() & 0xFFFFFFFF;
     event->header.event_type = CT_EVENT_FILE_OPEN;
+    event->header.weight = weight;
     
     /* Read process name (comm) */
     bpf_get_current_comm(&event->header.comm, sizeof(event->header.comm));
     
     /* Store flags */
+    event->count = 0;
     event->flags = flags;
-    event->result = 0;
+    event->result = result;
+    event->filename_len = len;
     
-    /* Submit event - filtering will happen in user-space */
-    bpf_ringbuf_submit(event, 0);
+    /* Copy the used part of the candidate event into the ring buffer */
+    ringbuf_output_record(&events, event,
+                          CT_RECORD_SIZE(struct ct_file_open_event, filename, len));
     
     return 0;
 }
 
+/* Handle an open by the name passed to it (do_sys_openat2/do_sys_open) */
+static __always_inline int handle_file_open(const char *filename_ptr, __u32 flags, __s32 result) {
+    struct ct_file_open_event *event;
+    int len;
+    
+    if (!filename_ptr) {
+        return 0;
+    }
+    
+    event = start_file_open(result);
+    if (!event) {
+        return 0;
+    }
+    
+    /* Read filename directly into event structure */
+    len = bpf_probe_read_user_str(event->filename, sizeof(event->filename), filename_ptr);
+    event->ino = 0;
+    event->dev = 0;
+    
+    return submit_file_open(event, len, flags, result);
+}
+
+/* fexit on security_file_open (every open that reaches the permission
+ * check, 5.10+ for bpf_d_path)
+ * The file is fully opened: its path is the canonical absolute path in
+ * the opener's root, whatever name, dirfd or symlinks were used. f_flags
+ * no longer holds the creation flags (O_CREAT, O_TRUNC, ...), only the
+ * access mode and status flags, which is all the event reports.
+ */
+SEC("fexit/security_file_open")
+int BPF_PROG(trace_security_file_open, struct file *file, int ret) {
+    struct ct_file_open_event *event;
+    struct inode *inode;
+    long len;
+    
+    event = start_file_open(ret);
+    if (!event) {
+        return 0;
+    }
+    
+    len = bpf_d_path(&file->f_path, event->filename, sizeof(event->filename));
+    inode = BPF_CORE_READ(file, f_inode);
+    event->ino = BPF_CORE_READ(inode, i_ino);
+    event->dev = BPF_CORE_READ(inode, i_sb, s_dev);
+    
+    return submit_file_open(event, (int)len, (__u32)BPF_CORE_READ(file, f_flags), ret);
+}
+
+/* fexit on do_sys_openat2 (open, openat and openat2 on 5.6+)
+ * Runs after the open with its arguments and return value; how is the
+ * kernel's copy of the caller's struct open_how
+ */
+SEC("fexit/do_sys_openat2")
+int BPF_PROG(trace_openat2_exit, int dfd, const char *filename, struct open_how *how, long ret) {
+    return handle_file_open(filename, (__u32)BPF_CORE_READ(how, flags), (__s32)ret);
+}
+
 /* Kprobe for do_sys_open (kernel function)
  * This is more reliable than tracepoints for file opening
  */
 SEC("kprobe/do_sys_openat2")
 int trace_do_sys_openat2(struct pt_regs *ctx) {
     const char *filename;
-    __u32 flags = 0;
+    struct open_how *how;
+    __u32 flags;
     
     /* do_sys_openat2(int dfd, const char __user *filename, struct open_how *how) */
     filename = (const char *)PT_REGS_PARM2(ctx);
+    how = (struct open_how *)PT_REGS_PARM3(ctx);
+    flags = (__u32)BPF_CORE_READ(how, flags);
     
-    return handle_file_open(filename, flags);
+    /* The result is not known yet: every open is reported */
+    return handle_file_open(filename, flags, 0);
 }
 
 /* Fallback kprobe for older kernels */
@@ -91,5 +259,5 @@ int trace_do_sys_open(struct pt_regs *ctx) {
     filename = (const char *)PT_REGS_PARM2(ctx);
     flags = (__u32)PT_REGS_PARM3(ctx);
     
-    return handle_file_open(filename, flags);
-}
\ No newline at end of file
+    return handle_file_open(filename, flags, 0);
+}
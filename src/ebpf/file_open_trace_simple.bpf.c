@@ -32,10 +32,12 @@ int trace_do_sys_openat2(struct pt_regs *ctx) {
     }
     
     /* Fill minimal event data */
-    event->header.timestamp_ns = bpf_ktime_get_ns();
+    event->header.timestamp_ns = bpf_ktime_get_boot_ns();
+    event->header.cgroup_id = bpf_get_current_cgroup_id();
     event->header.pid = bpf_get_current_pid_tgid() >> 32;
     event->header.uid = bpf_get_current_uid_gid() & 0xFFFFFFFF;
     event->header.event_type = CT_EVENT_FILE_OPEN;
+    event->header.weight = 1;
     
     /* Read process name */
     bpf_get_current_comm(&event->header.comm, sizeof(event->header.comm));
@@ -46,7 +48,10 @@ int trace_do_sys_openat2(struct pt_regs *ctx) {
     event->filename[2] = 's';
     event->filename[3] = 't';
     event->filename[4] = '\0';
+    event->filename_len = 5;
     
+    event->path_hash = 0;
+    event->count = 0;
     event->flags = 0;
     event->result = 0;
     
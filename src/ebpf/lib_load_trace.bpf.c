@@ -12,58 +12,88 @@
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_core_read.h>
 #include <bpf/bpf_tracing.h>
-#include "common.h"
+#include "probe_common.h"
+#include "coalesce.h"
 
 char LICENSE[] SEC("license") = "GPL";
 
 /* Ring buffer for events */
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, 1 << 20); /* 1MB */
+    __uint(max_entries, CT_RINGBUF_DEFAULT_SIZE); /* Resized from user-space before load */
 } events SEC(".maps");
 
+/* Per-CPU scratch event; only the used part is copied to the ring buffer */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct ct_lib_load_event);
+} scratch SEC(".maps");
+
 /* Uprobe for dlopen() function
  * dlopen() signature: void *dlopen(const char *filename, int flags)
  * On x86_64: filename is in rdi (PT_REGS_PARM1)
  * NOTE: Filtering moved to user-space to avoid BPF verifier issues
+ * Attached by user space to dlopen in every libc/libdl it finds
  */
-SEC("uprobe/dlopen")
+SEC("uprobe")
 int trace_dlopen(struct pt_regs *ctx) {
     struct ct_lib_load_event *event;
     const char *filename_ptr;
+    __u32 zero = 0;
+    __u32 weight;
+    __u64 now;
     int len;
     
     /* Get the filename argument (first parameter) */
     filename_ptr = (const char *)PT_REGS_PARM1(ctx);
-    if (!filename_ptr) {
+    if (!filename_ptr || !process_allowed()) {
         return 0;
     }
     
-    /* Reserve space in ring buffer */
-    event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
+    /* Build the event in per-CPU scratch space */
+    event = bpf_map_lookup_elem(&scratch, &zero);
     if (!event) {
         return 0;
     }
     
     /* Read library path directly into event structure */
     len = bpf_probe_read_user_str(event->lib_path, sizeof(event->lib_path), filename_ptr);
-    if (len <= 1) {
+    if (len <= 1 || len > MAX_LIBPATH_LEN) {
         /* Empty or error - discard */
-        bpf_ringbuf_discard(event, 0);
+        return 0;
+    }
+    event->lib_path_len = len;
+    event->count = 0;
+    
+    now = bpf_ktime_get_boot_ns();
+    weight = rate_limit_weight(CT_EVENT_LIB_LOAD, now);
+    if (weight == 0) {
+        return 0;
+    }
+    
+    /* Repeats inside a --coalesce window only bump a counter */
+    if (!coalesce_submit(CT_EVENT_LIB_LOAD, event->lib_path, (__u32)(len - 1), weight, now,
+                         &event->path_hash)) {
         return 0;
     }
     
     /* Fill event header */
-    event->header.timestamp_ns = bpf_ktime_get_ns();
+    event->header.timestamp_ns = now;
+    event->header.start_time_ns = current_start_time();
+    event->header.cgroup_id = bpf_get_current_cgroup_id();
     event->header.pid = bpf_get_current_pid_tgid() >> 32;
     event->header.uid = bpf_get_current_uid_gid() & 0xFFFFFFFF;
     event->header.event_type = CT_EVENT_LIB_LOAD;
+    event->header.weight = weight;
     
     /* Read process name (comm) */
     bpf_get_current_comm(&event->header.comm, sizeof(event->header.comm));
     
-    /* Submit event - filtering will happen in user-space */
-    bpf_ringbuf_submit(event, 0);
+    /* Submit the used part of the event - filtering will happen in user-space */
+    ringbuf_output_record(&events, event,
+                          CT_RECORD_SIZE(struct ct_lib_load_event, lib_path, len));
     
     return 0;
 }
\ No newline at end of file
@@ -5,7 +5,8 @@
 
 /**
  * openssl_api_trace.bpf.c - eBPF program for tracing OpenSSL API calls (optional)
- * Monitors OpenSSL API functions for SSL/TLS operations
+ * Monitors OpenSSL API functions for SSL/TLS operations, and measures
+ * TLS handshake latency with paired entry and return probes
  * NOTE: This is an optional P1 feature, not required for v1.0 MVP
  */
 
@@ -13,16 +14,65 @@
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_core_read.h>
 #include <bpf/bpf_tracing.h>
-#include "common.h"
+#include "probe_common.h"
 
 char LICENSE[] SEC("license") = "GPL";
 
 /* Ring buffer for events */
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, 1 << 20); /* 1MB */
+    __uint(max_entries, CT_RINGBUF_DEFAULT_SIZE); /* Resized from user-space before load */
 } events SEC(".maps");
 
+/* Call counts by (TGID, function), read in batches from user-space */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+    __uint(max_entries, MAX_API_COUNT_KEYS);
+    __type(key, struct ct_api_count_key);
+    __type(value, __u64);
+} api_counts SEC(".maps");
+
+/* Handshakes in progress: the first SSL_connect/SSL_accept/SSL_do_handshake
+ * call on an SSL object starts one; on a non-blocking socket the calls
+ * repeat until it completes or fails */
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_HANDSHAKES_IN_FLIGHT);
+    __type(key, struct ct_handshake_key);
+    __type(value, struct ct_handshake_start);
+} handshakes SEC(".maps");
+
+/* The SSL object of the handshake (or SSL_get_error) call a thread is in,
+ * for its return probe */
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_HANDSHAKES_IN_FLIGHT);
+    __type(key, __u64);            /* pid_tgid */
+    __type(value, __u64);          /* SSL * */
+} handshake_calls SEC(".maps");
+
+/* Handshake latency histograms by (TGID, function), read periodically
+ * from user-space */
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, MAX_HANDSHAKE_KEYS);
+    __type(key, struct ct_api_count_key);
+    __type(value, struct ct_handshake_hist);
+} handshake_latency SEC(".maps");
+
+/* Count calls in api_counts instead of sending an event per call
+ * (set from user-space before load) */
+const volatile bool aggregate_api_calls = false;
+
+/* Measure handshakes into handshake_latency (set from user-space before load) */
+const volatile bool measure_handshakes = false;
+
+/* SSL_get_error() results that leave a handshake in progress: WANT_READ,
+ * WANT_WRITE, WANT_X509_LOOKUP, WANT_CONNECT, WANT_ACCEPT, WANT_ASYNC,
+ * WANT_ASYNC_JOB, WANT_CLIENT_HELLO_CB, WANT_RETRY_VERIFY */
+#define SSL_WANT_MASK ((1U << 2) | (1U << 3) | (1U << 4) | (1U << 7) | (1U << 8) | \
+                       (1U << 9) | (1U << 10) | (1U << 11) | (1U << 12))
+
 /* Helper function to copy string literal */
 static __always_inline void copy_string(char *dst, const char *src, int max_len) {
     int i;
@@ -32,21 +82,182 @@ static __always_inline void copy_string(char *dst, const char *src, int max_len)
     dst[i] = '\0';
 }
 
+/* Count a call in this CPU's slot of api_counts
+ * Returns false if the map is full, so the call is sent as an event */
+static __always_inline bool count_api_call(__u32 function_id) {
+    struct ct_api_count_key key = {
+        .pid = bpf_get_current_pid_tgid() >> 32,
+        .function_id = function_id,
+    };
+    __u64 one = 1;
+    __u64 *count;
+    
+    count = bpf_map_lookup_elem(&api_counts, &key);
+    if (count) {
+        (*count)++;
+        return true;
+    }
+    
+    if (bpf_map_update_elem(&api_counts, &key, &one, BPF_NOEXIST) == 0) {
+        return true;
+    }
+    
+    /* Another CPU created the entry first; this CPU's slot starts at zero */
+    count = bpf_map_lookup_elem(&api_counts, &key);
+    if (count) {
+        (*count)++;
+        return true;
+    }
+    return false;
+}
+
+/* log2 of a duration in microseconds, capped to the last bucket */
+static __always_inline __u32 latency_bucket(__u64 ns) {
+    __u64 us = ns / 1000;
+    __u32 bucket = 0;
+    
+    if (us >> 32) {
+        return CT_LATENCY_BUCKETS - 1;
+    }
+    if (us >> 16) {
+        us >>= 16;
+        bucket += 16;
+    }
+    if (us >> 8) {
+        us >>= 8;
+        bucket += 8;
+    }
+    if (us >> 4) {
+        us >>= 4;
+        bucket += 4;
+    }
+    if (us >> 2) {
+        us >>= 2;
+        bucket += 2;
+    }
+    if (us >> 1) {
+        bucket += 1;
+    }
+    return bucket;
+}
+
+/* Remember the SSL object of the call the thread is entering */
+static __always_inline void stash_call(__u64 ssl) {
+    __u64 id = bpf_get_current_pid_tgid();
+    
+    bpf_map_update_elem(&handshake_calls, &id, &ssl, BPF_ANY);
+}
+
+/* Take the SSL object stashed at entry; 0 if there is none */
+static __always_inline __u64 take_call(void) {
+    __u64 id = bpf_get_current_pid_tgid();
+    __u64 *stashed = bpf_map_lookup_elem(&handshake_calls, &id);
+    __u64 ssl;
+    
+    if (!stashed) {
+        return 0;
+    }
+    ssl = *stashed;
+    bpf_map_delete_elem(&handshake_calls, &id);
+    return ssl;
+}
+
+/* A handshake call starts: the first one on an SSL object starts the clock */
+static __always_inline void begin_handshake(__u64 ssl, __u32 function_id) {
+    struct ct_handshake_key key = {
+        .ssl = ssl,
+        .pid = bpf_get_current_pid_tgid() >> 32,
+    };
+    struct ct_handshake_start start = {
+        .start_ns = bpf_ktime_get_boot_ns(),
+        .function_id = function_id,
+    };
+    
+    if (!ssl) {
+        return;
+    }
+    
+    /* Repeated non-blocking calls keep the first start */
+    bpf_map_update_elem(&handshakes, &key, &start, BPF_NOEXIST);
+    stash_call(ssl);
+}
+
+/* A handshake completed (ok) or failed: add it to its histogram */
+static __always_inline void end_handshake(__u64 ssl, bool ok) {
+    struct ct_handshake_key key = {
+        .ssl = ssl,
+        .pid = bpf_get_current_pid_tgid() >> 32,
+    };
+    struct ct_api_count_key hist_key = { .pid = key.pid };
+    struct ct_handshake_start *start;
+    struct ct_handshake_hist *hist;
+    __u64 duration;
+    
+    start = bpf_map_lookup_elem(&handshakes, &key);
+    if (!start) {
+        return;
+    }
+    duration = bpf_ktime_get_boot_ns() - start->start_ns;
+    hist_key.function_id = start->function_id;
+    bpf_map_delete_elem(&handshakes, &key);
+    
+    hist = bpf_map_lookup_elem(&handshake_latency, &hist_key);
+    if (!hist) {
+        struct ct_handshake_hist empty = {};
+        
+        bpf_get_current_comm(&empty.comm, sizeof(empty.comm));
+        bpf_map_update_elem(&handshake_latency, &hist_key, &empty, BPF_NOEXIST);
+        hist = bpf_map_lookup_elem(&handshake_latency, &hist_key);
+        if (!hist) {
+            return;  /* Map full */
+        }
+    }
+    
+    if (ok) {
+        __sync_fetch_and_add(&hist->buckets[latency_bucket(duration) & (CT_LATENCY_BUCKETS - 1)], 1);
+        __sync_fetch_and_add(&hist->total_ns, duration);
+    } else {
+        __sync_fetch_and_add(&hist->errors, 1);
+    }
+}
+
 /* Common function to handle API call events */
-static __always_inline int handle_api_call(const char *function_name) {
+static __always_inline int handle_api_call(__u32 function_id, const char *function_name) {
     struct ct_api_call_event *event;
+    void *ring;
+    __u32 weight;
+    __u64 now;
+    
+    if (!process_allowed()) {
+        return 0;
+    }
+    
+    if (aggregate_api_calls && count_api_call(function_id)) {
+        return 0;
+    }
+    
+    now = bpf_ktime_get_boot_ns();
+    weight = rate_limit_weight(CT_EVENT_API_CALL, now);
+    if (weight == 0) {
+        return 0;
+    }
     
     /* Reserve space in ring buffer */
-    event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
+    ring = event_ringbuf(&events);
+    event = bpf_ringbuf_reserve(ring, sizeof(*event), 0);
     if (!event) {
+        count_stat(CT_STAT_RINGBUF_FULL);
         return 0;
     }
     
     /* Fill event header */
-    event->header.timestamp_ns = bpf_ktime_get_ns();
+    event->header.timestamp_ns = now;
+    event->header.start_time_ns = current_start_time();
+    event->header.cgroup_id = bpf_get_current_cgroup_id();
     event->header.pid = bpf_get_current_pid_tgid() >> 32;
     event->header.uid = bpf_get_current_uid_gid() & 0xFFFFFFFF;
     event->header.event_type = CT_EVENT_API_CALL;
+    event->header.weight = weight;
     
     /* Read process name (comm) */
     bpf_get_current_comm(&event->header.comm, sizeof(event->header.comm));
@@ -58,7 +269,7 @@ static __always_inline int handle_api_call(const char *function_name) {
     copy_string(event->library, "libssl", sizeof(event->library));
     
     /* Submit event to ring buffer */
-    bpf_ringbuf_submit(event, 0);
+    bpf_ringbuf_submit(event, ringbuf_wakeup_flags(ring));
     
     return 0;
 }
@@ -66,26 +277,103 @@ static __always_inline int handle_api_call(const char *function_name) {
 /* Uprobe for SSL_CTX_new() function
  * SSL_CTX *SSL_CTX_new(const SSL_METHOD *method)
  * This creates a new SSL context
+ * These programs name no binary: user space attaches each of them to
+ * every libssl it finds (uprobe_attacher.h)
  */
-SEC("uprobe/SSL_CTX_new")
+SEC("uprobe")
 int trace_ssl_ctx_new(struct pt_regs *ctx) {
-    return handle_api_call("SSL_CTX_new");
+    return handle_api_call(CT_API_SSL_CTX_NEW, "SSL_CTX_new");
 }
 
 /* Uprobe for SSL_connect() function
  * int SSL_connect(SSL *ssl)
  * This initiates an SSL/TLS handshake with a server
  */
-SEC("uprobe/SSL_connect")
+SEC("uprobe")
 int trace_ssl_connect(struct pt_regs *ctx) {
-    return handle_api_call("SSL_connect");
+    if (measure_handshakes && process_allowed()) {
+        begin_handshake((__u64)PT_REGS_PARM1(ctx), CT_API_SSL_CONNECT);
+    }
+    return handle_api_call(CT_API_SSL_CONNECT, "SSL_connect");
 }
 
 /* Uprobe for SSL_accept() function
  * int SSL_accept(SSL *ssl)
  * This waits for an SSL/TLS client to initiate a handshake
  */
-SEC("uprobe/SSL_accept")
+SEC("uprobe")
 int trace_ssl_accept(struct pt_regs *ctx) {
-    return handle_api_call("SSL_accept");
+    if (measure_handshakes && process_allowed()) {
+        begin_handshake((__u64)PT_REGS_PARM1(ctx), CT_API_SSL_ACCEPT);
+    }
+    return handle_api_call(CT_API_SSL_ACCEPT, "SSL_accept");
+}
+
+/* Uprobe for SSL_do_handshake() function
+ * int SSL_do_handshake(SSL *ssl)
+ * The handshake of servers and clients that set the role beforehand
+ * (SSL_set_accept_state/SSL_set_connect_state); SSL_connect and
+ * SSL_accept call it too, and then the handshake keeps their function.
+ * Attached only when handshakes are measured.
+ */
+SEC("uprobe")
+int trace_ssl_do_handshake(struct pt_regs *ctx) {
+    if (measure_handshakes && process_allowed()) {
+        begin_handshake((__u64)PT_REGS_PARM1(ctx), CT_API_SSL_DO_HANDSHAKE);
+    }
+    return 0;
+}
+
+/* Uretprobe for SSL_connect(), SSL_accept() and SSL_do_handshake()
+ * 1 completes the handshake, 0 fails it; below 0 the caller asks
+ * SSL_get_error() whether to retry, which decides (see below)
+ */
+SEC("uretprobe")
+int trace_ssl_handshake_ret(struct pt_regs *ctx) {
+    int ret = (int)PT_REGS_RC(ctx);
+    __u64 ssl = take_call();
+    
+    if (!ssl) {
+        return 0;
+    }
+    if (ret == 1) {
+        end_handshake(ssl, true);
+    } else if (ret == 0) {
+        end_handshake(ssl, false);
+    } else {
+        stash_call(ssl);  /* For the SSL_get_error() that follows */
+    }
+    return 0;
+}
+
+/* Uprobe for SSL_get_error() function
+ * int SSL_get_error(const SSL *ssl, int ret)
+ * Only of interest right after a handshake call returned below 0, when
+ * the stash still holds that SSL object
+ */
+SEC("uprobe")
+int trace_ssl_get_error(struct pt_regs *ctx) {
+    __u64 id = bpf_get_current_pid_tgid();
+    __u64 *stashed = bpf_map_lookup_elem(&handshake_calls, &id);
+    
+    if (stashed && *stashed != (__u64)PT_REGS_PARM1(ctx)) {
+        bpf_map_delete_elem(&handshake_calls, &id);
+    }
+    return 0;
+}
+
+/* Uretprobe for SSL_get_error(): anything but a WANT_* result ends the
+ * pending handshake as failed */
+SEC("uretprobe")
+int trace_ssl_get_error_ret(struct pt_regs *ctx) {
+    int err = (int)PT_REGS_RC(ctx);
+    __u64 ssl = take_call();
+    
+    if (!ssl) {
+        return 0;
+    }
+    if (err > 0 && (err >= 32 || !((1U << err) & SSL_WANT_MASK))) {
+        end_handshake(ssl, false);
+    }
+    return 0;
 }
\ No newline at end of file
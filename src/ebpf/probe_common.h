@@ -0,0 +1,360 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * probe_common.h - Maps and helpers shared by all eBPF programs
+ * Kernel-side only; include after vmlinux.h and bpf_helpers.h
+ *
+ * The process filter maps and the rate limit configuration are created
+ * by the first program that loads and reused by every other program (see
+ * ebpf_manager.c), so a PID added by the fork probe is immediately
+ * visible to all probes. The same goes for the sharded ring buffers,
+ * which user space creates itself.
+ */
+
+#ifndef __PROBE_COMMON_H__
+#define __PROBE_COMMON_H__
+
+#include "common.h"
+
+/* Per-CPU counters (see enum ct_stat_id) */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, CT_STAT_MAX);
+    __type(key, __u32);
+    __type(value, __u64);
+} stats SEC(".maps");
+
+/* Process filter configuration (single entry) */
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct ct_filter_config);
+} filter_config SEC(".maps");
+
+/* Target TGIDs (CT_FILTER_PID) */
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, MAX_FILTER_PIDS);
+    __type(key, __u32);
+    __type(value, __u8);
+} filter_pids SEC(".maps");
+
+/* Comm substrings (CT_FILTER_COMM) */
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_FILTER_COMMS);
+    __type(key, __u32);
+    __type(value, struct ct_comm_pattern);
+} filter_comms SEC(".maps");
+
+/* Target UIDs (CT_FILTER_UID) */
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, MAX_FILTER_UIDS);
+    __type(key, __u32);
+    __type(value, __u8);
+} filter_uids SEC(".maps");
+
+/* Target cgroup v2 ids (CT_FILTER_CGROUP); a task matches if its cgroup
+ * or any ancestor of it is in the map */
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, MAX_FILTER_CGROUPS);
+    __type(key, __u64);
+    __type(value, __u8);
+} filter_cgroups SEC(".maps");
+
+/* Rate limits and sampling per event type (see struct ct_rate_config) */
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, CT_EVENT_TYPE_MAX);
+    __type(key, __u32);
+    __type(value, struct ct_rate_config);
+} rate_config SEC(".maps");
+
+/* Token buckets, private to each program and CPU */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, CT_EVENT_TYPE_MAX);
+    __type(key, __u32);
+    __type(value, struct ct_rate_state);
+} rate_state SEC(".maps");
+
+/* Ring buffer notification policy, set from user-space before load.
+ * 0 wakes the consumer for every record; otherwise records are written
+ * with BPF_RB_NO_WAKEUP until this many bytes are pending, so bursts
+ * are drained in batches (the consumer's poll timeout bounds latency) */
+const volatile __u64 wakeup_watermark = 0;
+
+/* Sharded ring buffer layout: with ring_sharding set, every program
+ * submits to ring_shards[shard_of_cpu[cpu]] instead of its own events
+ * map, so CPUs (or NUMA nodes) do not contend on one ring's lock and each
+ * ring has a consumer on its own node. User space creates the rings and
+ * fills both maps before attach; a CPU without a ring falls back to the
+ * program's events map. */
+struct ringbuf_shard {
+    __uint(type, BPF_MAP_TYPE_RINGBUF);
+    __uint(max_entries, CT_RINGBUF_DEFAULT_SIZE);
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+    __uint(max_entries, CT_MAX_RING_SHARDS);
+    __type(key, __u32);
+    __array(values, struct ringbuf_shard);
+} ring_shards SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, CT_MAX_CPUS);
+    __type(key, __u32);
+    __type(value, __u32);
+} shard_of_cpu SEC(".maps");
+
+const volatile bool ring_sharding = false;
+
+static __always_inline void count_stat(__u32 id) {
+    __u64 *value = bpf_map_lookup_elem(&stats, &id);
+    if (value) {
+        (*value)++;
+    }
+}
+
+/* Ring buffer the current CPU submits to: its shard, or ringbuf (the
+ * program's events map) when the layout is not sharded */
+static __always_inline void *event_ringbuf(void *ringbuf) {
+    __u32 cpu;
+    __u32 *shard;
+    void *ring;
+    
+    if (!ring_sharding) {
+        return ringbuf;
+    }
+    
+    cpu = bpf_get_smp_processor_id();
+    shard = bpf_map_lookup_elem(&shard_of_cpu, &cpu);
+    if (!shard) {
+        return ringbuf;
+    }
+    ring = bpf_map_lookup_elem(&ring_shards, shard);
+    return ring ? ring : ringbuf;
+}
+
+/* Notification flags for the next record written to ringbuf */
+static __always_inline __u64 ringbuf_wakeup_flags(void *ringbuf) {
+    if (wakeup_watermark == 0) {
+        return 0;
+    }
+    
+    return bpf_ringbuf_query(ringbuf, BPF_RB_AVAIL_DATA) >= wakeup_watermark ?
+           BPF_RB_FORCE_WAKEUP : BPF_RB_NO_WAKEUP;
+}
+
+/* Copy a record into ringbuf (or the CPU's shard, see event_ringbuf()),
+ * counting it in stats[CT_STAT_RINGBUF_FULL] when there is no room */
+static __always_inline void ringbuf_output_record(void *ringbuf, void *data, __u64 size) {
+    void *ring = event_ringbuf(ringbuf);
+    
+    if (bpf_ringbuf_output(ring, data, size, ringbuf_wakeup_flags(ring)) != 0) {
+        count_stat(CT_STAT_RINGBUF_FULL);
+    }
+}
+
+/* Apply the event type's sampling and rate limit to the current event
+ * Call once the event is known to be wanted and before any ring buffer
+ * work. Skipped events are counted in stats[CT_STAT_SAMPLED_OUT] or
+ * stats[CT_STAT_RATE_LIMITED] and folded into the weight of this CPU's
+ * next submitted one. Returns the weight of the event, itself included,
+ * or 0 if it must be dropped.
+ */
+static __always_inline __u32 rate_limit_weight(__u32 event_type, __u64 now) {
+    struct ct_rate_config *cfg;
+    struct ct_rate_state *state;
+    __u64 weight, cap, elapsed;
+    
+    cfg = bpf_map_lookup_elem(&rate_config, &event_type);
+    if (!cfg || (cfg->rate == 0 && cfg->sample_every <= 1)) {
+        return 1;
+    }
+    
+    state = bpf_map_lookup_elem(&rate_state, &event_type);
+    if (!state) {
+        return 1;
+    }
+    
+    if (cfg->sample_every > 1 && ++state->seen % cfg->sample_every != 0) {
+        state->suppressed++;
+        count_stat(CT_STAT_SAMPLED_OUT);
+        return 0;
+    }
+    
+    if (cfg->rate > 0) {
+        /* Refill at rate tokens per second, up to burst tokens */
+        cap = (__u64)(cfg->burst ? cfg->burst : cfg->rate) * 1000000000ULL;
+        elapsed = now - state->last_ns;
+        if (state->last_ns == 0 || elapsed >= cap / cfg->rate) {
+            state->credit = cap;
+        } else {
+            state->credit += elapsed * cfg->rate;
+            if (state->credit > cap) {
+                state->credit = cap;
+            }
+        }
+        state->last_ns = now;
+        
+        if (state->credit < 1000000000ULL) {
+            state->suppressed++;
+            count_stat(CT_STAT_RATE_LIMITED);
+            return 0;
+        }
+        state->credit -= 1000000000ULL;
+    }
+    
+    weight = state->suppressed + 1;
+    state->suppressed = 0;
+    return weight > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (__u32)weight;
+}
+
+/* Start time (ns since boot) of the current thread group leader
+ * Together with the TGID this identifies a process across PID reuse */
+static __always_inline __u64 current_start_time(void) {
+    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
+    
+    return BPF_CORE_READ(task, group_leader, start_time);
+}
+
+static __always_inline char ct_tolower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/* Case-insensitive substring match of a pattern against a comm.
+ * Loops are bounded by MAX_COMM_LEN; indices are masked for the verifier.
+ */
+static __always_inline bool comm_contains(const char *comm, const struct ct_comm_pattern *p) {
+    __u32 start, j;
+    
+    if (p->len == 0 || p->len >= MAX_COMM_LEN) {
+        return false;
+    }
+    
+    for (start = 0; start < MAX_COMM_LEN; start++) {
+        bool matched = true;
+        
+        if (start + p->len >= MAX_COMM_LEN) {
+            return false;
+        }
+        
+        for (j = 0; j < MAX_COMM_LEN; j++) {
+            if (j >= p->len) {
+                break;
+            }
+            if (ct_tolower(comm[(start + j) & (MAX_COMM_LEN - 1)]) != p->pattern[j]) {
+                matched = false;
+                break;
+            }
+        }
+        
+        if (matched) {
+            return true;
+        }
+        if (comm[start & (MAX_COMM_LEN - 1)] == '\0') {
+            return false;
+        }
+    }
+    
+    return false;
+}
+
+/* Check the current task against the process filter.
+ * Must be called before any ring buffer work; rejected events are
+ * counted in stats[CT_STAT_PROCESS_FILTERED]. All configured criteria
+ * must match (comm patterns match if any one of them does). Once user
+ * space sets CT_FILTER_STOPPED nothing passes, uncounted.
+ */
+static __always_inline bool process_allowed(void) {
+    struct ct_filter_config *cfg;
+    struct ct_comm_pattern *pattern;
+    char comm[MAX_COMM_LEN];
+    __u32 zero = 0;
+    __u32 id, i;
+    bool comm_ok;
+    
+    cfg = bpf_map_lookup_elem(&filter_config, &zero);
+    if (!cfg || cfg->flags == 0) {
+        return true;
+    }
+    
+    if (cfg->flags & CT_FILTER_STOPPED) {
+        return false;
+    }
+    
+    if (cfg->flags & CT_FILTER_PID) {
+        id = bpf_get_current_pid_tgid() >> 32;
+        if (!bpf_map_lookup_elem(&filter_pids, &id)) {
+            goto reject;
+        }
+    }
+    
+    if (cfg->flags & CT_FILTER_UID) {
+        id = bpf_get_current_uid_gid() & 0xFFFFFFFF;
+        if (!bpf_map_lookup_elem(&filter_uids, &id)) {
+            goto reject;
+        }
+    }
+    
+    /* Containers and pods are cgroup subtrees: walk down from the root
+     * until the task's own cgroup (ancestor ids are 0 past it) */
+    if (cfg->flags & CT_FILTER_CGROUP) {
+        bool cgroup_ok = false;
+        
+        for (i = 0; i < CT_MAX_CGROUP_DEPTH; i++) {
+            __u64 cgroup = bpf_get_current_ancestor_cgroup_id(i);
+            
+            if (cgroup == 0) {
+                break;
+            }
+            if (bpf_map_lookup_elem(&filter_cgroups, &cgroup)) {
+                cgroup_ok = true;
+                break;
+            }
+        }
+        
+        if (!cgroup_ok) {
+            goto reject;
+        }
+    }
+    
+    if (cfg->flags & CT_FILTER_COMM) {
+        comm_ok = false;
+        bpf_get_current_comm(&comm, sizeof(comm));
+        
+        for (i = 0; i < MAX_FILTER_COMMS; i++) {
+            __u32 key = i;
+            
+            pattern = bpf_map_lookup_elem(&filter_comms, &key);
+            if (!pattern || pattern->len == 0) {
+                break;
+            }
+            if (comm_contains(comm, pattern)) {
+                comm_ok = true;
+                break;
+            }
+        }
+        
+        if (!comm_ok) {
+            goto reject;
+        }
+    }
+    
+    return true;
+    
+reject:
+    count_stat(CT_STAT_PROCESS_FILTERED);
+    return false;
+}
+
+#endif /* __PROBE_COMMON_H__ */
@@ -6,72 +6,144 @@
 /**
  * process_exec_trace.bpf.c - eBPF program for tracing process execution
  * Monitors sched_process_exec tracepoint for new process execution
- * NOTE: Simplified to avoid BPF verifier issues with complex cmdline reading
+ * and sched_process_fork to extend the PID filter to new children
  */
 
 #include "vmlinux.h"
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_core_read.h>
 #include <bpf/bpf_tracing.h>
-#include "common.h"
+#include "probe_common.h"
 
 char LICENSE[] SEC("license") = "GPL";
 
 /* Ring buffer for events */
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, 1 << 20); /* 1MB */
+    __uint(max_entries, CT_RINGBUF_DEFAULT_SIZE); /* Resized from user-space before load */
 } events SEC(".maps");
 
+/* Scratch space for building an exec record (too large for the BPF stack) */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct ct_process_exec_event);
+} exec_scratch SEC(".maps");
+
 /* Tracepoint for sched_process_exec
- * This fires when a process successfully executes a new program
- * Cmdline reading simplified - user-space can read full cmdline from /proc if needed
+ * This fires when a process successfully executes a new program.
+ * The exec filename and argv are read here, while the new image is
+ * guaranteed to exist, so short-lived processes are reported in full
+ * without user space racing them to /proc.
  */
 SEC("tracepoint/sched/sched_process_exec")
-int trace_process_exec(void *ctx) {
+int trace_process_exec(struct trace_event_raw_sched_process_exec *ctx) {
     struct ct_process_exec_event *event;
-    struct task_struct *task, *parent;
-    __u64 pid_tgid;
-    __u32 pid, ppid = 0;
+    struct task_struct *task;
+    unsigned long arg_start, arg_end;
+    __u64 pid_tgid, size, now;
+    __u32 zero = 0;
+    __u32 weight;
+    __u32 pid, filename_off, args_len = 0;
+    long len;
     
     /* Get PID */
     pid_tgid = bpf_get_current_pid_tgid();
     pid = pid_tgid >> 32;
     
-    /* Reserve space in ring buffer */
-    event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
+    if (!process_allowed()) {
+        return 0;
+    }
+    
+    now = bpf_ktime_get_boot_ns();
+    weight = rate_limit_weight(CT_EVENT_PROCESS_EXEC, now);
+    if (weight == 0) {
+        return 0;
+    }
+    
+    event = bpf_map_lookup_elem(&exec_scratch, &zero);
     if (!event) {
         return 0;
     }
     
     /* Fill event header */
-    event->header.timestamp_ns = bpf_ktime_get_ns();
+    event->header.timestamp_ns = now;
+    event->header.start_time_ns = current_start_time();
+    event->header.cgroup_id = bpf_get_current_cgroup_id();
     event->header.pid = pid;
     event->header.uid = bpf_get_current_uid_gid() & 0xFFFFFFFF;
     event->header.event_type = CT_EVENT_PROCESS_EXEC;
-    
-    /* Read process name (comm) - this is the most important part */
+    event->header.weight = weight;
     bpf_get_current_comm(&event->header.comm, sizeof(event->header.comm));
     
-    /* Get current task for PPID */
     task = (struct task_struct *)bpf_get_current_task_btf();
-    if (task) {
-        /* Read PPID from task structure */
-        parent = BPF_CORE_READ(task, real_parent);
-        if (parent) {
-            ppid = BPF_CORE_READ(parent, tgid);
+    event->ppid = BPF_CORE_READ(task, real_parent, tgid);
+    
+    /* Exec filename from the tracepoint's dynamic array */
+    filename_off = ctx->__data_loc_filename & 0xFFFF;
+    len = bpf_probe_read_kernel_str(event->data, MAX_FILENAME_LEN, (void *)ctx + filename_off);
+    if (len <= 0) {
+        event->data[0] = '\0';
+        len = 1;
+    }
+    if (len > MAX_FILENAME_LEN) {
+        len = MAX_FILENAME_LEN;
+    }
+    event->filename_len = len;
+    
+    /* argv lives in the new image's stack between arg_start and arg_end */
+    arg_start = BPF_CORE_READ(task, mm, arg_start);
+    arg_end = BPF_CORE_READ(task, mm, arg_end);
+    if (arg_end > arg_start) {
+        args_len = arg_end - arg_start;
+        if (args_len > MAX_EXEC_ARGS_LEN) {
+            args_len = MAX_EXEC_ARGS_LEN;
+        }
+        if (bpf_probe_read_user(&event->data[len], args_len,
+                                (void *)arg_start) != 0) {
+            args_len = 0;
         }
     }
+    event->args_len = args_len;
     
-    /* Store PPID */
-    event->ppid = ppid;
+    /* Submit only the used part of the record */
+    size = CT_RECORD_SIZE(struct ct_process_exec_event, data, event->filename_len + args_len);
+    if (size > sizeof(*event)) {
+        size = sizeof(*event);
+    }
+    ringbuf_output_record(&events, event, size);
     
-    /* Set cmdline to process name (comm) - user-space can read full cmdline from /proc if needed */
-    __builtin_memcpy(event->cmdline, event->header.comm, sizeof(event->header.comm));
-    event->cmdline[sizeof(event->header.comm)] = '\0';
+    return 0;
+}
+
+/* BTF tracepoint for sched_process_fork
+ * With CT_FILTER_FOLLOW_CHILDREN, a new process whose parent is in the
+ * PID filter is added to it here, before the child can run, so its
+ * events are never dropped by the other probes. New threads share the
+ * parent's TGID and need no entry.
+ */
+SEC("tp_btf/sched_process_fork")
+int BPF_PROG(trace_process_fork, struct task_struct *parent, struct task_struct *child) {
+    struct ct_filter_config *cfg;
+    __u32 zero = 0;
+    __u32 parent_tgid, child_tgid;
+    __u8 one = 1;
     
-    /* Submit event to ring buffer */
-    bpf_ringbuf_submit(event, 0);
+    cfg = bpf_map_lookup_elem(&filter_config, &zero);
+    if (!cfg || !(cfg->flags & CT_FILTER_FOLLOW_CHILDREN) || !(cfg->flags & CT_FILTER_PID)) {
+        return 0;
+    }
+    
+    parent_tgid = BPF_CORE_READ(parent, tgid);
+    child_tgid = BPF_CORE_READ(child, tgid);
+    if (parent_tgid == child_tgid) {
+        return 0;
+    }
+    
+    if (bpf_map_lookup_elem(&filter_pids, &parent_tgid)) {
+        bpf_map_update_elem(&filter_pids, &child_tgid, &one, BPF_ANY);
+    }
     
     return 0;
 }
@@ -12,14 +12,14 @@
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_core_read.h>
 #include <bpf/bpf_tracing.h>
-#include "common.h"
+#include "probe_common.h"
 
 char LICENSE[] SEC("license") = "GPL";
 
 /* Ring buffer for events */
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, 1 << 20); /* 1MB */
+    __uint(max_entries, CT_RINGBUF_DEFAULT_SIZE); /* Resized from user-space before load */
 } events SEC(".maps");
 
 /* Hash map to track process start times (for cleanup) */
@@ -30,15 +30,36 @@ struct {
     __type(value, __u64);  /* timestamp */
 } process_start_time SEC(".maps");
 
+/* Drop an exiting child from the PID filter when following children,
+ * so the map only holds live processes. Only the thread group leader's
+ * exit removes the entry; the exit event itself has already passed.
+ */
+static __always_inline void forget_followed_process(__u64 pid_tgid) {
+    struct ct_filter_config *cfg;
+    __u32 zero = 0;
+    __u32 tgid = pid_tgid >> 32;
+    
+    if ((__u32)pid_tgid != tgid) {
+        return;
+    }
+    
+    cfg = bpf_map_lookup_elem(&filter_config, &zero);
+    if (cfg && (cfg->flags & CT_FILTER_FOLLOW_CHILDREN)) {
+        bpf_map_delete_elem(&filter_pids, &tgid);
+    }
+}
+
 /* Tracepoint for sched_process_exit
- * This fires when a process exits
+ * This fires when any thread exits; the record carries the thread so
+ * user-space can tell the leader's exit, which ends the process
  */
 SEC("tracepoint/sched/sched_process_exit")
 int trace_process_exit(void *ctx) {
     struct ct_process_exit_event *event;
     struct task_struct *task;
-    __u64 pid_tgid;
-    __u32 pid;
+    void *ring;
+    __u64 pid_tgid, now;
+    __u32 pid, weight;
     __s32 exit_code;
     
     /* Get current task */
@@ -51,34 +72,55 @@ int trace_process_exit(void *ctx) {
     pid_tgid = bpf_get_current_pid_tgid();
     pid = pid_tgid >> 32;
     
+    if (!process_allowed()) {
+        bpf_map_delete_elem(&process_start_time, &pid);
+        return 0;
+    }
+    
+    now = bpf_ktime_get_boot_ns();
+    weight = rate_limit_weight(CT_EVENT_PROCESS_EXIT, now);
+    if (weight == 0) {
+        bpf_map_delete_elem(&process_start_time, &pid);
+        forget_followed_process(pid_tgid);
+        return 0;
+    }
+    
     /* Read exit code from task structure */
     exit_code = BPF_CORE_READ(task, exit_code);
     
     /* Reserve space in ring buffer */
-    event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
+    ring = event_ringbuf(&events);
+    event = bpf_ringbuf_reserve(ring, sizeof(*event), 0);
     if (!event) {
-        /* Still clean up the map entry even if we can't send event */
+        count_stat(CT_STAT_RINGBUF_FULL);
+        /* Still clean up the map entries even if we can't send event */
         bpf_map_delete_elem(&process_start_time, &pid);
+        forget_followed_process(pid_tgid);
         return 0;
     }
     
     /* Fill event header */
-    event->header.timestamp_ns = bpf_ktime_get_ns();
+    event->header.timestamp_ns = now;
+    event->header.start_time_ns = current_start_time();
+    event->header.cgroup_id = bpf_get_current_cgroup_id();
     event->header.pid = pid;
     event->header.uid = bpf_get_current_uid_gid() & 0xFFFFFFFF;
     event->header.event_type = CT_EVENT_PROCESS_EXIT;
+    event->header.weight = weight;
     
     /* Read process name (comm) */
     bpf_get_current_comm(&event->header.comm, sizeof(event->header.comm));
     
     /* Store exit code */
     event->exit_code = exit_code;
+    event->tid = (__u32)pid_tgid;
     
     /* Submit event to ring buffer */
-    bpf_ringbuf_submit(event, 0);
+    bpf_ringbuf_submit(event, ringbuf_wakeup_flags(ring));
     
-    /* Clean up process tracking map */
+    /* Clean up process tracking maps */
     bpf_map_delete_elem(&process_start_time, &pid);
+    forget_followed_process(pid_tgid);
     
     return 0;
 }
\ No newline at end of file
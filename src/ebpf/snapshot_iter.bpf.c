@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * snapshot_iter.bpf.c - BPF iterators behind the snapshot command
+ * Walk every process's mappings and open files in the kernel and write
+ * one ct_iter_record per candidate to the iterator's seq file, so a
+ * snapshot is a few read() calls instead of a /proc walk.
+ *
+ * task_vma keeps executable file mappings only: every shared library
+ * has exactly one, so user-space classifies a handful of paths per
+ * process with the full library rules. task_file applies the crypto
+ * extension prefilter to the dentry name before resolving the path.
+ */
+
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_core_read.h>
+#include <bpf/bpf_tracing.h>
+#include "common.h"
+
+char LICENSE[] SEC("license") = "GPL";
+
+#define CT_VM_EXEC 0x00000004
+
+/* Crypto file extensions, populated by user-space after load */
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_CRYPTO_EXTENSIONS);
+    __type(key, __u32);
+    __type(value, struct ct_crypto_extension);
+} crypto_extensions SEC(".maps");
+
+/* Per-CPU scratch buffer for the resolved path */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, char[MAX_FILENAME_LEN]);
+} path_buf SEC(".maps");
+
+/**
+ * Check a dentry name against the extension table
+ * Same rules as file_open_trace: lower-case suffix match, and an empty
+ * table means "no prefilter"
+ */
+static __always_inline bool has_crypto_extension(const char *name, __u32 name_len) {
+    struct ct_crypto_extension *ext;
+    __u32 i, j, idx;
+    char c;
+    
+    for (i = 0; i < MAX_CRYPTO_EXTENSIONS; i++) {
+        __u32 key = i;
+        bool matched = true;
+        
+        ext = bpf_map_lookup_elem(&crypto_extensions, &key);
+        if (!ext || ext->len == 0) {
+            return i == 0;
+        }
+        
+        if (ext->len > MAX_EXTENSION_LEN || ext->len > name_len) {
+            continue;
+        }
+        
+        for (j = 0; j < MAX_EXTENSION_LEN; j++) {
+            if (j >= ext->len) {
+                break;
+            }
+            idx = (name_len - ext->len + j) & (MAX_DNAME_LEN - 1);
+            c = name[idx];
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+            if (c != ext->suffix[j]) {
+                matched = false;
+                break;
+            }
+        }
+        
+        if (matched) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * Resolve a file's path and write its record
+ * bpf_seq_write() fails when the seq buffer is full; the kernel then
+ * replays the object into the next read(), so nothing is lost.
+ */
+static __always_inline int emit_record(struct seq_file *seq, struct file *file, __u32 tgid,
+                                       __u32 kind, __s32 fd) {
+    struct ct_iter_record rec = {};
+    __u32 zero = 0;
+    char *buf;
+    long len;
+    
+    buf = bpf_map_lookup_elem(&path_buf, &zero);
+    if (!buf) {
+        return 0;
+    }
+    
+    len = bpf_d_path(&file->f_path, buf, MAX_FILENAME_LEN);
+    if (len <= 0 || len > MAX_FILENAME_LEN) {
+        return 0;
+    }
+    
+    rec.pid = tgid;
+    rec.kind = kind;
+    rec.fd = fd;
+    rec.path_len = (__u32)len;
+    rec.ino = BPF_CORE_READ(file, f_inode, i_ino);
+    
+    if (bpf_seq_write(seq, &rec, sizeof(rec)) != 0) {
+        return 0;
+    }
+    bpf_seq_write(seq, buf, len);
+    return 0;
+}
+
+SEC("iter/task_vma")
+int dump_task_vma(struct bpf_iter__task_vma *ctx) {
+    struct vm_area_struct *vma = ctx->vma;
+    struct task_struct *task = ctx->task;
+    struct file *file;
+    
+    if (!task || !vma) {
+        return 0;
+    }
+    
+    file = vma->vm_file;
+    if (!file || !(vma->vm_flags & CT_VM_EXEC)) {
+        return 0;
+    }
+    
+    return emit_record(ctx->meta->seq, file, task->tgid, CT_ITER_LIBRARY, -1);
+}
+
+SEC("iter/task_file")
+int dump_task_file(struct bpf_iter__task_file *ctx) {
+    struct task_struct *task = ctx->task;
+    struct file *file = ctx->file;
+    char name[MAX_DNAME_LEN];
+    const unsigned char *dname;
+    long len;
+    
+    if (!task || !file) {
+        return 0;
+    }
+    
+    dname = BPF_CORE_READ(file, f_path.dentry, d_name.name);
+    len = bpf_probe_read_kernel_str(name, sizeof(name), dname);
+    if (len <= 1 || !has_crypto_extension(name, (__u32)(len - 1))) {
+        return 0;
+    }
+    
+    return emit_record(ctx->meta->seq, file, task->tgid, CT_ITER_FILE, (__s32)ctx->fd);
+}
@@ -21,18 +21,83 @@ typedef __s16 s16;
 typedef __s32 s32;
 typedef __s64 s64;
 
+/* Address space (minimal) */
+struct mm_struct {
+    unsigned long arg_start;
+    unsigned long arg_end;
+    /* Other fields omitted for fallback */
+};
+
 /* Process task structure (minimal) */
 struct task_struct {
     int pid;
     int tgid;
     char comm[16];
+    u64 start_time;
+    struct task_struct *group_leader;
+    struct task_struct *real_parent;
+    struct mm_struct *mm;
     /* Other fields omitted for fallback */
 };
 
+/* Path resolution (minimal) */
+struct qstr {
+    const unsigned char *name;
+};
+
+struct dentry {
+    struct qstr d_name;
+};
+
+struct path {
+    void *mnt;
+    struct dentry *dentry;
+};
+
+struct inode {
+    unsigned long i_ino;
+};
+
 /* File structure (minimal) */
 struct file {
     /* Minimal definition for fallback */
-    void *f_path;
+    struct path f_path;
+    struct inode *f_inode;
+};
+
+/* openat2() arguments */
+struct open_how {
+    u64 flags;
+    u64 mode;
+    u64 resolve;
+};
+
+/* Memory mapping (minimal) */
+struct vm_area_struct {
+    unsigned long vm_flags;
+    struct file *vm_file;
+};
+
+/* BPF iterator contexts (minimal) */
+struct seq_file;
+
+struct bpf_iter_meta {
+    struct seq_file *seq;
+    u64 session_id;
+    u64 seq_num;
+};
+
+struct bpf_iter__task_vma {
+    struct bpf_iter_meta *meta;
+    struct task_struct *task;
+    struct vm_area_struct *vma;
+};
+
+struct bpf_iter__task_file {
+    struct bpf_iter_meta *meta;
+    struct task_struct *task;
+    u32 fd;
+    struct file *file;
 };
 
 /* pt_regs structure for different architectures */
@@ -63,6 +128,13 @@ struct pt_regs {
 #endif
 
 /* Tracepoint structures (minimal definitions) */
+struct trace_entry {
+    unsigned short type;
+    unsigned char flags;
+    unsigned char preempt_count;
+    int pid;
+};
+
 struct trace_event_raw_sys_enter {
     struct trace_entry ent;
     long id;
@@ -72,9 +144,9 @@ struct trace_event_raw_sys_enter {
 
 struct trace_event_raw_sched_process_exec {
     struct trace_entry ent;
-    u32 pid;
-    u32 old_pid;
-    char filename[16];
+    u32 __data_loc_filename;
+    int pid;
+    int old_pid;
     char __data[0];
 };
 
@@ -86,11 +158,4 @@ struct trace_event_raw_sched_process_exit {
     char __data[0];
 };
 
-struct trace_entry {
-    unsigned short type;
-    unsigned char flags;
-    unsigned char preempt_count;
-    int pid;
-};
-
 #endif /* __VMLINUX_FALLBACK_H__ */
\ No newline at end of file
@@ -14,14 +14,34 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
-#include <time.h>
 #include <signal.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <pthread.h>
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
 
 #include "crypto_tracer.h"
+#include "crypto_classifier.h"
 #include "ebpf_manager.h"
 #include "logger.h"
+#include "spsc_queue.h"
+#include "coalesce_table.h"
+#include "timestamp.h"
+#include "pipeline_stats.h"
+#include "binary_format.h"
+#include "daemon.h"
+#include "symbol_cache.h"
+#include "uprobe_attacher.h"
+#include "handshake_latency.h"
 #include "ebpf/common.h"
 
 /* Include generated BPF skeletons */
@@ -31,6 +51,131 @@
 #include "process_exit_trace.skel.h"
 #include "openssl_api_trace.skel.h"
 
+struct event_batch_ctx;
+static struct bpf_object *source_object(struct ebpf_manager *mgr, ebpf_source_t source);
+static int attach_daemon(struct ebpf_manager *mgr);
+static void stop_daemon_client(struct ebpf_manager *mgr);
+static int poll_daemon(struct ebpf_manager *mgr, event_callback_t callback, void *ctx);
+
+/* Per-source ring buffer callback context
+ * Every skeleton owns a private ring buffer map; all of them are
+ * registered on one ring_buffer manager so a single epoll drains them */
+struct ring_source_ctx {
+    struct ebpf_manager *mgr;
+    ebpf_source_t source;
+    unsigned int ring_index;       /* Position in the ring_buffer manager (if attached) */
+};
+
+/* Power-of-two latency histogram buckets (bucket i holds [2^(i-1), 2^i) ns) */
+#define LATENCY_BUCKETS 64
+
+/* What a shutdown drain got through */
+struct drain_result {
+    uint64_t events;
+    uint64_t ns;
+    uint64_t left_bytes;           /* Still in the rings at the deadline */
+};
+
+/* Consumer of the shard rings of one NUMA node (sharded ring layout)
+ * Only the thread polling it touches it; counters are written with
+ * relaxed atomic stores so the stats getters may read them anywhere */
+struct ring_consumer {
+    struct ebpf_manager *mgr;
+    unsigned int index;
+    cpu_set_t cpus;                /* CPUs of the node */
+    struct ring_buffer *rb;        /* The node's shard rings */
+    event_buffer_pool_t *pool;     /* Allocated on the node by its first poll */
+    event_callback_t callback;
+    void *user_ctx;
+    uint32_t events_in_batch;
+    bool drain_busy;
+    uint64_t watermark_ns;         /* Records stamped before this were drained */
+    uint64_t events_processed;
+    uint64_t events_dropped;
+    uint64_t events_received[EBPF_SOURCE_COUNT];
+    uint64_t latency_hist[LATENCY_BUCKETS];
+    uint64_t latency_max_ns;
+    uint64_t cpu_ns;
+    uint64_t batches;
+    uint64_t busy_polls;
+    struct drain_result drain;     /* Final drain (see ebpf_manager_drain_consumer) */
+};
+
+/* Process filter and rate limit maps (see ebpf/probe_common.h)
+ * Created by the first program that loads and reused by the others, so
+ * all probes and the fork probe share one filter */
+enum {
+    FILTER_MAP_CONFIG = 0,
+    FILTER_MAP_PIDS,
+    FILTER_MAP_COMMS,
+    FILTER_MAP_UIDS,
+    FILTER_MAP_CGROUPS,
+    FILTER_MAP_RATE,
+    FILTER_MAP_COUNT
+};
+
+_Static_assert(EBPF_MAX_FILTER_CGROUPS == MAX_FILTER_CGROUPS,
+               "ebpf_manager.h and ebpf/common.h disagree on the cgroup filter size");
+
+#define SKEL_FILTER_MAPS(skel) \
+    { (skel)->maps.filter_config, (skel)->maps.filter_pids, \
+      (skel)->maps.filter_comms, (skel)->maps.filter_uids, \
+      (skel)->maps.filter_cgroups, (skel)->maps.rate_config }
+
+/* Drain policy defaults (see ebpf_poll_config_t) */
+#define DEFAULT_DRAIN_BUDGET 256
+#define DEFAULT_IDLE_TIMEOUT_MS 10
+
+/* Returned by handle_event() to stop ring_buffer__consume() at the budget
+ * (the record that hit the budget has already been consumed) */
+#define DRAIN_BUDGET_EXHAUSTED (-EAGAIN)
+
+/* With lazy wakeup the consumer is woken once a ring is 1/N full */
+#define RINGBUF_WAKEUP_FRACTION 4
+
+/* Keys requested per bpf_map_lookup_batch() call on api_counts */
+#define API_COUNT_BATCH 256
+
+/* Function names by enum ct_api_function, as reported in api_call events */
+static const char *const api_function_names[CT_API_FUNCTION_COUNT] = {
+    [CT_API_SSL_CTX_NEW] = "SSL_CTX_new",
+    [CT_API_SSL_CONNECT] = "SSL_connect",
+    [CT_API_SSL_ACCEPT] = "SSL_accept",
+    [CT_API_SSL_DO_HANDSHAKE] = "SSL_do_handshake",
+};
+
+/* Total calls of one (process, function) pair, summed over CPUs */
+typedef struct {
+    struct ct_api_count_key key;
+    uint64_t total;
+} api_count_t;
+
+/* Handshake latency histogram of one (process, function) pair */
+typedef struct {
+    struct ct_api_count_key key;
+    struct ct_handshake_hist hist;
+} handshake_hist_t;
+
+/* file_open_trace flavors, in order of preference (see file_open_trace.bpf.c) */
+typedef enum {
+    FILE_OPEN_RESOLVED,            /* fexit on security_file_open: absolute path, inode, dev */
+    FILE_OPEN_FEXIT,               /* fexit on do_sys_openat2: name as passed to open */
+    FILE_OPEN_KPROBE,              /* kprobes, before the open */
+} file_open_flavor_t;
+
+/* Kernel NUMA node ids are below this */
+#define MAX_NUMA_NODES 1024
+
+/* Apply the ring buffer configuration to an opened skeleton */
+#define SKEL_CONFIGURE_RINGBUF(mgr, skel, name) \
+    do { \
+        configure_ringbuf((mgr), (name), (skel)->maps.events); \
+        configure_ring_shards((mgr), (name), (skel)->maps.ring_shards, \
+                              (skel)->maps.shard_of_cpu); \
+        (skel)->rodata->wakeup_watermark = (mgr)->wakeup_watermark; \
+        (skel)->rodata->ring_sharding = (mgr)->ring_shards_fd >= 0; \
+    } while (0)
+
 /* eBPF manager structure */
 struct ebpf_manager {
     /* BPF skeletons */
@@ -40,22 +185,113 @@ struct ebpf_manager {
     struct process_exit_trace_bpf *process_exit_skel;
     struct openssl_api_trace_bpf *openssl_api_skel;
     
-    /* Ring buffer */
+    /* Ring buffer (multiplexes the ring buffers of all loaded programs) */
     struct ring_buffer *rb;
     struct event_batch_ctx *batch_ctx;
+    struct ring_source_ctx ring_sources[EBPF_SOURCE_COUNT];
+    
+    /* Ring buffer configuration (see ebpf_manager_set_ringbuf_config) */
+    uint32_t ringbuf_size;
+    uint64_t wakeup_watermark;     /* Bytes pending before a wakeup (0 = every record) */
+    
+    /* Sharded ring layout (see ebpf_manager_set_ring_layout) */
+    ebpf_ring_layout_t ring_layout;
+    int ring_shards_fd;            /* Map of the shard rings, shared by all programs (-1 = off) */
+    int shard_of_cpu_fd;           /* CPU to shard index */
+    int shard_fds[CT_MAX_RING_SHARDS];
+    unsigned int shard_consumer[CT_MAX_RING_SHARDS];
+    unsigned int shard_count;
+    struct ring_consumer *consumers;
+    unsigned int consumer_count;   /* One per NUMA node (0 = not sharded) */
+    
+    /* API call aggregation (see ebpf_manager_set_api_aggregation) */
+    bool aggregate_api_calls;
+    api_count_t *api_counts;       /* Totals at the last read, sorted by key */
+    size_t api_count_len;
+    
+    /* Handshake latency (see ebpf_manager_set_handshake_latency) */
+    bool measure_handshakes;
+    handshake_hist_t *handshake_hists;   /* Histograms at the last read, sorted by key */
+    size_t handshake_hist_len;
+    
+    /* Event coalescing (see ebpf_manager_set_coalesce_window) */
+    uint64_t coalesce_window_ns;   /* 0 = off */
+    coalesce_table_t *coalesce_table;
+    uint64_t coalesce_flushed_ns;  /* Last ebpf_manager_flush_coalesced() (boot ns) */
+    
+    /* Drain policy */
+    ebpf_poll_config_t poll_config;
+    bool drain_busy;               /* Last poll hit the budget, skip the wait */
     
     /* Statistics */
     uint64_t events_processed;
     uint64_t events_dropped;
+    ebpf_source_stats_t source_stats[EBPF_SOURCE_COUNT];
+    uint64_t latency_hist[LATENCY_BUCKETS];
+    uint64_t latency_max_ns;
+    uint64_t consumer_cpu_ns;
+    uint64_t batches;
+    uint64_t busy_polls;
+    struct drain_result drain;     /* Final drain (see ebpf_manager_drain) */
+    uint64_t teardown_ns;          /* Last ebpf_manager_cleanup() */
+    int bpf_stats_fd;              /* Keeps kernel BPF run time stats on (-1 = off) */
     
     /* Event buffer pool */
     event_buffer_pool_t *event_pool;
     
+    /* Consumer thread queue (NULL = dispatch on the polling thread) */
+    spsc_queue_t *event_queue;
+    
+    /* Raw record capture (see ebpf_manager_set_raw_writer) */
+    raw_writer_t *raw_writer;
+    bool replaying;                /* Records come from a capture, not the kernel */
+    
+    /* Daemon client (see ebpf_manager_use_daemon) */
+    char *daemon_path;             /* NULL = load the programs here */
+    int daemon_fd;
+    daemon_request_t daemon_request;
+    spsc_queue_t *daemon_queue;    /* Events decoded by the reader thread */
+    pthread_t daemon_reader;
+    bool daemon_reading;
+    bool daemon_stopping;          /* Atomic: reader must give up waiting for events */
+    bool daemon_closed;            /* Atomic: the daemon's stream ended */
+    
+    /* Pinned programs, links and maps (see ebpf_manager_pin) */
+    char *pin_dir;
+    
+    /* Uprobes, attached per library as libraries are found (see attach_uprobes) */
+    symbol_cache_t *symbols;
+    uprobe_attacher_t *uprobes;
+    size_t uprobe_probe[UPROBE_MAX_TARGETS];   /* Attacher target to uprobe_probes[] */
+    struct bpf_link **uprobe_links;
+    size_t uprobe_link_count;
+    size_t uprobe_link_capacity;
+    
+    /* Command line of the exec record being dispatched in place (argv joined by spaces) */
+    char exec_cmdline[MAX_EXEC_ARGS_LEN + 1];
+    
+    /* Shared process filter maps (owned copies, -1 until a program loads) */
+    int filter_map_fds[FILTER_MAP_COUNT];
+    
+    /* Sources to load (see ebpf_manager_set_sources) */
+    uint32_t sources;
+    file_open_flavor_t file_open_flavor; /* Flavor file_open_trace loaded */
+    
     /* Flags */
     bool programs_loaded;
     bool programs_attached;
+    bool follows_children;
+    bool filters_cgroups;
 };
 
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 /* Libbpf logging callback - integrate with our logger */
 static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va_list args)
 {
@@ -96,15 +332,28 @@ struct ebpf_manager *ebpf_manager_create(void)
         return NULL;
     }
     
-    /* Create event buffer pool (1000 pre-allocated events) */
-    mgr->event_pool = event_buffer_pool_create(1000);
+    /* Create event buffer pool (grows on demand up to the capacity) */
+    mgr->event_pool = event_buffer_pool_create(EBPF_EVENT_POOL_CAPACITY);
     if (!mgr->event_pool) {
         log_error("Failed to create event buffer pool");
         free(mgr);
         return NULL;
     }
     
-    log_debug("eBPF manager created with event pool capacity: 1000");
+    for (int i = 0; i < FILTER_MAP_COUNT; i++) {
+        mgr->filter_map_fds[i] = -1;
+    }
+    mgr->bpf_stats_fd = -1;
+    mgr->ring_shards_fd = -1;
+    mgr->shard_of_cpu_fd = -1;
+    mgr->daemon_fd = -1;
+    
+    mgr->ringbuf_size = CT_RINGBUF_DEFAULT_SIZE;
+    mgr->sources = EBPF_SOURCES_ALL;
+    mgr->poll_config.budget = DEFAULT_DRAIN_BUDGET;
+    mgr->poll_config.idle_timeout_ms = DEFAULT_IDLE_TIMEOUT_MS;
+    
+    log_debug("eBPF manager created with event pool capacity: %d", EBPF_EVENT_POOL_CAPACITY);
     
     /* Set up libbpf logging */
     libbpf_set_print(libbpf_print_fn);
@@ -113,691 +362,3447 @@ struct ebpf_manager *ebpf_manager_create(void)
 }
 
 /**
- * Load all eBPF programs
+ * Populate the file_open_trace extension table from the classifier's
+ * extension rules (built-in or --crypto-rules)
+ * Rules that do not fit the table leave it empty, and on failure it is
+ * cleared: both disable the kernel-side prefilter instead of silently
+ * dropping crypto files
  */
-int ebpf_manager_load_programs(struct ebpf_manager *mgr)
+static int configure_file_open_filter(struct ebpf_manager *mgr)
 {
-    int err;
-    int loaded_count = 0;
+    struct ct_crypto_extension entries[MAX_CRYPTO_EXTENSIONS];
+    struct ct_crypto_extension ext;
+    int count;
+    int map_fd;
+    __u32 i;
     
-    if (!mgr) {
-        return -EINVAL;
+    map_fd = bpf_map__fd(mgr->file_open_skel->maps.crypto_extensions);
+    if (map_fd < 0) {
+        return -1;
     }
     
-    if (mgr->programs_loaded) {
-        log_warn("Programs already loaded");
-        return 0;
+    count = crypto_classifier_kernel_extensions(crypto_classifier_default(), entries);
+    if (count < 0) {
+        log_warn("Crypto file rules do not fit the kernel-side file prefilter, disabling it");
+        return -1;
     }
     
-    log_debug("Loading eBPF programs...");
-    
-    /* Load file_open_trace program */
-    log_debug("Loading file_open_trace program...");
-    mgr->file_open_skel = file_open_trace_bpf__open();
-    if (!mgr->file_open_skel) {
-        log_warn("Failed to open file_open_trace BPF skeleton");
-    } else {
-        err = file_open_trace_bpf__load(mgr->file_open_skel);
-        if (err) {
-            log_bpf_verifier_error("file_open_trace", err, "Check kernel logs for details");
-            file_open_trace_bpf__destroy(mgr->file_open_skel);
-            mgr->file_open_skel = NULL;
-        } else {
-            loaded_count++;
-            log_debug("file_open_trace program loaded successfully");
+    for (i = 0; i < (__u32)count; i++) {
+        if (bpf_map_update_elem(map_fd, &i, &entries[i], BPF_ANY) != 0) {
+            log_warn("Failed to configure kernel-side file prefilter, disabling it");
+            memset(&ext, 0, sizeof(ext));
+            i = 0;
+            bpf_map_update_elem(map_fd, &i, &ext, BPF_ANY);
+            return -1;
         }
     }
     
-    /* Load lib_load_trace program */
-    log_debug("Loading lib_load_trace program...");
-    mgr->lib_load_skel = lib_load_trace_bpf__open();
-    if (!mgr->lib_load_skel) {
-        log_warn("Failed to open lib_load_trace BPF skeleton");
-    } else {
-        err = lib_load_trace_bpf__load(mgr->lib_load_skel);
-        if (err) {
-            log_bpf_verifier_error("lib_load_trace", err, "Check kernel logs for details");
-            lib_load_trace_bpf__destroy(mgr->lib_load_skel);
-            mgr->lib_load_skel = NULL;
-        } else {
-            loaded_count++;
-            log_debug("lib_load_trace program loaded successfully");
-        }
-    }
+    log_debug("Kernel-side file prefilter configured with %u extension(s)", i);
     
-    /* Load process_exec_trace program */
-    log_debug("Loading process_exec_trace program...");
-    mgr->process_exec_skel = process_exec_trace_bpf__open();
-    if (!mgr->process_exec_skel) {
-        log_warn("Failed to open process_exec_trace BPF skeleton");
-    } else {
-        err = process_exec_trace_bpf__load(mgr->process_exec_skel);
-        if (err) {
-            log_bpf_verifier_error("process_exec_trace", err, "Check kernel logs for details");
-            process_exec_trace_bpf__destroy(mgr->process_exec_skel);
-            mgr->process_exec_skel = NULL;
-        } else {
-            loaded_count++;
-            log_debug("process_exec_trace program loaded successfully");
+    return 0;
+}
+
+/**
+ * Point a program's process filter maps at the shared ones before load
+ * A program whose maps cannot be shared keeps private, unconfigured
+ * maps, which let every event through
+ */
+static void reuse_filter_maps(struct ebpf_manager *mgr, const char *name,
+                              struct bpf_map *maps[FILTER_MAP_COUNT])
+{
+    for (int i = 0; i < FILTER_MAP_COUNT; i++) {
+        if (mgr->filter_map_fds[i] < 0) {
+            return;
         }
+        if (bpf_map__reuse_fd(maps[i], mgr->filter_map_fds[i]) != 0) {
+            log_warn("Failed to share process filter map with %s", name);
+        }
+    }
+}
+
+/**
+ * Take ownership of the process filter maps of the first loaded program
+ */
+static void adopt_filter_maps(struct ebpf_manager *mgr, struct bpf_map *maps[FILTER_MAP_COUNT])
+{
+    if (mgr->filter_map_fds[FILTER_MAP_CONFIG] >= 0) {
+        return;
     }
     
-    /* Load process_exit_trace program */
-    log_debug("Loading process_exit_trace program...");
-    mgr->process_exit_skel = process_exit_trace_bpf__open();
-    if (!mgr->process_exit_skel) {
-        log_warn("Failed to open process_exit_trace BPF skeleton");
-    } else {
-        err = process_exit_trace_bpf__load(mgr->process_exit_skel);
-        if (err) {
-            log_bpf_verifier_error("process_exit_trace", err, "Check kernel logs for details");
-            process_exit_trace_bpf__destroy(mgr->process_exit_skel);
-            mgr->process_exit_skel = NULL;
-        } else {
-            loaded_count++;
-            log_debug("process_exit_trace program loaded successfully");
+    for (int i = 0; i < FILTER_MAP_COUNT; i++) {
+        mgr->filter_map_fds[i] = dup(bpf_map__fd(maps[i]));
+        if (mgr->filter_map_fds[i] < 0) {
+            log_warn("Failed to keep process filter maps, kernel-side process filter disabled");
+            while (i-- > 0) {
+                close(mgr->filter_map_fds[i]);
+                mgr->filter_map_fds[i] = -1;
+            }
+            return;
         }
     }
+}
+
+/**
+ * Size a program's ring buffer before it is loaded
+ * With sharded rings it only catches CPUs without a shard, so it is
+ * kept to one page
+ */
+static void configure_ringbuf(struct ebpf_manager *mgr, const char *name, struct bpf_map *events)
+{
+    uint32_t size = mgr->ring_shards_fd >= 0 ? (uint32_t)sysconf(_SC_PAGESIZE) : mgr->ringbuf_size;
+    int err = bpf_map__set_max_entries(events, size);
+    if (err) {
+        log_warn("Failed to set %s ring buffer size to %u bytes: %d", name, size, err);
+    }
+}
+
+/**
+ * Point a program's shard maps at the shared ones before load
+ * Without a sharded layout the maps are unused and shrunk to a single
+ * entry and a one-page ring template. A program whose maps cannot be
+ * shared submits to its own ring buffer, which consumer 0 drains.
+ */
+static void configure_ring_shards(struct ebpf_manager *mgr, const char *name,
+                                  struct bpf_map *ring_shards, struct bpf_map *shard_of_cpu)
+{
+    struct bpf_map *template = bpf_map__inner_map(ring_shards);
     
-    /* Load openssl_api_trace program (optional) */
-    log_debug("Loading openssl_api_trace program (optional)...");
-    mgr->openssl_api_skel = openssl_api_trace_bpf__open();
-    if (!mgr->openssl_api_skel) {
-        log_info("OpenSSL API tracing not available (optional feature)");
-    } else {
-        err = openssl_api_trace_bpf__load(mgr->openssl_api_skel);
-        if (err) {
-            log_info("OpenSSL API tracing not loaded (optional feature, error: %d)", err);
-            openssl_api_trace_bpf__destroy(mgr->openssl_api_skel);
-            mgr->openssl_api_skel = NULL;
-        } else {
-            loaded_count++;
+    if (mgr->ring_shards_fd < 0) {
+        bpf_map__set_max_entries(ring_shards, 1);
+        bpf_map__set_max_entries(shard_of_cpu, 1);
+        if (template) {
+            bpf_map__set_max_entries(template, (uint32_t)sysconf(_SC_PAGESIZE));
         }
+        return;
     }
     
-    /* Check if at least core programs loaded */
-    if (loaded_count == 0) {
-        log_error_with_suggestion("Failed to load any eBPF programs",
-                                   "Check kernel version (requires 4.15+) and BPF support");
-        return -1;
+    if (bpf_map__reuse_fd(ring_shards, mgr->ring_shards_fd) != 0 ||
+        bpf_map__reuse_fd(shard_of_cpu, mgr->shard_of_cpu_fd) != 0) {
+        log_warn("Failed to share ring buffer shards with %s", name);
     }
-    
-    mgr->programs_loaded = true;
-    log_info("Successfully loaded %d eBPF program(s)", loaded_count);
-    
-    return 0;
 }
 
 /**
- * Attach all loaded eBPF programs
+ * Sum a counter from a per-CPU array map across all possible CPUs
  */
-int ebpf_manager_attach_programs(struct ebpf_manager *mgr)
+static int read_percpu_counter(int map_fd, __u32 key, uint64_t *sum)
 {
-    int err;
-    int attached_count = 0;
+    int ncpus = libbpf_num_possible_cpus();
+    uint64_t *values;
+    int i;
     
-    if (!mgr) {
-        return -EINVAL;
-    }
+    *sum = 0;
     
-    if (!mgr->programs_loaded) {
-        log_error("Programs not loaded yet");
+    if (map_fd < 0 || ncpus <= 0) {
         return -1;
     }
     
-    if (mgr->programs_attached) {
-        log_warn("Programs already attached");
-        return 0;
+    values = calloc(ncpus, sizeof(*values));
+    if (!values) {
+        return -1;
     }
     
-    log_debug("Attaching eBPF programs...");
-    
-    /* Attach file_open_trace program */
-    if (mgr->file_open_skel) {
-        log_debug("Attaching file_open_trace...");
-        err = file_open_trace_bpf__attach(mgr->file_open_skel);
-        if (err) {
-            log_warn("Failed to attach file_open_trace: %d", err);
-        } else {
-            attached_count++;
-            log_debug("file_open_trace attached successfully");
-        }
+    if (bpf_map_lookup_elem(map_fd, &key, values) != 0) {
+        free(values);
+        return -1;
     }
     
-    /* Attach lib_load_trace program */
-    if (mgr->lib_load_skel) {
-        log_debug("Attaching lib_load_trace...");
-        err = lib_load_trace_bpf__attach(mgr->lib_load_skel);
-        if (err) {
-            log_warn("Failed to attach lib_load_trace: %d", err);
-        } else {
-            attached_count++;
-            log_debug("lib_load_trace attached successfully");
-        }
+    for (i = 0; i < ncpus; i++) {
+        *sum += values[i];
     }
     
-    /* Attach process_exec_trace program */
-    if (mgr->process_exec_skel) {
-        log_debug("Attaching process_exec_trace...");
-        err = process_exec_trace_bpf__attach(mgr->process_exec_skel);
-        if (err) {
-            log_warn("Failed to attach process_exec_trace: %d", err);
-        } else {
-            attached_count++;
-            log_debug("process_exec_trace attached successfully");
-        }
-    }
+    free(values);
+    return 0;
+}
+
+/**
+ * Set the ring buffer size and notification mode
+ * Must be called before ebpf_manager_load_programs().
+ * 
+ * @param mgr eBPF manager
+ * @param config Ring buffer configuration
+ * @return 0 on success, -EINVAL on invalid arguments, -1 if already loaded
+ */
+int ebpf_manager_set_ringbuf_config(struct ebpf_manager *mgr, const ebpf_ringbuf_config_t *config)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    uint32_t size;
     
-    /* Attach process_exit_trace program */
-    if (mgr->process_exit_skel) {
-        log_debug("Attaching process_exit_trace...");
-        err = process_exit_trace_bpf__attach(mgr->process_exit_skel);
-        if (err) {
-            log_warn("Failed to attach process_exit_trace: %d", err);
-        } else {
-            attached_count++;
-            log_debug("process_exit_trace attached successfully");
-        }
+    if (!mgr || !config) {
+        return -EINVAL;
     }
     
-    /* Attach openssl_api_trace program (optional) */
-    if (mgr->openssl_api_skel) {
-        log_debug("Attaching openssl_api_trace (optional)...");
-        err = openssl_api_trace_bpf__attach(mgr->openssl_api_skel);
-        if (err) {
-            log_info("OpenSSL API tracing not attached (optional): %d", err);
-        } else {
-            attached_count++;
-            log_debug("openssl_api_trace attached successfully");
-        }
+    size = config->size ? config->size : CT_RINGBUF_DEFAULT_SIZE;
+    
+    /* The kernel requires a power-of-two multiple of the page size */
+    if ((size & (size - 1)) != 0 || (page_size > 0 && size % (uint32_t)page_size != 0)) {
+        log_error("Invalid ring buffer size %u (must be a power of two and a multiple of %ld)",
+                  size, page_size);
+        return -EINVAL;
     }
     
-    if (attached_count == 0) {
-        log_error("Failed to attach any eBPF programs");
+    if (mgr->programs_loaded) {
+        log_warn("Ring buffer configuration must be set before programs are loaded");
         return -1;
     }
     
-    mgr->programs_attached = true;
-    log_info("Successfully attached %d eBPF program(s)", attached_count);
+    mgr->ringbuf_size = size;
+    mgr->wakeup_watermark = config->lazy_wakeup ? size / RINGBUF_WAKEUP_FRACTION : 0;
+    
+    if (config->lazy_wakeup) {
+        log_debug("Ring buffer size: %u bytes per program, wakeup past 1/%d full",
+                  size, RINGBUF_WAKEUP_FRACTION);
+    } else {
+        log_debug("Ring buffer size: %u bytes per program, wakeup per event", size);
+    }
     
     return 0;
 }
 
-/* Event batch processing context */
-struct event_batch_ctx {
-    struct ebpf_manager *mgr;
-    event_callback_t callback;
-    void *user_ctx;
-    int events_in_batch;
-    int max_batch_size;
-};
-
 /**
- * Convert timestamp to ISO 8601 format
+ * Count OpenSSL API calls in the kernel instead of sending an event per call
+ * Must be called before ebpf_manager_load_programs(). The counts are
+ * delivered by ebpf_manager_read_api_counts(); calls that do not fit in
+ * the count map still arrive as events.
+ * 
+ * @return 0 on success, -EINVAL on invalid arguments, -1 if already loaded
  */
-static void format_timestamp(uint64_t timestamp_ns, char *buf, size_t buf_size)
+int ebpf_manager_set_api_aggregation(struct ebpf_manager *mgr, bool enable)
 {
-    time_t sec = timestamp_ns / 1000000000ULL;
-    uint64_t usec = (timestamp_ns % 1000000000ULL) / 1000;
-    struct tm tm;
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    if (mgr->programs_loaded) {
+        log_warn("API aggregation must be set before programs are loaded");
+        return -1;
+    }
     
-    gmtime_r(&sec, &tm);
-    snprintf(buf, buf_size, "%04d-%02d-%02dT%02d:%02d:%02d.%06luZ",
-             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
-             tm.tm_hour, tm.tm_min, tm.tm_sec, usec);
+    mgr->aggregate_api_calls = enable;
+    return 0;
 }
 
 /**
- * Parse and process a file_open event
+ * Measure TLS handshake latency in the kernel
+ * Must be called before ebpf_manager_load_programs(). Handshakes are
+ * timed by entry and return probes on SSL_connect, SSL_accept and
+ * SSL_do_handshake and counted in per-(process, function) histograms,
+ * delivered by ebpf_manager_read_handshake_latency(). The return probes,
+ * and the SSL_get_error probes that tell a failed non-blocking handshake
+ * from one that will be retried, are only attached when enabled.
+ * 
+ * @return 0 on success, -EINVAL on invalid arguments, -1 if already loaded
  */
-static int process_file_open_event(struct ebpf_manager *mgr, struct ct_file_open_event *event,
-                                   event_callback_t callback, void *ctx)
+int ebpf_manager_set_handshake_latency(struct ebpf_manager *mgr, bool enable)
 {
-    processed_event_t *proc_event;
-    char timestamp[64];
-    int ret;
+    if (!mgr) {
+        return -EINVAL;
+    }
     
-    /* Acquire event from buffer pool */
-    proc_event = event_buffer_pool_acquire(mgr->event_pool);
-    if (!proc_event) {
-        mgr->events_dropped++;
+    if (mgr->programs_loaded) {
+        log_warn("Handshake latency must be set before programs are loaded");
         return -1;
     }
     
-    /* Format timestamp */
-    format_timestamp(event->header.timestamp_ns, timestamp, sizeof(timestamp));
-    
-    /* Fill processed event */
-    proc_event->event_type = strdup("file_open");
-    proc_event->timestamp = strdup(timestamp);
-    proc_event->pid = event->header.pid;
-    proc_event->uid = event->header.uid;
-    proc_event->process = strndup(event->header.comm, MAX_COMM_LEN);
-    proc_event->file = strndup(event->filename, MAX_FILENAME_LEN);
-    proc_event->flags = NULL; /* Will be formatted later if needed */
-    proc_event->result = event->result;
-    
-    /* Call user callback */
-    ret = callback ? callback(proc_event, ctx) : 0;
-    
-    /* Release event back to pool */
-    event_buffer_pool_release(mgr->event_pool, proc_event);
-    
-    return ret;
+    mgr->measure_handshakes = enable;
+    return 0;
 }
 
 /**
- * Parse and process a lib_load event
+ * Coalesce repeated file opens and library loads in the kernel
+ * Must be called before ebpf_manager_load_programs(). Within window_ms
+ * of the first open (or load) of a path by a process, further ones only
+ * bump a kernel counter; the counts are delivered as file_open and
+ * lib_load events whose count is the number of repeats, once per window
+ * by ebpf_manager_poll_events(), when the process exits, and by
+ * ebpf_manager_flush_coalesced().
+ * 
+ * @param window_ms Window length (0 = every event is submitted)
+ * @return 0 on success, -EINVAL on invalid arguments, -1 if already
+ *         loaded or out of memory
  */
-static int process_lib_load_event(struct ebpf_manager *mgr, struct ct_lib_load_event *event,
-                                  event_callback_t callback, void *ctx)
+int ebpf_manager_set_coalesce_window(struct ebpf_manager *mgr, uint32_t window_ms)
 {
-    processed_event_t *proc_event;
-    char timestamp[64];
-    int ret;
+    if (!mgr) {
+        return -EINVAL;
+    }
     
-    /* Acquire event from buffer pool */
-    proc_event = event_buffer_pool_acquire(mgr->event_pool);
-    if (!proc_event) {
-        mgr->events_dropped++;
+    if (mgr->programs_loaded) {
+        log_warn("Coalescing window must be set before programs are loaded");
         return -1;
     }
     
-    /* Format timestamp */
-    format_timestamp(event->header.timestamp_ns, timestamp, sizeof(timestamp));
-    
-    /* Fill processed event */
-    proc_event->event_type = strdup("lib_load");
-    proc_event->timestamp = strdup(timestamp);
-    proc_event->pid = event->header.pid;
-    proc_event->uid = event->header.uid;
-    proc_event->process = strndup(event->header.comm, MAX_COMM_LEN);
-    proc_event->library = strndup(event->lib_path, MAX_LIBPATH_LEN);
-    
-    /* Call user callback */
-    ret = callback ? callback(proc_event, ctx) : 0;
-    
-    /* Release event back to pool */
-    event_buffer_pool_release(mgr->event_pool, proc_event);
+    if (window_ms > 0 && !mgr->coalesce_table) {
+        mgr->coalesce_table = coalesce_table_create();
+        if (!mgr->coalesce_table) {
+            return -1;
+        }
+    } else if (window_ms == 0) {
+        coalesce_table_destroy(mgr->coalesce_table);
+        mgr->coalesce_table = NULL;
+    }
     
-    return ret;
+    mgr->coalesce_window_ns = (uint64_t)window_ms * 1000000ULL;
+    return 0;
 }
 
 /**
- * Parse and process a process_exec event
+ * Choose the event sources to load and attach
+ * Must be called before ebpf_manager_load_programs(); commands that only
+ * need some event types skip the verification and attachment of the
+ * other programs. All sources are loaded by default.
+ * 
+ * @param sources Bitmask of EBPF_SOURCE_BIT() values (0 = all)
+ * @return 0 on success, -EINVAL on invalid arguments, -1 if already loaded
  */
-static int process_exec_event(struct ebpf_manager *mgr, struct ct_process_exec_event *event,
-                              event_callback_t callback, void *ctx)
+int ebpf_manager_set_sources(struct ebpf_manager *mgr, uint32_t sources)
 {
-    processed_event_t *proc_event;
-    char timestamp[64];
-    int ret;
+    if (!mgr || (sources & ~EBPF_SOURCES_ALL) != 0) {
+        return -EINVAL;
+    }
     
-    /* Acquire event from buffer pool */
-    proc_event = event_buffer_pool_acquire(mgr->event_pool);
-    if (!proc_event) {
-        mgr->events_dropped++;
+    if (mgr->programs_loaded) {
+        log_warn("Event sources must be set before programs are loaded");
         return -1;
     }
     
-    /* Format timestamp */
-    format_timestamp(event->header.timestamp_ns, timestamp, sizeof(timestamp));
-    
-    /* Fill processed event */
-    proc_event->event_type = strdup("process_exec");
-    proc_event->timestamp = strdup(timestamp);
-    proc_event->pid = event->header.pid;
-    proc_event->uid = event->header.uid;
-    proc_event->process = strndup(event->header.comm, MAX_COMM_LEN);
-    proc_event->cmdline = strndup(event->cmdline, MAX_CMDLINE_LEN);
-    
-    /* Call user callback */
-    ret = callback ? callback(proc_event, ctx) : 0;
-    
-    /* Release event back to pool */
-    event_buffer_pool_release(mgr->event_pool, proc_event);
-    
-    return ret;
+    mgr->sources = sources ? sources : EBPF_SOURCES_ALL;
+    return 0;
 }
 
 /**
- * Parse and process a process_exit event
+ * Choose between one ring buffer per program and sharded rings
+ * Must be called before ebpf_manager_load_programs(). The sharded rings
+ * are drained with ebpf_manager_poll_consumer(), one consumer per NUMA
+ * node; a kernel that cannot put ring buffers in a map gets one ring per
+ * program instead, and ebpf_manager_consumer_count() returns 0. Event
+ * coalescing and raw capture need the single polling thread and are not
+ * available with sharded rings.
+ * 
+ * @return 0 on success, -EINVAL on invalid arguments, -1 if already loaded
  */
-static int process_exit_event(struct ebpf_manager *mgr, struct ct_process_exit_event *event,
-                              event_callback_t callback, void *ctx)
+int ebpf_manager_set_ring_layout(struct ebpf_manager *mgr, ebpf_ring_layout_t layout)
 {
-    processed_event_t *proc_event;
-    char timestamp[64];
-    int ret;
+    if (!mgr || layout < EBPF_RINGS_PER_PROGRAM || layout > EBPF_RINGS_PER_NODE) {
+        return -EINVAL;
+    }
     
-    /* Acquire event from buffer pool */
-    proc_event = event_buffer_pool_acquire(mgr->event_pool);
-    if (!proc_event) {
-        mgr->events_dropped++;
+    if (mgr->programs_loaded) {
+        log_warn("Ring buffer layout must be set before programs are loaded");
         return -1;
     }
     
-    /* Format timestamp */
-    format_timestamp(event->header.timestamp_ns, timestamp, sizeof(timestamp));
-    
-    /* Fill processed event */
-    proc_event->event_type = strdup("process_exit");
-    proc_event->timestamp = strdup(timestamp);
-    proc_event->pid = event->header.pid;
-    proc_event->uid = event->header.uid;
-    proc_event->process = strndup(event->header.comm, MAX_COMM_LEN);
-    proc_event->exit_code = event->exit_code;
-    
-    /* Call user callback */
-    ret = callback ? callback(proc_event, ctx) : 0;
-    
-    /* Release event back to pool */
-    event_buffer_pool_release(mgr->event_pool, proc_event);
-    
-    return ret;
+    mgr->ring_layout = layout;
+    return 0;
 }
 
 /**
- * Parse and process an api_call event
+ * Assign the CPUs of a sysfs CPU list ("0-3,8,10-11") to a NUMA node
  */
-static int process_api_call_event(struct ebpf_manager *mgr, struct ct_api_call_event *event,
-                                  event_callback_t callback, void *ctx)
+static void assign_cpu_list(const char *list, int node, int *node_of_cpu, int ncpus)
 {
-    processed_event_t *proc_event;
-    char timestamp[64];
-    int ret;
+    const char *p = list;
+    char *end;
+    long first, last;
     
-    /* Acquire event from buffer pool */
-    proc_event = event_buffer_pool_acquire(mgr->event_pool);
-    if (!proc_event) {
-        mgr->events_dropped++;
-        return -1;
+    while (*p && *p != '\n') {
+        first = strtol(p, &end, 10);
+        if (end == p) {
+            return;
+        }
+        last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p) {
+                return;
+            }
+        }
+        for (long cpu = first < 0 ? 0 : first; cpu <= last && cpu < ncpus; cpu++) {
+            node_of_cpu[cpu] = node;
+        }
+        p = *end == ',' ? end + 1 : end;
     }
-    
-    /* Format timestamp */
-    format_timestamp(event->header.timestamp_ns, timestamp, sizeof(timestamp));
-    
-    /* Fill processed event */
-    proc_event->event_type = strdup("api_call");
-    proc_event->timestamp = strdup(timestamp);
-    proc_event->pid = event->header.pid;
-    proc_event->uid = event->header.uid;
-    proc_event->process = strndup(event->header.comm, MAX_COMM_LEN);
-    proc_event->function_name = strndup(event->function_name, MAX_FUNCNAME_LEN);
-    proc_event->library = strndup(event->library, MAX_FUNCNAME_LEN);
-    
-    /* Call user callback */
-    ret = callback ? callback(proc_event, ctx) : 0;
-    
-    /* Release event back to pool */
-    event_buffer_pool_release(mgr->event_pool, proc_event);
-    
-    return ret;
 }
 
 /**
- * Ring buffer callback handler
+ * Find the NUMA node of every possible CPU
+ * Nodes with CPUs are numbered densely in order of their kernel ids;
+ * without NUMA information in sysfs every CPU is on node 0.
+ * 
+ * @return Number of nodes with CPUs (at least 1)
  */
-static int handle_event(void *ctx, void *data, size_t data_sz)
+static unsigned int read_cpu_nodes(int *node_of_cpu, int ncpus)
 {
-    struct event_batch_ctx *batch_ctx = ctx;
-    struct ebpf_manager *mgr = batch_ctx->mgr;
-    struct ct_event_header *header = data;
-    int ret = 0;
+    static int dense[MAX_NUMA_NODES];
+    char path[64];
+    char list[4096];
+    struct dirent *entry;
+    unsigned int nodes = 0;
+    DIR *dir;
+    FILE *fp;
+    int node;
+    
+    memset(node_of_cpu, 0, (size_t)ncpus * sizeof(*node_of_cpu));
+    
+    dir = opendir("/sys/devices/system/node");
+    while (dir && (entry = readdir(dir)) != NULL) {
+        if (sscanf(entry->d_name, "node%d", &node) != 1 || node < 0 || node >= MAX_NUMA_NODES) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        fp = fopen(path, "r");
+        if (!fp) {
+            continue;
+        }
+        if (fgets(list, sizeof(list), fp)) {
+            assign_cpu_list(list, node, node_of_cpu, ncpus);
+        }
+        fclose(fp);
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    
+    for (node = 0; node < MAX_NUMA_NODES; node++) {
+        dense[node] = -1;
+    }
+    for (int cpu = 0; cpu < ncpus; cpu++) {
+        dense[node_of_cpu[cpu]] = 0;
+    }
+    for (node = 0; node < MAX_NUMA_NODES; node++) {
+        if (dense[node] == 0) {
+            dense[node] = (int)nodes++;
+        }
+    }
+    for (int cpu = 0; cpu < ncpus; cpu++) {
+        node_of_cpu[cpu] = dense[node_of_cpu[cpu]];
+    }
+    
+    return nodes;
+}
+
+/**
+ * Release the shard rings and their maps
+ */
+static void destroy_ring_shards(struct ebpf_manager *mgr)
+{
+    for (unsigned int i = 0; i < mgr->consumer_count; i++) {
+        if (mgr->consumers[i].rb) {
+            ring_buffer__free(mgr->consumers[i].rb);
+            mgr->consumers[i].rb = NULL;
+        }
+    }
+    for (unsigned int shard = 0; shard < mgr->shard_count; shard++) {
+        close(mgr->shard_fds[shard]);
+    }
+    mgr->shard_count = 0;
+    
+    if (mgr->ring_shards_fd >= 0) {
+        close(mgr->ring_shards_fd);
+        mgr->ring_shards_fd = -1;
+    }
+    if (mgr->shard_of_cpu_fd >= 0) {
+        close(mgr->shard_of_cpu_fd);
+        mgr->shard_of_cpu_fd = -1;
+    }
+}
+
+/**
+ * Create the shard rings of the sharded layout and the maps the programs
+ * find them through, and set up one consumer per NUMA node
+ * Per CPU, CPU i submits to shard i (modulo CT_MAX_RING_SHARDS) and the
+ * shard belongs to the node of CPU i; per node, each node has one shard.
+ * 
+ * @return 0 on success, -1 on failure (nothing left created)
+ */
+static int create_ring_shards(struct ebpf_manager *mgr)
+{
+    LIBBPF_OPTS(bpf_map_create_opts, opts);
+    int ncpus = libbpf_num_possible_cpus();
+    unsigned int nodes;
+    int *node_of_cpu;
+    __u32 key, value;
     
-    if (!mgr || !data || data_sz < sizeof(struct ct_event_header)) {
+    if (ncpus <= 0) {
         return -1;
     }
+    node_of_cpu = calloc((size_t)ncpus, sizeof(*node_of_cpu));
+    if (!node_of_cpu) {
+        return -1;
+    }
+    nodes = read_cpu_nodes(node_of_cpu, ncpus);
     
-    /* Update statistics */
-    mgr->events_processed++;
-    batch_ctx->events_in_batch++;
+    mgr->consumers = calloc(nodes, sizeof(*mgr->consumers));
+    if (!mgr->consumers) {
+        free(node_of_cpu);
+        return -1;
+    }
+    mgr->consumer_count = nodes;
+    for (unsigned int i = 0; i < nodes; i++) {
+        mgr->consumers[i].mgr = mgr;
+        mgr->consumers[i].index = i;
+        CPU_ZERO(&mgr->consumers[i].cpus);
+    }
+    for (int cpu = 0; cpu < ncpus && cpu < CPU_SETSIZE; cpu++) {
+        CPU_SET(cpu, &mgr->consumers[node_of_cpu[cpu]].cpus);
+    }
+    
+    if (mgr->ring_layout == EBPF_RINGS_PER_CPU) {
+        mgr->shard_count = ncpus < CT_MAX_RING_SHARDS ? (unsigned int)ncpus : CT_MAX_RING_SHARDS;
+    } else {
+        mgr->shard_count = nodes < CT_MAX_RING_SHARDS ? nodes : CT_MAX_RING_SHARDS;
+    }
     
-    /* Check batch size limit for backpressure */
-    if (batch_ctx->events_in_batch >= batch_ctx->max_batch_size) {
-        /* Log warning about backpressure */
-        static uint64_t last_warning = 0;
-        uint64_t now = header->timestamp_ns;
-        if (now - last_warning > 1000000000ULL) { /* 1 second */
-            log_warn("Event processing backpressure detected (batch size: %d)",
-                     batch_ctx->events_in_batch);
-            last_warning = now;
+    for (unsigned int shard = 0; shard < mgr->shard_count; shard++) {
+        mgr->shard_fds[shard] = bpf_map_create(BPF_MAP_TYPE_RINGBUF, "ring_shard", 0, 0,
+                                               mgr->ringbuf_size, NULL);
+        if (mgr->shard_fds[shard] < 0) {
+            mgr->shard_count = shard;
+            goto fail;
         }
     }
     
-    /* Parse event based on type */
-    switch (header->event_type) {
-        case CT_EVENT_FILE_OPEN:
-            if (data_sz >= sizeof(struct ct_file_open_event)) {
-                ret = process_file_open_event(mgr, (struct ct_file_open_event *)data,
-                                             batch_ctx->callback, batch_ctx->user_ctx);
+    opts.inner_map_fd = mgr->shard_fds[0];
+    mgr->ring_shards_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY_OF_MAPS, "ring_shards",
+                                         sizeof(__u32), sizeof(__u32), CT_MAX_RING_SHARDS, &opts);
+    mgr->shard_of_cpu_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, "shard_of_cpu",
+                                          sizeof(__u32), sizeof(__u32), CT_MAX_CPUS, NULL);
+    if (mgr->ring_shards_fd < 0 || mgr->shard_of_cpu_fd < 0) {
+        goto fail;
+    }
+    
+    for (key = 0; key < mgr->shard_count; key++) {
+        value = (__u32)mgr->shard_fds[key];
+        if (bpf_map_update_elem(mgr->ring_shards_fd, &key, &value, BPF_ANY) != 0) {
+            goto fail;
+        }
+    }
+    
+    /* CPUs past CT_MAX_CPUS find no shard and use their program's ring */
+    for (key = 0; key < (__u32)ncpus && key < CT_MAX_CPUS; key++) {
+        value = mgr->ring_layout == EBPF_RINGS_PER_CPU ? key % mgr->shard_count :
+                (__u32)node_of_cpu[key] % mgr->shard_count;
+        if (bpf_map_update_elem(mgr->shard_of_cpu_fd, &key, &value, BPF_ANY) != 0) {
+            goto fail;
+        }
+        if (mgr->ring_layout == EBPF_RINGS_PER_NODE || key < mgr->shard_count) {
+            mgr->shard_consumer[value] = (unsigned int)node_of_cpu[key];
+        }
+    }
+    
+    free(node_of_cpu);
+    log_info("Sharded ring buffers: %u ring(s) of %u bytes, %u consumer(s)",
+             mgr->shard_count, mgr->ringbuf_size, nodes);
+    return 0;
+    
+fail:
+    log_debug("Failed to create ring buffer shards: %s", strerror(errno));
+    free(node_of_cpu);
+    destroy_ring_shards(mgr);
+    free(mgr->consumers);
+    mgr->consumers = NULL;
+    mgr->consumer_count = 0;
+    return -1;
+}
+
+/**
+ * Finish loading a skeleton: time it, and take over its filter maps if
+ * this is the first program to load
+ */
+static void source_loaded(struct ebpf_manager *mgr, ebpf_source_t source,
+                          struct bpf_map *filter_maps[FILTER_MAP_COUNT], bool adopt,
+                          uint64_t start_ns)
+{
+    if (adopt) {
+        adopt_filter_maps(mgr, filter_maps);
+    }
+    mgr->source_stats[source].load_ns = clock_ns(CLOCK_MONOTONIC) - start_ns;
+    log_debug("%s loaded in %.1f ms", ebpf_source_name(source),
+              mgr->source_stats[source].load_ns / 1e6);
+}
+
+static const char *const file_open_flavor_names[] = {
+    [FILE_OPEN_RESOLVED] = "security_file_open",
+    [FILE_OPEN_FEXIT] = "fexit",
+    [FILE_OPEN_KPROBE] = "kprobes",
+};
+
+/**
+ * Open and load file_open_trace with one of its flavors (see
+ * file_open_trace.bpf.c)
+ * 
+ * @return 0 on success, -1 on failure (skeleton released)
+ */
+static int load_file_open(struct ebpf_manager *mgr, file_open_flavor_t flavor)
+{
+    struct file_open_trace_bpf *skel;
+    int err;
+    
+    skel = file_open_trace_bpf__open();
+    if (!skel) {
+        log_warn("Failed to open file_open_trace BPF skeleton");
+        return -1;
+    }
+    
+    struct bpf_map *filter_maps[FILTER_MAP_COUNT] = SKEL_FILTER_MAPS(skel);
+    
+    bpf_program__set_autoload(skel->progs.trace_security_file_open, flavor == FILE_OPEN_RESOLVED);
+    bpf_program__set_autoload(skel->progs.trace_openat2_exit, flavor == FILE_OPEN_FEXIT);
+    bpf_program__set_autoload(skel->progs.trace_do_sys_openat2, flavor == FILE_OPEN_KPROBE);
+    bpf_program__set_autoload(skel->progs.trace_do_sys_open, flavor == FILE_OPEN_KPROBE);
+    
+    reuse_filter_maps(mgr, "file_open_trace", filter_maps);
+    SKEL_CONFIGURE_RINGBUF(mgr, skel, "file_open_trace");
+    skel->rodata->coalesce_window_ns = mgr->coalesce_window_ns;
+    err = file_open_trace_bpf__load(skel);
+    if (err) {
+        if (flavor != FILE_OPEN_KPROBE) {
+            log_debug("file_open_trace %s flavor not loaded (%d), using %s",
+                      file_open_flavor_names[flavor], err, file_open_flavor_names[flavor + 1]);
+        } else {
+            log_bpf_verifier_error("file_open_trace", err, "Check kernel logs for details");
+        }
+        file_open_trace_bpf__destroy(skel);
+        return -1;
+    }
+    
+    mgr->file_open_skel = skel;
+    mgr->file_open_flavor = flavor;
+    log_debug("file_open_trace uses %s", file_open_flavor_names[flavor]);
+    return 0;
+}
+
+/**
+ * Open, configure and load the skeleton behind one source
+ * With adopt false the shared filter maps must already exist; such loads
+ * touch nothing but their own skeleton and can run concurrently.
+ * 
+ * @return 0 if the program loaded, -1 otherwise
+ */
+static int load_source(struct ebpf_manager *mgr, ebpf_source_t source, bool adopt)
+{
+    uint64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    int err;
+    
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN: {
+            log_debug("Loading file_open_trace program...");
+            /* Prefer the resolved paths, then the fexit flavor; without
+             * BTF neither can load */
+            file_open_flavor_t flavor = FILE_OPEN_RESOLVED;
+            
+            if (access("/sys/kernel/btf/vmlinux", R_OK) != 0) {
+                flavor = FILE_OPEN_KPROBE;
             }
-            break;
+            while (load_file_open(mgr, flavor) != 0) {
+                if (flavor == FILE_OPEN_KPROBE) {
+                    return -1;
+                }
+                flavor++;
+            }
+            struct bpf_map *filter_maps[FILTER_MAP_COUNT] = SKEL_FILTER_MAPS(mgr->file_open_skel);
             
-        case CT_EVENT_LIB_LOAD:
-            if (data_sz >= sizeof(struct ct_lib_load_event)) {
-                ret = process_lib_load_event(mgr, (struct ct_lib_load_event *)data,
-                                            batch_ctx->callback, batch_ctx->user_ctx);
+            source_loaded(mgr, source, filter_maps, adopt, start_ns);
+            configure_file_open_filter(mgr);
+            return 0;
+        }
+        
+        case EBPF_SOURCE_LIB_LOAD: {
+            log_debug("Loading lib_load_trace program...");
+            mgr->lib_load_skel = lib_load_trace_bpf__open();
+            if (!mgr->lib_load_skel) {
+                log_warn("Failed to open lib_load_trace BPF skeleton");
+                return -1;
             }
-            break;
+            struct bpf_map *filter_maps[FILTER_MAP_COUNT] = SKEL_FILTER_MAPS(mgr->lib_load_skel);
             
-        case CT_EVENT_PROCESS_EXEC:
-            if (data_sz >= sizeof(struct ct_process_exec_event)) {
-                ret = process_exec_event(mgr, (struct ct_process_exec_event *)data,
-                                        batch_ctx->callback, batch_ctx->user_ctx);
+            reuse_filter_maps(mgr, "lib_load_trace", filter_maps);
+            SKEL_CONFIGURE_RINGBUF(mgr, mgr->lib_load_skel, "lib_load_trace");
+            mgr->lib_load_skel->rodata->coalesce_window_ns = mgr->coalesce_window_ns;
+            err = lib_load_trace_bpf__load(mgr->lib_load_skel);
+            if (err) {
+                log_bpf_verifier_error("lib_load_trace", err, "Check kernel logs for details");
+                lib_load_trace_bpf__destroy(mgr->lib_load_skel);
+                mgr->lib_load_skel = NULL;
+                return -1;
             }
-            break;
+            source_loaded(mgr, source, filter_maps, adopt, start_ns);
+            return 0;
+        }
+        
+        case EBPF_SOURCE_PROCESS_EXEC: {
+            log_debug("Loading process_exec_trace program...");
+            mgr->process_exec_skel = process_exec_trace_bpf__open();
+            if (!mgr->process_exec_skel) {
+                log_warn("Failed to open process_exec_trace BPF skeleton");
+                return -1;
+            }
+            struct bpf_map *filter_maps[FILTER_MAP_COUNT] = SKEL_FILTER_MAPS(mgr->process_exec_skel);
             
-        case CT_EVENT_PROCESS_EXIT:
-            if (data_sz >= sizeof(struct ct_process_exit_event)) {
-                ret = process_exit_event(mgr, (struct ct_process_exit_event *)data,
-                                        batch_ctx->callback, batch_ctx->user_ctx);
+            reuse_filter_maps(mgr, "process_exec_trace", filter_maps);
+            SKEL_CONFIGURE_RINGBUF(mgr, mgr->process_exec_skel, "process_exec_trace");
+            err = process_exec_trace_bpf__load(mgr->process_exec_skel);
+            if (err) {
+                log_bpf_verifier_error("process_exec_trace", err, "Check kernel logs for details");
+                process_exec_trace_bpf__destroy(mgr->process_exec_skel);
+                mgr->process_exec_skel = NULL;
+                return -1;
             }
-            break;
+            source_loaded(mgr, source, filter_maps, adopt, start_ns);
+            return 0;
+        }
+        
+        case EBPF_SOURCE_PROCESS_EXIT: {
+            log_debug("Loading process_exit_trace program...");
+            mgr->process_exit_skel = process_exit_trace_bpf__open();
+            if (!mgr->process_exit_skel) {
+                log_warn("Failed to open process_exit_trace BPF skeleton");
+                return -1;
+            }
+            struct bpf_map *filter_maps[FILTER_MAP_COUNT] = SKEL_FILTER_MAPS(mgr->process_exit_skel);
             
-        case CT_EVENT_API_CALL:
-            if (data_sz >= sizeof(struct ct_api_call_event)) {
-                ret = process_api_call_event(mgr, (struct ct_api_call_event *)data,
-                                            batch_ctx->callback, batch_ctx->user_ctx);
+            reuse_filter_maps(mgr, "process_exit_trace", filter_maps);
+            SKEL_CONFIGURE_RINGBUF(mgr, mgr->process_exit_skel, "process_exit_trace");
+            err = process_exit_trace_bpf__load(mgr->process_exit_skel);
+            if (err) {
+                log_bpf_verifier_error("process_exit_trace", err, "Check kernel logs for details");
+                process_exit_trace_bpf__destroy(mgr->process_exit_skel);
+                mgr->process_exit_skel = NULL;
+                return -1;
             }
-            break;
+            source_loaded(mgr, source, filter_maps, adopt, start_ns);
+            return 0;
+        }
+        
+        case EBPF_SOURCE_OPENSSL_API: {
+            /* Optional: only logged at info level when unavailable */
+            log_debug("Loading openssl_api_trace program (optional)...");
+            mgr->openssl_api_skel = openssl_api_trace_bpf__open();
+            if (!mgr->openssl_api_skel) {
+                log_info("OpenSSL API tracing not available (optional feature)");
+                return -1;
+            }
+            struct bpf_map *filter_maps[FILTER_MAP_COUNT] = SKEL_FILTER_MAPS(mgr->openssl_api_skel);
             
+            reuse_filter_maps(mgr, "openssl_api_trace", filter_maps);
+            SKEL_CONFIGURE_RINGBUF(mgr, mgr->openssl_api_skel, "openssl_api_trace");
+            mgr->openssl_api_skel->rodata->aggregate_api_calls = mgr->aggregate_api_calls;
+            mgr->openssl_api_skel->rodata->measure_handshakes = mgr->measure_handshakes;
+            err = openssl_api_trace_bpf__load(mgr->openssl_api_skel);
+            if (err) {
+                log_info("OpenSSL API tracing not loaded (optional feature, error: %d)", err);
+                openssl_api_trace_bpf__destroy(mgr->openssl_api_skel);
+                mgr->openssl_api_skel = NULL;
+                return -1;
+            }
+            source_loaded(mgr, source, filter_maps, adopt, start_ns);
+            return 0;
+        }
+        
         default:
-            log_warn("Unknown event type: %u", header->event_type);
-            break;
+            return -1;
+    }
+}
+
+/* Parallel skeleton load (see ebpf_manager_load_programs) */
+typedef struct {
+    struct ebpf_manager *mgr;
+    ebpf_source_t source;
+    pthread_t thread;
+    bool started;
+    int result;
+} load_worker_t;
+
+static void *load_worker_main(void *arg)
+{
+    load_worker_t *worker = arg;
+    
+    worker->result = load_source(worker->mgr, worker->source, false);
+    return NULL;
+}
+
+/**
+ * Load the selected eBPF programs
+ * Programs are loaded in source order until one succeeds and creates the
+ * shared process filter maps. The rest only reuse those maps, so they
+ * are verified and loaded on parallel threads.
+ */
+int ebpf_manager_load_programs(struct ebpf_manager *mgr)
+{
+    load_worker_t workers[EBPF_SOURCE_COUNT];
+    int worker_count = 0;
+    int loaded_count = 0;
+    uint64_t start_ns;
+    int source = 0;
+    
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    if (mgr->programs_loaded) {
+        log_warn("Programs already loaded");
+        return 0;
+    }
+    
+    /* The daemon's programs are used; the connection is made on attach,
+     * once the process filter is known */
+    if (mgr->daemon_path) {
+        mgr->programs_loaded = true;
+        return 0;
+    }
+    
+    log_debug("Loading eBPF programs (sources: 0x%x)...", mgr->sources);
+    start_ns = clock_ns(CLOCK_MONOTONIC);
+    
+    /* The shard rings must exist before the programs that share them */
+    if (mgr->ring_layout != EBPF_RINGS_PER_PROGRAM && !mgr->consumers &&
+        create_ring_shards(mgr) != 0) {
+        log_warn("Sharded ring buffers not supported by this kernel, using one per program");
+    }
+    
+    /* The first program to load owns the shared filter maps */
+    for (; source < EBPF_SOURCE_COUNT && loaded_count == 0; source++) {
+        if (mgr->sources & EBPF_SOURCE_BIT(source)) {
+            loaded_count += load_source(mgr, (ebpf_source_t)source, true) == 0;
+        }
+    }
+    
+    /* Without shared maps every program would create (and adopt) its own;
+     * load them one at a time then */
+    for (; source < EBPF_SOURCE_COUNT; source++) {
+        if (!(mgr->sources & EBPF_SOURCE_BIT(source))) {
+            continue;
+        }
+        if (mgr->filter_map_fds[FILTER_MAP_CONFIG] < 0) {
+            loaded_count += load_source(mgr, (ebpf_source_t)source, true) == 0;
+            continue;
+        }
+        
+        load_worker_t *worker = &workers[worker_count++];
+        worker->mgr = mgr;
+        worker->source = (ebpf_source_t)source;
+        worker->started = pthread_create(&worker->thread, NULL, load_worker_main, worker) == 0;
+        if (!worker->started) {
+            load_worker_main(worker);
+        }
+    }
+    
+    for (int i = 0; i < worker_count; i++) {
+        if (workers[i].started) {
+            pthread_join(workers[i].thread, NULL);
+        }
+        loaded_count += workers[i].result == 0;
+    }
+    
+    /* Check if at least core programs loaded */
+    if (loaded_count == 0) {
+        log_error_with_suggestion("Failed to load any eBPF programs",
+                                   "Check kernel version (requires 4.15+) and BPF support");
+        return -1;
+    }
+    
+    mgr->programs_loaded = true;
+    log_info("Successfully loaded %d eBPF program(s)", loaded_count);
+    log_debug("eBPF programs loaded in %.1f ms", (clock_ns(CLOCK_MONOTONIC) - start_ns) / 1e6);
+    
+    return 0;
+}
+
+/**
+ * Push a process filter into the kernel
+ * Call after load and before attach, so filtered processes never reach
+ * the ring buffers. On failure the kernel filter is left disabled and
+ * only the user-space filters apply.
+ * Returns 0 on success, -EINVAL on invalid arguments, -1 on error
+ */
+int ebpf_manager_set_process_filter(struct ebpf_manager *mgr, const ebpf_process_filter_t *filter)
+{
+    struct ct_filter_config config = { 0 };
+    struct ct_comm_pattern pattern;
+    __u32 key = 0;
+    __u8 one = 1;
+    size_t len;
+    
+    if (!mgr || !filter) {
+        return -EINVAL;
+    }
+    
+    /* A daemon client sends its filter with its request */
+    if (mgr->daemon_path) {
+        mgr->daemon_request.pid = filter->pid;
+        if (filter->comm) {
+            snprintf(mgr->daemon_request.comm, sizeof(mgr->daemon_request.comm), "%s",
+                     filter->comm);
+        }
+        if (filter->follow_children) {
+            log_warn("Child processes are not followed through the daemon");
+        }
+        /* Cgroups are matched by the client, which resolves the ids itself */
+        return 0;
+    }
+    
+    if (!mgr->programs_loaded || mgr->filter_map_fds[FILTER_MAP_CONFIG] < 0) {
+        log_debug("Kernel-side process filter not available");
+        return -1;
+    }
+    
+    mgr->follows_children = false;
+    mgr->filters_cgroups = false;
+    
+    if (filter->pid > 0) {
+        key = filter->pid;
+        if (bpf_map_update_elem(mgr->filter_map_fds[FILTER_MAP_PIDS], &key, &one, BPF_ANY) != 0) {
+            goto fail;
+        }
+        config.flags |= CT_FILTER_PID;
+        
+        /* Children are only added by the fork probe in process_exec_trace */
+        if (filter->follow_children && mgr->process_exec_skel) {
+            config.flags |= CT_FILTER_FOLLOW_CHILDREN;
+        } else if (filter->follow_children) {
+            log_warn("Child process tracking unavailable (process_exec_trace not loaded)");
+        }
+    }
+    
+    /* A name longer than a comm can never match one; leave it to user space */
+    if (filter->comm && (len = strlen(filter->comm)) > 0 && len < MAX_COMM_LEN) {
+        memset(&pattern, 0, sizeof(pattern));
+        pattern.len = len;
+        for (size_t i = 0; i < len; i++) {
+            pattern.pattern[i] = tolower((unsigned char)filter->comm[i]);
+        }
+        
+        key = 0;
+        if (bpf_map_update_elem(mgr->filter_map_fds[FILTER_MAP_COMMS], &key, &pattern, BPF_ANY) != 0) {
+            goto fail;
+        }
+        config.flags |= CT_FILTER_COMM;
+    }
+    
+    if (filter->filter_uid) {
+        key = filter->uid;
+        if (bpf_map_update_elem(mgr->filter_map_fds[FILTER_MAP_UIDS], &key, &one, BPF_ANY) != 0) {
+            goto fail;
+        }
+        config.flags |= CT_FILTER_UID;
+    }
+    
+    if (filter->cgroup_count > MAX_FILTER_CGROUPS) {
+        log_warn("More than %d cgroups selected, filtering them in user space only",
+                 MAX_FILTER_CGROUPS);
+    } else if (filter->cgroup_count > 0) {
+        for (size_t i = 0; i < filter->cgroup_count; i++) {
+            if (bpf_map_update_elem(mgr->filter_map_fds[FILTER_MAP_CGROUPS],
+                                    &filter->cgroup_ids[i], &one, BPF_ANY) != 0) {
+                goto fail;
+            }
+        }
+        config.flags |= CT_FILTER_CGROUP;
+    }
+    
+    /* Enable last, once every referenced map entry is in place */
+    key = 0;
+    if (bpf_map_update_elem(mgr->filter_map_fds[FILTER_MAP_CONFIG], &key, &config, BPF_ANY) != 0) {
+        goto fail;
+    }
+    
+    mgr->follows_children = (config.flags & CT_FILTER_FOLLOW_CHILDREN) != 0;
+    mgr->filters_cgroups = (config.flags & CT_FILTER_CGROUP) != 0;
+    log_debug("Kernel-side process filter configured (flags: 0x%x)", config.flags);
+    
+    return 0;
+    
+fail:
+    log_warn("Failed to configure kernel-side process filter, filtering in user space only");
+    memset(&config, 0, sizeof(config));
+    key = 0;
+    bpf_map_update_elem(mgr->filter_map_fds[FILTER_MAP_CONFIG], &key, &config, BPF_ANY);
+    return -1;
+}
+
+/**
+ * Check whether children of the filtered PID are tracked in the kernel
+ * When true, every event that passes the kernel filter belongs to the
+ * target process or one of its descendants
+ */
+bool ebpf_manager_follows_children(struct ebpf_manager *mgr)
+{
+    return mgr && mgr->follows_children;
+}
+
+/**
+ * Check whether the kernel filters on the selected cgroups
+ * When true, every event that passes the kernel filter comes from one of
+ * them or a descendant, including cgroups created after the selection
+ */
+bool ebpf_manager_filters_cgroups(struct ebpf_manager *mgr)
+{
+    return mgr && mgr->filters_cgroups;
+}
+
+/**
+ * Stop the probes from submitting events
+ * Sets CT_FILTER_STOPPED in the process filter of every loaded program,
+ * so the ring buffers only hold what was submitted before and can be
+ * drained to the end (ebpf_manager_drain()) while the programs are still
+ * attached. A daemon client has nothing to stop.
+ * Returns 0 on success, -EINVAL on invalid arguments, -1 on error
+ */
+int ebpf_manager_stop_events(struct ebpf_manager *mgr)
+{
+    struct bpf_map *maps[EBPF_SOURCE_COUNT];
+    struct ct_filter_config config;
+    __u32 key = 0;
+    int failed = 0;
+    
+    if (!mgr) {
+        return -EINVAL;
+    }
+    if (!mgr->programs_loaded) {
+        return 0;
+    }
+    
+    /* Each program's own map; programs sharing the filter share it */
+    maps[EBPF_SOURCE_FILE_OPEN] = mgr->file_open_skel ? mgr->file_open_skel->maps.filter_config : NULL;
+    maps[EBPF_SOURCE_LIB_LOAD] = mgr->lib_load_skel ? mgr->lib_load_skel->maps.filter_config : NULL;
+    maps[EBPF_SOURCE_PROCESS_EXEC] =
+        mgr->process_exec_skel ? mgr->process_exec_skel->maps.filter_config : NULL;
+    maps[EBPF_SOURCE_PROCESS_EXIT] =
+        mgr->process_exit_skel ? mgr->process_exit_skel->maps.filter_config : NULL;
+    maps[EBPF_SOURCE_OPENSSL_API] =
+        mgr->openssl_api_skel ? mgr->openssl_api_skel->maps.filter_config : NULL;
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        int fd;
+        
+        if (!maps[source]) {
+            continue;
+        }
+        fd = bpf_map__fd(maps[source]);
+        if (bpf_map_lookup_elem(fd, &key, &config) != 0) {
+            memset(&config, 0, sizeof(config));
+        }
+        config.flags |= CT_FILTER_STOPPED;
+        if (bpf_map_update_elem(fd, &key, &config, BPF_ANY) != 0) {
+            log_warn("Failed to stop %s events: %s", ebpf_source_name((ebpf_source_t)source),
+                     strerror(errno));
+            failed = -1;
+        }
+    }
+    
+    log_debug("Event production stopped");
+    return failed;
+}
+
+/* Kernel event type submitted by each source (rate_config index) */
+static const uint32_t source_event_types[EBPF_SOURCE_COUNT] = {
+    [EBPF_SOURCE_FILE_OPEN] = CT_EVENT_FILE_OPEN,
+    [EBPF_SOURCE_LIB_LOAD] = CT_EVENT_LIB_LOAD,
+    [EBPF_SOURCE_PROCESS_EXEC] = CT_EVENT_PROCESS_EXEC,
+    [EBPF_SOURCE_PROCESS_EXIT] = CT_EVENT_PROCESS_EXIT,
+    [EBPF_SOURCE_OPENSSL_API] = CT_EVENT_API_CALL,
+};
+
+/**
+ * Push a source's rate limit and sampling into the kernel
+ * Call after load and before attach, like the process filter. Token
+ * buckets are per CPU, so each CPU gets an equal share of the rate and
+ * burst (at least one event each); a storm confined to one CPU is held
+ * to that share. A NULL or all-zero limit removes the source's limit.
+ * Returns 0 on success, -EINVAL on invalid arguments, -1 on error
+ */
+int ebpf_manager_set_rate_limit(struct ebpf_manager *mgr, ebpf_source_t source,
+                                const ebpf_rate_limit_t *limit)
+{
+    struct ct_rate_config config = { 0 };
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    __u32 key;
+    
+    if (!mgr || source < 0 || source >= EBPF_SOURCE_COUNT) {
+        return -EINVAL;
+    }
+    
+    if (!mgr->programs_loaded || mgr->filter_map_fds[FILTER_MAP_RATE] < 0) {
+        log_debug("Kernel-side rate limiting not available");
+        return -1;
+    }
+    
+    if (cpus < 1) {
+        cpus = 1;
+    }
+    
+    if (limit && limit->rate > 0) {
+        uint32_t burst = limit->burst ? limit->burst : limit->rate;
+        
+        config.rate = (uint32_t)((limit->rate + (uint64_t)cpus - 1) / (uint64_t)cpus);
+        config.burst = (uint32_t)((burst + (uint64_t)cpus - 1) / (uint64_t)cpus);
+    }
+    if (limit) {
+        config.sample_every = limit->sample_every;
+    }
+    
+    key = source_event_types[source];
+    if (bpf_map_update_elem(mgr->filter_map_fds[FILTER_MAP_RATE], &key, &config, BPF_ANY) != 0) {
+        log_warn("Failed to configure rate limit for %s", ebpf_source_name(source));
+        return -1;
+    }
+    
+    log_debug("%s rate limit: %u/s per CPU (burst %u), sampling 1 in %u",
+              ebpf_source_name(source), config.rate, config.burst,
+              config.sample_every > 1 ? config.sample_every : 1);
+    return 0;
+}
+
+/* Functions the uprobe programs are attached to, in the libraries whose
+ * file name starts with library; dlopen moved into libc with glibc 2.34.
+ * Return probes (retprobe) and the probes only handshake latency needs
+ * (handshake) follow the entry probes they pair with. */
+static const struct {
+    ebpf_source_t source;
+    const char *program;
+    uprobe_target_t target;
+    bool retprobe;
+    bool handshake;
+} uprobe_probes[] = {
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_ctx_new", { "libssl.so", "SSL_CTX_new" }, false, false },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_connect", { "libssl.so", "SSL_connect" }, false, false },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_accept", { "libssl.so", "SSL_accept" }, false, false },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_do_handshake", { "libssl.so", "SSL_do_handshake" },
+      false, true },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_handshake_ret", { "libssl.so", "SSL_connect" },
+      true, true },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_handshake_ret", { "libssl.so", "SSL_accept" },
+      true, true },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_handshake_ret", { "libssl.so", "SSL_do_handshake" },
+      true, true },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_get_error", { "libssl.so", "SSL_get_error" },
+      false, true },
+    { EBPF_SOURCE_OPENSSL_API, "trace_ssl_get_error_ret", { "libssl.so", "SSL_get_error" },
+      true, true },
+    { EBPF_SOURCE_LIB_LOAD, "trace_dlopen", { "libc.so.6", "dlopen" }, false, false },
+    { EBPF_SOURCE_LIB_LOAD, "trace_dlopen", { "libdl.so.2", "dlopen" }, false, false },
+    { EBPF_SOURCE_LIB_LOAD, "trace_dlopen", { "ld-musl-", "dlopen" }, false, false },
+};
+
+/**
+ * Attach one uprobe program to a function of a library (attacher callback)
+ * Called with the attacher's lock held, so links are added one at a time
+ */
+static int attach_uprobe(size_t target, const char *path, uint64_t offset, void *ctx)
+{
+    struct ebpf_manager *mgr = ctx;
+    size_t probe = mgr->uprobe_probe[target];
+    struct bpf_object *obj = source_object(mgr, uprobe_probes[probe].source);
+    struct bpf_program *prog;
+    struct bpf_link *link;
+    struct bpf_link **links;
+    size_t capacity;
+    
+    prog = obj ? bpf_object__find_program_by_name(obj, uprobe_probes[probe].program) : NULL;
+    if (!prog) {
+        return -1;
+    }
+    
+    if (mgr->uprobe_link_count == mgr->uprobe_link_capacity) {
+        capacity = mgr->uprobe_link_capacity ? mgr->uprobe_link_capacity * 2 : 16;
+        links = realloc(mgr->uprobe_links, capacity * sizeof(*links));
+        if (!links) {
+            return -1;
+        }
+        mgr->uprobe_links = links;
+        mgr->uprobe_link_capacity = capacity;
+    }
+    
+    link = bpf_program__attach_uprobe(prog, uprobe_probes[probe].retprobe, -1, path,
+                                      (size_t)offset);
+    if (!link) {
+        log_debug("Failed to attach %s to %s+0x%llx: %d", uprobe_probes[probe].program, path,
+                  (unsigned long long)offset, -errno);
+        return -1;
+    }
+    
+    mgr->uprobe_links[mgr->uprobe_link_count++] = link;
+    log_debug("Attached %s to %s", uprobe_probes[probe].program, path);
+    return 0;
+}
+
+/**
+ * Attach the uprobe programs to the libraries mapped by every process
+ * The uprobe sections name no binary, so the programs are attached per
+ * library: first to those running processes map now, then to the new
+ * ones exec and dlopen events lead to (see note_new_libraries). Offsets
+ * are cached on disk by library identity, so a restart parses no ELF
+ * file it has seen before. Sets up once for all uprobe sources.
+ * 
+ * @return 0 on success, -1 on failure
+ */
+static int attach_uprobes(struct ebpf_manager *mgr)
+{
+    uprobe_target_t targets[UPROBE_MAX_TARGETS];
+    uprobe_attacher_stats_t stats;
+    size_t count = 0;
+    
+    if (mgr->uprobes) {
+        return 0;
+    }
+    
+    for (size_t i = 0; i < sizeof(uprobe_probes) / sizeof(uprobe_probes[0]); i++) {
+        if (source_object(mgr, uprobe_probes[i].source) &&
+            (!uprobe_probes[i].handshake || mgr->measure_handshakes)) {
+            mgr->uprobe_probe[count] = i;
+            targets[count++] = uprobe_probes[i].target;
+        }
+    }
+    
+    mgr->symbols = symbol_cache_create(SYMBOL_CACHE_DEFAULT_PATH);
+    if (!mgr->symbols) {
+        return -1;
+    }
+    mgr->uprobes = uprobe_attacher_create(targets, count, mgr->symbols, attach_uprobe, mgr);
+    if (!mgr->uprobes) {
+        symbol_cache_destroy(mgr->symbols);
+        mgr->symbols = NULL;
+        return -1;
+    }
+    
+    uprobe_attacher_scan_all(mgr->uprobes);
+    uprobe_attacher_get_stats(mgr->uprobes, &stats);
+    log_info("Attached %llu uprobe(s) in %llu librar%s", (unsigned long long)stats.probes,
+             (unsigned long long)stats.libraries, stats.libraries == 1 ? "y" : "ies");
+    return 0;
+}
+
+/**
+ * Queue the process of an exec or dlopen record for a maps scan
+ * Either can map libraries no probe is attached to yet
+ */
+static void note_new_libraries(struct ebpf_manager *mgr, const struct ct_event_header *header)
+{
+    if (mgr->uprobes && (header->event_type == CT_EVENT_PROCESS_EXEC ||
+                         header->event_type == CT_EVENT_LIB_LOAD)) {
+        uprobe_attacher_queue_pid(mgr->uprobes, (pid_t)header->pid, clock_ns(CLOCK_MONOTONIC));
+    }
+}
+
+/**
+ * Attach the skeleton behind one source, if it is loaded
+ * 
+ * @return 1 if attached, 0 if not loaded, -1 if the attach failed
+ */
+static int attach_source(struct ebpf_manager *mgr, ebpf_source_t source)
+{
+    uint64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    int err;
+    
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN:
+            if (!mgr->file_open_skel) {
+                return 0;
+            }
+            err = file_open_trace_bpf__attach(mgr->file_open_skel);
+            /* Trampolines can load but fail to attach (e.g. no arch
+             * support): reload with kprobes, reusing the shared maps */
+            if (err && mgr->file_open_flavor != FILE_OPEN_KPROBE) {
+                log_debug("file_open_trace %s attach failed (%d), using kprobes",
+                          file_open_flavor_names[mgr->file_open_flavor], err);
+                file_open_trace_bpf__destroy(mgr->file_open_skel);
+                mgr->file_open_skel = NULL;
+                if (load_file_open(mgr, FILE_OPEN_KPROBE) != 0) {
+                    return -1;
+                }
+                configure_file_open_filter(mgr);
+                err = file_open_trace_bpf__attach(mgr->file_open_skel);
+            }
+            break;
+        case EBPF_SOURCE_LIB_LOAD:
+            if (!mgr->lib_load_skel) {
+                return 0;
+            }
+            err = attach_uprobes(mgr);
+            break;
+        case EBPF_SOURCE_PROCESS_EXEC:
+            if (!mgr->process_exec_skel) {
+                return 0;
+            }
+            err = process_exec_trace_bpf__attach(mgr->process_exec_skel);
+            break;
+        case EBPF_SOURCE_PROCESS_EXIT:
+            if (!mgr->process_exit_skel) {
+                return 0;
+            }
+            err = process_exit_trace_bpf__attach(mgr->process_exit_skel);
+            break;
+        case EBPF_SOURCE_OPENSSL_API:
+            if (!mgr->openssl_api_skel) {
+                return 0;
+            }
+            err = attach_uprobes(mgr);
+            if (err) {
+                log_info("OpenSSL API tracing not attached (optional): %d", err);
+                return -1;
+            }
+            break;
+        default:
+            return 0;
+    }
+    
+    if (err) {
+        log_warn("Failed to attach %s: %d", ebpf_source_name(source), err);
+        return -1;
+    }
+    
+    mgr->source_stats[source].attach_ns = clock_ns(CLOCK_MONOTONIC) - start_ns;
+    log_debug("%s attached in %.1f ms", ebpf_source_name(source),
+              mgr->source_stats[source].attach_ns / 1e6);
+    return 1;
+}
+
+/**
+ * Attach all loaded eBPF programs
+ */
+int ebpf_manager_attach_programs(struct ebpf_manager *mgr)
+{
+    int attached_count = 0;
+    
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    if (!mgr->programs_loaded) {
+        log_error("Programs not loaded yet");
+        return -1;
+    }
+    
+    if (mgr->programs_attached) {
+        log_warn("Programs already attached");
+        return 0;
+    }
+    
+    if (mgr->daemon_path) {
+        return attach_daemon(mgr);
+    }
+    
+    log_debug("Attaching eBPF programs...");
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        attached_count += attach_source(mgr, (ebpf_source_t)source) == 1;
+    }
+    
+    if (attached_count == 0) {
+        log_error("Failed to attach any eBPF programs");
+        return -1;
+    }
+    
+    mgr->programs_attached = true;
+    log_info("Successfully attached %d eBPF program(s)", attached_count);
+    
+    /* Consumers set up their rings on their own threads; the sources
+     * they drain are known now */
+    for (int source = 0; source < EBPF_SOURCE_COUNT && mgr->consumers; source++) {
+        mgr->source_stats[source].attached = source_object(mgr, (ebpf_source_t)source) != NULL;
+    }
+    
+    return 0;
+}
+
+/* Event batch processing context */
+struct event_batch_ctx {
+    struct ebpf_manager *mgr;
+    event_callback_t callback;
+    void *user_ctx;
+    uint32_t events_in_batch;
+};
+
+/**
+ * Borrow a NUL-terminated string from a ring buffer record
+ * The record is read-only and only valid during the callback, so the
+ * string is used in place; an unterminated field is treated as missing
+ */
+static const char *borrow_record_string(const char *field, size_t size)
+{
+    return memchr(field, '\0', size) ? field : NULL;
+}
+
+/**
+ * Borrow the trailing string of a variable-length record
+ * The string must lie within the data_sz bytes received and end with
+ * the NUL that len counts; anything else is treated as missing
+ */
+static const char *borrow_record_payload(const void *record, size_t data_sz,
+                                         const char *field, size_t len)
+{
+    size_t offset = (size_t)(field - (const char *)record);
+    
+    if (len == 0 || offset > data_sz || len > data_sz - offset || field[len - 1] != '\0') {
+        return NULL;
+    }
+    
+    return field;
+}
+
+/**
+ * Fill the fields every record type shares
+ */
+static void decode_event_header(processed_event_t *proc_event, event_kind_t kind,
+                                const struct ct_event_header *header)
+{
+    processed_event_set_kind(proc_event, kind);
+    proc_event->timestamp_ns = timestamp_from_boot_ns(header->timestamp_ns);
+    proc_event->pid = header->pid;
+    proc_event->uid = header->uid;
+    proc_event->process_start_ns = header->start_time_ns;
+    proc_event->cgroup_id = header->cgroup_id;
+    proc_event->process = borrow_record_string(header->comm, sizeof(header->comm));
+    proc_event->count = header->weight > 1 ? header->weight : 0;
+}
+
+/**
+ * Access mode of an open, as reported in file_open events
+ */
+static const char *open_access_mode(uint32_t flags)
+{
+    switch (flags & O_ACCMODE) {
+        case O_WRONLY:
+            return "O_WRONLY";
+        case O_RDWR:
+            return "O_RDWR";
+        default:
+            return "O_RDONLY";
+    }
+}
+
+/**
+ * Record decoders, one per event kind (decode_<name>_event)
+ * String fields are borrowed from record; buf is scratch space for
+ * fields built from the record (the exec command line).
+ */
+typedef int (*record_decoder_t)(const void *record, size_t data_sz, processed_event_t *proc_event,
+                                char *buf, size_t size);
+
+/**
+ * Decode a file_open record
+ */
+static int decode_file_open_event(const void *record, size_t data_sz,
+                                  processed_event_t *proc_event, char *buf, size_t size)
+{
+    const struct ct_file_open_event *event = record;
+    
+    (void)buf;
+    (void)size;
+    if (data_sz < offsetof(struct ct_file_open_event, filename)) {
+        return -1;
+    }
+    
+    decode_event_header(proc_event, EVENT_FILE_OPEN, &event->header);
+    proc_event->file = borrow_record_payload(event, data_sz, event->filename, event->filename_len);
+    proc_event->flags = open_access_mode(event->flags);
+    proc_event->result = event->result;
+    if (event->ino != 0) {
+        proc_event->inode = event->ino;
+        proc_event->dev = makedev(event->dev >> 20, event->dev & 0xfffff);
+    }
+    if (event->count > 0) {
+        proc_event->count = event->count;
+    }
+    
+    return 0;
+}
+
+/**
+ * Decode a lib_load record
+ */
+static int decode_lib_load_event(const void *record, size_t data_sz,
+                                 processed_event_t *proc_event, char *buf, size_t size)
+{
+    const struct ct_lib_load_event *event = record;
+    
+    (void)buf;
+    (void)size;
+    if (data_sz < offsetof(struct ct_lib_load_event, lib_path)) {
+        return -1;
+    }
+    
+    decode_event_header(proc_event, EVENT_LIB_LOAD, &event->header);
+    proc_event->library = borrow_record_payload(event, data_sz, event->lib_path, event->lib_path_len);
+    if (event->count > 0) {
+        proc_event->count = event->count;
+    }
+    
+    return 0;
+}
+
+/**
+ * Join the NUL-separated argv of an exec record into a command line
+ * 
+ * @return Command line in buf, or NULL if the record carries no argv
+ */
+static const char *decode_exec_cmdline(const char *args, size_t args_len,
+                                       char *buf, size_t size)
+{
+    size_t len = 0;
+    
+    for (size_t i = 0; i < args_len && len + 1 < size; i++) {
+        buf[len++] = args[i] ? args[i] : ' ';
+    }
+    
+    /* Drop the separator(s) left by the final argument */
+    while (len > 0 && buf[len - 1] == ' ') {
+        len--;
+    }
+    buf[len] = '\0';
+    
+    return len > 0 ? buf : NULL;
+}
+
+/**
+ * Decode a process_exec record
+ * The joined command line is written to buf
+ */
+static int decode_process_exec_event(const void *record, size_t data_sz,
+                                     processed_event_t *proc_event, char *buf, size_t size)
+{
+    const struct ct_process_exec_event *event = record;
+    const char *filename;
+    size_t payload;
+    
+    if (data_sz < offsetof(struct ct_process_exec_event, data)) {
+        return -1;
+    }
+    
+    /* Variable-length record: the payload must hold what the header claims */
+    payload = data_sz - offsetof(struct ct_process_exec_event, data);
+    if ((size_t)event->filename_len + event->args_len > payload ||
+        event->filename_len > MAX_FILENAME_LEN || event->args_len > MAX_EXEC_ARGS_LEN) {
+        log_debug("Malformed process_exec record (%zu bytes)", data_sz);
+        return -1;
+    }
+    
+    decode_event_header(proc_event, EVENT_PROCESS_EXEC, &event->header);
+    proc_event->cmdline = decode_exec_cmdline(event->data + event->filename_len, event->args_len,
+                                              buf, size);
+    
+    /* The exec filename is the executable unless it was given relative
+     * to the caller's working directory */
+    filename = borrow_record_payload(event, data_sz, event->data, event->filename_len);
+    if (filename && filename[0] == '/') {
+        proc_event->exe = filename;
+    }
+    
+    return 0;
+}
+
+/**
+ * Decode a process_exit record
+ */
+static int decode_process_exit_event(const void *record, size_t data_sz,
+                                     processed_event_t *proc_event, char *buf, size_t size)
+{
+    const struct ct_process_exit_event *event = record;
+    
+    (void)buf;
+    (void)size;
+    if (data_sz < sizeof(struct ct_process_exit_event)) {
+        return -1;
+    }
+    
+    decode_event_header(proc_event, EVENT_PROCESS_EXIT, &event->header);
+    proc_event->exit_code = event->exit_code;
+    proc_event->tid = event->tid;
+    
+    return 0;
+}
+
+/**
+ * Decode an api_call record
+ */
+static int decode_api_call_event(const void *record, size_t data_sz,
+                                 processed_event_t *proc_event, char *buf, size_t size)
+{
+    const struct ct_api_call_event *event = record;
+    
+    (void)buf;
+    (void)size;
+    if (data_sz < sizeof(struct ct_api_call_event)) {
+        return -1;
+    }
+    
+    decode_event_header(proc_event, EVENT_API_CALL, &event->header);
+    proc_event->function_name = borrow_record_string(event->function_name, sizeof(event->function_name));
+    proc_event->library = borrow_record_string(event->library, sizeof(event->library));
+    
+    return 0;
+}
+
+/* Decoder of each kind; kinds are the kernel's record types */
+static const record_decoder_t record_decoders[EVENT_KIND_COUNT] = {
+#define EVENT_SCHEMA_DECODER(kind, name, fields) [EVENT_##kind] = decode_##name##_event,
+    EVENT_SCHEMA(EVENT_SCHEMA_DECODER)
+#undef EVENT_SCHEMA_DECODER
+};
+
+#define EVENT_SCHEMA_CHECK(kind, name, fields) \
+    _Static_assert((int)EVENT_##kind == (int)CT_EVENT_##kind, #name " kind is not its record type");
+EVENT_SCHEMA(EVENT_SCHEMA_CHECK)
+#undef EVENT_SCHEMA_CHECK
+
+/**
+ * Decode a record into a pool event
+ * String fields are borrowed from record, which must stay valid until
+ * the event is released.
+ * 
+ * @return 0 on success, -1 for short, malformed or unknown records
+ */
+static int decode_record(const void *record, size_t data_sz, processed_event_t *proc_event,
+                         char *cmdline_buf, size_t cmdline_size)
+{
+    const struct ct_event_header *header = record;
+    
+    if (header->event_type == EVENT_NONE || header->event_type >= EVENT_KIND_COUNT) {
+        log_warn("Unknown event type: %u", header->event_type);
+        return -1;
+    }
+    
+    return record_decoders[header->event_type](record, data_sz, proc_event, cmdline_buf,
+                                               cmdline_size);
+}
+
+/**
+ * Bump a counter with a single writer that other threads may read
+ */
+static inline void counter_add(uint64_t *counter, uint64_t value)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value,
+                     __ATOMIC_RELAXED);
+}
+
+static inline uint64_t counter_read(const uint64_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/**
+ * Add an event's capture-to-dispatch latency to the histogram
+ * Event timestamps were converted from CLOCK_BOOTTIME with the shared
+ * offset, so the current time is taken the same way
+ */
+static void record_latency(uint64_t hist[LATENCY_BUCKETS], uint64_t *max_ns,
+                           uint64_t timestamp_ns)
+{
+    uint64_t now = timestamp_now_ns();
+    uint64_t latency = now > timestamp_ns ? now - timestamp_ns : 0;
+    int bucket = latency ? 64 - __builtin_clzll(latency) : 0;
+    
+    counter_add(&hist[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1], 1);
+    if (latency > *max_ns) {
+        __atomic_store_n(max_ns, latency, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Finish with a dispatched event
+ * Records its latency and returns it to the pool. In queued mode this is
+ * called by the consumer thread after it has written the event.
+ */
+void ebpf_manager_complete_event(struct ebpf_manager *mgr, struct processed_event *event)
+{
+    if (!mgr || !event) {
+        return;
+    }
+    
+    /* A sharded layout consumer's event: its latency was recorded when
+     * its callback returned */
+    if (event->pool != mgr->event_pool) {
+        event_buffer_pool_release(event->pool, event);
+        return;
+    }
+    
+    /* Records that failed to decode carry no timestamp; replayed ones
+     * were captured long ago */
+    if (event->timestamp_ns && !mgr->replaying) {
+        record_latency(mgr->latency_hist, &mgr->latency_max_ns, event->timestamp_ns);
+    }
+    
+    event_buffer_pool_release(mgr->event_pool, event);
+}
+
+/**
+ * Decode a record in place and run the callback on this thread
+ */
+static int dispatch_record(struct ebpf_manager *mgr, struct event_batch_ctx *batch_ctx,
+                           const void *data, size_t data_sz, processed_event_t *proc_event)
+{
+    uint64_t begin = stage_begin();
+    int decoded;
+    int ret = 0;
+    
+    decoded = decode_record(data, data_sz, proc_event, mgr->exec_cmdline,
+                            sizeof(mgr->exec_cmdline));
+    stage_end(STAGE_DECODE, begin);
+    
+    if (decoded == 0 && batch_ctx->callback) {
+        ret = batch_ctx->callback(proc_event, batch_ctx->user_ctx);
+    }
+    
+    /* The callback has filtered and written the event by now */
+    ebpf_manager_complete_event(mgr, proc_event);
+    
+    return ret;
+}
+
+/**
+ * Decode a record from a copy the event owns
+ * The ring buffer slot is reclaimed as soon as the ring buffer callback
+ * returns, so an event that outlives it is decoded from a copy; exec
+ * records reserve room after the copy for the joined command line.
+ * 
+ * @return 0 on success, -1 on failure
+ */
+static int decode_record_copy(processed_event_t *proc_event, const void *data, size_t data_sz)
+{
+    const struct ct_event_header *header = data;
+    size_t extra = header->event_type == CT_EVENT_PROCESS_EXEC ? MAX_EXEC_ARGS_LEN + 1 : 0;
+    uint64_t begin = stage_begin();
+    char *record;
+    
+    record = processed_event_copy_record(proc_event, data, data_sz, extra);
+    if (!record || decode_record(record, data_sz, proc_event, record + data_sz, extra) != 0) {
+        return -1;
+    }
+    stage_end(STAGE_DECODE, begin);
+    return 0;
+}
+
+/**
+ * Decode a record and hand it to the consumer thread
+ */
+static void queue_record(struct ebpf_manager *mgr, const void *data, size_t data_sz,
+                         processed_event_t *proc_event)
+{
+    if (decode_record_copy(proc_event, data, data_sz) != 0) {
+        event_buffer_pool_release(mgr->event_pool, proc_event);
+        return;
+    }
+    
+    if (!spsc_queue_push(mgr->event_queue, proc_event)) {
+        mgr->events_dropped++;
+        event_buffer_pool_release(mgr->event_pool, proc_event);
+    }
+}
+
+/**
+ * Decode a record and deliver it, in place or through the event queue
+ * 
+ * @return The callback's result in place, 0 otherwise
+ */
+static int deliver_record(struct ebpf_manager *mgr, const void *data, size_t data_sz)
+{
+    processed_event_t *proc_event;
+    
+    /* An exhausted pool means the consumer is behind: drop this record
+     * and keep draining so the kernel side does not start dropping too */
+    proc_event = event_buffer_pool_acquire(mgr->event_pool);
+    if (!proc_event) {
+        mgr->events_dropped++;
+        return 0;
+    }
+    
+    if (mgr->event_queue) {
+        queue_record(mgr, data, data_sz, proc_event);
+        return 0;
+    }
+    
+    return dispatch_record(mgr, mgr->batch_ctx, data, data_sz, proc_event);
+}
+
+/**
+ * Coalescing map FD of the program behind an event type
+ * Returns -1 if the program is not loaded or does not coalesce
+ */
+static int coalesce_map_fd(struct ebpf_manager *mgr, uint32_t event_type)
+{
+    switch (event_type) {
+        case CT_EVENT_FILE_OPEN:
+            return mgr->file_open_skel ? bpf_map__fd(mgr->file_open_skel->maps.coalesce) : -1;
+        case CT_EVENT_LIB_LOAD:
+            return mgr->lib_load_skel ? bpf_map__fd(mgr->lib_load_skel->maps.coalesce) : -1;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Keep the record that opened a coalescing window
+ * Its copy is what the window's repeats are reported as
+ */
+static void track_coalesced_record(struct ebpf_manager *mgr, const void *data, size_t data_sz)
+{
+    const struct ct_event_header *header = data;
+    coalesce_key_t key = { .pid = header->pid, .event_type = header->event_type };
+    
+    switch (header->event_type) {
+        case CT_EVENT_FILE_OPEN:
+            if (data_sz < offsetof(struct ct_file_open_event, filename)) {
+                return;
+            }
+            key.path_hash = ((const struct ct_file_open_event *)data)->path_hash;
+            break;
+        case CT_EVENT_LIB_LOAD:
+            if (data_sz < offsetof(struct ct_lib_load_event, lib_path)) {
+                return;
+            }
+            key.path_hash = ((const struct ct_lib_load_event *)data)->path_hash;
+            break;
+        default:
+            return;
+    }
+    
+    if (key.path_hash != 0 && coalesce_table_put(mgr->coalesce_table, &key, data, data_sz) != 0) {
+        log_debug_ratelimited("Failed to track coalesced record of PID %u", header->pid);
+    }
+}
+
+/* Context of a coalesced count report */
+typedef struct {
+    struct ebpf_manager *mgr;
+    uint64_t now;                  /* CLOCK_BOOTTIME, like kernel record timestamps */
+    bool reap;                     /* Forget keys of processes that are gone */
+} coalesce_report_ctx_t;
+
+/**
+ * Deliver the repeats a key counted since its last report
+ * The window's record is delivered again, stamped now and carrying the
+ * number of repeats as its count.
+ * 
+ * @return true if the key should be forgotten
+ */
+static bool report_coalesced(coalesce_entry_t *entry, void *arg)
+{
+    coalesce_report_ctx_t *ctx = arg;
+    struct ct_coalesce_key key = {
+        .pid = entry->key.pid,
+        .event_type = entry->key.event_type,
+        .path_hash = entry->key.path_hash,
+    };
+    struct ct_coalesce_value value;
+    struct ct_event_header *header = entry->record;
+    uint32_t count;
+    int map_fd = coalesce_map_fd(ctx->mgr, entry->key.event_type);
+    
+    /* Evicted from the LRU map: its counter is gone with it */
+    if (map_fd < 0 || bpf_map_lookup_elem(map_fd, &key, &value) != 0) {
+        return true;
+    }
+    
+    /* A counter below what was reported belongs to a re-created key */
+    if (value.repeats < entry->delivered) {
+        entry->delivered = 0;
+    }
+    
+    if (value.repeats == entry->delivered) {
+        if (ctx->reap && kill((pid_t)entry->key.pid, 0) != 0 && errno == ESRCH) {
+            bpf_map_delete_elem(map_fd, &key);
+            return true;
+        }
+        return false;
+    }
+    
+    count = value.repeats - entry->delivered > UINT32_MAX ? UINT32_MAX :
+            (uint32_t)(value.repeats - entry->delivered);
+    entry->delivered = value.repeats;
+    
+    /* The repeats already include any sampling weight */
+    header->timestamp_ns = ctx->now;
+    header->weight = 0;
+    if (header->event_type == CT_EVENT_FILE_OPEN) {
+        ((struct ct_file_open_event *)entry->record)->count = count;
+    } else {
+        ((struct ct_lib_load_event *)entry->record)->count = count;
+    }
+    deliver_record(ctx->mgr, entry->record, entry->size);
+    
+    return false;
+}
+
+/**
+ * Deliver every coalesced count not reported yet
+ * Keys of processes that have exited are forgotten once reported. Runs
+ * once per window from ebpf_manager_poll_events(); call it once more
+ * after the last poll so the final partial window is not lost.
+ * 
+ * @return 0 on success, -EINVAL on invalid arguments
+ */
+int ebpf_manager_flush_coalesced(struct ebpf_manager *mgr)
+{
+    coalesce_report_ctx_t ctx;
+    
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    if (!mgr->coalesce_table || !mgr->batch_ctx) {
+        return 0;
+    }
+    
+    ctx.mgr = mgr;
+    ctx.now = timestamp_boot_ns();
+    ctx.reap = true;
+    coalesce_table_for_each(mgr->coalesce_table, report_coalesced, &ctx);
+    mgr->coalesce_flushed_ns = ctx.now;
+    
+    return 0;
+}
+
+/**
+ * Ring buffer callback handler
+ */
+static int handle_event(void *ctx, void *data, size_t data_sz)
+{
+    struct ring_source_ctx *source_ctx = ctx;
+    struct ebpf_manager *mgr = source_ctx->mgr;
+    struct event_batch_ctx *batch_ctx;
+    const struct ct_event_header *header = data;
+    int ret = 0;
+    
+    if (!mgr || !mgr->batch_ctx || !data || data_sz < sizeof(struct ct_event_header)) {
+        return -1;
+    }
+    
+    batch_ctx = mgr->batch_ctx;
+    
+    if (mgr->raw_writer &&
+        raw_writer_write_record(mgr->raw_writer, (uint8_t)source_ctx->source, data, data_sz) != 0) {
+        log_warn_ratelimited("Failed to record raw event");
+    }
+    
+    /* Update statistics */
+    mgr->events_processed++;
+    mgr->source_stats[source_ctx->source].events_received++;
+    batch_ctx->events_in_batch++;
+    note_new_libraries(mgr, header);
+    
+    if (mgr->coalesce_table) {
+        if (header->event_type == CT_EVENT_PROCESS_EXIT) {
+            /* Report the process's counts ahead of its exit */
+            coalesce_report_ctx_t report = { mgr, timestamp_boot_ns(), false };
+            coalesce_table_for_each_pid(mgr->coalesce_table, header->pid,
+                                        report_coalesced, &report);
+        } else {
+            track_coalesced_record(mgr, data, data_sz);
+        }
+    }
+    
+    ret = deliver_record(mgr, data, data_sz);
+    
+    /* Leave the rest queued once the budget is spent */
+    if (ret == 0 && batch_ctx->events_in_batch >= mgr->poll_config.budget) {
+        return DRAIN_BUDGET_EXHAUSTED;
+    }
+    
+    return ret;
+}
+
+/**
+ * Get the ring buffer map FD of a loaded event source
+ * Returns -1 if the source's program is not loaded
+ */
+static int source_ring_buffer_fd(struct ebpf_manager *mgr, ebpf_source_t source)
+{
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN:
+            return mgr->file_open_skel ? bpf_map__fd(mgr->file_open_skel->maps.events) : -1;
+        case EBPF_SOURCE_LIB_LOAD:
+            return mgr->lib_load_skel ? bpf_map__fd(mgr->lib_load_skel->maps.events) : -1;
+        case EBPF_SOURCE_PROCESS_EXEC:
+            return mgr->process_exec_skel ? bpf_map__fd(mgr->process_exec_skel->maps.events) : -1;
+        case EBPF_SOURCE_PROCESS_EXIT:
+            return mgr->process_exit_skel ? bpf_map__fd(mgr->process_exit_skel->maps.events) : -1;
+        case EBPF_SOURCE_OPENSSL_API:
+            return mgr->openssl_api_skel ? bpf_map__fd(mgr->openssl_api_skel->maps.events) : -1;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Get the per-CPU stats map FD of a loaded event source
+ * Returns -1 if the source's program is not loaded
+ */
+static int source_stats_map_fd(struct ebpf_manager *mgr, ebpf_source_t source)
+{
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN:
+            return mgr->file_open_skel ? bpf_map__fd(mgr->file_open_skel->maps.stats) : -1;
+        case EBPF_SOURCE_LIB_LOAD:
+            return mgr->lib_load_skel ? bpf_map__fd(mgr->lib_load_skel->maps.stats) : -1;
+        case EBPF_SOURCE_PROCESS_EXEC:
+            return mgr->process_exec_skel ? bpf_map__fd(mgr->process_exec_skel->maps.stats) : -1;
+        case EBPF_SOURCE_PROCESS_EXIT:
+            return mgr->process_exit_skel ? bpf_map__fd(mgr->process_exit_skel->maps.stats) : -1;
+        case EBPF_SOURCE_OPENSSL_API:
+            return mgr->openssl_api_skel ? bpf_map__fd(mgr->openssl_api_skel->maps.stats) : -1;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Setup ring buffer for event collection
+ * Registers the ring buffer of every loaded program on a single
+ * ring_buffer manager, so one poll drains all event sources
+ */
+static int setup_ring_buffer(struct ebpf_manager *mgr, event_callback_t callback, void *ctx)
+{
+    int ring_buffer_fd;
+    int source;
+    int registered = 0;
+    
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    /* Allocate batch context */
+    mgr->batch_ctx = calloc(1, sizeof(*mgr->batch_ctx));
+    if (!mgr->batch_ctx) {
+        log_error("Failed to allocate batch context");
+        return -1;
+    }
+    
+    mgr->batch_ctx->mgr = mgr;
+    mgr->batch_ctx->callback = callback;
+    mgr->batch_ctx->user_ctx = ctx;
+    mgr->batch_ctx->events_in_batch = 0;
+    
+    for (source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        ring_buffer_fd = source_ring_buffer_fd(mgr, (ebpf_source_t)source);
+        if (ring_buffer_fd < 0) {
+            continue;
+        }
+        
+        mgr->ring_sources[source].mgr = mgr;
+        mgr->ring_sources[source].source = (ebpf_source_t)source;
+        
+        if (!mgr->rb) {
+            /* Create ring buffer manager with the first available source */
+            mgr->rb = ring_buffer__new(ring_buffer_fd, handle_event,
+                                       &mgr->ring_sources[source], NULL);
+            if (!mgr->rb) {
+                log_warn("Failed to create ring buffer for %s (FD %d)",
+                         ebpf_source_name((ebpf_source_t)source), ring_buffer_fd);
+                continue;
+            }
+        } else if (ring_buffer__add(mgr->rb, ring_buffer_fd, handle_event,
+                                    &mgr->ring_sources[source]) != 0) {
+            log_warn("Failed to add %s ring buffer (FD %d)",
+                     ebpf_source_name((ebpf_source_t)source), ring_buffer_fd);
+            continue;
+        }
+        
+        mgr->ring_sources[source].ring_index = (unsigned int)registered;
+        mgr->source_stats[source].attached = true;
+        registered++;
+        log_debug("Ring buffer for %s registered (FD: %d)",
+                  ebpf_source_name((ebpf_source_t)source), ring_buffer_fd);
+    }
+    
+    if (registered == 0) {
+        log_error("Failed to get ring buffer FD");
+        if (mgr->rb) {
+            ring_buffer__free(mgr->rb);
+            mgr->rb = NULL;
+        }
+        free(mgr->batch_ctx);
+        mgr->batch_ctx = NULL;
+        return -1;
+    }
+    
+    log_debug("Ring buffer created successfully (%d source(s))", registered);
+    
+    return 0;
+}
+
+/**
+ * Note how much data waits in each ring buffer ahead of a drain
+ * Needs libbpf 1.3 for ring access; with older versions the fill level
+ * stays unknown (0).
+ */
+static void sample_ring_fill(struct ebpf_manager *mgr)
+{
+#if LIBBPF_MAJOR_VERSION > 1 || (LIBBPF_MAJOR_VERSION == 1 && LIBBPF_MINOR_VERSION >= 3)
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        ebpf_source_stats_t *stats = &mgr->source_stats[source];
+        struct ring *ring;
+        
+        if (!stats->attached) {
+            continue;
+        }
+        ring = ring_buffer__ring(mgr->rb, mgr->ring_sources[source].ring_index);
+        if (!ring) {
+            continue;
+        }
+        
+        stats->ringbuf_size = ring__size(ring);
+        stats->ringbuf_pending = ring__avail_data_size(ring);
+        if (stats->ringbuf_pending > stats->ringbuf_pending_max) {
+            stats->ringbuf_pending_max = stats->ringbuf_pending;
+        }
+    }
+#else
+    (void)mgr;
+#endif
+}
+
+/**
+ * Bytes still to be consumed in a ring buffer's rings: those between
+ * each ring's consumer and producer positions
+ * @return The byte count, or -1 when libbpf is too old to tell (< 1.3)
+ */
+static int64_t ring_buffer_pending(struct ring_buffer *rb)
+{
+#if LIBBPF_MAJOR_VERSION > 1 || (LIBBPF_MAJOR_VERSION == 1 && LIBBPF_MINOR_VERSION >= 3)
+    struct ring *ring;
+    int64_t pending = 0;
+    
+    for (unsigned int i = 0; (ring = ring_buffer__ring(rb, i)) != NULL; i++) {
+        pending += (int64_t)ring__avail_data_size(ring);
+    }
+    return pending;
+#else
+    (void)rb;
+    return -1;
+#endif
+}
+
+/**
+ * Wait until a ring buffer signals data or the timeout expires
+ */
+static void wait_for_records(struct ring_buffer *rb, int timeout_ms)
+{
+    struct epoll_event event;
+    
+    if (epoll_wait(ring_buffer__epoll_fd(rb), &event, 1, timeout_ms) < 0 && errno != EINTR) {
+        log_debug("epoll_wait failed: %s", strerror(errno));
+    }
+}
+
+/**
+ * Set the drain budget, idle timeout and batch completion hook
+ * 
+ * @param mgr eBPF manager
+ * @param config Drain policy (zero fields keep the defaults)
+ * @return 0 on success, -EINVAL on invalid arguments
+ */
+int ebpf_manager_set_poll_config(struct ebpf_manager *mgr, const ebpf_poll_config_t *config)
+{
+    if (!mgr || !config || config->idle_timeout_ms < 0) {
+        return -EINVAL;
+    }
+    
+    mgr->poll_config = *config;
+    if (mgr->poll_config.budget == 0) {
+        mgr->poll_config.budget = DEFAULT_DRAIN_BUDGET;
+    }
+    if (mgr->poll_config.idle_timeout_ms == 0) {
+        mgr->poll_config.idle_timeout_ms = DEFAULT_IDLE_TIMEOUT_MS;
+    }
+    
+    return 0;
+}
+
+/**
+ * Hand decoded events to a consumer thread instead of calling the poll
+ * callback on the polling thread
+ * Each event is copied out of the ring buffer and pushed to queue; the
+ * consumer must pass it to ebpf_manager_complete_event() when done. A
+ * full queue drops the event and counts it in events_dropped.
+ * 
+ * @param queue Queue to push to, or NULL to dispatch in place again
+ * @return 0 on success, negative error code on failure
+ */
+int ebpf_manager_set_event_queue(struct ebpf_manager *mgr, spsc_queue_t *queue)
+{
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    mgr->event_queue = queue;
+    
+    return 0;
+}
+
+/**
+ * Record every ring buffer record, as received, to a raw capture
+ * The writer must outlive the polls; pass NULL before closing it.
+ * 
+ * @return 0 on success, -EINVAL on invalid arguments
+ */
+int ebpf_manager_set_raw_writer(struct ebpf_manager *mgr, raw_writer_t *writer)
+{
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    mgr->raw_writer = writer;
+    
+    return 0;
+}
+
+/* Close the replayed batch as a drain would */
+static void end_replay_batch(struct ebpf_manager *mgr)
+{
+    if (mgr->batch_ctx->events_in_batch == 0) {
+        return;
+    }
+    
+    mgr->batches++;
+    if (mgr->poll_config.on_batch) {
+        mgr->poll_config.on_batch(mgr->batch_ctx->events_in_batch, mgr->poll_config.batch_ctx);
+    }
+    mgr->batch_ctx->events_in_batch = 0;
+}
+
+/**
+ * Feed a raw capture through the ring buffer callback path
+ * Needs no loaded programs: records go through handle_event() as if
+ * drained from the ring buffers, one budget per batch, and on_batch runs
+ * after each batch. Kernel-side counters and coalescing are not replayed
+ * and dispatch latency is not recorded.
+ * 
+ * @return Number of records replayed, or a negative error code
+ */
+int ebpf_manager_replay(struct ebpf_manager *mgr, raw_reader_t *reader,
+                        event_callback_t callback, void *ctx)
+{
+    const void *data;
+    uint64_t cpu_start;
+    uint64_t replayed = 0;
+    uint8_t source;
+    size_t size;
+    int status;
+    int ret = 0;
+    
+    if (!mgr || !reader || mgr->rb) {
+        return -EINVAL;
+    }
+    
+    if (!mgr->batch_ctx) {
+        mgr->batch_ctx = calloc(1, sizeof(*mgr->batch_ctx));
+        if (!mgr->batch_ctx) {
+            return -ENOMEM;
+        }
+    }
+    mgr->batch_ctx->mgr = mgr;
+    mgr->batch_ctx->callback = callback;
+    mgr->batch_ctx->user_ctx = ctx;
+    mgr->batch_ctx->events_in_batch = 0;
+    
+    for (int i = 0; i < EBPF_SOURCE_COUNT; i++) {
+        mgr->ring_sources[i].mgr = mgr;
+        mgr->ring_sources[i].source = (ebpf_source_t)i;
+    }
+    
+    mgr->replaying = true;
+    cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    
+    while ((status = raw_reader_next(reader, &source, &data, &size)) > 0) {
+        if (source >= EBPF_SOURCE_COUNT) {
+            continue;
+        }
+        mgr->source_stats[source].attached = true;
+        
+        /* The callback may keep the record's strings; the mapping is
+         * read-only and lives as long as the reader */
+        ret = handle_event(&mgr->ring_sources[source], (void *)data, size);
+        replayed++;
+        
+        if (ret < 0) {
+            end_replay_batch(mgr);
+            if (ret != DRAIN_BUDGET_EXHAUSTED) {
+                break;
+            }
+        }
+    }
+    
+    end_replay_batch(mgr);
+    mgr->consumer_cpu_ns += clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    
+    if (status < 0) {
+        return -EINVAL;
+    }
+    if (ret < 0 && ret != DRAIN_BUDGET_EXHAUSTED) {
+        return ret;
+    }
+    
+    return replayed > INT32_MAX ? INT32_MAX : (int)replayed;
+}
+
+/**
+ * Receive events from a running "crypto-tracer daemon" instead of loading
+ * programs
+ * Must be called before ebpf_manager_load_programs(). Loading then does
+ * nothing, attaching connects and sends the sources and process filter
+ * (ebpf_manager_set_sources(), ebpf_manager_set_process_filter()), and
+ * ebpf_manager_poll_events() dispatches the events the daemon sends.
+ * Ring buffer, coalescing and rate limit settings are the daemon's.
+ * 
+ * @return 0 on success, -EINVAL on invalid arguments, -1 if already loaded
+ */
+int ebpf_manager_use_daemon(struct ebpf_manager *mgr, const char *socket_path)
+{
+    if (!mgr || !socket_path) {
+        return -EINVAL;
+    }
+    
+    if (mgr->programs_loaded) {
+        log_warn("The daemon must be chosen before programs are loaded");
+        return -1;
+    }
+    
+    free(mgr->daemon_path);
+    mgr->daemon_path = strdup(socket_path);
+    
+    return mgr->daemon_path ? 0 : -ENOMEM;
+}
+
+/**
+ * Copy an event decoded from the daemon's stream into a pool event
+ */
+static void copy_daemon_event(processed_event_t *event, const processed_event_t *decoded)
+{
+    processed_event_set_kind(event, processed_event_kind(decoded));
+    event->timestamp_ns = decoded->timestamp_ns;
+    event->pid = decoded->pid;
+    event->uid = decoded->uid;
+    event->cgroup_id = decoded->cgroup_id;
+    event->count = decoded->count;
+    event->exit_code = decoded->exit_code;
+    event->tid = decoded->tid;
+    event->file_type = decoded->file_type;
+    event->result = decoded->result;
+    event->inode = decoded->inode;
+    event->dev = decoded->dev;
+    
+#define COPY_DAEMON_STRING(field, bit) \
+    do { \
+        if (decoded->field) { \
+            processed_event_store_string(event, (bit), decoded->field, strlen(decoded->field)); \
+        } \
+    } while (0)
+    
+    COPY_DAEMON_STRING(process, EVENT_OWNS_PROCESS);
+    COPY_DAEMON_STRING(exe, EVENT_OWNS_EXE);
+    COPY_DAEMON_STRING(cmdline, EVENT_OWNS_CMDLINE);
+    COPY_DAEMON_STRING(file, EVENT_OWNS_FILE);
+    COPY_DAEMON_STRING(library, EVENT_OWNS_LIBRARY);
+    COPY_DAEMON_STRING(library_name, EVENT_OWNS_LIBRARY_NAME);
+    COPY_DAEMON_STRING(function_name, EVENT_OWNS_FUNCTION_NAME);
+    COPY_DAEMON_STRING(flags, EVENT_OWNS_FLAGS);
+    
+#undef COPY_DAEMON_STRING
+}
+
+/**
+ * Reader thread of a daemon client: decode the daemon's stream into
+ * pool events for the polling thread
+ * When the pool runs dry it waits for the polling thread rather than
+ * dropping: the daemon disconnects a client that falls too far behind.
+ */
+static void *daemon_reader_main(void *arg)
+{
+    struct ebpf_manager *mgr = arg;
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 1000000 };
+    binary_decoder_t *decoder = NULL;
+    processed_event_t decoded;
+    processed_event_t *event;
+    FILE *stream = NULL;
+    sigset_t mask;
+    int status = 0;
+    int fd;
+    
+    /* Leave SIGINT/SIGTERM to the polling thread */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    /* A copy: the socket itself is shut down to stop this thread */
+    fd = dup(mgr->daemon_fd);
+    if (fd >= 0) {
+        stream = fdopen(fd, "r");
+        if (!stream) {
+            close(fd);
+        }
+    }
+    if (stream) {
+        decoder = binary_decoder_create(stream);
+    }
+    
+    while (decoder && (status = binary_decoder_next(decoder, &decoded)) > 0) {
+        while (!(event = event_buffer_pool_acquire(mgr->event_pool)) &&
+               !__atomic_load_n(&mgr->daemon_stopping, __ATOMIC_ACQUIRE)) {
+            nanosleep(&pause, NULL);
+        }
+        if (!event) {
+            break;
+        }
+        
+        copy_daemon_event(event, &decoded);
+        
+        /* Holds every pool event, so this only fails on a bug */
+        if (!spsc_queue_push(mgr->daemon_queue, event)) {
+            event_buffer_pool_release(mgr->event_pool, event);
+        }
+    }
+    
+    if (status < 0 && !__atomic_load_n(&mgr->daemon_stopping, __ATOMIC_ACQUIRE)) {
+        log_warn("Malformed event stream from crypto-tracer daemon");
+    }
+    
+    binary_decoder_destroy(decoder);
+    if (stream) {
+        fclose(stream);
+    }
+    
+    __atomic_store_n(&mgr->daemon_closed, true, __ATOMIC_RELEASE);
+    spsc_queue_wake(mgr->daemon_queue);
+    return NULL;
+}
+
+/**
+ * Connect to the daemon and start receiving its events
+ */
+static int attach_daemon(struct ebpf_manager *mgr)
+{
+    uint64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    
+    mgr->daemon_request.sources = mgr->sources;
+    mgr->daemon_fd = daemon_connect(mgr->daemon_path, &mgr->daemon_request);
+    if (mgr->daemon_fd < 0) {
+        return -1;
+    }
+    
+    mgr->daemon_queue = spsc_queue_create(EBPF_EVENT_POOL_CAPACITY);
+    if (!mgr->daemon_queue ||
+        pthread_create(&mgr->daemon_reader, NULL, daemon_reader_main, mgr) != 0) {
+        log_error("Failed to start daemon reader");
+        stop_daemon_client(mgr);
+        return -1;
+    }
+    mgr->daemon_reading = true;
+    mgr->programs_attached = true;
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        mgr->source_stats[source].attached = (mgr->sources & EBPF_SOURCE_BIT(source)) != 0;
+    }
+    
+    log_info("Receiving events from crypto-tracer daemon at %s (connected in %.1f ms)",
+             mgr->daemon_path, (clock_ns(CLOCK_MONOTONIC) - start_ns) / 1e6);
+    return 0;
+}
+
+/**
+ * Disconnect from the daemon and drop the events not yet dispatched
+ */
+static void stop_daemon_client(struct ebpf_manager *mgr)
+{
+    processed_event_t *event;
+    
+    if (mgr->daemon_fd < 0) {
+        return;
+    }
+    
+    __atomic_store_n(&mgr->daemon_stopping, true, __ATOMIC_RELEASE);
+    shutdown(mgr->daemon_fd, SHUT_RDWR);
+    if (mgr->daemon_reading) {
+        pthread_join(mgr->daemon_reader, NULL);
+        mgr->daemon_reading = false;
+    }
+    close(mgr->daemon_fd);
+    mgr->daemon_fd = -1;
+    
+    if (mgr->daemon_queue) {
+        while ((event = spsc_queue_pop(mgr->daemon_queue)) != NULL) {
+            event_buffer_pool_release(mgr->event_pool, event);
+        }
+        spsc_queue_destroy(mgr->daemon_queue);
+        mgr->daemon_queue = NULL;
+    }
+}
+
+/**
+ * ebpf_manager_poll_events() of a daemon client
+ * Dispatches up to one budget of the events the reader thread decoded,
+ * in place or through the event queue like drained records.
+ * 
+ * @return Number of events dispatched, or -ECONNRESET once the daemon
+ *         has closed the connection and every event was dispatched
+ */
+static int poll_daemon(struct ebpf_manager *mgr, event_callback_t callback, void *ctx)
+{
+    processed_event_t *event;
+    uint32_t drained = 0;
+    uint64_t cpu_start;
+    
+    if (spsc_queue_size(mgr->daemon_queue) == 0 &&
+        !__atomic_load_n(&mgr->daemon_closed, __ATOMIC_ACQUIRE)) {
+        spsc_queue_wait(mgr->daemon_queue, mgr->poll_config.idle_timeout_ms);
+    }
+    
+    cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    while (drained < mgr->poll_config.budget &&
+           (event = spsc_queue_pop(mgr->daemon_queue)) != NULL) {
+        drained++;
+        mgr->events_processed++;
+        
+        if (mgr->event_queue) {
+            if (!spsc_queue_push(mgr->event_queue, event)) {
+                mgr->events_dropped++;
+                event_buffer_pool_release(mgr->event_pool, event);
+            }
+        } else {
+            if (callback) {
+                callback(event, ctx);
+            }
+            ebpf_manager_complete_event(mgr, event);
+        }
+    }
+    
+    if (drained > 0) {
+        mgr->batches++;
+        if (mgr->poll_config.on_batch) {
+            mgr->poll_config.on_batch(drained, mgr->poll_config.batch_ctx);
+        }
+    } else if (__atomic_load_n(&mgr->daemon_closed, __ATOMIC_ACQUIRE)) {
+        log_error("crypto-tracer daemon closed the connection");
+        return -ECONNRESET;
+    }
+    mgr->consumer_cpu_ns += clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    
+    return (int)drained;
+}
+
+/**
+ * Drain up to one budget of records from all ring buffers
+ * While idle this sleeps up to the idle timeout waiting for data; after
+ * a poll that exhausted the budget it drains again without waiting.
+ * 
+ * @return Number of records drained, or a negative error code
+ */
+int ebpf_manager_poll_events(struct ebpf_manager *mgr, event_callback_t callback, void *ctx)
+{
+    uint64_t drain_begin;
+    uint64_t cpu_start;
+    uint32_t drained;
+    int err;
+    
+    if (!mgr) {
+        return -EINVAL;
+    }
+    
+    /* Sharded rings are drained by ebpf_manager_poll_consumer() */
+    if (mgr->consumers) {
+        return -EINVAL;
+    }
+    
+    if (mgr->daemon_path) {
+        return poll_daemon(mgr, callback, ctx);
+    }
+    
+    /* Setup ring buffer on first poll */
+    if (!mgr->rb) {
+        err = setup_ring_buffer(mgr, callback, ctx);
+        if (err) {
+            return err;
+        }
+    }
+    
+    if (!mgr->drain_busy) {
+        wait_for_records(mgr->rb, mgr->poll_config.idle_timeout_ms);
+    }
+    
+    /* Records written with BPF_RB_NO_WAKEUP never signal epoll, so the
+     * rings are drained after every wait, timed out or not */
+    sample_ring_fill(mgr);
+    cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    drain_begin = stage_begin();
+    mgr->batch_ctx->events_in_batch = 0;
+    err = ring_buffer__consume(mgr->rb);
+    drained = mgr->batch_ctx->events_in_batch;
+    if (drained > 0) {
+        stage_end(STAGE_DRAIN, drain_begin);
+    }
+    
+    mgr->drain_busy = (err == DRAIN_BUDGET_EXHAUSTED);
+    if (mgr->drain_busy) {
+        mgr->busy_polls++;
+    } else if (err < 0 && err != -EINTR) {
+        log_error("Error consuming ring buffer: %d", err);
+        return err;
+    }
+    
+    if (drained > 0) {
+        mgr->batches++;
+        if (mgr->poll_config.on_batch) {
+            mgr->poll_config.on_batch(drained, mgr->poll_config.batch_ctx);
+        }
+    }
+    mgr->consumer_cpu_ns += clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    
+    /* Attach to the libraries of processes that exec'd or dlopen'd */
+    if (mgr->uprobes) {
+        uprobe_attacher_process_pending(mgr->uprobes, clock_ns(CLOCK_MONOTONIC));
+    }
+    
+    /* Report coalesced repeats once per window */
+    if (mgr->coalesce_table &&
+        timestamp_boot_ns() - mgr->coalesce_flushed_ns >= mgr->coalesce_window_ns) {
+        ebpf_manager_flush_coalesced(mgr);
+    }
+    
+    /* Log dropped events if any */
+    if (mgr->events_dropped > 0) {
+        static uint64_t last_drop_count = 0;
+        if (mgr->events_dropped != last_drop_count) {
+            log_warn_ratelimited("%lu events dropped due to backpressure",
+                     mgr->events_dropped - last_drop_count);
+            last_drop_count = mgr->events_dropped;
+        }
+    }
+    
+    return (int)drained;
+}
+
+/**
+ * Source whose program submits records of an event type, or -1
+ */
+static int event_type_source(uint32_t event_type)
+{
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        if (source_event_types[source] == event_type) {
+            return source;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Ring buffer callback of a sharded layout consumer
+ * Shard rings carry every program's records, so the source is told by
+ * the event type. Records are always decoded from a copy, so the
+ * callback may keep the event by returning EBPF_EVENT_RETAINED.
+ */
+static int handle_shard_event(void *ctx, void *data, size_t data_sz)
+{
+    struct ring_consumer *consumer = ctx;
+    const struct ct_event_header *header = data;
+    processed_event_t *proc_event;
+    uint64_t timestamp_ns;
+    int source;
+    int ret = 0;
+    
+    if (!data || data_sz < sizeof(struct ct_event_header)) {
+        return -1;
+    }
+    
+    counter_add(&consumer->events_processed, 1);
+    source = event_type_source(header->event_type);
+    if (source >= 0) {
+        counter_add(&consumer->events_received[source], 1);
+    }
+    consumer->events_in_batch++;
+    note_new_libraries(consumer->mgr, header);
+    
+    proc_event = event_buffer_pool_acquire(consumer->pool);
+    if (!proc_event) {
+        counter_add(&consumer->events_dropped, 1);
+    } else if (decode_record_copy(proc_event, data, data_sz) != 0) {
+        event_buffer_pool_release(consumer->pool, proc_event);
+    } else {
+        /* A retained event may be gone once the callback returns */
+        timestamp_ns = proc_event->timestamp_ns;
+        ret = consumer->callback ? consumer->callback(proc_event, consumer->user_ctx) : 0;
+        record_latency(consumer->latency_hist, &consumer->latency_max_ns, timestamp_ns);
+        if (ret == EBPF_EVENT_RETAINED) {
+            ret = 0;
+        } else {
+            event_buffer_pool_release(consumer->pool, proc_event);
+        }
+    }
+    
+    if (ret == 0 && consumer->events_in_batch >= consumer->mgr->poll_config.budget) {
+        return DRAIN_BUDGET_EXHAUSTED;
+    }
+    
+    return ret;
+}
+
+/**
+ * Register one more ring on a consumer's ring_buffer manager
+ */
+static int add_consumer_ring(struct ring_consumer *consumer, int ring_fd)
+{
+    if (!consumer->rb) {
+        consumer->rb = ring_buffer__new(ring_fd, handle_shard_event, consumer, NULL);
+        return consumer->rb ? 0 : -1;
+    }
+    
+    return ring_buffer__add(consumer->rb, ring_fd, handle_shard_event, consumer);
+}
+
+/**
+ * Set up a consumer on the thread that polls it
+ * Registers the shard rings of its node and, on consumer 0, the program
+ * rings that catch CPUs without a shard
+ */
+static int setup_consumer(struct ring_consumer *consumer, event_callback_t callback, void *ctx)
+{
+    struct ebpf_manager *mgr = consumer->mgr;
+    event_buffer_pool_t *pool;
+    int ring_fd;
+    
+    consumer->callback = callback;
+    consumer->user_ctx = ctx;
+    
+    pool = event_buffer_pool_create(EBPF_EVENT_POOL_CAPACITY);
+    if (!pool) {
+        log_error("Failed to create event buffer pool for consumer %u", consumer->index);
+        return -ENOMEM;
+    }
+    __atomic_store_n(&consumer->pool, pool, __ATOMIC_RELEASE);
+    
+    for (unsigned int shard = 0; shard < mgr->shard_count; shard++) {
+        if (mgr->shard_consumer[shard] == consumer->index &&
+            add_consumer_ring(consumer, mgr->shard_fds[shard]) != 0) {
+            log_warn("Failed to add ring buffer shard %u to consumer %u", shard, consumer->index);
+        }
+    }
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT && consumer->index == 0; source++) {
+        ring_fd = source_ring_buffer_fd(mgr, (ebpf_source_t)source);
+        if (ring_fd >= 0 && add_consumer_ring(consumer, ring_fd) != 0) {
+            log_warn("Failed to add %s ring buffer to consumer 0",
+                     ebpf_source_name((ebpf_source_t)source));
+        }
+    }
+    
+    if (!consumer->rb) {
+        log_error("Consumer %u has no ring buffer to drain", consumer->index);
+        __atomic_store_n(&consumer->pool, NULL, __ATOMIC_RELEASE);
+        event_buffer_pool_destroy(pool);
+        return -1;
+    }
+    
+    return 0;
+}
+
+/**
+ * Number of consumers of the sharded ring layout: one per NUMA node, or
+ * 0 when the programs use one ring each (see ebpf_manager_set_ring_layout)
+ */
+unsigned int ebpf_manager_consumer_count(struct ebpf_manager *mgr)
+{
+    return mgr ? mgr->consumer_count : 0;
+}
+
+/**
+ * Pin the calling thread to the CPUs of a consumer's NUMA node
+ * Call on the thread that polls the consumer before its first poll, so
+ * its event pool is allocated on the node.
+ * 
+ * @return 0 on success, negative error code on failure
+ */
+int ebpf_manager_bind_consumer(struct ebpf_manager *mgr, unsigned int consumer)
+{
+    int err;
+    
+    if (!mgr || consumer >= mgr->consumer_count) {
+        return -EINVAL;
+    }
+    
+    err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &mgr->consumers[consumer].cpus);
+    if (err != 0) {
+        log_warn("Failed to pin consumer %u to its node: %s", consumer, strerror(err));
+        return -err;
+    }
+    
+    return 0;
+}
+
+/**
+ * Drain up to one budget of records from a consumer's rings
+ * The sharded counterpart of ebpf_manager_poll_events(): each consumer
+ * must only be polled by one thread, and different consumers may be
+ * polled concurrently. The callback runs on the polling thread and may
+ * keep events (EBPF_EVENT_RETAINED). poll_config.on_batch is not called;
+ * the caller flushes after each poll instead.
+ * 
+ * @return Number of records drained, or a negative error code
+ */
+int ebpf_manager_poll_consumer(struct ebpf_manager *mgr, unsigned int consumer_index,
+                               event_callback_t callback, void *ctx)
+{
+    struct ring_consumer *consumer;
+    uint64_t drain_begin;
+    uint64_t drain_start_ns;
+    uint64_t cpu_start;
+    uint32_t drained;
+    int err;
+    
+    if (!mgr || consumer_index >= mgr->consumer_count) {
+        return -EINVAL;
+    }
+    consumer = &mgr->consumers[consumer_index];
+    
+    if (!consumer->rb) {
+        err = setup_consumer(consumer, callback, ctx);
+        if (err) {
+            return err;
+        }
+    }
+    
+    if (!consumer->drain_busy) {
+        wait_for_records(consumer->rb, mgr->poll_config.idle_timeout_ms);
+    }
+    
+    cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    drain_start_ns = timestamp_boot_ns();
+    drain_begin = stage_begin();
+    consumer->events_in_batch = 0;
+    err = ring_buffer__consume(consumer->rb);
+    drained = consumer->events_in_batch;
+    if (drained > 0) {
+        stage_end(STAGE_DRAIN, drain_begin);
+        counter_add(&consumer->batches, 1);
+    }
+    
+    consumer->drain_busy = (err == DRAIN_BUDGET_EXHAUSTED);
+    if (consumer->drain_busy) {
+        counter_add(&consumer->busy_polls, 1);
+    } else if (err < 0 && err != -EINTR) {
+        log_error("Error consuming ring buffer shards of consumer %u: %d", consumer_index, err);
+        return err;
+    } else {
+        /* Drained to the end: what was submitted before the drain is in */
+        consumer->watermark_ns = timestamp_from_boot_ns(drain_start_ns);
+    }
+    counter_add(&consumer->cpu_ns, clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start);
+    
+    /* One consumer at a time scans, the others move on */
+    if (mgr->uprobes) {
+        uprobe_attacher_process_pending(mgr->uprobes, clock_ns(CLOCK_MONOTONIC));
+    }
+    
+    return (int)drained;
+}
+
+/**
+ * Time up to which a consumer has drained its rings
+ * Every record its programs submitted before this time (same clock as
+ * processed_event_t.timestamp_ns) has been passed to its callback; a
+ * record is stamped a little before it is submitted, so merging callers
+ * allow some slack. Call on the thread that polls the consumer.
+ * 
+ * @return Unix time in ns, or 0 before the first complete drain
+ */
+uint64_t ebpf_manager_consumer_watermark(struct ebpf_manager *mgr, unsigned int consumer)
+{
+    if (!mgr || consumer >= mgr->consumer_count) {
+        return 0;
+    }
+    
+    return mgr->consumers[consumer].watermark_ns;
+}
+
+/**
+ * Drain rings (or the daemon queue) until they are empty or a deadline
+ * passes; consumer_index -1 drains what ebpf_manager_poll_events() polls
+ * Without ring positions (old libbpf) a poll that finds nothing ends it.
+ */
+static int drain_until_empty(struct ebpf_manager *mgr, int consumer_index,
+                             event_callback_t callback, void *ctx, uint32_t timeout_ms,
+                             struct drain_result *result)
+{
+    struct ring_consumer *consumer = consumer_index >= 0 ? &mgr->consumers[consumer_index] : NULL;
+    uint64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    uint64_t deadline_ns = start_ns + (uint64_t)timeout_ms * 1000000ULL;
+    int64_t pending;
+    int ret = 0;
+    
+    memset(result, 0, sizeof(*result));
+    
+    for (;;) {
+        if (consumer) {
+            pending = consumer->rb ? ring_buffer_pending(consumer->rb) : 0;
+        } else if (mgr->daemon_path) {
+            pending = mgr->daemon_queue ? (int64_t)spsc_queue_size(mgr->daemon_queue) : 0;
+        } else {
+            pending = mgr->rb ? ring_buffer_pending(mgr->rb) : 0;
+        }
+        if (pending == 0 || clock_ns(CLOCK_MONOTONIC) >= deadline_ns) {
+            break;
+        }
+        
+        /* Consume right away, never wait for a wakeup */
+        if (consumer) {
+            consumer->drain_busy = true;
+            ret = ebpf_manager_poll_consumer(mgr, (unsigned int)consumer_index, callback, ctx);
+        } else {
+            mgr->drain_busy = true;
+            ret = ebpf_manager_poll_events(mgr, callback, ctx);
+        }
+        if (ret < 0 && ret != -EINTR) {
+            break;
+        }
+        if (ret > 0) {
+            result->events += (uint64_t)ret;
+        } else if (pending < 0) {
+            pending = 0;
+            break;
+        }
+    }
+    
+    result->ns = clock_ns(CLOCK_MONOTONIC) - start_ns;
+    result->left_bytes = pending > 0 ? (uint64_t)pending : 0;
+    if (pending > 0) {
+        log_warn("Drain deadline of %u ms reached, %lu bytes of events left unread",
+                 timeout_ms, result->left_bytes);
+    }
+    
+    return ret < 0 && ret != -EINTR ? ret : 0;
+}
+
+/**
+ * Drain what the probes submitted, before shutdown
+ * Call after ebpf_manager_stop_events(): polls without waiting until the
+ * consumer position of every ring reaches its producer position, so the
+ * tail of the buffers is not lost, or until timeout_ms has passed. The
+ * sharded rings are drained by ebpf_manager_drain_consumer() instead.
+ * 
+ * @return Number of records drained, or a negative error code
+ */
+int ebpf_manager_drain(struct ebpf_manager *mgr, event_callback_t callback, void *ctx,
+                       uint32_t timeout_ms)
+{
+    int err;
+    
+    if (!mgr || mgr->consumers) {
+        return -EINVAL;
+    }
+    
+    err = drain_until_empty(mgr, -1, callback, ctx, timeout_ms, &mgr->drain);
+    return err < 0 ? err : (int)mgr->drain.events;
+}
+
+/**
+ * ebpf_manager_drain() for one consumer of the sharded layout
+ * Call on the thread that polls the consumer.
+ * 
+ * @return Number of records drained, or a negative error code
+ */
+int ebpf_manager_drain_consumer(struct ebpf_manager *mgr, unsigned int consumer,
+                                event_callback_t callback, void *ctx, uint32_t timeout_ms)
+{
+    int err;
+    
+    if (!mgr || consumer >= mgr->consumer_count) {
+        return -EINVAL;
+    }
+    
+    err = drain_until_empty(mgr, (int)consumer, callback, ctx, timeout_ms,
+                            &mgr->consumers[consumer].drain);
+    return err < 0 ? err : (int)mgr->consumers[consumer].drain.events;
+}
+
+static int compare_api_counts(const void *a, const void *b)
+{
+    const struct ct_api_count_key *x = &((const api_count_t *)a)->key;
+    const struct ct_api_count_key *y = &((const api_count_t *)b)->key;
+    
+    if (x->pid != y->pid) {
+        return x->pid < y->pid ? -1 : 1;
+    }
+    return x->function_id < y->function_id ? -1 : x->function_id > y->function_id;
+}
+
+/**
+ * Append entries read from api_counts, summing each key's per-CPU values
+ */
+static int append_api_counts(api_count_t **counts, size_t *len, size_t *capacity,
+                             const struct ct_api_count_key *keys, const uint64_t *values,
+                             uint32_t n, int ncpus)
+{
+    if (*len + n > *capacity) {
+        size_t new_capacity = *capacity ? *capacity : API_COUNT_BATCH;
+        while (new_capacity < *len + n) {
+            new_capacity *= 2;
+        }
+        api_count_t *grown = realloc(*counts, new_capacity * sizeof(*grown));
+        if (!grown) {
+            return -1;
+        }
+        *counts = grown;
+        *capacity = new_capacity;
+    }
+    
+    for (uint32_t i = 0; i < n; i++) {
+        api_count_t *entry = &(*counts)[(*len)++];
+        entry->key = keys[i];
+        entry->total = 0;
+        for (int cpu = 0; cpu < ncpus; cpu++) {
+            entry->total += values[(size_t)i * ncpus + cpu];
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read every entry of api_counts
+ * Uses batched lookups; kernels without batch operations on hash maps
+ * (before 5.6) are walked key by key instead.
+ */
+static int read_api_count_map(int map_fd, int ncpus, api_count_t **counts, size_t *len)
+{
+    struct ct_api_count_key keys[API_COUNT_BATCH];
+    uint64_t *values;
+    size_t capacity = 0;
+    __u32 in_batch = 0, out_batch = 0;
+    bool first = true;
+    int ret = 0;
+    
+    LIBBPF_OPTS(bpf_map_batch_opts, opts);
+    
+    *counts = NULL;
+    *len = 0;
+    
+    values = calloc((size_t)API_COUNT_BATCH * ncpus, sizeof(*values));
+    if (!values) {
+        return -1;
+    }
+    
+    for (;;) {
+        __u32 n = API_COUNT_BATCH;
+        int err = bpf_map_lookup_batch(map_fd, first ? NULL : &in_batch, &out_batch,
+                                       keys, values, &n, &opts);
+        
+        if (err && errno != ENOENT) {
+            if (first && (errno == EINVAL || errno == EOPNOTSUPP)) {
+                break;  /* No batch support: walk the keys below */
+            }
+            log_debug("api_counts batch lookup failed: %s", strerror(errno));
+            ret = -1;
+            goto out;
+        }
+        if (append_api_counts(counts, len, &capacity, keys, values, n, ncpus) != 0) {
+            ret = -1;
+            goto out;
+        }
+        if (err) {
+            goto out;  /* ENOENT: that was the last batch */
+        }
+        in_batch = out_batch;
+        first = false;
     }
     
+    for (int more = bpf_map_get_next_key(map_fd, NULL, &keys[0]) == 0; more;
+         more = bpf_map_get_next_key(map_fd, &keys[0], &keys[0]) == 0) {
+        if (bpf_map_lookup_elem(map_fd, &keys[0], values) == 0 &&
+            append_api_counts(counts, len, &capacity, keys, values, 1, ncpus) != 0) {
+            ret = -1;
+            goto out;
+        }
+    }
+    
+out:
+    free(values);
+    if (ret != 0) {
+        free(*counts);
+        *counts = NULL;
+        *len = 0;
+    }
     return ret;
 }
 
 /**
- * Setup ring buffer for event collection
+ * Deliver the API calls counted in the kernel since the last read
+ * Each (process, function) pair with new calls becomes one api_call
+ * event whose count field holds the number of calls. Entries of
+ * processes that have exited are removed from the kernel map once their
+ * final counts have been delivered.
+ * 
+ * @param mgr eBPF manager
+ * @param callback Called for each event, on the calling thread
+ * @param ctx Passed to callback
+ * @return Number of events delivered, or a negative error code
  */
-static int setup_ring_buffer(struct ebpf_manager *mgr, event_callback_t callback, void *ctx)
+int ebpf_manager_read_api_counts(struct ebpf_manager *mgr, event_callback_t callback, void *ctx)
 {
-    int ring_buffer_fd = -1;
+    api_count_t *counts;
+    size_t len, prev = 0, kept = 0;
+    uint64_t now;
+    int ncpus = libbpf_num_possible_cpus();
+    int map_fd, delivered = 0;
     
-    if (!mgr) {
+    if (!mgr || !callback) {
         return -EINVAL;
     }
     
-    /* Get ring buffer FD from one of the loaded programs
-     * All programs share the same ring buffer map */
-    if (mgr->file_open_skel) {
-        ring_buffer_fd = bpf_map__fd(mgr->file_open_skel->maps.events);
-    } else if (mgr->lib_load_skel) {
-        ring_buffer_fd = bpf_map__fd(mgr->lib_load_skel->maps.events);
-    } else if (mgr->process_exec_skel) {
-        ring_buffer_fd = bpf_map__fd(mgr->process_exec_skel->maps.events);
-    } else if (mgr->process_exit_skel) {
-        ring_buffer_fd = bpf_map__fd(mgr->process_exit_skel->maps.events);
-    } else if (mgr->openssl_api_skel) {
-        ring_buffer_fd = bpf_map__fd(mgr->openssl_api_skel->maps.events);
+    if (!mgr->aggregate_api_calls || !mgr->openssl_api_skel || ncpus <= 0) {
+        return 0;
     }
     
-    if (ring_buffer_fd < 0) {
-        log_error("Failed to get ring buffer FD");
+    map_fd = bpf_map__fd(mgr->openssl_api_skel->maps.api_counts);
+    if (read_api_count_map(map_fd, ncpus, &counts, &len) != 0) {
         return -1;
     }
     
-    log_debug("Ring buffer FD: %d", ring_buffer_fd);
+    if (len > 1) {
+        qsort(counts, len, sizeof(*counts), compare_api_counts);
+    }
+    now = timestamp_now_ns();
     
-    /* Allocate batch context */
-    mgr->batch_ctx = calloc(1, sizeof(*mgr->batch_ctx));
-    if (!mgr->batch_ctx) {
-        log_error("Failed to allocate batch context");
-        return -1;
+    /* Both snapshots are sorted: walk them together to find the deltas */
+    for (size_t i = 0; i < len; i++) {
+        api_count_t *entry = &counts[i];
+        uint64_t previous = 0;
+        
+        while (prev < mgr->api_count_len &&
+               compare_api_counts(&mgr->api_counts[prev], entry) < 0) {
+            prev++;
+        }
+        if (prev < mgr->api_count_len && compare_api_counts(&mgr->api_counts[prev], entry) == 0) {
+            previous = mgr->api_counts[prev].total;
+        }
+        
+        if (entry->total > previous && entry->key.function_id < CT_API_FUNCTION_COUNT) {
+            processed_event_t event = { 0 };
+            uint64_t calls = entry->total - previous;
+            
+            processed_event_set_kind(&event, EVENT_API_CALL);
+            event.timestamp_ns = now;
+            event.pid = entry->key.pid;
+            event.function_name = api_function_names[entry->key.function_id];
+            event.library = "libssl";
+            event.count = calls > UINT32_MAX ? UINT32_MAX : (uint32_t)calls;
+            
+            callback(&event, ctx);
+            processed_event_free_strings(&event);
+            delivered++;
+        } else if (kill((pid_t)entry->key.pid, 0) != 0 && errno == ESRCH) {
+            /* Unchanged and gone: everything it counted has been delivered */
+            bpf_map_delete_elem(map_fd, &entry->key);
+            continue;
+        }
+        
+        counts[kept++] = *entry;
     }
     
-    mgr->batch_ctx->mgr = mgr;
-    mgr->batch_ctx->callback = callback;
-    mgr->batch_ctx->user_ctx = ctx;
-    mgr->batch_ctx->events_in_batch = 0;
-    mgr->batch_ctx->max_batch_size = 100; /* Process up to 100 events per poll */
+    free(mgr->api_counts);
+    mgr->api_counts = counts;
+    mgr->api_count_len = kept;
     
-    /* Create ring buffer manager */
-    mgr->rb = ring_buffer__new(ring_buffer_fd, handle_event, mgr->batch_ctx, NULL);
-    if (!mgr->rb) {
-        log_system_error("Failed to create ring buffer");
-        free(mgr->batch_ctx);
-        mgr->batch_ctx = NULL;
-        return -1;
+    return delivered;
+}
+
+static int compare_handshake_hists(const void *a, const void *b)
+{
+    const struct ct_api_count_key *x = &((const handshake_hist_t *)a)->key;
+    const struct ct_api_count_key *y = &((const handshake_hist_t *)b)->key;
+    
+    if (x->pid != y->pid) {
+        return x->pid < y->pid ? -1 : 1;
     }
+    return x->function_id < y->function_id ? -1 : x->function_id > y->function_id;
+}
+
+/**
+ * Read every entry of handshake_latency
+ * The map is small (MAX_HANDSHAKE_KEYS) and read once per interval, so
+ * it is walked key by key.
+ */
+static int read_handshake_map(int map_fd, handshake_hist_t **hists, size_t *len)
+{
+    struct ct_api_count_key key;
+    size_t capacity = 0;
     
-    log_debug("Ring buffer created successfully");
+    *hists = NULL;
+    *len = 0;
     
+    for (int more = bpf_map_get_next_key(map_fd, NULL, &key) == 0; more;
+         more = bpf_map_get_next_key(map_fd, &key, &key) == 0) {
+        if (*len == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 64;
+            handshake_hist_t *grown = realloc(*hists, new_capacity * sizeof(*grown));
+            if (!grown) {
+                free(*hists);
+                *hists = NULL;
+                *len = 0;
+                return -1;
+            }
+            *hists = grown;
+            capacity = new_capacity;
+        }
+        if (bpf_map_lookup_elem(map_fd, &key, &(*hists)[*len].hist) == 0) {
+            (*hists)[(*len)++].key = key;
+        }
+    }
     return 0;
 }
 
 /**
- * Poll events from ring buffer with batching
- * Implements 10ms polling interval and processes up to 100 events per iteration
+ * Deliver the TLS handshakes measured in the kernel since the last read
+ * Each (process, function) pair with new handshakes or failures is passed
+ * to callback as one histogram of the interval. Entries of processes that
+ * have exited are removed from the kernel map once their final counts
+ * have been delivered.
+ * 
+ * @param mgr eBPF manager
+ * @param callback Called for each histogram, on the calling thread
+ * @param ctx Passed to callback
+ * @return Number of histograms delivered, or a negative error code
  */
-int ebpf_manager_poll_events(struct ebpf_manager *mgr, event_callback_t callback, void *ctx)
+int ebpf_manager_read_handshake_latency(struct ebpf_manager *mgr, handshake_callback_t callback,
+                                        void *ctx)
 {
-    int err;
+    handshake_hist_t *hists;
+    size_t len, prev = 0, kept = 0;
+    int map_fd, delivered = 0;
     
-    if (!mgr) {
+    if (!mgr || !callback) {
         return -EINVAL;
     }
     
-    /* Setup ring buffer on first poll */
-    if (!mgr->rb) {
-        err = setup_ring_buffer(mgr, callback, ctx);
-        if (err) {
-            return err;
-        }
+    if (!mgr->measure_handshakes || !mgr->openssl_api_skel) {
+        return 0;
     }
     
-    /* Reset batch counter */
-    if (mgr->batch_ctx) {
-        mgr->batch_ctx->events_in_batch = 0;
+    map_fd = bpf_map__fd(mgr->openssl_api_skel->maps.handshake_latency);
+    if (read_handshake_map(map_fd, &hists, &len) != 0) {
+        return -1;
     }
     
-    /* Poll ring buffer with 10ms timeout
-     * This will process up to max_batch_size events per call */
-    err = ring_buffer__poll(mgr->rb, 10);
-    if (err < 0 && err != -EINTR) {
-        log_error("Error polling ring buffer: %d", err);
-        return err;
+    if (len > 1) {
+        qsort(hists, len, sizeof(*hists), compare_handshake_hists);
     }
     
-    /* Log dropped events if any */
-    if (mgr->events_dropped > 0) {
-        static uint64_t last_drop_count = 0;
-        if (mgr->events_dropped != last_drop_count) {
-            log_warn("%lu events dropped due to backpressure",
-                     mgr->events_dropped - last_drop_count);
-            last_drop_count = mgr->events_dropped;
+    /* Both snapshots are sorted: walk them together to find the deltas */
+    for (size_t i = 0; i < len; i++) {
+        handshake_hist_t *entry = &hists[i];
+        const struct ct_handshake_hist *previous = NULL;
+        handshake_latency_t delta = { 0 };
+        bool changed;
+        
+        while (prev < mgr->handshake_hist_len &&
+               compare_handshake_hists(&mgr->handshake_hists[prev], entry) < 0) {
+            prev++;
+        }
+        if (prev < mgr->handshake_hist_len &&
+            compare_handshake_hists(&mgr->handshake_hists[prev], entry) == 0) {
+            previous = &mgr->handshake_hists[prev].hist;
         }
+        
+        /* The kernel counters only grow */
+        for (int b = 0; b < CT_LATENCY_BUCKETS; b++) {
+            delta.buckets[b] = entry->hist.buckets[b] - (previous ? previous->buckets[b] : 0);
+        }
+        delta.errors = entry->hist.errors - (previous ? previous->errors : 0);
+        delta.total_ns = entry->hist.total_ns - (previous ? previous->total_ns : 0);
+        changed = delta.errors > 0 || handshake_latency_count(&delta) > 0;
+        
+        if (changed && entry->key.function_id < CT_API_FUNCTION_COUNT) {
+            delta.pid = entry->key.pid;
+            memcpy(delta.comm, entry->hist.comm, sizeof(delta.comm));
+            delta.comm[sizeof(delta.comm) - 1] = '\0';
+            delta.function_name = api_function_names[entry->key.function_id];
+            
+            callback(&delta, ctx);
+            delivered++;
+        } else if (kill((pid_t)entry->key.pid, 0) != 0 && errno == ESRCH) {
+            /* Unchanged and gone: everything it measured has been delivered */
+            bpf_map_delete_elem(map_fd, &entry->key);
+            continue;
+        }
+        
+        hists[kept++] = *entry;
     }
     
-    return 0;
+    free(mgr->handshake_hists);
+    mgr->handshake_hists = hists;
+    mgr->handshake_hist_len = kept;
+    
+    return delivered;
 }
 
-/**
- * Cleanup timeout handler
- */
-static volatile sig_atomic_t cleanup_timeout = 0;
+/* Longest wait for the skeletons to be destroyed */
+#define TEARDOWN_TIMEOUT_MS 5000
+
+/* A skeleton to destroy on its own thread (see ebpf_manager_cleanup) */
+typedef struct {
+    ebpf_source_t source;
+    void *skel;
+} destroy_job_t;
+
+static void destroy_skeleton(ebpf_source_t source, void *skel)
+{
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN:
+            file_open_trace_bpf__destroy(skel);
+            break;
+        case EBPF_SOURCE_LIB_LOAD:
+            lib_load_trace_bpf__destroy(skel);
+            break;
+        case EBPF_SOURCE_PROCESS_EXEC:
+            process_exec_trace_bpf__destroy(skel);
+            break;
+        case EBPF_SOURCE_PROCESS_EXIT:
+            process_exit_trace_bpf__destroy(skel);
+            break;
+        case EBPF_SOURCE_OPENSSL_API:
+            openssl_api_trace_bpf__destroy(skel);
+            break;
+        default:
+            break;
+    }
+}
 
-static void cleanup_alarm_handler(int sig)
+/* The job is the thread's own: a thread given up on may outlive cleanup */
+static void *destroy_worker_main(void *arg)
 {
-    (void)sig;
-    cleanup_timeout = 1;
+    destroy_job_t job = *(destroy_job_t *)arg;
+    sigset_t mask;
+    
+    /* Leave SIGINT/SIGTERM to the main thread */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    free(arg);
+    destroy_skeleton(job.source, job.skel);
+    return NULL;
 }
 
 /**
- * Cleanup and detach all eBPF programs with timeout protection
- * Implements proper detachment order: uprobes first, then tracepoints
- * Includes 5-second timeout protection for cleanup operations
+ * Cleanup and detach all eBPF programs
+ * Uprobe links go first, then the skeletons are destroyed in parallel:
+ * detaching each one waits for an RCU grace period, so they overlap
+ * instead of adding up. Skeletons not destroyed within
+ * TEARDOWN_TIMEOUT_MS are left to their threads and the process exit.
+ * Call ebpf_manager_stop_events() and drain first to keep every event.
  */
 void ebpf_manager_cleanup(struct ebpf_manager *mgr)
 {
-    struct sigaction sa, old_sa;
+    void *skels[EBPF_SOURCE_COUNT];
+    pthread_t threads[EBPF_SOURCE_COUNT];
+    bool started[EBPF_SOURCE_COUNT] = { false };
+    struct timespec deadline;
+    uint64_t start_ns;
+    int destroyed = 0;
+    int abandoned = 0;
     
     if (!mgr) {
         return;
     }
     
-    /* Set up timeout protection (5 seconds) */
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = cleanup_alarm_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    
-    if (sigaction(SIGALRM, &sa, &old_sa) == 0) {
-        alarm(5); /* 5-second timeout */
-    }
+    start_ns = clock_ns(CLOCK_MONOTONIC);
     
-    /* Detach and destroy programs in reverse order (uprobes first, then tracepoints) */
+    /* Pins would keep the programs attached past the skeletons */
+    ebpf_manager_unpin(mgr);
+    stop_daemon_client(mgr);
     
     /* Step 1: Detach uprobes first */
-    if (mgr->openssl_api_skel && !cleanup_timeout) {
-        openssl_api_trace_bpf__destroy(mgr->openssl_api_skel);
-        mgr->openssl_api_skel = NULL;
+    for (size_t i = 0; i < mgr->uprobe_link_count; i++) {
+        bpf_link__destroy(mgr->uprobe_links[i]);
     }
+    free(mgr->uprobe_links);
+    mgr->uprobe_links = NULL;
+    mgr->uprobe_link_count = mgr->uprobe_link_capacity = 0;
+    uprobe_attacher_destroy(mgr->uprobes);
+    mgr->uprobes = NULL;
+    symbol_cache_destroy(mgr->symbols);
+    mgr->symbols = NULL;
     
-    if (mgr->lib_load_skel && !cleanup_timeout) {
-        lib_load_trace_bpf__destroy(mgr->lib_load_skel);
-        mgr->lib_load_skel = NULL;
-    }
+    /* Step 2: Destroy the skeletons concurrently */
+    skels[EBPF_SOURCE_FILE_OPEN] = mgr->file_open_skel;
+    skels[EBPF_SOURCE_LIB_LOAD] = mgr->lib_load_skel;
+    skels[EBPF_SOURCE_PROCESS_EXEC] = mgr->process_exec_skel;
+    skels[EBPF_SOURCE_PROCESS_EXIT] = mgr->process_exit_skel;
+    skels[EBPF_SOURCE_OPENSSL_API] = mgr->openssl_api_skel;
+    mgr->file_open_skel = NULL;
+    mgr->lib_load_skel = NULL;
+    mgr->process_exec_skel = NULL;
+    mgr->process_exit_skel = NULL;
+    mgr->openssl_api_skel = NULL;
     
-    /* Step 2: Detach tracepoints */
-    if (mgr->process_exit_skel && !cleanup_timeout) {
-        process_exit_trace_bpf__destroy(mgr->process_exit_skel);
-        mgr->process_exit_skel = NULL;
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        destroy_job_t *job;
+        
+        if (!skels[source]) {
+            continue;
+        }
+        job = malloc(sizeof(*job));
+        if (job) {
+            job->source = (ebpf_source_t)source;
+            job->skel = skels[source];
+            started[source] = pthread_create(&threads[source], NULL, destroy_worker_main, job) == 0;
+            if (!started[source]) {
+                free(job);
+            }
+        }
+        if (!started[source]) {
+            destroy_skeleton((ebpf_source_t)source, skels[source]);
+            destroyed++;
+        }
     }
     
-    if (mgr->process_exec_skel && !cleanup_timeout) {
-        process_exec_trace_bpf__destroy(mgr->process_exec_skel);
-        mgr->process_exec_skel = NULL;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += TEARDOWN_TIMEOUT_MS / 1000;
+    deadline.tv_nsec += (TEARDOWN_TIMEOUT_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
     }
-    
-    if (mgr->file_open_skel && !cleanup_timeout) {
-        file_open_trace_bpf__destroy(mgr->file_open_skel);
-        mgr->file_open_skel = NULL;
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        if (!started[source]) {
+            continue;
+        }
+        if (pthread_timedjoin_np(threads[source], NULL, &deadline) == 0) {
+            destroyed++;
+        } else {
+            pthread_detach(threads[source]);
+            abandoned++;
+        }
     }
     
     /* Step 3: Cleanup ring buffer */
-    if (mgr->rb && !cleanup_timeout) {
+    if (mgr->rb) {
         ring_buffer__free(mgr->rb);
         mgr->rb = NULL;
     }
     
+    /* Consumer threads must have stopped polling by now */
+    destroy_ring_shards(mgr);
+    
     /* Step 4: Free batch context */
-    if (mgr->batch_ctx && !cleanup_timeout) {
-        free(mgr->batch_ctx);
-        mgr->batch_ctx = NULL;
+    free(mgr->batch_ctx);
+    mgr->batch_ctx = NULL;
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        mgr->source_stats[source].attached = false;
     }
     
-    /* Cancel alarm and restore old handler */
-    alarm(0);
-    sigaction(SIGALRM, &old_sa, NULL);
+    /* Step 5: Release shared filter maps */
+    for (int i = 0; i < FILTER_MAP_COUNT; i++) {
+        if (mgr->filter_map_fds[i] >= 0) {
+            close(mgr->filter_map_fds[i]);
+            mgr->filter_map_fds[i] = -1;
+        }
+    }
+    mgr->follows_children = false;
+    mgr->filters_cgroups = false;
     
-    if (cleanup_timeout) {
-        log_warn("Cleanup timeout reached, some resources may not be freed");
-    } else {
-        log_debug("eBPF manager cleanup completed successfully");
+    if (destroyed > 0 || abandoned > 0) {
+        mgr->teardown_ns = clock_ns(CLOCK_MONOTONIC) - start_ns;
+    }
+    if (abandoned > 0) {
+        log_warn("Teardown timeout reached, %d eBPF program(s) still detaching", abandoned);
+    } else if (destroyed > 0) {
+        log_debug("eBPF programs detached in %.1f ms", mgr->teardown_ns / 1e6);
     }
     
     mgr->programs_loaded = false;
@@ -822,6 +3827,22 @@ void ebpf_manager_destroy(struct ebpf_manager *mgr)
         mgr->event_pool = NULL;
     }
     
+    for (unsigned int i = 0; i < mgr->consumer_count; i++) {
+        if (mgr->consumers[i].pool) {
+            event_buffer_pool_destroy(mgr->consumers[i].pool);
+        }
+    }
+    free(mgr->consumers);
+    
+    free(mgr->api_counts);
+    free(mgr->handshake_hists);
+    coalesce_table_destroy(mgr->coalesce_table);
+    free(mgr->daemon_path);
+    
+    if (mgr->bpf_stats_fd >= 0) {
+        close(mgr->bpf_stats_fd);
+    }
+    
     /* Free manager structure */
     free(mgr);
 }
@@ -831,15 +3852,420 @@ void ebpf_manager_destroy(struct ebpf_manager *mgr)
  */
 void ebpf_manager_get_stats(struct ebpf_manager *mgr, uint64_t *events_processed, uint64_t *events_dropped)
 {
+    uint64_t processed, dropped;
+    
     if (!mgr) {
         return;
     }
     
+    processed = mgr->events_processed;
+    dropped = mgr->events_dropped;
+    for (unsigned int i = 0; i < mgr->consumer_count; i++) {
+        processed += counter_read(&mgr->consumers[i].events_processed);
+        dropped += counter_read(&mgr->consumers[i].events_dropped);
+    }
+    
     if (events_processed) {
-        *events_processed = mgr->events_processed;
+        *events_processed = processed;
     }
     
     if (events_dropped) {
-        *events_dropped = mgr->events_dropped;
+        ebpf_source_stats_t stats;
+        
+        /* Records lost in the kernel to a full ring buffer plus events
+         * lost in user space to pool exhaustion */
+        *events_dropped = dropped;
+        for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+            if (ebpf_manager_get_source_stats(mgr, (ebpf_source_t)source, &stats) == 0) {
+                *events_dropped += stats.ringbuf_full;
+            }
+        }
+    }
+}
+
+/**
+ * Get the BPF object of a loaded event source, or NULL
+ */
+static struct bpf_object *source_object(struct ebpf_manager *mgr, ebpf_source_t source)
+{
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN:
+            return mgr->file_open_skel ? mgr->file_open_skel->obj : NULL;
+        case EBPF_SOURCE_LIB_LOAD:
+            return mgr->lib_load_skel ? mgr->lib_load_skel->obj : NULL;
+        case EBPF_SOURCE_PROCESS_EXEC:
+            return mgr->process_exec_skel ? mgr->process_exec_skel->obj : NULL;
+        case EBPF_SOURCE_PROCESS_EXIT:
+            return mgr->process_exit_skel ? mgr->process_exit_skel->obj : NULL;
+        case EBPF_SOURCE_OPENSSL_API:
+            return mgr->openssl_api_skel ? mgr->openssl_api_skel->obj : NULL;
+        default:
+            return NULL;
+    }
+}
+
+/* Longest bpffs pin path */
+#define PIN_PATH_MAX 512
+
+/**
+ * Skeleton of a loaded source, for its programs' links
+ */
+static struct bpf_object_skeleton *source_skeleton(struct ebpf_manager *mgr, ebpf_source_t source)
+{
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN:
+            return mgr->file_open_skel ? mgr->file_open_skel->skeleton : NULL;
+        case EBPF_SOURCE_LIB_LOAD:
+            return mgr->lib_load_skel ? mgr->lib_load_skel->skeleton : NULL;
+        case EBPF_SOURCE_PROCESS_EXEC:
+            return mgr->process_exec_skel ? mgr->process_exec_skel->skeleton : NULL;
+        case EBPF_SOURCE_PROCESS_EXIT:
+            return mgr->process_exit_skel ? mgr->process_exit_skel->skeleton : NULL;
+        case EBPF_SOURCE_OPENSSL_API:
+            return mgr->openssl_api_skel ? mgr->openssl_api_skel->skeleton : NULL;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Remove a pin directory and everything pinned in it
+ * Unlinking a pinned link detaches its program once nothing else holds it.
+ * 
+ * @return Number of pins removed
+ */
+static int remove_pin_dir(const char *path)
+{
+    char entry_path[PIN_PATH_MAX];
+    struct dirent *entry;
+    int removed = 0;
+    DIR *dir;
+    
+    dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(entry_path, sizeof(entry_path), "%s/%s", path, entry->d_name);
+        removed += unlink(entry_path) == 0;
+    }
+    closedir(dir);
+    rmdir(path);
+    
+    return removed;
+}
+
+/**
+ * Pin the attached programs, their links and their maps (ring buffers
+ * included) in bpffs, one directory per program object under dir
+ * Makes the daemon's probes visible to bpftool and other tools. Pins left
+ * by a previous run that did not unpin (a crash) are removed first, which
+ * detaches its orphaned probes. ebpf_manager_cleanup() unpins.
+ * 
+ * @return 0 on success, -1 if anything could not be pinned (logged)
+ */
+int ebpf_manager_pin(struct ebpf_manager *mgr, const char *dir)
+{
+    struct bpf_object_skeleton *skel;
+    struct bpf_prog_skeleton *prog;
+    struct bpf_object *obj;
+    char path[PIN_PATH_MAX];
+    char link_path[PIN_PATH_MAX];
+    int stale;
+    int ret = 0;
+    
+    if (!mgr || !dir || !mgr->programs_attached || mgr->daemon_path) {
+        return -EINVAL;
+    }
+    
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        log_warn("Failed to create pin directory %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    free(mgr->pin_dir);
+    mgr->pin_dir = strdup(dir);
+    if (!mgr->pin_dir) {
+        return -ENOMEM;
+    }
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        obj = source_object(mgr, (ebpf_source_t)source);
+        skel = source_skeleton(mgr, (ebpf_source_t)source);
+        snprintf(path, sizeof(path), "%s/%s", dir, ebpf_source_name((ebpf_source_t)source));
+        
+        stale = remove_pin_dir(path);
+        if (stale > 0) {
+            log_warn("Removed %d pins left behind in %s", stale, path);
+        }
+        if (!obj || !skel) {
+            continue;
+        }
+        
+        if (mkdir(path, 0700) != 0 || bpf_object__pin_maps(obj, path) != 0 ||
+            bpf_object__pin_programs(obj, path) != 0) {
+            log_warn("Failed to pin %s in %s", ebpf_source_name((ebpf_source_t)source), path);
+            ret = -1;
+            continue;
+        }
+        for (int i = 0; i < skel->prog_cnt; i++) {
+            prog = &skel->progs[i];
+            if (!prog->link || !*prog->link) {
+                continue;
+            }
+            snprintf(link_path, sizeof(link_path), "%s/link_%s", path, prog->name);
+            if (bpf_link__pin(*prog->link, link_path) != 0) {
+                log_warn("Failed to pin link of %s", prog->name);
+                ret = -1;
+            }
+        }
+    }
+    
+    log_info("Pinned programs, links and maps in %s", dir);
+    return ret;
+}
+
+/**
+ * Remove the pins made by ebpf_manager_pin()
+ */
+void ebpf_manager_unpin(struct ebpf_manager *mgr)
+{
+    char path[PIN_PATH_MAX];
+    
+    if (!mgr || !mgr->pin_dir) {
+        return;
+    }
+    
+    /* Unpinning is unlinking: the skeletons still hold the objects */
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        snprintf(path, sizeof(path), "%s/%s", mgr->pin_dir, ebpf_source_name((ebpf_source_t)source));
+        remove_pin_dir(path);
+    }
+    rmdir(mgr->pin_dir);
+    
+    free(mgr->pin_dir);
+    mgr->pin_dir = NULL;
+}
+
+/**
+ * Sum the kernel's run counters over a source's loaded programs
+ * The kernel only counts while BPF stats are enabled (kernel.bpf_stats_enabled
+ * or ebpf_manager_enable_program_stats()).
+ */
+static void read_program_stats(struct ebpf_manager *mgr, ebpf_source_t source,
+                               ebpf_source_stats_t *stats)
+{
+    struct bpf_object *obj = source_object(mgr, source);
+    struct bpf_program *prog;
+    
+    if (!obj) {
+        return;
+    }
+    
+    bpf_object__for_each_program(prog, obj) {
+        struct bpf_prog_info info;
+        __u32 info_len = sizeof(info);
+        int fd = bpf_program__fd(prog);
+        
+        memset(&info, 0, sizeof(info));
+        if (fd < 0 || bpf_obj_get_info_by_fd(fd, &info, &info_len) != 0) {
+            continue;
+        }
+        stats->prog_run_count += info.run_cnt;
+        stats->prog_run_ns += info.run_time_ns;
+    }
+}
+
+/**
+ * Turn on the kernel's BPF program run time accounting for as long as
+ * the manager exists; it costs every BPF program on the system a clock
+ * read per run
+ * 
+ * @return 0 on success, negative error code on failure
+ */
+int ebpf_manager_enable_program_stats(struct ebpf_manager *mgr)
+{
+    int fd;
+    
+    if (!mgr) {
+        return -EINVAL;
+    }
+    if (mgr->bpf_stats_fd >= 0) {
+        return 0;
+    }
+    
+    fd = bpf_enable_stats(BPF_STATS_RUN_TIME);
+    if (fd < 0) {
+        log_debug("BPF run time stats unavailable: %d", fd);
+        return fd;
+    }
+    
+    mgr->bpf_stats_fd = fd;
+    return 0;
+}
+
+/**
+ * Get statistics for a single event source
+ * Returns 0 on success, -EINVAL on invalid arguments
+ */
+int ebpf_manager_get_source_stats(struct ebpf_manager *mgr, ebpf_source_t source, ebpf_source_stats_t *stats)
+{
+    uint64_t prefiltered = 0;
+    uint64_t process_filtered = 0;
+    int map_fd;
+    
+    if (!mgr || !stats || source < 0 || source >= EBPF_SOURCE_COUNT) {
+        return -EINVAL;
+    }
+    
+    *stats = mgr->source_stats[source];
+    for (unsigned int i = 0; i < mgr->consumer_count; i++) {
+        stats->events_received += counter_read(&mgr->consumers[i].events_received[source]);
+    }
+    
+    /* Kernel-side counters live in the program's per-CPU stats map */
+    map_fd = source_stats_map_fd(mgr, source);
+    if (map_fd >= 0) {
+        read_percpu_counter(map_fd, CT_STAT_FILTERED, &prefiltered);
+        read_percpu_counter(map_fd, CT_STAT_PROCESS_FILTERED, &process_filtered);
+        read_percpu_counter(map_fd, CT_STAT_RINGBUF_FULL, &stats->ringbuf_full);
+        read_percpu_counter(map_fd, CT_STAT_COALESCED, &stats->coalesced);
+        read_percpu_counter(map_fd, CT_STAT_SAMPLED_OUT, &stats->sampled_out);
+        read_percpu_counter(map_fd, CT_STAT_RATE_LIMITED, &stats->rate_limited);
+        stats->kernel_filtered = prefiltered + process_filtered;
+    }
+    read_program_stats(mgr, source, stats);
+    
+    return 0;
+}
+
+/**
+ * Get what the final drain and the last teardown took
+ * Call once polling has stopped; teardown_ns is set by
+ * ebpf_manager_cleanup().
+ * Returns 0 on success, -EINVAL on invalid arguments
+ */
+int ebpf_manager_get_shutdown_stats(struct ebpf_manager *mgr, ebpf_shutdown_stats_t *stats)
+{
+    if (!mgr || !stats) {
+        return -EINVAL;
+    }
+    
+    stats->drain_events = mgr->drain.events;
+    stats->drain_ns = mgr->drain.ns;
+    stats->drain_left_bytes = mgr->drain.left_bytes;
+    
+    /* Consumers drain concurrently: the slowest one is the drain time */
+    for (unsigned int c = 0; c < mgr->consumer_count; c++) {
+        const struct drain_result *drain = &mgr->consumers[c].drain;
+        
+        stats->drain_events += drain->events;
+        stats->drain_left_bytes += drain->left_bytes;
+        if (drain->ns > stats->drain_ns) {
+            stats->drain_ns = drain->ns;
+        }
+    }
+    stats->teardown_ns = mgr->teardown_ns;
+    
+    return 0;
+}
+
+/**
+ * Get consumer latency and CPU cost
+ * Percentiles are reported as the upper bound of their power-of-two bucket.
+ * 
+ * @param mgr eBPF manager
+ * @param stats Output statistics
+ * @return 0 on success, -EINVAL on invalid arguments
+ */
+int ebpf_manager_get_consumer_stats(struct ebpf_manager *mgr, ebpf_consumer_stats_t *stats)
+{
+    uint64_t hist[LATENCY_BUCKETS];
+    event_pool_stats_t pool;
+    uint64_t cpu_ns;
+    uint64_t total = 0;
+    uint64_t seen = 0;
+    
+    if (!mgr || !stats) {
+        return -EINVAL;
+    }
+    
+    memset(stats, 0, sizeof(*stats));
+    
+    /* The polling thread's figures plus those of every shard consumer */
+    memcpy(hist, mgr->latency_hist, sizeof(hist));
+    stats->latency_max_ns = mgr->latency_max_ns;
+    cpu_ns = mgr->consumer_cpu_ns;
+    stats->batches = mgr->batches;
+    stats->busy_polls = mgr->busy_polls;
+    event_buffer_pool_get_stats(mgr->event_pool, &pool);
+    stats->pool_allocated = pool.allocated;
+    stats->pool_high_water = pool.high_water;
+    stats->pool_capacity = pool.capacity;
+    
+    for (unsigned int c = 0; c < mgr->consumer_count; c++) {
+        struct ring_consumer *consumer = &mgr->consumers[c];
+        uint64_t max_ns = counter_read(&consumer->latency_max_ns);
+        
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            hist[i] += counter_read(&consumer->latency_hist[i]);
+        }
+        if (max_ns > stats->latency_max_ns) {
+            stats->latency_max_ns = max_ns;
+        }
+        cpu_ns += counter_read(&consumer->cpu_ns);
+        stats->batches += counter_read(&consumer->batches);
+        stats->busy_polls += counter_read(&consumer->busy_polls);
+        event_buffer_pool_t *consumer_pool = __atomic_load_n(&consumer->pool, __ATOMIC_ACQUIRE);
+        
+        if (consumer_pool) {
+            event_buffer_pool_get_stats(consumer_pool, &pool);
+            stats->pool_allocated += pool.allocated;
+            stats->pool_high_water += pool.high_water;
+            stats->pool_capacity += pool.capacity;
+        }
+    }
+    
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        total += hist[i];
+    }
+    
+    for (int i = 0; i < LATENCY_BUCKETS && total > 0; i++) {
+        seen += hist[i];
+        if (stats->latency_p50_ns == 0 && seen * 2 >= total) {
+            stats->latency_p50_ns = 1ULL << i;
+        }
+        if (seen * 100 >= total * 99) {
+            stats->latency_p99_ns = 1ULL << i;
+            break;
+        }
+    }
+    
+    stats->events = total;
+    stats->cpu_ns_per_event = total ? cpu_ns / total : 0;
+    
+    return 0;
+}
+
+/**
+ * Get the name of an event source (the BPF program behind it)
+ */
+const char *ebpf_source_name(ebpf_source_t source)
+{
+    switch (source) {
+        case EBPF_SOURCE_FILE_OPEN:
+            return "file_open_trace";
+        case EBPF_SOURCE_LIB_LOAD:
+            return "lib_load_trace";
+        case EBPF_SOURCE_PROCESS_EXEC:
+            return "process_exec_trace";
+        case EBPF_SOURCE_PROCESS_EXIT:
+            return "process_exit_trace";
+        case EBPF_SOURCE_OPENSSL_API:
+            return "openssl_api_trace";
+        default:
+            return "unknown";
     }
 }
@@ -5,28 +5,196 @@
 
 /**
  * event_buffer.c - Event buffer pool implementation
- * Pre-allocated event buffer pool to avoid malloc in hot path
+ * Slab-allocated event pool with per-thread free lists, to avoid malloc
+ * and lock traffic in the hot path
+ * Events borrow their strings by default; see processed_event_t.owned
+ *
+ * A thread's cache belongs to one pool at a time. Switching pools hands
+ * the cache back through the registry of live pools, so the events of a
+ * pool that was destroyed meanwhile are never touched.
  */
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include "include/crypto_tracer.h"
+#include "include/string_arena.h"
 #include "include/logger.h"
 
 /* Default buffer pool capacity */
 #define DEFAULT_POOL_CAPACITY 1000
 
+/* Chunk size of an event's overflow arena */
+#define EVENT_OVERFLOW_CHUNK 1024
+
+struct event_slab {
+    struct event_slab *next;
+    size_t count;
+    processed_event_t events[];
+};
+
+/* Free events this thread holds for one pool */
+typedef struct {
+    uint64_t pool_id;              /* 0 = none */
+    processed_event_t *head;
+    size_t count;
+} event_cache_t;
+
+static _Thread_local event_cache_t thread_cache;
+
+/* Returns a thread's cache to its pool when the thread exits */
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+/* Live pools, by id */
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static event_buffer_pool_t **live_pools;
+static size_t live_count;
+static size_t live_capacity;
+
+static atomic_uint_fast64_t next_pool_id = 1;
+
+/**
+ * Allocate the next slab (caller holds pool->lock)
+ *
+ * @return 0 on success, -1 at capacity or on allocation failure
+ */
+static int grow_locked(event_buffer_pool_t *pool) {
+    struct event_slab *slab;
+    size_t count = pool->capacity - pool->allocated;
+    
+    if (count == 0) {
+        return -1;
+    }
+    if (count > EVENT_POOL_SLAB_EVENTS) {
+        count = EVENT_POOL_SLAB_EVENTS;
+    }
+    
+    slab = calloc(1, sizeof(*slab) + count * sizeof(processed_event_t));
+    if (!slab) {
+        log_error("Failed to allocate event buffer slab");
+        return -1;
+    }
+    
+    slab->count = count;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->allocated += count;
+    
+    /* Link in reverse so the free list hands out events in address order */
+    for (size_t i = count; i-- > 0;) {
+        slab->events[i].pool = pool;
+        slab->events[i].next = pool->free_list;
+        pool->free_list = &slab->events[i];
+    }
+    
+    return 0;
+}
+
+/**
+ * Hand this thread's cache back to its pool, if that pool still exists
+ */
+static void return_thread_cache(void) {
+    event_cache_t *cache = &thread_cache;
+    
+    if (cache->pool_id == 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&registry_lock);
+    for (size_t i = 0; i < live_count && cache->head; i++) {
+        event_buffer_pool_t *pool = live_pools[i];
+        processed_event_t *tail = cache->head;
+        
+        if (pool->id != cache->pool_id) {
+            continue;
+        }
+        
+        while (tail->next) {
+            tail = tail->next;
+        }
+        pthread_mutex_lock(&pool->lock);
+        tail->next = pool->free_list;
+        pool->free_list = cache->head;
+        pthread_mutex_unlock(&pool->lock);
+        break;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    
+    cache->pool_id = 0;
+    cache->head = NULL;
+    cache->count = 0;
+}
+
+static void cache_thread_exit(void *arg) {
+    (void)arg;
+    return_thread_cache();
+}
+
+static void create_cache_key(void) {
+    pthread_key_create(&cache_key, cache_thread_exit);
+}
+
+/**
+ * This thread's cache, switched over to pool if it held another pool's
+ */
+static event_cache_t *pool_cache(event_buffer_pool_t *pool) {
+    if (thread_cache.pool_id != pool->id) {
+        return_thread_cache();
+        pthread_once(&cache_key_once, create_cache_key);
+        pthread_setspecific(cache_key, &thread_cache);
+        thread_cache.pool_id = pool->id;
+    }
+    return &thread_cache;
+}
+
+static int register_pool(event_buffer_pool_t *pool) {
+    pthread_mutex_lock(&registry_lock);
+    if (live_count == live_capacity) {
+        size_t capacity = live_capacity ? live_capacity * 2 : 8;
+        event_buffer_pool_t **pools = realloc(live_pools, capacity * sizeof(*pools));
+        
+        if (!pools) {
+            pthread_mutex_unlock(&registry_lock);
+            return -1;
+        }
+        live_pools = pools;
+        live_capacity = capacity;
+    }
+    live_pools[live_count++] = pool;
+    pthread_mutex_unlock(&registry_lock);
+    
+    return 0;
+}
+
+static void unregister_pool(event_buffer_pool_t *pool) {
+    pthread_mutex_lock(&registry_lock);
+    for (size_t i = 0; i < live_count; i++) {
+        if (live_pools[i] == pool) {
+            live_pools[i] = live_pools[--live_count];
+            break;
+        }
+    }
+    if (live_count == 0) {
+        free(live_pools);
+        live_pools = NULL;
+        live_capacity = 0;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
 /**
  * Create a new event buffer pool with specified capacity
  * Requirement: 17.1, 17.2, 17.3, 17.4
  * 
- * @param capacity Number of events to pre-allocate
+ * Only the first slab is allocated up front; the pool grows a slab at a
+ * time when it runs dry, up to capacity events.
+ * 
+ * @param capacity Most events the pool may hold (0 = default)
  * @return Pointer to event buffer pool, or NULL on failure
  */
 event_buffer_pool_t *event_buffer_pool_create(size_t capacity) {
     event_buffer_pool_t *pool = NULL;
-    size_t i;
     
     if (capacity == 0) {
         capacity = DEFAULT_POOL_CAPACITY;
@@ -39,78 +207,244 @@ event_buffer_pool_t *event_buffer_pool_create(size_t capacity) {
         return NULL;
     }
     
-    /* Allocate event array */
-    pool->events = (processed_event_t *)calloc(capacity, sizeof(processed_event_t));
-    if (!pool->events) {
+    pool->capacity = capacity;
+    pool->id = atomic_fetch_add(&next_pool_id, 1);
+    atomic_init(&pool->in_use_count, 0);
+    atomic_init(&pool->high_water, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    
+    if (grow_locked(pool) != 0 || register_pool(pool) != 0) {
         log_error("Failed to allocate event buffer array");
+        free(pool->slabs);
+        pthread_mutex_destroy(&pool->lock);
         free(pool);
         return NULL;
     }
     
     log_debug("Event buffer pool created with capacity: %zu", capacity);
     
-    pool->capacity = capacity;
-    pool->in_use_count = 0;
-    pool->free_list = NULL;
-    
-    /* Initialize free list - link all events together */
-    for (i = 0; i < capacity; i++) {
-        pool->events[i].in_use = false;
-        pool->events[i].next = pool->free_list;
-        pool->free_list = &pool->events[i];
-    }
-    
     return pool;
 }
 
+/**
+ * Reset an event's per-use fields
+ * The record buffer, overflow arena and pool link are kept
+ */
+static void clear_event(processed_event_t *event) {
+    memset(event, 0, offsetof(processed_event_t, record));
+}
+
 /**
  * Acquire an event from the buffer pool
- * Returns a pre-allocated event, or NULL if pool is exhausted
+ * Returns a cleared event, or NULL if pool is exhausted
+ * 
+ * Takes from this thread's cache; an empty cache is refilled with half
+ * a cache's worth from the pool, growing the pool if needed.
  * 
  * @param pool Event buffer pool
  * @return Pointer to available event, or NULL if none available
  */
 processed_event_t *event_buffer_pool_acquire(event_buffer_pool_t *pool) {
     processed_event_t *event = NULL;
+    event_cache_t *cache;
+    size_t in_use;
+    size_t high_water;
     
     if (!pool) {
         return NULL;
     }
     
-    /* Check if free list is empty */
-    if (!pool->free_list) {
-        log_warn("Event buffer pool exhausted (%zu events in use)", pool->in_use_count);
-        return NULL;
+    cache = pool_cache(pool);
+    if (!cache->head) {
+        pthread_mutex_lock(&pool->lock);
+        if (!pool->free_list) {
+            grow_locked(pool);
+        }
+        while (pool->free_list && cache->count < EVENT_POOL_CACHE_MAX / 2) {
+            event = pool->free_list;
+            pool->free_list = event->next;
+            event->next = cache->head;
+            cache->head = event;
+            cache->count++;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        
+        if (!cache->head) {
+            log_warn_ratelimited("Event buffer pool exhausted (%zu events in use)",
+                                 atomic_load(&pool->in_use_count));
+            return NULL;
+        }
     }
     
-    /* Pop from free list */
-    event = pool->free_list;
-    pool->free_list = event->next;
-    
-    /* Clear the event structure */
-    memset(event, 0, sizeof(processed_event_t));
-    event->in_use = true;
+    event = cache->head;
+    cache->head = event->next;
+    cache->count--;
     event->next = NULL;
+    event->in_use = true;
     
-    pool->in_use_count++;
+    in_use = atomic_fetch_add(&pool->in_use_count, 1) + 1;
+    high_water = atomic_load_explicit(&pool->high_water, memory_order_relaxed);
+    while (in_use > high_water &&
+           !atomic_compare_exchange_weak_explicit(&pool->high_water, &high_water, in_use,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
     
     return event;
 }
 
+/**
+ * Map an EVENT_OWNS_* bit to the string field it describes
+ */
+static const char **event_string_field(processed_event_t *event, uint32_t field) {
+    switch (field) {
+        case EVENT_OWNS_PROCESS:
+            return &event->process;
+        case EVENT_OWNS_EXE:
+            return &event->exe;
+        case EVENT_OWNS_CMDLINE:
+            return &event->cmdline;
+        case EVENT_OWNS_FILE:
+            return &event->file;
+        case EVENT_OWNS_LIBRARY:
+            return &event->library;
+        case EVENT_OWNS_LIBRARY_NAME:
+            return &event->library_name;
+        case EVENT_OWNS_FUNCTION_NAME:
+            return &event->function_name;
+        case EVENT_OWNS_FLAGS:
+            return &event->flags;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Replace a string field with a heap string owned by the event
+ * The previous value is freed if the event owned it
+ * 
+ * @param event Event to update
+ * @param field EVENT_OWNS_* bit of the field
+ * @param value Heap-allocated string (ownership is transferred), or NULL
+ */
+void processed_event_set_string(processed_event_t *event, uint32_t field, char *value) {
+    const char **slot;
+    
+    if (!event || !(slot = event_string_field(event, field))) {
+        free(value);
+        return;
+    }
+    
+    if (event->owned & field) {
+        free((char *)*slot);
+    }
+    
+    *slot = value;
+    if (value) {
+        event->owned |= field;
+    } else {
+        event->owned &= ~field;
+    }
+}
+
+/**
+ * Free the string fields owned by an event
+ * Borrowed fields are left alone; all string fields are reset to NULL
+ * 
+ * @param event Event whose strings to release
+ */
+void processed_event_free_strings(processed_event_t *event) {
+    uint32_t field;
+    const char **slot;
+    
+    if (!event) {
+        return;
+    }
+    
+    for (field = EVENT_OWNS_PROCESS; field <= EVENT_OWNS_FLAGS; field <<= 1) {
+        slot = event_string_field(event, field);
+        if (event->owned & field) {
+            free((char *)*slot);
+        }
+        *slot = NULL;
+    }
+    
+    event->owned = 0;
+    event->inline_used = 0;
+    string_arena_reset(event->overflow);
+}
+
+/**
+ * Copy a string into storage that lives as long as the event's current use
+ * Short strings go to the event's inline buffer and long ones to its
+ * overflow arena, both reused when the event is recycled, so steady-state
+ * copies do not allocate. Events outside a pool fall back to a heap copy
+ * owned by the event.
+ * 
+ * @param event Event to update
+ * @param field EVENT_OWNS_* bit of the field
+ * @param str String to copy (need not be NUL-terminated)
+ * @param len Length of str
+ * @return The copy, or NULL on failure (the field is left unchanged)
+ */
+const char *processed_event_store_string(processed_event_t *event, uint32_t field,
+                                         const char *str, size_t len) {
+    const char **slot;
+    char *copy;
+    
+    if (!event || !str || !(slot = event_string_field(event, field))) {
+        return NULL;
+    }
+    
+    if (len < sizeof(event->inline_strings) - event->inline_used) {
+        copy = event->inline_strings + event->inline_used;
+        event->inline_used += len + 1;
+    } else if (event->pool) {
+        if (!event->overflow) {
+            event->overflow = string_arena_create(EVENT_OVERFLOW_CHUNK);
+        }
+        copy = string_arena_alloc(event->overflow, len + 1);
+    } else {
+        copy = malloc(len + 1);
+        if (copy) {
+            memcpy(copy, str, len);
+            copy[len] = '\0';
+            processed_event_set_string(event, field, copy);
+        }
+        return copy;
+    }
+    
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    
+    if (event->owned & field) {
+        free((char *)*slot);
+        event->owned &= ~field;
+    }
+    *slot = copy;
+    
+    return copy;
+}
+
 /**
  * Release an event back to the buffer pool
- * Frees any dynamically allocated strings and returns event to free list
+ * Frees any strings the event owns and returns event to this thread's
+ * cache; a full cache gives half of its events back to the pool
  * 
  * @param pool Event buffer pool
  * @param event Event to release
  */
 void event_buffer_pool_release(event_buffer_pool_t *pool, processed_event_t *event) {
+    event_cache_t *cache;
+    
     if (!pool || !event) {
         return;
     }
     
     /* Verify this event belongs to this pool */
-    if (event < pool->events || event >= pool->events + pool->capacity) {
+    if (event->pool != pool) {
         log_warn("Attempted to release event not from this pool");
         return;
     }
@@ -120,60 +454,125 @@ void event_buffer_pool_release(event_buffer_pool_t *pool, processed_event_t *eve
         return;
     }
     
-    /* Free any dynamically allocated strings */
-    free(event->event_type);
-    free(event->timestamp);
-    free(event->process);
-    free(event->exe);
-    free(event->cmdline);
-    free(event->file);
-    free(event->library);
-    free(event->library_name);
-    free(event->function_name);
-    free(event->flags);
+    /* Free any strings owned by the event (borrowed ones are not ours) */
+    processed_event_free_strings(event);
     
     /* Clear the event structure */
-    memset(event, 0, sizeof(processed_event_t));
-    
-    /* Return to free list */
+    clear_event(event);
     event->in_use = false;
-    event->next = pool->free_list;
-    pool->free_list = event;
+    atomic_fetch_sub(&pool->in_use_count, 1);
     
-    pool->in_use_count--;
+    /* Return to this thread's free list */
+    cache = pool_cache(pool);
+    event->next = cache->head;
+    cache->head = event;
+    cache->count++;
+    
+    if (cache->count > EVENT_POOL_CACHE_MAX) {
+        pthread_mutex_lock(&pool->lock);
+        while (cache->count > EVENT_POOL_CACHE_MAX / 2) {
+            event = cache->head;
+            cache->head = event->next;
+            cache->count--;
+            event->next = pool->free_list;
+            pool->free_list = event;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * Copy a raw record into the event's private record buffer
+ * The buffer grows as needed and is kept when the event is recycled, so
+ * steady-state copies do not allocate. extra bytes past the record are
+ * left for in-place decoding.
+ * 
+ * @param event Event to copy into
+ * @param data Raw record
+ * @param size Size of the record in bytes
+ * @param extra Additional scratch bytes to reserve after the record
+ * @return Pointer to the copy, or NULL on allocation failure
+ */
+char *processed_event_copy_record(processed_event_t *event, const void *data,
+                                  size_t size, size_t extra) {
+    char *record;
+    
+    if (!event || !data) {
+        return NULL;
+    }
+    
+    if (event->record_capacity < size + extra) {
+        record = realloc(event->record, size + extra);
+        if (!record) {
+            log_error("Failed to allocate event record buffer");
+            return NULL;
+        }
+        event->record = record;
+        event->record_capacity = size + extra;
+    }
+    
+    memcpy(event->record, data, size);
+    
+    return event->record;
+}
+
+/**
+ * Read a pool's occupancy
+ */
+void event_buffer_pool_get_stats(event_buffer_pool_t *pool, event_pool_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    memset(stats, 0, sizeof(*stats));
+    if (!pool) {
+        return;
+    }
+    
+    pthread_mutex_lock(&pool->lock);
+    stats->capacity = pool->capacity;
+    stats->allocated = pool->allocated;
+    pthread_mutex_unlock(&pool->lock);
+    stats->in_use = atomic_load(&pool->in_use_count);
+    stats->high_water = atomic_load(&pool->high_water);
 }
 
 /**
  * Destroy event buffer pool and free all resources
+ * Events cached by other threads are freed with their slabs; those
+ * threads drop their cache the next time they use a pool
  * 
  * @param pool Event buffer pool to destroy
  */
 void event_buffer_pool_destroy(event_buffer_pool_t *pool) {
-    size_t i;
+    struct event_slab *slab, *next;
     
     if (!pool) {
         return;
     }
     
-    /* Free any strings in events that are still in use */
-    if (pool->events) {
-        for (i = 0; i < pool->capacity; i++) {
-            if (pool->events[i].in_use) {
-                /* Free dynamically allocated strings */
-                free(pool->events[i].event_type);
-                free(pool->events[i].timestamp);
-                free(pool->events[i].process);
-                free(pool->events[i].exe);
-                free(pool->events[i].cmdline);
-                free(pool->events[i].file);
-                free(pool->events[i].library);
-                free(pool->events[i].library_name);
-                free(pool->events[i].function_name);
-                free(pool->events[i].flags);
+    unregister_pool(pool);
+    if (thread_cache.pool_id == pool->id) {
+        thread_cache.pool_id = 0;
+        thread_cache.head = NULL;
+        thread_cache.count = 0;
+    }
+    
+    for (slab = pool->slabs; slab; slab = next) {
+        next = slab->next;
+        for (size_t i = 0; i < slab->count; i++) {
+            processed_event_t *event = &slab->events[i];
+            
+            if (event->in_use) {
+                /* Free strings owned by the event */
+                processed_event_free_strings(event);
             }
+            free(event->record);
+            string_arena_destroy(event->overflow);
         }
-        free(pool->events);
+        free(slab);
     }
     
+    pthread_mutex_destroy(&pool->lock);
     free(pool);
 }
@@ -17,13 +17,430 @@
 #include <stdio.h>
 #include <fnmatch.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include "include/event_processor.h"
-#include "include/privacy_filter.h"
+#include "include/crypto_classifier.h"
 #include "include/logger.h"
 #include "ebpf/common.h"
 
+/* Glob tokens (see compile_glob) */
+typedef enum {
+    GLOB_LITERAL,
+    GLOB_ANY,                       /* ? */
+    GLOB_STAR,                      /* * */
+    GLOB_CLASS                      /* [...] */
+} glob_token_kind_t;
+
+typedef struct {
+    glob_token_kind_t kind;
+    unsigned char c;                /* GLOB_LITERAL */
+    uint8_t set[32];                /* GLOB_CLASS: bitmap of matching bytes */
+} glob_token_t;
+
+/* Glob compiled for FNM_PATHNAME matching
+ * Patterns using syntax the compiler does not handle (character class
+ * names such as [[:alpha:]]) keep fnmatch as the matcher. */
+typedef struct {
+    char *prefix;                   /* Literal prefix, checked first */
+    size_t prefix_len;
+    glob_token_t *tokens;           /* Rest of the pattern */
+    size_t count;
+    char *fallback;                 /* Pattern for fnmatch(), NULL if compiled */
+} compiled_glob_t;
+
+/* Case-insensitive substring matcher (Knuth-Morris-Pratt automaton) */
+typedef struct {
+    char *pattern;                  /* Lower-case */
+    size_t len;
+    size_t *fail;                   /* fail[i]: longest proper border of pattern[0..i] */
+} substring_matcher_t;
+
+/* One step of a compiled filter set */
+typedef struct {
+    filter_type_t type;
+    int pid;
+    substring_matcher_t substring;  /* Process name and library filters */
+    compiled_glob_t glob;           /* File path filter */
+} filter_op_t;
+
+/* Filter set compiled into the order it is evaluated in: integer
+ * compares first, then substring automata, then globs */
+struct filter_program {
+    size_t count;
+    filter_op_t ops[];
+};
+
+static void glob_class_add(glob_token_t *token, unsigned char c) {
+    token->set[c >> 3] |= (uint8_t)(1U << (c & 7));
+}
+
+static bool glob_class_has(const glob_token_t *token, unsigned char c) {
+    return (token->set[c >> 3] >> (c & 7)) & 1U;
+}
+
+/**
+ * Parse a bracket expression starting after its '['
+ * 
+ * @return Characters consumed (including the closing ']'), 0 if the
+ *         bracket is unterminated (fnmatch then takes '[' literally), or
+ *         -1 for syntax left to fnmatch
+ */
+static int parse_glob_class(const char *p, glob_token_t *token) {
+    const char *start = p;
+    bool negate = false;
+    bool first = true;
+    
+    memset(token, 0, sizeof(*token));
+    token->kind = GLOB_CLASS;
+    
+    if (*p == '!' || *p == '^') {
+        negate = true;
+        p++;
+    }
+    
+    while (*p && (*p != ']' || first)) {
+        unsigned char lo, hi;
+        
+        if (p[0] == '[' && (p[1] == ':' || p[1] == '=' || p[1] == '.')) {
+            return -1;
+        }
+        if (*p == '\\' && p[1]) {
+            p++;
+        }
+        lo = (unsigned char)*p++;
+        hi = lo;
+        if (p[0] == '-' && p[1] && p[1] != ']') {
+            p++;
+            if (*p == '\\' && p[1]) {
+                p++;
+            }
+            hi = (unsigned char)*p++;
+        }
+        for (unsigned int c = lo; c <= hi; c++) {
+            glob_class_add(token, (unsigned char)c);
+        }
+        first = false;
+    }
+    
+    if (*p != ']') {
+        return 0;
+    }
+    
+    if (negate) {
+        for (size_t i = 0; i < sizeof(token->set); i++) {
+            token->set[i] = (uint8_t)~token->set[i];
+        }
+    }
+    /* With FNM_PATHNAME a bracket expression never matches '/' */
+    token->set['/' >> 3] &= (uint8_t)~(1U << ('/' & 7));
+    
+    return (int)(p + 1 - start);
+}
+
+static void free_glob(compiled_glob_t *glob) {
+    free(glob->prefix);
+    free(glob->tokens);
+    free(glob->fallback);
+    memset(glob, 0, sizeof(*glob));
+}
+
+/**
+ * Compile a glob into a literal prefix and a token list
+ * 
+ * @return 0 on success, -1 on allocation failure
+ */
+static int compile_glob(const char *pattern, compiled_glob_t *glob) {
+    size_t len = strlen(pattern);
+    const char *p = pattern;
+    
+    memset(glob, 0, sizeof(*glob));
+    glob->prefix = malloc(len + 1);
+    glob->tokens = calloc(len + 1, sizeof(*glob->tokens));
+    if (!glob->prefix || !glob->tokens) {
+        free_glob(glob);
+        return -1;
+    }
+    
+    while (*p) {
+        glob_token_t *token = &glob->tokens[glob->count];
+        int used;
+        
+        memset(token, 0, sizeof(*token));
+        switch (*p) {
+            case '*':
+                token->kind = GLOB_STAR;
+                p++;
+                break;
+            case '?':
+                token->kind = GLOB_ANY;
+                p++;
+                break;
+            case '[':
+                used = parse_glob_class(p + 1, token);
+                if (used < 0) {
+                    free_glob(glob);
+                    glob->fallback = strdup(pattern);
+                    return glob->fallback ? 0 : -1;
+                }
+                if (used > 0) {
+                    p += 1 + used;
+                    break;
+                }
+                /* Unterminated: a literal '[' */
+                memset(token, 0, sizeof(*token));
+                token->kind = GLOB_LITERAL;
+                token->c = (unsigned char)*p++;
+                break;
+            case '\\':
+                if (p[1]) {
+                    p++;
+                }
+                /* fall through */
+            default:
+                token->kind = GLOB_LITERAL;
+                token->c = (unsigned char)*p++;
+                break;
+        }
+        
+        /* Leading literals become the prefix */
+        if (token->kind == GLOB_LITERAL && glob->count == 0) {
+            glob->prefix[glob->prefix_len++] = (char)token->c;
+            continue;
+        }
+        glob->count++;
+    }
+    glob->prefix[glob->prefix_len] = '\0';
+    
+    return 0;
+}
+
+static bool glob_token_matches(const glob_token_t *token, unsigned char c) {
+    switch (token->kind) {
+        case GLOB_LITERAL:
+            return token->c == c;
+        case GLOB_ANY:
+            return c != '/';
+        case GLOB_CLASS:
+            return glob_class_has(token, c);
+        default:
+            return false;
+    }
+}
+
+/**
+ * Match a string against a compiled glob with FNM_PATHNAME semantics
+ * Wildcards never match '/', so a '*' only ever needs to be retried up
+ * to the next '/'; the last '*' seen is the only backtracking point.
+ */
+static bool compiled_glob_match(const compiled_glob_t *glob, const char *string) {
+    const size_t none = (size_t)-1;
+    size_t ti = 0, si = 0;
+    size_t star_t = none, star_s = 0;
+    
+    if (glob->fallback) {
+        return fnmatch(glob->fallback, string, FNM_PATHNAME) == 0;
+    }
+    
+    if (strncmp(string, glob->prefix, glob->prefix_len) != 0) {
+        return false;
+    }
+    string += glob->prefix_len;
+    
+    while (string[si]) {
+        unsigned char c = (unsigned char)string[si];
+        
+        if (ti < glob->count && glob->tokens[ti].kind == GLOB_STAR) {
+            star_t = ti++;
+            star_s = si;
+            continue;
+        }
+        if (ti < glob->count && glob_token_matches(&glob->tokens[ti], c)) {
+            ti++;
+            si++;
+            continue;
+        }
+        if (star_t != none && string[star_s] != '/') {
+            ti = star_t + 1;
+            si = ++star_s;
+            continue;
+        }
+        return false;
+    }
+    
+    while (ti < glob->count && glob->tokens[ti].kind == GLOB_STAR) {
+        ti++;
+    }
+    return ti == glob->count;
+}
+
+/**
+ * Perform glob pattern matching
+ * Same matcher as the file path filter (fnmatch with FNM_PATHNAME
+ * semantics); compiles the pattern on every call
+ * 
+ * @param pattern Glob pattern (e.g., "/etc/ssl/ *.pem")
+ * @param string String to match against
+ * @return true if matches, false otherwise
+ */
+bool glob_match(const char *pattern, const char *string) {
+    compiled_glob_t glob;
+    bool matched;
+    
+    if (!pattern || !string) {
+        return false;
+    }
+    
+    if (compile_glob(pattern, &glob) != 0) {
+        return fnmatch(pattern, string, FNM_PATHNAME) == 0;
+    }
+    matched = compiled_glob_match(&glob, string);
+    free_glob(&glob);
+    
+    return matched;
+}
+
+static void free_substring_matcher(substring_matcher_t *matcher) {
+    free(matcher->pattern);
+    free(matcher->fail);
+    memset(matcher, 0, sizeof(*matcher));
+}
+
+/**
+ * Build the KMP automaton of a lower-cased pattern
+ * 
+ * @return 0 on success, -1 on allocation failure
+ */
+static int compile_substring(const char *pattern, substring_matcher_t *matcher) {
+    size_t k = 0;
+    
+    memset(matcher, 0, sizeof(*matcher));
+    matcher->len = strlen(pattern);
+    matcher->pattern = malloc(matcher->len + 1);
+    matcher->fail = calloc(matcher->len + 1, sizeof(*matcher->fail));
+    if (!matcher->pattern || !matcher->fail) {
+        free_substring_matcher(matcher);
+        return -1;
+    }
+    
+    for (size_t i = 0; i <= matcher->len; i++) {
+        matcher->pattern[i] = (char)tolower((unsigned char)pattern[i]);
+    }
+    
+    for (size_t i = 1; i < matcher->len; i++) {
+        while (k > 0 && matcher->pattern[i] != matcher->pattern[k]) {
+            k = matcher->fail[k - 1];
+        }
+        if (matcher->pattern[i] == matcher->pattern[k]) {
+            k++;
+        }
+        matcher->fail[i] = k;
+    }
+    
+    return 0;
+}
+
+/**
+ * Case-insensitive substring search in one pass over string
+ */
+static bool substring_matcher_find(const substring_matcher_t *matcher, const char *string) {
+    size_t k = 0;
+    
+    if (matcher->len == 0) {
+        return true;
+    }
+    
+    for (; *string; string++) {
+        char c = (char)tolower((unsigned char)*string);
+        
+        while (k > 0 && c != matcher->pattern[k]) {
+            k = matcher->fail[k - 1];
+        }
+        if (c == matcher->pattern[k] && ++k == matcher->len) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/* Evaluation order of the filter types, cheapest first */
+static int filter_type_cost(filter_type_t type) {
+    switch (type) {
+        case FILTER_TYPE_PID:
+            return 0;
+        case FILTER_TYPE_PROCESS_NAME:
+            return 1;
+        case FILTER_TYPE_LIBRARY:
+            return 2;
+        default:
+            return 3;
+    }
+}
+
+static void filter_program_destroy(struct filter_program *program) {
+    if (!program) {
+        return;
+    }
+    
+    for (size_t i = 0; i < program->count; i++) {
+        free_substring_matcher(&program->ops[i].substring);
+        free_glob(&program->ops[i].glob);
+    }
+    free(program);
+}
+
+/**
+ * Compile a filter list into an ordered program
+ * 
+ * @return Program, or NULL on allocation failure
+ */
+static struct filter_program *filter_program_compile(const filter_set_t *set) {
+    struct filter_program *program;
+    const filter_t *filter;
+    int err = 0;
+    
+    program = calloc(1, sizeof(*program) + set->count * sizeof(program->ops[0]));
+    if (!program) {
+        return NULL;
+    }
+    
+    for (int cost = 0; cost <= 3; cost++) {
+        for (filter = set->filters; filter; filter = filter->next) {
+            filter_op_t *op;
+            
+            if (filter_type_cost(filter->type) != cost) {
+                continue;
+            }
+            
+            op = &program->ops[program->count++];
+            op->type = filter->type;
+            switch (filter->type) {
+                case FILTER_TYPE_PID:
+                    op->pid = filter->value.pid;
+                    break;
+                case FILTER_TYPE_PROCESS_NAME:
+                    err |= compile_substring(filter->value.name_pattern, &op->substring);
+                    break;
+                case FILTER_TYPE_LIBRARY:
+                    err |= compile_substring(filter->value.library_pattern, &op->substring);
+                    break;
+                case FILTER_TYPE_FILE_PATH:
+                    err |= compile_glob(filter->value.file_pattern, &op->glob);
+                    break;
+            }
+        }
+    }
+    
+    if (err) {
+        filter_program_destroy(program);
+        return NULL;
+    }
+    
+    return program;
+}
+
 /**
  * Create a new filter set
  * Returns pointer to filter set, or NULL on failure
@@ -41,8 +458,29 @@ filter_set_t *filter_set_create(void) {
     return set;
 }
 
+static void free_filter(filter_t *filter) {
+    switch (filter->type) {
+        case FILTER_TYPE_PROCESS_NAME:
+            free(filter->value.name_pattern);
+            break;
+        case FILTER_TYPE_LIBRARY:
+            free(filter->value.library_pattern);
+            break;
+        case FILTER_TYPE_FILE_PATH:
+            free(filter->value.file_pattern);
+            break;
+        case FILTER_TYPE_PID:
+            /* No dynamic allocation for PID */
+            break;
+    }
+    
+    free(filter);
+}
+
 /**
  * Add a filter to the filter set
+ * The set is recompiled, so every pattern is parsed once here rather
+ * than per event.
  * 
  * @param set Filter set
  * @param type Filter type
@@ -50,6 +488,7 @@ filter_set_t *filter_set_create(void) {
  * @return 0 on success, -1 on failure
  */
 int filter_set_add(filter_set_t *set, filter_type_t type, const void *value) {
+    struct filter_program *program;
     filter_t *filter = NULL;
     
     if (!set || !value) {
@@ -71,7 +510,7 @@ int filter_set_add(filter_set_t *set, filter_type_t type, const void *value) {
         case FILTER_TYPE_PID:
             filter->value.pid = *(int *)value;
             break;
-            
+        
         case FILTER_TYPE_PROCESS_NAME:
             filter->value.name_pattern = strdup((const char *)value);
             if (!filter->value.name_pattern) {
@@ -79,7 +518,7 @@ int filter_set_add(filter_set_t *set, filter_type_t type, const void *value) {
                 return -1;
             }
             break;
-            
+        
         case FILTER_TYPE_LIBRARY:
             filter->value.library_pattern = strdup((const char *)value);
             if (!filter->value.library_pattern) {
@@ -87,7 +526,7 @@ int filter_set_add(filter_set_t *set, filter_type_t type, const void *value) {
                 return -1;
             }
             break;
-            
+        
         case FILTER_TYPE_FILE_PATH:
             filter->value.file_pattern = strdup((const char *)value);
             if (!filter->value.file_pattern) {
@@ -95,7 +534,7 @@ int filter_set_add(filter_set_t *set, filter_type_t type, const void *value) {
                 return -1;
             }
             break;
-            
+        
         default:
             free(filter);
             return -1;
@@ -106,24 +545,18 @@ int filter_set_add(filter_set_t *set, filter_type_t type, const void *value) {
     set->filters = filter;
     set->count++;
     
-    return 0;
-}
-
-/**
- * Perform glob pattern matching
- * Uses fnmatch for glob pattern support
- * 
- * @param pattern Glob pattern (e.g., "/etc/ssl/ *.pem")
- * @param string String to match against
- * @return true if matches, false otherwise
- */
-static bool crypto_glob_match(const char *pattern, const char *string) {
-    if (!pattern || !string) {
-        return false;
+    program = filter_program_compile(set);
+    if (!program) {
+        log_error("Failed to compile filters");
+        set->filters = filter->next;
+        set->count--;
+        free_filter(filter);
+        return -1;
     }
+    filter_program_destroy(set->program);
+    set->program = program;
     
-    /* Use fnmatch with FNM_PATHNAME for path-aware matching */
-    return (fnmatch(pattern, string, FNM_PATHNAME) == 0);
+    return 0;
 }
 
 /**
@@ -167,86 +600,95 @@ bool substring_match(const char *pattern, const char *string) {
 }
 
 /**
- * Check if a single filter matches an event
+ * Run one compiled filter against an event
  * Requirement: 14.3 - Early termination for performance
- * 
- * @param filter Filter to check
- * @param event Event to match against
- * @return true if filter matches, false otherwise
  */
-static bool filter_matches_event(filter_t *filter, processed_event_t *event) {
-    if (!filter || !event) {
-        return false;
-    }
-    
-    switch (filter->type) {
+static filter_verdict_t filter_op_evaluate(const filter_op_t *op, const processed_event_t *event) {
+    switch (op->type) {
         case FILTER_TYPE_PID:
             /* Match PID exactly */
-            return (event->pid == (uint32_t)filter->value.pid);
-            
+            return event->pid == (uint32_t)op->pid ? FILTER_MATCH : FILTER_REJECT;
+        
         case FILTER_TYPE_PROCESS_NAME:
-            /* Substring match on process name */
-            if (event->process) {
-                return substring_match(filter->value.name_pattern, event->process);
+            /* Substring match on process name; only /proc can supply a missing one */
+            if (!event->process) {
+                return FILTER_UNDECIDED;
             }
-            return false;
-            
+            return substring_matcher_find(&op->substring, event->process) ?
+                   FILTER_MATCH : FILTER_REJECT;
+        
         case FILTER_TYPE_LIBRARY:
             /* Substring match on library path or library name */
-            if (event->library) {
-                if (substring_match(filter->value.library_pattern, event->library)) {
-                    return true;
-                }
+            if (event->library && substring_matcher_find(&op->substring, event->library)) {
+                return FILTER_MATCH;
             }
-            if (event->library_name) {
-                if (substring_match(filter->value.library_pattern, event->library_name)) {
-                    return true;
-                }
+            if (event->library_name && substring_matcher_find(&op->substring, event->library_name)) {
+                return FILTER_MATCH;
             }
-            return false;
-            
+            return FILTER_REJECT;
+        
         case FILTER_TYPE_FILE_PATH:
             /* Glob pattern match on file path */
-            if (event->file) {
-                return crypto_glob_match(filter->value.file_pattern, event->file);
+            if (event->file && compiled_glob_match(&op->glob, event->file)) {
+                return FILTER_MATCH;
             }
-            return false;
-            
+            return FILTER_REJECT;
+        
         default:
-            return false;
+            return FILTER_REJECT;
     }
 }
 
 /**
- * Check if event matches all filters in the set
+ * Evaluate the filters against the fields an event already carries
  * Requirement: 14.4 - AND logic with early termination
  * Requirement: 14.3 - Optimize to under 1 microsecond per event
  * 
+ * Meant to run on the decoded record, before enrichment: only a missing
+ * process name can still be filled in from /proc, and an event lacking
+ * one that passes every other filter is FILTER_UNDECIDED.
+ * 
  * @param set Filter set
  * @param event Event to match
- * @return true if all filters match (or no filters), false otherwise
+ * @return FILTER_MATCH, FILTER_REJECT or FILTER_UNDECIDED
  */
-bool filter_set_matches(filter_set_t *set, processed_event_t *event) {
-    filter_t *filter = NULL;
+filter_verdict_t filter_set_evaluate(const filter_set_t *set, const processed_event_t *event) {
+    filter_verdict_t verdict = FILTER_MATCH;
     
     if (!set || !event) {
-        return false;
+        return FILTER_REJECT;
     }
     
     /* No filters means match everything */
-    if (set->count == 0 || !set->filters) {
-        return true;
+    if (set->count == 0 || !set->program) {
+        return FILTER_MATCH;
     }
     
-    /* AND logic: All filters must match */
-    /* Early termination: Return false as soon as one filter doesn't match */
-    for (filter = set->filters; filter != NULL; filter = filter->next) {
-        if (!filter_matches_event(filter, event)) {
-            return false;  /* Early termination */
+    for (size_t i = 0; i < set->program->count; i++) {
+        switch (filter_op_evaluate(&set->program->ops[i], event)) {
+            case FILTER_REJECT:
+                return FILTER_REJECT;  /* Early termination */
+            case FILTER_UNDECIDED:
+                verdict = FILTER_UNDECIDED;
+                break;
+            default:
+                break;
         }
     }
     
-    return true;  /* All filters matched */
+    return verdict;
+}
+
+/**
+ * Check if event matches all filters in the set
+ * A filter on a field the event does not have does not match.
+ * 
+ * @param set Filter set
+ * @param event Event to match
+ * @return true if all filters match (or no filters), false otherwise
+ */
+bool filter_set_matches(filter_set_t *set, processed_event_t *event) {
+    return filter_set_evaluate(set, event) == FILTER_MATCH;
 }
 
 /**
@@ -266,27 +708,11 @@ void filter_set_destroy(filter_set_t *set) {
     filter = set->filters;
     while (filter) {
         next = filter->next;
-        
-        /* Free filter value based on type */
-        switch (filter->type) {
-            case FILTER_TYPE_PROCESS_NAME:
-                free(filter->value.name_pattern);
-                break;
-            case FILTER_TYPE_LIBRARY:
-                free(filter->value.library_pattern);
-                break;
-            case FILTER_TYPE_FILE_PATH:
-                free(filter->value.file_pattern);
-                break;
-            case FILTER_TYPE_PID:
-                /* No dynamic allocation for PID */
-                break;
-        }
-        
-        free(filter);
+        free_filter(filter);
         filter = next;
     }
     
+    filter_program_destroy(set->program);
     free(set);
 }
 
@@ -320,6 +746,25 @@ event_processor_t *event_processor_create(cli_args_t *args) {
     proc->args = args;
     proc->redact_paths = !args->no_redact;
     
+    /* Enrichment still works without the cache, just more slowly */
+    proc->cache = proc_cache_create(PROC_CACHE_DEFAULT_CAPACITY);
+    if (!proc->cache) {
+        log_warn("Failed to create proc cache, enrichment will read /proc for every event");
+    }
+    
+    /* Containers are attributed by cgroup id, which needs cgroup v2 */
+    proc->cgroups = cgroup_cache_create(NULL);
+    if (args->cgroup_filter || args->container_filter) {
+        proc->cgroup_filter = cgroup_selector_create(args->cgroup_filter, args->container_filter);
+        if (!proc->cgroup_filter) {
+            event_processor_destroy(proc);
+            return NULL;
+        }
+        if (!proc->cgroups) {
+            log_warn("cgroup v2 is not mounted, --cgroup and --container match no events");
+        }
+    }
+    
     /* Add filters based on CLI arguments */
     if (args->pid > 0) {
         if (event_processor_add_filter(proc, FILTER_TYPE_PID, &args->pid) != 0) {
@@ -383,6 +828,38 @@ bool event_processor_matches_filters(event_processor_t *proc, processed_event_t
     return filter_set_matches(proc->filters, event);
 }
 
+/**
+ * Run the filters on a decoded record before it is enriched
+ * Events rejected here never cost a /proc read; FILTER_UNDECIDED ones
+ * must be checked again with event_processor_matches_filters() once
+ * enriched.
+ * 
+ * @param proc Event processor
+ * @param event Event to check
+ * @return FILTER_MATCH, FILTER_REJECT or FILTER_UNDECIDED
+ */
+filter_verdict_t event_processor_prefilter(event_processor_t *proc, const processed_event_t *event) {
+    filter_verdict_t verdict;
+    const cgroup_info_t *cgroup;
+    
+    if (!proc || !proc->filters) {
+        return FILTER_REJECT;
+    }
+    
+    verdict = filter_set_evaluate(proc->filters, event);
+    if (verdict == FILTER_REJECT || !proc->cgroup_filter) {
+        return verdict;
+    }
+    
+    /* A cgroup removed before it could be looked up passed the kernel
+     * filter if there was one */
+    cgroup = cgroup_cache_lookup(proc->cgroups, event->cgroup_id);
+    if (!cgroup) {
+        return proc->cgroups_in_kernel ? verdict : FILTER_REJECT;
+    }
+    return cgroup_selector_matches(proc->cgroup_filter, cgroup) ? verdict : FILTER_REJECT;
+}
+
 /**
  * Destroy event processor and free all resources
  * 
@@ -397,6 +874,10 @@ void event_processor_destroy(event_processor_t *proc) {
         filter_set_destroy(proc->filters);
     }
     
+    proc_cache_destroy(proc->cache);
+    cgroup_cache_destroy(proc->cgroups);
+    cgroup_selector_destroy(proc->cgroup_filter);
+    
     free(proc);
 }
 
@@ -571,7 +1052,7 @@ int enrich_event(processed_event_t *event) {
     /* Enrich process name if not already set */
     if (!event->process && event->pid > 0) {
         if (enrich_process_name(event->pid, &process_name) == 0) {
-            event->process = process_name;
+            processed_event_set_string(event, EVENT_OWNS_PROCESS, process_name);
             enriched++;
         }
     }
@@ -579,16 +1060,15 @@ int enrich_event(processed_event_t *event) {
     /* Enrich executable path if not already set */
     if (!event->exe && event->pid > 0) {
         if (enrich_executable_path(event->pid, &exe_path) == 0) {
-            event->exe = exe_path;
+            processed_event_set_string(event, EVENT_OWNS_EXE, exe_path);
             enriched++;
         }
     }
     
     /* Enrich command line if not already set and this is a process_exec event */
-    if (!event->cmdline && event->pid > 0 && event->event_type && 
-        strcmp(event->event_type, "process_exec") == 0) {
+    if (!event->cmdline && event->pid > 0 && processed_event_kind(event) == EVENT_PROCESS_EXEC) {
         if (enrich_cmdline(event->pid, &cmdline_str) == 0) {
-            event->cmdline = cmdline_str;
+            processed_event_set_string(event, EVENT_OWNS_CMDLINE, cmdline_str);
             enriched++;
         }
     }
@@ -598,72 +1078,113 @@ int enrich_event(processed_event_t *event) {
     return 0;
 }
 
+/**
+ * Set an enriched string field to a cached string, or to a copy owned by
+ * the event when it is kept past the next enrichment
+ */
+static void enrich_string(const event_processor_t *proc, processed_event_t *event,
+                          const char **slot, uint32_t field, const char *value) {
+    if (proc->copy_enrichment) {
+        processed_event_store_string(event, field, value, strlen(value));
+    } else {
+        *slot = value;
+    }
+}
 
 /**
- * Check if string ends with suffix (case-insensitive)
+ * Enrich event with process metadata through the processor's proc cache
+ * Requirements: 17.3, 17.4, 17.5, 17.6
+ * 
+ * The cache is filled on the first event of a process, refreshed on
+ * process_exec (unless the kernel already captured exe and cmdline) and
+ * evicted after the process_exit of the thread group leader. Enriched fields borrow
+ * the cached strings, which stay valid until the next event is enriched,
+ * or with copy_enrichment own copies of them.
+ * The container and pod come from the cgroup cache and stay valid as
+ * long as the processor.
+ * Falls back to enrich_event() when the processor has no cache.
+ * 
+ * @param proc Event processor
+ * @param event Event to enrich
+ * @return 0 on success, -1 on failure
  */
-static bool str_ends_with(const char *str, const char *suffix) {
-    size_t str_len, suffix_len, i;
+int event_processor_enrich(event_processor_t *proc, processed_event_t *event) {
+    const proc_cache_entry_t *entry;
+    const cgroup_info_t *cgroup;
+    unsigned int flags = 0;
+    bool is_exec;
+    
+    if (!proc || !proc->cache) {
+        return enrich_event(event);
+    }
     
-    if (!str || !suffix) {
-        return false;
+    if (!event) {
+        return -1;
     }
     
-    str_len = strlen(str);
-    suffix_len = strlen(suffix);
+    cgroup = cgroup_cache_lookup(proc->cgroups, event->cgroup_id);
+    if (cgroup) {
+        event->container = cgroup->container;
+        event->pod = cgroup->pod;
+    }
     
-    if (suffix_len > str_len) {
-        return false;
+    if (event->pid == 0) {
+        return 0;
     }
     
-    /* Compare from the end, case-insensitive */
-    for (i = 0; i < suffix_len; i++) {
-        if (tolower((unsigned char)str[str_len - suffix_len + i]) != 
-            tolower((unsigned char)suffix[i])) {
-            return false;
+    is_exec = processed_event_kind(event) == EVENT_PROCESS_EXEC;
+    if (is_exec && event->process && event->exe && event->cmdline) {
+        /* Captured in the kernel at exec time; the pre-exec entry is stale */
+        proc_cache_invalidate(proc->cache, (pid_t)event->pid);
+        return 0;
+    }
+    if (!is_exec && event->process && event->exe) {
+        /* Enriched before it got here (crypto-tracer daemon) */
+        return 0;
+    }
+    if (is_exec) {
+        flags |= PROC_CACHE_REFRESH;
+        if (!event->cmdline) {
+            flags |= PROC_CACHE_NEED_CMDLINE;
         }
+    } else if (processed_event_ends_process(event)) {
+        /* Only the leader's exit; other threads leave the process running */
+        flags |= PROC_CACHE_LAST_USE;
     }
     
-    return true;
+    entry = proc_cache_lookup(proc->cache, (pid_t)event->pid, event->process_start_ns, flags);
+    if (!entry) {
+        /* Requirement 17.6: Handle missing /proc data gracefully */
+        return 0;
+    }
+    
+    if (!event->process && entry->comm) {
+        enrich_string(proc, event, &event->process, EVENT_OWNS_PROCESS, entry->comm);
+    }
+    if (!event->exe && entry->exe) {
+        enrich_string(proc, event, &event->exe, EVENT_OWNS_EXE, entry->exe);
+    }
+    if (!event->cmdline && is_exec && entry->cmdline) {
+        enrich_string(proc, event, &event->cmdline, EVENT_OWNS_CMDLINE, entry->cmdline);
+    }
+    
+    return 0;
 }
 
+
 /**
  * Classify cryptographic file by extension and content
  * Requirement: 17.1
  * 
  * For v1.0: Simplified classification based on extension only
  * .pem files are classified as "certificate" by default
+ * The rules are those of the process-wide crypto classifier.
  * 
  * @param path File path
  * @return File type classification
  */
 file_type_t classify_crypto_file(const char *path) {
-    if (!path) {
-        return FILE_TYPE_UNKNOWN;
-    }
-    
-    /* Check for certificate extensions */
-    if (str_ends_with(path, ".crt") || 
-        str_ends_with(path, ".cer") ||
-        str_ends_with(path, ".pem")) {
-        /* Requirement: For .pem files, classify as "certificate" by default (v1.0 simplification) */
-        return FILE_TYPE_CERTIFICATE;
-    }
-    
-    /* Check for private key extensions */
-    if (str_ends_with(path, ".key")) {
-        return FILE_TYPE_PRIVATE_KEY;
-    }
-    
-    /* Check for keystore extensions */
-    if (str_ends_with(path, ".p12") ||
-        str_ends_with(path, ".pfx") ||
-        str_ends_with(path, ".jks") ||
-        str_ends_with(path, ".keystore")) {
-        return FILE_TYPE_KEYSTORE;
-    }
-    
-    return FILE_TYPE_UNKNOWN;
+    return crypto_classifier_file_type(crypto_classifier_default(), path);
 }
 
 /**
@@ -698,12 +1219,40 @@ const char *file_type_to_string(file_type_t type) {
  * @return Library name (caller must free), or NULL on failure
  */
 char *extract_library_name(const char *library_path) {
-    const char *filename = NULL;
-    const char *dot = NULL;
+    const char *filename;
     size_t name_len;
     char *library_name = NULL;
     
-    if (!library_path) {
+    filename = library_name_span(library_path, &name_len);
+    if (!filename) {
+        return NULL;
+    }
+    
+    /* Allocate and copy library name */
+    library_name = (char *)malloc(name_len + 1);
+    if (!library_name) {
+        return NULL;
+    }
+    
+    memcpy(library_name, filename, name_len);
+    library_name[name_len] = '\0';
+    
+    return library_name;
+}
+
+/**
+ * Locate the library name inside a library path, without copying it
+ * Same rules as extract_library_name()
+ * 
+ * @param library_path Full library path
+ * @param len Set to the length of the name
+ * @return Start of the name inside library_path, or NULL if library_path is NULL
+ */
+const char *library_name_span(const char *library_path, size_t *len) {
+    const char *filename = NULL;
+    const char *dot = NULL;
+    
+    if (!library_path || !len) {
         return NULL;
     }
     
@@ -718,83 +1267,31 @@ char *extract_library_name(const char *library_path) {
     /* Find the first '.' to remove version suffix */
     dot = strchr(filename, '.');
     if (dot) {
-        name_len = dot - filename;
+        *len = (size_t)(dot - filename);
     } else {
-        name_len = strlen(filename);
+        *len = strlen(filename);
     }
     
-    /* Allocate and copy library name */
-    library_name = (char *)malloc(name_len + 1);
-    if (!library_name) {
-        return NULL;
-    }
-    
-    strncpy(library_name, filename, name_len);
-    library_name[name_len] = '\0';
-    
-    return library_name;
+    return filename;
 }
 
 /**
  * Apply privacy filtering to event paths
  * Requirements: 6.1, 6.2, 6.3, 6.4
+ * Redaction only replaces a path prefix, so the event's strings are left
+ * alone: the output formatter and the profile manager write exe, file and
+ * library through privacy_redact_path() when redact_paths is set. The
+ * command line is kept as is (privacy_filter_cmdline()).
  * 
  * @param event Event to filter
  * @param redact_enabled Whether redaction is enabled (false if --no-redact)
  * @return 0 on success, -1 on failure
  */
 int apply_privacy_filter(processed_event_t *event, bool redact_enabled) {
-    char *filtered_path = NULL;
-    char *filtered_cmdline = NULL;
-    
     if (!event) {
         return -1;
     }
     
-    /* Filter file path if present */
-    if (event->file) {
-        filtered_path = privacy_filter_path(event->file, redact_enabled);
-        if (filtered_path) {
-            free(event->file);
-            event->file = filtered_path;
-        } else {
-            /* If filtering failed, keep original but log warning */
-            log_warn("Failed to filter file path");
-        }
-    }
-    
-    /* Filter library path if present */
-    if (event->library) {
-        filtered_path = privacy_filter_path(event->library, redact_enabled);
-        if (filtered_path) {
-            free(event->library);
-            event->library = filtered_path;
-        } else {
-            log_warn("Failed to filter library path");
-        }
-    }
-    
-    /* Filter executable path if present */
-    if (event->exe) {
-        filtered_path = privacy_filter_path(event->exe, redact_enabled);
-        if (filtered_path) {
-            free(event->exe);
-            event->exe = filtered_path;
-        } else {
-            log_warn("Failed to filter exe path");
-        }
-    }
-    
-    /* Filter command line if present */
-    if (event->cmdline) {
-        filtered_cmdline = privacy_filter_cmdline(event->cmdline, redact_enabled);
-        if (filtered_cmdline) {
-            free(event->cmdline);
-            event->cmdline = filtered_cmdline;
-        } else {
-            log_warn("Failed to filter cmdline");
-        }
-    }
-    
+    event->redact_paths = redact_enabled;
     return 0;
 }
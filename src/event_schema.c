@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * event_schema.c - Event type names
+ */
+
+#include <string.h>
+#include "include/event_schema.h"
+
+static const char *const event_kind_names[EVENT_KIND_COUNT] = {
+#define EVENT_SCHEMA_NAME(kind, name, fields) [EVENT_##kind] = #name,
+    EVENT_SCHEMA(EVENT_SCHEMA_NAME)
+#undef EVENT_SCHEMA_NAME
+};
+
+const char *event_kind_name(event_kind_t kind) {
+    return (unsigned int)kind < EVENT_KIND_COUNT ? event_kind_names[kind] : NULL;
+}
+
+event_kind_t event_kind_from_name(const char *name) {
+    if (!name) {
+        return EVENT_NONE;
+    }
+    
+    for (int kind = EVENT_NONE + 1; kind < EVENT_KIND_COUNT; kind++) {
+        if (strcmp(name, event_kind_names[kind]) == 0) {
+            return (event_kind_t)kind;
+        }
+    }
+    
+    return EVENT_NONE;
+}
@@ -0,0 +1,688 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * exporter.c - Batched export of the monitor output to a collector
+ * Everything but the statistics belongs to the sink's writer thread. A
+ * slow or hung collector blocks that thread for at most the send timeout;
+ * meanwhile the sink's blocks fill and event output waits, so memory stays
+ * bounded. Spool files are numbered in send order, [spool_head,
+ * spool_tail): while anything is spooled, new batches are spooled behind
+ * it rather than sent, so the collector always sees a stream in order.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <dirent.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <zlib.h>
+#include "include/exporter.h"
+#include "include/logger.h"
+
+#define EXPORT_CONNECT_TIMEOUT_MS 2000
+#define EXPORT_SEND_TIMEOUT_MS 5000
+#define EXPORT_RETRY_MIN_MS 1000
+#define EXPORT_RETRY_MAX_MS 30000
+
+/* Spooled batches sent per writer tick, so live batches keep moving */
+#define EXPORT_REPLAY_BATCHES 16
+
+/* How long closing keeps sending spooled batches */
+#define EXPORT_CLOSE_REPLAY_MS 2000
+
+#define SPOOL_SUFFIX ".ctex"
+
+struct exporter {
+    exporter_config_t config;
+    char *host;
+    char *port;
+    char *spool_dir;
+    uint64_t stream_id;
+    uint64_t next_seq;
+    int fd;                        /* Collector connection (-1 = none) */
+    uint64_t retry_at_ns;
+    uint32_t retry_ms;
+    bool warned;                   /* Unreachable collector reported */
+    uint64_t spool_head;           /* Oldest spool file */
+    uint64_t spool_tail;           /* Number of the next spool file */
+    z_stream zs;
+    bool zs_ready;
+    unsigned char *frame;          /* Frame being sent or spooled */
+    size_t frame_size;
+    
+    pthread_mutex_t lock;          /* Statistics */
+    exporter_stats_t stats;
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void put_be32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static void put_be64(unsigned char *p, uint64_t v) {
+    put_be32(p, (uint32_t)(v >> 32));
+    put_be32(p + 4, (uint32_t)v);
+}
+
+int exporter_parse_address(const char *address, char *host, size_t host_size,
+                           char *port, size_t port_size) {
+    const char *sep, *host_start = address;
+    size_t host_len;
+    
+    if (!address) {
+        return -1;
+    }
+    
+    if (address[0] == '[') {
+        const char *end = strchr(address, ']');
+        
+        if (!end || end[1] != ':') {
+            return -1;
+        }
+        host_start = address + 1;
+        host_len = (size_t)(end - host_start);
+        sep = end + 1;
+    } else {
+        sep = strrchr(address, ':');
+        if (!sep || strchr(address, ':') != sep) {
+            return -1;
+        }
+        host_len = (size_t)(sep - address);
+    }
+    
+    if (host_len == 0 || host_len >= host_size || sep[1] == '\0' ||
+        strlen(sep + 1) >= port_size) {
+        return -1;
+    }
+    for (const char *c = sep + 1; *c; c++) {
+        if (*c < '0' || *c > '9') {
+            return -1;
+        }
+    }
+    if (atoi(sep + 1) < 1 || atoi(sep + 1) > 65535) {
+        return -1;
+    }
+    
+    memcpy(host, host_start, host_len);
+    host[host_len] = '\0';
+    snprintf(port, port_size, "%s", sep + 1);
+    return 0;
+}
+
+static void spool_name(const exporter_t *ex, uint64_t seq, char *buf, size_t size) {
+    snprintf(buf, size, "%s/%020lu" SPOOL_SUFFIX, ex->spool_dir, seq);
+}
+
+/**
+ * Connect with a timeout; the socket is blocking afterwards, with a send
+ * timeout so a hung collector cannot hold the writer forever
+ */
+static int connect_collector(exporter_t *ex) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct timeval send_timeout = {
+        .tv_sec = EXPORT_SEND_TIMEOUT_MS / 1000,
+        .tv_usec = (EXPORT_SEND_TIMEOUT_MS % 1000) * 1000,
+    };
+    struct addrinfo *res, *ai;
+    int one = 1;
+    int fd = -1;
+    
+    if (getaddrinfo(ex->host, ex->port, &hints, &res) != 0) {
+        return -1;
+    }
+    
+    for (ai = res; ai; ai = ai->ai_next) {
+        struct pollfd pfd;
+        socklen_t len = sizeof(int);
+        int err = 0;
+        
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            if (errno != EINPROGRESS) {
+                err = errno;
+            } else {
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                if (poll(&pfd, 1, EXPORT_CONNECT_TIMEOUT_MS) != 1 ||
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) {
+                    err = ETIMEDOUT;
+                }
+            }
+        }
+        if (err == 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK) == 0) {
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+            setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    
+    ex->fd = fd;
+    return fd >= 0 ? 0 : -1;
+}
+
+/* Connect if the retry is due, backing off while the collector is away */
+static void try_connect(exporter_t *ex) {
+    uint64_t now = monotonic_ns();
+    
+    if (ex->fd >= 0 || now < ex->retry_at_ns) {
+        return;
+    }
+    
+    if (connect_collector(ex) == 0) {
+        log_info("Connected to collector %s:%s", ex->host, ex->port);
+        ex->retry_ms = EXPORT_RETRY_MIN_MS;
+        ex->warned = false;
+        pthread_mutex_lock(&ex->lock);
+        ex->stats.connects++;
+        ex->stats.connected = true;
+        pthread_mutex_unlock(&ex->lock);
+        return;
+    }
+    
+    if (!ex->warned) {
+        log_warn("Collector %s:%s is unreachable, %s until it answers", ex->host, ex->port,
+                 ex->spool_dir ? "spooling event batches" : "dropping event batches");
+        ex->warned = true;
+    }
+    ex->retry_at_ns = monotonic_ns() + (uint64_t)ex->retry_ms * 1000000ULL;
+    ex->retry_ms = ex->retry_ms * 2 > EXPORT_RETRY_MAX_MS ? EXPORT_RETRY_MAX_MS :
+                   ex->retry_ms * 2;
+}
+
+static void disconnect(exporter_t *ex) {
+    log_warn("Lost connection to collector %s:%s, %s", ex->host, ex->port,
+             ex->spool_dir ? "spooling event batches" : "dropping event batches");
+    close(ex->fd);
+    ex->fd = -1;
+    ex->warned = true;
+    ex->retry_ms = EXPORT_RETRY_MIN_MS;
+    ex->retry_at_ns = monotonic_ns() + (uint64_t)ex->retry_ms * 1000000ULL;
+    pthread_mutex_lock(&ex->lock);
+    ex->stats.send_errors++;
+    ex->stats.connected = false;
+    pthread_mutex_unlock(&ex->lock);
+}
+
+static int send_all(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Send the frame being built, disconnecting on failure */
+static int send_frame(exporter_t *ex, size_t len) {
+    if (send_all(ex->fd, ex->frame, len) != 0) {
+        disconnect(ex);
+        return -1;
+    }
+    return 0;
+}
+
+static int reserve_frame(exporter_t *ex, size_t size) {
+    unsigned char *frame;
+    
+    if (size <= ex->frame_size) {
+        return 0;
+    }
+    frame = realloc(ex->frame, size);
+    if (!frame) {
+        return -1;
+    }
+    ex->frame = frame;
+    ex->frame_size = size;
+    return 0;
+}
+
+/**
+ * Build the frame of one batch
+ * @return Frame length, or 0 on failure
+ */
+static size_t encode_batch(exporter_t *ex, const void *data, size_t len) {
+    size_t bound = ex->zs_ready ? deflateBound(&ex->zs, (uLong)len) : len;
+    unsigned char *payload;
+    size_t payload_len;
+    
+    if (len > UINT32_MAX || reserve_frame(ex, EXPORT_FRAME_HEADER_SIZE + bound) != 0) {
+        return 0;
+    }
+    payload = ex->frame + EXPORT_FRAME_HEADER_SIZE;
+    
+    if (ex->zs_ready) {
+        deflateReset(&ex->zs);
+        ex->zs.next_in = (Bytef *)data;
+        ex->zs.avail_in = (uInt)len;
+        ex->zs.next_out = payload;
+        ex->zs.avail_out = (uInt)bound;
+        if (deflate(&ex->zs, Z_FINISH) != Z_STREAM_END) {
+            return 0;
+        }
+        payload_len = bound - ex->zs.avail_out;
+    } else {
+        memcpy(payload, data, len);
+        payload_len = len;
+    }
+    
+    memcpy(ex->frame, EXPORT_FRAME_MAGIC, 4);
+    ex->frame[4] = EXPORT_FRAME_VERSION;
+    ex->frame[5] = (ex->zs_ready ? EXPORT_FLAG_GZIP : 0) |
+                   (ex->config.binary ? EXPORT_FLAG_BINARY : 0);
+    ex->frame[6] = 0;
+    ex->frame[7] = 0;
+    put_be64(ex->frame + 8, ex->stream_id);
+    put_be64(ex->frame + 16, ex->next_seq++);
+    put_be32(ex->frame + 24, (uint32_t)len);
+    put_be32(ex->frame + 28, (uint32_t)payload_len);
+    return EXPORT_FRAME_HEADER_SIZE + payload_len;
+}
+
+/* Delete the oldest spooled batch, unsent */
+static void drop_oldest(exporter_t *ex) {
+    char name[PATH_MAX];
+    struct stat st;
+    uint64_t size = 0;
+    
+    spool_name(ex, ex->spool_head, name, sizeof(name));
+    if (stat(name, &st) == 0) {
+        size = (uint64_t)st.st_size;
+    }
+    unlink(name);
+    ex->spool_head++;
+    
+    pthread_mutex_lock(&ex->lock);
+    ex->stats.batches_dropped++;
+    ex->stats.spool_batches--;
+    ex->stats.spool_bytes -= size < ex->stats.spool_bytes ? size : ex->stats.spool_bytes;
+    pthread_mutex_unlock(&ex->lock);
+}
+
+/**
+ * Write the frame being built to the spool, making room by dropping the
+ * oldest batches; written to a temporary name first, so a crash never
+ * leaves a torn batch to send
+ */
+static void spool_frame(exporter_t *ex, size_t len) {
+    char name[PATH_MAX], tmp[PATH_MAX];
+    bool written = false;
+    int fd;
+    
+    if (!ex->spool_dir || len > ex->config.spool_max_bytes) {
+        log_warn_ratelimited("Collector %s:%s unreachable, dropping event batches",
+                             ex->host, ex->port);
+        pthread_mutex_lock(&ex->lock);
+        ex->stats.batches_dropped++;
+        pthread_mutex_unlock(&ex->lock);
+        return;
+    }
+    
+    /* Only this thread changes the spool counters */
+    while (ex->spool_head < ex->spool_tail &&
+           ex->stats.spool_bytes + len > ex->config.spool_max_bytes) {
+        log_warn_ratelimited("Spool %s is full, dropping the oldest event batches",
+                             ex->spool_dir);
+        drop_oldest(ex);
+    }
+    
+    spool_name(ex, ex->spool_tail, name, sizeof(name));
+    snprintf(tmp, sizeof(tmp), "%s/.spool.tmp", ex->spool_dir);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        written = write_all(fd, ex->frame, len) == 0;
+        if (close(fd) != 0) {
+            written = false;
+        }
+        written = written && rename(tmp, name) == 0;
+    }
+    if (!written) {
+        log_warn_ratelimited("Failed to spool an event batch to %s", ex->spool_dir);
+        unlink(tmp);
+        pthread_mutex_lock(&ex->lock);
+        ex->stats.batches_dropped++;
+        pthread_mutex_unlock(&ex->lock);
+        return;
+    }
+    
+    ex->spool_tail++;
+    pthread_mutex_lock(&ex->lock);
+    ex->stats.batches_spooled++;
+    ex->stats.spool_batches++;
+    ex->stats.spool_bytes += len;
+    pthread_mutex_unlock(&ex->lock);
+}
+
+/**
+ * Send spooled batches, oldest first, while connected
+ * @param max Batches to send at most
+ * @param deadline_ns Stop after this time (0 = no limit)
+ */
+static void send_spooled(exporter_t *ex, unsigned int max, uint64_t deadline_ns) {
+    char name[PATH_MAX];
+    
+    for (unsigned int i = 0; i < max && ex->fd >= 0 && ex->spool_head < ex->spool_tail; i++) {
+        struct stat st;
+        size_t len = 0;
+        bool ok = false;
+        int fd;
+        
+        if (deadline_ns > 0 && monotonic_ns() >= deadline_ns) {
+            break;
+        }
+        
+        spool_name(ex, ex->spool_head, name, sizeof(name));
+        fd = open(name, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            if (fstat(fd, &st) == 0 && st.st_size >= EXPORT_FRAME_HEADER_SIZE &&
+                reserve_frame(ex, (size_t)st.st_size) == 0) {
+                len = (size_t)st.st_size;
+                ok = read(fd, ex->frame, len) == (ssize_t)len &&
+                     memcmp(ex->frame, EXPORT_FRAME_MAGIC, 4) == 0;
+            }
+            close(fd);
+        }
+        if (!ok) {
+            log_warn("Dropping unreadable spooled batch %s", name);
+            drop_oldest(ex);
+            continue;
+        }
+        
+        if (send_frame(ex, len) != 0) {
+            break;
+        }
+        unlink(name);
+        ex->spool_head++;
+        pthread_mutex_lock(&ex->lock);
+        ex->stats.batches_sent++;
+        ex->stats.batches_replayed++;
+        ex->stats.bytes_sent += len;
+        ex->stats.spool_batches--;
+        ex->stats.spool_bytes -= len < ex->stats.spool_bytes ? len : ex->stats.spool_bytes;
+        pthread_mutex_unlock(&ex->lock);
+    }
+}
+
+static int64_t exporter_write(void *ctx, struct iovec *blocks, unsigned int count,
+                              bool partial) {
+    exporter_t *ex = (exporter_t *)ctx;
+    int64_t written = 0;
+    
+    (void)partial;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        size_t len = encode_batch(ex, blocks[i].iov_base, blocks[i].iov_len);
+        
+        if (len == 0) {
+            log_error("Failed to encode an event batch for the collector");
+            return -1;
+        }
+        written += (int64_t)len;
+        
+        if (ex->fd >= 0 && ex->spool_head == ex->spool_tail && send_frame(ex, len) == 0) {
+            pthread_mutex_lock(&ex->lock);
+            ex->stats.batches_sent++;
+            ex->stats.bytes_sent += len;
+            pthread_mutex_unlock(&ex->lock);
+            continue;
+        }
+        spool_frame(ex, len);
+    }
+    return written;
+}
+
+static void exporter_tick(void *ctx) {
+    exporter_t *ex = (exporter_t *)ctx;
+    
+    try_connect(ex);
+    send_spooled(ex, EXPORT_REPLAY_BATCHES, 0);
+}
+
+/* Send what the spool holds for a little while, then hang up */
+static int exporter_close(void *ctx) {
+    exporter_t *ex = (exporter_t *)ctx;
+    
+    if (ex->spool_head < ex->spool_tail) {
+        try_connect(ex);
+        send_spooled(ex, UINT_MAX, monotonic_ns() + EXPORT_CLOSE_REPLAY_MS * 1000000ULL);
+        if (ex->spool_head < ex->spool_tail) {
+            log_info("%lu event batches left in %s for the next run",
+                     ex->spool_tail - ex->spool_head, ex->spool_dir);
+        }
+    }
+    
+    if (ex->fd >= 0) {
+        close(ex->fd);
+        ex->fd = -1;
+        pthread_mutex_lock(&ex->lock);
+        ex->stats.connected = false;
+        pthread_mutex_unlock(&ex->lock);
+    }
+    return 0;
+}
+
+const output_sink_backend_t exporter_backend = {
+    .write = exporter_write,
+    .tick = exporter_tick,
+    .close = exporter_close,
+};
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Find the batches an earlier run spooled and number them from 1 in the
+ * order they are to be sent
+ */
+static int open_spool(exporter_t *ex) {
+    char name[PATH_MAX], from[PATH_MAX];
+    uint64_t *seqs = NULL;
+    size_t count = 0, cap = 0;
+    struct dirent *entry;
+    struct stat st;
+    DIR *dir;
+    
+    if (mkdir(ex->spool_dir, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    dir = opendir(ex->spool_dir);
+    if (!dir) {
+        return -1;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        char *end;
+        uint64_t seq;
+        
+        if (len <= strlen(SPOOL_SUFFIX) ||
+            strcmp(entry->d_name + len - strlen(SPOOL_SUFFIX), SPOOL_SUFFIX) != 0) {
+            continue;
+        }
+        seq = strtoull(entry->d_name, &end, 10);
+        if (seq == 0 || strcmp(end, SPOOL_SUFFIX) != 0) {
+            continue;
+        }
+        if (count == cap) {
+            uint64_t *grown = realloc(seqs, (cap ? cap * 2 : 64) * sizeof(*seqs));
+            
+            if (!grown) {
+                free(seqs);
+                closedir(dir);
+                errno = ENOMEM;
+                return -1;
+            }
+            seqs = grown;
+            cap = cap ? cap * 2 : 64;
+        }
+        seqs[count++] = seq;
+    }
+    closedir(dir);
+    
+    /* Sorted, distinct and from 1: renaming to i + 1 never overwrites */
+    if (count > 0) {
+        qsort(seqs, count, sizeof(*seqs), compare_u64);
+    }
+    ex->spool_head = 1;
+    ex->spool_tail = 1;
+    for (size_t i = 0; i < count; i++) {
+        spool_name(ex, seqs[i], from, sizeof(from));
+        spool_name(ex, ex->spool_tail, name, sizeof(name));
+        if ((seqs[i] != ex->spool_tail && rename(from, name) != 0) || stat(name, &st) != 0) {
+            continue;
+        }
+        ex->spool_tail++;
+        ex->stats.spool_batches++;
+        ex->stats.spool_bytes += (uint64_t)st.st_size;
+    }
+    free(seqs);
+    
+    if (ex->stats.spool_batches > 0) {
+        log_info("Sending %lu event batches spooled in %s by an earlier run",
+                 ex->stats.spool_batches, ex->spool_dir);
+    }
+    return 0;
+}
+
+exporter_t *exporter_create(const exporter_config_t *config) {
+    struct timespec now;
+    exporter_t *ex;
+    int err;
+    
+    if (!config || !config->host || !config->port || config->gzip_level < 0 ||
+        config->gzip_level > 9) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    ex = calloc(1, sizeof(*ex));
+    if (!ex) {
+        return NULL;
+    }
+    ex->config = *config;
+    if (ex->config.spool_max_bytes == 0) {
+        ex->config.spool_max_bytes = EXPORT_DEFAULT_SPOOL_MAX;
+    }
+    ex->fd = -1;
+    ex->next_seq = 1;
+    ex->retry_ms = EXPORT_RETRY_MIN_MS;
+    pthread_mutex_init(&ex->lock, NULL);
+    
+    clock_gettime(CLOCK_REALTIME, &now);
+    ex->stream_id = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    
+    ex->host = strdup(config->host);
+    ex->port = strdup(config->port);
+    if (!ex->host || !ex->port) {
+        goto fail;
+    }
+    if (config->spool_dir) {
+        ex->spool_dir = strdup(config->spool_dir);
+        if (!ex->spool_dir || open_spool(ex) != 0) {
+            goto fail;
+        }
+    }
+    
+    if (config->gzip_level > 0) {
+        /* windowBits 15 + 16: every batch is a gzip member of its own */
+        if (deflateInit2(&ex->zs, config->gzip_level, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            errno = ENOMEM;
+            goto fail;
+        }
+        ex->zs_ready = true;
+    }
+    
+    try_connect(ex);
+    return ex;
+
+fail:
+    err = errno;
+    exporter_destroy(ex);
+    errno = err;
+    return NULL;
+}
+
+void exporter_get_stats(exporter_t *exporter, exporter_stats_t *stats) {
+    if (!exporter || !stats) {
+        return;
+    }
+    pthread_mutex_lock(&exporter->lock);
+    *stats = exporter->stats;
+    pthread_mutex_unlock(&exporter->lock);
+}
+
+void exporter_destroy(exporter_t *exporter) {
+    if (!exporter) {
+        return;
+    }
+    if (exporter->fd >= 0) {
+        close(exporter->fd);
+    }
+    if (exporter->zs_ready) {
+        deflateEnd(&exporter->zs);
+    }
+    pthread_mutex_destroy(&exporter->lock);
+    free(exporter->frame);
+    free(exporter->spool_dir);
+    free(exporter->host);
+    free(exporter->port);
+    free(exporter);
+}
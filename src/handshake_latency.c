@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * handshake_latency.c - TLS handshake latency histograms
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "include/handshake_latency.h"
+
+uint64_t handshake_latency_count(const handshake_latency_t *h) {
+    uint64_t count = 0;
+    
+    for (unsigned int i = 0; i < HANDSHAKE_LATENCY_BUCKETS; i++) {
+        count += h->buckets[i];
+    }
+    return count;
+}
+
+void handshake_latency_merge(handshake_latency_t *dst, const handshake_latency_t *src) {
+    for (unsigned int i = 0; i < HANDSHAKE_LATENCY_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->errors += src->errors;
+    dst->total_ns += src->total_ns;
+}
+
+uint64_t handshake_latency_bucket_us(unsigned int bucket) {
+    return bucket < HANDSHAKE_LATENCY_BUCKETS ? 2ULL << bucket : 0;
+}
+
+uint64_t handshake_latency_mean_us(const handshake_latency_t *h) {
+    uint64_t count = handshake_latency_count(h);
+    
+    return count > 0 ? h->total_ns / count / 1000 : 0;
+}
+
+uint64_t handshake_latency_percentile_us(const handshake_latency_t *h, double percentile) {
+    uint64_t count = handshake_latency_count(h);
+    uint64_t rank, seen = 0;
+    
+    if (count == 0) {
+        return 0;
+    }
+    if (percentile < 0) {
+        percentile = 0;
+    }
+    if (percentile > 100) {
+        percentile = 100;
+    }
+    
+    /* The handshake at this rank (from 1) in duration order */
+    rank = (uint64_t)(percentile / 100.0 * (double)count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (unsigned int i = 0; i < HANDSHAKE_LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            return handshake_latency_bucket_us(i);
+        }
+    }
+    return handshake_latency_bucket_us(HANDSHAKE_LATENCY_BUCKETS - 1);
+}
+
+int handshake_latency_format_histogram(const handshake_latency_t *h, char *buf, size_t size) {
+    size_t len = 0;
+    int n;
+    
+    if (size < 3) {
+        return -1;
+    }
+    buf[len++] = '{';
+    for (unsigned int i = 0; i < HANDSHAKE_LATENCY_BUCKETS; i++) {
+        if (h->buckets[i] == 0) {
+            continue;
+        }
+        n = snprintf(buf + len, size - len, "%s\"%" PRIu64 "\": %" PRIu64,
+                     len > 1 ? ", " : "", handshake_latency_bucket_us(i), h->buckets[i]);
+        if (n < 0 || (size_t)n >= size - len) {
+            return -1;
+        }
+        len += (size_t)n;
+    }
+    if (len + 2 > size) {
+        return -1;
+    }
+    buf[len++] = '}';
+    buf[len] = '\0';
+    return (int)len;
+}
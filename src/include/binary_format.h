@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * binary_format.h - Compact binary event format
+ * Written by the output formatter (--format binary) for high-rate
+ * capture and turned back into JSON by "crypto-tracer decode"
+ *
+ * Layout: an 8-byte header ("CTRB", version, reserved) followed by
+ * records of <type:u8> <payload length:varint> <payload>. Integers are
+ * LEB128 varints, signed ones zigzag-encoded.
+ *
+ * A STRING record appends its payload to the string dictionary; ids
+ * count up from 0 in file order. An EVENT record holds:
+ *   event kind (u8, event_kind_t), timestamp delta from the previous event
+ *   (signed varint), pid, uid, the BINARY_EVENT_STRINGS string fields
+ *   as references, file type (u8), result and exit code (signed varints),
+ *   then the event's count (varint), cgroup id (varint), the
+ *   BINARY_EVENT_TRAILING_STRINGS as references, inode, device and
+ *   exiting thread (varints, 0 = unknown), each absent in older captures
+ * A string reference is BINARY_REF_NULL, BINARY_REF_INLINE followed by
+ * <length:varint> <bytes>, or BINARY_REF_DICT_BASE + dictionary id.
+ * Readers skip record types they do not know.
+ */
+
+#ifndef __BINARY_FORMAT_H__
+#define __BINARY_FORMAT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "crypto_tracer.h"
+
+#define BINARY_MAGIC        "CTRB"
+#define BINARY_VERSION      1
+#define BINARY_HEADER_SIZE  8
+
+/* Record types */
+#define BINARY_RECORD_STRING 1
+#define BINARY_RECORD_EVENT  2
+
+/* String references */
+#define BINARY_REF_NULL      0
+#define BINARY_REF_INLINE    1
+#define BINARY_REF_DICT_BASE 2
+
+/* Dictionary limits: longer strings, and new strings once the dictionary
+ * is full, are written inline */
+#define BINARY_DICT_MAX      65536
+#define BINARY_DICT_MAX_LEN  4096
+
+/* Largest encoding of a 64-bit varint */
+#define BINARY_VARINT_MAX 10
+
+/* Number of string fields in an event record, in this order:
+ * process, exe, cmdline, file, library, library_name, function_name, flags */
+#define BINARY_EVENT_STRINGS 8
+
+/* Number of string fields after the cgroup id: container, pod */
+#define BINARY_EVENT_TRAILING_STRINGS 2
+
+/* Varint encoding; dst needs BINARY_VARINT_MAX bytes */
+size_t binary_varint_size(uint64_t value);
+size_t binary_put_varint(uint8_t *dst, uint64_t value);
+uint64_t binary_zigzag(int64_t value);
+int64_t binary_unzigzag(uint64_t value);
+
+/* Decoder
+ * binary_decoder_next() returns 1 with the next event, 0 at end of input
+ * or -1 on a malformed file. The event's strings belong to the decoder
+ * and stay valid until the next call. */
+typedef struct binary_decoder binary_decoder_t;
+
+binary_decoder_t *binary_decoder_create(FILE *input);
+int binary_decoder_next(binary_decoder_t *dec, processed_event_t *event);
+void binary_decoder_destroy(binary_decoder_t *dec);
+
+#endif /* __BINARY_FORMAT_H__ */
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * cgroup_cache.h - cgroup v2 id to container attribution cache interface
+ * Maps the cgroup id carried by every event to its cgroup path and, for
+ * container runtimes that name their cgroups after the container, the
+ * container id and Kubernetes pod UID. The cgroup tree is read once and
+ * rescanned (at most once per CGROUP_RESCAN_INTERVAL_NS) when an unknown
+ * id shows up, so events never cost a /proc or /sys read of their own.
+ */
+
+#ifndef __CGROUP_CACHE_H__
+#define __CGROUP_CACHE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Where cgroup v2 is looked for (unified, then hybrid hierarchy) */
+#define CGROUP_V2_ROOT "/sys/fs/cgroup"
+#define CGROUP_V2_HYBRID_ROOT "/sys/fs/cgroup/unified"
+
+/* Most cgroups cached; cgroups past this are not attributed */
+#define CGROUP_CACHE_MAX_ENTRIES 65536
+
+/* Least time between two rescans of the cgroup tree */
+#define CGROUP_RESCAN_INTERVAL_NS 1000000000ULL
+
+/* Short container id length, as shown by docker ps and crictl ps */
+#define CGROUP_CONTAINER_ID_LEN 12
+
+/* Longest pod UID (36 with dashes; static pods use 32 hex digits) */
+#define CGROUP_POD_UID_MAX 36
+
+/* A cached cgroup; valid until the cache is destroyed */
+typedef struct {
+    uint64_t id;               /* cgroup id (inode of its cgroupfs directory) */
+    const char *path;          /* Relative to the cgroup v2 mount, "/" for the root */
+    const char *container;     /* Short container id (NULL = not in a container) */
+    const char *pod;           /* Kubernetes pod UID (NULL = not in a pod) */
+} cgroup_info_t;
+
+/* Which cgroups --cgroup and --container select; both must match */
+typedef struct {
+    char *path;                /* Subtree, normalized to "/a/b" (NULL = any) */
+    char *container;           /* Container id prefix or pod UID (NULL = any) */
+} cgroup_selector_t;
+
+typedef struct cgroup_cache cgroup_cache_t;
+
+/* Lifecycle functions
+ * root is the cgroup v2 mount (NULL = find it); fails if there is none.
+ * A cache is not thread-safe: use one per thread. */
+cgroup_cache_t *cgroup_cache_create(const char *root);
+void cgroup_cache_destroy(cgroup_cache_t *cache);
+
+/* Lookup (rescans the tree on a miss, rate limited)
+ * @return Cached cgroup, or NULL if id is not a live cgroup */
+const cgroup_info_t *cgroup_cache_lookup(cgroup_cache_t *cache, uint64_t id);
+
+/* Ids of the outermost cgroups sel matches, after a rescan
+ * (descendants are left out: they match through their ancestor)
+ * @return Number of matching cgroups, which may exceed max */
+size_t cgroup_cache_select(cgroup_cache_t *cache, const cgroup_selector_t *sel,
+                           uint64_t *ids, size_t max);
+
+/* Selectors */
+cgroup_selector_t *cgroup_selector_create(const char *path, const char *container);
+bool cgroup_selector_matches(const cgroup_selector_t *sel, const cgroup_info_t *info);
+void cgroup_selector_destroy(cgroup_selector_t *sel);
+
+/* Container id (CGROUP_CONTAINER_ID_LEN + 1 bytes) and pod UID
+ * (CGROUP_POD_UID_MAX + 1 bytes) named by one cgroup path component
+ * @return true if either was found; the other is left empty */
+bool cgroup_parse_component(const char *name, char *container, char *pod);
+
+#endif /* __CGROUP_CACHE_H__ */
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * coalesce_table.h - Records behind the kernel's coalescing windows
+ * The kernel only counts repeats of a (process, event type, path) key;
+ * this table keeps the last record submitted for each key, so a count
+ * can be reported as an event with the path and process it belongs to
+ */
+
+#ifndef __COALESCE_TABLE_H__
+#define __COALESCE_TABLE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Same layout as struct ct_coalesce_key */
+typedef struct {
+    uint32_t pid;
+    uint32_t event_type;
+    uint64_t path_hash;
+} coalesce_key_t;
+
+typedef struct coalesce_entry {
+    coalesce_key_t key;
+    uint64_t delivered;            /* Kernel repeats already reported */
+    void *record;                  /* Copy of the last submitted record */
+    size_t size;
+    size_t capacity;
+    struct coalesce_entry *next;
+    struct coalesce_entry *pid_next; /* Chain of the per-process index */
+} coalesce_entry_t;
+
+typedef struct coalesce_table coalesce_table_t;
+
+/* Lifecycle functions */
+coalesce_table_t *coalesce_table_create(void);
+void coalesce_table_destroy(coalesce_table_t *table);
+
+/* Remember the record that opened a key's window
+ * The record is copied; an existing key keeps its delivered count.
+ * Returns 0 on success, -1 on allocation failure */
+int coalesce_table_put(coalesce_table_t *table, const coalesce_key_t *key,
+                       const void *record, size_t size);
+
+/* Entry of a key (NULL if unknown); valid until the key is removed */
+coalesce_entry_t *coalesce_table_find(coalesce_table_t *table, const coalesce_key_t *key);
+
+/* Visit every entry, or every entry of one process
+ * fn returns true to remove the entry it was given; it must not put or
+ * remove any other key */
+typedef bool (*coalesce_entry_fn)(coalesce_entry_t *entry, void *ctx);
+void coalesce_table_for_each(coalesce_table_t *table, coalesce_entry_fn fn, void *ctx);
+void coalesce_table_for_each_pid(coalesce_table_t *table, uint32_t pid,
+                                 coalesce_entry_fn fn, void *ctx);
+
+void coalesce_table_remove(coalesce_table_t *table, const coalesce_key_t *key);
+size_t coalesce_table_count(const coalesce_table_t *table);
+
+#endif /* __COALESCE_TABLE_H__ */
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * crypto_classifier.h - Compiled crypto file and library classifier
+ * One rule set, compiled once, decides whether a path is a crypto file
+ * (by extension) or a crypto library (by name) for every subsystem
+ */
+
+#ifndef __CRYPTO_CLASSIFIER_H__
+#define __CRYPTO_CLASSIFIER_H__
+
+#include <stdbool.h>
+#include "crypto_tracer.h"
+
+typedef struct crypto_classifier crypto_classifier_t;
+struct ct_crypto_extension;
+
+/* Lifecycle functions
+ * crypto_classifier_create() compiles the built-in rules;
+ * crypto_classifier_load() compiles a rule file instead. Rule file lines:
+ *   library <substring>                 e.g. "library libssl"
+ *   extension <suffix> <type>           e.g. "extension .pem certificate"
+ * where <type> is certificate, private_key or keystore. '#' starts a
+ * comment. Extensions match case-insensitively, longest suffix first. */
+crypto_classifier_t *crypto_classifier_create(void);
+crypto_classifier_t *crypto_classifier_load(const char *rules_path);
+void crypto_classifier_destroy(crypto_classifier_t *classifier);
+
+/* Classification (one pass over the path; safe to share across threads) */
+file_type_t crypto_classifier_file_type(const crypto_classifier_t *classifier, const char *path);
+bool crypto_classifier_is_library(const crypto_classifier_t *classifier, const char *path);
+
+/* Rule enumeration: every extension suffix, lower-cased, with its type */
+typedef void (*crypto_extension_fn)(const char *suffix, file_type_t type, void *ctx);
+void crypto_classifier_for_each_extension(const crypto_classifier_t *classifier,
+                                          crypto_extension_fn fn, void *ctx);
+
+/* Kernel-side prefilter table (MAX_CRYPTO_EXTENSIONS entries, see
+ * ebpf/common.h) holding every extension rule
+ * @return Entries filled, or -1 if the rules do not fit the table, in
+ *         which case the prefilter must stay off */
+int crypto_classifier_kernel_extensions(const crypto_classifier_t *classifier,
+                                        struct ct_crypto_extension *table);
+
+/* Process-wide classifier used by classify_crypto_file(), the proc scanner
+ * and the event callbacks. The built-in rules are used until
+ * crypto_classifier_set_default() installs another one, which must
+ * happen at startup before any thread classifies. */
+const crypto_classifier_t *crypto_classifier_default(void);
+void crypto_classifier_set_default(crypto_classifier_t *classifier);
+
+#endif /* __CRYPTO_CLASSIFIER_H__ */
@@ -14,6 +14,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "event_schema.h"
 
 /* Version information */
 #define CRYPTO_TRACER_VERSION "1.0.0"
@@ -34,6 +38,9 @@ typedef enum {
     CMD_SNAPSHOT,
     CMD_LIBS,
     CMD_FILES,
+    CMD_DECODE,
+    CMD_REPLAY,
+    CMD_DAEMON,
     CMD_HELP,
     CMD_VERSION
 } command_type_t;
@@ -43,14 +50,19 @@ typedef enum {
     FORMAT_JSON_STREAM = 0,
     FORMAT_JSON_ARRAY,
     FORMAT_JSON_PRETTY,
-    FORMAT_SUMMARY
+    FORMAT_SUMMARY,
+    FORMAT_BINARY                  /* Compact records, see binary_format.h */
 } output_format_t;
 
+/* Event types --rate-limit and --sample apply to (ebpf_source_t order) */
+#define RATE_LIMIT_TYPES 5
+
 /* Command-line arguments structure */
 typedef struct cli_args {
     command_type_t command;
     int duration;                  /* Duration in seconds (0 = unlimited) */
     char *output_file;             /* Output file path (NULL = stdout) */
+    char *input_file;              /* Decode: binary capture (NULL = stdin); replay: raw capture */
     output_format_t format;        /* Output format */
     int pid;                       /* Target PID (0 = all processes) */
     char *process_name;            /* Target process name (NULL = all) */
@@ -60,6 +72,40 @@ typedef struct cli_args {
     bool quiet;                    /* Quiet mode (minimal output) */
     bool no_redact;                /* Disable privacy redaction */
     bool follow_children;          /* Follow child processes */
+    bool profile_all;              /* Profile: every process, as periodic deltas */
+    int profile_interval;          /* Profile --all deltas / monitor summaries: seconds
+                                    * between them (0 = the command's default) */
+    uint32_t ringbuf_size;         /* Ring buffer bytes per probe (0 = default) */
+    bool lazy_wakeup;              /* Batch ring buffer wakeups */
+    uint32_t coalesce_window_ms;   /* Kernel-side dedupe window (0 = off) */
+    uint32_t drain_timeout_ms;     /* Longest drain of the ring buffers at exit */
+    uint32_t rate_limit[RATE_LIMIT_TYPES];   /* Events per second (0 = unlimited) */
+    uint32_t sample_every[RATE_LIMIT_TYPES]; /* Keep 1 event in N (0 = all) */
+    bool library_index;            /* Snapshot: shared library table + ids */
+    bool incremental;              /* Snapshot: rescan only new and changed processes */
+    char *state_file;              /* Snapshot --incremental: state of the previous run */
+    bool snapshot_diff;            /* Snapshot --incremental: write only what changed */
+    bool log_json;                 /* Diagnostics as JSON lines */
+    char *rules_file;              /* Crypto classification rules (NULL = built-in) */
+    char *stats_file;              /* Monitor: JSON run statistics on exit (NULL = none) */
+    char *record_file;             /* Monitor: raw ring buffer records (NULL = off) */
+    char *metrics_socket;          /* Monitor: Prometheus metrics unix socket (NULL = off) */
+    int stats_interval;            /* Monitor: seconds between JSON stats lines (0 = off) */
+    int summary_top;               /* Monitor: keys per top-K summary table (0 = write events) */
+    int gzip_level;                /* Monitor: gzip level (0 = uncompressed, -1 = not given) */
+    uint64_t rotate_bytes;         /* Monitor --output: rotate at this size (0 = never) */
+    uint32_t rotate_interval_ms;   /* Monitor --output: rotate at this age (0 = never) */
+    int rotate_keep;               /* Monitor --output: rotated files kept (0 = all) */
+    char *export_address;          /* Monitor: collector HOST:PORT (NULL = no export) */
+    char *spool_dir;               /* Monitor --export: spool while unreachable (NULL = drop) */
+    uint64_t spool_max_bytes;      /* Monitor --export: spool bound (0 = default) */
+    int ring_layout;               /* Monitor: ebpf_ring_layout_t (0 = one ring per probe) */
+    bool ordered_output;           /* Monitor: merge sharded output in timestamp order */
+    char *cgroup_filter;           /* cgroup v2 subtree to trace (NULL = all) */
+    char *container_filter;        /* Container id prefix or pod UID to trace (NULL = all) */
+    bool use_daemon;               /* Read events from a running daemon instead of BPF */
+    char *daemon_socket;           /* Daemon socket (NULL = DAEMON_DEFAULT_SOCKET) */
+    char *pin_dir;                 /* Daemon: bpffs directory for pins (NULL = default) */
     bool exit_after_parse;         /* Exit immediately after parsing (for help/version) */
 } cli_args_t;
 
@@ -71,41 +117,138 @@ typedef enum {
     FILE_TYPE_UNKNOWN
 } file_type_t;
 
-/* Processed event structure for user-space processing */
+/* Inline storage per event for short copied strings
+ * (processed_event_store_string); longer ones go to the event's
+ * overflow arena */
+#define EVENT_INLINE_STRINGS 128
+
+/* Processed event structure for user-space processing
+ * String fields are borrowed unless their EVENT_OWNS_* bit is set in
+ * owned: kernel-provided strings point into the ring buffer record and
+ * are only valid for the duration of the event callback. Consumers that
+ * keep data past the callback must copy it. When events are queued to
+ * another thread the record is first copied into the event's own record
+ * buffer, and borrowed strings point there instead. */
 typedef struct processed_event {
-    char *event_type;          /* Event type string (file_open, lib_load, etc.) */
-    char *timestamp;           /* ISO 8601 formatted timestamp */
+    const char *event_type;    /* Static event type name (file_open, lib_load, etc.) */
+    event_kind_t kind;         /* Set with event_type where events are decoded */
+    uint64_t timestamp_ns;     /* Unix time in ns (0 = unknown), formatted on output */
     uint32_t pid;              /* Process ID */
     uint32_t uid;              /* User ID */
-    char *process;             /* Process name */
-    char *exe;                 /* Executable path (enriched from /proc) */
-    char *cmdline;             /* Command line (for process_exec events) */
+    uint64_t process_start_ns; /* Process start time (boot ns, 0 = unknown) */
+    uint64_t cgroup_id;        /* cgroup v2 id (0 = unknown) */
+    const char *process;       /* Process name */
+    const char *exe;           /* Executable path (enriched from /proc) */
+    const char *cmdline;       /* Command line (for process_exec events) */
+    const char *container;     /* Short container id (enriched from the cgroup cache) */
+    const char *pod;           /* Kubernetes pod UID (enriched from the cgroup cache) */
     
     /* Event-specific fields */
-    char *file;                /* File path (for file_open events) */
-    char *library;             /* Library path (for lib_load events) */
-    char *library_name;        /* Extracted library name */
-    char *function_name;       /* Function name (for api_call events) */
+    const char *file;          /* File path (for file_open events) */
+    const char *library;       /* Library path (for lib_load events) */
+    const char *library_name;  /* Extracted library name */
+    const char *function_name; /* Function name (for api_call events) */
+    uint32_t count;            /* Events counted in the kernel: api_call calls, coalesced
+                                * file_open/lib_load repeats, or the weight of an event
+                                * kept by sampling/rate limiting (0 = one event) */
     int32_t exit_code;         /* Exit code (for process_exit events) */
+    uint32_t tid;              /* Exiting thread (for process_exit events; 0 = unknown,
+                                * taken as the leader) */
     
     /* Classification and metadata */
     file_type_t file_type;     /* Classified file type */
-    char *flags;               /* Human-readable flags (for file_open) */
+    const char *flags;         /* Human-readable flags (for file_open) */
     int32_t result;            /* System call result */
+    uint64_t inode;            /* Inode of the opened file (file_open resolved in the
+                                * kernel, 0 = unknown) */
+    uint64_t dev;              /* Its device, as stat() st_dev */
+    bool redact_paths;         /* Redact exe/file/library as they are written out
+                                * (apply_privacy_filter) */
     
-    /* Internal management */
+    /* Internal management; everything above record is cleared on reuse */
+    uint32_t owned;            /* EVENT_OWNS_* bits of heap strings to free */
+    size_t inline_used;        /* Bytes of inline_strings handed out */
+    char *record;              /* Private copy of the raw record (kept across reuse) */
+    size_t record_capacity;    /* Allocated size of record */
+    struct string_arena *overflow; /* Copied strings too long for inline_strings
+                                    * (pool events only, kept across reuse) */
+    struct event_buffer_pool *pool; /* Owning pool (NULL outside a pool) */
     bool in_use;               /* Buffer pool management flag */
     struct processed_event *next; /* For free list */
+    char inline_strings[EVENT_INLINE_STRINGS];
 } processed_event_t;
 
-/* Event buffer pool for pre-allocated events */
+/* Kind of an event: set where events are decoded, looked up from
+ * event_type for events built elsewhere */
+static inline event_kind_t processed_event_kind(const processed_event_t *event) {
+    return event->kind != EVENT_NONE ? event->kind : event_kind_from_name(event->event_type);
+}
+
+/* Set the kind of an event and its event_type name */
+static inline void processed_event_set_kind(processed_event_t *event, event_kind_t kind) {
+    event->kind = kind;
+    event->event_type = event_kind_name(kind);
+}
+
+/* Whether an event ends its process: the thread group leader's exit
+ * (other threads exiting leave the process and its PID in use) */
+static inline bool processed_event_ends_process(const processed_event_t *event) {
+    return processed_event_kind(event) == EVENT_PROCESS_EXIT &&
+           (event->tid == 0 || event->tid == event->pid);
+}
+
+/* String fields of processed_event_t, used as processed_event_t.owned bits */
+#define EVENT_OWNS_PROCESS       (1U << 0)
+#define EVENT_OWNS_EXE           (1U << 1)
+#define EVENT_OWNS_CMDLINE       (1U << 2)
+#define EVENT_OWNS_FILE          (1U << 3)
+#define EVENT_OWNS_LIBRARY       (1U << 4)
+#define EVENT_OWNS_LIBRARY_NAME  (1U << 5)
+#define EVENT_OWNS_FUNCTION_NAME (1U << 6)
+#define EVENT_OWNS_FLAGS         (1U << 7)
+
+/* Event buffer pool
+ * Events are carved out of slabs of EVENT_POOL_SLAB_EVENTS, allocated as
+ * the pool runs dry until capacity events exist. Each thread keeps up to
+ * EVENT_POOL_CACHE_MAX free events of its own, so acquire and release
+ * only take the lock to move a batch between the thread and the pool. */
+#define EVENT_POOL_SLAB_EVENTS 256
+#define EVENT_POOL_CACHE_MAX 32
+
 typedef struct event_buffer_pool {
-    processed_event_t *events;  /* Array of pre-allocated events */
-    size_t capacity;            /* Total capacity (1000) */
-    size_t in_use_count;        /* Number of events currently in use */
-    processed_event_t *free_list; /* Linked list of free events */
+    struct event_slab *slabs;   /* Slabs allocated so far */
+    size_t capacity;            /* Most events the pool grows to (default 1000) */
+    size_t allocated;           /* Events in allocated slabs */
+    atomic_size_t in_use_count; /* Number of events currently in use */
+    atomic_size_t high_water;   /* Most events in use at once */
+    uint64_t id;                /* Tells thread caches of different pools apart */
+    processed_event_t *free_list; /* Free events not held by a thread cache */
+    pthread_mutex_t lock;       /* Protects slabs, allocated and free_list */
 } event_buffer_pool_t;
 
+/* Pool occupancy */
+typedef struct {
+    size_t capacity;
+    size_t allocated;           /* Events in allocated slabs */
+    size_t in_use;
+    size_t high_water;          /* Most events in use at once */
+} event_pool_stats_t;
+
+/* Buckets of a TLS handshake latency histogram: bucket i counts the
+ * handshakes that took [2^i, 2^(i+1)) microseconds (see handshake_latency.h) */
+#define HANDSHAKE_LATENCY_BUCKETS 32
+
+/* TLS handshake latencies of one process and handshake function,
+ * cumulative or over an interval */
+typedef struct handshake_latency {
+    uint32_t pid;
+    char comm[16];
+    const char *function_name;     /* Static: SSL_connect, SSL_accept, SSL_do_handshake */
+    uint64_t buckets[HANDSHAKE_LATENCY_BUCKETS];   /* Completed handshakes */
+    uint64_t errors;               /* Failed handshakes */
+    uint64_t total_ns;             /* Sum of the completed durations */
+} handshake_latency_t;
+
 /* Profile structure for process profiling */
 typedef struct {
     char *profile_version;
@@ -145,6 +288,9 @@ typedef struct {
     } *api_calls;
     size_t api_call_count;
     
+    handshake_latency_t *tls_handshakes;   /* One per handshake function used */
+    size_t tls_handshake_count;
+    
     struct {
         int total_events;
         int libraries_loaded;
@@ -153,6 +299,19 @@ typedef struct {
     } statistics;
 } profile_t;
 
+/* Process entry of a snapshot */
+typedef struct {
+    uint32_t pid;
+    char *name;
+    char *exe;
+    char **libraries;
+    uint32_t *library_ids;         /* Ids in the snapshot's library_table (optional) */
+    size_t library_count;
+    char **open_crypto_files;
+    size_t file_count;
+    char *running_as;
+} snapshot_process_t;
+
 /* Snapshot structure for system-wide inventory */
 typedef struct {
     char *snapshot_version;
@@ -160,17 +319,10 @@ typedef struct {
     char *hostname;
     char *kernel;
     
-    struct {
-        uint32_t pid;
-        char *name;
-        char *exe;
-        char **libraries;
-        size_t library_count;
-        char **open_crypto_files;
-        size_t file_count;
-        char *running_as;
-    } *processes;
+    snapshot_process_t *processes;
     size_t process_count;
+    struct string_arena *arena;    /* Holds the process strings (see snapshot_scan) */
+    struct path_intern *library_table;  /* Interned library paths (not owned) */
     
     struct {
         int total_processes;
@@ -198,6 +350,13 @@ bool is_shutdown_requested(void);
 event_buffer_pool_t *event_buffer_pool_create(size_t capacity);
 processed_event_t *event_buffer_pool_acquire(event_buffer_pool_t *pool);
 void event_buffer_pool_release(event_buffer_pool_t *pool, processed_event_t *event);
+void processed_event_set_string(processed_event_t *event, uint32_t field, char *value);
+const char *processed_event_store_string(processed_event_t *event, uint32_t field,
+                                         const char *str, size_t len);
+void processed_event_free_strings(processed_event_t *event);
+char *processed_event_copy_record(processed_event_t *event, const void *data,
+                                  size_t size, size_t extra);
+void event_buffer_pool_get_stats(event_buffer_pool_t *pool, event_pool_stats_t *stats);
 void event_buffer_pool_destroy(event_buffer_pool_t *pool);
 
 #endif /* __CRYPTO_TRACER_H__ */
\ No newline at end of file
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * daemon.h - Event fan-out of "crypto-tracer daemon"
+ * The daemon keeps one set of probes attached and serves their events to
+ * any number of clients on a unix socket, so concurrent queries share the
+ * probes instead of loading their own. A BPF ring buffer has a single
+ * consumer position, which is why the fan-out happens here and clients
+ * do not read the (pinned) ring buffers themselves.
+ *
+ * A client connects and sends its request as "<key> <value>" lines ended
+ * by an empty line:
+ *   sources <EBPF_SOURCE_BIT() mask of the event types wanted>
+ *   pid <TGID>              (optional, default all processes)
+ *   comm <name substring>   (optional, case-insensitive)
+ * The daemon answers with a binary format stream (binary_format.h) of
+ * the matching events, decoded, classified and enriched but not redacted.
+ * A client that falls a full socket buffer behind is disconnected.
+ */
+
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "crypto_tracer.h"
+
+#define DAEMON_DEFAULT_SOCKET "/run/crypto-tracer.daemon.sock"
+#define DAEMON_DEFAULT_PIN_DIR "/sys/fs/bpf/crypto-tracer"
+
+/* Longest request a client may send */
+#define DAEMON_REQUEST_MAX 512
+
+/* Longest process name substring in a request */
+#define DAEMON_COMM_MAX 64
+
+/* What a client wants from the daemon */
+typedef struct {
+    uint32_t sources;              /* EBPF_SOURCE_BIT() mask */
+    uint32_t pid;                  /* Only this TGID (0 = all processes) */
+    char comm[DAEMON_COMM_MAX];    /* Process name substring ("" = all) */
+} daemon_request_t;
+
+/* Request encoding (length written, or -1 if buf is too small) */
+int daemon_request_format(const daemon_request_t *req, char *buf, size_t size);
+/* Request decoding (0 on success, -1 on a malformed request) */
+int daemon_request_parse(const char *text, daemon_request_t *req);
+bool daemon_request_matches(const daemon_request_t *req, const processed_event_t *event);
+
+/* Client side: connect and send the request
+ * @return Connected socket, or -1 on failure (logged) */
+int daemon_connect(const char *path, const daemon_request_t *req);
+
+/* Server
+ * The socket is created mode 0600; an existing socket at path is
+ * replaced. Clients are accepted on their own thread; events are
+ * published and flushed from the polling thread. */
+typedef struct daemon_server daemon_server_t;
+
+daemon_server_t *daemon_server_start(const char *path);
+unsigned int daemon_server_client_count(daemon_server_t *server);
+void daemon_server_publish(daemon_server_t *server, processed_event_t *event);
+void daemon_server_flush(daemon_server_t *server);
+void daemon_server_stop(daemon_server_t *server);
+
+#endif /* __DAEMON_H__ */
@@ -7,21 +7,181 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "spsc_queue.h"
+#include "raw_capture.h"
+
+/* Most events the pool grows to (bounds events in flight to a consumer thread) */
+#define EBPF_EVENT_POOL_CAPACITY 16384
+
+/* Most cgroups the kernel-side process filter holds (MAX_FILTER_CGROUPS) */
+#define EBPF_MAX_FILTER_CGROUPS 256
 
 /* Forward declarations */
 struct ebpf_manager;
 struct processed_event;
+struct handshake_latency;
 
 /* Event callback function type */
 typedef int (*event_callback_t)(struct processed_event *event, void *ctx);
 
+/* Returned by a consumer callback that keeps the event (sharded layout);
+ * the event must then be passed to ebpf_manager_complete_event() */
+#define EBPF_EVENT_RETAINED 1
+
+/* Called once per drained batch, after its events were dispatched */
+typedef void (*batch_callback_t)(uint32_t events, void *ctx);
+
+/* Called with the TLS handshakes of one process and function since the
+ * last read (see ebpf_manager_read_handshake_latency) */
+typedef void (*handshake_callback_t)(const struct handshake_latency *delta, void *ctx);
+
+/* Event sources - one per BPF program, each with its own ring buffer */
+typedef enum {
+    EBPF_SOURCE_FILE_OPEN = 0,
+    EBPF_SOURCE_LIB_LOAD,
+    EBPF_SOURCE_PROCESS_EXEC,
+    EBPF_SOURCE_PROCESS_EXIT,
+    EBPF_SOURCE_OPENSSL_API,
+    EBPF_SOURCE_COUNT
+} ebpf_source_t;
+
+/* Source bitmasks for ebpf_manager_set_sources() */
+#define EBPF_SOURCE_BIT(source) (1U << (source))
+#define EBPF_SOURCES_ALL ((1U << EBPF_SOURCE_COUNT) - 1)
+
+/* Per-source statistics */
+typedef struct {
+    bool attached;                 /* Source ring buffer is being drained */
+    uint64_t events_received;      /* Records consumed from the source ring buffer */
+    uint64_t kernel_filtered;      /* Events dropped by in-kernel filters (all kinds) */
+    uint64_t ringbuf_full;         /* Events lost in the kernel to a full ring buffer */
+    uint64_t coalesced;            /* Repeats counted in the kernel instead of submitted */
+    uint64_t sampled_out;          /* Events skipped by 1-in-N sampling */
+    uint64_t rate_limited;         /* Events over the source's rate limit */
+    uint64_t load_ns;              /* Open, verification and load time */
+    uint64_t attach_ns;            /* Attach time */
+    uint64_t prog_run_count;       /* Runs of the source's programs (kernel BPF stats) */
+    uint64_t prog_run_ns;          /* Their run time (kernel BPF stats) */
+    uint64_t ringbuf_size;         /* Ring buffer bytes (0 = unknown) */
+    uint64_t ringbuf_pending;      /* Bytes waiting at the last drain */
+    uint64_t ringbuf_pending_max;  /* Most bytes waiting at any drain */
+} ebpf_source_stats_t;
+
+/* Ring buffer configuration, applied when the programs are loaded */
+typedef struct {
+    uint32_t size;                 /* Bytes per program (power of two, page multiple; 0 = 1 MB) */
+    bool lazy_wakeup;              /* Wake the consumer only past a fill watermark */
+} ebpf_ringbuf_config_t;
+
+/* Ring buffer layout, chosen before the programs are loaded
+ * The sharded layouts replace the program ring buffers with rings shared
+ * by all programs, one per CPU or per NUMA node. Each NUMA node's rings
+ * are drained by their own consumer (ebpf_manager_poll_consumer()), so
+ * capture scales with the nodes instead of being bound to one thread. */
+typedef enum {
+    EBPF_RINGS_PER_PROGRAM = 0,    /* One ring per program, drained by ebpf_manager_poll_events() */
+    EBPF_RINGS_PER_CPU,            /* One ring per CPU, one consumer per NUMA node */
+    EBPF_RINGS_PER_NODE,           /* One ring and one consumer per NUMA node */
+} ebpf_ring_layout_t;
+
+/* Process filter pushed into the kernel
+ * Every probe checks it before touching its ring buffer; unset fields
+ * do not filter. User-space filters still run on whatever gets through. */
+typedef struct {
+    uint32_t pid;                  /* Target TGID (0 = all processes) */
+    const char *comm;              /* Comm substring, case-insensitive (NULL = all) */
+    bool filter_uid;               /* Restrict events to uid */
+    uint32_t uid;                  /* Target UID (if filter_uid) */
+    bool follow_children;          /* Add children forked by pid to the filter */
+    const uint64_t *cgroup_ids;    /* cgroup v2 ids; their subtrees pass (see cgroup_cache.h) */
+    size_t cgroup_count;           /* Entries in cgroup_ids (0 = all cgroups) */
+} ebpf_process_filter_t;
+
+/* Kernel-side rate limit and sampling of one source's events
+ * Suppressed events are not lost to the counts: each submitted event
+ * carries the number of events it stands for (processed_event_t.count). */
+typedef struct {
+    uint32_t rate;                 /* Events per second (0 = unlimited) */
+    uint32_t burst;                /* Events allowed at once (0 = rate) */
+    uint32_t sample_every;         /* Keep 1 event in N (0 or 1 = all) */
+} ebpf_rate_limit_t;
+
+/* Ring buffer draining policy for ebpf_manager_poll_events() */
+typedef struct {
+    uint32_t budget;               /* Records drained per poll (0 = default) */
+    int idle_timeout_ms;           /* Longest wait for records when idle (0 = default) */
+    batch_callback_t on_batch;     /* Batch completion hook, e.g. flush output (optional) */
+    void *batch_ctx;               /* Context passed to on_batch */
+} ebpf_poll_config_t;
+
+/* Consumer cost, measured while polling */
+typedef struct {
+    uint64_t events;               /* Events measured */
+    uint64_t latency_p50_ns;       /* Capture to callback return, upper bound of */
+    uint64_t latency_p99_ns;       /*   the power-of-two latency bucket */
+    uint64_t latency_max_ns;
+    uint64_t cpu_ns_per_event;     /* Consumer thread CPU time per event */
+    uint64_t batches;              /* Polls that drained at least one record */
+    uint64_t busy_polls;           /* Polls that exhausted the budget */
+    uint64_t pool_allocated;       /* Events in allocated pool slabs */
+    uint64_t pool_high_water;      /* Most events in flight at once */
+    uint64_t pool_capacity;
+} ebpf_consumer_stats_t;
+
+/* Shutdown cost (see ebpf_manager_stop_events) */
+typedef struct {
+    uint64_t drain_events;         /* Records drained after production stopped */
+    uint64_t drain_ns;             /* Time to drain them */
+    uint64_t drain_left_bytes;     /* Left unread at the drain deadline (0 = none) */
+    uint64_t teardown_ns;          /* Detach and destroy (0 until ebpf_manager_cleanup) */
+} ebpf_shutdown_stats_t;
+
 /* Function prototypes */
 struct ebpf_manager *ebpf_manager_create(void);
+int ebpf_manager_set_ringbuf_config(struct ebpf_manager *mgr, const ebpf_ringbuf_config_t *config);
+int ebpf_manager_set_api_aggregation(struct ebpf_manager *mgr, bool enable);
+int ebpf_manager_set_handshake_latency(struct ebpf_manager *mgr, bool enable);
+int ebpf_manager_set_sources(struct ebpf_manager *mgr, uint32_t sources);
+int ebpf_manager_set_coalesce_window(struct ebpf_manager *mgr, uint32_t window_ms);
+int ebpf_manager_set_ring_layout(struct ebpf_manager *mgr, ebpf_ring_layout_t layout);
+int ebpf_manager_use_daemon(struct ebpf_manager *mgr, const char *socket_path);
 int ebpf_manager_load_programs(struct ebpf_manager *mgr);
+int ebpf_manager_set_process_filter(struct ebpf_manager *mgr, const ebpf_process_filter_t *filter);
+bool ebpf_manager_follows_children(struct ebpf_manager *mgr);
+bool ebpf_manager_filters_cgroups(struct ebpf_manager *mgr);
+int ebpf_manager_stop_events(struct ebpf_manager *mgr);
+int ebpf_manager_set_rate_limit(struct ebpf_manager *mgr, ebpf_source_t source,
+                                const ebpf_rate_limit_t *limit);
 int ebpf_manager_attach_programs(struct ebpf_manager *mgr);
+int ebpf_manager_pin(struct ebpf_manager *mgr, const char *dir);
+void ebpf_manager_unpin(struct ebpf_manager *mgr);
+int ebpf_manager_set_poll_config(struct ebpf_manager *mgr, const ebpf_poll_config_t *config);
+int ebpf_manager_set_event_queue(struct ebpf_manager *mgr, spsc_queue_t *queue);
+int ebpf_manager_set_raw_writer(struct ebpf_manager *mgr, raw_writer_t *writer);
+int ebpf_manager_replay(struct ebpf_manager *mgr, raw_reader_t *reader,
+                        event_callback_t callback, void *ctx);
 int ebpf_manager_poll_events(struct ebpf_manager *mgr, event_callback_t callback, void *ctx);
+unsigned int ebpf_manager_consumer_count(struct ebpf_manager *mgr);
+int ebpf_manager_bind_consumer(struct ebpf_manager *mgr, unsigned int consumer);
+int ebpf_manager_poll_consumer(struct ebpf_manager *mgr, unsigned int consumer,
+                               event_callback_t callback, void *ctx);
+uint64_t ebpf_manager_consumer_watermark(struct ebpf_manager *mgr, unsigned int consumer);
+int ebpf_manager_drain(struct ebpf_manager *mgr, event_callback_t callback, void *ctx,
+                       uint32_t timeout_ms);
+int ebpf_manager_drain_consumer(struct ebpf_manager *mgr, unsigned int consumer,
+                                event_callback_t callback, void *ctx, uint32_t timeout_ms);
+int ebpf_manager_read_api_counts(struct ebpf_manager *mgr, event_callback_t callback, void *ctx);
+int ebpf_manager_read_handshake_latency(struct ebpf_manager *mgr, handshake_callback_t callback,
+                                        void *ctx);
+int ebpf_manager_flush_coalesced(struct ebpf_manager *mgr);
+void ebpf_manager_complete_event(struct ebpf_manager *mgr, struct processed_event *event);
 void ebpf_manager_cleanup(struct ebpf_manager *mgr);
 void ebpf_manager_destroy(struct ebpf_manager *mgr);
 void ebpf_manager_get_stats(struct ebpf_manager *mgr, uint64_t *events_processed, uint64_t *events_dropped);
+int ebpf_manager_get_source_stats(struct ebpf_manager *mgr, ebpf_source_t source, ebpf_source_stats_t *stats);
+int ebpf_manager_get_consumer_stats(struct ebpf_manager *mgr, ebpf_consumer_stats_t *stats);
+int ebpf_manager_get_shutdown_stats(struct ebpf_manager *mgr, ebpf_shutdown_stats_t *stats);
+int ebpf_manager_enable_program_stats(struct ebpf_manager *mgr);
+const char *ebpf_source_name(ebpf_source_t source);
 
 #endif /* __EBPF_MANAGER_H__ */
\ No newline at end of file
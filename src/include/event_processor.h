@@ -16,6 +16,8 @@
 #include <stddef.h>
 #include <sys/types.h>
 #include "crypto_tracer.h"
+#include "proc_cache.h"
+#include "cgroup_cache.h"
 
 /* Forward declaration */
 struct ct_event_header;
@@ -44,13 +46,27 @@ typedef struct filter {
 typedef struct filter_set {
     filter_t *filters;              /* Linked list of filters */
     size_t count;                   /* Number of filters */
+    struct filter_program *program; /* Compiled filters (see filter_set_add) */
 } filter_set_t;
 
+/* Result of evaluating filters on a partially enriched event */
+typedef enum {
+    FILTER_REJECT = 0,
+    FILTER_MATCH,
+    FILTER_UNDECIDED                /* Passed so far; needs the /proc process name */
+} filter_verdict_t;
+
 /* Event processor structure */
 typedef struct event_processor {
     filter_set_t *filters;          /* Filter set */
     cli_args_t *args;               /* CLI arguments for configuration */
     bool redact_paths;              /* Enable path redaction */
+    proc_cache_t *cache;            /* /proc enrichment cache (NULL = uncached) */
+    cgroup_cache_t *cgroups;        /* Container attribution (NULL = no cgroup v2) */
+    cgroup_selector_t *cgroup_filter; /* --cgroup/--container (NULL = all) */
+    bool cgroups_in_kernel;         /* The kernel already dropped other cgroups' events */
+    bool copy_enrichment;           /* Events outlive the next enrichment: copy the
+                                     * cached strings into them */
 } event_processor_t;
 
 /* Event processor lifecycle functions */
@@ -60,6 +76,7 @@ void event_processor_destroy(event_processor_t *proc);
 /* Filter management functions */
 int event_processor_add_filter(event_processor_t *proc, filter_type_t type, const void *value);
 bool event_processor_matches_filters(event_processor_t *proc, processed_event_t *event);
+filter_verdict_t event_processor_prefilter(event_processor_t *proc, const processed_event_t *event);
 
 /* Event processing functions */
 int event_processor_process_event(event_processor_t *proc, 
@@ -71,16 +88,19 @@ int enrich_process_name(pid_t pid, char **process_name);
 int enrich_executable_path(pid_t pid, char **exe_path);
 int enrich_cmdline(pid_t pid, char **cmdline);
 int enrich_event(processed_event_t *event);
+int event_processor_enrich(event_processor_t *proc, processed_event_t *event);
 
 /* Classification functions */
 file_type_t classify_crypto_file(const char *path);
 const char *file_type_to_string(file_type_t type);
 char *extract_library_name(const char *library_path);
+const char *library_name_span(const char *library_path, size_t *len);
 
 /* Filter set functions */
 filter_set_t *filter_set_create(void);
 int filter_set_add(filter_set_t *set, filter_type_t type, const void *value);
 bool filter_set_matches(filter_set_t *set, processed_event_t *event);
+filter_verdict_t filter_set_evaluate(const filter_set_t *set, const processed_event_t *event);
 void filter_set_destroy(filter_set_t *set);
 
 /* Helper functions for pattern matching */
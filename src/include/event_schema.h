@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * event_schema.h - The event types and the fields each one carries
+ * EVENT_SCHEMA has one entry per event type: its kind, the name written
+ * as event_type, and its field list, in output order, after the fields
+ * every event has (event_type, timestamp, pid, uid, process, container,
+ * pod) and before its count. A field is F(TYPE, member): member is both
+ * the processed_event_t member and the JSON key, TYPE how it is written:
+ *   PATH       a path, redacted as the event asks
+ *   STRING     a string
+ *   INT        a signed integer
+ *   FILE_TYPE  a file_type_t, by name
+ *   OPT_UINT   an unsigned integer, left out when 0
+ * The kind enum, event_type names, binary format codes, kernel record
+ * decoder table and JSON writers are generated from it, so a new event
+ * type is one entry here plus its kernel decoder. Kinds number from 1 in
+ * schema order and equal the kernel's enum ct_event_type and the binary
+ * format's event type codes.
+ */
+
+#ifndef __EVENT_SCHEMA_H__
+#define __EVENT_SCHEMA_H__
+
+#define EVENT_FILE_OPEN_FIELDS(F) \
+    F(PATH, exe) F(PATH, file) F(FILE_TYPE, file_type) F(STRING, flags) F(INT, result) \
+    F(OPT_UINT, inode) F(OPT_UINT, dev)
+#define EVENT_LIB_LOAD_FIELDS(F) \
+    F(PATH, exe) F(PATH, library) F(STRING, library_name)
+#define EVENT_PROCESS_EXEC_FIELDS(F) \
+    F(PATH, exe) F(STRING, cmdline)
+#define EVENT_PROCESS_EXIT_FIELDS(F) \
+    F(INT, exit_code) F(OPT_UINT, tid)
+#define EVENT_API_CALL_FIELDS(F) \
+    F(PATH, exe) F(STRING, function_name) F(PATH, library)
+
+/* X(KIND, name, FIELDS) */
+#define EVENT_SCHEMA(X) \
+    X(FILE_OPEN, file_open, EVENT_FILE_OPEN_FIELDS) \
+    X(LIB_LOAD, lib_load, EVENT_LIB_LOAD_FIELDS) \
+    X(PROCESS_EXEC, process_exec, EVENT_PROCESS_EXEC_FIELDS) \
+    X(PROCESS_EXIT, process_exit, EVENT_PROCESS_EXIT_FIELDS) \
+    X(API_CALL, api_call, EVENT_API_CALL_FIELDS)
+
+typedef enum {
+    EVENT_NONE = 0,                /* Unknown or not set */
+#define EVENT_SCHEMA_KIND(kind, name, fields) EVENT_##kind,
+    EVENT_SCHEMA(EVENT_SCHEMA_KIND)
+#undef EVENT_SCHEMA_KIND
+    EVENT_KIND_COUNT
+} event_kind_t;
+
+/* Name of a kind, as written in event_type (NULL for EVENT_NONE and
+ * out of range values) */
+const char *event_kind_name(event_kind_t kind);
+
+/* Kind of an event_type name (EVENT_NONE if unknown) */
+event_kind_t event_kind_from_name(const char *name);
+
+#endif /* __EVENT_SCHEMA_H__ */
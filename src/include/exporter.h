@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * exporter.h - Batched export of the monitor output to a collector
+ * The exporter is an output sink backend: the event output (JSON lines or
+ * the binary format) fills the sink's blocks, and each block the writer
+ * thread takes becomes one batch, gzip-compressed and sent as a frame over
+ * a persistent TCP connection. While the collector is unreachable, batches
+ * are spooled to a directory, bounded in size with the oldest dropped
+ * first, and sent in order once it is back; batches still spooled at exit
+ * are sent by the next run using the same directory.
+ */
+
+#ifndef __EXPORTER_H__
+#define __EXPORTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "output_sink.h"
+
+/**
+ * Frame on the wire (and in a spool file): a 32 byte header, big-endian,
+ * followed by the payload
+ *   0  magic "CTEX"
+ *   4  version (1)
+ *   5  flags (EXPORT_FLAG_*)
+ *   6  reserved (0)
+ *   8  stream id: the exporting run, its start time in ns since the epoch
+ *   16 sequence: the batch number within the stream, from 1
+ *   24 raw length: payload bytes before compression
+ *   28 payload length
+ * A gap in the sequence of a stream means batches were dropped. The
+ * payloads of a stream concatenated in sequence order are the output
+ * file the run would have written.
+ */
+#define EXPORT_FRAME_MAGIC "CTEX"
+#define EXPORT_FRAME_VERSION 1
+#define EXPORT_FRAME_HEADER_SIZE 32
+#define EXPORT_FLAG_GZIP 0x01      /* Payload is one gzip member */
+#define EXPORT_FLAG_BINARY 0x02    /* Payload is the binary event format */
+
+/* Spool bound when none is given */
+#define EXPORT_DEFAULT_SPOOL_MAX (1024ULL * 1024 * 1024)
+
+typedef struct {
+    const char *host;
+    const char *port;
+    int gzip_level;                /* 1-9, 0 = send uncompressed */
+    bool binary;                   /* The output is the binary format */
+    const char *spool_dir;         /* NULL = drop batches while disconnected */
+    uint64_t spool_max_bytes;      /* Spool bound (0 = EXPORT_DEFAULT_SPOOL_MAX) */
+} exporter_config_t;
+
+typedef struct {
+    uint64_t batches_sent;         /* Sent directly or from the spool */
+    uint64_t bytes_sent;           /* Frame bytes sent */
+    uint64_t batches_spooled;      /* Written to the spool */
+    uint64_t batches_replayed;     /* Sent from the spool */
+    uint64_t batches_dropped;      /* Lost: no spool, spool full or unreadable */
+    uint64_t spool_batches;        /* In the spool now */
+    uint64_t spool_bytes;
+    uint64_t connects;             /* Connections made */
+    uint64_t send_errors;          /* Connections lost */
+    bool connected;
+} exporter_stats_t;
+
+typedef struct exporter exporter_t;
+
+/* The sink backend: output_sink_open_backend(&exporter_backend, exporter).
+ * Closing the sink sends what it can and disconnects; the exporter stays
+ * valid for exporter_get_stats() until exporter_destroy(). */
+extern const output_sink_backend_t exporter_backend;
+
+/**
+ * Split HOST:PORT or [IPV6]:PORT
+ * @return 0 on success, -1 if the address is malformed
+ */
+int exporter_parse_address(const char *address, char *host, size_t host_size,
+                           char *port, size_t port_size);
+
+/**
+ * Create an exporter and make the first connection attempt
+ * An unreachable collector is not an error: batches are spooled until it
+ * answers. Batches an earlier run left in the spool directory are sent
+ * first.
+ * @return NULL if the spool directory cannot be used (errno set)
+ */
+exporter_t *exporter_create(const exporter_config_t *config);
+
+/* Current statistics; safe from any thread */
+void exporter_get_stats(exporter_t *exporter, exporter_stats_t *stats);
+
+void exporter_destroy(exporter_t *exporter);
+
+#endif /* __EXPORTER_H__ */
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * handshake_latency.h - TLS handshake latency histograms
+ * The kernel times each handshake from the first SSL_connect, SSL_accept
+ * or SSL_do_handshake call on an SSL object to the call that completes
+ * it, and counts it in a log2 histogram per process and function; these
+ * helpers merge such histograms and summarize them for the profile and
+ * summary outputs. Percentiles are the upper bound of the bucket they
+ * fall in, so they are accurate to a factor of two.
+ */
+
+#ifndef __HANDSHAKE_LATENCY_H__
+#define __HANDSHAKE_LATENCY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "crypto_tracer.h"
+
+/* Room handshake_latency_format_histogram() needs for any histogram */
+#define HANDSHAKE_LATENCY_JSON_MAX 1280
+
+/* Completed handshakes */
+uint64_t handshake_latency_count(const handshake_latency_t *h);
+
+/* Add the counts of src to dst */
+void handshake_latency_merge(handshake_latency_t *dst, const handshake_latency_t *src);
+
+/* Upper bound of a bucket, in microseconds */
+uint64_t handshake_latency_bucket_us(unsigned int bucket);
+
+/* Mean duration of the completed handshakes, in microseconds (0 if none) */
+uint64_t handshake_latency_mean_us(const handshake_latency_t *h);
+
+/* Upper bound of the bucket holding the given percentile (0-100), in
+ * microseconds (0 if none completed) */
+uint64_t handshake_latency_percentile_us(const handshake_latency_t *h, double percentile);
+
+/* Format the non-empty buckets as a JSON object from bucket upper bound
+ * (microseconds) to count, e.g. {"1024": 3, "2048": 1}
+ * @return Length written, or -1 if buf is too small */
+int handshake_latency_format_histogram(const handshake_latency_t *h, char *buf, size_t size);
+
+#endif /* __HANDSHAKE_LATENCY_H__ */
@@ -6,6 +6,11 @@
 /**
  * logger.h - Structured logging and diagnostics system
  * Provides INFO, WARN, ERROR, and DEBUG level logging with helpful error messages
+ *
+ * Once logger_start_async() has run, log calls format their message into
+ * a lock-free queue and return; a writer thread does the I/O. A full
+ * queue drops the message and counts it instead of waiting, so a stalled
+ * stderr never stalls the caller.
  */
 
 #ifndef __LOGGER_H__
@@ -13,6 +18,9 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
 
 /* Log levels */
 typedef enum {
@@ -22,12 +30,19 @@ typedef enum {
     LOG_LEVEL_ERROR       /* Error messages */
 } log_level_t;
 
+/* Log line formats */
+typedef enum {
+    LOG_FORMAT_TEXT = 0,  /* [LEVEL] message */
+    LOG_FORMAT_JSON       /* One JSON object per line */
+} log_format_t;
+
 /* Logger configuration */
 typedef struct {
     log_level_t min_level;  /* Minimum level to log */
     bool quiet;             /* Suppress all non-error output */
     bool verbose;           /* Enable debug output */
     FILE *output;           /* Output stream (default: stderr) */
+    log_format_t format;    /* Line format (default: text) */
 } logger_config_t;
 
 /* Initialize the logger with configuration */
@@ -42,12 +57,57 @@ void logger_set_quiet(bool quiet);
 /* Set verbose mode */
 void logger_set_verbose(bool verbose);
 
+/* Set the line format */
+void logger_set_format(log_format_t format);
+
+/* Asynchronous output
+ * logger_start_async() starts the writer thread (0 on success, -1 on
+ * failure, in which case logging stays synchronous). logger_flush()
+ * writes everything queued so far before returning. logger_shutdown()
+ * stops the writer, writes what is left and reports messages still
+ * suppressed by rate limiting; call it once before exiting. */
+int logger_start_async(void);
+void logger_flush(void);
+void logger_shutdown(void);
+
+/* Messages dropped because the queue was full */
+uint64_t logger_dropped(void);
+
 /* Core logging functions */
 void log_debug(const char *format, ...) __attribute__((format(printf, 1, 2)));
 void log_info(const char *format, ...) __attribute__((format(printf, 1, 2)));
 void log_warn(const char *format, ...) __attribute__((format(printf, 1, 2)));
 void log_error(const char *format, ...) __attribute__((format(printf, 1, 2)));
 
+/* Per-call-site rate limiting
+ * Each call site may log LOG_RATELIMIT_BURST messages per
+ * LOG_RATELIMIT_INTERVAL_NS; the rest are only counted, and the next
+ * message written from that site says how many were suppressed */
+#define LOG_RATELIMIT_BURST 10
+#define LOG_RATELIMIT_INTERVAL_NS 5000000000ULL
+#define LOG_SUMMARY_MAX 128
+
+typedef struct log_ratelimit {
+    _Atomic uint64_t window_start_ns;
+    _Atomic uint32_t count;              /* Messages in the current window */
+    _Atomic bool listed;                 /* On the list logger_shutdown() reports */
+    log_level_t level;
+    struct log_ratelimit *next;
+    char last[LOG_SUMMARY_MAX];          /* Last message written from this site */
+} log_ratelimit_t;
+
+void log_message_ratelimited(log_ratelimit_t *site, log_level_t level, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define log_ratelimited(level, ...) \
+    do { \
+        static log_ratelimit_t log_site_; \
+        log_message_ratelimited(&log_site_, (level), __VA_ARGS__); \
+    } while (0)
+
+#define log_debug_ratelimited(...) log_ratelimited(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_warn_ratelimited(...) log_ratelimited(LOG_LEVEL_WARN, __VA_ARGS__)
+
 /* Logging with suggestions for error resolution */
 void log_error_with_suggestion(const char *error_msg, const char *suggestion);
 
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * metrics.h - Live run metrics: Prometheus text and JSON stats lines
+ * Metrics are rendered on the polling thread, which owns the eBPF
+ * manager's counters, and combine the per-source kernel counters, ring
+ * buffer fill, BPF program run time and the pipeline stage histograms.
+ * The metrics server serves the last published rendering on a unix
+ * socket, to plain readers (socat) and HTTP clients
+ * (curl --unix-socket PATH http://localhost/metrics) alike.
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ebpf_manager.h"
+
+/* Counters kept outside the manager, by the event callback */
+typedef struct {
+    uint64_t uptime_ns;            /* Since monitoring started */
+    uint64_t events_processed;     /* Events handed to the event callback */
+    uint64_t events_filtered;      /* Events the callback filtered out */
+} metrics_counters_t;
+
+/* Rendering (malloc'd text, 0 on success, -1 on allocation failure) */
+int metrics_render_prometheus(struct ebpf_manager *mgr, const metrics_counters_t *counters,
+                              char **text, size_t *len);
+int metrics_render_json(struct ebpf_manager *mgr, const metrics_counters_t *counters,
+                        char **text, size_t *len);
+
+/* Write the stage histograms as a "stages" JSON member */
+void metrics_write_stages_json(FILE *fp);
+
+/* Unix socket server
+ * The socket is created mode 0600; an existing socket at path is
+ * replaced. Serving runs on its own thread. */
+typedef struct metrics_server metrics_server_t;
+
+metrics_server_t *metrics_server_start(const char *path);
+/* Replace the served text (takes ownership of text) */
+void metrics_server_publish(metrics_server_t *server, char *text, size_t len);
+void metrics_server_stop(metrics_server_t *server);
+
+#endif /* __METRICS_H__ */
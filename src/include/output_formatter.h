@@ -22,6 +22,16 @@ typedef struct output_formatter {
     FILE *output;                   /* Output file handle */
     bool first_event;               /* Track first event for JSON array */
     bool array_started;             /* Track if JSON array has been started */
+    bool batched;                   /* Flush in output_formatter_flush(), not per event */
+    bool library_index;             /* Snapshot libraries as a shared table + ids */
+    char *buf;                      /* Output buffer, written with one fwrite per flush */
+    size_t buf_len;                 /* Bytes buffered */
+    size_t buf_size;                /* Buffer capacity, sized for the output device */
+    bool failed;                    /* A write failed since the last flush */
+    bool whole_records;             /* Only hand complete events to the stream */
+    size_t record_start;            /* Start of the event being written */
+    struct path_intern *dictionary; /* Binary format: strings already defined */
+    uint64_t last_timestamp_ns;     /* Binary format: timestamp of the previous event */
 } output_formatter_t;
 
 /* Lifecycle functions */
@@ -32,10 +42,24 @@ void output_formatter_destroy(output_formatter_t *fmt);
 int output_formatter_write_event(output_formatter_t *fmt, processed_event_t *event);
 int output_formatter_write_profile(output_formatter_t *fmt, profile_t *profile);
 int output_formatter_write_snapshot(output_formatter_t *fmt, snapshot_t *snapshot);
+int output_formatter_write_snapshot_diff(output_formatter_t *fmt, snapshot_t *snapshot,
+                                         snapshot_t *added, snapshot_t *removed,
+                                         const char *since);
 int output_formatter_finalize(output_formatter_t *fmt);
 
+/* Batched output */
+void output_formatter_set_batching(output_formatter_t *fmt, bool batched);
+void output_formatter_set_whole_records(output_formatter_t *fmt, bool whole_records);
+int output_formatter_flush(output_formatter_t *fmt);
+
+/* Snapshot layout: emit a top-level "libraries" table once and refer to
+ * it from each process through "library_ids" */
+void output_formatter_set_library_index(output_formatter_t *fmt, bool library_index);
+
 /* Timestamp formatting */
+#define ISO8601_TIMESTAMP_SIZE 64
 char *format_timestamp_iso8601(uint64_t timestamp_ns);
+char *format_timestamp_iso8601_r(uint64_t timestamp_ns, char *buf, size_t buf_size);
 
 /* JSON escaping */
 char *json_escape_string(const char *str);
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * output_sink.h - Asynchronous, rotating, compressed output file
+ * The sink is a stdio stream, so the output formatter and everything else
+ * that writes to the output keeps writing to a FILE*. Writes are copied
+ * into large blocks; a writer thread compresses full blocks (gzip) and
+ * writes them with O_APPEND, several at a time with writev when
+ * uncompressed, and rotates the file by size or age. Blocks are bounded:
+ * when every block is waiting for the disk, writers wait too, and the
+ * wait is counted and logged rather than growing memory. The writer
+ * thread hands the blocks to a backend: the output file, or the exporter.
+ */
+
+#ifndef __OUTPUT_SINK_H__
+#define __OUTPUT_SINK_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+/* Blocks a write is copied into, and the size of each */
+#define OUTPUT_SINK_BLOCKS 4
+#define OUTPUT_SINK_BLOCK_SIZE (1024 * 1024)
+
+/* How long a partly filled block may wait before it is written */
+#define OUTPUT_SINK_LINGER_MS 1000
+
+typedef struct {
+    const char *path;
+    int gzip_level;                /* 1-9, 0 = uncompressed */
+    uint64_t rotate_bytes;         /* Rotate once the file is this big (0 = never) */
+    uint32_t rotate_ms;            /* Rotate once the file is this old (0 = never) */
+    unsigned int rotate_keep;      /* Rotated files kept (0 = all) */
+} output_sink_config_t;
+
+typedef struct {
+    uint64_t bytes_in;             /* Bytes written to the stream */
+    uint64_t bytes_out;            /* Bytes the backend wrote out (compressed) */
+    uint64_t blocks_queued;        /* Blocks waiting for the writer now */
+    uint64_t stalls;               /* Writes that waited for a free block */
+    uint64_t stall_ns;             /* Time spent waiting */
+    uint64_t write_errors;
+} output_sink_stats_t;
+
+typedef struct output_sink output_sink_t;
+
+/* Where the writer thread puts the blocks; called on the writer thread */
+typedef struct {
+    /* Write blocks in order; partial: the last one was taken before it
+     * filled up (the output is idle). Returns the bytes written out, or
+     * -1 on failure, which stops the sink. */
+    int64_t (*write)(void *ctx, struct iovec *blocks, unsigned int count, bool partial);
+    /* Periodic work, after each write and at least every OUTPUT_SINK_LINGER_MS */
+    void (*tick)(void *ctx);
+    /* Write out what the backend still buffers; called once, when the sink
+     * closes or fails to open. The file backend frees itself here.
+     * @return 0 on success, -1 on failure */
+    int (*close)(void *ctx);
+} output_sink_backend_t;
+
+/* Open the output file and start the writer thread
+ * Rotated files are named path.N, or stem.N.gz when a gzip path ends
+ * with .gz, with N counting up from the first name not in use.
+ * @return NULL if the file cannot be created (errno set) */
+output_sink_t *output_sink_open(const output_sink_config_t *config);
+
+/* Start a sink writing to another backend
+ * The backend is closed on failure too. */
+output_sink_t *output_sink_open_backend(const output_sink_backend_t *backend, void *ctx);
+
+/* The sink's stream: unbuffered, any thread may write to it */
+FILE *output_sink_stream(output_sink_t *sink);
+
+/* Current statistics; safe from any thread */
+void output_sink_get_stats(output_sink_t *sink, output_sink_stats_t *stats);
+
+/* Close the stream, write everything still buffered and stop the writer
+ * @param stats Final statistics (may be NULL)
+ * @return 0 on success, -1 if any write failed */
+int output_sink_close(output_sink_t *sink, output_sink_stats_t *stats);
+
+#endif /* __OUTPUT_SINK_H__ */
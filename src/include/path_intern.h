@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * path_intern.h - Interned path table interface
+ * Stores each distinct path once and hands out a stable pointer and a
+ * dense id for it, so thousands of processes mapping the same library
+ * share one copy
+ */
+
+#ifndef __PATH_INTERN_H__
+#define __PATH_INTERN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Id returned for paths that could not be interned */
+#define PATH_INTERN_INVALID UINT32_MAX
+
+typedef struct path_intern path_intern_t;
+
+/* Lifecycle functions */
+path_intern_t *path_intern_create(void);
+void path_intern_destroy(path_intern_t *table);
+
+/* Intern a path (thread-safe)
+ * Returns its id (ids are dense, in insertion order) or
+ * PATH_INTERN_INVALID on allocation failure; *interned, if given, is set
+ * to the table's copy, valid until the table is destroyed */
+uint32_t path_intern_add(path_intern_t *table, const char *path, const char **interned);
+
+/* Id of an already interned path (PATH_INTERN_INVALID if absent) */
+uint32_t path_intern_find(path_intern_t *table, const char *path);
+
+/* Look up a path by id (NULL if out of range) */
+const char *path_intern_get(path_intern_t *table, uint32_t id);
+
+/* Number of distinct paths */
+size_t path_intern_count(path_intern_t *table);
+
+#endif /* __PATH_INTERN_H__ */
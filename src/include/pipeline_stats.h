@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * pipeline_stats.h - Per-stage latency histograms of the event pipeline
+ * Stages are timed with the TSC where there is one (CLOCK_MONOTONIC
+ * elsewhere) into log-linear histograms: STAGE_HIST_SUB_BUCKETS buckets
+ * per power of two, so a bucket is at most 25% wide. Ticks are converted
+ * to nanoseconds when a snapshot is taken, with the tick rate measured
+ * against CLOCK_MONOTONIC since pipeline_stats_enable().
+ *
+ * Timing is off until pipeline_stats_enable(); stage_begin() then returns
+ * 0 and stage_end() does nothing. Each stage must only be recorded by one
+ * thread at a time (the polling thread or the output thread) unless
+ * pipeline_stats_set_concurrent() was called; snapshots may be taken
+ * from any thread.
+ */
+
+#ifndef __PIPELINE_STATS_H__
+#define __PIPELINE_STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef enum {
+    STAGE_DRAIN = 0,               /* One ring buffer drain that returned records */
+    STAGE_DECODE,                  /* Record to processed event (and queue copy) */
+    STAGE_ENRICH,                  /* /proc metadata lookup */
+    STAGE_CLASSIFY,                /* Crypto file and library classification */
+    STAGE_FILTER,                  /* Prefilter and post-enrichment filters */
+    STAGE_FORMAT,                  /* Redaction and event to output buffer */
+    STAGE_WRITE,                   /* Output buffer to the output file */
+    STAGE_COUNT
+} pipeline_stage_t;
+
+#define STAGE_HIST_SUB_BITS     2
+#define STAGE_HIST_SUB_BUCKETS  (1 << STAGE_HIST_SUB_BITS)
+/* Up to 2^42 ticks (over 20 minutes at 4 GHz), longer goes to the last */
+#define STAGE_HIST_BUCKETS      (41 * STAGE_HIST_SUB_BUCKETS)
+
+/* Stage latencies in nanoseconds; percentiles are the upper bound of
+ * their bucket */
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+} stage_snapshot_t;
+
+/* Set once by pipeline_stats_enable(); read on every stage_begin() */
+extern bool pipeline_stats_enabled;
+
+void pipeline_stats_enable(void);
+void pipeline_stats_set_concurrent(void);
+void pipeline_stats_record(pipeline_stage_t stage, uint64_t ticks);
+int pipeline_stats_snapshot(pipeline_stage_t stage, stage_snapshot_t *snapshot);
+const char *pipeline_stage_name(pipeline_stage_t stage);
+
+static inline uint64_t stage_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* Start timing a stage: a tick count, or 0 while timing is off */
+static inline uint64_t stage_begin(void) {
+    return pipeline_stats_enabled ? stage_clock() : 0;
+}
+
+/* Record a stage started with stage_begin() */
+static inline void stage_end(pipeline_stage_t stage, uint64_t begin) {
+    if (begin) {
+        pipeline_stats_record(stage, stage_clock() - begin);
+    }
+}
+
+#endif /* __PIPELINE_STATS_H__ */
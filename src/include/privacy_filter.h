@@ -13,6 +13,38 @@
 #define __PRIVACY_FILTER_H__
 
 #include <stdbool.h>
+#include <stddef.h>
+
+/* Room for any redacted path of up to PATH_MAX (4096) bytes: the
+ * "/home/ROOT" replacement is longer than the "/root" it replaces */
+#define REDACTED_PATH_MAX (4096 + 16)
+
+/* A redacted path as a view into the original: the output is prefix
+ * followed by suffix. Nothing is copied or allocated. */
+typedef struct {
+    const char *prefix;            /* Replacement prefix (static) */
+    size_t prefix_len;
+    const char *suffix;            /* Remainder of the original path */
+} redacted_path_t;
+
+/**
+ * Look up the redaction of a path
+ * 
+ * @param path Original path
+ * @param redact_enabled Whether redaction is enabled (false if --no-redact)
+ * @param view Set to the redacted path when it differs from path
+ * @return true if redaction changes the path, false if it is kept as is
+ */
+bool privacy_redact_path(const char *path, bool redact_enabled, redacted_path_t *view);
+
+/**
+ * Redact a path into a caller buffer
+ * 
+ * @param buf Buffer for the redacted path (REDACTED_PATH_MAX is enough)
+ * @return path itself if unchanged, buf if redacted, NULL if buf is too small
+ */
+const char *privacy_redact_path_into(const char *path, bool redact_enabled,
+                                     char *buf, size_t buf_size);
 
 /**
  * Apply path redaction for privacy protection
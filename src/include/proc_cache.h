@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * proc_cache.h - Per-process /proc enrichment cache interface
+ * Caches comm/exe/cmdline keyed by (pid, process start time) so
+ * repeated events from one process do not re-read /proc
+ */
+
+#ifndef __PROC_CACHE_H__
+#define __PROC_CACHE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Default number of cached processes */
+#define PROC_CACHE_DEFAULT_CAPACITY 1024
+
+/* Lookup flags */
+#define PROC_CACHE_NEED_CMDLINE (1U << 0)  /* Also load the command line */
+#define PROC_CACHE_REFRESH      (1U << 1)  /* Re-read /proc (process called exec) */
+#define PROC_CACHE_LAST_USE     (1U << 2)  /* Evict after this use (process exited) */
+#define PROC_CACHE_CMDLINE_ONLY (1U << 3)  /* Loader: only the command line is missing */
+
+/* Cached process metadata (NULL fields could not be read) */
+typedef struct {
+    const char *comm;
+    const char *exe;
+    const char *cmdline;
+} proc_cache_entry_t;
+
+/* Cache statistics */
+typedef struct {
+    uint64_t hits;             /* Lookups served from the cache */
+    uint64_t misses;           /* Lookups that read /proc */
+    uint64_t evictions;        /* Entries dropped to make room */
+    uint64_t invalidations;    /* Entries dropped or refreshed on exec/exit */
+    size_t entries;            /* Entries currently cached */
+    size_t capacity;           /* Maximum number of entries */
+} proc_cache_stats_t;
+
+typedef struct proc_cache proc_cache_t;
+
+/* Reads a process's metadata on a cache miss into entry as malloc'd
+ * strings (NULL where unavailable), cmdline only with PROC_CACHE_NEED_CMDLINE.
+ * proc_cache_read_proc() is the default; replay substitutes recorded reads. */
+typedef void (*proc_cache_loader_t)(pid_t pid, uint64_t start_time_ns, unsigned int flags,
+                                    proc_cache_entry_t *entry, void *ctx);
+
+/* Lifecycle functions */
+proc_cache_t *proc_cache_create(size_t capacity);
+void proc_cache_destroy(proc_cache_t *cache);
+
+/* Lookup (fills the cache from /proc on a miss)
+ * The returned entry and its strings stay valid until the next call on the cache */
+const proc_cache_entry_t *proc_cache_lookup(proc_cache_t *cache, pid_t pid,
+                                            uint64_t start_time_ns, unsigned int flags);
+void proc_cache_invalidate(proc_cache_t *cache, pid_t pid);
+
+/* Metadata source */
+void proc_cache_set_loader(proc_cache_t *cache, proc_cache_loader_t loader, void *ctx);
+void proc_cache_read_proc(pid_t pid, uint64_t start_time_ns, unsigned int flags,
+                          proc_cache_entry_t *entry, void *ctx);
+
+/* Statistics */
+void proc_cache_get_stats(proc_cache_t *cache, proc_cache_stats_t *stats);
+
+#endif /* __PROC_CACHE_H__ */
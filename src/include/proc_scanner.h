@@ -14,6 +14,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/types.h>
+#include "string_arena.h"
+#include "path_intern.h"
 
 /* Maximum path length for files and libraries */
 #define MAX_PATH_LEN 4096
@@ -21,33 +23,47 @@
 /* Maximum command line length */
 #define MAX_CMDLINE_LEN 4096
 
-/* Process information structure */
+/* Process information structure
+ * exe and cmdline are allocated from the arena passed to
+ * proc_scanner_get_process_info() (or the list's arena once added) */
 typedef struct {
     pid_t pid;
     char comm[256];           /* Process name from /proc/[pid]/comm */
-    char exe[MAX_PATH_LEN];   /* Executable path from /proc/[pid]/exe */
-    char cmdline[MAX_CMDLINE_LEN]; /* Command line from /proc/[pid]/cmdline */
+    const char *exe;          /* Executable path from /proc/[pid]/exe */
+    const char *cmdline;      /* Command line from /proc/[pid]/cmdline */
     uid_t uid;
     gid_t gid;
 } process_info_t;
 
-/* Library information structure */
+/* Library information structure
+ * Entries found by proc_scanner_get_loaded_libraries() are interned in
+ * the scanner's library table: path points into it and stays valid
+ * until the scanner is destroyed */
 typedef struct {
-    char path[MAX_PATH_LEN];
-    char name[256];           /* Extracted library name */
+    const char *path;
+    const char *name;         /* Extracted library name */
+    uint32_t path_id;         /* Id in the library table (if interned) */
+    bool interned;            /* path is owned by the library table */
 } library_info_t;
 
 /* File information structure */
 typedef struct {
-    char path[MAX_PATH_LEN];
+    const char *path;
     int fd;                   /* File descriptor number */
 } file_info_t;
 
+/* Dynamic arrays
+ * The *_add functions copy an entry's strings into the list's arena,
+ * which is freed with the list unless it was supplied by the caller
+ * through *_init_arena() */
+
 /* Dynamic array for process list */
 typedef struct {
     process_info_t *processes;
     size_t count;
     size_t capacity;
+    string_arena_t *arena;
+    bool owns_arena;
 } process_list_t;
 
 /* Dynamic array for library list */
@@ -55,6 +71,8 @@ typedef struct {
     library_info_t *libraries;
     size_t count;
     size_t capacity;
+    string_arena_t *arena;
+    bool owns_arena;
 } library_list_t;
 
 /* Dynamic array for file list */
@@ -62,6 +80,8 @@ typedef struct {
     file_info_t *files;
     size_t count;
     size_t capacity;
+    string_arena_t *arena;
+    bool owns_arena;
 } file_list_t;
 
 /* Proc scanner opaque structure */
@@ -90,9 +110,11 @@ int proc_scanner_scan_processes(proc_scanner_t *scanner, process_list_t *process
  * @param scanner Proc scanner instance
  * @param pid Process ID to query
  * @param info Output process information
+ * @param arena Arena for exe and cmdline (NULL = only read comm, uid and gid)
  * @return 0 on success, -1 on failure (e.g., process doesn't exist)
  */
-int proc_scanner_get_process_info(proc_scanner_t *scanner, pid_t pid, process_info_t *info);
+int proc_scanner_get_process_info(proc_scanner_t *scanner, pid_t pid, process_info_t *info,
+                                  string_arena_t *arena);
 
 /**
  * Get list of loaded libraries for a process
@@ -122,6 +144,48 @@ int proc_scanner_get_loaded_libraries(proc_scanner_t *scanner, pid_t pid, librar
  */
 int proc_scanner_get_open_files(proc_scanner_t *scanner, pid_t pid, file_list_t *files);
 
+/* Directory-relative variants
+ * These take a /proc/[pid] directory fd from proc_scanner_open_pid() and
+ * read through openat()/readlinkat(), so a caller scanning several files
+ * of one process resolves its /proc path once. They keep no state in the
+ * scanner and may be called from several threads at once. */
+
+/**
+ * List the PIDs currently present in /proc
+ * 
+ * @param scanner Proc scanner instance
+ * @param pids Output array of PIDs (caller must free)
+ * @param count Output number of PIDs
+ * @return 0 on success, -1 on failure
+ */
+int proc_scanner_list_pids(proc_scanner_t *scanner, pid_t **pids, size_t *count);
+
+/**
+ * Open the /proc/[pid] directory of a process
+ * 
+ * @param proc_fd Directory fd of /proc
+ * @param pid Process ID
+ * @return Directory fd (caller must close), or -1 if the process is gone
+ */
+int proc_scanner_open_pid(int proc_fd, pid_t pid);
+
+int proc_scanner_get_process_info_at(proc_scanner_t *scanner, int pid_fd, pid_t pid,
+                                     process_info_t *info, string_arena_t *arena);
+int proc_scanner_get_loaded_libraries_at(proc_scanner_t *scanner, int pid_fd, library_list_t *libs);
+int proc_scanner_get_open_files_at(proc_scanner_t *scanner, int pid_fd, file_list_t *files);
+
+/* Classify a path found by another backend (the snapshot's BPF
+ * iterators) with the scanner's rules and add it to the list if it is a
+ * crypto library or file. Return 1 if added, 0 if not. */
+int proc_scanner_add_library_path(proc_scanner_t *scanner, library_list_t *libs, const char *path);
+int proc_scanner_add_file_path(proc_scanner_t *scanner, file_list_t *files, const char *path, int fd);
+
+/**
+ * Table interning every library path the scanner has found
+ * Shared by all threads using the scanner; owned by the scanner
+ */
+path_intern_t *proc_scanner_library_table(proc_scanner_t *scanner);
+
 /**
  * Destroy proc scanner instance and free resources
  * 
@@ -136,6 +200,11 @@ void proc_scanner_destroy(proc_scanner_t *scanner);
  */
 void process_list_init(process_list_t *list);
 
+/**
+ * Initialize a process list whose strings go to a caller-owned arena
+ */
+void process_list_init_arena(process_list_t *list, string_arena_t *arena);
+
 /**
  * Add a process to the list
  * Returns 0 on success, -1 on failure
@@ -143,7 +212,7 @@ void process_list_init(process_list_t *list);
 int process_list_add(process_list_t *list, const process_info_t *info);
 
 /**
- * Free process list resources
+ * Free process list resources (and its arena, if the list created it)
  */
 void process_list_free(process_list_t *list);
 
@@ -152,14 +221,20 @@ void process_list_free(process_list_t *list);
  */
 void library_list_init(library_list_t *list);
 
+/**
+ * Initialize a library list whose strings go to a caller-owned arena
+ */
+void library_list_init_arena(library_list_t *list, string_arena_t *arena);
+
 /**
  * Add a library to the list
+ * Interned paths are referenced, other strings are copied
  * Returns 0 on success, -1 on failure
  */
 int library_list_add(library_list_t *list, const library_info_t *info);
 
 /**
- * Free library list resources
+ * Free library list resources (and its arena, if the list created it)
  */
 void library_list_free(library_list_t *list);
 
@@ -168,6 +243,11 @@ void library_list_free(library_list_t *list);
  */
 void file_list_init(file_list_t *list);
 
+/**
+ * Initialize a file list whose strings go to a caller-owned arena
+ */
+void file_list_init_arena(file_list_t *list, string_arena_t *arena);
+
 /**
  * Add a file to the list
  * Returns 0 on success, -1 on failure
@@ -175,7 +255,7 @@ void file_list_init(file_list_t *list);
 int file_list_add(file_list_t *list, const file_info_t *info);
 
 /**
- * Free file list resources
+ * Free file list resources (and its arena, if the list created it)
  */
 void file_list_free(file_list_t *list);
 
@@ -28,10 +28,23 @@ void profile_manager_destroy(profile_manager_t *mgr);
 /* Event aggregation functions */
 int profile_manager_add_event(profile_manager_t *mgr, processed_event_t *event);
 
+/* Add TLS handshake latencies (from ebpf_manager_read_handshake_latency)
+ * to the profile of pid, which may differ from latency->pid when children
+ * are folded into their parent's profile */
+int profile_manager_add_handshakes(profile_manager_t *mgr, pid_t pid,
+                                   const handshake_latency_t *latency);
+
 /* Profile retrieval and finalization */
 profile_t *profile_manager_get_profile(profile_manager_t *mgr, pid_t pid);
 profile_t *profile_manager_finalize_profile(profile_manager_t *mgr, pid_t pid, int duration_seconds);
 
+/* System-wide delta profiles
+ * profile_manager_flush_deltas() calls emit with the activity of every
+ * changed profile since the previous flush and frees retired profiles. */
+typedef void (*profile_delta_fn)(profile_t *delta, void *ctx);
+int profile_manager_flush_deltas(profile_manager_t *mgr, int duration_seconds,
+                                 profile_delta_fn emit, void *ctx);
+
 /* Profile cleanup */
 void profile_free(profile_t *profile);
 
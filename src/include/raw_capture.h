@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * raw_capture.h - Raw ring buffer record capture and replay
+ * Written by "monitor --record-raw" and read by "crypto-tracer replay",
+ * which feeds the records through the same decode, enrichment, filter
+ * and output path without BPF
+ *
+ * Layout: a RAW_HEADER_SIZE header ("CTRW", version u16, reserved u16,
+ * boot-to-realtime offset as s64 ns) followed by frames of
+ * <kind:u8> <source:u8> <reserved:u16> <payload length:u32> <payload>,
+ * each padded to RAW_FRAME_ALIGN bytes so records can be decoded in place
+ * from a mapping of the file. Integers are in host byte order: a capture
+ * replays on the architecture that recorded it.
+ *
+ * A RECORD frame holds a ct_*_event record exactly as handle_event()
+ * received it from the ring buffer of event source <source>. A PROC frame
+ * holds the result of one /proc read of the enrichment cache:
+ *   pid (u32), PROC_CACHE_* flags (u32), process start time (u64), then
+ *   comm, exe and cmdline as <length:u32> <bytes> (RAW_STRING_NULL = not read)
+ * Readers skip frame kinds they do not know.
+ */
+
+#ifndef __RAW_CAPTURE_H__
+#define __RAW_CAPTURE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "proc_cache.h"
+
+#define RAW_MAGIC               "CTRW"
+#define RAW_VERSION             4
+#define RAW_HEADER_SIZE         16
+#define RAW_FRAME_HEADER_SIZE   8
+#define RAW_FRAME_ALIGN         8
+
+/* Frame kinds */
+#define RAW_FRAME_RECORD        1
+#define RAW_FRAME_PROC          2
+
+/* String length of a field that could not be read */
+#define RAW_STRING_NULL         UINT32_MAX
+
+/* Writer
+ * Thread-safe: records are written by the polling thread and /proc reads
+ * by the thread that enriches events. */
+typedef struct raw_writer raw_writer_t;
+
+raw_writer_t *raw_writer_create(const char *path, int64_t boot_to_realtime_ns);
+int raw_writer_write_record(raw_writer_t *writer, uint8_t source, const void *data, size_t size);
+int raw_writer_write_proc(raw_writer_t *writer, pid_t pid, uint64_t start_time_ns,
+                          unsigned int flags, const proc_cache_entry_t *entry);
+int raw_writer_close(raw_writer_t *writer);
+
+/* Reader
+ * The file is mapped; raw_reader_next() returns 1 with the next record,
+ * 0 at end of file or -1 on a malformed frame. Records stay valid until
+ * raw_reader_close(). */
+typedef struct raw_reader raw_reader_t;
+
+raw_reader_t *raw_reader_open(const char *path);
+int64_t raw_reader_boot_offset(const raw_reader_t *reader);
+int raw_reader_next(raw_reader_t *reader, uint8_t *source, const void **data, size_t *size);
+void raw_reader_close(raw_reader_t *reader);
+
+/* Recorded /proc reads of a process, handed out in the order they were
+ * made. Fills entry with malloc'd copies; a process read more often than
+ * recorded gets its last result again. Returns 0, or -1 if the process
+ * was never read. */
+int raw_reader_proc_lookup(raw_reader_t *reader, pid_t pid, uint64_t start_time_ns,
+                           proc_cache_entry_t *entry);
+
+#endif /* __RAW_CAPTURE_H__ */
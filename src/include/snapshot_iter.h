@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * snapshot_iter.h - BPF iterator snapshot backend interface
+ * Collects every process's executable mappings and candidate crypto
+ * files with the snapshot_iter BPF iterators. The records are the
+ * kernel's candidates only; the snapshot scanner classifies them.
+ */
+
+#ifndef __SNAPSHOT_ITER_H__
+#define __SNAPSHOT_ITER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "crypto_classifier.h"
+
+/* One iterator record; path points into the result's data */
+typedef struct {
+    pid_t pid;
+    int kind;                  /* CT_ITER_LIBRARY or CT_ITER_FILE */
+    int fd;                    /* -1 for mappings */
+    uint64_t ino;
+    const char *path;
+} snapshot_iter_record_t;
+
+/* Records sorted by pid, mappings before files within a process */
+typedef struct {
+    snapshot_iter_record_t *records;
+    size_t count;
+    char *data;                /* Raw iterator output */
+    size_t data_len;
+} snapshot_iter_result_t;
+
+/* Run both iterators. The kernel's extension prefilter follows the
+ * classifier's rules. Returns 0 on success, or -1 if the iterators are
+ * not available (no privileges, kernel without BPF iterators or BTF),
+ * in which case the caller falls back to /proc. */
+int snapshot_iter_collect(const crypto_classifier_t *classifier, snapshot_iter_result_t *result);
+
+/* Parse and sort result->data into result->records (used by
+ * snapshot_iter_collect(); exposed for tests). Returns 0, or -1 on a
+ * truncated or malformed record. */
+int snapshot_iter_parse(snapshot_iter_result_t *result);
+
+void snapshot_iter_result_free(snapshot_iter_result_t *result);
+
+#endif /* __SNAPSHOT_ITER_H__ */
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * snapshot_state.h - Per-process state carried between incremental snapshots
+ * Remembers what the last snapshot found in every process, keyed by the
+ * process's identity (pid, start time, executable dev/inode), along with
+ * a cheap change signature: its virtual memory size, which every mmap and
+ * munmap changes (so every library load or unload), and its fd count.
+ * A process whose identity and signature are unchanged is reported from
+ * the state instead of being rescanned, so a snapshot of a steady host
+ * costs a few syscalls per process. The state is a text file rewritten
+ * after each run.
+ */
+
+#ifndef __SNAPSHOT_STATE_H__
+#define __SNAPSHOT_STATE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "crypto_tracer.h"
+
+/* Identity and change signature of a process */
+typedef struct {
+    uint32_t pid;
+    uint64_t start_time;           /* Clock ticks after boot (/proc/[pid]/stat) */
+    uint64_t exe_dev;
+    uint64_t exe_ino;
+    uint64_t vsize;                /* Virtual memory size in bytes */
+    uint32_t fd_count;
+} snapshot_process_key_t;
+
+/* A process as the state remembers it */
+typedef struct {
+    snapshot_process_key_t key;
+    snapshot_process_t process;    /* name == NULL: uses no cryptography */
+    bool recorded;
+} snapshot_state_entry_t;
+
+typedef struct snapshot_state snapshot_state_t;
+
+/* Load the state of the previous run
+ * A missing file, or one written with the other redaction setting, gives
+ * an empty state (every process is scanned); a malformed one is ignored
+ * with a warning. NULL only when out of memory. */
+snapshot_state_t *snapshot_state_load(const char *path, bool redact);
+void snapshot_state_destroy(snapshot_state_t *state);
+
+/* Read a process's identity and signature through its /proc/[pid] fd
+ * @return 0 on success, -1 if the process is gone */
+int snapshot_state_read_key(int pid_fd, pid_t pid, snapshot_process_key_t *key);
+
+/* Previous entry of a process, if its identity and signature are unchanged */
+const snapshot_state_entry_t *snapshot_state_unchanged(const snapshot_state_t *state,
+                                                       const snapshot_process_key_t *key);
+
+/* Previous entry of a pid, whatever its signature (NULL if none) */
+const snapshot_state_entry_t *snapshot_state_find(const snapshot_state_t *state, uint32_t pid);
+
+/* Record this run's processes: one slot per listed PID, filled from any
+ * thread (one slot per thread at a time); process may be NULL for a
+ * process that uses no cryptography. Recorded strings are borrowed and
+ * must stay valid until snapshot_state_save() and snapshot_state_diff(). */
+int snapshot_state_begin(snapshot_state_t *state, size_t count);
+void snapshot_state_record(snapshot_state_t *state, size_t index,
+                           const snapshot_process_key_t *key, const snapshot_process_t *process);
+bool snapshot_state_recorded(const snapshot_state_t *state, size_t index);
+
+/* Write this run's processes (written to a temporary file, then renamed)
+ * @return 0 on success, -1 on failure */
+int snapshot_state_save(snapshot_state_t *state, const char *path, const char *generated_at);
+
+/* Compare this run with the previous one
+ * added gets the new processes with everything they use, and for the
+ * processes of both runs the libraries and files they started using;
+ * removed gets the processes gone and what the others stopped using.
+ * Both are freed with snapshot_free_processes(); their strings are the
+ * state's and this run's. */
+int snapshot_state_diff(snapshot_state_t *state, snapshot_t *added, snapshot_t *removed);
+
+/* generated_at of the previous run (NULL on the first run) */
+const char *snapshot_state_since(const snapshot_state_t *state);
+
+/* Processes in the previous run */
+size_t snapshot_state_previous_count(const snapshot_state_t *state);
+
+#endif /* __SNAPSHOT_STATE_H__ */
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * spsc_queue.h - Bounded single-producer/single-consumer queue interface
+ * Hands captured events from the ring buffer thread to the output thread
+ * without locks on the fast path
+ */
+
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct spsc_queue spsc_queue_t;
+
+/* Lifecycle functions (capacity is rounded up to a power of two) */
+spsc_queue_t *spsc_queue_create(size_t capacity);
+void spsc_queue_destroy(spsc_queue_t *queue);
+
+/* Producer side: returns false when the queue is full */
+bool spsc_queue_push(spsc_queue_t *queue, void *item);
+
+/* Consumer side: returns NULL when the queue is empty */
+void *spsc_queue_pop(spsc_queue_t *queue);
+
+/* Consumer side: sleep until an item is pushed, the queue is woken
+ * or timeout_ms elapses */
+void spsc_queue_wait(spsc_queue_t *queue, int timeout_ms);
+
+/* Wake a consumer blocked in spsc_queue_wait (e.g. at shutdown) */
+void spsc_queue_wake(spsc_queue_t *queue);
+
+/* Number of queued items (approximate while the other side is active) */
+size_t spsc_queue_size(spsc_queue_t *queue);
+size_t spsc_queue_capacity(spsc_queue_t *queue);
+
+#endif /* __SPSC_QUEUE_H__ */
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * string_arena.h - Bump allocator for short-lived strings
+ * Strings are carved out of large chunks and freed all at once when the
+ * arena is destroyed. An arena is not thread-safe; give each thread its
+ * own and merge them when the threads are done.
+ */
+
+#ifndef __STRING_ARENA_H__
+#define __STRING_ARENA_H__
+
+#include <stddef.h>
+
+/* Default chunk size */
+#define STRING_ARENA_DEFAULT_CHUNK (64 * 1024)
+
+typedef struct string_arena string_arena_t;
+
+/* Lifecycle functions */
+string_arena_t *string_arena_create(size_t chunk_size);
+void string_arena_destroy(string_arena_t *arena);
+
+/* Allocation (pointer-aligned; NULL on failure) */
+void *string_arena_alloc(string_arena_t *arena, size_t size);
+char *string_arena_strdup(string_arena_t *arena, const char *str);
+char *string_arena_strndup(string_arena_t *arena, const char *str, size_t len);
+
+/* Drop every allocation, keeping the current chunk for reuse */
+void string_arena_reset(string_arena_t *arena);
+
+/* Move all of src's allocations into dst; src is left empty */
+void string_arena_merge(string_arena_t *dst, string_arena_t *src);
+
+/* Bytes handed out and bytes held in chunks */
+size_t string_arena_bytes_used(const string_arena_t *arena);
+size_t string_arena_bytes_reserved(const string_arena_t *arena);
+
+#endif /* __STRING_ARENA_H__ */
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * symbol_cache.h - ELF symbol to file offset resolution, cached on disk
+ * Uprobes are attached at a file offset, which is found by walking the
+ * library's symbol tables. A library is identified by its device, inode
+ * and GNU build id (or size and mtime when it has none), and the offsets
+ * resolved for it are kept in memory and appended to a cache file, so
+ * each library image is parsed once, not once per path or per run.
+ *
+ * Cache file: one "<dev> <inode> <id> <symbol> <offset>" line per symbol,
+ * dev and inode in decimal, offset in hex (0 = not defined). Unknown or
+ * malformed lines are skipped; the file is only ever appended to.
+ */
+
+#ifndef __SYMBOL_CACHE_H__
+#define __SYMBOL_CACHE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SYMBOL_CACHE_DEFAULT_PATH "/var/cache/crypto-tracer/uprobe-offsets"
+
+/* Most symbols cached; past this, offsets are resolved but not kept */
+#define SYMBOL_CACHE_MAX_ENTRIES 65536
+
+/* Longest symbol name cached */
+#define SYMBOL_NAME_MAX 128
+
+/* Library identity: hex build id, or "m<size>-<mtime ns>" (with NUL) */
+#define SYMBOL_FILE_ID_LEN 72
+
+typedef struct symbol_cache symbol_cache_t;
+
+typedef struct {
+    uint64_t hits;                 /* Symbols answered from the cache */
+    uint64_t resolved;             /* Symbols looked up in an ELF file */
+    uint64_t files_parsed;         /* ELF symbol tables walked */
+} symbol_cache_stats_t;
+
+/* Lifecycle functions
+ * path is the cache file (NULL = memory only); a missing file is created
+ * on the first append, with its directory. Thread-safe. */
+symbol_cache_t *symbol_cache_create(const char *path);
+void symbol_cache_destroy(symbol_cache_t *cache);
+
+/* File offsets of the function symbols names in the ELF file at path
+ * (0 = not defined there), from the cache when the file is known
+ * @return 0 on success, -1 if path is not a readable 64-bit ELF file */
+int symbol_cache_resolve(symbol_cache_t *cache, const char *path, const char *const *names,
+                         size_t count, uint64_t *offsets);
+
+void symbol_cache_get_stats(symbol_cache_t *cache, symbol_cache_stats_t *stats);
+
+/* Uncached primitives on an open file */
+/* Identity of the file (SYMBOL_FILE_ID_LEN bytes), see above
+ * @return 0 on success, -1 if fd is not a 64-bit ELF file */
+int elf_file_id(int fd, char *id);
+/* @return 0 on success, -1 if fd is not a 64-bit ELF file */
+int elf_symbol_offsets(int fd, const char *const *names, size_t count, uint64_t *offsets);
+
+#endif /* __SYMBOL_CACHE_H__ */
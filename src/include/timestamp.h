@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * timestamp.h - Kernel timestamp conversion and ISO 8601 formatting
+ * The BPF programs stamp records with bpf_ktime_get_boot_ns(), i.e.
+ * CLOCK_BOOTTIME. Records are converted to Unix time with an offset that
+ * is measured once and re-measured at most once per second, so a clock
+ * step (NTP, settimeofday) shows up in the output within a second.
+ */
+
+#ifndef __TIMESTAMP_H__
+#define __TIMESTAMP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Re-measure the boot-to-realtime offset after this much boot time */
+#define TIMESTAMP_RESYNC_NS 1000000000ULL
+
+/* Bytes a formatted timestamp needs, NUL included, up to year 9999 */
+#define TIMESTAMP_ISO8601_LEN 28
+
+/* Current CLOCK_BOOTTIME, the clock of kernel record timestamps */
+uint64_t timestamp_boot_ns(void);
+
+/* Convert a CLOCK_BOOTTIME timestamp to Unix time (0 stays 0) */
+uint64_t timestamp_from_boot_ns(uint64_t boot_ns);
+
+/* Current Unix time, on the same scale as converted record timestamps */
+uint64_t timestamp_now_ns(void);
+
+/* Measure the offset now instead of at the next conversion due */
+void timestamp_resync(void);
+
+/* Offset conversions currently add to CLOCK_BOOTTIME (measured if needed) */
+int64_t timestamp_boot_offset(void);
+
+/* Convert with a fixed offset from now on, e.g. the one a capture being
+ * replayed was recorded with; re-measuring stops */
+void timestamp_pin_offset(int64_t offset_ns);
+
+/* Format Unix nanoseconds as YYYY-MM-DDTHH:MM:SS.ssssssZ
+ * The part up to the seconds is cached per thread and only rebuilt when
+ * the second changes. Returns buf, or NULL if buf is too small */
+char *timestamp_format_iso8601(uint64_t unix_ns, char *buf, size_t buf_size);
+
+#endif /* __TIMESTAMP_H__ */
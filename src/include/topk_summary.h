@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * topk_summary.h - Streaming top-K summary of a capture in fixed memory
+ * Keeps the heaviest processes, files, libraries, API functions and
+ * private key readers of an unbounded event stream. Each dimension is a
+ * Space-Saving table of a few times K counters, fronted by a Count-Min
+ * sketch: a key not in the table only takes the smallest counter's place
+ * once the sketch estimates it heavier, so one-off keys (temporary files,
+ * short-lived processes) do not churn the table. Everything is allocated
+ * at creation; memory does not grow with the number of distinct keys.
+ * Counts are upper bounds; count - error is a lower bound. TLS handshake
+ * latency histograms, when enabled, are kept per process name and
+ * function in a table of the same fixed size.
+ */
+
+#ifndef __TOPK_SUMMARY_H__
+#define __TOPK_SUMMARY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "crypto_tracer.h"
+
+/* Default and largest K */
+#define TOPK_DEFAULT_K 10
+#define TOPK_MAX_K 1000
+
+/* Keys longer than this are truncated (and counted as the truncated key) */
+#define TOPK_KEY_MAX 256
+
+typedef enum {
+    TOPK_PROCESSES = 0,            /* Process names, every event */
+    TOPK_PRIVATE_KEY_READERS,      /* Process names, private key opens */
+    TOPK_FILES,                    /* Crypto file paths opened */
+    TOPK_LIBRARIES,                /* Crypto library names loaded */
+    TOPK_API_FUNCTIONS,            /* Crypto API functions called */
+    TOPK_DIMENSIONS
+} topk_dimension_t;
+
+/* One reported key */
+typedef struct {
+    char key[TOPK_KEY_MAX];
+    uint64_t count;                /* Estimated count (upper bound) */
+    uint64_t error;                /* Overestimation bound */
+} topk_entry_t;
+
+typedef struct topk_summary topk_summary_t;
+
+/* Create a summary reporting the top k keys of each dimension
+ * @return NULL if k is out of range or out of memory */
+topk_summary_t *topk_summary_create(unsigned int k);
+void topk_summary_destroy(topk_summary_t *summary);
+
+/* Count a key weight times; safe to call from several threads */
+void topk_summary_add(topk_summary_t *summary, topk_dimension_t dim,
+                      const char *key, uint64_t weight);
+
+/* Count a prepared event in every dimension it belongs to, with its
+ * kernel-side count as weight */
+void topk_summary_add_event(topk_summary_t *summary, const processed_event_t *event);
+
+/* Copy the heaviest keys of a dimension, heaviest first
+ * @return Number of entries written (at most k and max) */
+size_t topk_summary_top(topk_summary_t *summary, topk_dimension_t dim,
+                        topk_entry_t *out, size_t max);
+
+/* Include TLS handshake latencies in the output; call before writing
+ * from another thread */
+void topk_summary_enable_handshakes(topk_summary_t *summary);
+
+/* Add the handshake latencies of an interval (one process and function);
+ * once the table is full, new keys are counted under "(other)" */
+void topk_summary_add_handshakes(topk_summary_t *summary, const handshake_latency_t *latency);
+
+/* Events counted so far */
+uint64_t topk_summary_events(topk_summary_t *summary);
+
+/* Dimension name as used in the JSON output */
+const char *topk_dimension_name(topk_dimension_t dim);
+
+/* Write the current summary as a text table (format == FORMAT_SUMMARY) or
+ * one JSON object (pretty with FORMAT_JSON_PRETTY, else one line)
+ * @return 0 on success, -1 on write error */
+int topk_summary_write(topk_summary_t *summary, FILE *fp, output_format_t format,
+                       const char *generated_at, uint64_t elapsed_s);
+
+#endif /* __TOPK_SUMMARY_H__ */
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * uprobe_attacher.h - Incremental uprobe attachment across libraries
+ * Finds the libraries mapped by running processes (every process once,
+ * then the processes queued by exec and dlopen events) and attaches the
+ * target functions of each library it has not seen before. A library is
+ * known by the device and inode /proc/[pid]/maps reports for it, which
+ * for a container's overlay file is the underlying file the uprobe lands
+ * on, so a library shared by many processes or containers is attached
+ * once and attach work grows with the number of new libraries only.
+ * A container's copy is reached through /proc/[pid]/root, and offsets
+ * come from the symbol cache (symbol_cache.h).
+ */
+
+#ifndef __UPROBE_ATTACHER_H__
+#define __UPROBE_ATTACHER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "symbol_cache.h"
+
+/* Most targets (one function in one kind of library) */
+#define UPROBE_MAX_TARGETS 64
+
+/* Most distinct libraries attached; past this, new ones are skipped */
+#define UPROBE_MAX_LIBRARIES 4096
+
+/* Most processes waiting for their maps to be read */
+#define UPROBE_PENDING_MAX 1024
+
+/* Age of a queued process before its maps are read, so that the
+ * libraries it was loading when queued are mapped by then */
+#define UPROBE_SCAN_DELAY_NS 50000000ULL
+
+/* Most queued processes scanned per uprobe_attacher_process_pending() */
+#define UPROBE_SCAN_BUDGET 64
+
+/* A function to probe in every library whose file name starts with library */
+typedef struct {
+    const char *library;           /* File name prefix, e.g. "libssl.so" */
+    const char *symbol;            /* Function name, e.g. "SSL_connect" */
+} uprobe_target_t;
+
+/* Attach the probe of targets[target] at offset in the file at path
+ * @return 0 on success, -1 on failure */
+typedef int (*uprobe_attach_fn)(size_t target, const char *path, uint64_t offset, void *ctx);
+
+typedef struct {
+    uint64_t libraries;            /* Distinct libraries holding a target */
+    uint64_t probes;               /* Probes attached */
+    uint64_t failures;             /* Probes that failed to attach or resolve */
+    uint64_t processes_scanned;    /* /proc/[pid]/maps files read */
+    uint64_t pending_dropped;      /* Processes not queued: queue full */
+} uprobe_attacher_stats_t;
+
+typedef struct uprobe_attacher uprobe_attacher_t;
+
+/* Lifecycle functions
+ * targets is copied; its strings must outlive the attacher. symbols is
+ * borrowed. All functions are thread-safe. */
+uprobe_attacher_t *uprobe_attacher_create(const uprobe_target_t *targets, size_t count,
+                                          symbol_cache_t *symbols, uprobe_attach_fn attach,
+                                          void *ctx);
+void uprobe_attacher_destroy(uprobe_attacher_t *attacher);
+
+/* Discovery; each returns the number of probes it attached */
+unsigned int uprobe_attacher_add_library(uprobe_attacher_t *attacher, const char *path);
+unsigned int uprobe_attacher_scan_pid(uprobe_attacher_t *attacher, pid_t pid);
+unsigned int uprobe_attacher_scan_all(uprobe_attacher_t *attacher);
+
+/* Queue a process whose libraries may have changed (exec, dlopen) and
+ * scan the queued processes old enough; only one thread scans at a time,
+ * others return 0 at once */
+void uprobe_attacher_queue_pid(uprobe_attacher_t *attacher, pid_t pid, uint64_t now_ns);
+unsigned int uprobe_attacher_process_pending(uprobe_attacher_t *attacher, uint64_t now_ns);
+
+void uprobe_attacher_get_stats(uprobe_attacher_t *attacher, uprobe_attacher_stats_t *stats);
+
+#endif /* __UPROBE_ATTACHER_H__ */
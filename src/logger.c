@@ -6,6 +6,13 @@
 /**
  * logger.c - Structured logging and diagnostics system implementation
  * Requirements: 15.3, 15.4, 15.5, 15.6
+ *
+ * The async queue is a bounded multi-producer ring: each slot carries a
+ * sequence number saying whether it is free for the producer of a given
+ * position or holds a message for the writer. Producers claim positions
+ * with a CAS and never wait on the writer. Everything that reaches the
+ * output stream goes through write_lock, so queued lines and the
+ * multi-line diagnostics below never interleave.
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -16,16 +23,74 @@
 #include <time.h>
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include "include/logger.h"
+#include "include/timestamp.h"
+
+/* Queued messages (power of two) */
+#define LOG_QUEUE_SLOTS 256
+
+/* Longest message kept, NUL included; longer ones are truncated */
+#define LOG_MESSAGE_MAX 512
+
+/* Longest output line: a message with every byte JSON-escaped */
+#define LOG_LINE_MAX 4096
+
+/* The writer batches lines into one write of up to this many bytes */
+#define LOG_WRITE_BATCH (16 * 1024)
+
+/* Writer sleep when the queue is empty (a new message wakes it) */
+#define LOG_WRITER_IDLE_MS 100
 
 /* Global logger state */
 static logger_config_t g_logger_config = {
     .min_level = LOG_LEVEL_INFO,
     .quiet = false,
     .verbose = false,
-    .output = NULL  /* Will default to stderr */
+    .output = NULL,  /* Will default to stderr */
+    .format = LOG_FORMAT_TEXT
 };
 
+/* A message on its way to the output */
+typedef struct {
+    log_level_t level;
+    uint32_t suppressed;           /* Similar messages dropped before this one */
+    uint64_t time_ns;              /* Unix time of the log call */
+    const char *text;
+    const char *extra_key;         /* Optional second JSON field */
+    const char *extra_value;
+} log_record_t;
+
+typedef struct {
+    _Atomic size_t seq;            /* pos: free for pos; pos + 1: holds pos */
+    log_level_t level;
+    uint32_t suppressed;
+    uint64_t time_ns;
+    char text[LOG_MESSAGE_MAX];
+} log_slot_t;
+
+static struct {
+    log_slot_t slots[LOG_QUEUE_SLOTS];
+    _Atomic size_t enqueue_pos;
+    _Atomic size_t dequeue_pos;    /* Advanced under write_lock */
+    _Atomic bool running;
+    _Atomic bool writer_waiting;
+    _Atomic uint64_t dropped;
+    uint64_t dropped_reported;     /* Protected by write_lock */
+    bool woken;                    /* Protected by wait_lock */
+    pthread_mutex_t wait_lock;
+    pthread_cond_t cond;
+    pthread_t writer;
+} g_log_queue = {
+    .wait_lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Rate-limited call sites that have suppressed something */
+static _Atomic(log_ratelimit_t *) g_ratelimit_sites;
+
 /* Log level names for output */
 static const char *log_level_names[] = {
     "DEBUG",
@@ -34,6 +99,14 @@ static const char *log_level_names[] = {
     "ERROR"
 };
 
+/* Level names in JSON lines */
+static const char *log_level_keys[] = {
+    "debug",
+    "info",
+    "warn",
+    "error"
+};
+
 /* Log level colors (ANSI escape codes) */
 static const char *log_level_colors[] = {
     "\033[36m",  /* DEBUG: Cyan */
@@ -105,41 +178,498 @@ void logger_set_verbose(bool verbose) {
     }
 }
 
+/**
+ * Set the line format
+ */
+void logger_set_format(log_format_t format) {
+    g_logger_config.format = format;
+}
+
+static FILE *log_output(void) {
+    return g_logger_config.output ? g_logger_config.output : stderr;
+}
+
+/**
+ * Check whether messages of a level are written
+ */
+static bool level_enabled(log_level_t level) {
+    if (level < g_logger_config.min_level) {
+        return false;
+    }
+    
+    /* Quiet mode suppresses everything except errors */
+    return !g_logger_config.quiet || level == LOG_LEVEL_ERROR;
+}
+
+/* Bounded line under construction; one byte is kept for the newline */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} line_t;
+
+static void line_printf(line_t *line, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void line_printf(line_t *line, const char *format, ...) {
+    size_t avail = line->size - line->len;
+    va_list args;
+    int n;
+    
+    if (avail <= 2) {
+        return;
+    }
+    
+    va_start(args, format);
+    n = vsnprintf(line->buf + line->len, avail - 1, format, args);
+    va_end(args);
+    
+    if (n > 0) {
+        line->len += (size_t)n < avail - 2 ? (size_t)n : avail - 2;
+    }
+}
+
+static void line_json_string(line_t *line, const char *str) {
+    static const char hex[] = "0123456789abcdef";
+    
+    line_printf(line, "\"");
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        char esc = 0;
+        
+        /* Worst case \u00XX plus the closing quote and newline */
+        if (line->size - line->len < 9) {
+            break;
+        }
+        
+        switch (*p) {
+            case '"':  esc = '"'; break;
+            case '\\': esc = '\\'; break;
+            case '\n': esc = 'n'; break;
+            case '\r': esc = 'r'; break;
+            case '\t': esc = 't'; break;
+            default: break;
+        }
+        
+        if (esc) {
+            line->buf[line->len++] = '\\';
+            line->buf[line->len++] = esc;
+        } else if (*p < 0x20) {
+            memcpy(line->buf + line->len, "\\u00", 4);
+            line->buf[line->len + 4] = hex[*p >> 4];
+            line->buf[line->len + 5] = hex[*p & 0xf];
+            line->len += 6;
+        } else {
+            line->buf[line->len++] = (char)*p;
+        }
+    }
+    line->buf[line->len] = '\0';
+    line_printf(line, "\"");
+}
+
+/**
+ * Format one record as a newline-terminated line
+ *
+ * @param buf Output buffer (at least 2 bytes)
+ * @param size Size of buf; longer lines are truncated
+ * @param use_color Color the level (text format only)
+ * @return Length of the line, newline included
+ */
+static size_t format_line(char *buf, size_t size, const log_record_t *rec, bool use_color) {
+    line_t line = { buf, size, 0 };
+    
+    if (g_logger_config.format == LOG_FORMAT_JSON) {
+        char timestamp[TIMESTAMP_ISO8601_LEN];
+        
+        line_printf(&line, "{\"timestamp\":\"%s\",\"level\":\"%s\",\"message\":",
+                    timestamp_format_iso8601(rec->time_ns, timestamp, sizeof(timestamp)) ?
+                    timestamp : "", log_level_keys[rec->level]);
+        line_json_string(&line, rec->text);
+        if (rec->suppressed) {
+            line_printf(&line, ",\"suppressed\":%u", rec->suppressed);
+        }
+        if (rec->extra_key && rec->extra_value) {
+            line_printf(&line, ",\"%s\":", rec->extra_key);
+            line_json_string(&line, rec->extra_value);
+        }
+        line_printf(&line, "}");
+    } else {
+        if (use_color) {
+            line_printf(&line, "%s[%s]%s ", log_level_colors[rec->level],
+                        log_level_names[rec->level], color_reset);
+        } else {
+            line_printf(&line, "[%s] ", log_level_names[rec->level]);
+        }
+        line_printf(&line, "%s", rec->text);
+        if (rec->suppressed) {
+            line_printf(&line, " (%u similar messages suppressed)", rec->suppressed);
+        }
+    }
+    
+    buf[line.len++] = '\n';
+    buf[line.len] = '\0';
+    return line.len;
+}
+
+/**
+ * Write every queued message (caller holds write_lock)
+ * Lines are batched into LOG_WRITE_BATCH-byte writes and flushed once
+ *
+ * @return Number of messages written
+ */
+static size_t drain_queue_locked(FILE *output) {
+    char batch[LOG_WRITE_BATCH];
+    size_t len = 0;
+    size_t written = 0;
+    size_t pos = atomic_load_explicit(&g_log_queue.dequeue_pos, memory_order_relaxed);
+    bool use_color = g_logger_config.format == LOG_FORMAT_TEXT && is_tty(output);
+    uint64_t dropped;
+    
+    for (;;) {
+        log_slot_t *slot = &g_log_queue.slots[pos & (LOG_QUEUE_SLOTS - 1)];
+        log_record_t rec;
+        
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1) {
+            break;
+        }
+        
+        if (sizeof(batch) - len < LOG_LINE_MAX) {
+            fwrite(batch, 1, len, output);
+            len = 0;
+        }
+        
+        rec = (log_record_t){ slot->level, slot->suppressed, slot->time_ns, slot->text, NULL, NULL };
+        len += format_line(batch + len, LOG_LINE_MAX, &rec, use_color);
+        
+        /* Hand the slot back for the producer one lap ahead */
+        atomic_store_explicit(&slot->seq, pos + LOG_QUEUE_SLOTS, memory_order_release);
+        pos++;
+        written++;
+    }
+    atomic_store_explicit(&g_log_queue.dequeue_pos, pos, memory_order_relaxed);
+    
+    dropped = atomic_load_explicit(&g_log_queue.dropped, memory_order_relaxed);
+    if (dropped != g_log_queue.dropped_reported) {
+        char text[64];
+        log_record_t rec = { LOG_LEVEL_WARN, 0, timestamp_now_ns(), text, NULL, NULL };
+        
+        snprintf(text, sizeof(text), "%lu log messages dropped (log queue full)",
+                 (unsigned long)(dropped - g_log_queue.dropped_reported));
+        g_log_queue.dropped_reported = dropped;
+        if (sizeof(batch) - len < LOG_LINE_MAX) {
+            fwrite(batch, 1, len, output);
+            len = 0;
+        }
+        len += format_line(batch + len, LOG_LINE_MAX, &rec, use_color);
+    }
+    
+    if (len > 0) {
+        fwrite(batch, 1, len, output);
+    }
+    if (written > 0 || len > 0) {
+        fflush(output);
+    }
+    
+    return written;
+}
+
+/**
+ * Take the output for a direct write, after anything still queued
+ */
+static FILE *begin_direct_output(void) {
+    FILE *output = log_output();
+    
+    pthread_mutex_lock(&write_lock);
+    drain_queue_locked(output);
+    return output;
+}
+
+static void end_direct_output(FILE *output) {
+    fflush(output);
+    pthread_mutex_unlock(&write_lock);
+}
+
+/**
+ * Write one record as a line, after anything still queued
+ */
+static void write_record(const log_record_t *rec) {
+    char line[LOG_LINE_MAX];
+    FILE *output = begin_direct_output();
+    size_t len = format_line(line, sizeof(line), rec,
+                             g_logger_config.format == LOG_FORMAT_TEXT && is_tty(output));
+    
+    fwrite(line, 1, len, output);
+    end_direct_output(output);
+}
+
+/**
+ * Wake the writer if it is sleeping in the idle wait of log_writer_main
+ */
+static void notify_writer(void) {
+    /* Pairs with the fence in log_writer_main: either the writer sees
+     * the new message, or we see that it is waiting */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&g_log_queue.writer_waiting, memory_order_relaxed)) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_log_queue.wait_lock);
+    pthread_cond_signal(&g_log_queue.cond);
+    pthread_mutex_unlock(&g_log_queue.wait_lock);
+}
+
+static bool queue_has_messages(void) {
+    size_t pos = atomic_load_explicit(&g_log_queue.dequeue_pos, memory_order_relaxed);
+    log_slot_t *slot = &g_log_queue.slots[pos & (LOG_QUEUE_SLOTS - 1)];
+    
+    return atomic_load_explicit(&slot->seq, memory_order_acquire) == pos + 1;
+}
+
+/**
+ * Keep a rate-limited site's message for the shutdown summary
+ */
+static void remember_message(log_ratelimit_t *site, const char *text) {
+    size_t len;
+    
+    if (!site) {
+        return;
+    }
+    len = strnlen(text, sizeof(site->last) - 1);
+    memcpy(site->last, text, len);
+    site->last[len] = '\0';
+}
+
+/**
+ * Queue a message for the writer
+ * Formats into the claimed slot; never waits for space
+ *
+ * @return true if queued, false if the queue was full (counted as dropped)
+ */
+static bool enqueue_message(log_level_t level, uint32_t suppressed, const char *format,
+                            va_list args, log_ratelimit_t *site) {
+    size_t pos = atomic_load_explicit(&g_log_queue.enqueue_pos, memory_order_relaxed);
+    log_slot_t *slot;
+    
+    for (;;) {
+        slot = &g_log_queue.slots[pos & (LOG_QUEUE_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&g_log_queue.enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if ((ptrdiff_t)(seq - pos) < 0) {
+            /* The writer has not freed this slot from the previous lap */
+            atomic_fetch_add_explicit(&g_log_queue.dropped, 1, memory_order_relaxed);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&g_log_queue.enqueue_pos, memory_order_relaxed);
+        }
+    }
+    
+    slot->level = level;
+    slot->suppressed = suppressed;
+    slot->time_ns = g_logger_config.format == LOG_FORMAT_JSON ? timestamp_now_ns() : 0;
+    vsnprintf(slot->text, sizeof(slot->text), format, args);
+    remember_message(site, slot->text);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    
+    notify_writer();
+    return true;
+}
+
 /**
  * Core logging function
  * Requirement: 15.3 - Structured logging with INFO, WARN, ERROR, DEBUG levels
+ * Queues the message when the writer thread runs, otherwise writes it
+ * as one line with a single fwrite
  */
+static void log_message_va(log_level_t level, uint32_t suppressed, const char *format,
+                           va_list args, log_ratelimit_t *site) {
+    char text[LOG_MESSAGE_MAX];
+    log_record_t rec;
+    
+    if (atomic_load_explicit(&g_log_queue.running, memory_order_acquire)) {
+        enqueue_message(level, suppressed, format, args, site);
+        return;
+    }
+    
+    vsnprintf(text, sizeof(text), format, args);
+    remember_message(site, text);
+    rec = (log_record_t){ level, suppressed,
+                          g_logger_config.format == LOG_FORMAT_JSON ? timestamp_now_ns() : 0,
+                          text, NULL, NULL };
+    write_record(&rec);
+}
+
 static void log_message(log_level_t level, const char *format, va_list args) {
-    FILE *output;
-    bool use_color;
+    if (!level_enabled(level)) {
+        return;
+    }
+    log_message_va(level, 0, format, args, NULL);
+}
+
+/**
+ * Rate-limited logging, one call site per site struct (see log_ratelimited)
+ * The first call of each window writes the message with the number of
+ * messages suppressed in the windows before it
+ */
+void log_message_ratelimited(log_ratelimit_t *site, log_level_t level, const char *format, ...) {
+    uint64_t now;
+    uint64_t start;
+    uint32_t suppressed = 0;
+    va_list args;
     
-    /* Check if we should log this level */
-    if (level < g_logger_config.min_level) {
+    if (!site || !level_enabled(level)) {
         return;
     }
     
-    /* Quiet mode suppresses everything except errors */
-    if (g_logger_config.quiet && level != LOG_LEVEL_ERROR) {
+    now = timestamp_boot_ns();
+    start = atomic_load_explicit(&site->window_start_ns, memory_order_relaxed);
+    if ((start == 0 || now - start >= LOG_RATELIMIT_INTERVAL_NS) &&
+        atomic_compare_exchange_strong_explicit(&site->window_start_ns, &start, now,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        uint32_t seen = atomic_exchange_explicit(&site->count, 1, memory_order_relaxed);
+        suppressed = seen > LOG_RATELIMIT_BURST ? seen - LOG_RATELIMIT_BURST : 0;
+    } else if (atomic_fetch_add_explicit(&site->count, 1, memory_order_relaxed) >=
+               LOG_RATELIMIT_BURST) {
+        /* Remember the site so shutdown can report what it held back */
+        if (!atomic_exchange_explicit(&site->listed, true, memory_order_relaxed)) {
+            site->level = level;
+            site->next = atomic_load_explicit(&g_ratelimit_sites, memory_order_relaxed);
+            while (!atomic_compare_exchange_weak_explicit(&g_ratelimit_sites, &site->next, site,
+                                                          memory_order_release,
+                                                          memory_order_relaxed)) {
+            }
+        }
         return;
     }
     
-    output = g_logger_config.output ? g_logger_config.output : stderr;
-    use_color = is_tty(output);
+    va_start(args, format);
+    log_message_va(level, suppressed, format, args, site);
+    va_end(args);
+}
+
+static void *log_writer_main(void *arg) {
+    (void)arg;
     
-    /* Print log level with optional color */
-    if (use_color) {
-        fprintf(output, "%s[%s]%s ", 
-                log_level_colors[level],
-                log_level_names[level],
-                color_reset);
-    } else {
-        fprintf(output, "[%s] ", log_level_names[level]);
+    while (atomic_load_explicit(&g_log_queue.running, memory_order_acquire)) {
+        size_t written;
+        
+        pthread_mutex_lock(&write_lock);
+        written = drain_queue_locked(log_output());
+        pthread_mutex_unlock(&write_lock);
+        
+        if (written > 0) {
+            continue;
+        }
+        
+        /* Sleep until a producer queues something or shutdown wakes us */
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_WRITER_IDLE_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        
+        pthread_mutex_lock(&g_log_queue.wait_lock);
+        atomic_store_explicit(&g_log_queue.writer_waiting, true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        while (!g_log_queue.woken && !queue_has_messages()) {
+            if (pthread_cond_timedwait(&g_log_queue.cond, &g_log_queue.wait_lock,
+                                       &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        g_log_queue.woken = false;
+        atomic_store_explicit(&g_log_queue.writer_waiting, false, memory_order_relaxed);
+        pthread_mutex_unlock(&g_log_queue.wait_lock);
     }
     
-    /* Print the actual message */
-    vfprintf(output, format, args);
-    fprintf(output, "\n");
-    fflush(output);
+    return NULL;
+}
+
+/**
+ * Start the writer thread
+ * From here on log calls only queue their message
+ *
+ * @return 0 on success, -1 on failure (logging stays synchronous)
+ */
+int logger_start_async(void) {
+    int err;
+    
+    if (atomic_load_explicit(&g_log_queue.running, memory_order_relaxed)) {
+        return 0;
+    }
+    
+    for (size_t i = 0; i < LOG_QUEUE_SLOTS; i++) {
+        atomic_store_explicit(&g_log_queue.slots[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&g_log_queue.enqueue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&g_log_queue.dequeue_pos, 0, memory_order_relaxed);
+    g_log_queue.woken = false;
+    
+    atomic_store_explicit(&g_log_queue.running, true, memory_order_release);
+    err = pthread_create(&g_log_queue.writer, NULL, log_writer_main, NULL);
+    if (err != 0) {
+        atomic_store_explicit(&g_log_queue.running, false, memory_order_release);
+        errno = err;
+        log_system_error("Failed to start log writer thread");
+        return -1;
+    }
+    
+    return 0;
+}
+
+/**
+ * Write everything queued so far
+ * Safe from any thread; does nothing when logging is synchronous
+ */
+void logger_flush(void) {
+    pthread_mutex_lock(&write_lock);
+    drain_queue_locked(log_output());
+    pthread_mutex_unlock(&write_lock);
+}
+
+/**
+ * Stop the writer thread and report suppressed messages
+ * Messages logged after this are written synchronously
+ */
+void logger_shutdown(void) {
+    log_ratelimit_t *site;
+    
+    if (atomic_load_explicit(&g_log_queue.running, memory_order_relaxed)) {
+        atomic_store_explicit(&g_log_queue.running, false, memory_order_release);
+        
+        pthread_mutex_lock(&g_log_queue.wait_lock);
+        g_log_queue.woken = true;
+        pthread_cond_signal(&g_log_queue.cond);
+        pthread_mutex_unlock(&g_log_queue.wait_lock);
+        
+        pthread_join(g_log_queue.writer, NULL);
+        
+        /* Producers that saw running before it was cleared may still
+         * be filling slots; those are written by the final drain */
+        logger_flush();
+    }
+    
+    for (site = atomic_exchange_explicit(&g_ratelimit_sites, NULL, memory_order_acquire); site;
+         site = site->next) {
+        uint32_t seen = atomic_exchange_explicit(&site->count, 0, memory_order_relaxed);
+        
+        atomic_store_explicit(&site->listed, false, memory_order_relaxed);
+        if (seen > LOG_RATELIMIT_BURST && level_enabled(site->level)) {
+            log_record_t rec = { site->level, seen - LOG_RATELIMIT_BURST, timestamp_now_ns(),
+                                 site->last, NULL, NULL };
+            
+            write_record(&rec);
+        }
+    }
+}
+
+uint64_t logger_dropped(void) {
+    return atomic_load_explicit(&g_log_queue.dropped, memory_order_relaxed);
 }
 
 /**
@@ -191,8 +721,18 @@ void log_error(const char *format, ...) {
  * Requirement: 15.5 - Create helpful error messages with suggested solutions
  */
 void log_error_with_suggestion(const char *error_msg, const char *suggestion) {
-    FILE *output = g_logger_config.output ? g_logger_config.output : stderr;
-    bool use_color = is_tty(output);
+    FILE *output;
+    bool use_color;
+    
+    if (g_logger_config.format == LOG_FORMAT_JSON) {
+        log_record_t rec = { LOG_LEVEL_ERROR, 0, timestamp_now_ns(), error_msg,
+                             "suggestion", suggestion && *suggestion ? suggestion : NULL };
+        write_record(&rec);
+        return;
+    }
+    
+    output = begin_direct_output();
+    use_color = is_tty(output);
     
     /* Print error message */
     if (use_color) {
@@ -213,7 +753,7 @@ void log_error_with_suggestion(const char *error_msg, const char *suggestion) {
         }
     }
     
-    fflush(output);
+    end_direct_output(output);
 }
 
 /**
@@ -221,8 +761,22 @@ void log_error_with_suggestion(const char *error_msg, const char *suggestion) {
  * Requirement: 15.6 - Add BPF verifier output logging for program load failures
  */
 void log_bpf_verifier_error(const char *program_name, int error_code, const char *verifier_log) {
-    FILE *output = g_logger_config.output ? g_logger_config.output : stderr;
-    bool use_color = is_tty(output);
+    FILE *output;
+    bool use_color;
+    
+    if (g_logger_config.format == LOG_FORMAT_JSON) {
+        char text[LOG_MESSAGE_MAX];
+        log_record_t rec = { LOG_LEVEL_ERROR, 0, timestamp_now_ns(), text,
+                             "verifier_log", verifier_log && *verifier_log ? verifier_log : NULL };
+        
+        snprintf(text, sizeof(text), "Failed to load eBPF program: %s (error code: %d)",
+                 program_name, error_code);
+        write_record(&rec);
+        return;
+    }
+    
+    output = begin_direct_output();
+    use_color = is_tty(output);
     
     /* Print error header */
     if (use_color) {
@@ -260,7 +814,7 @@ void log_bpf_verifier_error(const char *program_name, int error_code, const char
     fprintf(output, "  - Run with --verbose for more details\n");
     fprintf(output, "  - Check dmesg for kernel messages: dmesg | tail -20\n");
     
-    fflush(output);
+    end_direct_output(output);
 }
 
 /**
@@ -269,22 +823,6 @@ void log_bpf_verifier_error(const char *program_name, int error_code, const char
  */
 void log_system_error(const char *operation) {
     int saved_errno = errno;
-    FILE *output = g_logger_config.output ? g_logger_config.output : stderr;
-    bool use_color = is_tty(output);
-    
-    if (use_color) {
-        fprintf(output, "%s[ERROR]%s %s: %s (errno: %d)\n",
-                log_level_colors[LOG_LEVEL_ERROR],
-                color_reset,
-                operation,
-                strerror(saved_errno),
-                saved_errno);
-    } else {
-        fprintf(output, "[ERROR] %s: %s (errno: %d)\n",
-                operation,
-                strerror(saved_errno),
-                saved_errno);
-    }
     
-    fflush(output);
+    log_error("%s: %s (errno: %d)", operation, strerror(saved_errno), saved_errno);
 }
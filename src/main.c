@@ -20,6 +20,8 @@
 #include <limits.h>
 #include <signal.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "include/crypto_tracer.h"
 #include "include/logger.h"
 #include "include/ebpf_manager.h"
@@ -28,6 +30,19 @@
 #include "include/profile_manager.h"
 #include "include/proc_scanner.h"
 #include "include/privacy_filter.h"
+#include "include/spsc_queue.h"
+#include "include/snapshot_scanner.h"
+#include "include/crypto_classifier.h"
+#include "include/binary_format.h"
+#include "include/timestamp.h"
+#include "include/proc_cache.h"
+#include "include/raw_capture.h"
+#include "include/pipeline_stats.h"
+#include "include/metrics.h"
+#include "include/daemon.h"
+#include "include/topk_summary.h"
+#include "include/output_sink.h"
+#include "include/exporter.h"
 
 /* Minimum supported kernel version */
 #define MIN_KERNEL_MAJOR 4
@@ -45,7 +60,13 @@
 /* Default values */
 #define DEFAULT_DURATION 0           /* Unlimited */
 #define DEFAULT_PROFILE_DURATION 30  /* 30 seconds for profile command */
+#define DEFAULT_PROFILE_INTERVAL 60  /* Seconds between profile --all deltas */
+#define DEFAULT_SUMMARY_INTERVAL 10  /* Seconds between monitor summaries */
+#define DEFAULT_GZIP_LEVEL 6         /* --compress gzip */
+#define DEFAULT_DRAIN_TIMEOUT_MS 1000 /* Longest drain of buffered events at exit */
 #define DEFAULT_FORMAT FORMAT_JSON_STREAM
+#define MAX_RATE_LIMIT 10000000     /* --rate-limit events per second */
+#define MAX_SAMPLE_EVERY 1000000    /* --sample 1 in N */
 
 /* External shutdown flag from signal_handler.c */
 extern volatile sig_atomic_t shutdown_requested;
@@ -74,6 +95,9 @@ void print_usage(const char *program_name) {
     printf("  snapshot             Take quick snapshot of all crypto usage\n");
     printf("  libs                 List loaded cryptographic libraries\n");
     printf("  files                Track access to cryptographic files\n");
+    printf("  decode [FILE]        Convert a binary capture to JSON\n");
+    printf("  replay FILE          Run a raw capture (--record-raw) through the event pipeline\n");
+    printf("  daemon               Keep the probes attached and serve events to --daemon clients\n");
     printf("  help [command]       Show help for a specific command\n");
     printf("  version              Show version information\n");
     printf("\n");
@@ -82,14 +106,24 @@ void print_usage(const char *program_name) {
     printf("  -v, --verbose        Enable verbose output\n");
     printf("  -q, --quiet          Quiet mode (minimal output)\n");
     printf("  -o, --output FILE    Write output to FILE instead of stdout\n");
-    printf("  -f, --format FORMAT  Output format: json-stream, json-array, json-pretty, summary\n");
+    printf("  -f, --format FORMAT  Output format: json-stream, json-array, json-pretty, summary, binary\n");
     printf("  --no-redact          Disable privacy path redaction\n");
+    printf("  --ringbuf-size SIZE  Ring buffer size per probe, e.g. 4M (power of two, default 1M)\n");
+    printf("  --lazy-wakeup        Batch ring buffer wakeups (fewer wakeups, up to 10ms latency)\n");
+    printf("  --coalesce WINDOW    Count repeated opens/loads of a path in the kernel, e.g. 5s\n");
+    printf("  --drain-timeout TIME Longest wait to drain buffered events at exit (default: 1s)\n");
+    printf("  --rate-limit [TYPE=]N  Submit at most N events per second (per event type)\n");
+    printf("  --sample [TYPE=]N    Keep 1 event in N; kept events carry the count they stand for\n");
+    printf("  --crypto-rules FILE  Classify crypto files and libraries with the rules in FILE\n");
+    printf("  --log-format FORMAT  Diagnostic log format on stderr: text (default) or json\n");
+    printf("  --daemon[=SOCKET]    Read events from a running crypto-tracer daemon (no root needed)\n");
     printf("\n");
     printf("Examples:\n");
     printf("  %s monitor --duration 60                    # Monitor for 60 seconds\n", program_name);
     printf("  %s profile --pid 1234 --duration 30         # Profile process 1234\n", program_name);
     printf("  %s snapshot --format summary                # Quick system snapshot\n", program_name);
     printf("  %s files --file '/etc/ssl/*.pem'            # Track certificate access\n", program_name);
+    printf("  %s monitor -f binary -o capture.bin         # Full-rate binary capture\n", program_name);
     printf("\n");
     printf("For detailed help on a specific command, use: %s help <command>\n", program_name);
 }
@@ -107,20 +141,55 @@ void print_command_help(command_type_t cmd) {
             printf("  -d, --duration SECONDS   Monitor for specified duration (default: unlimited)\n");
             printf("  -p, --pid PID            Monitor specific process ID\n");
             printf("  -n, --name NAME          Monitor processes matching name\n");
+            printf("  --cgroup PATH            Keep events of a cgroup v2 subtree, e.g. /system.slice\n");
+            printf("  --container ID           Keep events of a container (id prefix) or pod (UID)\n");
             printf("  -l, --library LIB        Filter by library name\n");
             printf("  -F, --file PATTERN       Filter by file path (glob pattern)\n");
             printf("  -o, --output FILE        Write output to file\n");
-            printf("  -f, --format FORMAT      Output format (json-stream, json-array, json-pretty)\n");
+            printf("  -f, --format FORMAT      Output format (json-stream, json-array, json-pretty, summary,\n");
+            printf("                           binary)\n");
+            printf("  --top K                  Write the top K processes, files, libraries and API\n");
+            printf("                           functions instead of events (summary: K = 10)\n");
+            printf("  --interval SECONDS       Seconds between summaries (default: 10)\n");
+            printf("  --compress gzip[:LEVEL]  Compress the --output file or exported batches\n");
+            printf("                           (default level 6; exported batches: gzip)\n");
+            printf("  --rotate-size SIZE       Start a new --output file at SIZE, e.g. 512M\n");
+            printf("  --rotate-interval TIME   Start a new --output file every TIME, e.g. 60m\n");
+            printf("  --rotate-keep N          Keep the last N rotated files\n");
+            printf("  --export HOST:PORT       Send the output in batches to a collector over TCP\n");
+            printf("  --spool-dir DIR          Spool batches to DIR while the collector is unreachable\n");
+            printf("  --spool-max SIZE         Spool at most SIZE, dropping the oldest (default: 1G)\n");
             printf("  -v, --verbose            Enable verbose output\n");
             printf("  -q, --quiet              Quiet mode\n");
             printf("  --no-redact              Disable path redaction\n");
+            printf("  --coalesce WINDOW        Report repeated opens/loads of a path once per WINDOW\n");
+            printf("  --rate-limit [TYPE=]N    Submit at most N events per second, e.g. file_open=1000\n");
+            printf("  --sample [TYPE=]N        Keep 1 event in N, e.g. api_call=10\n");
+            printf("  --stats-file FILE        Write run statistics to FILE as JSON on exit\n");
+            printf("  --record-raw FILE        Also record raw ring buffer records to FILE for replay\n");
+            printf("  --metrics-socket PATH    Serve live Prometheus metrics on a unix socket\n");
+            printf("  --stats-interval SECONDS Print a JSON stats line to stderr every SECONDS\n");
+            printf("  --ring-shards cpu|node   One ring buffer per CPU or NUMA node, one consumer per node\n");
+            printf("  --ordered                With --ring-shards, write events in timestamp order\n");
+            printf("  --drain-timeout TIME     Longest wait to drain buffered events at exit (default: 1s)\n");
+            printf("  --daemon[=SOCKET]        Read events from a running crypto-tracer daemon\n");
             printf("\n");
             printf("Examples:\n");
             printf("  crypto-tracer monitor --duration 60\n");
             printf("  crypto-tracer monitor --pid 1234 --output events.json\n");
             printf("  crypto-tracer monitor --name nginx --library libssl\n");
+            printf("  crypto-tracer monitor --format binary --output capture.bin\n");
+            printf("  crypto-tracer monitor --coalesce 10s\n");
+            printf("  crypto-tracer monitor --rate-limit file_open=500 --sample api_call=10\n");
+            printf("  crypto-tracer monitor --metrics-socket /run/crypto-tracer.sock\n");
+            printf("  crypto-tracer monitor --ring-shards node --ordered\n");
+            printf("  crypto-tracer monitor --daemon --name nginx\n");
+            printf("  crypto-tracer monitor --container 3f2a9c1b7d4e\n");
+            printf("  crypto-tracer monitor --format summary --top 20 --interval 30\n");
+            printf("  crypto-tracer monitor -o events.json.gz --compress gzip --rotate-size 1G\n");
+            printf("  crypto-tracer monitor --export collector:9400 --spool-dir /var/spool/ct\n");
             break;
-            
+        
         case CMD_PROFILE:
             printf("Usage: crypto-tracer profile [options]\n\n");
             printf("Generate a detailed profile of a process's cryptographic usage.\n\n");
@@ -129,6 +198,10 @@ void print_command_help(command_type_t cmd) {
             printf("  -n, --name NAME          Target process name (alternative to --pid)\n");
             printf("  -d, --duration SECONDS   Profile duration (default: 30 seconds)\n");
             printf("  --follow-children        Include child processes in profile\n");
+            printf("  --all                    Profile every process, emitting deltas\n");
+            printf("  --interval SECONDS       Seconds between --all deltas (default: 60)\n");
+            printf("  --coalesce WINDOW        Count repeated opens of a file in the kernel\n");
+            printf("  --daemon[=SOCKET]        Read events from a running crypto-tracer daemon\n");
             printf("  -o, --output FILE        Write profile to file\n");
             printf("  -f, --format FORMAT      Output format (json-stream, json-pretty)\n");
             printf("  -v, --verbose            Enable verbose output\n");
@@ -138,8 +211,9 @@ void print_command_help(command_type_t cmd) {
             printf("  crypto-tracer profile --pid 1234\n");
             printf("  crypto-tracer profile --name nginx --duration 60\n");
             printf("  crypto-tracer profile --pid 1234 --follow-children\n");
+            printf("  crypto-tracer profile --all --interval 30 --output deltas.json\n");
             break;
-            
+        
         case CMD_SNAPSHOT:
             printf("Usage: crypto-tracer snapshot [options]\n\n");
             printf("Take a quick snapshot of all cryptographic usage on the system.\n\n");
@@ -148,47 +222,120 @@ void print_command_help(command_type_t cmd) {
             printf("  -f, --format FORMAT      Output format (json-pretty, summary)\n");
             printf("  -v, --verbose            Enable verbose output\n");
             printf("  --no-redact              Disable path redaction\n");
+            printf("  --library-index          List each library once and refer to it by index\n");
+            printf("  --incremental            Rescan only processes new or changed since the last run\n");
+            printf("  --state FILE             Incremental: per-process state kept between runs\n");
+            printf("  --diff                   Incremental: write the added and removed entries only\n");
             printf("\n");
             printf("Examples:\n");
             printf("  crypto-tracer snapshot\n");
             printf("  crypto-tracer snapshot --format summary\n");
             printf("  crypto-tracer snapshot --output snapshot.json\n");
+            printf("  crypto-tracer snapshot --incremental --state /var/lib/crypto-tracer/snapshot.state --diff\n");
             break;
-            
+        
         case CMD_LIBS:
             printf("Usage: crypto-tracer libs [options]\n\n");
             printf("List all loaded cryptographic libraries.\n\n");
             printf("Options:\n");
             printf("  -l, --library LIB        Filter by library name\n");
+            printf("  --cgroup PATH            Keep events of a cgroup v2 subtree, e.g. /system.slice\n");
+            printf("  --container ID           Keep events of a container (id prefix) or pod (UID)\n");
             printf("  -d, --duration SECONDS   Monitor duration (default: unlimited)\n");
             printf("  -o, --output FILE        Write output to file\n");
             printf("  -f, --format FORMAT      Output format (json-stream, json-array)\n");
             printf("  -v, --verbose            Enable verbose output\n");
             printf("  --no-redact              Disable path redaction\n");
+            printf("  --daemon[=SOCKET]        Read events from a running crypto-tracer daemon\n");
             printf("\n");
             printf("Examples:\n");
             printf("  crypto-tracer libs\n");
             printf("  crypto-tracer libs --library libssl\n");
             printf("  crypto-tracer libs --duration 60 --output libs.json\n");
             break;
-            
+        
         case CMD_FILES:
             printf("Usage: crypto-tracer files [options]\n\n");
             printf("Track access to cryptographic files (certificates, keys, keystores).\n\n");
             printf("Options:\n");
             printf("  -F, --file PATTERN       Filter by file path (glob pattern)\n");
+            printf("  --cgroup PATH            Keep events of a cgroup v2 subtree, e.g. /system.slice\n");
+            printf("  --container ID           Keep events of a container (id prefix) or pod (UID)\n");
             printf("  -d, --duration SECONDS   Monitor duration (default: unlimited)\n");
             printf("  -o, --output FILE        Write output to file\n");
             printf("  -f, --format FORMAT      Output format (json-stream, json-array)\n");
             printf("  -v, --verbose            Enable verbose output\n");
             printf("  --no-redact              Disable path redaction\n");
+            printf("  --daemon[=SOCKET]        Read events from a running crypto-tracer daemon\n");
             printf("\n");
             printf("Examples:\n");
             printf("  crypto-tracer files\n");
             printf("  crypto-tracer files --file '/etc/ssl/*.pem'\n");
             printf("  crypto-tracer files --duration 60 --output files.json\n");
             break;
-            
+        
+        case CMD_DECODE:
+            printf("Usage: crypto-tracer decode [options] [FILE]\n\n");
+            printf("Convert a binary capture (--format binary) to JSON.\n");
+            printf("Reads FILE, or standard input if no FILE is given.\n\n");
+            printf("Options:\n");
+            printf("  -o, --output FILE        Write JSON to file\n");
+            printf("  -f, --format FORMAT      Output format (json-stream, json-array, json-pretty)\n");
+            printf("  -v, --verbose            Enable verbose output\n");
+            printf("\n");
+            printf("Examples:\n");
+            printf("  crypto-tracer decode capture.bin\n");
+            printf("  crypto-tracer decode capture.bin --format json-array --output events.json\n");
+            break;
+        
+        case CMD_REPLAY:
+            printf("Usage: crypto-tracer replay [options] FILE\n\n");
+            printf("Run a raw capture (monitor --record-raw) through decoding, enrichment,\n");
+            printf("filtering and output as fast as possible, without BPF or root.\n");
+            printf("Process metadata comes from the /proc reads recorded with the capture.\n\n");
+            printf("Options:\n");
+            printf("  -p, --pid PID            Keep events of a specific process ID\n");
+            printf("  -n, --name NAME          Keep events of processes matching name\n");
+            printf("  -l, --library LIB        Filter by library name\n");
+            printf("  -F, --file PATTERN       Filter by file path (glob pattern)\n");
+            printf("  --cgroup PATH            Keep events of a cgroup v2 subtree, e.g. /system.slice\n");
+            printf("  --container ID           Keep events of a container (id prefix) or pod (UID)\n");
+            printf("  -o, --output FILE        Write output to file\n");
+            printf("  -f, --format FORMAT      Output format (json-stream, json-array, json-pretty, binary)\n");
+            printf("  --no-redact              Disable path redaction\n");
+            printf("  --stats-file FILE        Write run statistics to FILE as JSON on exit\n");
+            printf("\n");
+            printf("Examples:\n");
+            printf("  sudo crypto-tracer monitor --duration 60 --record-raw trace.raw\n");
+            printf("  crypto-tracer replay trace.raw --output /dev/null --stats-file stats.json\n");
+            break;
+        
+        case CMD_DAEMON:
+            printf("Usage: crypto-tracer daemon [options]\n\n");
+            printf("Attach every probe once and serve the events to clients started with\n");
+            printf("--daemon, so concurrent monitor, profile, libs and files runs share one\n");
+            printf("set of probes. Each client gets only the event types, process and name\n");
+            printf("it asked for. Runs until interrupted or for --duration.\n\n");
+            printf("Options:\n");
+            printf("  --socket PATH            Client socket (default: %s)\n", DAEMON_DEFAULT_SOCKET);
+            printf("  --pin-dir DIR            bpffs directory for the pinned maps and programs\n");
+            printf("                           (default: %s)\n", DAEMON_DEFAULT_PIN_DIR);
+            printf("  -d, --duration SECONDS   Serve for specified duration (default: unlimited)\n");
+            printf("  --ringbuf-size SIZE      Ring buffer size per probe, e.g. 4M\n");
+            printf("  --lazy-wakeup            Batch ring buffer wakeups\n");
+            printf("  --coalesce WINDOW        Report repeated opens/loads of a path once per WINDOW\n");
+            printf("  --rate-limit [TYPE=]N    Submit at most N events per second, e.g. file_open=1000\n");
+            printf("  --sample [TYPE=]N        Keep 1 event in N, e.g. api_call=10\n");
+            printf("  --metrics-socket PATH    Serve live Prometheus metrics on a unix socket\n");
+            printf("  --stats-interval SECONDS Print a JSON stats line to stderr every SECONDS\n");
+            printf("  -v, --verbose            Enable verbose output\n");
+            printf("\n");
+            printf("Examples:\n");
+            printf("  sudo crypto-tracer daemon\n");
+            printf("  crypto-tracer monitor --daemon --name nginx\n");
+            printf("  crypto-tracer files --daemon=/run/ct.sock --file '/etc/ssl/*'\n");
+            break;
+        
         default:
             printf("No help available for this command.\n");
             break;
@@ -203,6 +350,7 @@ static void init_args(cli_args_t *args) {
     args->command = CMD_NONE;
     args->duration = DEFAULT_DURATION;
     args->output_file = NULL;
+    args->input_file = NULL;
     args->format = DEFAULT_FORMAT;
     args->pid = 0;
     args->process_name = NULL;
@@ -212,6 +360,39 @@ static void init_args(cli_args_t *args) {
     args->quiet = false;
     args->no_redact = false;
     args->follow_children = false;
+    args->profile_all = false;
+    args->profile_interval = 0;
+    args->ringbuf_size = 0;
+    args->lazy_wakeup = false;
+    args->coalesce_window_ms = 0;
+    args->drain_timeout_ms = DEFAULT_DRAIN_TIMEOUT_MS;
+    memset(args->rate_limit, 0, sizeof(args->rate_limit));
+    memset(args->sample_every, 0, sizeof(args->sample_every));
+    args->library_index = false;
+    args->incremental = false;
+    args->state_file = NULL;
+    args->snapshot_diff = false;
+    args->log_json = false;
+    args->rules_file = NULL;
+    args->stats_file = NULL;
+    args->record_file = NULL;
+    args->metrics_socket = NULL;
+    args->stats_interval = 0;
+    args->summary_top = 0;
+    args->gzip_level = -1;
+    args->rotate_bytes = 0;
+    args->rotate_interval_ms = 0;
+    args->rotate_keep = 0;
+    args->export_address = NULL;
+    args->spool_dir = NULL;
+    args->spool_max_bytes = 0;
+    args->ring_layout = EBPF_RINGS_PER_PROGRAM;
+    args->ordered_output = false;
+    args->cgroup_filter = NULL;
+    args->container_filter = NULL;
+    args->use_daemon = false;
+    args->daemon_socket = NULL;
+    args->pin_dir = NULL;
     args->exit_after_parse = false;
 }
 
@@ -228,10 +409,136 @@ static int parse_format(const char *format_str) {
         return FORMAT_JSON_PRETTY;
     } else if (strcmp(format_str, "summary") == 0) {
         return FORMAT_SUMMARY;
+    } else if (strcmp(format_str, "binary") == 0) {
+        return FORMAT_BINARY;
     }
     return -1;
 }
 
+/**
+ * Parse a size in bytes with an optional K/M/G suffix
+ * Returns size in bytes, or 0 if invalid or over max
+ */
+static uint64_t parse_byte_size(const char *size_str, uint64_t max) {
+    char *endptr;
+    unsigned long long size = strtoull(size_str, &endptr, 10);
+    unsigned int shift = 0;
+    
+    if (endptr == size_str) {
+        return 0;
+    }
+    
+    if (*endptr == 'k' || *endptr == 'K') {
+        shift = 10;
+        endptr++;
+    } else if (*endptr == 'm' || *endptr == 'M') {
+        shift = 20;
+        endptr++;
+    } else if (*endptr == 'g' || *endptr == 'G') {
+        shift = 30;
+        endptr++;
+    }
+    
+    if (*endptr != '\0' || size == 0 || size > (max >> shift)) {
+        return 0;
+    }
+    
+    return (uint64_t)size << shift;
+}
+
+/**
+ * Parse a ring buffer size with an optional K/M/G suffix
+ * Returns size in bytes, or 0 if invalid or not a power of two
+ */
+static uint32_t parse_ringbuf_size(const char *size_str) {
+    uint64_t size = parse_byte_size(size_str, 1ULL << 30);
+    
+    if ((size & (size - 1)) != 0) {
+        return 0;
+    }
+    
+    return (uint32_t)size;
+}
+
+/**
+ * Parse a coalescing window: a number with an optional ms, s or m suffix
+ * (seconds without one)
+ * Returns the window in milliseconds, or 0 if invalid or over a day
+ */
+static uint32_t parse_window_ms(const char *window_str) {
+    char *endptr;
+    unsigned long long window = strtoull(window_str, &endptr, 10);
+    
+    if (endptr == window_str || window > 86400000ULL) {
+        return 0;
+    }
+    
+    if (strcmp(endptr, "ms") == 0) {
+        /* Already milliseconds */
+    } else if (*endptr == '\0' || strcmp(endptr, "s") == 0) {
+        window *= 1000;
+    } else if (strcmp(endptr, "m") == 0) {
+        window *= 60000;
+    } else {
+        return 0;
+    }
+    
+    if (window == 0 || window > 86400000ULL) {
+        return 0;
+    }
+    
+    return (uint32_t)window;
+}
+
+/* Event type names for --rate-limit and --sample (ebpf_source_t order) */
+static const char *rate_limit_type_names[RATE_LIMIT_TYPES] = {
+    "file_open", "lib_load", "process_exec", "process_exit", "api_call",
+};
+
+/**
+ * Parse a [TYPE=]N limit into values, indexed like rate_limit_type_names
+ * Without a TYPE, N applies to every event type. An optional suffix
+ * (e.g. "/s") is accepted and skipped.
+ * Returns 0 on success, -1 if invalid or N is not in 1..max
+ */
+static int parse_type_limit(const char *arg, const char *suffix, uint32_t max,
+                            uint32_t values[RATE_LIMIT_TYPES]) {
+    const char *value_str = arg;
+    const char *eq = strchr(arg, '=');
+    int type = -1;
+    char *endptr;
+    unsigned long long value;
+    
+    if (eq) {
+        for (int i = 0; i < RATE_LIMIT_TYPES; i++) {
+            if (strlen(rate_limit_type_names[i]) == (size_t)(eq - arg) &&
+                strncmp(arg, rate_limit_type_names[i], (size_t)(eq - arg)) == 0) {
+                type = i;
+                break;
+            }
+        }
+        if (type < 0) {
+            return -1;
+        }
+        value_str = eq + 1;
+    }
+    
+    value = strtoull(value_str, &endptr, 10);
+    if (endptr == value_str || value == 0 || value > max) {
+        return -1;
+    }
+    if (*endptr != '\0' && (!suffix || strcmp(endptr, suffix) != 0)) {
+        return -1;
+    }
+    
+    for (int i = 0; i < RATE_LIMIT_TYPES; i++) {
+        if (type < 0 || type == i) {
+            values[i] = (uint32_t)value;
+        }
+    }
+    return 0;
+}
+
 /**
  * Parse command string
  * Returns command type or CMD_NONE on error
@@ -247,6 +554,12 @@ static command_type_t parse_command(const char *cmd_str) {
         return CMD_LIBS;
     } else if (strcmp(cmd_str, "files") == 0) {
         return CMD_FILES;
+    } else if (strcmp(cmd_str, "decode") == 0) {
+        return CMD_DECODE;
+    } else if (strcmp(cmd_str, "replay") == 0) {
+        return CMD_REPLAY;
+    } else if (strcmp(cmd_str, "daemon") == 0) {
+        return CMD_DAEMON;
     } else if (strcmp(cmd_str, "help") == 0) {
         return CMD_HELP;
     } else if (strcmp(cmd_str, "version") == 0) {
@@ -260,8 +573,17 @@ static command_type_t parse_command(const char *cmd_str) {
  * Returns 0 on success, -1 on validation error
  */
 static int validate_args(cli_args_t *args) {
-    /* Profile command requires either --pid or --name */
-    if (args->command == CMD_PROFILE) {
+    /* Profile command requires either --pid or --name, or --all */
+    if (args->command == CMD_PROFILE && args->profile_all) {
+        if (args->pid != 0 || args->process_name != NULL) {
+            fprintf(stderr, "Error: --all cannot be combined with --pid or --name\n");
+            return -1;
+        }
+        if (args->follow_children) {
+            fprintf(stderr, "Warning: --follow-children is ignored with --all\n");
+        }
+        /* A system-wide profile runs until interrupted unless --duration is given */
+    } else if (args->command == CMD_PROFILE) {
         if (args->pid == 0 && args->process_name == NULL) {
             fprintf(stderr, "Error: profile command requires --pid or --name\n");
             fprintf(stderr, "Use 'crypto-tracer help profile' for more information\n");
@@ -273,6 +595,167 @@ static int validate_args(cli_args_t *args) {
         }
     }
     
+    /* A monitor summary replaces the event stream with refreshed top-K tables */
+    if (args->summary_top > 0 && args->command != CMD_MONITOR) {
+        fprintf(stderr, "Warning: --top is only supported for monitor command\n");
+        args->summary_top = 0;
+    } else if (args->command == CMD_MONITOR && args->format == FORMAT_SUMMARY &&
+               args->summary_top == 0) {
+        args->summary_top = TOPK_DEFAULT_K;
+    }
+    if (args->summary_top > 0 && args->format == FORMAT_BINARY) {
+        fprintf(stderr, "Error: --top cannot be used with --format binary\n");
+        return -1;
+    }
+    
+    /* The output sink compresses and rotates the monitor's output file */
+    if ((args->rotate_bytes > 0 || args->rotate_interval_ms > 0 || args->rotate_keep > 0) &&
+        (args->command != CMD_MONITOR || !args->output_file)) {
+        fprintf(stderr, "Error: --rotate-* are only supported for monitor with --output\n");
+        return -1;
+    }
+    if (args->gzip_level >= 0 &&
+        (args->command != CMD_MONITOR || (!args->output_file && !args->export_address))) {
+        fprintf(stderr, "Error: --compress is only supported for monitor with --output or "
+                "--export\n");
+        return -1;
+    }
+    if (args->rotate_keep > 0 && args->rotate_bytes == 0 && args->rotate_interval_ms == 0) {
+        fprintf(stderr, "Warning: --rotate-keep is ignored without --rotate-size or "
+                "--rotate-interval\n");
+    }
+    /* Every rotated file must stand alone: no array brackets or binary dictionary */
+    if ((args->rotate_bytes > 0 || args->rotate_interval_ms > 0) &&
+        (args->format == FORMAT_JSON_ARRAY || args->format == FORMAT_BINARY) &&
+        args->summary_top == 0) {
+        fprintf(stderr, "Error: rotation requires --format json-stream, json-pretty or summary\n");
+        return -1;
+    }
+    
+    /* ... or its batches to a collector instead */
+    if (args->export_address && args->command != CMD_MONITOR) {
+        fprintf(stderr, "Error: --export is only supported for monitor command\n");
+        return -1;
+    }
+    if (args->export_address && args->output_file) {
+        fprintf(stderr, "Error: --export cannot be used with --output\n");
+        return -1;
+    }
+    if ((args->spool_dir || args->spool_max_bytes > 0) && !args->export_address) {
+        fprintf(stderr, "Error: --spool-dir and --spool-max require --export\n");
+        return -1;
+    }
+    if (args->spool_max_bytes > 0 && !args->spool_dir) {
+        fprintf(stderr, "Warning: --spool-max is ignored without --spool-dir\n");
+    }
+    
+    if (args->profile_all && args->command != CMD_PROFILE) {
+        fprintf(stderr, "Warning: --all is only supported for profile command\n");
+    }
+    if (args->profile_interval != 0 && args->summary_top == 0 &&
+        (args->command != CMD_PROFILE || !args->profile_all)) {
+        fprintf(stderr, "Warning: --interval is only used by profile --all and monitor summaries\n");
+    }
+    if (args->profile_interval == 0) {
+        args->profile_interval = args->summary_top > 0 ? DEFAULT_SUMMARY_INTERVAL :
+                                                         DEFAULT_PROFILE_INTERVAL;
+    }
+    
+    if (args->coalesce_window_ms > 0 &&
+        (args->command == CMD_SNAPSHOT || args->command == CMD_DECODE ||
+         args->command == CMD_REPLAY)) {
+        fprintf(stderr, "Warning: --coalesce is ignored for %s command\n",
+                args->command == CMD_SNAPSHOT ? "snapshot" :
+                args->command == CMD_DECODE ? "decode" : "replay");
+    }
+    
+    for (int i = 0; i < RATE_LIMIT_TYPES; i++) {
+        if ((args->rate_limit[i] > 0 || args->sample_every[i] > 0) &&
+            (args->command == CMD_SNAPSHOT || args->command == CMD_DECODE ||
+             args->command == CMD_REPLAY)) {
+            fprintf(stderr, "Warning: --rate-limit and --sample are ignored for %s command\n",
+                    args->command == CMD_SNAPSHOT ? "snapshot" :
+                    args->command == CMD_DECODE ? "decode" : "replay");
+            break;
+        }
+    }
+    
+    /* Replay has no default input: the capture is mapped, not streamed */
+    if (args->command == CMD_REPLAY && !args->input_file) {
+        fprintf(stderr, "Error: replay command requires a capture file\n");
+        fprintf(stderr, "Use 'crypto-tracer help replay' for more information\n");
+        return -1;
+    }
+    
+    if (args->record_file && args->command != CMD_MONITOR) {
+        fprintf(stderr, "Warning: --record-raw is only supported for monitor command\n");
+    }
+    
+    if ((args->metrics_socket || args->stats_interval > 0) &&
+        args->command != CMD_MONITOR && args->command != CMD_DAEMON) {
+        fprintf(stderr, "Warning: --metrics-socket and --stats-interval are only supported "
+                "for monitor and daemon commands\n");
+    }
+    
+    if ((args->ring_layout != EBPF_RINGS_PER_PROGRAM || args->ordered_output) &&
+        args->command != CMD_MONITOR) {
+        fprintf(stderr, "Warning: --ring-shards and --ordered are only supported for monitor command\n");
+    } else if (args->ring_layout != EBPF_RINGS_PER_PROGRAM) {
+        /* Both need the single polling thread of the per-probe rings */
+        if (args->coalesce_window_ms > 0 || args->record_file) {
+            fprintf(stderr, "Error: --ring-shards cannot be used with --coalesce or --record-raw\n");
+            return -1;
+        }
+    } else if (args->ordered_output) {
+        fprintf(stderr, "Warning: --ordered is ignored without --ring-shards\n");
+    }
+    
+    if (args->use_daemon) {
+        bool kernel_settings = args->ringbuf_size > 0 || args->lazy_wakeup ||
+                               args->coalesce_window_ms > 0;
+        
+        for (int i = 0; i < RATE_LIMIT_TYPES; i++) {
+            if (args->rate_limit[i] > 0 || args->sample_every[i] > 0) {
+                kernel_settings = true;
+            }
+        }
+        
+        if (args->command != CMD_MONITOR && args->command != CMD_PROFILE &&
+            args->command != CMD_LIBS && args->command != CMD_FILES) {
+            fprintf(stderr, "Error: --daemon is only supported for monitor, profile, libs "
+                    "and files\n");
+            return -1;
+        }
+        /* The daemon owns the ring buffers: there are no raw records or shards to read */
+        if (args->record_file || args->ring_layout != EBPF_RINGS_PER_PROGRAM) {
+            fprintf(stderr, "Error: --daemon cannot be used with --record-raw or --ring-shards\n");
+            return -1;
+        }
+        if (kernel_settings) {
+            fprintf(stderr, "Warning: ring buffer, --coalesce, --rate-limit and --sample "
+                    "settings are the daemon's and are ignored with --daemon\n");
+        }
+    }
+    
+    if ((args->daemon_socket || args->pin_dir) && !args->use_daemon &&
+        args->command != CMD_DAEMON) {
+        fprintf(stderr, "Warning: --socket and --pin-dir are only supported for daemon command\n");
+    }
+    
+    /* Clients filter for themselves; the daemon serves every process */
+    if (args->command == CMD_DAEMON &&
+        (args->pid != 0 || args->process_name != NULL || args->library_filter != NULL ||
+         args->file_filter != NULL || args->follow_children ||
+         args->cgroup_filter != NULL || args->container_filter != NULL)) {
+        fprintf(stderr, "Warning: --pid, --name, filters and --follow-children are ignored "
+                "for daemon command\n");
+    }
+    
+    if ((args->cgroup_filter || args->container_filter) &&
+        (args->command == CMD_SNAPSHOT || args->command == CMD_DECODE)) {
+        fprintf(stderr, "Warning: --cgroup and --container are ignored for this command\n");
+    }
+    
     /* Snapshot command doesn't support duration, pid, or filters */
     if (args->command == CMD_SNAPSHOT) {
         if (args->duration != DEFAULT_DURATION) {
@@ -289,6 +772,29 @@ static int validate_args(cli_args_t *args) {
         }
     }
     
+    /* Incremental snapshots need somewhere to keep their state */
+    if ((args->incremental || args->state_file || args->snapshot_diff) &&
+        args->command != CMD_SNAPSHOT) {
+        fprintf(stderr, "Error: --incremental, --state and --diff are only supported for snapshot\n");
+        return -1;
+    }
+    if (args->incremental != (args->state_file != NULL)) {
+        fprintf(stderr, "Error: --incremental and --state FILE must be used together\n");
+        return -1;
+    }
+    if (args->snapshot_diff && !args->incremental) {
+        fprintf(stderr, "Error: --diff requires --incremental\n");
+        return -1;
+    }
+    
+    /* Binary output is an event stream; profile and snapshot write documents */
+    if (args->format == FORMAT_BINARY &&
+        (args->command == CMD_PROFILE || args->command == CMD_SNAPSHOT ||
+         args->command == CMD_DECODE)) {
+        fprintf(stderr, "Error: --format binary is only supported for monitor, libs and files\n");
+        return -1;
+    }
+    
     /* Verbose and quiet are mutually exclusive */
     if (args->verbose && args->quiet) {
         fprintf(stderr, "Error: --verbose and --quiet cannot be used together\n");
@@ -339,6 +845,39 @@ int parse_args(int argc, char **argv, cli_args_t *args) {
         {"file",            required_argument, 0, 'F'},
         {"no-redact",       no_argument,       0, 'R'},
         {"follow-children", no_argument,       0, 'C'},
+        {"ringbuf-size",    required_argument, 0, 'B'},
+        {"lazy-wakeup",     no_argument,       0, 'W'},
+        {"library-index",   no_argument,       0, 'I'},
+        {"crypto-rules",    required_argument, 0, 'K'},
+        {"all",             no_argument,       0, 'A'},
+        {"interval",        required_argument, 0, 'T'},
+        {"coalesce",        required_argument, 0, 'G'},
+        {"rate-limit",      required_argument, 0, 'L'},
+        {"sample",          required_argument, 0, 'S'},
+        {"log-format",      required_argument, 0, 'J'},
+        {"stats-file",      required_argument, 0, 'Z'},
+        {"record-raw",      required_argument, 0, 'X'},
+        {"metrics-socket",  required_argument, 0, 'M'},
+        {"stats-interval",  required_argument, 0, 'N'},
+        {"ring-shards",     required_argument, 0, 'H'},
+        {"ordered",         no_argument,       0, 'O'},
+        {"daemon",          optional_argument, 0, 'D'},
+        {"socket",          required_argument, 0, 'U'},
+        {"pin-dir",         required_argument, 0, 'P'},
+        {"cgroup",          required_argument, 0, 'E'},
+        {"container",       required_argument, 0, 'Y'},
+        {"incremental",     no_argument,       0, 'i'},
+        {"state",           required_argument, 0, 's'},
+        {"diff",            no_argument,       0, 'g'},
+        {"top",             required_argument, 0, 'k'},
+        {"compress",        required_argument, 0, 'z'},
+        {"rotate-size",     required_argument, 0, 'r'},
+        {"rotate-interval", required_argument, 0, 't'},
+        {"rotate-keep",     required_argument, 0, 'u'},
+        {"export",          required_argument, 0, 'x'},
+        {"spool-dir",       required_argument, 0, 'w'},
+        {"spool-max",       required_argument, 0, 'y'},
+        {"drain-timeout",   required_argument, 0, 'e'},
         {0, 0, 0, 0}
     };
     
@@ -412,36 +951,36 @@ int parse_args(int argc, char **argv, cli_args_t *args) {
                 print_command_help(args->command);
                 args->exit_after_parse = true;
                 return EXIT_SUCCESS;
-                
+            
             case 'V':
                 print_version();
                 args->exit_after_parse = true;
                 return EXIT_SUCCESS;
-                
+            
             case 'v':
                 args->verbose = true;
                 break;
-                
+            
             case 'q':
                 args->quiet = true;
                 break;
-                
+            
             case 'o':
                 args->output_file = optarg;
                 break;
-                
+            
             case 'f':
                 {
                     int fmt = parse_format(optarg);
                     if (fmt < 0) {
                         fprintf(stderr, "Error: Invalid format: %s\n", optarg);
-                        fprintf(stderr, "Valid formats: json-stream, json-array, json-pretty, summary\n");
+                        fprintf(stderr, "Valid formats: json-stream, json-array, json-pretty, summary, binary\n");
                         return EXIT_ARGUMENT_ERROR;
                     }
                     args->format = (output_format_t)fmt;
                 }
                 break;
-                
+            
             case 'd':
                 {
                     char *endptr;
@@ -453,7 +992,7 @@ int parse_args(int argc, char **argv, cli_args_t *args) {
                     args->duration = (int)duration;
                 }
                 break;
-                
+            
             case 'p':
                 {
                     char *endptr;
@@ -465,117 +1004,367 @@ int parse_args(int argc, char **argv, cli_args_t *args) {
                     args->pid = (int)pid;
                 }
                 break;
-                
+            
             case 'n':
                 args->process_name = optarg;
                 break;
-                
+            
             case 'l':
                 args->library_filter = optarg;
                 break;
-                
+            
             case 'F':
                 args->file_filter = optarg;
                 break;
-                
+            
             case 'R':
                 args->no_redact = true;
                 break;
-                
+            
             case 'C':
                 args->follow_children = true;
                 break;
-                
-            case '?':
-                /* getopt_long already printed an error message */
-                fprintf(stderr, "Use 'crypto-tracer help %s' for command-specific help\n",
-                        args->command == CMD_MONITOR ? "monitor" :
-                        args->command == CMD_PROFILE ? "profile" :
-                        args->command == CMD_SNAPSHOT ? "snapshot" :
-                        args->command == CMD_LIBS ? "libs" :
-                        args->command == CMD_FILES ? "files" : "");
-                return EXIT_ARGUMENT_ERROR;
-                
-            default:
-                return EXIT_ARGUMENT_ERROR;
-        }
-    }
-    
-    /* Check for extra arguments */
-    if (optind < argc) {
-        fprintf(stderr, "Error: Unexpected argument: %s\n", argv[optind]);
-        return EXIT_ARGUMENT_ERROR;
-    }
-    
-    /* Validate argument combinations */
-    if (validate_args(args) != 0) {
-        return EXIT_ARGUMENT_ERROR;
-    }
-    
-    return EXIT_SUCCESS;
-}
-
-/**
- * Parse kernel version string into major, minor, patch components
- * Returns 0 on success, -1 on failure
- */
-static int parse_kernel_version(const char *version_str, int *major, int *minor, int *patch) {
-    if (!version_str || !major || !minor || !patch) {
-        return -1;
-    }
-    
-    /* Skip any leading non-digit characters */
-    while (*version_str && (*version_str < '0' || *version_str > '9')) {
-        version_str++;
-    }
-    
-    if (sscanf(version_str, "%d.%d.%d", major, minor, patch) < 2) {
-        return -1;
-    }
-    
-    return 0;
-}
-
-/**
- * Check if a specific capability is present
- * Returns 1 if capability is present, 0 if not, -1 on error
- */
-static int has_capability(cap_value_t cap) {
-    cap_t caps;
-    cap_flag_value_t value;
-    int result = 0;
-    
-    caps = cap_get_proc();
-    if (!caps) {
-        return -1;
-    }
-    
-    if (cap_get_flag(caps, cap, CAP_EFFECTIVE, &value) == 0) {
-        result = (value == CAP_SET) ? 1 : 0;
-    } else {
-        result = -1;
-    }
-    
-    cap_free(caps);
-    return result;
-}
-
-/**
- * Validate that the process has sufficient privileges to load eBPF programs
- * Requirements: 7.1, 7.2, 7.3, 7.4, 7.5
- * Returns EXIT_SUCCESS on success, EXIT_PRIVILEGE_ERROR on failure
- */
-int validate_privileges(void) {
-    int has_cap_bpf = 0;
-    int has_cap_sys_admin = 0;
-    int is_root = 0;
-    struct utsname uts;
-    int major = 0, minor = 0, patch = 0;
-    
-    /* Check if running as root (UID 0) */
-    is_root = (geteuid() == 0);
-    
-    /* Get kernel version to determine which capabilities to check */
+            
+            case 'B':
+                args->ringbuf_size = parse_ringbuf_size(optarg);
+                if (args->ringbuf_size == 0) {
+                    fprintf(stderr, "Error: Invalid ring buffer size: %s\n", optarg);
+                    fprintf(stderr, "Size must be a power of two up to 1G, e.g. 256K or 4M\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'W':
+                args->lazy_wakeup = true;
+                break;
+            
+            case 'I':
+                args->library_index = true;
+                break;
+            
+            case 'i':
+                args->incremental = true;
+                break;
+            
+            case 's':
+                args->state_file = optarg;
+                break;
+            
+            case 'g':
+                args->snapshot_diff = true;
+                break;
+            
+            case 'K':
+                args->rules_file = optarg;
+                break;
+            
+            case 'Z':
+                args->stats_file = optarg;
+                break;
+            
+            case 'X':
+                args->record_file = optarg;
+                break;
+            
+            case 'M':
+                args->metrics_socket = optarg;
+                break;
+            
+            case 'H':
+                if (strcmp(optarg, "cpu") == 0) {
+                    args->ring_layout = EBPF_RINGS_PER_CPU;
+                } else if (strcmp(optarg, "node") == 0) {
+                    args->ring_layout = EBPF_RINGS_PER_NODE;
+                } else {
+                    fprintf(stderr, "Error: Invalid ring shards: %s (expected cpu or node)\n", optarg);
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'O':
+                args->ordered_output = true;
+                break;
+            
+            case 'D':
+                args->use_daemon = true;
+                if (optarg) {
+                    args->daemon_socket = optarg;
+                }
+                break;
+            
+            case 'U':
+                args->daemon_socket = optarg;
+                break;
+            
+            case 'P':
+                args->pin_dir = optarg;
+                break;
+            
+            case 'E':
+                args->cgroup_filter = optarg;
+                break;
+            
+            case 'Y':
+                args->container_filter = optarg;
+                break;
+            
+            case 'N':
+                {
+                    char *endptr;
+                    long interval = strtol(optarg, &endptr, 10);
+                    if (*endptr != '\0' || interval <= 0 || interval > INT_MAX) {
+                        fprintf(stderr, "Error: Invalid stats interval: %s\n", optarg);
+                        return EXIT_ARGUMENT_ERROR;
+                    }
+                    args->stats_interval = (int)interval;
+                }
+                break;
+            
+            case 'k':
+                {
+                    char *endptr;
+                    long top = strtol(optarg, &endptr, 10);
+                    if (*endptr != '\0' || top <= 0 || top > TOPK_MAX_K) {
+                        fprintf(stderr, "Error: Invalid --top: %s (1-%d)\n", optarg, TOPK_MAX_K);
+                        return EXIT_ARGUMENT_ERROR;
+                    }
+                    args->summary_top = (int)top;
+                }
+                break;
+            
+            case 'z':
+                if (strcmp(optarg, "none") == 0) {
+                    args->gzip_level = 0;
+                } else if (strcmp(optarg, "gzip") == 0) {
+                    args->gzip_level = DEFAULT_GZIP_LEVEL;
+                } else if (strncmp(optarg, "gzip:", 5) == 0 && optarg[5] >= '1' &&
+                           optarg[5] <= '9' && optarg[6] == '\0') {
+                    args->gzip_level = optarg[5] - '0';
+                } else {
+                    fprintf(stderr, "Error: Invalid compression: %s\n", optarg);
+                    fprintf(stderr, "Use gzip, gzip:LEVEL (1-9) or none\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'r':
+                args->rotate_bytes = parse_byte_size(optarg, 1ULL << 40);
+                if (args->rotate_bytes == 0) {
+                    fprintf(stderr, "Error: Invalid rotation size: %s\n", optarg);
+                    fprintf(stderr, "Size must be positive, e.g. 512M or 2G\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 't':
+                args->rotate_interval_ms = parse_window_ms(optarg);
+                if (args->rotate_interval_ms == 0) {
+                    fprintf(stderr, "Error: Invalid rotation interval: %s\n", optarg);
+                    fprintf(stderr, "Interval must be positive and at most a day, e.g. 30m or 3600\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'u':
+                {
+                    char *endptr;
+                    long keep = strtol(optarg, &endptr, 10);
+                    if (*endptr != '\0' || keep <= 0 || keep > INT_MAX) {
+                        fprintf(stderr, "Error: Invalid --rotate-keep: %s\n", optarg);
+                        return EXIT_ARGUMENT_ERROR;
+                    }
+                    args->rotate_keep = (int)keep;
+                }
+                break;
+            
+            case 'x':
+                {
+                    char host[256], port[8];
+                    if (exporter_parse_address(optarg, host, sizeof(host), port,
+                                               sizeof(port)) != 0) {
+                        fprintf(stderr, "Error: Invalid collector address: %s\n", optarg);
+                        fprintf(stderr, "Use HOST:PORT or [IPV6]:PORT\n");
+                        return EXIT_ARGUMENT_ERROR;
+                    }
+                    args->export_address = optarg;
+                }
+                break;
+            
+            case 'w':
+                args->spool_dir = optarg;
+                break;
+            
+            case 'y':
+                args->spool_max_bytes = parse_byte_size(optarg, 1ULL << 40);
+                if (args->spool_max_bytes == 0) {
+                    fprintf(stderr, "Error: Invalid spool size: %s\n", optarg);
+                    fprintf(stderr, "Size must be positive, e.g. 512M or 2G\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'A':
+                args->profile_all = true;
+                break;
+            
+            case 'T':
+                {
+                    char *endptr;
+                    long interval = strtol(optarg, &endptr, 10);
+                    if (*endptr != '\0' || interval <= 0 || interval > INT_MAX) {
+                        fprintf(stderr, "Error: Invalid interval: %s\n", optarg);
+                        return EXIT_ARGUMENT_ERROR;
+                    }
+                    args->profile_interval = (int)interval;
+                }
+                break;
+            
+            case 'G':
+                args->coalesce_window_ms = parse_window_ms(optarg);
+                if (args->coalesce_window_ms == 0) {
+                    fprintf(stderr, "Error: Invalid coalescing window: %s\n", optarg);
+                    fprintf(stderr, "Window must be positive and at most a day, e.g. 500ms, 5s or 2m\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'e':
+                args->drain_timeout_ms = parse_window_ms(optarg);
+                if (args->drain_timeout_ms == 0) {
+                    fprintf(stderr, "Error: Invalid drain timeout: %s\n", optarg);
+                    fprintf(stderr, "Timeout must be positive and at most a day, e.g. 500ms or 5s\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'L':
+                if (parse_type_limit(optarg, "/s", MAX_RATE_LIMIT, args->rate_limit) != 0) {
+                    fprintf(stderr, "Error: Invalid rate limit: %s\n", optarg);
+                    fprintf(stderr, "Use [TYPE=]N with N events per second (1-%u), e.g. file_open=1000\n",
+                            MAX_RATE_LIMIT);
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'S':
+                if (parse_type_limit(optarg, NULL, MAX_SAMPLE_EVERY, args->sample_every) != 0) {
+                    fprintf(stderr, "Error: Invalid sampling rate: %s\n", optarg);
+                    fprintf(stderr, "Use [TYPE=]N to keep 1 event in N (1-%u), e.g. api_call=10\n",
+                            MAX_SAMPLE_EVERY);
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case 'J':
+                if (strcmp(optarg, "json") == 0) {
+                    args->log_json = true;
+                } else if (strcmp(optarg, "text") == 0) {
+                    args->log_json = false;
+                } else {
+                    fprintf(stderr, "Error: Invalid log format: %s\n", optarg);
+                    fprintf(stderr, "Valid log formats: text, json\n");
+                    return EXIT_ARGUMENT_ERROR;
+                }
+                break;
+            
+            case '?':
+                /* getopt_long already printed an error message */
+                fprintf(stderr, "Use 'crypto-tracer help %s' for command-specific help\n",
+                        args->command == CMD_MONITOR ? "monitor" :
+                        args->command == CMD_PROFILE ? "profile" :
+                        args->command == CMD_SNAPSHOT ? "snapshot" :
+                        args->command == CMD_LIBS ? "libs" :
+                        args->command == CMD_FILES ? "files" :
+                        args->command == CMD_DECODE ? "decode" :
+                        args->command == CMD_REPLAY ? "replay" :
+                        args->command == CMD_DAEMON ? "daemon" : "");
+                return EXIT_ARGUMENT_ERROR;
+            
+            default:
+                return EXIT_ARGUMENT_ERROR;
+        }
+    }
+    
+    /* decode and replay take the capture to read as their only argument */
+    if ((args->command == CMD_DECODE || args->command == CMD_REPLAY) && optind < argc) {
+        args->input_file = argv[optind++];
+    }
+    
+    /* Check for extra arguments */
+    if (optind < argc) {
+        fprintf(stderr, "Error: Unexpected argument: %s\n", argv[optind]);
+        return EXIT_ARGUMENT_ERROR;
+    }
+    
+    /* Validate argument combinations */
+    if (validate_args(args) != 0) {
+        return EXIT_ARGUMENT_ERROR;
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Parse kernel version string into major, minor, patch components
+ * Returns 0 on success, -1 on failure
+ */
+static int parse_kernel_version(const char *version_str, int *major, int *minor, int *patch) {
+    if (!version_str || !major || !minor || !patch) {
+        return -1;
+    }
+    
+    /* Skip any leading non-digit characters */
+    while (*version_str && (*version_str < '0' || *version_str > '9')) {
+        version_str++;
+    }
+    
+    if (sscanf(version_str, "%d.%d.%d", major, minor, patch) < 2) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+/**
+ * Check if a specific capability is present
+ * Returns 1 if capability is present, 0 if not, -1 on error
+ */
+static int has_capability(cap_value_t cap) {
+    cap_t caps;
+    cap_flag_value_t value;
+    int result = 0;
+    
+    caps = cap_get_proc();
+    if (!caps) {
+        return -1;
+    }
+    
+    if (cap_get_flag(caps, cap, CAP_EFFECTIVE, &value) == 0) {
+        result = (value == CAP_SET) ? 1 : 0;
+    } else {
+        result = -1;
+    }
+    
+    cap_free(caps);
+    return result;
+}
+
+/**
+ * Validate that the process has sufficient privileges to load eBPF programs
+ * Requirements: 7.1, 7.2, 7.3, 7.4, 7.5
+ * Returns EXIT_SUCCESS on success, EXIT_PRIVILEGE_ERROR on failure
+ */
+int validate_privileges(void) {
+    int has_cap_bpf = 0;
+    int has_cap_sys_admin = 0;
+    int is_root = 0;
+    struct utsname uts;
+    int major = 0, minor = 0, patch = 0;
+    
+    /* Check if running as root (UID 0) */
+    is_root = (geteuid() == 0);
+    
+    /* Get kernel version to determine which capabilities to check */
     if (uname(&uts) == 0) {
         if (parse_kernel_version(uts.release, &major, &minor, &patch) == 0) {
             /* CAP_BPF is available on kernel 5.8+ */
@@ -586,171 +1375,1246 @@ int validate_privileges(void) {
         }
     }
     
-    /* Check CAP_SYS_ADMIN (required on older kernels, alternative on newer) */
-    has_cap_sys_admin = has_capability(CAP_SYS_ADMIN);
-    
-    /* Requirement 7.5: Accept root as sufficient privilege */
-    if (is_root) {
-        return EXIT_SUCCESS;
+    /* Check CAP_SYS_ADMIN (required on older kernels, alternative on newer) */
+    has_cap_sys_admin = has_capability(CAP_SYS_ADMIN);
+    
+    /* Requirement 7.5: Accept root as sufficient privilege */
+    if (is_root) {
+        return EXIT_SUCCESS;
+    }
+    
+    /* Requirement 7.4: Detect CAP_BPF on kernel 5.8+ and fall back to CAP_SYS_ADMIN */
+    if (has_cap_bpf > 0 || has_cap_sys_admin > 0) {
+        return EXIT_SUCCESS;
+    }
+    
+    /* Requirement 7.2, 7.3: Exit with code 3 and display helpful error message */
+    char suggestion[512];
+    
+    if (major > CAP_BPF_KERNEL_MAJOR || 
+        (major == CAP_BPF_KERNEL_MAJOR && minor >= CAP_BPF_KERNEL_MINOR)) {
+        snprintf(suggestion, sizeof(suggestion),
+                 "Run as root (sudo crypto-tracer), or grant CAP_BPF capability: "
+                 "sudo setcap cap_bpf+ep /path/to/crypto-tracer");
+    } else {
+        snprintf(suggestion, sizeof(suggestion),
+                 "Run as root (sudo crypto-tracer), or grant CAP_SYS_ADMIN capability: "
+                 "sudo setcap cap_sys_admin+ep /path/to/crypto-tracer "
+                 "(CAP_BPF not available on kernel %d.%d)", major, minor);
+    }
+    
+    log_error_with_suggestion("Insufficient privileges to run crypto-tracer", suggestion);
+    
+    return EXIT_PRIVILEGE_ERROR;
+}
+
+/**
+ * Check kernel version and compatibility
+ * Requirements: 9.1, 9.2, 9.3, 9.4, 9.5
+ * Returns EXIT_SUCCESS on success, EXIT_KERNEL_ERROR on failure
+ */
+int check_kernel_version(void) {
+    struct utsname uts;
+    int major = 0, minor = 0, patch = 0;
+    
+    /* Get kernel version information */
+    if (uname(&uts) != 0) {
+        log_system_error("Failed to get kernel version");
+        return EXIT_KERNEL_ERROR;
+    }
+    
+    /* Parse kernel version */
+    if (parse_kernel_version(uts.release, &major, &minor, &patch) != 0) {
+        log_error("Failed to parse kernel version: %s", uts.release);
+        return EXIT_KERNEL_ERROR;
+    }
+    
+    log_debug("Detected kernel version: %d.%d.%d (%s)", major, minor, patch, uts.release);
+    
+    /* Requirement 9.1: Check for minimum kernel version 4.15+ */
+    if (major < MIN_KERNEL_MAJOR || 
+        (major == MIN_KERNEL_MAJOR && minor < MIN_KERNEL_MINOR)) {
+        char error_msg[256];
+        char suggestion[256];
+        
+        snprintf(error_msg, sizeof(error_msg),
+                 "Kernel version %d.%d.%d is not supported (requires 4.15+)",
+                 major, minor, patch);
+        snprintf(suggestion, sizeof(suggestion),
+                 "Please upgrade your kernel to Linux 4.15 or later");
+        
+        log_error_with_suggestion(error_msg, suggestion);
+        return EXIT_KERNEL_ERROR;
+    }
+    
+    /* Requirement 9.2: Detect CAP_BPF support on kernel 5.8+ */
+    if (major > CAP_BPF_KERNEL_MAJOR || 
+        (major == CAP_BPF_KERNEL_MAJOR && minor >= CAP_BPF_KERNEL_MINOR)) {
+        /* CAP_BPF is available - enhanced security mode */
+        log_debug("Kernel %d.%d.%d supports CAP_BPF (enhanced security)", major, minor, patch);
+    } else {
+        /* Older kernel - will use CAP_SYS_ADMIN */
+        log_debug("Kernel %d.%d.%d requires CAP_SYS_ADMIN (CAP_BPF not available)", 
+                  major, minor, patch);
+    }
+    
+    /* Check for eBPF support by looking for /sys/kernel/btf/vmlinux or /proc/config.gz */
+    if (access("/sys/kernel/btf/vmlinux", F_OK) == 0) {
+        log_debug("BTF support detected (CO-RE enabled)");
+    } else {
+        log_debug("BTF not available, using fallback headers");
+    }
+    
+    /* Requirement 9.4: Graceful feature detection - always succeed if kernel >= 4.15 */
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Stop the probes, then process the events they already submitted
+ * Polls until every ring buffer is empty, or for at most --drain-timeout;
+ * sharded rings are drained by their consumer threads instead.
+ */
+static void drain_remaining_events(struct ebpf_manager *mgr, const cli_args_t *args,
+                                   event_callback_t callback, void *ctx) {
+    int ret;
+    
+    ebpf_manager_stop_events(mgr);
+    if (ebpf_manager_consumer_count(mgr) > 0) {
+        return;
+    }
+    
+    ret = ebpf_manager_drain(mgr, callback, ctx, args->drain_timeout_ms);
+    if (ret >= 0) {
+        log_debug("Drained %d remaining events", ret);
+    }
+}
+
+/**
+ * Log how long the final drain and the program teardown took
+ * Call between ebpf_manager_cleanup() and ebpf_manager_destroy()
+ */
+static void log_shutdown_stats(struct ebpf_manager *mgr) {
+    ebpf_shutdown_stats_t stats;
+    
+    if (ebpf_manager_get_shutdown_stats(mgr, &stats) != 0 || stats.teardown_ns == 0) {
+        return;
+    }
+    
+    log_info("Shutdown: drained %lu events in %.1f ms, detached programs in %.1f ms",
+             stats.drain_events, stats.drain_ns / 1e6, stats.teardown_ns / 1e6);
+}
+
+/**
+ * Log per-source ring buffer and consumer statistics (verbose mode)
+ */
+static void log_source_stats(struct ebpf_manager *mgr) {
+    ebpf_source_stats_t stats;
+    ebpf_consumer_stats_t consumer;
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        if (ebpf_manager_get_source_stats(mgr, (ebpf_source_t)source, &stats) != 0 ||
+            !stats.attached) {
+            continue;
+        }
+        log_debug("  %s: %lu events received, %lu filtered in kernel, %lu lost to a full ring buffer",
+                  ebpf_source_name((ebpf_source_t)source), stats.events_received,
+                  stats.kernel_filtered, stats.ringbuf_full);
+        if (stats.coalesced > 0) {
+            log_debug("  %s: %lu repeats coalesced in kernel",
+                      ebpf_source_name((ebpf_source_t)source), stats.coalesced);
+        }
+        if (stats.sampled_out > 0 || stats.rate_limited > 0) {
+            log_debug("  %s: %lu sampled out, %lu over the rate limit (counted in kept events)",
+                      ebpf_source_name((ebpf_source_t)source), stats.sampled_out,
+                      stats.rate_limited);
+        }
+    }
+    
+    if (ebpf_manager_get_consumer_stats(mgr, &consumer) == 0 && consumer.events > 0) {
+        log_debug("  consumer: %lu batches (%lu at budget), latency p50 <= %lu us, "
+                  "p99 <= %lu us, max %lu us, %lu ns CPU per event",
+                  consumer.batches, consumer.busy_polls, consumer.latency_p50_ns / 1000,
+                  consumer.latency_p99_ns / 1000, consumer.latency_max_ns / 1000,
+                  consumer.cpu_ns_per_event);
+        log_debug("  event pool: %lu in flight at most, %lu of %lu events allocated",
+                  consumer.pool_high_water, consumer.pool_allocated, consumer.pool_capacity);
+    }
+}
+
+/**
+ * Log /proc enrichment cache statistics (verbose mode)
+ */
+static void log_cache_stats(event_processor_t *processor) {
+    proc_cache_stats_t stats = {0};
+    
+    if (!processor || !processor->cache) {
+        return;
+    }
+    
+    proc_cache_get_stats(processor->cache, &stats);
+    log_debug("  enrichment cache: %lu hits, %lu misses, %lu evictions, %lu invalidations",
+              stats.hits, stats.misses, stats.evictions, stats.invalidations);
+}
+
+/**
+ * Flush formatted events once per drained batch
+ */
+static void flush_output_batch(uint32_t events, void *ctx) {
+    (void)events;
+    output_formatter_flush((output_formatter_t *)ctx);
+}
+
+/**
+ * Write events unflushed and flush after each ring buffer drain, so a
+ * burst costs one write syscall instead of one per event
+ */
+static void configure_batched_output(struct ebpf_manager *mgr, output_formatter_t *formatter) {
+    ebpf_poll_config_t config = {
+        .on_batch = flush_output_batch,
+        .batch_ctx = formatter,
+    };
+    
+    output_formatter_set_batching(formatter, true);
+    ebpf_manager_set_poll_config(mgr, &config);
+}
+
+/**
+ * Apply --ringbuf-size and --lazy-wakeup; must run before load
+ */
+static int configure_ringbuf(struct ebpf_manager *mgr, const cli_args_t *args) {
+    ebpf_ringbuf_config_t config = {
+        .size = args->ringbuf_size,
+        .lazy_wakeup = args->lazy_wakeup,
+    };
+    
+    return ebpf_manager_set_ringbuf_config(mgr, &config);
+}
+
+/**
+ * Load and attach only the programs whose events the command can use
+ * libs and files drop other event types before enrichment, so they need
+ * one program each. monitor keeps process_exec/exit under a library or
+ * file filter: they keep the enrichment cache current.
+ */
+static void configure_sources(struct ebpf_manager *mgr, const cli_args_t *args) {
+    const uint32_t lifecycle = EBPF_SOURCE_BIT(EBPF_SOURCE_PROCESS_EXEC) |
+                               EBPF_SOURCE_BIT(EBPF_SOURCE_PROCESS_EXIT);
+    uint32_t sources = EBPF_SOURCES_ALL;
+    
+    switch (args->command) {
+        case CMD_LIBS:
+            sources = EBPF_SOURCE_BIT(EBPF_SOURCE_LIB_LOAD);
+            break;
+        case CMD_FILES:
+            sources = EBPF_SOURCE_BIT(EBPF_SOURCE_FILE_OPEN);
+            break;
+        case CMD_PROFILE:
+            /* System-wide profiles ignore exec events and children */
+            if (args->profile_all) {
+                sources &= ~EBPF_SOURCE_BIT(EBPF_SOURCE_PROCESS_EXEC);
+            }
+            break;
+        case CMD_MONITOR:
+            /* Every filter must match: --library only passes events with a
+             * library, --file only file_open */
+            if (args->library_filter && !args->file_filter) {
+                sources = EBPF_SOURCE_BIT(EBPF_SOURCE_LIB_LOAD) |
+                          EBPF_SOURCE_BIT(EBPF_SOURCE_OPENSSL_API) | lifecycle;
+            } else if (args->file_filter && !args->library_filter) {
+                sources = EBPF_SOURCE_BIT(EBPF_SOURCE_FILE_OPEN) | lifecycle;
+            }
+            break;
+        default:
+            break;
+    }
+    
+    ebpf_manager_set_sources(mgr, sources);
+}
+
+/**
+ * Apply --coalesce; must run before load
+ */
+static void configure_coalescing(struct ebpf_manager *mgr, const cli_args_t *args) {
+    if (args->coalesce_window_ms == 0) {
+        return;
+    }
+    
+    if (ebpf_manager_set_coalesce_window(mgr, args->coalesce_window_ms) == 0) {
+        log_debug("Coalescing repeated opens and loads over %u ms", args->coalesce_window_ms);
+    } else {
+        log_warn("Coalescing unavailable, every event is reported");
+    }
+}
+
+/**
+ * Apply --daemon: read events from the daemon instead of loading programs
+ * Must run before load. The sources and process filter set on the
+ * manager become the client's request.
+ */
+static int configure_daemon_client(struct ebpf_manager *mgr, const cli_args_t *args) {
+    if (!args->use_daemon) {
+        return 0;
+    }
+    
+    return ebpf_manager_use_daemon(mgr, args->daemon_socket ? args->daemon_socket :
+                                        DAEMON_DEFAULT_SOCKET);
+}
+
+/**
+ * Apply --rate-limit and --sample; must run between load and attach
+ */
+static void configure_rate_limits(struct ebpf_manager *mgr, const cli_args_t *args) {
+    for (int i = 0; i < RATE_LIMIT_TYPES; i++) {
+        ebpf_rate_limit_t limit = {
+            .rate = args->rate_limit[i],
+            .sample_every = args->sample_every[i],
+        };
+        
+        if (limit.rate == 0 && limit.sample_every <= 1) {
+            continue;
+        }
+        if (ebpf_manager_set_rate_limit(mgr, (ebpf_source_t)i, &limit) != 0) {
+            log_warn("Rate limit for %s events unavailable", rate_limit_type_names[i]);
+        }
+    }
+}
+
+/**
+ * Push the process filters into the kernel so non-matching processes are
+ * dropped before they reach the ring buffers. Must run between load and
+ * attach. The user-space filters still apply, so failure only costs speed.
+ * The cgroups the processor's --cgroup/--container selector matches now
+ * are pushed as subtrees, so containers started later under them match.
+ */
+static void configure_kernel_filter(struct ebpf_manager *mgr, event_processor_t *processor,
+                                    pid_t pid, const char *process_name, bool follow_children) {
+    uint64_t cgroup_ids[EBPF_MAX_FILTER_CGROUPS];
+    ebpf_process_filter_t filter = {
+        .pid = pid > 0 ? (uint32_t)pid : 0,
+        .comm = process_name,
+        .follow_children = follow_children,
+    };
+    
+    if (processor && processor->cgroup_filter) {
+        filter.cgroup_count = cgroup_cache_select(processor->cgroups, processor->cgroup_filter,
+                                                  cgroup_ids, EBPF_MAX_FILTER_CGROUPS);
+        filter.cgroup_ids = cgroup_ids;
+        if (filter.cgroup_count == 0) {
+            log_warn("No running cgroup matches --cgroup/--container yet, filtering in user space");
+        }
+    }
+    
+    if (filter.pid == 0 && filter.comm == NULL && filter.cgroup_count == 0) {
+        return;
+    }
+    
+    if (ebpf_manager_set_process_filter(mgr, &filter) == 0) {
+        log_debug("Process filter enabled in kernel");
+    }
+    if (processor) {
+        processor->cgroups_in_kernel = ebpf_manager_filters_cgroups(mgr);
+    }
+}
+
+/**
+ * Event callback context for main event loop
+ */
+typedef struct {
+    event_processor_t *processor;
+    output_formatter_t *formatter;
+    topk_summary_t *summary;       /* Count events here instead of writing them */
+    uint64_t events_processed;
+    uint64_t events_filtered;
+} event_loop_ctx_t;
+
+/**
+ * Event callback context of the daemon command
+ */
+typedef struct {
+    event_loop_ctx_t loop_ctx;
+    daemon_server_t *server;
+} daemon_loop_ctx_t;
+
+/**
+ * Write monitor run statistics as one JSON object (--stats-file)
+ * Drops are split into records the kernel could not submit to a full
+ * ring buffer and events lost in user space; the consumer latency is
+ * kernel timestamp to callback, and "stages" holds the time spent per
+ * pipeline stage. Used by the benchmark driver.
+ */
+static void write_stats_file(const char *path, struct ebpf_manager *mgr,
+                             const event_loop_ctx_t *ctx, uint64_t elapsed_ns,
+                             output_sink_t *sink, exporter_t *exporter) {
+    ebpf_source_stats_t stats;
+    output_sink_stats_t output;
+    exporter_stats_t export;
+    ebpf_consumer_stats_t consumer = {0};
+    ebpf_shutdown_stats_t shutdown = {0};
+    uint64_t processed = 0, dropped = 0, kernel_dropped = 0, kernel_filtered = 0;
+    bool first = true;
+    FILE *fp;
+    
+    fp = fopen(path, "w");
+    if (!fp) {
+        log_error("Failed to open stats file: %s", path);
+        log_system_error("fopen");
+        return;
+    }
+    
+    ebpf_manager_get_stats(mgr, &processed, &dropped);
+    ebpf_manager_get_consumer_stats(mgr, &consumer);
+    ebpf_manager_get_shutdown_stats(mgr, &shutdown);
+    
+    fprintf(fp, "{\"elapsed_ns\":%lu,\"sources\":{", elapsed_ns);
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        if (ebpf_manager_get_source_stats(mgr, (ebpf_source_t)source, &stats) != 0 ||
+            !stats.attached) {
+            continue;
+        }
+        kernel_dropped += stats.ringbuf_full;
+        kernel_filtered += stats.kernel_filtered;
+        fprintf(fp, "%s\"%s\":{\"events_received\":%lu,\"kernel_filtered\":%lu,"
+                "\"ringbuf_full\":%lu,\"coalesced\":%lu,\"sampled_out\":%lu,"
+                "\"rate_limited\":%lu}",
+                first ? "" : ",", ebpf_source_name((ebpf_source_t)source),
+                stats.events_received, stats.kernel_filtered, stats.ringbuf_full,
+                stats.coalesced, stats.sampled_out, stats.rate_limited);
+        first = false;
+    }
+            
+    fprintf(fp, "},\"events_processed\":%lu,\"events_written\":%lu,\"events_filtered\":%lu,"
+            "\"kernel_filtered\":%lu,\"kernel_dropped\":%lu,\"user_dropped\":%lu,"
+            "\"latency_p50_ns\":%lu,\"latency_p99_ns\":%lu,\"latency_max_ns\":%lu,"
+            "\"cpu_ns_per_event\":%lu,\"pool_high_water\":%lu,",
+            processed, ctx->events_processed, ctx->events_filtered, kernel_filtered,
+            kernel_dropped, dropped > kernel_dropped ? dropped - kernel_dropped : 0,
+            consumer.latency_p50_ns, consumer.latency_p99_ns, consumer.latency_max_ns,
+            consumer.cpu_ns_per_event, consumer.pool_high_water);
+    fprintf(fp, "\"drain\":{\"events\":%lu,\"ns\":%lu,\"left_bytes\":%lu},",
+            shutdown.drain_events, shutdown.drain_ns, shutdown.drain_left_bytes);
+    if (sink) {
+        output_sink_get_stats(sink, &output);
+        fprintf(fp, "\"output\":{\"bytes_in\":%lu,\"bytes_out\":%lu,\"blocks_queued\":%lu,"
+                "\"stalls\":%lu,\"stall_ns\":%lu,\"write_errors\":%lu},",
+                output.bytes_in, output.bytes_out, output.blocks_queued, output.stalls,
+                output.stall_ns, output.write_errors);
+    }
+    if (exporter) {
+        exporter_get_stats(exporter, &export);
+        fprintf(fp, "\"export\":{\"connected\":%s,\"batches_sent\":%lu,\"bytes_sent\":%lu,"
+                "\"batches_spooled\":%lu,\"batches_replayed\":%lu,\"batches_dropped\":%lu,"
+                "\"spool_batches\":%lu,\"spool_bytes\":%lu,\"connects\":%lu,"
+                "\"send_errors\":%lu},",
+                export.connected ? "true" : "false", export.batches_sent, export.bytes_sent,
+                export.batches_spooled, export.batches_replayed, export.batches_dropped,
+                export.spool_batches, export.spool_bytes, export.connects, export.send_errors);
+    }
+    metrics_write_stages_json(fp);
+    fputs("}\n", fp);
+    
+    if (fclose(fp) != 0) {
+        log_error("Failed to write stats file: %s", path);
+    }
+}
+
+/**
+ * Log what an export sent, and what it spooled or lost on the way
+ */
+static void log_export_stats(exporter_t *exporter, const char *address) {
+    exporter_stats_t stats;
+    
+    exporter_get_stats(exporter, &stats);
+    log_info("Exported %lu batches (%lu bytes) to %s", stats.batches_sent, stats.bytes_sent,
+             address);
+    if (stats.send_errors > 0 || stats.batches_spooled > 0) {
+        log_info("Collector connection lost %lu times; %lu batches spooled, %lu sent from "
+                 "the spool", stats.send_errors, stats.batches_spooled, stats.batches_replayed);
+    }
+    if (stats.batches_dropped > 0) {
+        log_warn("Dropped %lu event batches the collector could not take", stats.batches_dropped);
+    }
+}
+
+/**
+ * Fill a lib_load event's library name in the event's own string storage
+ */
+static void set_library_name(processed_event_t *event) {
+    size_t len;
+    const char *name = library_name_span(event->library, &len);
+    
+    if (name) {
+        processed_event_store_string(event, EVENT_OWNS_LIBRARY_NAME, name, len);
+    }
+}
+
+/**
+ * Filter, classify and enrich an event ahead of output
+ * 
+ * @return true if the event is to be written
+ */
+static bool prepare_event(processed_event_t *event, event_loop_ctx_t *loop_ctx) {
+    filter_verdict_t verdict;
+    uint64_t begin;
+    bool matches;
+    
+    loop_ctx->events_processed++;
+    
+    /* Cheap filters on the decoded record run first, so rejected events
+     * never cost a /proc read */
+    begin = stage_begin();
+    verdict = event_processor_prefilter(loop_ctx->processor, event);
+    stage_end(STAGE_FILTER, begin);
+    if (verdict == FILTER_REJECT) {
+        loop_ctx->events_filtered++;
+        return false;  /* Event filtered out */
+    }
+    
+    /* Classify file type if this is a file_open event */
+    if (event->file && processed_event_kind(event) == EVENT_FILE_OPEN) {
+        begin = stage_begin();
+        event->file_type = classify_crypto_file(event->file);
+        stage_end(STAGE_CLASSIFY, begin);
+        
+        /* Filter: Only keep crypto files (filtering moved from eBPF to user-space) */
+        if (event->file_type == FILE_TYPE_UNKNOWN) {
+            loop_ctx->events_filtered++;
+            return false;  /* Not a crypto file, filter it out */
+        }
+    }
+    
+    /* Extract library name if this is a lib_load event */
+    if (event->library && processed_event_kind(event) == EVENT_LIB_LOAD) {
+        begin = stage_begin();
+        set_library_name(event);
+        matches = event->library_name &&
+                  crypto_classifier_is_library(crypto_classifier_default(), event->library);
+        stage_end(STAGE_CLASSIFY, begin);
+        
+        /* Filter: Only keep crypto libraries (filtering moved from eBPF to user-space) */
+        if (!matches) {
+            loop_ctx->events_filtered++;
+            return false;  /* Not a crypto library, filter it out */
+        }
+    }
+    
+    /* Enrich event with process metadata from /proc */
+    begin = stage_begin();
+    event_processor_enrich(loop_ctx->processor, event);
+    stage_end(STAGE_ENRICH, begin);
+    
+    /* A process name filter needs the name enrichment supplied */
+    if (verdict == FILTER_UNDECIDED) {
+        begin = stage_begin();
+        matches = event_processor_matches_filters(loop_ctx->processor, event);
+        stage_end(STAGE_FILTER, begin);
+        if (!matches) {
+            loop_ctx->events_filtered++;
+            return false;  /* Event filtered out */
+        }
+    }
+    
+    apply_privacy_filter(event, loop_ctx->processor->redact_paths);
+    return true;
+}
+
+/**
+ * Event callback for main event loop
+ * Processes, filters, enriches, and outputs events
+ * Requirements: 14.1, 14.2, 14.3, 14.4, 14.5, 14.6
+ */
+static int event_callback(processed_event_t *event, void *ctx) {
+    event_loop_ctx_t *loop_ctx = (event_loop_ctx_t *)ctx;
+    uint64_t begin;
+    int ret;
+    
+    if (!event || !loop_ctx) {
+        return -1;
+    }
+    
+    if (!prepare_event(event, loop_ctx)) {
+        return 0;
+    }
+    
+    if (loop_ctx->summary) {
+        topk_summary_add_event(loop_ctx->summary, event);
+        return 0;
+    }
+    
+    /* Write the (redaction-marked) event to output */
+    begin = stage_begin();
+    ret = output_formatter_write_event(loop_ctx->formatter, event);
+    stage_end(STAGE_FORMAT, begin);
+    if (ret != 0) {
+        log_warn_ratelimited("Failed to write event to output");
+        return -1;
+    }
+    
+    return 0;
+}
+
+/* How long the output thread sleeps when no events arrive */
+#define OUTPUT_WORKER_IDLE_MS 100
+
+/**
+ * Output thread for the monitor command
+ * The main thread only drains the ring buffers and queues decoded
+ * events; enrichment, filtering and formatting run here, so slow output
+ * does not stall capture and let the kernel-side buffers overflow.
+ */
+typedef struct {
+    struct ebpf_manager *mgr;
+    spsc_queue_t *queue;
+    event_loop_ctx_t *loop_ctx;
+    pthread_t thread;
+    atomic_bool stop;
+    bool running;
+} output_worker_t;
+
+static void *output_worker_main(void *arg) {
+    output_worker_t *worker = (output_worker_t *)arg;
+    processed_event_t *event;
+    sigset_t mask;
+    bool stopping;
+    
+    /* Leave SIGINT/SIGTERM to the capture thread */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    for (;;) {
+        /* Everything queued before stop was set is drained below */
+        stopping = atomic_load(&worker->stop);
+        
+        while ((event = spsc_queue_pop(worker->queue)) != NULL) {
+            event_callback(event, worker->loop_ctx);
+            ebpf_manager_complete_event(worker->mgr, event);
+        }
+        
+        /* Caught up: write out what the burst produced in one go */
+        output_formatter_flush(worker->loop_ctx->formatter);
+        
+        if (stopping) {
+            break;
+        }
+        spsc_queue_wait(worker->queue, OUTPUT_WORKER_IDLE_MS);
+    }
+    
+    return NULL;
+}
+
+/**
+ * Start the output thread and route captured events to it
+ * 
+ * @return 0 on success, -1 if events must be dispatched in place
+ */
+static int start_output_worker(output_worker_t *worker, struct ebpf_manager *mgr,
+                               event_loop_ctx_t *loop_ctx) {
+    worker->mgr = mgr;
+    worker->loop_ctx = loop_ctx;
+    atomic_init(&worker->stop, false);
+    
+    /* Queue holds every pool event, so only pool exhaustion drops */
+    worker->queue = spsc_queue_create(EBPF_EVENT_POOL_CAPACITY);
+    if (!worker->queue) {
+        return -1;
+    }
+    
+    if (pthread_create(&worker->thread, NULL, output_worker_main, worker) != 0) {
+        log_system_error("pthread_create");
+        spsc_queue_destroy(worker->queue);
+        worker->queue = NULL;
+        return -1;
+    }
+    
+    worker->running = true;
+    output_formatter_set_batching(loop_ctx->formatter, true);
+    ebpf_manager_set_event_queue(mgr, worker->queue);
+    
+    return 0;
+}
+
+/**
+ * Stop the output thread once it has written every queued event
+ * Must be called after the final poll; safe to call if never started
+ */
+static void stop_output_worker(output_worker_t *worker) {
+    if (!worker->running) {
+        return;
+    }
+    
+    atomic_store(&worker->stop, true);
+    spsc_queue_wake(worker->queue);
+    pthread_join(worker->thread, NULL);
+    worker->running = false;
+    
+    ebpf_manager_set_event_queue(worker->mgr, NULL);
+    spsc_queue_destroy(worker->queue);
+    worker->queue = NULL;
+}
+
+/* How far ordered output stays behind the slowest consumer: a record is
+ * stamped a little before it is submitted to its ring */
+#define ORDER_SLACK_NS 10000000ULL
+
+/* How long the merge thread sleeps when no events arrive */
+#define MERGE_IDLE_NS 1000000L
+
+typedef struct sharded_capture sharded_capture_t;
+
+/**
+ * Consumer thread of the sharded ring layout (--ring-shards)
+ * Drains one NUMA node's rings and filters and enriches on that node with
+ * its own processor. It writes events itself through its own formatter,
+ * or queues them for the merge thread when output is merged.
+ */
+typedef struct {
+    sharded_capture_t *capture;
+    unsigned int index;
+    event_loop_ctx_t loop_ctx;         /* Own processor; own formatter unless merged */
+    spsc_queue_t *queue;               /* Merged output: events for the merge thread */
+    _Atomic uint64_t watermark_ns;     /* Events stamped before this are queued */
+    _Atomic uint64_t events_processed; /* loop_ctx counts, published after each poll */
+    _Atomic uint64_t events_filtered;
+    pthread_t thread;
+    bool running;
+} shard_consumer_t;
+
+struct sharded_capture {
+    struct ebpf_manager *mgr;
+    output_formatter_t *formatter;     /* Merged output */
+    shard_consumer_t *consumers;
+    unsigned int count;
+    bool merged;                       /* One thread formats every event */
+    bool ordered;                      /* ... in timestamp order (--ordered) */
+    uint32_t drain_timeout_ms;         /* Consumers' final drain (--drain-timeout) */
+    processed_event_t **pending;       /* Ordered: min-heap by timestamp */
+    size_t pending_count;
+    processed_event_t **written;       /* Events to release after a flush */
+    atomic_bool stop;
+    atomic_bool merge_stop;
+    atomic_bool failed;
+    pthread_t merge_thread;
+    bool merge_running;
+};
+
+/**
+ * Consumer callback: prepare the event on the consumer's node, then
+ * write it or hand it to the merge thread
+ */
+static int shard_event_callback(processed_event_t *event, void *ctx) {
+    shard_consumer_t *consumer = (shard_consumer_t *)ctx;
+    uint64_t begin;
+    int ret;
+    
+    if (!prepare_event(event, &consumer->loop_ctx)) {
+        return 0;
+    }
+    
+    if (consumer->loop_ctx.summary) {
+        topk_summary_add_event(consumer->loop_ctx.summary, event);
+        return 0;
+    }
+    
+    /* The queue holds as many events as the consumer's pool */
+    if (consumer->capture->merged) {
+        if (!spsc_queue_push(consumer->queue, event)) {
+            log_warn_ratelimited("Merge queue of consumer %u full, event dropped", consumer->index);
+            return 0;
+        }
+        return EBPF_EVENT_RETAINED;
+    }
+    
+    begin = stage_begin();
+    ret = output_formatter_write_event(consumer->loop_ctx.formatter, event);
+    stage_end(STAGE_FORMAT, begin);
+    if (ret != 0) {
+        log_warn_ratelimited("Failed to write event to output");
+        return -1;
+    }
+    
+    return 0;
+}
+
+static void *shard_consumer_main(void *arg) {
+    shard_consumer_t *consumer = (shard_consumer_t *)arg;
+    sharded_capture_t *capture = consumer->capture;
+    bool stopping = false;
+    sigset_t mask;
+    int ret;
+    
+    /* Leave SIGINT/SIGTERM to the main thread */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    /* Before the first poll, so the event pool is allocated on the node */
+    ebpf_manager_bind_consumer(capture->mgr, consumer->index);
+    
+    for (;;) {
+        /* Once stopped, the probes submit nothing: drain to the end */
+        stopping = atomic_load(&capture->stop);
+        if (stopping) {
+            ret = ebpf_manager_drain_consumer(capture->mgr, consumer->index, shard_event_callback,
+                                              consumer, capture->drain_timeout_ms);
+        } else {
+            ret = ebpf_manager_poll_consumer(capture->mgr, consumer->index,
+                                             shard_event_callback, consumer);
+        }
+        if (ret < 0 && ret != -EINTR) {
+            atomic_store(&capture->failed, true);
+            break;
+        }
+        
+        if (capture->merged) {
+            atomic_store(&consumer->watermark_ns,
+                         ebpf_manager_consumer_watermark(capture->mgr, consumer->index));
+        } else {
+            output_formatter_flush(consumer->loop_ctx.formatter);
+        }
+        atomic_store_explicit(&consumer->events_processed, consumer->loop_ctx.events_processed,
+                              memory_order_relaxed);
+        atomic_store_explicit(&consumer->events_filtered, consumer->loop_ctx.events_filtered,
+                              memory_order_relaxed);
+        
+        if (stopping) {
+            break;
+        }
+    }
+    
+    /* Nothing more comes from this consumer */
+    atomic_store(&consumer->watermark_ns, UINT64_MAX);
+    return NULL;
+}
+
+static void pending_push(sharded_capture_t *capture, processed_event_t *event) {
+    processed_event_t **heap = capture->pending;
+    size_t i = capture->pending_count++;
+    
+    while (i > 0 && heap[(i - 1) / 2]->timestamp_ns > event->timestamp_ns) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = event;
+}
+
+static processed_event_t *pending_pop(sharded_capture_t *capture) {
+    processed_event_t **heap = capture->pending;
+    processed_event_t *top = heap[0];
+    processed_event_t *last = heap[--capture->pending_count];
+    size_t n = capture->pending_count;
+    size_t i = 0;
+    size_t child;
+    
+    while ((child = 2 * i + 1) < n) {
+        if (child + 1 < n && heap[child + 1]->timestamp_ns < heap[child]->timestamp_ns) {
+            child++;
+        }
+        if (last->timestamp_ns <= heap[child]->timestamp_ns) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    
+    return top;
+}
+
+static int compare_event_pools(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)(*(processed_event_t *const *)a)->pool;
+    uintptr_t y = (uintptr_t)(*(processed_event_t *const *)b)->pool;
+    
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Write one merged event
+ */
+static void write_merged_event(sharded_capture_t *capture, processed_event_t *event) {
+    uint64_t begin = stage_begin();
+    
+    if (output_formatter_write_event(capture->formatter, event) != 0) {
+        log_warn_ratelimited("Failed to write event to output");
+    }
+    stage_end(STAGE_FORMAT, begin);
+}
+
+/**
+ * Merge thread: write the consumers' events through one formatter
+ * With --ordered, events wait in a heap until every consumer has drained
+ * past their timestamp (less ORDER_SLACK_NS), and are written in
+ * timestamp order; otherwise they are written as they are popped.
+ */
+static void *merge_main(void *arg) {
+    sharded_capture_t *capture = (sharded_capture_t *)arg;
+    struct timespec idle = { .tv_sec = 0, .tv_nsec = MERGE_IDLE_NS };
+    processed_event_t *event;
+    uint64_t limit_ns;
+    uint64_t watermark_ns;
+    size_t written;
+    sigset_t mask;
+    bool stopping;
+    
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    for (;;) {
+        /* Everything queued before stop was set is popped below */
+        stopping = atomic_load(&capture->merge_stop);
+        written = 0;
+        
+        /* Read the watermarks before the queues, so every event stamped
+         * before them has been queued */
+        limit_ns = UINT64_MAX;
+        for (unsigned int i = 0; i < capture->count; i++) {
+            watermark_ns = atomic_load(&capture->consumers[i].watermark_ns);
+            if (watermark_ns < limit_ns) {
+                limit_ns = watermark_ns;
+            }
+        }
+        if (limit_ns != UINT64_MAX) {
+            limit_ns = limit_ns > ORDER_SLACK_NS ? limit_ns - ORDER_SLACK_NS : 0;
+        }
+        
+        for (unsigned int i = 0; i < capture->count; i++) {
+            while ((event = spsc_queue_pop(capture->consumers[i].queue)) != NULL) {
+                if (capture->ordered) {
+                    pending_push(capture, event);
+                } else {
+                    write_merged_event(capture, event);
+                    capture->written[written++] = event;
+                }
+            }
+        }
+        
+        while (capture->pending_count > 0 && capture->pending[0]->timestamp_ns <= limit_ns) {
+            event = pending_pop(capture);
+            write_merged_event(capture, event);
+            capture->written[written++] = event;
+        }
+        
+        if (written > 0) {
+            output_formatter_flush(capture->formatter);
+            
+            /* Group the releases by pool: switching pools costs this
+             * thread's event cache a trip to the pool */
+            qsort(capture->written, written, sizeof(*capture->written), compare_event_pools);
+            for (size_t i = 0; i < written; i++) {
+                ebpf_manager_complete_event(capture->mgr, capture->written[i]);
+            }
+        }
+        
+        /* Consumers are stopped first, so their watermarks flush the heap */
+        if (stopping && capture->pending_count == 0) {
+            break;
+        }
+        if (written == 0) {
+            nanosleep(&idle, NULL);
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Stop the consumer and merge threads once every event is written
+ * Safe to call if never started, and again after a stop
+ */
+static void stop_sharded_capture(sharded_capture_t *capture) {
+    atomic_store(&capture->stop, true);
+    for (unsigned int i = 0; i < capture->count; i++) {
+        if (capture->consumers[i].running) {
+            pthread_join(capture->consumers[i].thread, NULL);
+            capture->consumers[i].running = false;
+        }
     }
     
-    /* Requirement 7.4: Detect CAP_BPF on kernel 5.8+ and fall back to CAP_SYS_ADMIN */
-    if (has_cap_bpf > 0 || has_cap_sys_admin > 0) {
-        return EXIT_SUCCESS;
+    atomic_store(&capture->merge_stop, true);
+    if (capture->merge_running) {
+        pthread_join(capture->merge_thread, NULL);
+        capture->merge_running = false;
     }
-    
-    /* Requirement 7.2, 7.3: Exit with code 3 and display helpful error message */
-    char suggestion[512];
-    
-    if (major > CAP_BPF_KERNEL_MAJOR || 
-        (major == CAP_BPF_KERNEL_MAJOR && minor >= CAP_BPF_KERNEL_MINOR)) {
-        snprintf(suggestion, sizeof(suggestion),
-                 "Run as root (sudo crypto-tracer), or grant CAP_BPF capability: "
-                 "sudo setcap cap_bpf+ep /path/to/crypto-tracer");
-    } else {
-        snprintf(suggestion, sizeof(suggestion),
-                 "Run as root (sudo crypto-tracer), or grant CAP_SYS_ADMIN capability: "
-                 "sudo setcap cap_sys_admin+ep /path/to/crypto-tracer "
-                 "(CAP_BPF not available on kernel %d.%d)", major, minor);
+}
+
+/**
+ * Free what start_sharded_capture() created; threads must be stopped
+ */
+static void destroy_sharded_capture(sharded_capture_t *capture) {
+    for (unsigned int i = 0; i < capture->count; i++) {
+        shard_consumer_t *consumer = &capture->consumers[i];
+        
+        if (consumer->loop_ctx.formatter) {
+            output_formatter_destroy(consumer->loop_ctx.formatter);
+        }
+        if (consumer->loop_ctx.processor) {
+            event_processor_destroy(consumer->loop_ctx.processor);
+        }
+        spsc_queue_destroy(consumer->queue);
     }
     
-    log_error_with_suggestion("Insufficient privileges to run crypto-tracer", suggestion);
-    
-    return EXIT_PRIVILEGE_ERROR;
+    free(capture->consumers);
+    free(capture->pending);
+    free(capture->written);
+    capture->consumers = NULL;
+    capture->pending = NULL;
+    capture->written = NULL;
+    capture->count = 0;
 }
 
 /**
- * Check kernel version and compatibility
- * Requirements: 9.1, 9.2, 9.3, 9.4, 9.5
- * Returns EXIT_SUCCESS on success, EXIT_KERNEL_ERROR on failure
+ * Start one thread per consumer of the sharded ring layout
+ * json-stream and json-pretty events stand alone, so each consumer writes
+ * its own to the shared stream, whole events at a time. Other formats,
+ * and --ordered, go through one merge thread and the caller's formatter.
+ * 
+ * @return 0 on success, -1 on failure (capture must still be destroyed)
  */
-int check_kernel_version(void) {
-    struct utsname uts;
-    int major = 0, minor = 0, patch = 0;
-    
-    /* Get kernel version information */
-    if (uname(&uts) != 0) {
-        log_system_error("Failed to get kernel version");
-        return EXIT_KERNEL_ERROR;
+static int start_sharded_capture(sharded_capture_t *capture, struct ebpf_manager *mgr,
+                                 cli_args_t *args, output_formatter_t *formatter,
+                                 topk_summary_t *summary, FILE *output_file) {
+    unsigned int count = ebpf_manager_consumer_count(mgr);
+    shard_consumer_t *consumer;
+    
+    capture->mgr = mgr;
+    capture->formatter = formatter;
+    capture->ordered = args->ordered_output;
+    capture->drain_timeout_ms = args->drain_timeout_ms;
+    /* Consumers share a summary; only an event stream needs merging */
+    capture->merged = !summary &&
+                      (args->ordered_output ||
+                       (args->format != FORMAT_JSON_STREAM && args->format != FORMAT_JSON_PRETTY));
+    atomic_init(&capture->stop, false);
+    atomic_init(&capture->merge_stop, false);
+    atomic_init(&capture->failed, false);
+    
+    capture->consumers = calloc(count, sizeof(*capture->consumers));
+    if (!capture->consumers) {
+        return -1;
     }
-    
-    /* Parse kernel version */
-    if (parse_kernel_version(uts.release, &major, &minor, &patch) != 0) {
-        log_error("Failed to parse kernel version: %s", uts.release);
-        return EXIT_KERNEL_ERROR;
+    capture->count = count;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        consumer = &capture->consumers[i];
+        consumer->capture = capture;
+        consumer->index = i;
+        atomic_init(&consumer->watermark_ns, 0);
+        atomic_init(&consumer->events_processed, 0);
+        atomic_init(&consumer->events_filtered, 0);
+        
+        /* Enrichment caches stay on the node that fills them */
+        consumer->loop_ctx.processor = event_processor_create(args);
+        if (!consumer->loop_ctx.processor) {
+            log_error("Failed to create event processor for consumer %u", i);
+            return -1;
+        }
+        consumer->loop_ctx.processor->cgroups_in_kernel = ebpf_manager_filters_cgroups(mgr);
+        /* Merged events are formatted after later events were enriched */
+        consumer->loop_ctx.processor->copy_enrichment = capture->merged;
+        consumer->loop_ctx.summary = summary;
+        
+        if (capture->merged) {
+            consumer->queue = spsc_queue_create(EBPF_EVENT_POOL_CAPACITY);
+            if (!consumer->queue) {
+                return -1;
+            }
+        } else {
+            consumer->loop_ctx.formatter = output_formatter_create(args->format, output_file);
+            if (!consumer->loop_ctx.formatter) {
+                log_error("Failed to create output formatter for consumer %u", i);
+                return -1;
+            }
+            output_formatter_set_batching(consumer->loop_ctx.formatter, true);
+            output_formatter_set_whole_records(consumer->loop_ctx.formatter, true);
+        }
     }
     
-    log_debug("Detected kernel version: %d.%d.%d (%s)", major, minor, patch, uts.release);
+    /* Stage timing is now recorded from several threads */
+    pipeline_stats_set_concurrent();
     
-    /* Requirement 9.1: Check for minimum kernel version 4.15+ */
-    if (major < MIN_KERNEL_MAJOR || 
-        (major == MIN_KERNEL_MAJOR && minor < MIN_KERNEL_MINOR)) {
-        char error_msg[256];
-        char suggestion[256];
-        
-        snprintf(error_msg, sizeof(error_msg),
-                 "Kernel version %d.%d.%d is not supported (requires 4.15+)",
-                 major, minor, patch);
-        snprintf(suggestion, sizeof(suggestion),
-                 "Please upgrade your kernel to Linux 4.15 or later");
+    if (capture->merged) {
+        capture->pending = calloc((size_t)count * EBPF_EVENT_POOL_CAPACITY, sizeof(*capture->pending));
+        capture->written = calloc((size_t)count * EBPF_EVENT_POOL_CAPACITY, sizeof(*capture->written));
+        if (!capture->pending || !capture->written) {
+            return -1;
+        }
+        output_formatter_set_batching(formatter, true);
         
-        log_error_with_suggestion(error_msg, suggestion);
-        return EXIT_KERNEL_ERROR;
+        if (pthread_create(&capture->merge_thread, NULL, merge_main, capture) != 0) {
+            log_system_error("pthread_create");
+            return -1;
+        }
+        capture->merge_running = true;
     }
     
-    /* Requirement 9.2: Detect CAP_BPF support on kernel 5.8+ */
-    if (major > CAP_BPF_KERNEL_MAJOR || 
-        (major == CAP_BPF_KERNEL_MAJOR && minor >= CAP_BPF_KERNEL_MINOR)) {
-        /* CAP_BPF is available - enhanced security mode */
-        log_debug("Kernel %d.%d.%d supports CAP_BPF (enhanced security)", major, minor, patch);
-    } else {
-        /* Older kernel - will use CAP_SYS_ADMIN */
-        log_debug("Kernel %d.%d.%d requires CAP_SYS_ADMIN (CAP_BPF not available)", 
-                  major, minor, patch);
+    for (unsigned int i = 0; i < count; i++) {
+        consumer = &capture->consumers[i];
+        if (pthread_create(&consumer->thread, NULL, shard_consumer_main, consumer) != 0) {
+            log_system_error("pthread_create");
+            return -1;
+        }
+        consumer->running = true;
     }
     
-    /* Check for eBPF support by looking for /sys/kernel/btf/vmlinux or /proc/config.gz */
-    if (access("/sys/kernel/btf/vmlinux", F_OK) == 0) {
-        log_debug("BTF support detected (CO-RE enabled)");
-    } else {
-        log_debug("BTF not available, using fallback headers");
-    }
+    log_info("Draining %u ring buffer consumer%s%s", count, count == 1 ? "" : "s",
+             capture->ordered ? ", ordered output" : capture->merged ? ", merged output" : "");
     
-    /* Requirement 9.4: Graceful feature detection - always succeed if kernel >= 4.15 */
-    return EXIT_SUCCESS;
+    return 0;
 }
 
 /**
- * Event callback context for main event loop
+ * Sum the consumers' published event counts
+ */
+static void sum_sharded_counts(sharded_capture_t *capture, event_loop_ctx_t *loop_ctx) {
+    loop_ctx->events_processed = 0;
+    loop_ctx->events_filtered = 0;
+    for (unsigned int i = 0; i < capture->count; i++) {
+        loop_ctx->events_processed += atomic_load_explicit(&capture->consumers[i].events_processed,
+                                                           memory_order_relaxed);
+        loop_ctx->events_filtered += atomic_load_explicit(&capture->consumers[i].events_filtered,
+                                                          memory_order_relaxed);
+    }
+}
+
+/* How often the text served on --metrics-socket is refreshed */
+#define METRICS_PUBLISH_NS 1000000000ULL
+
+/**
+ * Live metrics of a monitor run (--metrics-socket, --stats-interval)
+ * Rendered on the polling thread between polls, which owns the manager's
+ * counters; the server thread only serves the published text.
  */
 typedef struct {
-    event_processor_t *processor;
-    output_formatter_t *formatter;
-    uint64_t events_processed;
-    uint64_t events_filtered;
-} event_loop_ctx_t;
+    metrics_server_t *server;
+    uint64_t stats_interval_ns;    /* 0 = no JSON stats lines */
+    uint64_t start_ns;
+    uint64_t next_publish_ns;
+    uint64_t next_stats_ns;
+} live_metrics_t;
 
 /**
- * Event callback for main event loop
- * Processes, filters, enriches, and outputs events
- * Requirements: 14.1, 14.2, 14.3, 14.4, 14.5, 14.6
+ * Turn on stage timing and BPF program stats and start the metrics server
+ * Stage timing must be on before the output thread starts.
+ * 
+ * @return 0 on success (or nothing requested), -1 if the socket failed
  */
-static int event_callback(processed_event_t *event, void *ctx) {
-    event_loop_ctx_t *loop_ctx = (event_loop_ctx_t *)ctx;
+static int start_live_metrics(live_metrics_t *live, struct ebpf_manager *mgr,
+                              const cli_args_t *args) {
+    memset(live, 0, sizeof(*live));
     
-    if (!event || !loop_ctx) {
-        return -1;
+    if (args->metrics_socket || args->stats_interval > 0 || args->stats_file) {
+        pipeline_stats_enable();
+    }
+    if (!args->metrics_socket && args->stats_interval == 0) {
+        return 0;
     }
     
-    loop_ctx->events_processed++;
+    if (ebpf_manager_enable_program_stats(mgr) != 0) {
+        log_debug("BPF program run counts unavailable, reported as 0");
+    }
     
-    /* Enrich event with process metadata from /proc */
-    enrich_event(event);
+    live->start_ns = timestamp_boot_ns();
+    live->next_publish_ns = live->start_ns;
+    live->stats_interval_ns = (uint64_t)args->stats_interval * 1000000000ULL;
+    live->next_stats_ns = live->start_ns + live->stats_interval_ns;
     
-    /* Classify file type if this is a file_open event */
-    if (event->file && event->event_type && strcmp(event->event_type, "file_open") == 0) {
-        event->file_type = classify_crypto_file(event->file);
-        
-        /* Filter: Only keep crypto files (filtering moved from eBPF to user-space) */
-        if (event->file_type == FILE_TYPE_UNKNOWN) {
-            loop_ctx->events_filtered++;
-            return 0;  /* Not a crypto file, filter it out */
+    if (args->metrics_socket) {
+        live->server = metrics_server_start(args->metrics_socket);
+        if (!live->server) {
+            return -1;
         }
     }
     
-    /* Extract library name if this is a lib_load event */
-    if (event->library && event->event_type && strcmp(event->event_type, "lib_load") == 0) {
-        event->library_name = extract_library_name(event->library);
-        
-        /* Filter: Only keep crypto libraries (filtering moved from eBPF to user-space) */
-        if (!event->library_name || 
-            (strstr(event->library, "libssl") == NULL &&
-             strstr(event->library, "libcrypto") == NULL &&
-             strstr(event->library, "libgnutls") == NULL &&
-             strstr(event->library, "libsodium") == NULL &&
-             strstr(event->library, "libnss3") == NULL &&
-             strstr(event->library, "libmbedtls") == NULL)) {
-            loop_ctx->events_filtered++;
-            return 0;  /* Not a crypto library, filter it out */
-        }
+    return 0;
+}
+
+/**
+ * Publish metrics and print a stats line when they are due
+ */
+static void update_live_metrics(live_metrics_t *live, struct ebpf_manager *mgr,
+                                const event_loop_ctx_t *ctx) {
+    metrics_counters_t counters;
+    uint64_t now_ns;
+    char *text = NULL;
+    size_t len = 0;
+    
+    if (!live->server && live->stats_interval_ns == 0) {
+        return;
     }
     
-    /* Apply privacy filtering */
-    apply_privacy_filter(event, loop_ctx->processor->redact_paths);
+    now_ns = timestamp_boot_ns();
+    counters.uptime_ns = now_ns - live->start_ns;
+    counters.events_processed = ctx->events_processed;
+    counters.events_filtered = ctx->events_filtered;
     
-    /* Check if event matches filters */
-    if (!event_processor_matches_filters(loop_ctx->processor, event)) {
-        loop_ctx->events_filtered++;
-        return 0;  /* Event filtered out */
+    if (live->server && now_ns >= live->next_publish_ns) {
+        live->next_publish_ns = now_ns + METRICS_PUBLISH_NS;
+        if (metrics_render_prometheus(mgr, &counters, &text, &len) == 0) {
+            metrics_server_publish(live->server, text, len);
+        } else {
+            free(text);
+        }
     }
     
-    /* Write event to output */
-    if (output_formatter_write_event(loop_ctx->formatter, event) != 0) {
-        log_warn("Failed to write event to output");
-        return -1;
+    if (live->stats_interval_ns > 0 && now_ns >= live->next_stats_ns) {
+        live->next_stats_ns = now_ns + live->stats_interval_ns;
+        text = NULL;
+        if (metrics_render_json(mgr, &counters, &text, &len) == 0) {
+            fwrite(text, 1, len, stderr);
+        }
+        free(text);
+    }
+}
+
+static void stop_live_metrics(live_metrics_t *live) {
+    metrics_server_stop(live->server);
+    live->server = NULL;
+}
+
+/**
+ * Proc cache loader of monitor --record-raw: read /proc and record the result
+ */
+static void record_proc_read(pid_t pid, uint64_t start_time_ns, unsigned int flags,
+                             proc_cache_entry_t *entry, void *ctx) {
+    proc_cache_read_proc(pid, start_time_ns, flags, entry, NULL);
+    if (raw_writer_write_proc((raw_writer_t *)ctx, pid, start_time_ns, flags, entry) != 0) {
+        log_warn_ratelimited("Failed to record /proc metadata of PID %d", pid);
     }
+}
+
+/**
+ * Proc cache loader of replay: hand out the reads recorded with the capture
+ */
+static void replay_proc_read(pid_t pid, uint64_t start_time_ns, unsigned int flags,
+                             proc_cache_entry_t *entry, void *ctx) {
+    (void)flags;
+    raw_reader_proc_lookup((raw_reader_t *)ctx, pid, start_time_ns, entry);
+}
+
+/**
+ * Add the TLS handshakes of an interval to the summary
+ * (ebpf_manager_read_handshake_latency callback)
+ */
+static void summary_handshake_callback(const handshake_latency_t *delta, void *ctx) {
+    topk_summary_add_handshakes((topk_summary_t *)ctx, delta);
+}
+
+/**
+ * Write the monitor's top-K summary (--format summary, --top)
+ * Handshake latencies are read from the kernel histograms first.
+ */
+static void write_monitor_summary(topk_summary_t *summary, struct ebpf_manager *mgr,
+                                  FILE *output_file, const cli_args_t *args, time_t start_time) {
+    char generated_at[TIMESTAMP_ISO8601_LEN];
+    time_t now = time(NULL);
     
-    return 0;
+    ebpf_manager_read_handshake_latency(mgr, summary_handshake_callback, summary);
+    
+    if (!timestamp_format_iso8601((uint64_t)now * 1000000000ULL, generated_at,
+                                  sizeof(generated_at))) {
+        generated_at[0] = '\0';
+    }
+    if (topk_summary_write(summary, output_file, args->format, generated_at,
+                           (uint64_t)difftime(now, start_time)) != 0) {
+        log_warn_ratelimited("Failed to write summary");
+    }
 }
 
 /**
@@ -762,9 +2626,18 @@ static int execute_monitor_command(cli_args_t *args) {
     struct ebpf_manager *mgr = NULL;
     event_processor_t *processor = NULL;
     output_formatter_t *formatter = NULL;
+    topk_summary_t *summary = NULL;
     FILE *output_file = NULL;
+    output_sink_t *sink = NULL;
+    exporter_t *exporter = NULL;
     event_loop_ctx_t loop_ctx = {0};
-    time_t start_time, current_time;
+    output_worker_t worker = {0};
+    sharded_capture_t sharded = {0};
+    raw_writer_t *raw_writer = NULL;
+    live_metrics_t live = {0};
+    struct timespec tick = { .tv_sec = 0, .tv_nsec = 10000000 };
+    time_t start_time, current_time, next_summary = 0;
+    uint64_t start_ns;
     int ret = EXIT_SUCCESS;
     uint64_t events_processed_total = 0;
     uint64_t events_dropped_total = 0;
@@ -791,34 +2664,111 @@ static int execute_monitor_command(cli_args_t *args) {
     }
     log_debug("Event processor created");
     
-    /* Open output file if specified */
-    if (args->output_file) {
-        output_file = fopen(args->output_file, "w");
-        if (!output_file) {
+    /* Open output file if specified: written on the sink's own thread,
+     * compressed and rotated as requested. An export sends the output to
+     * a collector instead, in batches of the sink's blocks. */
+    if (args->export_address) {
+        char host[256], port[8];
+        exporter_config_t export_config = {
+            .host = host,
+            .port = port,
+            .gzip_level = args->gzip_level >= 0 ? args->gzip_level : DEFAULT_GZIP_LEVEL,
+            .binary = args->format == FORMAT_BINARY,
+            .spool_dir = args->spool_dir,
+            .spool_max_bytes = args->spool_max_bytes,
+        };
+        
+        exporter_parse_address(args->export_address, host, sizeof(host), port, sizeof(port));
+        exporter = exporter_create(&export_config);
+        if (exporter) {
+            sink = output_sink_open_backend(&exporter_backend, exporter);
+        }
+        if (!sink) {
+            if (!exporter && args->spool_dir) {
+                log_error("Failed to use spool directory: %s", args->spool_dir);
+            } else {
+                log_error("Failed to start exporting to %s", args->export_address);
+            }
+            log_system_error("exporter");
+            exporter_destroy(exporter);
+            event_processor_destroy(processor);
+            ebpf_manager_destroy(mgr);
+            return EXIT_GENERAL_ERROR;
+        }
+        output_file = output_sink_stream(sink);
+        log_debug("Exporting to %s", args->export_address);
+    } else if (args->output_file) {
+        output_sink_config_t sink_config = {
+            .path = args->output_file,
+            .gzip_level = args->gzip_level > 0 ? args->gzip_level : 0,
+            .rotate_bytes = args->rotate_bytes,
+            .rotate_ms = args->rotate_interval_ms,
+            .rotate_keep = (unsigned int)args->rotate_keep,
+        };
+        
+        sink = output_sink_open(&sink_config);
+        if (!sink) {
             log_error("Failed to open output file: %s", args->output_file);
-            log_system_error("fopen");
+            log_system_error("open");
             event_processor_destroy(processor);
             ebpf_manager_destroy(mgr);
             return EXIT_GENERAL_ERROR;
         }
+        output_file = output_sink_stream(sink);
         log_debug("Output file opened: %s", args->output_file);
     } else {
         output_file = stdout;
     }
     
-    /* Create output formatter */
-    formatter = output_formatter_create(args->format, output_file);
+    /* Create output formatter (a summary writes no event document) */
+    formatter = output_formatter_create(args->summary_top > 0 ? FORMAT_SUMMARY : args->format,
+                                        output_file);
     if (!formatter) {
         log_error("Failed to create output formatter");
-        if (args->output_file && output_file) {
-            fclose(output_file);
+        if (sink) {
+            output_sink_close(sink, NULL);
         }
+        exporter_destroy(exporter);
         event_processor_destroy(processor);
         ebpf_manager_destroy(mgr);
         return EXIT_GENERAL_ERROR;
     }
     log_debug("Output formatter created");
     
+    /* Files rotate and batches end between writes: only hand whole events
+     * to the sink */
+    if (args->rotate_bytes > 0 || args->rotate_interval_ms > 0 || exporter) {
+        output_formatter_set_whole_records(formatter, true);
+    }
+    
+    /* --format summary / --top: refreshed top-K tables instead of events */
+    if (args->summary_top > 0) {
+        summary = topk_summary_create((unsigned int)args->summary_top);
+        if (!summary) {
+            log_error("Failed to create summary");
+            ret = EXIT_GENERAL_ERROR;
+            goto cleanup;
+        }
+        
+        /* The summary shows handshake latency histograms, read from the
+         * kernel when it is written */
+        ebpf_manager_set_handshake_latency(mgr, true);
+        topk_summary_enable_handshakes(summary);
+    }
+    
+    /* Size the ring buffers before the maps are created */
+    if (configure_ringbuf(mgr, args) != 0) {
+        ret = EXIT_ARGUMENT_ERROR;
+        goto cleanup;
+    }
+    configure_sources(mgr, args);
+    configure_coalescing(mgr, args);
+    if (configure_daemon_client(mgr, args) != 0) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    ebpf_manager_set_ring_layout(mgr, (ebpf_ring_layout_t)args->ring_layout);
+    
     /* Step 6: Load eBPF programs */
     log_debug("Loading eBPF programs...");
     ret = ebpf_manager_load_programs(mgr);
@@ -829,6 +2779,9 @@ static int execute_monitor_command(cli_args_t *args) {
     }
     log_info("eBPF programs loaded successfully");
     
+    configure_kernel_filter(mgr, processor, args->pid, args->process_name, false);
+    configure_rate_limits(mgr, args);
+    
     /* Attach eBPF programs */
     log_debug("Attaching eBPF programs...");
     ret = ebpf_manager_attach_programs(mgr);
@@ -843,27 +2796,77 @@ static int execute_monitor_command(cli_args_t *args) {
     log_debug("Verifying system ready...");
     log_info("crypto-tracer ready, monitoring started");
     
+    /* Record what the kernel sends and what enrichment reads, for replay */
+    if (args->record_file) {
+        raw_writer = raw_writer_create(args->record_file, timestamp_boot_offset());
+        if (!raw_writer) {
+            ret = EXIT_GENERAL_ERROR;
+            goto cleanup;
+        }
+        ebpf_manager_set_raw_writer(mgr, raw_writer);
+        proc_cache_set_loader(processor->cache, record_proc_read, raw_writer);
+        log_info("Recording raw events to %s", args->record_file);
+    }
+    
     /* Setup event loop context */
     loop_ctx.processor = processor;
     loop_ctx.formatter = formatter;
+    loop_ctx.summary = summary;
     loop_ctx.events_processed = 0;
     loop_ctx.events_filtered = 0;
     
+    if (start_live_metrics(&live, mgr, args) != 0) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
+    /* Sharded rings: one thread per consumer drains, filters and writes */
+    if (ebpf_manager_consumer_count(mgr) > 0) {
+        if (start_sharded_capture(&sharded, mgr, args, formatter, summary, output_file) != 0) {
+            log_error("Failed to start ring buffer consumers");
+            ret = EXIT_GENERAL_ERROR;
+            goto cleanup;
+        }
+    } else if (start_output_worker(&worker, mgr, &loop_ctx) != 0) {
+        /* Format and write events on a separate thread */
+        log_warn("Output thread unavailable, writing events from the capture loop");
+        configure_batched_output(mgr, formatter);
+    }
+    
     /* Record start time */
     start_time = time(NULL);
+    start_ns = timestamp_boot_ns();
+    next_summary = start_time + args->profile_interval;
     
-    /* Main event loop - single-threaded, event-driven */
+    /* Main event loop - event-driven capture, output on the worker thread */
     /* Requirements: 16.1, 16.2 - Complete initialization in <2s, capture first event within 2s */
     log_debug("Entering main event loop");
     
     while (!is_shutdown_requested()) {
-        /* Poll events from ring buffer (10ms timeout) */
-        /* Requirement: 14.1 - Poll ring buffer every 10ms */
-        /* Requirement: 14.2 - Process up to 100 events per iteration */
-        ret = ebpf_manager_poll_events(mgr, event_callback, &loop_ctx);
-        if (ret < 0 && ret != -EINTR) {
-            log_error("Error polling events: %d", ret);
-            break;
+        if (sharded.count > 0) {
+            /* The consumer threads poll; this one only keeps time */
+            nanosleep(&tick, NULL);
+            if (atomic_load(&sharded.failed)) {
+                log_error("Error polling ring buffer shards");
+                break;
+            }
+            sum_sharded_counts(&sharded, &loop_ctx);
+        } else {
+            /* Poll events from ring buffer (10ms timeout) */
+            /* Requirement: 14.1 - Wait up to 10ms for events while idle */
+            /* Requirement: 14.2 - Drain up to one budget of events per iteration */
+            ret = ebpf_manager_poll_events(mgr, event_callback, &loop_ctx);
+            if (ret < 0 && ret != -EINTR) {
+                log_error("Error polling events: %d", ret);
+                break;
+            }
+        }
+        
+        update_live_metrics(&live, mgr, &loop_ctx);
+        
+        if (summary && time(NULL) >= next_summary) {
+            write_monitor_summary(summary, mgr, output_file, args, start_time);
+            next_summary = time(NULL) + args->profile_interval;
         }
         
         /* Check duration limit */
@@ -876,24 +2879,38 @@ static int execute_monitor_command(cli_args_t *args) {
         }
     }
     
-    /* Requirement: 16.4 - Process buffered events before exit (up to 1 second) */
-    if (is_shutdown_requested()) {
-        log_debug("Shutdown requested, processing remaining events...");
-        time_t shutdown_start = time(NULL);
-        while (difftime(time(NULL), shutdown_start) < 1.0) {
-            ret = ebpf_manager_poll_events(mgr, event_callback, &loop_ctx);
-            if (ret < 0 && ret != -EINTR) {
-                break;
-            }
-            /* If no events processed in last poll, we're done */
-            if (ret == 0) {
-                break;
-            }
-        }
+    /* Requirement: 16.4 - Process buffered events before exit */
+    drain_remaining_events(mgr, args, event_callback, &loop_ctx);
+    
+    /* Report the last partial coalescing window */
+    ebpf_manager_flush_coalesced(mgr);
+    
+    /* Wait for the output thread to write the last queued events */
+    stop_output_worker(&worker);
+    
+    /* Consumers drain their rings (up to --drain-timeout) before they stop */
+    stop_sharded_capture(&sharded);
+    sum_sharded_counts(&sharded, &loop_ctx);
+    
+    /* The final summary covers the whole run */
+    if (summary) {
+        write_monitor_summary(summary, mgr, output_file, args, start_time);
     }
     
     /* Get final statistics */
     ebpf_manager_get_stats(mgr, &events_processed_total, &events_dropped_total);
+    log_source_stats(mgr);
+    if (sharded.count > 0) {
+        for (unsigned int i = 0; i < sharded.count; i++) {
+            log_cache_stats(sharded.consumers[i].loop_ctx.processor);
+        }
+    } else {
+        log_cache_stats(processor);
+    }
+    if (args->stats_file) {
+        write_stats_file(args->stats_file, mgr, &loop_ctx, timestamp_boot_ns() - start_ns,
+                         sink, exporter);
+    }
     
     /* Log statistics */
     log_info("Monitoring complete");
@@ -907,20 +2924,35 @@ cleanup:
     /* Requirement: 16.3, 16.4, 16.5 - Graceful shutdown with timeout protection */
     log_debug("Cleaning up resources...");
     
+    stop_output_worker(&worker);
+    stop_sharded_capture(&sharded);
+    stop_live_metrics(&live);
+    
     /* Cleanup eBPF manager (includes timeout protection) */
     if (mgr) {
         ebpf_manager_cleanup(mgr);
+        log_shutdown_stats(mgr);
         ebpf_manager_destroy(mgr);
     }
     
+    /* Consumer formatters write to the output file too */
+    destroy_sharded_capture(&sharded);
+    topk_summary_destroy(summary);
+    
     /* Cleanup output formatter */
     if (formatter) {
         output_formatter_destroy(formatter);
     }
     
-    /* Close output file if we opened it */
-    if (args->output_file && output_file && output_file != stdout) {
-        fclose(output_file);
+    /* Write out and close the output file if we opened it */
+    if (sink && output_sink_close(sink, NULL) != 0 && ret == EXIT_SUCCESS) {
+        log_error("Failed to write output: %s",
+                  args->output_file ? args->output_file : args->export_address);
+        ret = EXIT_GENERAL_ERROR;
+    }
+    if (exporter) {
+        log_export_stats(exporter, args->export_address);
+        exporter_destroy(exporter);
     }
     
     /* Cleanup event processor */
@@ -928,6 +2960,10 @@ cleanup:
         event_processor_destroy(processor);
     }
     
+    if (raw_writer && raw_writer_close(raw_writer) != 0 && ret == EXIT_SUCCESS) {
+        ret = EXIT_GENERAL_ERROR;
+    }
+    
     log_debug("Cleanup complete");
     
     return ret;
@@ -941,6 +2977,8 @@ typedef struct {
     profile_manager_t *profile_mgr;
     pid_t target_pid;
     bool follow_children;
+    bool children_in_kernel;       /* Kernel PID filter tracks descendants */
+    bool system_wide;              /* profile --all: every PID gets a profile */
     uint64_t events_processed;
     uint64_t events_filtered;
 } profile_ctx_t;
@@ -951,6 +2989,7 @@ typedef struct {
  */
 static int profile_event_callback(processed_event_t *event, void *ctx) {
     profile_ctx_t *pctx = (profile_ctx_t *)ctx;
+    filter_verdict_t verdict;
     
     if (!event || !pctx) {
         return -1;
@@ -958,11 +2997,50 @@ static int profile_event_callback(processed_event_t *event, void *ctx) {
     
     pctx->events_processed++;
     
-    /* Enrich event with process metadata */
-    enrich_event(event);
+    /* System-wide profiles are built from crypto activity only; exec
+     * events would start a profile for every short-lived process */
+    if (pctx->system_wide && processed_event_kind(event) == EVENT_PROCESS_EXEC) {
+        pctx->events_filtered++;
+        return 0;
+    }
+    
+    /* Requirement 2.1: Filter by target PID */
+    /* Requirement 2.4: Include child processes if follow_children enabled
+     * Children are tracked by the kernel PID filter, so any other PID that
+     * gets this far is a descendant; fold it into the target's profile */
+    bool matches_target = pctx->system_wide || (event->pid == (uint32_t)pctx->target_pid);
+    bool fold_into_target = false;
+    
+    if (!matches_target && pctx->follow_children && pctx->children_in_kernel) {
+        /* A child exiting must not retire the target's profile */
+        if (processed_event_kind(event) == EVENT_PROCESS_EXIT) {
+            pctx->events_filtered++;
+            return 0;
+        }
+        fold_into_target = true;
+        matches_target = true;
+    }
+    
+    if (!matches_target) {
+        pctx->events_filtered++;
+        return 0;  /* Event filtered out */
+    }
+    
+    /* Check the other filters on the decoded record, before any /proc
+     * read; a folded child is checked as the target */
+    uint32_t pid = event->pid;
+    if (fold_into_target) {
+        event->pid = (uint32_t)pctx->target_pid;
+    }
+    verdict = event_processor_prefilter(pctx->processor, event);
+    event->pid = pid;
+    if (verdict == FILTER_REJECT) {
+        pctx->events_filtered++;
+        return 0;  /* Event filtered out */
+    }
     
     /* Classify file type if this is a file_open event */
-    if (event->file && event->event_type && strcmp(event->event_type, "file_open") == 0) {
+    if (event->file && processed_event_kind(event) == EVENT_FILE_OPEN) {
         event->file_type = classify_crypto_file(event->file);
         
         /* Filter: Only keep crypto files (filtering moved from eBPF to user-space) */
@@ -973,51 +3051,254 @@ static int profile_event_callback(processed_event_t *event, void *ctx) {
     }
     
     /* Extract library name if this is a lib_load event */
-    if (event->library && event->event_type && strcmp(event->event_type, "lib_load") == 0) {
-        event->library_name = extract_library_name(event->library);
+    if (event->library && processed_event_kind(event) == EVENT_LIB_LOAD) {
+        set_library_name(event);
         
         /* Filter: Only keep crypto libraries (filtering moved from eBPF to user-space) */
         if (!event->library_name || 
-            (strstr(event->library, "libssl") == NULL &&
-             strstr(event->library, "libcrypto") == NULL &&
-             strstr(event->library, "libgnutls") == NULL &&
-             strstr(event->library, "libsodium") == NULL &&
-             strstr(event->library, "libnss3") == NULL &&
-             strstr(event->library, "libmbedtls") == NULL)) {
+            !crypto_classifier_is_library(crypto_classifier_default(), event->library)) {
             pctx->events_filtered++;
             return 0;  /* Not a crypto library, filter it out */
         }
     }
     
-    /* Apply privacy filtering */
-    apply_privacy_filter(event, pctx->processor->redact_paths);
-    
-    /* Requirement 2.1: Filter by target PID */
-    /* Requirement 2.4: Include child processes if follow_children enabled */
-    bool matches_target = (event->pid == (uint32_t)pctx->target_pid);
-    
-    /* TODO: Implement child process tracking for follow_children */
-    /* For now, we only track the target PID */
+    /* Enrich event with process metadata (of the process itself) */
+    event_processor_enrich(pctx->processor, event);
     
-    if (!matches_target) {
-        pctx->events_filtered++;
-        return 0;  /* Event filtered out */
+    if (fold_into_target) {
+        event->pid = (uint32_t)pctx->target_pid;
     }
     
-    /* Check if event matches other filters */
-    if (!event_processor_matches_filters(pctx->processor, event)) {
+    if (verdict == FILTER_UNDECIDED && !event_processor_matches_filters(pctx->processor, event)) {
         pctx->events_filtered++;
         return 0;  /* Event filtered out */
     }
     
+    /* Apply privacy filtering */
+    apply_privacy_filter(event, pctx->processor->redact_paths);
+    
     /* Add event to profile manager */
     if (profile_manager_add_event(pctx->profile_mgr, event) != 0) {
-        log_warn("Failed to add event to profile");
+        log_warn_ratelimited("Failed to add event to profile");
     }
     
     return 0;
 }
 
+/**
+ * Add the TLS handshakes of an interval to their profile
+ * (ebpf_manager_read_handshake_latency callback)
+ */
+static void profile_handshake_callback(const handshake_latency_t *delta, void *ctx) {
+    profile_ctx_t *pctx = (profile_ctx_t *)ctx;
+    pid_t pid = (pid_t)delta->pid;
+    
+    /* The kernel PID filter only lets the target and, when followed, its
+     * descendants through; fold the latter into the target's profile */
+    if (!pctx->system_wide && pid != pctx->target_pid) {
+        if (!pctx->follow_children || !pctx->children_in_kernel) {
+            return;
+        }
+        pid = pctx->target_pid;
+    }
+    
+    if (profile_manager_add_handshakes(pctx->profile_mgr, pid, delta) != 0) {
+        log_warn_ratelimited("Failed to add handshakes to profile");
+    }
+}
+
+/**
+ * Write one profile delta (profile_manager_flush_deltas callback)
+ */
+static void write_profile_delta(profile_t *delta, void *ctx) {
+    if (output_formatter_write_profile((output_formatter_t *)ctx, delta) != 0) {
+        log_warn("Failed to write profile delta for PID %d", delta->process.pid);
+    }
+}
+
+/**
+ * Emit the deltas of every changed profile
+ */
+static void flush_profile_deltas(profile_manager_t *profile_mgr, output_formatter_t *formatter,
+                                 time_t *last_flush) {
+    time_t now = time(NULL);
+    int emitted = profile_manager_flush_deltas(profile_mgr, (int)difftime(now, *last_flush),
+                                               write_profile_delta, formatter);
+    
+    if (emitted > 0) {
+        log_debug("Wrote %d profile deltas", emitted);
+    }
+    *last_flush = now;
+}
+
+/**
+ * Execute profile --all
+ * Aggregates every process and writes, every --interval seconds, one
+ * profile per process with new libraries, file accesses or API calls
+ * since the previous interval. Profiles of exited processes are dropped
+ * after their last delta, which keeps memory proportional to the live
+ * processes using crypto.
+ */
+static int execute_profile_all_command(cli_args_t *args) {
+    struct ebpf_manager *mgr = NULL;
+    event_processor_t *processor = NULL;
+    output_formatter_t *formatter = NULL;
+    profile_manager_t *profile_mgr = NULL;
+    FILE *output_file = NULL;
+    time_t start_time, last_flush;
+    int ret = EXIT_SUCCESS;
+    uint64_t events_processed_total = 0;
+    uint64_t events_dropped_total = 0;
+    
+    log_info("Starting system-wide profile (delta every %d seconds)", args->profile_interval);
+    
+    mgr = ebpf_manager_create();
+    if (!mgr) {
+        log_error("Failed to create eBPF manager");
+        return EXIT_BPF_ERROR;
+    }
+    
+    processor = event_processor_create(args);
+    if (!processor) {
+        log_error("Failed to create event processor");
+        ebpf_manager_destroy(mgr);
+        return EXIT_GENERAL_ERROR;
+    }
+    
+    profile_mgr = profile_manager_create();
+    if (!profile_mgr) {
+        log_error("Failed to create profile manager");
+        event_processor_destroy(processor);
+        ebpf_manager_destroy(mgr);
+        return EXIT_GENERAL_ERROR;
+    }
+    
+    if (args->output_file) {
+        output_file = fopen(args->output_file, "w");
+        if (!output_file) {
+            log_error("Failed to open output file: %s", args->output_file);
+            log_system_error("fopen");
+            profile_manager_destroy(profile_mgr);
+            event_processor_destroy(processor);
+            ebpf_manager_destroy(mgr);
+            return EXIT_GENERAL_ERROR;
+        }
+    } else {
+        output_file = stdout;
+    }
+    
+    formatter = output_formatter_create(args->format, output_file);
+    if (!formatter) {
+        log_error("Failed to create output formatter");
+        if (args->output_file && output_file) {
+            fclose(output_file);
+        }
+        profile_manager_destroy(profile_mgr);
+        event_processor_destroy(processor);
+        ebpf_manager_destroy(mgr);
+        return EXIT_GENERAL_ERROR;
+    }
+    
+    if (configure_ringbuf(mgr, args) != 0) {
+        ret = EXIT_ARGUMENT_ERROR;
+        goto cleanup;
+    }
+    configure_sources(mgr, args);
+    configure_coalescing(mgr, args);
+    if (configure_daemon_client(mgr, args) != 0) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
+    /* Profiles only need API call counts and handshake latency
+     * histograms: both are kept in the kernel */
+    ebpf_manager_set_api_aggregation(mgr, true);
+    ebpf_manager_set_handshake_latency(mgr, true);
+    
+    if (ebpf_manager_load_programs(mgr) != 0) {
+        log_error("Failed to load eBPF programs");
+        ret = EXIT_BPF_ERROR;
+        goto cleanup;
+    }
+    
+    /* No PID filter: every process is profiled */
+    configure_kernel_filter(mgr, processor, 0, NULL, false);
+    configure_rate_limits(mgr, args);
+    
+    if (ebpf_manager_attach_programs(mgr) != 0) {
+        log_error("Failed to attach eBPF programs");
+        ret = EXIT_BPF_ERROR;
+        goto cleanup;
+    }
+    log_info("Profiling started");
+    
+    profile_ctx_t profile_ctx = {
+        .processor = processor,
+        .profile_mgr = profile_mgr,
+        .system_wide = true,
+        .events_processed = 0,
+        .events_filtered = 0
+    };
+    
+    start_time = time(NULL);
+    last_flush = start_time;
+    
+    while (!is_shutdown_requested()) {
+        ret = ebpf_manager_poll_events(mgr, profile_event_callback, &profile_ctx);
+        if (ret < 0 && ret != -EINTR) {
+            log_error("Error polling events: %d", ret);
+            break;
+        }
+        
+        time_t now = time(NULL);
+        if (difftime(now, last_flush) >= args->profile_interval) {
+            ebpf_manager_read_api_counts(mgr, profile_event_callback, &profile_ctx);
+            ebpf_manager_read_handshake_latency(mgr, profile_handshake_callback, &profile_ctx);
+            flush_profile_deltas(profile_mgr, formatter, &last_flush);
+        }
+        
+        if (args->duration > 0 && difftime(now, start_time) >= args->duration) {
+            log_debug("Profile duration reached (%d seconds)", args->duration);
+            break;
+        }
+    }
+    
+    /* Process remaining events, then report the last partial interval */
+    drain_remaining_events(mgr, args, profile_event_callback, &profile_ctx);
+    ebpf_manager_flush_coalesced(mgr);
+    ebpf_manager_read_api_counts(mgr, profile_event_callback, &profile_ctx);
+    ebpf_manager_read_handshake_latency(mgr, profile_handshake_callback, &profile_ctx);
+    flush_profile_deltas(profile_mgr, formatter, &last_flush);
+    
+    ebpf_manager_get_stats(mgr, &events_processed_total, &events_dropped_total);
+    log_source_stats(mgr);
+    log_cache_stats(processor);
+    
+    log_info("Profiling complete");
+    log_info("Events processed: %lu", profile_ctx.events_processed);
+    log_info("Events filtered: %lu", profile_ctx.events_filtered);
+    log_info("Events dropped: %lu", events_dropped_total);
+    
+    ret = EXIT_SUCCESS;
+    
+cleanup:
+    if (mgr) {
+        ebpf_manager_cleanup(mgr);
+        log_shutdown_stats(mgr);
+        ebpf_manager_destroy(mgr);
+    }
+    if (formatter) {
+        output_formatter_destroy(formatter);
+    }
+    if (output_file && output_file != stdout) {
+        fclose(output_file);
+    }
+    profile_manager_destroy(profile_mgr);
+    event_processor_destroy(processor);
+    
+    return ret;
+}
+
 /**
  * Execute profile command
  * Requirement: 2.1, 2.2, 2.3, 2.4, 2.5, 2.6
@@ -1037,6 +3318,10 @@ static int execute_profile_command(cli_args_t *args) {
     uint64_t events_processed_total = 0;
     uint64_t events_dropped_total = 0;
     
+    if (args->profile_all) {
+        return execute_profile_all_command(args);
+    }
+    
     log_info("Starting profile command");
     
     /* Requirement 2.1: Resolve process name to PID if needed */
@@ -1085,7 +3370,7 @@ static int execute_profile_command(cli_args_t *args) {
     }
     
     process_info_t proc_info;
-    if (proc_scanner_get_process_info(scanner, target_pid, &proc_info) != 0) {
+    if (proc_scanner_get_process_info(scanner, target_pid, &proc_info, NULL) != 0) {
         log_error("Target process (PID %d) not found or not accessible", target_pid);
         proc_scanner_destroy(scanner);
         return EXIT_GENERAL_ERROR;
@@ -1159,6 +3444,23 @@ static int execute_profile_command(cli_args_t *args) {
     }
     log_debug("Output formatter created");
     
+    /* Size the ring buffers before the maps are created */
+    if (configure_ringbuf(mgr, args) != 0) {
+        ret = EXIT_ARGUMENT_ERROR;
+        goto cleanup;
+    }
+    configure_sources(mgr, args);
+    configure_coalescing(mgr, args);
+    if (configure_daemon_client(mgr, args) != 0) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
+    /* Profiles only need API call counts and handshake latency
+     * histograms: both are kept in the kernel */
+    ebpf_manager_set_api_aggregation(mgr, true);
+    ebpf_manager_set_handshake_latency(mgr, true);
+    
     /* Load eBPF programs */
     log_debug("Loading eBPF programs...");
     ret = ebpf_manager_load_programs(mgr);
@@ -1169,6 +3471,10 @@ static int execute_profile_command(cli_args_t *args) {
     }
     log_info("eBPF programs loaded successfully");
     
+    /* Profile by name resolved to a PID above; the name filter stays in user space */
+    configure_kernel_filter(mgr, processor, target_pid, NULL, args->follow_children);
+    configure_rate_limits(mgr, args);
+    
     /* Attach eBPF programs */
     log_debug("Attaching eBPF programs...");
     ret = ebpf_manager_attach_programs(mgr);
@@ -1190,6 +3496,7 @@ static int execute_profile_command(cli_args_t *args) {
         .profile_mgr = profile_mgr,
         .target_pid = target_pid,
         .follow_children = args->follow_children,
+        .children_in_kernel = ebpf_manager_follows_children(mgr),
         .events_processed = 0,
         .events_filtered = 0
     };
@@ -1206,7 +3513,7 @@ static int execute_profile_command(cli_args_t *args) {
         }
         
         /* Requirement 2.3: Check if target process still exists */
-        if (proc_scanner_get_process_info(scanner, target_pid, &proc_info) != 0) {
+        if (proc_scanner_get_process_info(scanner, target_pid, &proc_info, NULL) != 0) {
             log_info("Target process (PID %d) has exited", target_pid);
             process_exited = true;
             break;
@@ -1221,22 +3528,17 @@ static int execute_profile_command(cli_args_t *args) {
     }
     
     /* Process remaining events */
-    if (is_shutdown_requested() || process_exited) {
-        log_debug("Processing remaining events...");
-        time_t shutdown_start = time(NULL);
-        while (difftime(time(NULL), shutdown_start) < 1.0) {
-            ret = ebpf_manager_poll_events(mgr, profile_event_callback, &profile_ctx);
-            if (ret < 0 && ret != -EINTR) {
-                break;
-            }
-            if (ret == 0) {
-                break;
-            }
-        }
-    }
+    drain_remaining_events(mgr, args, profile_event_callback, &profile_ctx);
+    
+    /* Add the API calls, repeated opens and handshakes counted in the kernel */
+    ebpf_manager_flush_coalesced(mgr);
+    ebpf_manager_read_api_counts(mgr, profile_event_callback, &profile_ctx);
+    ebpf_manager_read_handshake_latency(mgr, profile_handshake_callback, &profile_ctx);
     
     /* Get final statistics */
     ebpf_manager_get_stats(mgr, &events_processed_total, &events_dropped_total);
+    log_source_stats(mgr);
+    log_cache_stats(processor);
     
     /* Requirement 2.2, 2.5: Generate complete profile document */
     log_info("Generating profile...");
@@ -1279,6 +3581,7 @@ cleanup:
     /* Cleanup eBPF manager */
     if (mgr) {
         ebpf_manager_cleanup(mgr);
+        log_shutdown_stats(mgr);
         ebpf_manager_destroy(mgr);
     }
     
@@ -1288,7 +3591,7 @@ cleanup:
     }
     
     /* Close output file if we opened it */
-    if (args->output_file && output_file && output_file != stdout) {
+    if (output_file && output_file != stdout) {
         fclose(output_file);
     }
     
@@ -1325,7 +3628,11 @@ static int execute_snapshot_command(cli_args_t *args) {
     output_formatter_t *formatter = NULL;
     FILE *output_file = NULL;
     snapshot_t snapshot = {0};
-    process_list_t process_list = {0};
+    snapshot_t added = {0};
+    snapshot_t removed = {0};
+    snapshot_state_t *state = NULL;
+    snapshot_scan_config_t scan_config = {0};
+    snapshot_scan_stats_t scan_stats;
     int ret = EXIT_SUCCESS;
     time_t start_time, current_time;
     struct utsname sys_info;
@@ -1374,20 +3681,9 @@ static int execute_snapshot_command(cli_args_t *args) {
         proc_scanner_destroy(scanner);
         return EXIT_GENERAL_ERROR;
     }
+    output_formatter_set_library_index(formatter, args->library_index);
     log_debug("Output formatter created");
     
-    /* Initialize process list */
-    process_list_init(&process_list);
-    
-    /* Requirement 3.1: Scan all running processes */
-    log_debug("Scanning processes...");
-    if (proc_scanner_scan_processes(scanner, &process_list) != 0) {
-        log_error("Failed to scan processes");
-        ret = EXIT_GENERAL_ERROR;
-        goto cleanup;
-    }
-    log_debug("Found %zu processes", process_list.count);
-    
     /* Build snapshot structure */
     snapshot.snapshot_version = "1.0";
     
@@ -1412,101 +3708,61 @@ static int execute_snapshot_command(cli_args_t *args) {
     snapshot.hostname = hostname;
     snapshot.kernel = kernel_version;
     
-    /* Allocate processes array */
-    snapshot.process_count = 0;
-    snapshot.processes = calloc(process_list.count, sizeof(*snapshot.processes));
-    if (!snapshot.processes) {
-        log_error("Failed to allocate snapshot processes array");
-        ret = EXIT_GENERAL_ERROR;
-        goto cleanup;
+    /* Incremental: what the previous run found, to skip unchanged processes */
+    if (args->incremental) {
+        state = snapshot_state_load(args->state_file, !args->no_redact);
+        if (!state) {
+            log_error("Failed to load snapshot state");
+            ret = EXIT_GENERAL_ERROR;
+            goto cleanup;
+        }
+        log_debug("Snapshot state: %zu processes from %s", snapshot_state_previous_count(state),
+                  snapshot_state_since(state) ? snapshot_state_since(state) : "no previous run");
     }
     
-    /* Initialize summary statistics */
-    snapshot.summary.total_processes = 0;
-    snapshot.summary.total_libraries = 0;
-    snapshot.summary.total_files = 0;
-    
-    /* Scan each process for crypto libraries and files */
+    /* Requirements 3.1-3.3, 3.5: Scan processes for crypto libraries and files */
     log_debug("Scanning for crypto libraries and files...");
+    scan_config.redact = !args->no_redact;
+    scan_config.bpf_iter = true;
+    scan_config.state = state;
+    if (snapshot_scan(scanner, &scan_config, &snapshot, &scan_stats) != 0) {
+        log_error("Failed to scan processes");
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    if (scan_stats.timed_out) {
+        log_warn("Snapshot timeout reached (%d seconds), stopping scan",
+                 SNAPSHOT_DEFAULT_TIMEOUT_MS / 1000);
+    }
+    if (scan_stats.bpf_iter) {
+        log_debug("Scanned %zu processes with BPF iterators", scan_stats.pids_scanned);
+    } else {
+        log_debug("Scanned %zu of %zu processes with %u threads",
+                  scan_stats.pids_scanned, scan_stats.pids_listed, scan_stats.threads);
+    }
+    if (state) {
+        log_info("Incremental snapshot: %zu processes unchanged, %zu rescanned",
+                 scan_stats.pids_reused, scan_stats.pids_scanned);
+    }
     
-    for (size_t i = 0; i < process_list.count; i++) {
-        process_info_t *proc_info = &process_list.processes[i];
-        library_list_t lib_list = {0};
-        file_list_t file_list = {0};
-        
-        /* Check timeout - Requirement 3.5: Complete in under 5 seconds */
-        current_time = time(NULL);
-        if (difftime(current_time, start_time) >= 5.0) {
-            log_warn("Snapshot timeout reached (5 seconds), stopping scan");
-            break;
-        }
-        
-        /* Initialize lists */
-        library_list_init(&lib_list);
-        file_list_init(&file_list);
-        
-        /* Requirement 3.2: Get loaded crypto libraries */
-        proc_scanner_get_loaded_libraries(scanner, proc_info->pid, &lib_list);
-        
-        /* Requirement 3.3: Get open crypto files */
-        proc_scanner_get_open_files(scanner, proc_info->pid, &file_list);
-        
-        /* Only include processes that have crypto libraries or files */
-        if (lib_list.count > 0 || file_list.count > 0) {
-            size_t proc_idx = snapshot.process_count;
-            
-            /* Fill process information */
-            snapshot.processes[proc_idx].pid = proc_info->pid;
-            snapshot.processes[proc_idx].name = strdup(proc_info->comm);
-            
-            /* Apply privacy filtering - Requirement 6.1, 6.2, 6.3 */
-            char *filtered_exe = privacy_filter_path(proc_info->exe, !args->no_redact);
-            snapshot.processes[proc_idx].exe = filtered_exe ? filtered_exe : strdup(proc_info->exe);
-            
-            /* Format running_as (UID) */
-            char running_as_buf[32];
-            snprintf(running_as_buf, sizeof(running_as_buf), "uid:%u", proc_info->uid);
-            snapshot.processes[proc_idx].running_as = strdup(running_as_buf);
-            
-            /* Copy libraries */
-            snapshot.processes[proc_idx].library_count = lib_list.count;
-            if (lib_list.count > 0) {
-                snapshot.processes[proc_idx].libraries = calloc(lib_list.count, sizeof(char *));
-                for (size_t j = 0; j < lib_list.count; j++) {
-                    char *filtered_lib = privacy_filter_path(lib_list.libraries[j].path, !args->no_redact);
-                    snapshot.processes[proc_idx].libraries[j] = filtered_lib ? filtered_lib : strdup(lib_list.libraries[j].path);
-                }
-                snapshot.summary.total_libraries += lib_list.count;
-            } else {
-                snapshot.processes[proc_idx].libraries = NULL;
-            }
-            
-            /* Copy open crypto files */
-            snapshot.processes[proc_idx].file_count = file_list.count;
-            if (file_list.count > 0) {
-                snapshot.processes[proc_idx].open_crypto_files = calloc(file_list.count, sizeof(char *));
-                for (size_t j = 0; j < file_list.count; j++) {
-                    char *filtered_file = privacy_filter_path(file_list.files[j].path, !args->no_redact);
-                    snapshot.processes[proc_idx].open_crypto_files[j] = filtered_file ? filtered_file : strdup(file_list.files[j].path);
-                }
-                snapshot.summary.total_files += file_list.count;
-            } else {
-                snapshot.processes[proc_idx].open_crypto_files = NULL;
-            }
-            
-            snapshot.process_count++;
-            snapshot.summary.total_processes++;
+    /* Requirement 3.4: Generate snapshot document */
+    log_info("Generating snapshot document...");
+    if (args->snapshot_diff) {
+        if (snapshot_state_diff(state, &added, &removed) != 0 ||
+            output_formatter_write_snapshot_diff(formatter, &snapshot, &added, &removed,
+                                                 snapshot_state_since(state)) != 0) {
+            log_error("Failed to write snapshot diff to output");
+            ret = EXIT_GENERAL_ERROR;
+            goto cleanup;
         }
-        
-        /* Cleanup lists */
-        library_list_free(&lib_list);
-        file_list_free(&file_list);
+    } else if (output_formatter_write_snapshot(formatter, &snapshot) != 0) {
+        log_error("Failed to write snapshot to output");
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
     }
     
-    /* Requirement 3.4: Generate snapshot document */
-    log_info("Generating snapshot document...");
-    if (output_formatter_write_snapshot(formatter, &snapshot) != 0) {
-        log_error("Failed to write snapshot to output");
+    /* Saved once the output is written, so a failed run is redone in full */
+    if (state && snapshot_state_save(state, args->state_file, snapshot.generated_at) != 0) {
         ret = EXIT_GENERAL_ERROR;
         goto cleanup;
     }
@@ -1518,6 +3774,16 @@ static int execute_snapshot_command(cli_args_t *args) {
     log_info("Found %d processes using cryptography", snapshot.summary.total_processes);
     log_info("Total libraries: %d, Total files: %d", 
              snapshot.summary.total_libraries, snapshot.summary.total_files);
+    if (scan_stats.bpf_iter) {
+        log_info("Scan phases: iterators %.1f ms, classify %.1f ms, merge %.1f ms",
+                 scan_stats.list_ns / 1e6, scan_stats.scan_ns / 1e6, scan_stats.merge_ns / 1e6);
+    } else {
+        log_info("Scan phases: list %.1f ms, scan %.1f ms, merge %.1f ms "
+                 "(maps %.1f ms, fds %.1f ms, process info %.1f ms across threads)",
+                 scan_stats.list_ns / 1e6, scan_stats.scan_ns / 1e6, scan_stats.merge_ns / 1e6,
+                 scan_stats.maps_ns / 1e6, scan_stats.fds_ns / 1e6, scan_stats.info_ns / 1e6);
+    }
+    log_debug("Snapshot strings: %zu bytes", scan_stats.arena_bytes);
     
     ret = EXIT_SUCCESS;
     
@@ -1525,31 +3791,10 @@ cleanup:
     log_debug("Cleaning up resources...");
     
     /* Free snapshot data */
-    if (snapshot.processes) {
-        for (size_t i = 0; i < snapshot.process_count; i++) {
-            free(snapshot.processes[i].name);
-            free(snapshot.processes[i].exe);
-            free(snapshot.processes[i].running_as);
-            
-            if (snapshot.processes[i].libraries) {
-                for (size_t j = 0; j < snapshot.processes[i].library_count; j++) {
-                    free(snapshot.processes[i].libraries[j]);
-                }
-                free(snapshot.processes[i].libraries);
-            }
-            
-            if (snapshot.processes[i].open_crypto_files) {
-                for (size_t j = 0; j < snapshot.processes[i].file_count; j++) {
-                    free(snapshot.processes[i].open_crypto_files[j]);
-                }
-                free(snapshot.processes[i].open_crypto_files);
-            }
-        }
-        free(snapshot.processes);
-    }
-    
-    /* Cleanup process list */
-    process_list_free(&process_list);
+    snapshot_free_processes(&added);
+    snapshot_free_processes(&removed);
+    snapshot_free_processes(&snapshot);
+    snapshot_state_destroy(state);
     
     /* Cleanup output formatter */
     if (formatter) {
@@ -1557,7 +3802,7 @@ cleanup:
     }
     
     /* Close output file if we opened it */
-    if (args->output_file && output_file && output_file != stdout) {
+    if (output_file && output_file != stdout) {
         fclose(output_file);
     }
     
@@ -1587,6 +3832,7 @@ typedef struct {
  */
 static int libs_event_callback(processed_event_t *event, void *ctx) {
     libs_ctx_t *lctx = (libs_ctx_t *)ctx;
+    filter_verdict_t verdict;
     
     if (!event || !lctx) {
         return -1;
@@ -1595,43 +3841,45 @@ static int libs_event_callback(processed_event_t *event, void *ctx) {
     lctx->events_processed++;
     
     /* Requirement 4.1: Only process lib_load events */
-    if (!event->event_type || strcmp(event->event_type, "lib_load") != 0) {
+    if (processed_event_kind(event) != EVENT_LIB_LOAD) {
         lctx->events_filtered++;
         return 0;  /* Not a library load event, filter it out */
     }
     
-    /* Enrich event with process metadata */
-    enrich_event(event);
+    /* Requirement 4.2: Apply library name filter if specified
+     * Checked on the decoded record, before any /proc read */
+    verdict = event_processor_prefilter(lctx->processor, event);
+    if (verdict == FILTER_REJECT) {
+        lctx->events_filtered++;
+        return 0;  /* Event filtered out */
+    }
     
     /* Extract library name */
     if (event->library) {
-        event->library_name = extract_library_name(event->library);
+        set_library_name(event);
         
         /* Filter: Only keep crypto libraries (filtering moved from eBPF to user-space) */
         if (!event->library_name || 
-            (strstr(event->library, "libssl") == NULL &&
-             strstr(event->library, "libcrypto") == NULL &&
-             strstr(event->library, "libgnutls") == NULL &&
-             strstr(event->library, "libsodium") == NULL &&
-             strstr(event->library, "libnss3") == NULL &&
-             strstr(event->library, "libmbedtls") == NULL)) {
+            !crypto_classifier_is_library(crypto_classifier_default(), event->library)) {
             lctx->events_filtered++;
             return 0;  /* Not a crypto library, filter it out */
         }
     }
     
-    /* Apply privacy filtering */
-    apply_privacy_filter(event, lctx->processor->redact_paths);
+    /* Enrich event with process metadata */
+    event_processor_enrich(lctx->processor, event);
     
-    /* Requirement 4.2: Apply library name filter if specified */
-    if (!event_processor_matches_filters(lctx->processor, event)) {
+    if (verdict == FILTER_UNDECIDED && !event_processor_matches_filters(lctx->processor, event)) {
         lctx->events_filtered++;
         return 0;  /* Event filtered out */
     }
     
+    /* Apply privacy filtering */
+    apply_privacy_filter(event, lctx->processor->redact_paths);
+    
     /* Requirement 4.4: Write event to output as JSON */
     if (output_formatter_write_event(lctx->formatter, event) != 0) {
-        log_warn("Failed to write event to output");
+        log_warn_ratelimited("Failed to write event to output");
         return -1;
     }
     
@@ -1706,6 +3954,18 @@ static int execute_libs_command(cli_args_t *args) {
     }
     log_debug("Output formatter created");
     
+    /* Size the ring buffers before the maps are created */
+    if (configure_ringbuf(mgr, args) != 0) {
+        ret = EXIT_ARGUMENT_ERROR;
+        goto cleanup;
+    }
+    configure_sources(mgr, args);
+    configure_coalescing(mgr, args);
+    if (configure_daemon_client(mgr, args) != 0) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
     /* Load eBPF programs */
     log_debug("Loading eBPF programs...");
     ret = ebpf_manager_load_programs(mgr);
@@ -1716,6 +3976,9 @@ static int execute_libs_command(cli_args_t *args) {
     }
     log_info("eBPF programs loaded successfully");
     
+    configure_kernel_filter(mgr, processor, args->pid, args->process_name, false);
+    configure_rate_limits(mgr, args);
+    
     /* Attach eBPF programs */
     log_debug("Attaching eBPF programs...");
     ret = ebpf_manager_attach_programs(mgr);
@@ -1734,6 +3997,7 @@ static int execute_libs_command(cli_args_t *args) {
     /* Setup libs event callback context */
     libs_ctx.processor = processor;
     libs_ctx.formatter = formatter;
+    configure_batched_output(mgr, formatter);
     libs_ctx.events_processed = 0;
     libs_ctx.events_filtered = 0;
     
@@ -1762,22 +4026,15 @@ static int execute_libs_command(cli_args_t *args) {
     }
     
     /* Process remaining events */
-    if (is_shutdown_requested()) {
-        log_debug("Shutdown requested, processing remaining events...");
-        time_t shutdown_start = time(NULL);
-        while (difftime(time(NULL), shutdown_start) < 1.0) {
-            ret = ebpf_manager_poll_events(mgr, libs_event_callback, &libs_ctx);
-            if (ret < 0 && ret != -EINTR) {
-                break;
-            }
-            if (ret == 0) {
-                break;
-            }
-        }
-    }
+    drain_remaining_events(mgr, args, libs_event_callback, &libs_ctx);
+    
+    /* Report the last partial coalescing window */
+    ebpf_manager_flush_coalesced(mgr);
     
     /* Get final statistics */
     ebpf_manager_get_stats(mgr, &events_processed_total, &events_dropped_total);
+    log_source_stats(mgr);
+    log_cache_stats(processor);
     
     /* Log statistics */
     log_info("Library monitoring complete");
@@ -1793,6 +4050,7 @@ cleanup:
     /* Cleanup eBPF manager */
     if (mgr) {
         ebpf_manager_cleanup(mgr);
+        log_shutdown_stats(mgr);
         ebpf_manager_destroy(mgr);
     }
     
@@ -1802,7 +4060,7 @@ cleanup:
     }
     
     /* Close output file if we opened it */
-    if (args->output_file && output_file && output_file != stdout) {
+    if (output_file && output_file != stdout) {
         fclose(output_file);
     }
     
@@ -1832,6 +4090,7 @@ typedef struct {
  */
 static int files_event_callback(processed_event_t *event, void *ctx) {
     files_ctx_t *fctx = (files_ctx_t *)ctx;
+    filter_verdict_t verdict;
     
     if (!event || !fctx) {
         return -1;
@@ -1840,13 +4099,18 @@ static int files_event_callback(processed_event_t *event, void *ctx) {
     fctx->events_processed++;
     
     /* Requirement 5.1: Only process file_open events */
-    if (!event->event_type || strcmp(event->event_type, "file_open") != 0) {
+    if (processed_event_kind(event) != EVENT_FILE_OPEN) {
         fctx->events_filtered++;
         return 0;  /* Not a file open event, filter it out */
     }
     
-    /* Enrich event with process metadata */
-    enrich_event(event);
+    /* Requirement 5.3, 5.5: Apply file path filter with glob pattern support
+     * Matched against the path as opened, before any /proc read */
+    verdict = event_processor_prefilter(fctx->processor, event);
+    if (verdict == FILTER_REJECT) {
+        fctx->events_filtered++;
+        return 0;  /* Event filtered out */
+    }
     
     /* Requirement 5.4: Classify file type */
     if (event->file) {
@@ -1859,18 +4123,20 @@ static int files_event_callback(processed_event_t *event, void *ctx) {
         }
     }
     
-    /* Apply privacy filtering */
-    apply_privacy_filter(event, fctx->processor->redact_paths);
+    /* Enrich event with process metadata */
+    event_processor_enrich(fctx->processor, event);
     
-    /* Requirement 5.3, 5.5: Apply file path filter with glob pattern support */
-    if (!event_processor_matches_filters(fctx->processor, event)) {
+    if (verdict == FILTER_UNDECIDED && !event_processor_matches_filters(fctx->processor, event)) {
         fctx->events_filtered++;
         return 0;  /* Event filtered out */
     }
     
+    /* Apply privacy filtering */
+    apply_privacy_filter(event, fctx->processor->redact_paths);
+    
     /* Requirement 5.2: Write event to output as JSON with file path, access mode, and process info */
     if (output_formatter_write_event(fctx->formatter, event) != 0) {
-        log_warn("Failed to write event to output");
+        log_warn_ratelimited("Failed to write event to output");
         return -1;
     }
     
@@ -1945,6 +4211,18 @@ static int execute_files_command(cli_args_t *args) {
     }
     log_debug("Output formatter created");
     
+    /* Size the ring buffers before the maps are created */
+    if (configure_ringbuf(mgr, args) != 0) {
+        ret = EXIT_ARGUMENT_ERROR;
+        goto cleanup;
+    }
+    configure_sources(mgr, args);
+    configure_coalescing(mgr, args);
+    if (configure_daemon_client(mgr, args) != 0) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
     /* Load eBPF programs */
     log_debug("Loading eBPF programs...");
     ret = ebpf_manager_load_programs(mgr);
@@ -1955,6 +4233,9 @@ static int execute_files_command(cli_args_t *args) {
     }
     log_info("eBPF programs loaded successfully");
     
+    configure_kernel_filter(mgr, processor, args->pid, args->process_name, false);
+    configure_rate_limits(mgr, args);
+    
     /* Attach eBPF programs */
     log_debug("Attaching eBPF programs...");
     ret = ebpf_manager_attach_programs(mgr);
@@ -1973,6 +4254,7 @@ static int execute_files_command(cli_args_t *args) {
     /* Setup files event callback context */
     files_ctx.processor = processor;
     files_ctx.formatter = formatter;
+    configure_batched_output(mgr, formatter);
     files_ctx.events_processed = 0;
     files_ctx.events_filtered = 0;
     
@@ -2001,22 +4283,15 @@ static int execute_files_command(cli_args_t *args) {
     }
     
     /* Process remaining events */
-    if (is_shutdown_requested()) {
-        log_debug("Shutdown requested, processing remaining events...");
-        time_t shutdown_start = time(NULL);
-        while (difftime(time(NULL), shutdown_start) < 1.0) {
-            ret = ebpf_manager_poll_events(mgr, files_event_callback, &files_ctx);
-            if (ret < 0 && ret != -EINTR) {
-                break;
-            }
-            if (ret == 0) {
-                break;
-            }
-        }
-    }
+    drain_remaining_events(mgr, args, files_event_callback, &files_ctx);
+    
+    /* Report the last partial coalescing window */
+    ebpf_manager_flush_coalesced(mgr);
     
     /* Get final statistics */
     ebpf_manager_get_stats(mgr, &events_processed_total, &events_dropped_total);
+    log_source_stats(mgr);
+    log_cache_stats(processor);
     
     /* Log statistics */
     log_info("File monitoring complete");
@@ -2032,6 +4307,7 @@ cleanup:
     /* Cleanup eBPF manager */
     if (mgr) {
         ebpf_manager_cleanup(mgr);
+        log_shutdown_stats(mgr);
         ebpf_manager_destroy(mgr);
     }
     
@@ -2041,7 +4317,7 @@ cleanup:
     }
     
     /* Close output file if we opened it */
-    if (args->output_file && output_file && output_file != stdout) {
+    if (output_file && output_file != stdout) {
         fclose(output_file);
     }
     
@@ -2055,6 +4331,308 @@ cleanup:
     return ret;
 }
 
+/**
+ * Execute decode command
+ * Converts a binary capture back to the JSON the capture would have
+ * produced with a JSON format
+ */
+static int execute_decode_command(cli_args_t *args) {
+    binary_decoder_t *decoder = NULL;
+    output_formatter_t *formatter = NULL;
+    FILE *input_file = stdin;
+    FILE *output_file = stdout;
+    processed_event_t event;
+    uint64_t events_decoded = 0;
+    int ret = EXIT_SUCCESS;
+    int status;
+    
+    if (args->input_file) {
+        input_file = fopen(args->input_file, "rb");
+        if (!input_file) {
+            log_error("Failed to open input file: %s", args->input_file);
+            log_system_error("fopen");
+            return EXIT_GENERAL_ERROR;
+        }
+    }
+    
+    decoder = binary_decoder_create(input_file);
+    if (!decoder) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
+    if (args->output_file) {
+        output_file = fopen(args->output_file, "w");
+        if (!output_file) {
+            log_error("Failed to open output file: %s", args->output_file);
+            log_system_error("fopen");
+            ret = EXIT_GENERAL_ERROR;
+            goto cleanup;
+        }
+    }
+    
+    formatter = output_formatter_create(args->format, output_file);
+    if (!formatter) {
+        log_error("Failed to create output formatter");
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    output_formatter_set_batching(formatter, true);
+    
+    while ((status = binary_decoder_next(decoder, &event)) > 0) {
+        if (output_formatter_write_event(formatter, &event) != 0) {
+            log_error("Failed to write event to output");
+            ret = EXIT_GENERAL_ERROR;
+            break;
+        }
+        events_decoded++;
+    }
+    if (status < 0) {
+        ret = EXIT_GENERAL_ERROR;
+    }
+    
+    log_debug("Decoded %llu events", (unsigned long long)events_decoded);
+    
+cleanup:
+    output_formatter_destroy(formatter);
+    binary_decoder_destroy(decoder);
+    if (output_file && output_file != stdout) {
+        fclose(output_file);
+    }
+    if (input_file != stdin) {
+        fclose(input_file);
+    }
+    return ret;
+}
+
+/**
+ * Execute replay command
+ * Runs a raw capture through the monitor pipeline on this thread:
+ * decoding, filters, enrichment from the recorded /proc reads and
+ * output, as fast as they go, so pipeline changes can be measured and
+ * regression-tested without BPF or root
+ */
+static int execute_replay_command(cli_args_t *args) {
+    struct ebpf_manager *mgr = NULL;
+    event_processor_t *processor = NULL;
+    output_formatter_t *formatter = NULL;
+    FILE *output_file = stdout;
+    event_loop_ctx_t loop_ctx = {0};
+    raw_reader_t *reader;
+    uint64_t start_ns;
+    int ret = EXIT_SUCCESS;
+    int replayed;
+    
+    reader = raw_reader_open(args->input_file);
+    if (!reader) {
+        return EXIT_GENERAL_ERROR;
+    }
+    
+    /* Timestamps convert as they did while recording */
+    timestamp_pin_offset(raw_reader_boot_offset(reader));
+    
+    mgr = ebpf_manager_create();
+    processor = event_processor_create(args);
+    if (!mgr || !processor) {
+        log_error("Failed to initialize the event pipeline");
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    proc_cache_set_loader(processor->cache, replay_proc_read, reader);
+    
+    if (args->output_file) {
+        output_file = fopen(args->output_file, "w");
+        if (!output_file) {
+            log_error("Failed to open output file: %s", args->output_file);
+            log_system_error("fopen");
+            ret = EXIT_GENERAL_ERROR;
+            goto cleanup;
+        }
+    }
+    
+    formatter = output_formatter_create(args->format, output_file);
+    if (!formatter) {
+        log_error("Failed to create output formatter");
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    configure_batched_output(mgr, formatter);
+    
+    loop_ctx.processor = processor;
+    loop_ctx.formatter = formatter;
+    
+    /* Replay is how stage costs are compared between builds */
+    if (args->stats_file) {
+        pipeline_stats_enable();
+    }
+    
+    start_ns = timestamp_boot_ns();
+    replayed = ebpf_manager_replay(mgr, reader, event_callback, &loop_ctx);
+    if (replayed < 0) {
+        log_error("Failed to replay %s", args->input_file);
+        ret = EXIT_GENERAL_ERROR;
+    }
+    
+    log_source_stats(mgr);
+    log_cache_stats(processor);
+    if (args->stats_file) {
+        write_stats_file(args->stats_file, mgr, &loop_ctx, timestamp_boot_ns() - start_ns,
+                         NULL, NULL);
+    }
+    
+    log_info("Replay complete");
+    log_info("Records replayed: %d", replayed > 0 ? replayed : 0);
+    log_info("Events filtered: %lu", loop_ctx.events_filtered);
+    
+cleanup:
+    output_formatter_destroy(formatter);
+    if (output_file && output_file != stdout) {
+        fclose(output_file);
+    }
+    event_processor_destroy(processor);
+    ebpf_manager_destroy(mgr);
+    raw_reader_close(reader);
+    return ret;
+}
+
+/**
+ * Event callback of the daemon: prepare the event once for every client
+ */
+static int daemon_event_callback(processed_event_t *event, void *ctx) {
+    daemon_loop_ctx_t *daemon_ctx = (daemon_loop_ctx_t *)ctx;
+    
+    if (!event || !daemon_ctx) {
+        return -1;
+    }
+    
+    /* Nobody is listening: skip the classification and /proc reads */
+    if (daemon_server_client_count(daemon_ctx->server) == 0) {
+        return 0;
+    }
+    
+    if (prepare_event(event, &daemon_ctx->loop_ctx)) {
+        daemon_server_publish(daemon_ctx->server, event);
+    }
+    
+    return 0;
+}
+
+/**
+ * Execute daemon command
+ * Attaches every program once, with no process filter, and serves the
+ * events to the clients connected on the daemon socket. The maps and
+ * programs are pinned under --pin-dir while it runs, so they show up in
+ * bpftool under a stable name; the pins are removed on exit.
+ */
+static int execute_daemon_command(cli_args_t *args) {
+    struct ebpf_manager *mgr = NULL;
+    event_processor_t *processor = NULL;
+    daemon_loop_ctx_t daemon_ctx = {0};
+    live_metrics_t live = {0};
+    cli_args_t processor_args = *args;
+    const char *socket_path = args->daemon_socket ? args->daemon_socket : DAEMON_DEFAULT_SOCKET;
+    const char *pin_dir = args->pin_dir ? args->pin_dir : DAEMON_DEFAULT_PIN_DIR;
+    time_t start_time;
+    int ret = EXIT_SUCCESS;
+    
+    log_info("Starting daemon command");
+    
+    mgr = ebpf_manager_create();
+    if (!mgr) {
+        log_error("Failed to create eBPF manager");
+        return EXIT_BPF_ERROR;
+    }
+    
+    /* Clients filter and redact for themselves */
+    processor_args.pid = 0;
+    processor_args.process_name = NULL;
+    processor_args.library_filter = NULL;
+    processor_args.file_filter = NULL;
+    processor_args.no_redact = true;
+    processor = event_processor_create(&processor_args);
+    if (!processor) {
+        log_error("Failed to create event processor");
+        ebpf_manager_destroy(mgr);
+        return EXIT_GENERAL_ERROR;
+    }
+    
+    if (configure_ringbuf(mgr, args) != 0) {
+        ret = EXIT_ARGUMENT_ERROR;
+        goto cleanup;
+    }
+    configure_coalescing(mgr, args);
+    
+    log_debug("Loading eBPF programs...");
+    if (ebpf_manager_load_programs(mgr) != 0) {
+        log_error("Failed to load eBPF programs");
+        ret = EXIT_BPF_ERROR;
+        goto cleanup;
+    }
+    configure_rate_limits(mgr, args);
+    
+    log_debug("Attaching eBPF programs...");
+    if (ebpf_manager_attach_programs(mgr) != 0) {
+        log_error("Failed to attach eBPF programs");
+        ret = EXIT_BPF_ERROR;
+        goto cleanup;
+    }
+    log_info("eBPF programs attached successfully");
+    
+    /* Pins only name the probes; serving clients does not need them */
+    if (ebpf_manager_pin(mgr, pin_dir) != 0) {
+        log_warn("Failed to pin maps and programs under %s", pin_dir);
+    }
+    
+    daemon_ctx.loop_ctx.processor = processor;
+    daemon_ctx.server = daemon_server_start(socket_path);
+    if (!daemon_ctx.server) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
+    if (start_live_metrics(&live, mgr, args) != 0) {
+        ret = EXIT_GENERAL_ERROR;
+        goto cleanup;
+    }
+    
+    log_info("crypto-tracer daemon serving clients on %s", socket_path);
+    start_time = time(NULL);
+    
+    while (!is_shutdown_requested()) {
+        ret = ebpf_manager_poll_events(mgr, daemon_event_callback, &daemon_ctx);
+        if (ret < 0 && ret != -EINTR) {
+            log_error("Error polling events: %d", ret);
+            break;
+        }
+        
+        /* One send per client per drain; also notices closed clients */
+        daemon_server_flush(daemon_ctx.server);
+        update_live_metrics(&live, mgr, &daemon_ctx.loop_ctx);
+        
+        if (args->duration > 0 && difftime(time(NULL), start_time) >= args->duration) {
+            log_debug("Duration limit reached (%d seconds)", args->duration);
+            break;
+        }
+    }
+    
+    log_source_stats(mgr);
+    log_cache_stats(processor);
+    log_info("Daemon stopped");
+    log_info("Events processed: %lu", daemon_ctx.loop_ctx.events_processed);
+    ret = EXIT_SUCCESS;
+    
+cleanup:
+    stop_live_metrics(&live);
+    daemon_server_stop(daemon_ctx.server);
+    
+    /* Also removes the pins */
+    ebpf_manager_cleanup(mgr);
+    log_shutdown_stats(mgr);
+    ebpf_manager_destroy(mgr);
+    event_processor_destroy(processor);
+    return ret;
+}
+
 /**
  * Dispatch to appropriate command handler
  * Requirements: 16.1, 16.2, 16.3, 16.4, 16.5
@@ -2067,19 +4645,28 @@ static int dispatch_command(cli_args_t *args) {
     switch (args->command) {
         case CMD_MONITOR:
             return execute_monitor_command(args);
-            
+        
         case CMD_PROFILE:
             return execute_profile_command(args);
-            
+        
         case CMD_SNAPSHOT:
             return execute_snapshot_command(args);
-            
+        
         case CMD_LIBS:
             return execute_libs_command(args);
-            
+        
         case CMD_FILES:
             return execute_files_command(args);
-            
+        
+        case CMD_DECODE:
+            return execute_decode_command(args);
+        
+        case CMD_REPLAY:
+            return execute_replay_command(args);
+        
+        case CMD_DAEMON:
+            return execute_daemon_command(args);
+        
         default:
             log_error("Unknown command: %d", args->command);
             return EXIT_GENERAL_ERROR;
@@ -2109,19 +4696,33 @@ int main(int argc, char **argv) {
     logger_config.quiet = args.quiet;
     logger_config.verbose = args.verbose;
     logger_config.output = stderr;
+    logger_config.format = args.log_json ? LOG_FORMAT_JSON : LOG_FORMAT_TEXT;
     logger_init(&logger_config);
     
     log_debug("crypto-tracer v%s starting", CRYPTO_TRACER_VERSION);
+    
+    /* Compile custom classification rules before anything classifies */
+    if (args.rules_file) {
+        crypto_classifier_t *classifier = crypto_classifier_load(args.rules_file);
+        if (!classifier) {
+            return EXIT_ARGUMENT_ERROR;
+        }
+        crypto_classifier_set_default(classifier);
+    }
     log_debug("Command: %s", 
               args.command == CMD_MONITOR ? "monitor" :
               args.command == CMD_PROFILE ? "profile" :
               args.command == CMD_SNAPSHOT ? "snapshot" :
               args.command == CMD_LIBS ? "libs" :
-              args.command == CMD_FILES ? "files" : "unknown");
+              args.command == CMD_FILES ? "files" :
+              args.command == CMD_DECODE ? "decode" :
+              args.command == CMD_REPLAY ? "replay" :
+              args.command == CMD_DAEMON ? "daemon" : "unknown");
     
-    /* Validate privileges (not required for snapshot command) */
+    /* Validate privileges (not required for snapshot, decode, replay and daemon clients) */
     /* Requirement 3.6: Snapshot works without eBPF (using /proc only) */
-    if (args.command != CMD_SNAPSHOT) {
+    if (args.command != CMD_SNAPSHOT && args.command != CMD_DECODE &&
+        args.command != CMD_REPLAY && !args.use_daemon) {
         log_debug("Validating privileges...");
         ret = validate_privileges();
         if (ret != EXIT_SUCCESS) {
@@ -2137,7 +4738,10 @@ int main(int argc, char **argv) {
         }
         log_debug("Kernel compatibility check passed");
     } else {
-        log_debug("Snapshot command - skipping privilege and kernel checks (uses /proc only)");
+        log_debug("%s command - skipping privilege and kernel checks",
+                  args.command == CMD_SNAPSHOT ? "Snapshot" :
+                  args.use_daemon ? "Daemon client" :
+                  args.command == CMD_DECODE ? "Decode" : "Replay");
     }
     
     /* Setup signal handlers for graceful shutdown */
@@ -2165,8 +4769,12 @@ int main(int argc, char **argv) {
         }
     }
     
+    /* From here on log calls from the event loop only queue their message */
+    logger_start_async();
+    
     /* Dispatch to command handlers */
     ret = dispatch_command(&args);
     
+    logger_shutdown();
     return ret;
 }
\ No newline at end of file
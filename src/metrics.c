@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * metrics.c - Live run metrics: Prometheus text and JSON stats lines
+ * The server thread never touches the manager: it hands out a copy of
+ * the text last published by the polling thread, under a mutex held
+ * only for the swap and the copy.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "include/metrics.h"
+#include "include/pipeline_stats.h"
+#include "include/timestamp.h"
+#include "include/logger.h"
+
+/* How long a client gets to send its request before plain text is sent */
+#define REQUEST_TIMEOUT_MS 100
+
+/* How long a send may wait for a client that does not read, before the
+ * response is abandoned */
+#define RESPONSE_TIMEOUT_MS 1000
+
+#define PROMETHEUS_CONTENT_TYPE "text/plain; version=0.0.4"
+
+struct metrics_server {
+    char *path;
+    int listen_fd;
+    int stop_pipe[2];
+    pthread_t thread;
+    pthread_mutex_t lock;
+    char *text;                    /* Protected by lock */
+    size_t len;
+};
+
+/* User-space drops: the manager's total less the kernel's full ring buffers */
+static uint64_t user_dropped(struct ebpf_manager *mgr) {
+    ebpf_source_stats_t stats;
+    uint64_t processed = 0, dropped = 0;
+    
+    ebpf_manager_get_stats(mgr, &processed, &dropped);
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        if (ebpf_manager_get_source_stats(mgr, (ebpf_source_t)source, &stats) == 0) {
+            dropped -= dropped >= stats.ringbuf_full ? stats.ringbuf_full : dropped;
+        }
+    }
+    return dropped;
+}
+
+static void prometheus_header(FILE *fp, const char *name, const char *type, const char *help) {
+    fprintf(fp, "# HELP crypto_tracer_%s %s\n# TYPE crypto_tracer_%s %s\n", name, help, name, type);
+}
+
+/* One per-source metric family, over the attached sources */
+#define PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, name, type, help, expr) \
+    do { \
+        prometheus_header((fp), (name), (type), (help)); \
+        for (int s_ = 0; s_ < EBPF_SOURCE_COUNT; s_++) { \
+            const ebpf_source_stats_t *src_ = &(stats)[s_]; \
+            if (!(attached)[s_]) { \
+                continue; \
+            } \
+            fprintf((fp), "crypto_tracer_%s{source=\"%s\"} %.17g\n", (name), \
+                    ebpf_source_name((ebpf_source_t)s_), (double)(expr)); \
+        } \
+    } while (0)
+
+/**
+ * Render the metrics in the Prometheus text exposition format
+ */
+int metrics_render_prometheus(struct ebpf_manager *mgr, const metrics_counters_t *counters,
+                              char **text, size_t *len) {
+    ebpf_source_stats_t stats[EBPF_SOURCE_COUNT];
+    bool attached[EBPF_SOURCE_COUNT];
+    ebpf_consumer_stats_t consumer = {0};
+    stage_snapshot_t stages[STAGE_COUNT];
+    FILE *fp;
+    
+    if (!mgr || !counters || !text || !len) {
+        return -1;
+    }
+    
+    fp = open_memstream(text, len);
+    if (!fp) {
+        return -1;
+    }
+    
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        attached[source] = ebpf_manager_get_source_stats(mgr, (ebpf_source_t)source,
+                                                         &stats[source]) == 0 &&
+                           stats[source].attached;
+    }
+    ebpf_manager_get_consumer_stats(mgr, &consumer);
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        pipeline_stats_snapshot((pipeline_stage_t)stage, &stages[stage]);
+    }
+    
+    prometheus_header(fp, "uptime_seconds", "gauge", "Time since monitoring started");
+    fprintf(fp, "crypto_tracer_uptime_seconds %.3f\n", (double)counters->uptime_ns / 1e9);
+    
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "events_received_total", "counter",
+                             "Records consumed from the source ring buffer", src_->events_received);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "events_kernel_filtered_total", "counter",
+                             "Events dropped by in-kernel filters", src_->kernel_filtered);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "events_ringbuf_full_total", "counter",
+                             "Events lost in the kernel to a full ring buffer", src_->ringbuf_full);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "events_coalesced_total", "counter",
+                             "Repeats counted in the kernel instead of submitted", src_->coalesced);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "events_sampled_out_total", "counter",
+                             "Events skipped by 1-in-N sampling", src_->sampled_out);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "events_rate_limited_total", "counter",
+                             "Events over the source's rate limit", src_->rate_limited);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "bpf_prog_runs_total", "counter",
+                             "Runs of the source's BPF programs (kernel BPF stats)",
+                             src_->prog_run_count);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "bpf_prog_run_seconds_total", "counter",
+                             "Run time of the source's BPF programs (kernel BPF stats)",
+                             (double)src_->prog_run_ns / 1e9);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "ringbuf_size_bytes", "gauge",
+                             "Size of the source ring buffer", src_->ringbuf_size);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "ringbuf_pending_bytes", "gauge",
+                             "Bytes waiting in the ring buffer at the last drain",
+                             src_->ringbuf_pending);
+    PROMETHEUS_SOURCE_FAMILY(fp, stats, attached, "ringbuf_pending_max_bytes", "gauge",
+                             "Most bytes waiting in the ring buffer at any drain",
+                             src_->ringbuf_pending_max);
+    
+    prometheus_header(fp, "events_processed_total", "counter", "Events handed to the event callback");
+    fprintf(fp, "crypto_tracer_events_processed_total %lu\n", counters->events_processed);
+    prometheus_header(fp, "events_filtered_total", "counter", "Events filtered in user space");
+    fprintf(fp, "crypto_tracer_events_filtered_total %lu\n", counters->events_filtered);
+    prometheus_header(fp, "events_user_dropped_total", "counter",
+                      "Events lost in user space to an exhausted event pool or queue");
+    fprintf(fp, "crypto_tracer_events_user_dropped_total %lu\n", user_dropped(mgr));
+    prometheus_header(fp, "event_pool_in_flight_max", "gauge", "Most events in flight at once");
+    fprintf(fp, "crypto_tracer_event_pool_in_flight_max %lu\n", consumer.pool_high_water);
+    
+    prometheus_header(fp, "event_latency_seconds", "gauge",
+                      "Kernel timestamp to event completion, bucket upper bound");
+    fprintf(fp, "crypto_tracer_event_latency_seconds{quantile=\"0.5\"} %.9f\n",
+            (double)consumer.latency_p50_ns / 1e9);
+    fprintf(fp, "crypto_tracer_event_latency_seconds{quantile=\"0.99\"} %.9f\n",
+            (double)consumer.latency_p99_ns / 1e9);
+    fprintf(fp, "crypto_tracer_event_latency_seconds{quantile=\"1\"} %.9f\n",
+            (double)consumer.latency_max_ns / 1e9);
+    
+    prometheus_header(fp, "stage_duration_seconds", "summary",
+                      "Time spent per pipeline stage, bucket upper bound");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const stage_snapshot_t *snap = &stages[stage];
+        const char *name = pipeline_stage_name((pipeline_stage_t)stage);
+        
+        fprintf(fp, "crypto_tracer_stage_duration_seconds{stage=\"%s\",quantile=\"0.5\"} %.9f\n",
+                name, (double)snap->p50_ns / 1e9);
+        fprintf(fp, "crypto_tracer_stage_duration_seconds{stage=\"%s\",quantile=\"0.9\"} %.9f\n",
+                name, (double)snap->p90_ns / 1e9);
+        fprintf(fp, "crypto_tracer_stage_duration_seconds{stage=\"%s\",quantile=\"0.99\"} %.9f\n",
+                name, (double)snap->p99_ns / 1e9);
+        fprintf(fp, "crypto_tracer_stage_duration_seconds{stage=\"%s\",quantile=\"0.999\"} %.9f\n",
+                name, (double)snap->p999_ns / 1e9);
+        fprintf(fp, "crypto_tracer_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n",
+                name, (double)snap->sum_ns / 1e9);
+        fprintf(fp, "crypto_tracer_stage_duration_seconds_count{stage=\"%s\"} %lu\n",
+                name, snap->count);
+    }
+    prometheus_header(fp, "stage_duration_max_seconds", "gauge", "Longest time spent in a stage");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        fprintf(fp, "crypto_tracer_stage_duration_max_seconds{stage=\"%s\"} %.9f\n",
+                pipeline_stage_name((pipeline_stage_t)stage), (double)stages[stage].max_ns / 1e9);
+    }
+    
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/**
+ * Write the stage histograms as "stages":{"<stage>":{...},...}
+ */
+void metrics_write_stages_json(FILE *fp) {
+    fputs("\"stages\":{", fp);
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        stage_snapshot_t snap;
+        
+        pipeline_stats_snapshot((pipeline_stage_t)stage, &snap);
+        fprintf(fp, "%s\"%s\":{\"count\":%lu,\"mean_ns\":%lu,\"p50_ns\":%lu,\"p90_ns\":%lu,"
+                "\"p99_ns\":%lu,\"p999_ns\":%lu,\"max_ns\":%lu}",
+                stage ? "," : "", pipeline_stage_name((pipeline_stage_t)stage), snap.count,
+                snap.count ? snap.sum_ns / snap.count : 0, snap.p50_ns, snap.p90_ns,
+                snap.p99_ns, snap.p999_ns, snap.max_ns);
+    }
+    fputc('}', fp);
+}
+
+/**
+ * Render the metrics as one JSON line (--stats-interval)
+ * Counters are totals since monitoring started.
+ */
+int metrics_render_json(struct ebpf_manager *mgr, const metrics_counters_t *counters,
+                        char **text, size_t *len) {
+    char timestamp[TIMESTAMP_ISO8601_LEN];
+    ebpf_source_stats_t stats;
+    ebpf_consumer_stats_t consumer = {0};
+    bool first = true;
+    FILE *fp;
+    
+    if (!mgr || !counters || !text || !len) {
+        return -1;
+    }
+    
+    fp = open_memstream(text, len);
+    if (!fp) {
+        return -1;
+    }
+    
+    ebpf_manager_get_consumer_stats(mgr, &consumer);
+    timestamp_format_iso8601(timestamp_now_ns(), timestamp, sizeof(timestamp));
+    
+    fprintf(fp, "{\"type\":\"stats\",\"timestamp\":\"%s\",\"uptime_ns\":%lu,"
+            "\"events_processed\":%lu,\"events_filtered\":%lu,\"user_dropped\":%lu,"
+            "\"pool_high_water\":%lu,\"latency_p50_ns\":%lu,\"latency_p99_ns\":%lu,\"sources\":{",
+            timestamp, counters->uptime_ns, counters->events_processed,
+            counters->events_filtered, user_dropped(mgr), consumer.pool_high_water,
+            consumer.latency_p50_ns, consumer.latency_p99_ns);
+    for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+        if (ebpf_manager_get_source_stats(mgr, (ebpf_source_t)source, &stats) != 0 ||
+            !stats.attached) {
+            continue;
+        }
+        fprintf(fp, "%s\"%s\":{\"events_received\":%lu,\"kernel_filtered\":%lu,"
+                "\"ringbuf_full\":%lu,\"ringbuf_pending\":%lu,\"ringbuf_pending_max\":%lu,"
+                "\"ringbuf_size\":%lu,\"prog_runs\":%lu,\"prog_run_ns\":%lu}",
+                first ? "" : ",", ebpf_source_name((ebpf_source_t)source),
+                stats.events_received, stats.kernel_filtered, stats.ringbuf_full,
+                stats.ringbuf_pending, stats.ringbuf_pending_max, stats.ringbuf_size,
+                stats.prog_run_count, stats.prog_run_ns);
+        first = false;
+    }
+    fputs("},", fp);
+    metrics_write_stages_json(fp);
+    fputs("}\n", fp);
+    
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* Write all of buf; the client may be gone, which must not raise SIGPIPE */
+static void send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+/**
+ * Serve one client: HTTP if it sends a GET, the bare text otherwise
+ */
+static void serve_client(metrics_server_t *server, int fd) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    struct timeval send_timeout = {
+        .tv_sec = RESPONSE_TIMEOUT_MS / 1000,
+        .tv_usec = (RESPONSE_TIMEOUT_MS % 1000) * 1000,
+    };
+    char request[512];
+    ssize_t n = 0;
+    char *text;
+    size_t len;
+    
+    /* A client that never reads must not stall the only metrics thread */
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout)) != 0) {
+        return;
+    }
+    
+    if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) > 0) {
+        n = recv(fd, request, sizeof(request) - 1, 0);
+    }
+    
+    pthread_mutex_lock(&server->lock);
+    len = server->len;
+    text = len ? malloc(len) : NULL;
+    if (text) {
+        memcpy(text, server->text, len);
+    } else {
+        len = 0;
+    }
+    pthread_mutex_unlock(&server->lock);
+    
+    if (n >= 4 && strncmp(request, "GET ", 4) == 0) {
+        char header[160];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 200 OK\r\nContent-Type: %s\r\n"
+                                  "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                                  PROMETHEUS_CONTENT_TYPE, len);
+        send_all(fd, header, (size_t)header_len);
+    }
+    send_all(fd, text ? text : "", len);
+    free(text);
+}
+
+static void *metrics_server_main(void *arg) {
+    metrics_server_t *server = arg;
+    struct pollfd fds[2] = {
+        { .fd = server->listen_fd, .events = POLLIN },
+        { .fd = server->stop_pipe[0], .events = POLLIN },
+    };
+    sigset_t mask;
+    
+    /* Leave SIGINT/SIGTERM to the capture thread */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    for (;;) {
+        int fd;
+        
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_warn("Metrics server stopped: %s", strerror(errno));
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        
+        fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        serve_client(server, fd);
+        close(fd);
+    }
+    
+    return NULL;
+}
+
+/**
+ * Create the metrics socket and start serving
+ *
+ * @return Server, or NULL on failure (logged)
+ */
+metrics_server_t *metrics_server_start(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    metrics_server_t *server;
+    struct stat st;
+    mode_t old_umask;
+    
+    if (!path || strlen(path) >= sizeof(addr.sun_path)) {
+        log_error("Invalid metrics socket path: %s", path ? path : "(null)");
+        return NULL;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    
+    /* Replace the socket of a previous run, but nothing else */
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            log_error("Metrics socket path exists and is not a socket: %s", path);
+            return NULL;
+        }
+        unlink(path);
+    }
+    
+    server = calloc(1, sizeof(*server));
+    if (!server) {
+        log_error("Failed to allocate metrics server");
+        return NULL;
+    }
+    server->listen_fd = -1;
+    server->stop_pipe[0] = server->stop_pipe[1] = -1;
+    pthread_mutex_init(&server->lock, NULL);
+    
+    server->path = strdup(path);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (!server->path || server->listen_fd < 0 || pipe2(server->stop_pipe, O_CLOEXEC) != 0) {
+        log_system_error("metrics socket");
+        goto fail;
+    }
+    
+    old_umask = umask(0177);
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        umask(old_umask);
+        log_error("Failed to bind metrics socket: %s", path);
+        log_system_error("bind");
+        goto fail;
+    }
+    umask(old_umask);
+    
+    if (listen(server->listen_fd, 8) != 0 ||
+        pthread_create(&server->thread, NULL, metrics_server_main, server) != 0) {
+        log_system_error("metrics server");
+        unlink(path);
+        goto fail;
+    }
+    
+    log_info("Serving metrics on %s", path);
+    return server;
+
+fail:
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->stop_pipe[0] >= 0) {
+        close(server->stop_pipe[0]);
+        close(server->stop_pipe[1]);
+    }
+    pthread_mutex_destroy(&server->lock);
+    free(server->path);
+    free(server);
+    return NULL;
+}
+
+void metrics_server_publish(metrics_server_t *server, char *text, size_t len) {
+    char *old;
+    
+    if (!server) {
+        free(text);
+        return;
+    }
+    
+    pthread_mutex_lock(&server->lock);
+    old = server->text;
+    server->text = text;
+    server->len = text ? len : 0;
+    pthread_mutex_unlock(&server->lock);
+    
+    free(old);
+}
+
+void metrics_server_stop(metrics_server_t *server) {
+    if (!server) {
+        return;
+    }
+    
+    if (write(server->stop_pipe[1], "", 1) < 0) {
+        log_debug("Failed to signal metrics server: %s", strerror(errno));
+    }
+    pthread_join(server->thread, NULL);
+    
+    close(server->listen_fd);
+    close(server->stop_pipe[0]);
+    close(server->stop_pipe[1]);
+    unlink(server->path);
+    
+    pthread_mutex_destroy(&server->lock);
+    free(server->path);
+    free(server->text);
+    free(server);
+}
@@ -11,11 +11,182 @@
 
 #define _POSIX_C_SOURCE 200809L
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include <sys/stat.h>
 #include "include/output_formatter.h"
 #include "include/event_processor.h"
+#include "include/path_intern.h"
+#include "include/binary_format.h"
+#include "include/timestamp.h"
+#include "include/pipeline_stats.h"
+#include "include/privacy_filter.h"
+#include "include/handshake_latency.h"
+
+/* Output buffer sizing: a pipe or socket gets its default capacity, files
+ * and terminals a multiple of their preferred I/O block size */
+#define OUTPUT_BUFFER_PIPE (64 * 1024)
+#define OUTPUT_BUFFER_MIN  (16 * 1024)
+#define OUTPUT_BUFFER_MAX  (1024 * 1024)
+#define OUTPUT_BUFFER_BLOCKS 16
+
+/**
+ * Choose the output buffer size for an output stream
+ */
+static size_t output_buffer_size(FILE *output) {
+    struct stat st;
+    size_t size;
+    int fd = fileno(output);
+    
+    if (fd < 0 || fstat(fd, &st) != 0 || S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode) ||
+        st.st_blksize <= 0) {
+        return OUTPUT_BUFFER_PIPE;
+    }
+    
+    size = (size_t)st.st_blksize * OUTPUT_BUFFER_BLOCKS;
+    if (size < OUTPUT_BUFFER_MIN) {
+        size = OUTPUT_BUFFER_MIN;
+    } else if (size > OUTPUT_BUFFER_MAX) {
+        size = OUTPUT_BUFFER_MAX;
+    }
+    return size;
+}
+
+/**
+ * Hand everything buffered so far to the output stream in one fwrite
+ * 
+ * @return 0 on success, -1 on write failure
+ */
+static int out_drain(output_formatter_t *fmt) {
+    size_t len = fmt->buf_len;
+    
+    fmt->buf_len = 0;
+    fmt->record_start = 0;
+    if (len > 0 && fwrite(fmt->buf, 1, len, fmt->output) != len) {
+        fmt->failed = true;
+    }
+    return fmt->failed ? -1 : 0;
+}
+
+/**
+ * Hand the complete events buffered so far to the output stream and
+ * keep the one being written (see output_formatter_set_whole_records)
+ * 
+ * @return 0 on success, -1 on write failure
+ */
+static int out_drain_complete(output_formatter_t *fmt) {
+    size_t len = fmt->record_start;
+    
+    if (len > 0 && fwrite(fmt->buf, 1, len, fmt->output) != len) {
+        fmt->failed = true;
+    }
+    memmove(fmt->buf, fmt->buf + len, fmt->buf_len - len);
+    fmt->buf_len -= len;
+    fmt->record_start = 0;
+    return fmt->failed ? -1 : 0;
+}
+
+/**
+ * Write the buffer out and flush the stream
+ * Reports (and clears) any error recorded since the last flush
+ */
+static int out_flush(output_formatter_t *fmt) {
+    uint64_t begin = stage_begin();
+    int ret = out_drain(fmt);
+    
+    if (fflush(fmt->output) != 0) {
+        ret = -1;
+    }
+    stage_end(STAGE_WRITE, begin);
+    fmt->failed = false;
+    return ret;
+}
+
+/**
+ * Make room for n more bytes, draining or growing the buffer
+ * 
+ * @return Write position for at least n bytes, or NULL on failure
+ */
+static char *out_reserve(output_formatter_t *fmt, size_t n) {
+    if (fmt->buf_len + n > fmt->buf_size) {
+        uint64_t begin = stage_begin();
+        
+        if (fmt->whole_records) {
+            out_drain_complete(fmt);
+        } else {
+            out_drain(fmt);
+        }
+        stage_end(STAGE_WRITE, begin);
+        if (fmt->buf_len + n > fmt->buf_size) {
+            /* A single field larger than the buffer (a huge cmdline) */
+            char *buf = realloc(fmt->buf, fmt->buf_len + n);
+            if (!buf) {
+                fmt->failed = true;
+                return NULL;
+            }
+            fmt->buf = buf;
+            fmt->buf_size = fmt->buf_len + n;
+        }
+    }
+    return fmt->buf + fmt->buf_len;
+}
+
+static void out_write(output_formatter_t *fmt, const char *data, size_t len) {
+    char *dst = out_reserve(fmt, len);
+    
+    if (dst) {
+        memcpy(dst, data, len);
+        fmt->buf_len += len;
+    }
+}
+
+static void out_str(output_formatter_t *fmt, const char *str) {
+    out_write(fmt, str, strlen(str));
+}
+
+static void out_char(output_formatter_t *fmt, char c) {
+    char *dst = out_reserve(fmt, 1);
+    
+    if (dst) {
+        *dst = c;
+        fmt->buf_len++;
+    }
+}
+
+static void out_uint(output_formatter_t *fmt, unsigned long long value) {
+    char digits[20];
+    size_t n = 0;
+    char *dst;
+    
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    
+    dst = out_reserve(fmt, n);
+    if (dst) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = digits[n - 1 - i];
+        }
+        fmt->buf_len += n;
+    }
+}
+
+static void out_int(output_formatter_t *fmt, long long value) {
+    if (value < 0) {
+        out_char(fmt, '-');
+        out_uint(fmt, 0ULL - (unsigned long long)value);
+    } else {
+        out_uint(fmt, (unsigned long long)value);
+    }
+}
+
+static void out_indent(output_formatter_t *fmt, int indent) {
+    for (int i = 0; i < indent; i++) {
+        out_write(fmt, "  ", 2);
+    }
+}
 
 /**
  * Create a new output formatter
@@ -37,6 +208,14 @@ output_formatter_t *output_formatter_create(output_format_t format, FILE *output
         return NULL;
     }
     
+    fmt->buf_size = output_buffer_size(output);
+    fmt->buf = malloc(fmt->buf_size);
+    if (!fmt->buf) {
+        fprintf(stderr, "Error: Failed to allocate output buffer\n");
+        free(fmt);
+        return NULL;
+    }
+    
     fmt->format = format;
     fmt->output = output;
     fmt->first_event = true;
@@ -44,10 +223,24 @@ output_formatter_t *output_formatter_create(output_format_t format, FILE *output
     
     /* For JSON array format, start the array */
     if (format == FORMAT_JSON_ARRAY) {
-        fprintf(output, "[\n");
+        out_write(fmt, "[\n", 2);
         fmt->array_started = true;
     }
     
+    /* Binary captures start with the file header */
+    if (format == FORMAT_BINARY) {
+        static const char header[BINARY_HEADER_SIZE] = { 'C', 'T', 'R', 'B', BINARY_VERSION };
+        
+        fmt->dictionary = path_intern_create();
+        if (!fmt->dictionary) {
+            fprintf(stderr, "Error: Failed to allocate binary string dictionary\n");
+            free(fmt->buf);
+            free(fmt);
+            return NULL;
+        }
+        out_write(fmt, header, sizeof(header));
+    }
+    
     return fmt;
 }
 
@@ -64,11 +257,11 @@ int output_formatter_finalize(output_formatter_t *fmt) {
     
     /* Close JSON array if it was started */
     if (fmt->format == FORMAT_JSON_ARRAY && fmt->array_started) {
-        fprintf(fmt->output, "\n]\n");
-        fflush(fmt->output);
+        out_write(fmt, "\n]\n", 3);
+        fmt->array_started = false;
     }
     
-    return 0;
+    return out_flush(fmt);
 }
 
 /**
@@ -85,6 +278,8 @@ void output_formatter_destroy(output_formatter_t *fmt) {
     /* Finalize output before destroying */
     output_formatter_finalize(fmt);
     
+    path_intern_destroy(fmt->dictionary);
+    free(fmt->buf);
     free(fmt);
 }
 
@@ -94,38 +289,124 @@ void output_formatter_destroy(output_formatter_t *fmt) {
  * 
  * Format: YYYY-MM-DDTHH:MM:SS.ssssssZ
  * 
- * @param timestamp_ns Timestamp in nanoseconds
+ * @param timestamp_ns Unix time in nanoseconds
  * @return Formatted timestamp string (caller must free), or NULL on failure
  */
 char *format_timestamp_iso8601(uint64_t timestamp_ns) {
-    struct tm tm_info;
-    time_t seconds;
-    uint64_t microseconds;
-    char buffer[64];
-    char *result = NULL;
-    
-    /* Convert nanoseconds to seconds and microseconds */
-    seconds = timestamp_ns / 1000000000ULL;
-    microseconds = (timestamp_ns % 1000000000ULL) / 1000ULL;
-    
-    /* Convert to UTC time */
-    if (gmtime_r(&seconds, &tm_info) == NULL) {
+    char buffer[ISO8601_TIMESTAMP_SIZE];
+    
+    if (!format_timestamp_iso8601_r(timestamp_ns, buffer, sizeof(buffer))) {
+        return NULL;
+    }
+    
+    return strdup(buffer);
+}
+
+/**
+ * Format timestamp as ISO 8601 into a caller-provided buffer
+ * Same format as format_timestamp_iso8601(), without allocating; the
+ * date and time up to the second are cached per thread (see timestamp.h)
+ * 
+ * @param timestamp_ns Unix time in nanoseconds
+ * @param buf Output buffer (ISO8601_TIMESTAMP_SIZE bytes is always enough)
+ * @param buf_size Size of buf
+ * @return buf on success, or NULL on failure
+ */
+char *format_timestamp_iso8601_r(uint64_t timestamp_ns, char *buf, size_t buf_size) {
+    return timestamp_format_iso8601(timestamp_ns, buf, buf_size);
+}
+
+/**
+ * Format an event's raw timestamp for output
+ * Returns NULL for events without a timestamp
+ */
+static const char *event_timestamp(const processed_event_t *event, char *buf, size_t buf_size) {
+    if (event->timestamp_ns == 0) {
         return NULL;
     }
+    return format_timestamp_iso8601_r(event->timestamp_ns, buf, buf_size);
+}
+
+/**
+ * JSON escape sequence for each byte: 0 = copied as is, 'u' = \u00XX,
+ * anything else = backslash followed by that character
+ */
+static const char json_escape_table[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['"'] = '"',
+    ['/'] = '/',
+    ['\\'] = '\\',
+};
+
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+
+/* Non-zero if any byte of w is zero */
+static inline uint64_t swar_has_zero(uint64_t w) {
+    return (w - SWAR_ONES) & ~w & SWAR_HIGHS;
+}
+
+/**
+ * Check 8 bytes at once for anything JSON needs escaped
+ * Tests for a control character (byte < 0x20), '"', '\\' and '/'
+ * without a branch per byte; exact, so a clean block is copied as is.
+ */
+static inline bool json_block_needs_escape(uint64_t w) {
+    uint64_t control = (w - SWAR_ONES * 0x20) & ~w & SWAR_HIGHS;
+    
+    return (control |
+            swar_has_zero(w ^ (SWAR_ONES * '"')) |
+            swar_has_zero(w ^ (SWAR_ONES * '\\')) |
+            swar_has_zero(w ^ (SWAR_ONES * '/'))) != 0;
+}
+
+/**
+ * Escape len bytes of src into dst
+ * dst must have room for 6 * len bytes (every byte a \u00XX escape)
+ * 
+ * @return Number of bytes written (no terminator)
+ */
+static size_t json_escape_into(char *dst, const char *src, size_t len) {
+    static const char hex_digits[] = "0123456789abcdef";
+    char *out = dst;
+    size_t i = 0;
     
-    /* Format: YYYY-MM-DDTHH:MM:SS.ssssssZ */
-    snprintf(buffer, sizeof(buffer), 
-             "%04d-%02d-%02dT%02d:%02d:%02d.%06luZ",
-             tm_info.tm_year + 1900,
-             tm_info.tm_mon + 1,
-             tm_info.tm_mday,
-             tm_info.tm_hour,
-             tm_info.tm_min,
-             tm_info.tm_sec,
-             (unsigned long)microseconds);
+    while (i < len) {
+        size_t end = len - i >= 8 ? i + 8 : len;
+        
+        if (end - i == 8) {
+            uint64_t block;
+            memcpy(&block, src + i, sizeof(block));
+            if (!json_block_needs_escape(block)) {
+                memcpy(out, src + i, 8);
+                out += 8;
+                i += 8;
+                continue;
+            }
+        }
+        
+        for (; i < end; i++) {
+            unsigned char c = (unsigned char)src[i];
+            char escape = json_escape_table[c];
+            
+            if (!escape) {
+                *out++ = (char)c;
+            } else if (escape != 'u') {
+                out[0] = '\\';
+                out[1] = escape;
+                out += 2;
+            } else {
+                /* Other control characters (0x00-0x1F) need \uXXXX encoding */
+                memcpy(out, "\\u00", 4);
+                out[4] = hex_digits[c >> 4];
+                out[5] = hex_digits[c & 0x0f];
+                out += 6;
+            }
+        }
+    }
     
-    result = strdup(buffer);
-    return result;
+    return (size_t)(out - dst);
 }
 
 /**
@@ -136,7 +417,7 @@ char *format_timestamp_iso8601(uint64_t timestamp_ns) {
  * @return Escaped string (caller must free), or NULL on failure
  */
 char *json_escape_string(const char *str) {
-    size_t len, i, j;
+    size_t len, n;
     char *escaped = NULL;
     
     if (!str) {
@@ -145,452 +426,398 @@ char *json_escape_string(const char *str) {
     
     len = strlen(str);
     
-    /* Worst case: every character needs escaping (2x size) + null terminator */
-    escaped = (char *)malloc(len * 2 + 1);
+    /* Worst case: every character becomes a \u00XX escape + null terminator */
+    escaped = (char *)malloc(len * 6 + 1);
     if (!escaped) {
         return NULL;
     }
     
-    j = 0;
-    for (i = 0; i < len; i++) {
-        unsigned char c = (unsigned char)str[i];
-        
-        switch (c) {
-            case '"':
-                escaped[j++] = '\\';
-                escaped[j++] = '"';
-                break;
-            case '\\':
-                escaped[j++] = '\\';
-                escaped[j++] = '\\';
-                break;
-            case '/':
-                escaped[j++] = '\\';
-                escaped[j++] = '/';
-                break;
-            case '\b':
-                escaped[j++] = '\\';
-                escaped[j++] = 'b';
-                break;
-            case '\f':
-                escaped[j++] = '\\';
-                escaped[j++] = 'f';
-                break;
-            case '\n':
-                escaped[j++] = '\\';
-                escaped[j++] = 'n';
-                break;
-            case '\r':
-                escaped[j++] = '\\';
-                escaped[j++] = 'r';
-                break;
-            case '\t':
-                escaped[j++] = '\\';
-                escaped[j++] = 't';
-                break;
-            default:
-                /* Control characters (0x00-0x1F) need \uXXXX encoding */
-                if (c < 0x20) {
-                    j += snprintf(&escaped[j], 7, "\\u%04x", c);
-                } else {
-                    escaped[j++] = c;
-                }
-                break;
-        }
-    }
-    
-    escaped[j] = '\0';
+    n = json_escape_into(escaped, str, len);
+    escaped[n] = '\0';
     return escaped;
 }
 
 /**
- * Write a JSON field (key-value pair)
- * Helper function to reduce code duplication
+ * Write a JSON string value (quoted and escaped) or null
+ * Escapes straight into the output buffer
  */
-static void write_json_field_string(FILE *output, const char *key, const char *value, 
-                                     bool is_last, int indent) {
-    char *escaped = NULL;
-    int i;
+static void out_json_string(output_formatter_t *fmt, const char *str) {
+    size_t len, n;
+    char *dst;
     
-    if (!output || !key) {
+    if (!str) {
+        out_write(fmt, "null", 4);
         return;
     }
     
-    /* Indent */
-    for (i = 0; i < indent; i++) {
-        fprintf(output, "  ");
+    len = strlen(str);
+    dst = out_reserve(fmt, len * 6 + 2);
+    if (!dst) {
+        return;
     }
     
-    if (value) {
-        escaped = json_escape_string(value);
-        fprintf(output, "\"%s\": \"%s\"", key, escaped ? escaped : "");
-        free(escaped);
-    } else {
-        fprintf(output, "\"%s\": null", key);
+    dst[0] = '"';
+    n = json_escape_into(dst + 1, str, len);
+    dst[n + 1] = '"';
+    fmt->buf_len += n + 2;
+}
+
+/**
+ * Write a path as a JSON string value, redacted if asked
+ * A redacted path is its replacement prefix followed by the rest of the
+ * original path, escaped straight from the view
+ */
+static void out_json_path(output_formatter_t *fmt, const char *path, bool redact) {
+    redacted_path_t view;
+    size_t len, n;
+    char *dst;
+    
+    if (!privacy_redact_path(path, redact, &view)) {
+        out_json_string(fmt, path);
+        return;
     }
     
+    len = strlen(view.suffix);
+    dst = out_reserve(fmt, (view.prefix_len + len) * 6 + 2);
+    if (!dst) {
+        return;
+    }
+    
+    dst[0] = '"';
+    n = 1 + json_escape_into(dst + 1, view.prefix, view.prefix_len);
+    n += json_escape_into(dst + n, view.suffix, len);
+    dst[n] = '"';
+    fmt->buf_len += n + 1;
+}
+
+/**
+ * Write a JSON field (key-value pair)
+ * Helper function to reduce code duplication
+ */
+static void write_json_field_key(output_formatter_t *fmt, const char *key, int indent) {
+    out_indent(fmt, indent);
+    out_char(fmt, '"');
+    out_str(fmt, key);
+    out_write(fmt, "\": ", 3);
+}
+
+static void write_json_field_end(output_formatter_t *fmt, bool is_last) {
     if (!is_last) {
-        fprintf(output, ",");
+        out_char(fmt, ',');
     }
-    fprintf(output, "\n");
+    out_char(fmt, '\n');
+}
+
+static void write_json_field_string(output_formatter_t *fmt, const char *key, const char *value, 
+                                     bool is_last, int indent) {
+    write_json_field_key(fmt, key, indent);
+    out_json_string(fmt, value);
+    write_json_field_end(fmt, is_last);
 }
 
-static void write_json_field_int(FILE *output, const char *key, int value, 
+static void write_json_field_int(output_formatter_t *fmt, const char *key, int value, 
                                   bool is_last, int indent) {
-    int i;
-    
-    if (!output || !key) {
+    write_json_field_key(fmt, key, indent);
+    out_int(fmt, value);
+    write_json_field_end(fmt, is_last);
+}
+
+static void write_json_field_uint(output_formatter_t *fmt, const char *key, unsigned int value, 
+                                   bool is_last, int indent) {
+    write_json_field_key(fmt, key, indent);
+    out_uint(fmt, value);
+    write_json_field_end(fmt, is_last);
+}
+
+static void write_json_field_u64(output_formatter_t *fmt, const char *key, uint64_t value,
+                                 bool is_last, int indent) {
+    write_json_field_key(fmt, key, indent);
+    out_uint(fmt, value);
+    write_json_field_end(fmt, is_last);
+}
+
+/**
+ * Write an event field
+ * Compact (json-stream) fields are "key":value with no whitespace;
+ * pretty fields go one per line
+ */
+static void write_event_key(output_formatter_t *fmt, const char *key) {
+    out_char(fmt, '"');
+    out_str(fmt, key);
+    out_write(fmt, "\":", 2);
+}
+
+static void write_event_string(output_formatter_t *fmt, const char *key, const char *value,
+                               bool is_last, bool compact) {
+    if (!compact) {
+        write_json_field_string(fmt, key, value, is_last, 1);
         return;
     }
-    
-    /* Indent */
-    for (i = 0; i < indent; i++) {
-        fprintf(output, "  ");
+    write_event_key(fmt, key);
+    out_json_string(fmt, value);
+    if (!is_last) {
+        out_char(fmt, ',');
     }
-    
-    fprintf(output, "\"%s\": %d", key, value);
-    
+}
+
+static void write_event_path(output_formatter_t *fmt, const char *key, const char *path,
+                             const processed_event_t *event, bool is_last, bool compact) {
+    if (!compact) {
+        write_json_field_key(fmt, key, 1);
+        out_json_path(fmt, path, event->redact_paths);
+        write_json_field_end(fmt, is_last);
+        return;
+    }
+    write_event_key(fmt, key);
+    out_json_path(fmt, path, event->redact_paths);
     if (!is_last) {
-        fprintf(output, ",");
+        out_char(fmt, ',');
     }
-    fprintf(output, "\n");
 }
 
-static void write_json_field_uint(FILE *output, const char *key, unsigned int value, 
-                                   bool is_last, int indent) {
-    int i;
-    
-    if (!output || !key) {
+static void write_event_int(output_formatter_t *fmt, const char *key, int value,
+                            bool is_last, bool compact) {
+    if (!compact) {
+        write_json_field_int(fmt, key, value, is_last, 1);
         return;
     }
-    
-    /* Indent */
-    for (i = 0; i < indent; i++) {
-        fprintf(output, "  ");
+    write_event_key(fmt, key);
+    out_int(fmt, value);
+    if (!is_last) {
+        out_char(fmt, ',');
     }
-    
-    fprintf(output, "\"%s\": %u", key, value);
-    
+}
+
+static void write_event_uint(output_formatter_t *fmt, const char *key, unsigned int value,
+                             bool is_last, bool compact) {
+    if (!compact) {
+        write_json_field_uint(fmt, key, value, is_last, 1);
+        return;
+    }
+    write_event_key(fmt, key);
+    out_uint(fmt, value);
     if (!is_last) {
-        fprintf(output, ",");
+        out_char(fmt, ',');
+    }
+}
+
+static void write_event_u64(output_formatter_t *fmt, const char *key, uint64_t value,
+                            bool is_last, bool compact) {
+    if (!compact) {
+        write_json_field_u64(fmt, key, value, is_last, 1);
+        return;
+    }
+    write_event_key(fmt, key);
+    out_uint(fmt, value);
+    if (!is_last) {
+        out_char(fmt, ',');
     }
-    fprintf(output, "\n");
 }
 
 /**
- * Write a file_open event as JSON
- * Requirement: 10.1 - Valid JSON for all event types
+ * Write the fields every event starts with
+ * Compact output omits a missing timestamp, pretty output writes null;
+ * container and pod are only written for events attributed to one
  */
-static int write_file_open_event_json(FILE *output, processed_event_t *event, bool compact) {
-    char *escaped = NULL;
-    
-    if (!output || !event) {
-        return -1;
+static void write_event_common(output_formatter_t *fmt, const processed_event_t *event,
+                               const char *event_type, bool compact) {
+    char timestamp_buf[ISO8601_TIMESTAMP_SIZE];
+    const char *timestamp = event_timestamp(event, timestamp_buf, sizeof(timestamp_buf));
+    
+    write_event_string(fmt, "event_type", event_type, false, compact);
+    if (timestamp || !compact) {
+        write_event_string(fmt, "timestamp", timestamp, false, compact);
     }
-    
-    if (compact) {
-        /* Compact format for json-stream */
-        fprintf(output, "\"event_type\":\"file_open\",");
-        
-        if (event->timestamp) {
-            escaped = json_escape_string(event->timestamp);
-            fprintf(output, "\"timestamp\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        }
-        
-        fprintf(output, "\"pid\":%u,\"uid\":%u,", event->pid, event->uid);
-        
-        if (event->process) {
-            escaped = json_escape_string(event->process);
-            fprintf(output, "\"process\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"process\":null,");
-        }
-        
-        if (event->exe) {
-            escaped = json_escape_string(event->exe);
-            fprintf(output, "\"exe\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"exe\":null,");
-        }
-        
-        if (event->file) {
-            escaped = json_escape_string(event->file);
-            fprintf(output, "\"file\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"file\":null,");
-        }
-        
-        fprintf(output, "\"file_type\":\"%s\",", file_type_to_string(event->file_type));
-        
-        if (event->flags) {
-            escaped = json_escape_string(event->flags);
-            fprintf(output, "\"flags\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"flags\":null,");
-        }
-        
-        fprintf(output, "\"result\":%d", event->result);
-    } else {
-        /* Pretty format */
-        write_json_field_string(output, "event_type", event->event_type, false, 1);
-        write_json_field_string(output, "timestamp", event->timestamp, false, 1);
-        write_json_field_uint(output, "pid", event->pid, false, 1);
-        write_json_field_uint(output, "uid", event->uid, false, 1);
-        write_json_field_string(output, "process", event->process, false, 1);
-        write_json_field_string(output, "exe", event->exe, false, 1);
-        write_json_field_string(output, "file", event->file, false, 1);
-        write_json_field_string(output, "file_type", file_type_to_string(event->file_type), false, 1);
-        write_json_field_string(output, "flags", event->flags, false, 1);
-        write_json_field_int(output, "result", event->result, true, 1);
+    write_event_uint(fmt, "pid", event->pid, false, compact);
+    write_event_uint(fmt, "uid", event->uid, false, compact);
+    write_event_string(fmt, "process", event->process, false, compact);
+    if (event->container) {
+        write_event_string(fmt, "container", event->container, false, compact);
+    }
+    if (event->pod) {
+        write_event_string(fmt, "pod", event->pod, false, compact);
     }
-    
-    return 0;
 }
 
+/* One field of an event's schema field list; OPT_ fields are left out
+ * when 0 */
+#define EVENT_FIELD_COUNT(type, member) + EVENT_FIELD_PRESENT_##type(member)
+#define EVENT_FIELD_PRESENT_PATH(member) 1
+#define EVENT_FIELD_PRESENT_STRING(member) 1
+#define EVENT_FIELD_PRESENT_INT(member) 1
+#define EVENT_FIELD_PRESENT_FILE_TYPE(member) 1
+#define EVENT_FIELD_PRESENT_OPT_UINT(member) (event->member != 0)
+#define EVENT_FIELD_WRITE(type, member) EVENT_FIELD_WRITE_##type(member)
+#define EVENT_FIELD_WRITE_PATH(member) \
+    write_event_path(fmt, #member, event->member, event, --remaining == 0, compact);
+#define EVENT_FIELD_WRITE_STRING(member) \
+    write_event_string(fmt, #member, event->member, --remaining == 0, compact);
+#define EVENT_FIELD_WRITE_INT(member) \
+    write_event_int(fmt, #member, event->member, --remaining == 0, compact);
+#define EVENT_FIELD_WRITE_FILE_TYPE(member) \
+    write_event_string(fmt, #member, file_type_to_string(event->member), --remaining == 0, \
+                       compact);
+#define EVENT_FIELD_WRITE_OPT_UINT(member) \
+    if (event->member != 0) { \
+        write_event_u64(fmt, #member, event->member, --remaining == 0, compact); \
+    }
+
 /**
- * Write a lib_load event as JSON
+ * Write an event of each type as JSON (write_<name>_event_json)
+ * The common fields, the type's schema fields, then its count if any
  * Requirement: 10.1 - Valid JSON for all event types
  */
-static int write_lib_load_event_json(FILE *output, processed_event_t *event, bool compact) {
-    char *escaped = NULL;
-    
-    if (!output || !event) {
-        return -1;
+#define EVENT_SCHEMA_WRITER(kind, name, fields) \
+    static void write_##name##_event_json(output_formatter_t *fmt, \
+                                          const processed_event_t *event, bool compact) { \
+        int remaining = 0 fields(EVENT_FIELD_COUNT) + (event->count > 0); \
+        write_event_common(fmt, event, #name, compact); \
+        fields(EVENT_FIELD_WRITE) \
+        if (event->count > 0) { \
+            write_event_uint(fmt, "count", event->count, --remaining == 0, compact); \
+        } \
     }
+EVENT_SCHEMA(EVENT_SCHEMA_WRITER)
+#undef EVENT_SCHEMA_WRITER
+
+/* Field writer for each event kind */
+static void (*const event_writers[EVENT_KIND_COUNT])(output_formatter_t *fmt,
+                                                     const processed_event_t *event,
+                                                     bool compact) = {
+#define EVENT_SCHEMA_WRITER_ENTRY(kind, name, fields) [EVENT_##kind] = write_##name##_event_json,
+    EVENT_SCHEMA(EVENT_SCHEMA_WRITER_ENTRY)
+#undef EVENT_SCHEMA_WRITER_ENTRY
+};
+
+/**
+ * Write a binary STRING record
+ */
+static void write_binary_string(output_formatter_t *fmt, const char *str, size_t len) {
+    uint8_t *dst = (uint8_t *)out_reserve(fmt, 1 + BINARY_VARINT_MAX + len);
+    size_t n;
     
-    if (compact) {
-        /* Compact format for json-stream */
-        fprintf(output, "\"event_type\":\"lib_load\",");
-        
-        if (event->timestamp) {
-            escaped = json_escape_string(event->timestamp);
-            fprintf(output, "\"timestamp\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        }
-        
-        fprintf(output, "\"pid\":%u,\"uid\":%u,", event->pid, event->uid);
-        
-        if (event->process) {
-            escaped = json_escape_string(event->process);
-            fprintf(output, "\"process\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"process\":null,");
-        }
-        
-        if (event->exe) {
-            escaped = json_escape_string(event->exe);
-            fprintf(output, "\"exe\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"exe\":null,");
-        }
-        
-        if (event->library) {
-            escaped = json_escape_string(event->library);
-            fprintf(output, "\"library\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"library\":null,");
-        }
-        
-        if (event->library_name) {
-            escaped = json_escape_string(event->library_name);
-            fprintf(output, "\"library_name\":\"%s\"", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"library_name\":null");
-        }
-    } else {
-        /* Pretty format */
-        write_json_field_string(output, "event_type", event->event_type, false, 1);
-        write_json_field_string(output, "timestamp", event->timestamp, false, 1);
-        write_json_field_uint(output, "pid", event->pid, false, 1);
-        write_json_field_uint(output, "uid", event->uid, false, 1);
-        write_json_field_string(output, "process", event->process, false, 1);
-        write_json_field_string(output, "exe", event->exe, false, 1);
-        write_json_field_string(output, "library", event->library, false, 1);
-        write_json_field_string(output, "library_name", event->library_name, true, 1);
+    if (!dst) {
+        return;
     }
     
-    return 0;
+    dst[0] = BINARY_RECORD_STRING;
+    n = 1 + binary_put_varint(dst + 1, len);
+    memcpy(dst + n, str, len);
+    fmt->buf_len += n + len;
 }
 
 /**
- * Write a process_exec event as JSON
- * Requirement: 10.1 - Valid JSON for all event types
+ * Reference a string from a binary event record
+ * A string seen for the first time is added to the dictionary, and its
+ * STRING record is written ahead of the event; strings that do not fit
+ * the dictionary are written inline.
  */
-static int write_process_exec_event_json(FILE *output, processed_event_t *event, bool compact) {
-    char *escaped = NULL;
+static uint64_t binary_string_ref(output_formatter_t *fmt, const char *str, size_t *len) {
+    uint32_t id;
     
-    if (!output || !event) {
-        return -1;
+    if (!str) {
+        return BINARY_REF_NULL;
     }
     
-    if (compact) {
-        /* Compact format for json-stream */
-        fprintf(output, "\"event_type\":\"process_exec\",");
-        
-        if (event->timestamp) {
-            escaped = json_escape_string(event->timestamp);
-            fprintf(output, "\"timestamp\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        }
-        
-        fprintf(output, "\"pid\":%u,\"uid\":%u,", event->pid, event->uid);
-        
-        if (event->process) {
-            escaped = json_escape_string(event->process);
-            fprintf(output, "\"process\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"process\":null,");
-        }
-        
-        if (event->exe) {
-            escaped = json_escape_string(event->exe);
-            fprintf(output, "\"exe\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"exe\":null,");
-        }
-        
-        if (event->cmdline) {
-            escaped = json_escape_string(event->cmdline);
-            fprintf(output, "\"cmdline\":\"%s\"", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"cmdline\":null");
-        }
-    } else {
-        /* Pretty format */
-        write_json_field_string(output, "event_type", event->event_type, false, 1);
-        write_json_field_string(output, "timestamp", event->timestamp, false, 1);
-        write_json_field_uint(output, "pid", event->pid, false, 1);
-        write_json_field_uint(output, "uid", event->uid, false, 1);
-        write_json_field_string(output, "process", event->process, false, 1);
-        write_json_field_string(output, "exe", event->exe, false, 1);
-        write_json_field_string(output, "cmdline", event->cmdline, true, 1);
+    id = path_intern_find(fmt->dictionary, str);
+    if (id != PATH_INTERN_INVALID) {
+        return BINARY_REF_DICT_BASE + (uint64_t)id;
     }
     
-    return 0;
+    *len = strlen(str);
+    if (*len > BINARY_DICT_MAX_LEN || path_intern_count(fmt->dictionary) >= BINARY_DICT_MAX) {
+        return BINARY_REF_INLINE;
+    }
+    
+    id = path_intern_add(fmt->dictionary, str, NULL);
+    if (id == PATH_INTERN_INVALID) {
+        return BINARY_REF_INLINE;
+    }
+    write_binary_string(fmt, str, *len);
+    return BINARY_REF_DICT_BASE + (uint64_t)id;
 }
 
 /**
- * Write a process_exit event as JSON
- * Requirement: 10.1 - Valid JSON for all event types
+ * Write an event as a binary EVENT record (see binary_format.h)
  */
-static int write_process_exit_event_json(FILE *output, processed_event_t *event, bool compact) {
-    char *escaped = NULL;
+static int write_binary_event(output_formatter_t *fmt, const processed_event_t *event) {
+    char exe_buf[REDACTED_PATH_MAX], file_buf[REDACTED_PATH_MAX], library_buf[REDACTED_PATH_MAX];
+    const char *strings[BINARY_EVENT_STRINGS + BINARY_EVENT_TRAILING_STRINGS] = {
+        event->process,
+        privacy_redact_path_into(event->exe, event->redact_paths, exe_buf, sizeof(exe_buf)),
+        event->cmdline,
+        privacy_redact_path_into(event->file, event->redact_paths, file_buf, sizeof(file_buf)),
+        privacy_redact_path_into(event->library, event->redact_paths, library_buf,
+                                 sizeof(library_buf)),
+        event->library_name, event->function_name, event->flags,
+        event->container, event->pod,
+    };
+    const int string_count = BINARY_EVENT_STRINGS + BINARY_EVENT_TRAILING_STRINGS;
+    uint64_t refs[BINARY_EVENT_STRINGS + BINARY_EVENT_TRAILING_STRINGS];
+    size_t lens[BINARY_EVENT_STRINGS + BINARY_EVENT_TRAILING_STRINGS];
+    uint64_t delta, result, exit_code;
+    uint8_t code = (uint8_t)processed_event_kind(event);
+    size_t payload, n;
+    uint8_t *dst;
+    int i;
     
-    if (!output || !event) {
+    if (code == 0) {
         return -1;
     }
     
-    if (compact) {
-        /* Compact format for json-stream */
-        fprintf(output, "\"event_type\":\"process_exit\",");
-        
-        if (event->timestamp) {
-            escaped = json_escape_string(event->timestamp);
-            fprintf(output, "\"timestamp\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        }
-        
-        fprintf(output, "\"pid\":%u,\"uid\":%u,", event->pid, event->uid);
-        
-        if (event->process) {
-            escaped = json_escape_string(event->process);
-            fprintf(output, "\"process\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"process\":null,");
-        }
-        
-        fprintf(output, "\"exit_code\":%d", event->exit_code);
-    } else {
-        /* Pretty format */
-        write_json_field_string(output, "event_type", event->event_type, false, 1);
-        write_json_field_string(output, "timestamp", event->timestamp, false, 1);
-        write_json_field_uint(output, "pid", event->pid, false, 1);
-        write_json_field_uint(output, "uid", event->uid, false, 1);
-        write_json_field_string(output, "process", event->process, false, 1);
-        write_json_field_int(output, "exit_code", event->exit_code, true, 1);
+    /* Define new strings first so the event can refer to them */
+    for (i = 0; i < string_count; i++) {
+        lens[i] = 0;
+        refs[i] = binary_string_ref(fmt, strings[i], &lens[i]);
     }
     
-    return 0;
-}
-
-/**
- * Write an api_call event as JSON
- * Requirement: 10.1 - Valid JSON for all event types
- */
-static int write_api_call_event_json(FILE *output, processed_event_t *event, bool compact) {
-    char *escaped = NULL;
+    delta = binary_zigzag((int64_t)(event->timestamp_ns - fmt->last_timestamp_ns));
+    result = binary_zigzag(event->result);
+    exit_code = binary_zigzag(event->exit_code);
+    fmt->last_timestamp_ns = event->timestamp_ns;
+    
+    payload = 1 + binary_varint_size(delta) + binary_varint_size(event->pid) +
+              binary_varint_size(event->uid) + 1 + binary_varint_size(result) +
+              binary_varint_size(exit_code) + binary_varint_size(event->count) +
+              binary_varint_size(event->cgroup_id) + binary_varint_size(event->inode) +
+              binary_varint_size(event->dev) + binary_varint_size(event->tid);
+    for (i = 0; i < string_count; i++) {
+        payload += binary_varint_size(refs[i]);
+        if (refs[i] == BINARY_REF_INLINE) {
+            payload += binary_varint_size(lens[i]) + lens[i];
+        }
+    }
     
-    if (!output || !event) {
+    dst = (uint8_t *)out_reserve(fmt, 1 + BINARY_VARINT_MAX + payload);
+    if (!dst) {
         return -1;
     }
     
-    if (compact) {
-        /* Compact format for json-stream */
-        fprintf(output, "\"event_type\":\"api_call\",");
-        
-        if (event->timestamp) {
-            escaped = json_escape_string(event->timestamp);
-            fprintf(output, "\"timestamp\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        }
-        
-        fprintf(output, "\"pid\":%u,\"uid\":%u,", event->pid, event->uid);
-        
-        if (event->process) {
-            escaped = json_escape_string(event->process);
-            fprintf(output, "\"process\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"process\":null,");
-        }
-        
-        if (event->exe) {
-            escaped = json_escape_string(event->exe);
-            fprintf(output, "\"exe\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"exe\":null,");
+    dst[0] = BINARY_RECORD_EVENT;
+    n = 1 + binary_put_varint(dst + 1, payload);
+    dst[n++] = code;
+    n += binary_put_varint(dst + n, delta);
+    n += binary_put_varint(dst + n, event->pid);
+    n += binary_put_varint(dst + n, event->uid);
+    for (i = 0; i < string_count; i++) {
+        if (i == BINARY_EVENT_STRINGS) {
+            dst[n++] = (uint8_t)event->file_type;
+            n += binary_put_varint(dst + n, result);
+            n += binary_put_varint(dst + n, exit_code);
+            n += binary_put_varint(dst + n, event->count);
+            n += binary_put_varint(dst + n, event->cgroup_id);
         }
-        
-        if (event->function_name) {
-            escaped = json_escape_string(event->function_name);
-            fprintf(output, "\"function_name\":\"%s\",", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"function_name\":null,");
+        n += binary_put_varint(dst + n, refs[i]);
+        if (refs[i] == BINARY_REF_INLINE) {
+            n += binary_put_varint(dst + n, lens[i]);
+            memcpy(dst + n, strings[i], lens[i]);
+            n += lens[i];
         }
-        
-        if (event->library) {
-            escaped = json_escape_string(event->library);
-            fprintf(output, "\"library\":\"%s\"", escaped ? escaped : "");
-            free(escaped);
-        } else {
-            fprintf(output, "\"library\":null");
-        }
-    } else {
-        /* Pretty format */
-        write_json_field_string(output, "event_type", event->event_type, false, 1);
-        write_json_field_string(output, "timestamp", event->timestamp, false, 1);
-        write_json_field_uint(output, "pid", event->pid, false, 1);
-        write_json_field_uint(output, "uid", event->uid, false, 1);
-        write_json_field_string(output, "process", event->process, false, 1);
-        write_json_field_string(output, "exe", event->exe, false, 1);
-        write_json_field_string(output, "function_name", event->function_name, false, 1);
-        write_json_field_string(output, "library", event->library, true, 1);
     }
+    n += binary_put_varint(dst + n, event->inode);
+    n += binary_put_varint(dst + n, event->dev);
+    n += binary_put_varint(dst + n, event->tid);
+    fmt->buf_len += n;
     
     return 0;
 }
@@ -604,76 +831,135 @@ static int write_api_call_event_json(FILE *output, processed_event_t *event, boo
  * @return 0 on success, -1 on failure
  */
 int output_formatter_write_event(output_formatter_t *fmt, processed_event_t *event) {
+    void (*write_fields)(output_formatter_t *, const processed_event_t *, bool) = NULL;
     int indent = 0;
     bool compact = false;
+    bool multiline;
+    event_kind_t kind;
     
     if (!fmt || !fmt->output || !event || !event->event_type) {
         return -1;
     }
     
+    fmt->record_start = fmt->buf_len;
+    
+    if (fmt->format == FORMAT_BINARY) {
+        if (write_binary_event(fmt, event) != 0) {
+            return -1;
+        }
+        return fmt->batched ? 0 : out_flush(fmt);
+    }
+    
+    kind = processed_event_kind(event);
+    if (kind != EVENT_NONE) {
+        write_fields = event_writers[kind];
+    }
+    if (!write_fields) {
+        /* Unknown event type */
+        return -1;
+    }
+    
     /* Determine if we're using compact format */
     compact = (fmt->format == FORMAT_JSON_STREAM);
+    multiline = (fmt->format == FORMAT_JSON_PRETTY || fmt->format == FORMAT_JSON_ARRAY);
     
     /* For JSON array format, handle commas between events */
     if (fmt->format == FORMAT_JSON_ARRAY) {
         if (!fmt->first_event) {
-            fprintf(fmt->output, ",\n");
+            out_write(fmt, ",\n", 2);
         }
         fmt->first_event = false;
         indent = 1;  /* Indent for array elements */
     }
     
-    /* Start JSON object */
-    if (fmt->format == FORMAT_JSON_PRETTY || fmt->format == FORMAT_JSON_ARRAY) {
-        int i;
-        for (i = 0; i < indent; i++) {
-            fprintf(fmt->output, "  ");
-        }
-        fprintf(fmt->output, "{\n");
-    } else {
-        /* json-stream format: compact, one line per event */
-        fprintf(fmt->output, "{");
-    }
-    
-    /* Write event fields based on event type */
-    if (strcmp(event->event_type, "file_open") == 0) {
-        write_file_open_event_json(fmt->output, event, compact);
-    } else if (strcmp(event->event_type, "lib_load") == 0) {
-        write_lib_load_event_json(fmt->output, event, compact);
-    } else if (strcmp(event->event_type, "process_exec") == 0) {
-        write_process_exec_event_json(fmt->output, event, compact);
-    } else if (strcmp(event->event_type, "process_exit") == 0) {
-        write_process_exit_event_json(fmt->output, event, compact);
-    } else if (strcmp(event->event_type, "api_call") == 0) {
-        write_api_call_event_json(fmt->output, event, compact);
+    /* Start JSON object (json-stream: compact, one line per event) */
+    if (multiline) {
+        out_indent(fmt, indent);
+        out_write(fmt, "{\n", 2);
     } else {
-        /* Unknown event type */
-        return -1;
+        out_char(fmt, '{');
     }
-    
+            
+    write_fields(fmt, event, compact);
+            
     /* Close JSON object */
-    if (fmt->format == FORMAT_JSON_PRETTY || fmt->format == FORMAT_JSON_ARRAY) {
-        int i;
-        for (i = 0; i < indent; i++) {
-            fprintf(fmt->output, "  ");
-        }
-        fprintf(fmt->output, "}");
-    } else {
-        /* json-stream format */
-        fprintf(fmt->output, "}");
+    if (multiline) {
+        out_indent(fmt, indent);
     }
-    
+    out_char(fmt, '}');
+        
     /* For json-stream, add newline after each event */
     if (fmt->format == FORMAT_JSON_STREAM) {
-        fprintf(fmt->output, "\n");
+        out_char(fmt, '\n');
+    }
+        
+    /* Write the event out now unless batched; batched output stays in the
+     * buffer until it fills or the ring buffer drain calls
+     * output_formatter_flush() */
+    if (!fmt->batched) {
+        return out_flush(fmt);
+    }
+        
+    return 0;
+}
+    
+/**
+ * Enable or disable batched event output
+ * When batched, events stay in the output buffer until it fills or
+ * output_formatter_flush() is called
+ * 
+ * @param fmt Output formatter
+ * @param batched true to defer flushing to output_formatter_flush()
+ */
+void output_formatter_set_batching(output_formatter_t *fmt, bool batched) {
+    if (fmt) {
+        fmt->batched = batched;
     }
+}
     
-    /* Flush output to ensure data is written */
-    fflush(fmt->output);
+/**
+ * Keep events whole when the buffer fills mid-event
+ * For several formatters writing to one stream: a full buffer is written
+ * up to the last complete event, so the stream only ever receives whole
+ * events and the formatters' events interleave cleanly. Only json-stream
+ * and json-pretty events stand on their own.
+ * 
+ * @param fmt Output formatter
+ * @param whole_records true to never split an event across writes
+ */
+void output_formatter_set_whole_records(output_formatter_t *fmt, bool whole_records) {
+    if (fmt) {
+        fmt->whole_records = whole_records;
+    }
+}
     
-    return 0;
+/**
+ * Select the snapshot library layout
+ * 
+ * @param fmt Output formatter
+ * @param library_index true to emit a shared library table referenced by index
+ */
+void output_formatter_set_library_index(output_formatter_t *fmt, bool library_index) {
+    if (fmt) {
+        fmt->library_index = library_index;
+    }
 }
-
+    
+/**
+ * Flush events written since the last flush
+ * Everything buffered goes out in a single fwrite
+ * 
+ * @param fmt Output formatter
+ * @return 0 on success, -1 on failure
+ */
+int output_formatter_flush(output_formatter_t *fmt) {
+    if (!fmt || !fmt->output) {
+        return -1;
+    }
+        
+    return out_flush(fmt);
+}
+    
 /**
  * Write a profile document as JSON
  * Requirement: 2.2, 2.5, 10.6
@@ -686,194 +972,438 @@ int output_formatter_write_profile(output_formatter_t *fmt, profile_t *profile)
     size_t i;
     bool pretty = (fmt->format == FORMAT_JSON_PRETTY);
     int indent = pretty ? 1 : 0;
-    
+        
     if (!fmt || !fmt->output || !profile) {
         return -1;
     }
-    
+        
     /* Start profile object */
-    fprintf(fmt->output, "{\n");
-    
+    out_str(fmt, "{\n");
+            
     /* Profile metadata */
-    write_json_field_string(fmt->output, "profile_version", profile->profile_version, false, indent);
-    write_json_field_string(fmt->output, "generated_at", profile->generated_at, false, indent);
-    write_json_field_int(fmt->output, "duration_seconds", profile->duration_seconds, false, indent);
-    
+    write_json_field_string(fmt, "profile_version", profile->profile_version, false, indent);
+    write_json_field_string(fmt, "generated_at", profile->generated_at, false, indent);
+    write_json_field_int(fmt, "duration_seconds", profile->duration_seconds, false, indent);
+            
     /* Process information */
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "\"process\": {\n");
-    write_json_field_uint(fmt->output, "pid", profile->process.pid, false, indent + 1);
-    write_json_field_string(fmt->output, "name", profile->process.name, false, indent + 1);
-    write_json_field_string(fmt->output, "exe", profile->process.exe, false, indent + 1);
-    write_json_field_string(fmt->output, "cmdline", profile->process.cmdline, false, indent + 1);
-    write_json_field_uint(fmt->output, "uid", profile->process.uid, false, indent + 1);
-    write_json_field_uint(fmt->output, "gid", profile->process.gid, false, indent + 1);
-    write_json_field_string(fmt->output, "start_time", profile->process.start_time, true, indent + 1);
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "},\n");
-    
+    out_indent(fmt, indent);
+    out_str(fmt, "\"process\": {\n");
+    write_json_field_uint(fmt, "pid", profile->process.pid, false, indent + 1);
+    write_json_field_string(fmt, "name", profile->process.name, false, indent + 1);
+    write_json_field_string(fmt, "exe", profile->process.exe, false, indent + 1);
+    write_json_field_string(fmt, "cmdline", profile->process.cmdline, false, indent + 1);
+    write_json_field_uint(fmt, "uid", profile->process.uid, false, indent + 1);
+    write_json_field_uint(fmt, "gid", profile->process.gid, false, indent + 1);
+    write_json_field_string(fmt, "start_time", profile->process.start_time, true, indent + 1);
+    out_indent(fmt, indent);
+    out_str(fmt, "},\n");
+            
     /* Libraries array */
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "\"libraries\": [\n");
+    out_indent(fmt, indent);
+    out_str(fmt, "\"libraries\": [\n");
     for (i = 0; i < profile->library_count; i++) {
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "{\n");
-        write_json_field_string(fmt->output, "name", profile->libraries[i].name, false, indent + 2);
-        write_json_field_string(fmt->output, "path", profile->libraries[i].path, false, indent + 2);
-        write_json_field_string(fmt->output, "load_time", profile->libraries[i].load_time, true, indent + 2);
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "}");
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "{\n");
+        write_json_field_string(fmt, "name", profile->libraries[i].name, false, indent + 2);
+        write_json_field_string(fmt, "path", profile->libraries[i].path, false, indent + 2);
+        write_json_field_string(fmt, "load_time", profile->libraries[i].load_time, true, indent + 2);
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "}");
         if (i < profile->library_count - 1) {
-            fprintf(fmt->output, ",");
+            out_str(fmt, ",");
         }
-        fprintf(fmt->output, "\n");
+        out_str(fmt, "\n");
     }
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "],\n");
-    
+    out_indent(fmt, indent);
+    out_str(fmt, "],\n");
+            
     /* Files accessed array */
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "\"files_accessed\": [\n");
+    out_indent(fmt, indent);
+    out_str(fmt, "\"files_accessed\": [\n");
     for (i = 0; i < profile->file_count; i++) {
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "{\n");
-        write_json_field_string(fmt->output, "path", profile->files_accessed[i].path, false, indent + 2);
-        write_json_field_string(fmt->output, "type", profile->files_accessed[i].type, false, indent + 2);
-        write_json_field_int(fmt->output, "access_count", profile->files_accessed[i].access_count, false, indent + 2);
-        write_json_field_string(fmt->output, "first_access", profile->files_accessed[i].first_access, false, indent + 2);
-        write_json_field_string(fmt->output, "last_access", profile->files_accessed[i].last_access, false, indent + 2);
-        write_json_field_string(fmt->output, "mode", profile->files_accessed[i].mode, true, indent + 2);
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "}");
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "{\n");
+        write_json_field_string(fmt, "path", profile->files_accessed[i].path, false, indent + 2);
+        write_json_field_string(fmt, "type", profile->files_accessed[i].type, false, indent + 2);
+        write_json_field_int(fmt, "access_count", profile->files_accessed[i].access_count, false, indent + 2);
+        write_json_field_string(fmt, "first_access", profile->files_accessed[i].first_access, false, indent + 2);
+        write_json_field_string(fmt, "last_access", profile->files_accessed[i].last_access, false, indent + 2);
+        write_json_field_string(fmt, "mode", profile->files_accessed[i].mode, true, indent + 2);
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "}");
         if (i < profile->file_count - 1) {
-            fprintf(fmt->output, ",");
+            out_str(fmt, ",");
         }
-        fprintf(fmt->output, "\n");
+        out_str(fmt, "\n");
     }
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "],\n");
-    
+    out_indent(fmt, indent);
+    out_str(fmt, "],\n");
+            
     /* API calls array */
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "\"api_calls\": [\n");
+    out_indent(fmt, indent);
+    out_str(fmt, "\"api_calls\": [\n");
     for (i = 0; i < profile->api_call_count; i++) {
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "{\n");
-        write_json_field_string(fmt->output, "function_name", profile->api_calls[i].function_name, false, indent + 2);
-        write_json_field_int(fmt->output, "count", profile->api_calls[i].count, true, indent + 2);
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "}");
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "{\n");
+        write_json_field_string(fmt, "function_name", profile->api_calls[i].function_name, false, indent + 2);
+        write_json_field_int(fmt, "count", profile->api_calls[i].count, true, indent + 2);
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "}");
         if (i < profile->api_call_count - 1) {
-            fprintf(fmt->output, ",");
+            out_str(fmt, ",");
         }
-        fprintf(fmt->output, "\n");
+        out_str(fmt, "\n");
     }
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "],\n");
-    
+    out_indent(fmt, indent);
+    out_str(fmt, "],\n");
+            
+    /* TLS handshake latencies, measured in the kernel */
+    out_indent(fmt, indent);
+    out_str(fmt, "\"tls_handshakes\": [\n");
+    for (i = 0; i < profile->tls_handshake_count; i++) {
+        const handshake_latency_t *latency = &profile->tls_handshakes[i];
+        char histogram[HANDSHAKE_LATENCY_JSON_MAX];
+        
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "{\n");
+        write_json_field_string(fmt, "function_name", latency->function_name, false, indent + 2);
+        write_json_field_u64(fmt, "count", handshake_latency_count(latency), false, indent + 2);
+        write_json_field_u64(fmt, "errors", latency->errors, false, indent + 2);
+        write_json_field_u64(fmt, "mean_us", handshake_latency_mean_us(latency), false, indent + 2);
+        write_json_field_u64(fmt, "p50_us", handshake_latency_percentile_us(latency, 50),
+                             false, indent + 2);
+        write_json_field_u64(fmt, "p90_us", handshake_latency_percentile_us(latency, 90),
+                             false, indent + 2);
+        write_json_field_u64(fmt, "p99_us", handshake_latency_percentile_us(latency, 99),
+                             false, indent + 2);
+        write_json_field_key(fmt, "histogram_us", indent + 2);
+        out_str(fmt, handshake_latency_format_histogram(latency, histogram, sizeof(histogram)) > 0
+                     ? histogram : "{}");
+        write_json_field_end(fmt, true);
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "}");
+        if (i < profile->tls_handshake_count - 1) {
+            out_str(fmt, ",");
+        }
+        out_str(fmt, "\n");
+    }
+    out_indent(fmt, indent);
+    out_str(fmt, "],\n");
+            
     /* Statistics */
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "\"statistics\": {\n");
-    write_json_field_int(fmt->output, "total_events", profile->statistics.total_events, false, indent + 1);
-    write_json_field_int(fmt->output, "libraries_loaded", profile->statistics.libraries_loaded, false, indent + 1);
-    write_json_field_int(fmt->output, "files_accessed", profile->statistics.files_accessed, false, indent + 1);
-    write_json_field_int(fmt->output, "api_calls_made", profile->statistics.api_calls_made, true, indent + 1);
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "}\n");
-    
+    out_indent(fmt, indent);
+    out_str(fmt, "\"statistics\": {\n");
+    write_json_field_int(fmt, "total_events", profile->statistics.total_events, false, indent + 1);
+    write_json_field_int(fmt, "libraries_loaded", profile->statistics.libraries_loaded, false, indent + 1);
+    write_json_field_int(fmt, "files_accessed", profile->statistics.files_accessed, false, indent + 1);
+    write_json_field_int(fmt, "api_calls_made", profile->statistics.api_calls_made, true, indent + 1);
+    out_indent(fmt, indent);
+    out_str(fmt, "}\n");
+            
     /* Close profile object */
-    fprintf(fmt->output, "}\n");
+    out_str(fmt, "}\n");
+        
+    return out_flush(fmt);
+}
     
-    fflush(fmt->output);
-    return 0;
+/* Distinct libraries of a snapshot, in order of first use */
+typedef struct {
+    uint32_t *refs;            /* Output index of each process library, flattened */
+    char **escaped;            /* JSON-escaped path by output index */
+    size_t count;
+} snapshot_library_table_t;
+    
+static void free_library_table(snapshot_library_table_t *libs) {
+    for (size_t i = 0; i < libs->count; i++) {
+        free(libs->escaped[i]);
+    }
+    free(libs->escaped);
+    free(libs->refs);
 }
-
+    
+/**
+ * Number each distinct library of a snapshot and escape its path once
+ * Uses the scanner's interned ids when every process has them and
+ * interns the paths locally otherwise. Only referenced paths get an
+ * index, so paths replaced by redaction never reach the output.
+ */
+static int build_library_table(snapshot_t *snapshot, snapshot_library_table_t *libs) {
+    path_intern_t *table = snapshot->library_table;
+    path_intern_t *local = NULL;
+    uint32_t *index_of = NULL;
+    size_t total = 0, table_size, k = 0;
+    int ret = -1;
+        
+    memset(libs, 0, sizeof(*libs));
+        
+    for (size_t i = 0; i < snapshot->process_count; i++) {
+        total += snapshot->processes[i].library_count;
+        if (snapshot->processes[i].library_count > 0 && !snapshot->processes[i].library_ids) {
+            table = NULL;
+        }
+    }
+    if (total == 0) {
+        return 0;
+    }
+        
+    if (!table) {
+        local = path_intern_create();
+        if (!local) {
+            return -1;
+        }
+        table = local;
+    }
+        
+    libs->refs = malloc(total * sizeof(*libs->refs));
+    if (!libs->refs) {
+        goto out;
+    }
+        
+    /* Resolve every reference to its table id first */
+    for (size_t i = 0; i < snapshot->process_count; i++) {
+        snapshot_process_t *proc = &snapshot->processes[i];
+        for (size_t j = 0; j < proc->library_count; j++) {
+            libs->refs[k] = local ? path_intern_add(local, proc->libraries[j], NULL)
+                                  : proc->library_ids[j];
+            if (libs->refs[k] == PATH_INTERN_INVALID) {
+                goto out;
+            }
+            k++;
+        }
+    }
+        
+    table_size = path_intern_count(table);
+    index_of = malloc(table_size * sizeof(*index_of));
+    libs->escaped = calloc(table_size, sizeof(*libs->escaped));
+    if (!index_of || !libs->escaped) {
+        goto out;
+    }
+    memset(index_of, 0xff, table_size * sizeof(*index_of));
+        
+    /* Then map ids to output indices, escaping each path on first use */
+    k = 0;
+    for (size_t i = 0; i < snapshot->process_count; i++) {
+        snapshot_process_t *proc = &snapshot->processes[i];
+        for (size_t j = 0; j < proc->library_count; j++, k++) {
+            uint32_t id = libs->refs[k];
+            if (id >= table_size) {
+                goto out;
+            }
+            if (index_of[id] == UINT32_MAX) {
+                libs->escaped[libs->count] = json_escape_string(proc->libraries[j]);
+                if (!libs->escaped[libs->count]) {
+                    goto out;
+                }
+                index_of[id] = (uint32_t)libs->count++;
+            }
+            libs->refs[k] = index_of[id];
+        }
+    }
+    ret = 0;
+        
+out:
+    if (ret != 0) {
+        free_library_table(libs);
+        memset(libs, 0, sizeof(*libs));
+    }
+    free(index_of);
+    path_intern_destroy(local);
+    return ret;
+}
+    
+/**
+ * Write the processes of a snapshot as an array member
+ * Libraries are written as ids in the library table when by_index is
+ * set and as paths otherwise
+ */
+static void write_snapshot_processes(output_formatter_t *fmt, const char *key, snapshot_t *snapshot,
+                                     const snapshot_library_table_t *libs, bool by_index,
+                                     int indent) {
+    size_t i, j, ref = 0;
+        
+    out_indent(fmt, indent);
+    out_json_string(fmt, key);
+    out_str(fmt, ": [\n");
+    for (i = 0; i < snapshot->process_count; i++) {
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "{\n");
+        write_json_field_uint(fmt, "pid", snapshot->processes[i].pid, false, indent + 2);
+        write_json_field_string(fmt, "name", snapshot->processes[i].name, false, indent + 2);
+        write_json_field_string(fmt, "exe", snapshot->processes[i].exe, false, indent + 2);
+        write_json_field_string(fmt, "running_as", snapshot->processes[i].running_as, false, indent + 2);
+                    
+        /* Libraries of this process, by reference or by path */
+        out_indent(fmt, indent * 3);
+        out_str(fmt, by_index ? "\"library_ids\": [" : "\"libraries\": [");
+        for (j = 0; j < snapshot->processes[i].library_count; j++, ref++) {
+            if (j > 0) {
+                out_write(fmt, ", ", 2);
+            }
+            if (by_index) {
+                out_uint(fmt, libs->refs[ref]);
+            } else {
+                out_char(fmt, '"');
+                out_str(fmt, libs->escaped[libs->refs[ref]]);
+                out_char(fmt, '"');
+            }
+        }
+        out_str(fmt, "],\n");
+                    
+        /* Open crypto files array for this process */
+        out_indent(fmt, indent * 3);
+        out_str(fmt, "\"open_crypto_files\": [");
+        for (j = 0; j < snapshot->processes[i].file_count; j++) {
+            const char *file = snapshot->processes[i].open_crypto_files[j];
+            out_json_string(fmt, file ? file : "");
+            if (j < snapshot->processes[i].file_count - 1) {
+                out_write(fmt, ", ", 2);
+            }
+        }
+        out_str(fmt, "]\n");
+                    
+        out_indent(fmt, indent * 2);
+        out_str(fmt, "}");
+        if (i < snapshot->process_count - 1) {
+            out_str(fmt, ",");
+        }
+        out_str(fmt, "\n");
+    }
+    out_indent(fmt, indent);
+    out_str(fmt, "],\n");
+}
+    
 /**
  * Write a snapshot document as JSON
  * Requirement: 3.4, 10.6
+ * Each distinct library path is escaped once; with the library index
+ * layout it is also written once, in a top-level "libraries" table that
+ * processes refer to through "library_ids".
  * 
  * @param fmt Output formatter
  * @param snapshot Snapshot to write
  * @return 0 on success, -1 on failure
  */
 int output_formatter_write_snapshot(output_formatter_t *fmt, snapshot_t *snapshot) {
-    char *escaped = NULL;
-    size_t i, j;
-    bool pretty = (fmt->format == FORMAT_JSON_PRETTY);
-    int indent = pretty ? 1 : 0;
-    
+    snapshot_library_table_t libs;
+    size_t j;
+    bool pretty;
+    int indent;
+        
     if (!fmt || !fmt->output || !snapshot) {
         return -1;
     }
-    
+        
+    pretty = (fmt->format == FORMAT_JSON_PRETTY);
+    indent = pretty ? 1 : 0;
+        
+    if (build_library_table(snapshot, &libs) != 0) {
+        fprintf(stderr, "Error: Failed to index snapshot libraries\n");
+        return -1;
+    }
+        
     /* Start snapshot object */
-    fprintf(fmt->output, "{\n");
-    
+    out_str(fmt, "{\n");
+            
     /* Snapshot metadata */
-    write_json_field_string(fmt->output, "snapshot_version", snapshot->snapshot_version, false, indent);
-    write_json_field_string(fmt->output, "generated_at", snapshot->generated_at, false, indent);
-    write_json_field_string(fmt->output, "hostname", snapshot->hostname, false, indent);
-    write_json_field_string(fmt->output, "kernel", snapshot->kernel, false, indent);
-    
-    /* Processes array */
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "\"processes\": [\n");
-    for (i = 0; i < snapshot->process_count; i++) {
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "{\n");
-        write_json_field_uint(fmt->output, "pid", snapshot->processes[i].pid, false, indent + 2);
-        write_json_field_string(fmt->output, "name", snapshot->processes[i].name, false, indent + 2);
-        write_json_field_string(fmt->output, "exe", snapshot->processes[i].exe, false, indent + 2);
-        write_json_field_string(fmt->output, "running_as", snapshot->processes[i].running_as, false, indent + 2);
-        
-        /* Libraries array for this process */
-        if (pretty) fprintf(fmt->output, "      ");
-        fprintf(fmt->output, "\"libraries\": [");
-        for (j = 0; j < snapshot->processes[i].library_count; j++) {
-            escaped = json_escape_string(snapshot->processes[i].libraries[j]);
-            fprintf(fmt->output, "\"%s\"", escaped ? escaped : "");
-            free(escaped);
-            if (j < snapshot->processes[i].library_count - 1) {
-                fprintf(fmt->output, ", ");
-            }
-        }
-        fprintf(fmt->output, "],\n");
-        
-        /* Open crypto files array for this process */
-        if (pretty) fprintf(fmt->output, "      ");
-        fprintf(fmt->output, "\"open_crypto_files\": [");
-        for (j = 0; j < snapshot->processes[i].file_count; j++) {
-            escaped = json_escape_string(snapshot->processes[i].open_crypto_files[j]);
-            fprintf(fmt->output, "\"%s\"", escaped ? escaped : "");
-            free(escaped);
-            if (j < snapshot->processes[i].file_count - 1) {
-                fprintf(fmt->output, ", ");
+    write_json_field_string(fmt, "snapshot_version", snapshot->snapshot_version, false, indent);
+    write_json_field_string(fmt, "generated_at", snapshot->generated_at, false, indent);
+    write_json_field_string(fmt, "hostname", snapshot->hostname, false, indent);
+    write_json_field_string(fmt, "kernel", snapshot->kernel, false, indent);
+            
+    /* Shared library table */
+    if (fmt->library_index) {
+        out_indent(fmt, indent);
+        out_str(fmt, "\"libraries\": [");
+        for (j = 0; j < libs.count; j++) {
+            if (j > 0) {
+                out_write(fmt, ", ", 2);
             }
+            out_char(fmt, '"');
+            out_str(fmt, libs.escaped[j]);
+            out_char(fmt, '"');
         }
-        fprintf(fmt->output, "]\n");
-        
-        if (pretty) fprintf(fmt->output, "    ");
-        fprintf(fmt->output, "}");
-        if (i < snapshot->process_count - 1) {
-            fprintf(fmt->output, ",");
-        }
-        fprintf(fmt->output, "\n");
+        out_str(fmt, "],\n");
     }
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "],\n");
-    
+            
+    write_snapshot_processes(fmt, "processes", snapshot, &libs, fmt->library_index, indent);
+            
     /* Summary */
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "\"summary\": {\n");
-    write_json_field_int(fmt->output, "total_processes", snapshot->summary.total_processes, false, indent + 1);
-    write_json_field_int(fmt->output, "total_libraries", snapshot->summary.total_libraries, false, indent + 1);
-    write_json_field_int(fmt->output, "total_files", snapshot->summary.total_files, true, indent + 1);
-    if (pretty) fprintf(fmt->output, "  ");
-    fprintf(fmt->output, "}\n");
-    
+    out_indent(fmt, indent);
+    out_str(fmt, "\"summary\": {\n");
+    write_json_field_int(fmt, "total_processes", snapshot->summary.total_processes, false, indent + 1);
+    write_json_field_int(fmt, "total_libraries", snapshot->summary.total_libraries, false, indent + 1);
+    write_json_field_int(fmt, "total_files", snapshot->summary.total_files, true, indent + 1);
+    out_indent(fmt, indent);
+    out_str(fmt, "}\n");
+            
     /* Close snapshot object */
-    fprintf(fmt->output, "}\n");
-    
-    fflush(fmt->output);
-    return 0;
+    out_str(fmt, "}\n");
+        
+    free_library_table(&libs);
+    return out_flush(fmt);
+}
+        
+/**
+ * Write the difference between two snapshots as JSON
+ * Same process layout as a snapshot, with library paths inline: "added"
+ * holds the new processes and what the others started using, "removed"
+ * the processes gone and what the others stopped using.
+ * 
+ * @param fmt Output formatter
+ * @param snapshot This run's snapshot (metadata and totals)
+ * @param added Processes and entries new since the previous run
+ * @param removed Processes and entries gone since the previous run
+ * @param since generated_at of the previous run (NULL = first run)
+ * @return 0 on success, -1 on failure
+ */
+int output_formatter_write_snapshot_diff(output_formatter_t *fmt, snapshot_t *snapshot,
+                                         snapshot_t *added, snapshot_t *removed,
+                                         const char *since) {
+    snapshot_library_table_t added_libs, removed_libs;
+    int indent;
+        
+    if (!fmt || !fmt->output || !snapshot || !added || !removed) {
+        return -1;
+    }
+        
+    indent = (fmt->format == FORMAT_JSON_PRETTY) ? 1 : 0;
+        
+    if (build_library_table(added, &added_libs) != 0) {
+        fprintf(stderr, "Error: Failed to index snapshot libraries\n");
+        return -1;
+    }
+    if (build_library_table(removed, &removed_libs) != 0) {
+        fprintf(stderr, "Error: Failed to index snapshot libraries\n");
+        free_library_table(&added_libs);
+        return -1;
+    }
+        
+    out_str(fmt, "{\n");
+    write_json_field_string(fmt, "snapshot_version", snapshot->snapshot_version, false, indent);
+    write_json_field_string(fmt, "generated_at", snapshot->generated_at, false, indent);
+    write_json_field_string(fmt, "since", since, false, indent);
+    write_json_field_string(fmt, "hostname", snapshot->hostname, false, indent);
+    write_json_field_string(fmt, "kernel", snapshot->kernel, false, indent);
+        
+    write_snapshot_processes(fmt, "added", added, &added_libs, false, indent);
+    write_snapshot_processes(fmt, "removed", removed, &removed_libs, false, indent);
+        
+    /* Totals of this run, then of the changes */
+    out_indent(fmt, indent);
+    out_str(fmt, "\"summary\": {\n");
+    write_json_field_int(fmt, "total_processes", snapshot->summary.total_processes, false, indent + 1);
+    write_json_field_int(fmt, "total_libraries", snapshot->summary.total_libraries, false, indent + 1);
+    write_json_field_int(fmt, "total_files", snapshot->summary.total_files, false, indent + 1);
+    write_json_field_int(fmt, "added_libraries", added->summary.total_libraries, false, indent + 1);
+    write_json_field_int(fmt, "removed_libraries", removed->summary.total_libraries, false, indent + 1);
+    write_json_field_int(fmt, "added_files", added->summary.total_files, false, indent + 1);
+    write_json_field_int(fmt, "removed_files", removed->summary.total_files, true, indent + 1);
+    out_indent(fmt, indent);
+    out_str(fmt, "}\n");
+    out_str(fmt, "}\n");
+        
+    free_library_table(&added_libs);
+    free_library_table(&removed_libs);
+    return out_flush(fmt);
 }
+    
\ No newline at end of file
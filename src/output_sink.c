@@ -0,0 +1,609 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * output_sink.c - Asynchronous, rotating, compressed output file
+ * Writers fill one block at a time under the sink lock and queue it when
+ * the next write does not fit; a write is never split across blocks, so
+ * with the formatter handing over whole records, rotation (which happens
+ * between blocks) never splits a record. The writer thread owns the
+ * backend: the file descriptor and deflate stream of the file backend.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <zlib.h>
+#include "include/output_sink.h"
+#include "include/logger.h"
+
+/* Deflate output buffer of the writer thread */
+#define OUTPUT_SINK_ZBUF_SIZE (256 * 1024)
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t size;
+} sink_block_t;
+
+struct output_sink {
+    const output_sink_backend_t *backend;
+    void *backend_ctx;
+    FILE *stream;
+    
+    pthread_mutex_t lock;
+    pthread_cond_t queued;         /* Writer: a block is queued or the sink closes */
+    pthread_cond_t freed;          /* Writers: a block is free again */
+    sink_block_t blocks[OUTPUT_SINK_BLOCKS];
+    unsigned int queue[OUTPUT_SINK_BLOCKS];    /* Full blocks, oldest first */
+    unsigned int queue_head;
+    unsigned int queue_count;
+    unsigned int free_list[OUTPUT_SINK_BLOCKS];
+    unsigned int free_count;
+    int current;                   /* Block being filled (-1 = none) */
+    bool closing;
+    bool failed;
+    output_sink_stats_t stats;
+    pthread_t thread;
+    bool running;
+};
+
+/* The output file backend; everything here belongs to the writer thread */
+typedef struct {
+    output_sink_config_t config;
+    char *path;
+    int fd;
+    uint64_t file_bytes;
+    uint64_t file_opened_ns;
+    uint64_t written;              /* Bytes written by the current call */
+    unsigned int files;
+    unsigned int next_seq;         /* Number of the next rotated file */
+    z_stream zs;
+    bool zs_ready;
+    unsigned char *zbuf;
+} file_backend_t;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Name of rotated file seq */
+static void rotated_name(const file_backend_t *fb, unsigned int seq, char *buf, size_t size) {
+    size_t len = strlen(fb->path);
+    
+    if (fb->config.gzip_level > 0 && len > 3 && strcmp(fb->path + len - 3, ".gz") == 0) {
+        snprintf(buf, size, "%.*s.%u.gz", (int)(len - 3), fb->path, seq);
+    } else {
+        snprintf(buf, size, "%s.%u", fb->path, seq);
+    }
+}
+
+static int open_file(file_backend_t *fb) {
+    fb->fd = open(fb->path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+    if (fb->fd < 0) {
+        return -1;
+    }
+    fb->file_bytes = 0;
+    fb->file_opened_ns = monotonic_ns();
+    fb->files++;
+    return 0;
+}
+
+/**
+ * Write iovecs completely, resuming after short writes
+ */
+static int write_all(file_backend_t *fb, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fb->fd, iov, count);
+        
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        fb->file_bytes += (uint64_t)n;
+        fb->written += (uint64_t)n;
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Feed data to the deflate stream and write what it produces
+ * flush is Z_NO_FLUSH, Z_SYNC_FLUSH (make everything so far readable) or
+ * Z_FINISH (end the gzip member)
+ */
+static int deflate_write(file_backend_t *fb, const char *data, size_t len, int flush) {
+    struct iovec iov;
+    int zret;
+    
+    fb->zs.next_in = (Bytef *)data;
+    fb->zs.avail_in = (uInt)len;
+    do {
+        fb->zs.next_out = fb->zbuf;
+        fb->zs.avail_out = OUTPUT_SINK_ZBUF_SIZE;
+        zret = deflate(&fb->zs, flush);
+        if (zret == Z_STREAM_ERROR) {
+            return -1;
+        }
+        iov.iov_base = fb->zbuf;
+        iov.iov_len = OUTPUT_SINK_ZBUF_SIZE - fb->zs.avail_out;
+        if (iov.iov_len > 0 && write_all(fb, &iov, 1) != 0) {
+            return -1;
+        }
+    } while (fb->zs.avail_out == 0 || (flush == Z_FINISH && zret != Z_STREAM_END));
+    return 0;
+}
+
+/**
+ * Write taken blocks to the file
+ */
+static int64_t file_backend_write(void *ctx, struct iovec *blocks, unsigned int count,
+                                  bool partial) {
+    file_backend_t *fb = (file_backend_t *)ctx;
+    
+    fb->written = 0;
+    if (fb->fd < 0) {
+        return -1;
+    }
+    
+    if (fb->config.gzip_level == 0) {
+        if (write_all(fb, blocks, (int)count) != 0) {
+            goto fail;
+        }
+        return (int64_t)fb->written;
+    }
+    
+    for (unsigned int i = 0; i < count; i++) {
+        /* Idle output is made readable (zcat of a live file) right away */
+        int flush = (partial && i + 1 == count) ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+        
+        if (deflate_write(fb, blocks[i].iov_base, blocks[i].iov_len, flush) != 0) {
+            goto fail;
+        }
+    }
+    return (int64_t)fb->written;
+
+fail:
+    log_error("Failed to write output file %s", fb->path);
+    log_system_error("write");
+    return -1;
+}
+
+/**
+ * End the current file and start the next one
+ */
+static int rotate(file_backend_t *fb) {
+    char name[PATH_MAX];
+    int ret = 0;
+    
+    if (fb->zs_ready && deflate_write(fb, NULL, 0, Z_FINISH) != 0) {
+        ret = -1;
+    }
+    if (close(fb->fd) != 0) {
+        ret = -1;
+    }
+    fb->fd = -1;
+    
+    rotated_name(fb, fb->next_seq, name, sizeof(name));
+    if (rename(fb->path, name) != 0) {
+        log_error("Failed to rotate output file %s", fb->path);
+        log_system_error("rename");
+        ret = -1;
+    } else {
+        log_debug("Rotated output to %s", name);
+        if (fb->config.rotate_keep > 0 && fb->next_seq > fb->config.rotate_keep) {
+            rotated_name(fb, fb->next_seq - fb->config.rotate_keep, name, sizeof(name));
+            unlink(name);
+        }
+        fb->next_seq++;
+    }
+    
+    if (fb->zs_ready) {
+        deflateReset(&fb->zs);
+    }
+    if (open_file(fb) != 0) {
+        log_error("Failed to open output file %s", fb->path);
+        log_system_error("open");
+        return -1;
+    }
+    return ret;
+}
+
+static bool rotation_due(const file_backend_t *fb, uint64_t now_ns) {
+    if (fb->fd < 0 || fb->file_bytes == 0) {
+        return false;
+    }
+    if (fb->config.rotate_bytes > 0 && fb->file_bytes >= fb->config.rotate_bytes) {
+        return true;
+    }
+    return fb->config.rotate_ms > 0 &&
+           now_ns - fb->file_opened_ns >= (uint64_t)fb->config.rotate_ms * 1000000ULL;
+}
+
+/* A failed rotation leaves no file; the next write reports it */
+static void file_backend_tick(void *ctx) {
+    file_backend_t *fb = (file_backend_t *)ctx;
+    
+    if (rotation_due(fb, monotonic_ns())) {
+        rotate(fb);
+    }
+}
+
+static void free_file_backend(file_backend_t *fb) {
+    if (fb->zs_ready) {
+        deflateEnd(&fb->zs);
+    }
+    free(fb->zbuf);
+    if (fb->fd >= 0) {
+        close(fb->fd);
+    }
+    free(fb->path);
+    free(fb);
+}
+
+static int file_backend_close(void *ctx) {
+    file_backend_t *fb = (file_backend_t *)ctx;
+    int ret = 0;
+    
+    if (fb->fd < 0) {
+        ret = -1;
+    } else if (fb->zs_ready && deflate_write(fb, NULL, 0, Z_FINISH) != 0) {
+        ret = -1;
+    }
+    if (fb->fd >= 0 && close(fb->fd) != 0) {
+        ret = -1;
+    }
+    fb->fd = -1;
+    log_debug("Output written to %u file(s)", fb->files);
+    
+    free_file_backend(fb);
+    return ret;
+}
+
+static const output_sink_backend_t file_backend = {
+    .write = file_backend_write,
+    .tick = file_backend_tick,
+    .close = file_backend_close,
+};
+
+/* Queue the block being filled (lock held) */
+static void queue_current(output_sink_t *sink) {
+    unsigned int tail = (sink->queue_head + sink->queue_count) % OUTPUT_SINK_BLOCKS;
+    
+    sink->queue[tail] = (unsigned int)sink->current;
+    sink->queue_count++;
+    sink->current = -1;
+}
+
+static void *writer_main(void *arg) {
+    output_sink_t *sink = (output_sink_t *)arg;
+    unsigned int taken[OUTPUT_SINK_BLOCKS];
+    struct iovec iov[OUTPUT_SINK_BLOCKS];
+    unsigned int count;
+    int64_t written;
+    struct timespec deadline;
+    bool partial, closing;
+    
+    pthread_mutex_lock(&sink->lock);
+    for (;;) {
+        partial = false;
+        if (sink->queue_count == 0 && !sink->closing) {
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += OUTPUT_SINK_LINGER_MS / 1000;
+            deadline.tv_nsec += (OUTPUT_SINK_LINGER_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&sink->queued, &sink->lock, &deadline);
+        }
+        closing = sink->closing;
+        
+        /* Nothing filled a block for a while, or the sink closes: take the rest */
+        if (sink->queue_count == 0 && sink->current >= 0 &&
+            sink->blocks[sink->current].len > 0) {
+            queue_current(sink);
+            partial = true;
+        }
+        
+        count = sink->queue_count;
+        for (unsigned int i = 0; i < count; i++) {
+            taken[i] = sink->queue[(sink->queue_head + i) % OUTPUT_SINK_BLOCKS];
+            iov[i].iov_base = sink->blocks[taken[i]].data;
+            iov[i].iov_len = sink->blocks[taken[i]].len;
+        }
+        pthread_mutex_unlock(&sink->lock);
+        
+        written = 0;
+        if (count > 0) {
+            written = sink->backend->write(sink->backend_ctx, iov, count, partial);
+        }
+        if (!closing && sink->backend->tick) {
+            sink->backend->tick(sink->backend_ctx);
+        }
+        
+        pthread_mutex_lock(&sink->lock);
+        if (written < 0) {
+            sink->failed = true;
+            sink->stats.write_errors++;
+        } else {
+            sink->stats.bytes_out += (uint64_t)written;
+        }
+        for (unsigned int i = 0; i < count; i++) {
+            sink->blocks[taken[i]].len = 0;
+            sink->free_list[sink->free_count++] = taken[i];
+        }
+        sink->queue_head = (sink->queue_head + count) % OUTPUT_SINK_BLOCKS;
+        sink->queue_count -= count;
+        if (count > 0) {
+            pthread_cond_broadcast(&sink->freed);
+        }
+        if (closing && sink->queue_count == 0 &&
+            (sink->current < 0 || sink->blocks[sink->current].len == 0)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sink->lock);
+    
+    return NULL;
+}
+
+/**
+ * Stream write: copy into the current block, queueing it when full and
+ * waiting for a free block when the writer is behind
+ */
+static ssize_t sink_write(void *cookie, const char *buf, size_t size) {
+    output_sink_t *sink = (output_sink_t *)cookie;
+    sink_block_t *block;
+    uint64_t begin = 0;
+    
+    pthread_mutex_lock(&sink->lock);
+    if (sink->failed) {
+        pthread_mutex_unlock(&sink->lock);
+        errno = EIO;
+        return -1;
+    }
+    
+    if (sink->current >= 0 &&
+        sink->blocks[sink->current].len + size > sink->blocks[sink->current].size) {
+        queue_current(sink);
+        pthread_cond_signal(&sink->queued);
+    }
+    
+    if (sink->current < 0) {
+        if (sink->free_count == 0) {
+            begin = monotonic_ns();
+            sink->stats.stalls++;
+            log_warn_ratelimited("Output writer is behind, event output waits for it");
+            while (sink->free_count == 0) {
+                pthread_cond_wait(&sink->freed, &sink->lock);
+            }
+            sink->stats.stall_ns += monotonic_ns() - begin;
+        }
+        sink->current = (int)sink->free_list[--sink->free_count];
+    }
+    
+    /* A write bigger than a block gets a bigger block */
+    block = &sink->blocks[sink->current];
+    if (size > block->size) {
+        char *data = realloc(block->data, size);
+        
+        if (!data) {
+            pthread_mutex_unlock(&sink->lock);
+            errno = ENOMEM;
+            return -1;
+        }
+        block->data = data;
+        block->size = size;
+    }
+    memcpy(block->data + block->len, buf, size);
+    block->len += size;
+    sink->stats.bytes_in += size;
+    pthread_mutex_unlock(&sink->lock);
+    
+    return (ssize_t)size;
+}
+
+/* The sink outlives its stream: output_sink_close() does the work */
+static int sink_stream_close(void *cookie) {
+    (void)cookie;
+    return 0;
+}
+
+static void free_sink(output_sink_t *sink) {
+    for (int i = 0; i < OUTPUT_SINK_BLOCKS; i++) {
+        free(sink->blocks[i].data);
+    }
+    pthread_cond_destroy(&sink->queued);
+    pthread_cond_destroy(&sink->freed);
+    pthread_mutex_destroy(&sink->lock);
+    free(sink);
+}
+
+output_sink_t *output_sink_open_backend(const output_sink_backend_t *backend, void *ctx) {
+    cookie_io_functions_t io = { .write = sink_write, .close = sink_stream_close };
+    output_sink_t *sink;
+    int err;
+    
+    if (!backend || !backend->write || !backend->close) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    sink = calloc(1, sizeof(*sink));
+    if (!sink) {
+        backend->close(ctx);
+        return NULL;
+    }
+    sink->backend = backend;
+    sink->backend_ctx = ctx;
+    sink->current = -1;
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->queued, NULL);
+    pthread_cond_init(&sink->freed, NULL);
+    
+    for (int i = 0; i < OUTPUT_SINK_BLOCKS; i++) {
+        sink->blocks[i].data = malloc(OUTPUT_SINK_BLOCK_SIZE);
+        if (!sink->blocks[i].data) {
+            goto fail;
+        }
+        sink->blocks[i].size = OUTPUT_SINK_BLOCK_SIZE;
+        sink->free_list[sink->free_count++] = (unsigned int)i;
+    }
+    
+    sink->stream = fopencookie(sink, "w", io);
+    if (!sink->stream) {
+        goto fail;
+    }
+    /* Callers buffer already; every write goes straight into a block */
+    setvbuf(sink->stream, NULL, _IONBF, 0);
+    
+    if (pthread_create(&sink->thread, NULL, writer_main, sink) != 0) {
+        fclose(sink->stream);
+        errno = EAGAIN;
+        goto fail;
+    }
+    sink->running = true;
+    
+    return sink;
+
+fail:
+    err = errno;
+    backend->close(ctx);
+    free_sink(sink);
+    errno = err;
+    return NULL;
+}
+
+output_sink_t *output_sink_open(const output_sink_config_t *config) {
+    char name[PATH_MAX];
+    file_backend_t *fb;
+    int err;
+    
+    if (!config || !config->path || config->gzip_level < 0 || config->gzip_level > 9) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    fb = calloc(1, sizeof(*fb));
+    if (!fb) {
+        return NULL;
+    }
+    fb->config = *config;
+    fb->fd = -1;
+    fb->next_seq = 1;
+    
+    fb->path = strdup(config->path);
+    if (!fb->path) {
+        free_file_backend(fb);
+        return NULL;
+    }
+    fb->config.path = fb->path;
+    
+    if (config->gzip_level > 0) {
+        fb->zbuf = malloc(OUTPUT_SINK_ZBUF_SIZE);
+        /* windowBits 15 + 16: gzip framing */
+        if (!fb->zbuf || deflateInit2(&fb->zs, config->gzip_level, Z_DEFLATED, 15 + 16, 8,
+                                      Z_DEFAULT_STRATEGY) != Z_OK) {
+            free_file_backend(fb);
+            errno = ENOMEM;
+            return NULL;
+        }
+        fb->zs_ready = true;
+    }
+    
+    /* Rotation never overwrites the files of an earlier run */
+    if (config->rotate_bytes > 0 || config->rotate_ms > 0) {
+        rotated_name(fb, fb->next_seq, name, sizeof(name));
+        while (access(name, F_OK) == 0) {
+            rotated_name(fb, ++fb->next_seq, name, sizeof(name));
+        }
+    }
+    
+    if (open_file(fb) != 0) {
+        err = errno;
+        free_file_backend(fb);
+        errno = err;
+        return NULL;
+    }
+    
+    return output_sink_open_backend(&file_backend, fb);
+}
+
+FILE *output_sink_stream(output_sink_t *sink) {
+    return sink ? sink->stream : NULL;
+}
+
+void output_sink_get_stats(output_sink_t *sink, output_sink_stats_t *stats) {
+    if (!sink || !stats) {
+        return;
+    }
+    pthread_mutex_lock(&sink->lock);
+    *stats = sink->stats;
+    stats->blocks_queued = sink->queue_count;
+    pthread_mutex_unlock(&sink->lock);
+}
+
+int output_sink_close(output_sink_t *sink, output_sink_stats_t *stats) {
+    int ret = 0;
+    
+    if (!sink) {
+        return -1;
+    }
+    
+    if (fclose(sink->stream) != 0) {
+        ret = -1;
+    }
+    
+    pthread_mutex_lock(&sink->lock);
+    sink->closing = true;
+    pthread_cond_signal(&sink->queued);
+    pthread_mutex_unlock(&sink->lock);
+    if (sink->running) {
+        pthread_join(sink->thread, NULL);
+    }
+    
+    if (sink->backend->close(sink->backend_ctx) != 0) {
+        sink->failed = true;
+    }
+    
+    if (sink->stats.stalls > 0) {
+        log_warn("Event output waited for the writer %lu times (%.1f ms in total)",
+                 sink->stats.stalls, (double)sink->stats.stall_ns / 1e6);
+    }
+    log_debug("Output: %lu bytes in, %lu bytes written", sink->stats.bytes_in,
+              sink->stats.bytes_out);
+    
+    if (sink->failed) {
+        ret = -1;
+    }
+    if (stats) {
+        *stats = sink->stats;
+    }
+    free_sink(sink);
+    return ret;
+}
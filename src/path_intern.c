@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * path_intern.c - Interned path table implementation
+ * Open-addressing hash set of ids over an id-indexed entry array; the
+ * strings themselves live in a string arena. A mutex serializes access
+ * so the parallel snapshot workers can share one table: only crypto
+ * library paths are interned, so it is taken a handful of times per
+ * process.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "include/path_intern.h"
+#include "include/string_arena.h"
+#include "include/logger.h"
+
+/* Initial number of hash buckets (power of two) */
+#define INTERN_INITIAL_BUCKETS 64
+
+/* Arena chunk size: a host has at most a few hundred distinct libraries */
+#define INTERN_ARENA_CHUNK 8192
+
+typedef struct {
+    const char *path;
+    uint64_t hash;
+} intern_entry_t;
+
+struct path_intern {
+    pthread_mutex_t lock;
+    string_arena_t *arena;
+    intern_entry_t *entries;   /* Indexed by id */
+    size_t count;
+    size_t capacity;
+    uint32_t *buckets;         /* id + 1, 0 = empty */
+    size_t bucket_mask;
+};
+
+/**
+ * FNV-1a hash of a path
+ */
+static uint64_t hash_path(const char *path) {
+    uint64_t hash = 14695981039346656037ULL;
+    
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Create an empty table
+ *
+ * @return Pointer to table, or NULL on failure
+ */
+path_intern_t *path_intern_create(void) {
+    path_intern_t *table = calloc(1, sizeof(*table));
+    
+    if (!table) {
+        log_error("Failed to allocate path table");
+        return NULL;
+    }
+    
+    table->arena = string_arena_create(INTERN_ARENA_CHUNK);
+    table->buckets = calloc(INTERN_INITIAL_BUCKETS, sizeof(*table->buckets));
+    if (!table->arena || !table->buckets) {
+        log_error("Failed to allocate path table");
+        string_arena_destroy(table->arena);
+        free(table->buckets);
+        free(table);
+        return NULL;
+    }
+    
+    table->bucket_mask = INTERN_INITIAL_BUCKETS - 1;
+    pthread_mutex_init(&table->lock, NULL);
+    return table;
+}
+
+/**
+ * Destroy a table and every interned string
+ */
+void path_intern_destroy(path_intern_t *table) {
+    if (!table) {
+        return;
+    }
+    
+    pthread_mutex_destroy(&table->lock);
+    string_arena_destroy(table->arena);
+    free(table->entries);
+    free(table->buckets);
+    free(table);
+}
+
+/**
+ * Double the bucket array and reinsert every id (lock held)
+ */
+static int grow_buckets(path_intern_t *table) {
+    size_t new_size = (table->bucket_mask + 1) * 2;
+    uint32_t *buckets = calloc(new_size, sizeof(*buckets));
+    
+    if (!buckets) {
+        return -1;
+    }
+    
+    for (size_t id = 0; id < table->count; id++) {
+        size_t slot = table->entries[id].hash & (new_size - 1);
+        while (buckets[slot] != 0) {
+            slot = (slot + 1) & (new_size - 1);
+        }
+        buckets[slot] = (uint32_t)id + 1;
+    }
+    
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucket_mask = new_size - 1;
+    return 0;
+}
+
+/**
+ * Insert a new path (lock held, path known to be absent)
+ */
+static uint32_t insert_path(path_intern_t *table, const char *path, uint64_t hash,
+                            const char **interned) {
+    const char *copy;
+    size_t slot;
+    
+    /* Keep the load factor under 3/4 */
+    if ((table->count + 1) * 4 > (table->bucket_mask + 1) * 3 && grow_buckets(table) != 0) {
+        return PATH_INTERN_INVALID;
+    }
+    
+    if (table->count >= table->capacity) {
+        size_t new_capacity = table->capacity == 0 ? 32 : table->capacity * 2;
+        intern_entry_t *entries = realloc(table->entries, new_capacity * sizeof(*entries));
+        if (!entries) {
+            return PATH_INTERN_INVALID;
+        }
+        table->entries = entries;
+        table->capacity = new_capacity;
+    }
+    
+    copy = string_arena_strdup(table->arena, path);
+    if (!copy) {
+        return PATH_INTERN_INVALID;
+    }
+    
+    table->entries[table->count].path = copy;
+    table->entries[table->count].hash = hash;
+    
+    slot = hash & table->bucket_mask;
+    while (table->buckets[slot] != 0) {
+        slot = (slot + 1) & table->bucket_mask;
+    }
+    table->buckets[slot] = (uint32_t)table->count + 1;
+    
+    if (interned) {
+        *interned = copy;
+    }
+    return (uint32_t)table->count++;
+}
+
+/**
+ * Find the id of an interned path (lock held)
+ */
+static uint32_t lookup_path(path_intern_t *table, const char *path, uint64_t hash,
+                            const char **interned) {
+    for (size_t slot = hash & table->bucket_mask; table->buckets[slot] != 0;
+         slot = (slot + 1) & table->bucket_mask) {
+        const intern_entry_t *entry = &table->entries[table->buckets[slot] - 1];
+        if (entry->hash == hash && strcmp(entry->path, path) == 0) {
+            if (interned) {
+                *interned = entry->path;
+            }
+            return table->buckets[slot] - 1;
+        }
+    }
+    return PATH_INTERN_INVALID;
+}
+
+/**
+ * Intern a path
+ *
+ * @param table Path table
+ * @param path Path to intern
+ * @param interned Optional output: the table's copy of the path
+ * @return Id of the path, or PATH_INTERN_INVALID on failure
+ */
+uint32_t path_intern_add(path_intern_t *table, const char *path, const char **interned) {
+    uint64_t hash;
+    uint32_t id;
+    
+    if (!table || !path) {
+        return PATH_INTERN_INVALID;
+    }
+    
+    hash = hash_path(path);
+    
+    pthread_mutex_lock(&table->lock);
+    id = lookup_path(table, path, hash, interned);
+    if (id == PATH_INTERN_INVALID) {
+        id = insert_path(table, path, hash, interned);
+    }
+    pthread_mutex_unlock(&table->lock);
+    
+    return id;
+}
+
+/**
+ * Look up a path without interning it
+ *
+ * @return Id of the path, or PATH_INTERN_INVALID if it is not in the table
+ */
+uint32_t path_intern_find(path_intern_t *table, const char *path) {
+    uint32_t id;
+    
+    if (!table || !path) {
+        return PATH_INTERN_INVALID;
+    }
+    
+    pthread_mutex_lock(&table->lock);
+    id = lookup_path(table, path, hash_path(path), NULL);
+    pthread_mutex_unlock(&table->lock);
+    
+    return id;
+}
+
+const char *path_intern_get(path_intern_t *table, uint32_t id) {
+    const char *path = NULL;
+    
+    if (!table) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&table->lock);
+    if (id < table->count) {
+        path = table->entries[id].path;
+    }
+    pthread_mutex_unlock(&table->lock);
+    
+    return path;
+}
+
+size_t path_intern_count(path_intern_t *table) {
+    size_t count;
+    
+    if (!table) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&table->lock);
+    count = table->count;
+    pthread_mutex_unlock(&table->lock);
+    
+    return count;
+}
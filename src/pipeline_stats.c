@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * pipeline_stats.c - Per-stage latency histograms of the event pipeline
+ * A stage normally has a single writer, so its buckets are bumped with a
+ * relaxed load and store instead of a locked read-modify-write; readers
+ * see each counter whole, if not all counters of one event at once.
+ * Concurrent writers (sharded consumers) switch to atomic adds.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "include/pipeline_stats.h"
+
+typedef struct {
+    _Atomic uint64_t buckets[STAGE_HIST_BUCKETS];
+    _Atomic uint64_t sum_ticks;
+    _Atomic uint64_t max_ticks;
+} stage_hist_t;
+
+bool pipeline_stats_enabled;
+
+/* Several threads record the same stages (see pipeline_stats_set_concurrent) */
+static bool concurrent_writers;
+
+static stage_hist_t stage_hists[STAGE_COUNT];
+
+/* Tick rate reference, taken when timing was enabled */
+static uint64_t enabled_ticks;
+static uint64_t enabled_mono_ns;
+
+static const char *const stage_names[STAGE_COUNT] = {
+    [STAGE_DRAIN] = "drain",
+    [STAGE_DECODE] = "decode",
+    [STAGE_ENRICH] = "enrich",
+    [STAGE_CLASSIFY] = "classify",
+    [STAGE_FILTER] = "filter",
+    [STAGE_FORMAT] = "format",
+    [STAGE_WRITE] = "write",
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Start timing stages
+ * Call before the threads that record stages start
+ */
+void pipeline_stats_enable(void) {
+    enabled_mono_ns = monotonic_ns();
+    enabled_ticks = stage_clock();
+    pipeline_stats_enabled = true;
+}
+
+/**
+ * Let several threads record the same stage at once
+ * Call before those threads start; each bump then costs a locked add
+ */
+void pipeline_stats_set_concurrent(void) {
+    concurrent_writers = true;
+}
+
+/**
+ * Bucket of a tick count: values below STAGE_HIST_SUB_BUCKETS have a
+ * bucket each, above that each power of two is split in
+ * STAGE_HIST_SUB_BUCKETS by the bits below the leading one
+ */
+static int bucket_of(uint64_t ticks) {
+    int exponent;
+    int bucket;
+    
+    if (ticks < STAGE_HIST_SUB_BUCKETS) {
+        return (int)ticks;
+    }
+    
+    exponent = 63 - __builtin_clzll(ticks);
+    bucket = (exponent - STAGE_HIST_SUB_BITS + 1) * STAGE_HIST_SUB_BUCKETS +
+             (int)((ticks >> (exponent - STAGE_HIST_SUB_BITS)) & (STAGE_HIST_SUB_BUCKETS - 1));
+    
+    return bucket < STAGE_HIST_BUCKETS ? bucket : STAGE_HIST_BUCKETS - 1;
+}
+
+/* Smallest tick count of a bucket */
+static uint64_t bucket_lower(int bucket) {
+    int exponent;
+    uint64_t sub;
+    
+    if (bucket < STAGE_HIST_SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    
+    exponent = bucket / STAGE_HIST_SUB_BUCKETS + STAGE_HIST_SUB_BITS - 1;
+    sub = (uint64_t)(bucket % STAGE_HIST_SUB_BUCKETS);
+    return (STAGE_HIST_SUB_BUCKETS + sub) << (exponent - STAGE_HIST_SUB_BITS);
+}
+
+static inline void bump(_Atomic uint64_t *counter, uint64_t value) {
+    if (concurrent_writers) {
+        atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+        return;
+    }
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+/**
+ * Add one stage duration
+ */
+void pipeline_stats_record(pipeline_stage_t stage, uint64_t ticks) {
+    stage_hist_t *hist;
+    
+    if (stage < 0 || stage >= STAGE_COUNT) {
+        return;
+    }
+    
+    hist = &stage_hists[stage];
+    bump(&hist->buckets[bucket_of(ticks)], 1);
+    bump(&hist->sum_ticks, ticks);
+    if (ticks > atomic_load_explicit(&hist->max_ticks, memory_order_relaxed)) {
+        atomic_store_explicit(&hist->max_ticks, ticks, memory_order_relaxed);
+    }
+}
+
+/* Nanoseconds per tick, measured since pipeline_stats_enable() */
+static double ns_per_tick(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ticks = stage_clock() - enabled_ticks;
+    uint64_t ns = monotonic_ns() - enabled_mono_ns;
+    
+    /* Too short to measure: assume a 1 GHz TSC until it is not */
+    if (!pipeline_stats_enabled || ticks == 0 || ns < 1000000) {
+        return 1.0;
+    }
+    return (double)ns / (double)ticks;
+#else
+    return 1.0;
+#endif
+}
+
+/**
+ * Summarize a stage's histogram
+ *
+ * @return 0 on success, -EINVAL on invalid arguments
+ */
+int pipeline_stats_snapshot(pipeline_stage_t stage, stage_snapshot_t *snapshot) {
+    static const uint64_t per_1000[] = { 500, 900, 990, 999 };
+    uint64_t *quantiles[4];
+    uint64_t counts[STAGE_HIST_BUCKETS];
+    stage_hist_t *hist;
+    double scale;
+    uint64_t seen = 0;
+    size_t next = 0;
+    
+    if (!snapshot || stage < 0 || stage >= STAGE_COUNT) {
+        return -EINVAL;
+    }
+    
+    memset(snapshot, 0, sizeof(*snapshot));
+    quantiles[0] = &snapshot->p50_ns;
+    quantiles[1] = &snapshot->p90_ns;
+    quantiles[2] = &snapshot->p99_ns;
+    quantiles[3] = &snapshot->p999_ns;
+    hist = &stage_hists[stage];
+    scale = ns_per_tick();
+    
+    for (int i = 0; i < STAGE_HIST_BUCKETS; i++) {
+        counts[i] = atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        snapshot->count += counts[i];
+    }
+    snapshot->sum_ns = (uint64_t)((double)atomic_load_explicit(&hist->sum_ticks,
+                                                               memory_order_relaxed) * scale);
+    snapshot->max_ns = (uint64_t)((double)atomic_load_explicit(&hist->max_ticks,
+                                                               memory_order_relaxed) * scale);
+    
+    for (int i = 0; i < STAGE_HIST_BUCKETS && snapshot->count > 0 && next < 4; i++) {
+        seen += counts[i];
+        while (next < 4 && seen * 1000 >= snapshot->count * per_1000[next]) {
+            /* No bucket bound is above the maximum, the top bucket has none */
+            uint64_t ns = i + 1 < STAGE_HIST_BUCKETS ?
+                          (uint64_t)((double)bucket_lower(i + 1) * scale) : snapshot->max_ns;
+            
+            *quantiles[next++] = ns < snapshot->max_ns ? ns : snapshot->max_ns;
+        }
+    }
+    
+    return 0;
+}
+
+const char *pipeline_stage_name(pipeline_stage_t stage) {
+    if (stage < 0 || stage >= STAGE_COUNT) {
+        return "unknown";
+    }
+    return stage_names[stage];
+}
@@ -6,6 +6,9 @@
 /**
  * privacy_filter.c - Privacy filtering implementation
  * Implements path redaction and data sanitization
+ * Redaction rewrites at most a path's prefix, so it is computed as a view
+ * (replacement prefix, original suffix) that writers emit directly;
+ * privacy_filter_path() is the allocating form for code that keeps paths.
  * Requirements: 6.1, 6.2, 6.3, 6.4, 6.5, 6.6
  */
 
@@ -16,84 +19,123 @@
 #include <stdio.h>
 #include "include/privacy_filter.h"
 
-/**
- * Apply path redaction for privacy protection
- * 
+/* Redaction rules, looked up by the character after the leading '/'
  * Requirement 6.1: Redact home directories (/home/user/ → /home/USER/)
  * Requirement 6.2: Redact root directory (/root/ → /home/ROOT/)
- * Requirement 6.3: Preserve system paths (/etc/, /usr/, /lib/)
+ * Requirement 6.3: Preserve system paths (/etc/, /usr/, /lib/): no rule
+ * covers them, nor any other path, which is kept as is */
+typedef struct {
+    const char *match;             /* Prefix the rule applies to */
+    size_t match_len;
+    const char *replacement;
+    size_t replacement_len;
+    bool user_component;           /* Replace the path component after match too */
+} redact_rule_t;
+
+static const redact_rule_t redact_rules[] = {
+    { NULL, 0, NULL, 0, false },
+    { "/home/", 6, "/home/USER", 10, true },
+    { "/root", 5, "/home/ROOT", 10, false },
+};
+
+static const unsigned char redact_rule_index[256] = {
+    ['h'] = 1,
+    ['r'] = 2,
+};
+
+/**
+ * Look up the redaction of a path
  * Requirement 6.4: --no-redact flag disables all redaction
  * 
  * @param path Original path
  * @param redact_enabled Whether redaction is enabled (false if --no-redact)
- * @return Redacted path (caller must free), or NULL on failure
+ * @param view Set to the redacted path when it differs from path
+ * @return true if redaction changes the path, false if it is kept as is
  */
-char *privacy_filter_path(const char *path, bool redact_enabled) {
-    char *result = NULL;
-    const char *next_slash = NULL;
-    size_t len = 0;
+bool privacy_redact_path(const char *path, bool redact_enabled, redacted_path_t *view) {
+    const redact_rule_t *rule;
+    const char *suffix;
     
-    if (!path) {
-        return NULL;
+    if (!path || !view || !redact_enabled || path[0] != '/') {
+        return false;
     }
     
-    /* If redaction is disabled, return copy of original path */
-    if (!redact_enabled) {
-        return strdup(path);
+    rule = &redact_rules[redact_rule_index[(unsigned char)path[1]]];
+    if (!rule->match || strncmp(path, rule->match, rule->match_len) != 0) {
+        return false;
     }
     
-    /* Rule 1: /home/username/ → /home/USER/ */
-    if (strncmp(path, "/home/", 6) == 0) {
-        next_slash = strchr(path + 6, '/');
-        if (next_slash) {
-            /* Found username between /home/ and next / */
-            len = strlen("/home/USER") + strlen(next_slash) + 1;
-            result = (char *)malloc(len);
-            if (!result) {
-                return NULL;
-            }
-            snprintf(result, len, "/home/USER%s", next_slash);
-            return result;
-        } else {
-            /* Path is just /home/username with no trailing slash */
-            return strdup("/home/USER");
-        }
+    suffix = path + rule->match_len;
+    if (rule->user_component) {
+        /* /home/<user>[/...]: the user name goes, the rest stays */
+        suffix += strcspn(suffix, "/");
+    } else if (*suffix != '\0' && *suffix != '/') {
+        /* /rootfs is not /root */
+        return false;
     }
     
-    /* Rule 2: /root/ → /home/ROOT/ */
-    if (strncmp(path, "/root/", 6) == 0) {
-        len = strlen("/home/ROOT") + strlen(path + 5) + 1;
-        result = (char *)malloc(len);
-        if (!result) {
-            return NULL;
-        }
-        snprintf(result, len, "/home/ROOT%s", path + 5);
-        return result;
+    view->prefix = rule->replacement;
+    view->prefix_len = rule->replacement_len;
+    view->suffix = suffix;
+    return true;
+}
+
+/**
+ * Redact a path into a caller buffer
+ * 
+ * @param path Original path
+ * @param redact_enabled Whether redaction is enabled (false if --no-redact)
+ * @param buf Buffer for the redacted path (REDACTED_PATH_MAX is enough)
+ * @param buf_size Size of buf
+ * @return path itself if unchanged, buf if redacted, NULL if buf is too small
+ */
+const char *privacy_redact_path_into(const char *path, bool redact_enabled,
+                                     char *buf, size_t buf_size) {
+    redacted_path_t view;
+    size_t suffix_len;
+    
+    if (!privacy_redact_path(path, redact_enabled, &view)) {
+        return path;
     }
     
-    /* Special case: /root without trailing slash */
-    if (strcmp(path, "/root") == 0) {
-        return strdup("/home/ROOT");
+    suffix_len = strlen(view.suffix);
+    if (!buf || view.prefix_len + suffix_len + 1 > buf_size) {
+        return NULL;
     }
     
-    /* Rule 3: System paths - no redaction */
-    if (strncmp(path, "/etc/", 5) == 0 ||
-        strncmp(path, "/usr/", 5) == 0 ||
-        strncmp(path, "/lib/", 5) == 0 ||
-        strncmp(path, "/lib64/", 7) == 0 ||
-        strncmp(path, "/var/lib/", 9) == 0 ||
-        strncmp(path, "/sys/", 5) == 0 ||
-        strncmp(path, "/proc/", 6) == 0 ||
-        strncmp(path, "/dev/", 5) == 0 ||
-        strncmp(path, "/tmp/", 5) == 0 ||
-        strncmp(path, "/opt/", 5) == 0 ||
-        strncmp(path, "/bin/", 5) == 0 ||
-        strncmp(path, "/sbin/", 6) == 0) {
+    memcpy(buf, view.prefix, view.prefix_len);
+    memcpy(buf + view.prefix_len, view.suffix, suffix_len + 1);
+    return buf;
+}
+
+/**
+ * Apply path redaction for privacy protection
+ * 
+ * @param path Original path
+ * @param redact_enabled Whether redaction is enabled (false if --no-redact)
+ * @return Redacted path (caller must free), or NULL on failure
+ */
+char *privacy_filter_path(const char *path, bool redact_enabled) {
+    redacted_path_t view;
+    size_t suffix_len;
+    char *result;
+    
+    if (!path) {
+        return NULL;
+    }
+    
+    if (!privacy_redact_path(path, redact_enabled, &view)) {
         return strdup(path);
     }
     
-    /* Default: return copy of original path */
-    return strdup(path);
+    suffix_len = strlen(view.suffix);
+    result = (char *)malloc(view.prefix_len + suffix_len + 1);
+    if (!result) {
+        return NULL;
+    }
+    memcpy(result, view.prefix, view.prefix_len);
+    memcpy(result + view.prefix_len, view.suffix, suffix_len + 1);
+    return result;
 }
 
 /**
@@ -0,0 +1,364 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * proc_cache.c - Per-process /proc enrichment cache implementation
+ * Fixed-capacity hash table keyed by PID; the process start time from
+ * the event header detects PID reuse. Full tables evict with a CLOCK
+ * (second chance) sweep.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "include/proc_cache.h"
+#include "include/event_processor.h"
+#include "include/logger.h"
+
+/* Cache slot */
+typedef struct {
+    proc_cache_entry_t data;       /* Cached strings (owned by the cache) */
+    pid_t pid;
+    uint64_t start_time_ns;
+    bool used;
+    bool referenced;               /* CLOCK reference bit */
+    bool cmdline_loaded;           /* cmdline was read (even if unavailable) */
+    int32_t next;                  /* Next slot in bucket chain or free list */
+} cache_slot_t;
+
+/* Proc cache structure */
+struct proc_cache {
+    cache_slot_t *slots;
+    int32_t *buckets;              /* Head slot index per bucket (-1 = empty) */
+    size_t capacity;
+    size_t bucket_mask;
+    size_t count;
+    size_t clock_hand;
+    int32_t free_head;             /* First unused slot (-1 = table full) */
+    int32_t pending_evict;         /* Slot to drop on the next call (-1 = none) */
+    proc_cache_loader_t loader;
+    void *loader_ctx;
+    proc_cache_stats_t stats;
+};
+
+static size_t bucket_of(const proc_cache_t *cache, pid_t pid) {
+    return ((uint32_t)pid * 2654435761U) & cache->bucket_mask;
+}
+
+static void free_slot_data(cache_slot_t *slot) {
+    free((char *)slot->data.comm);
+    free((char *)slot->data.exe);
+    free((char *)slot->data.cmdline);
+    memset(&slot->data, 0, sizeof(slot->data));
+    slot->cmdline_loaded = false;
+}
+
+/**
+ * Read a process's metadata from /proc
+ * The default loader; with PROC_CACHE_CMDLINE_ONLY only the command line
+ */
+void proc_cache_read_proc(pid_t pid, uint64_t start_time_ns, unsigned int flags,
+                          proc_cache_entry_t *entry, void *ctx) {
+    char *value;
+    
+    (void)start_time_ns;
+    (void)ctx;
+    memset(entry, 0, sizeof(*entry));
+    
+    if (!(flags & PROC_CACHE_CMDLINE_ONLY)) {
+        if (enrich_process_name(pid, &value) == 0) {
+            entry->comm = value;
+        }
+        if (enrich_executable_path(pid, &value) == 0) {
+            entry->exe = value;
+        }
+    }
+    if (flags & PROC_CACHE_NEED_CMDLINE) {
+        if (enrich_cmdline(pid, &value) == 0) {
+            entry->cmdline = value;
+        }
+    }
+}
+
+/**
+ * Load a process's metadata into a slot
+ */
+static void load_slot(proc_cache_t *cache, cache_slot_t *slot, unsigned int flags) {
+    free_slot_data(slot);
+    
+    cache->loader(slot->pid, slot->start_time_ns, flags, &slot->data, cache->loader_ctx);
+    if (flags & PROC_CACHE_NEED_CMDLINE) {
+        slot->cmdline_loaded = true;
+    } else {
+        free((char *)slot->data.cmdline);
+        slot->data.cmdline = NULL;
+    }
+}
+
+static int32_t find_slot(const proc_cache_t *cache, pid_t pid) {
+    int32_t idx = cache->buckets[bucket_of(cache, pid)];
+    
+    while (idx >= 0 && cache->slots[idx].pid != pid) {
+        idx = cache->slots[idx].next;
+    }
+    
+    return idx;
+}
+
+/**
+ * Unlink a slot from its bucket, free its data and return it to the free list
+ */
+static void remove_slot(proc_cache_t *cache, int32_t idx) {
+    cache_slot_t *slot = &cache->slots[idx];
+    int32_t *link = &cache->buckets[bucket_of(cache, slot->pid)];
+    
+    while (*link >= 0 && *link != idx) {
+        link = &cache->slots[*link].next;
+    }
+    if (*link == idx) {
+        *link = slot->next;
+    }
+    
+    free_slot_data(slot);
+    slot->used = false;
+    slot->referenced = false;
+    slot->next = cache->free_head;
+    cache->free_head = idx;
+    cache->count--;
+}
+
+/**
+ * Evict one entry using the CLOCK algorithm
+ * Recently referenced entries get a second chance
+ */
+static void evict_one(proc_cache_t *cache) {
+    for (size_t scanned = 0; scanned < 2 * cache->capacity; scanned++) {
+        cache_slot_t *slot = &cache->slots[cache->clock_hand];
+        int32_t idx = (int32_t)cache->clock_hand;
+        
+        cache->clock_hand = (cache->clock_hand + 1) % cache->capacity;
+        
+        if (!slot->used) {
+            continue;
+        }
+        if (slot->referenced) {
+            slot->referenced = false;
+            continue;
+        }
+        
+        remove_slot(cache, idx);
+        cache->stats.evictions++;
+        return;
+    }
+}
+
+/**
+ * Drop the entry of an exited process once its last event is done
+ */
+static void process_pending_eviction(proc_cache_t *cache) {
+    if (cache->pending_evict >= 0) {
+        if (cache->slots[cache->pending_evict].used) {
+            remove_slot(cache, cache->pending_evict);
+        }
+        cache->pending_evict = -1;
+    }
+}
+
+/**
+ * Create a new proc cache
+ *
+ * @param capacity Maximum number of cached processes (0 = default)
+ * @return Pointer to cache, or NULL on failure
+ */
+proc_cache_t *proc_cache_create(size_t capacity) {
+    proc_cache_t *cache;
+    size_t buckets = 1;
+    
+    if (capacity == 0) {
+        capacity = PROC_CACHE_DEFAULT_CAPACITY;
+    }
+    
+    while (buckets < capacity) {
+        buckets <<= 1;
+    }
+    
+    cache = calloc(1, sizeof(*cache));
+    if (!cache) {
+        log_error("Failed to allocate proc cache");
+        return NULL;
+    }
+    
+    cache->slots = calloc(capacity, sizeof(*cache->slots));
+    cache->buckets = malloc(buckets * sizeof(*cache->buckets));
+    if (!cache->slots || !cache->buckets) {
+        log_error("Failed to allocate proc cache table");
+        free(cache->slots);
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < buckets; i++) {
+        cache->buckets[i] = -1;
+    }
+    
+    /* Chain all slots into the free list */
+    for (size_t i = 0; i < capacity; i++) {
+        cache->slots[i].next = (i + 1 < capacity) ? (int32_t)(i + 1) : -1;
+    }
+    
+    cache->capacity = capacity;
+    cache->bucket_mask = buckets - 1;
+    cache->free_head = 0;
+    cache->pending_evict = -1;
+    cache->loader = proc_cache_read_proc;
+    cache->stats.capacity = capacity;
+    
+    log_debug("Proc cache created with capacity: %zu", capacity);
+    
+    return cache;
+}
+
+/**
+ * Destroy a proc cache and free all cached strings
+ */
+void proc_cache_destroy(proc_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    
+    for (size_t i = 0; i < cache->capacity; i++) {
+        if (cache->slots[i].used) {
+            free_slot_data(&cache->slots[i]);
+        }
+    }
+    
+    free(cache->slots);
+    free(cache->buckets);
+    free(cache);
+}
+
+/**
+ * Look up a process, reading /proc on a miss
+ * A cached entry whose start time differs belongs to an earlier process
+ * with the same PID and is reloaded.
+ *
+ * @param cache Proc cache
+ * @param pid Process ID
+ * @param start_time_ns Process start time from the event (0 = unknown)
+ * @param flags PROC_CACHE_* lookup flags
+ * @return Cached entry, valid until the next call on the cache, or NULL
+ */
+const proc_cache_entry_t *proc_cache_lookup(proc_cache_t *cache, pid_t pid,
+                                            uint64_t start_time_ns, unsigned int flags) {
+    cache_slot_t *slot;
+    int32_t idx;
+    
+    if (!cache || pid <= 0) {
+        return NULL;
+    }
+    
+    process_pending_eviction(cache);
+    
+    idx = find_slot(cache, pid);
+    if (idx >= 0) {
+        slot = &cache->slots[idx];
+        
+        if (slot->start_time_ns != start_time_ns || (flags & PROC_CACHE_REFRESH)) {
+            /* PID reused or process called exec: cached data is stale */
+            cache->stats.invalidations++;
+            cache->stats.misses++;
+            slot->start_time_ns = start_time_ns;
+            load_slot(cache, slot, flags);
+        } else if ((flags & PROC_CACHE_NEED_CMDLINE) && !slot->cmdline_loaded) {
+            proc_cache_entry_t loaded;
+            
+            cache->stats.misses++;
+            cache->loader(pid, start_time_ns, flags | PROC_CACHE_CMDLINE_ONLY, &loaded,
+                          cache->loader_ctx);
+            free((char *)loaded.comm);
+            free((char *)loaded.exe);
+            slot->data.cmdline = loaded.cmdline;
+            slot->cmdline_loaded = true;
+        } else {
+            cache->stats.hits++;
+        }
+    } else {
+        if (cache->free_head < 0) {
+            evict_one(cache);
+            if (cache->free_head < 0) {
+                return NULL;
+            }
+        }
+        
+        idx = cache->free_head;
+        slot = &cache->slots[idx];
+        cache->free_head = slot->next;
+        
+        slot->pid = pid;
+        slot->start_time_ns = start_time_ns;
+        slot->used = true;
+        slot->next = cache->buckets[bucket_of(cache, pid)];
+        cache->buckets[bucket_of(cache, pid)] = idx;
+        cache->count++;
+        
+        cache->stats.misses++;
+        load_slot(cache, slot, flags);
+    }
+    
+    slot->referenced = true;
+    
+    if (flags & PROC_CACHE_LAST_USE) {
+        cache->stats.invalidations++;
+        cache->pending_evict = idx;
+    }
+    
+    return &slot->data;
+}
+
+/**
+ * Drop a process from the cache
+ */
+void proc_cache_invalidate(proc_cache_t *cache, pid_t pid) {
+    int32_t idx;
+    
+    if (!cache) {
+        return;
+    }
+    
+    process_pending_eviction(cache);
+    
+    idx = find_slot(cache, pid);
+    if (idx >= 0) {
+        remove_slot(cache, idx);
+        cache->stats.invalidations++;
+    }
+}
+
+/**
+ * Replace where cache misses read metadata from
+ * 
+ * @param loader Loader, or NULL for proc_cache_read_proc()
+ */
+void proc_cache_set_loader(proc_cache_t *cache, proc_cache_loader_t loader, void *ctx) {
+    if (!cache) {
+        return;
+    }
+    
+    cache->loader = loader ? loader : proc_cache_read_proc;
+    cache->loader_ctx = ctx;
+}
+
+/**
+ * Get cache statistics
+ */
+void proc_cache_get_stats(proc_cache_t *cache, proc_cache_stats_t *stats) {
+    if (!cache || !stats) {
+        return;
+    }
+    
+    *stats = cache->stats;
+    stats->entries = cache->count;
+}
@@ -8,7 +8,7 @@
  * Implements process discovery, library detection, and open file scanning
  */
 
-#define _XOPEN_SOURCE 500
+#define _XOPEN_SOURCE 700
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,95 +17,31 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <ctype.h>
 #include <limits.h>
 #include "include/proc_scanner.h"
+#include "include/crypto_classifier.h"
 
 /* Initial capacity for dynamic arrays */
 #define INITIAL_CAPACITY 16
 
-/* Proc scanner structure */
-struct proc_scanner {
-    bool verbose;  /* Enable verbose logging */
-};
+/* Chunk size of arenas created by the lists themselves */
+#define LIST_ARENA_CHUNK 4096
 
-/* Crypto library names to detect */
-static const char *crypto_libraries[] = {
-    "libssl",
-    "libcrypto",
-    "libgnutls",
-    "libsodium",
-    "libnss3",
-    "libmbedtls",
-    NULL
-};
+/* Bytes read from /proc/[pid]/maps per read() call */
+#define MAPS_READ_CHUNK (64 * 1024)
 
-/* Crypto file extensions to detect */
-static const char *crypto_extensions[] = {
-    ".pem",
-    ".crt",
-    ".cer",
-    ".key",
-    ".p12",
-    ".pfx",
-    ".jks",
-    ".keystore",
-    NULL
+/* Proc scanner structure
+ * Read-only after creation apart from the internally locked library
+ * table, so the *_at functions can be shared by threads */
+struct proc_scanner {
+    bool verbose;  /* Enable verbose logging */
+    path_intern_t *libraries;  /* Every crypto library path seen */
+    const crypto_classifier_t *classifier;
 };
 
-/**
- * Check if a string ends with a given suffix
- */
-static bool str_ends_with(const char *str, const char *suffix) {
-    if (!str || !suffix) {
-        return false;
-    }
-    
-    size_t str_len = strlen(str);
-    size_t suffix_len = strlen(suffix);
-    
-    if (suffix_len > str_len) {
-        return false;
-    }
-    
-    return strcmp(str + str_len - suffix_len, suffix) == 0;
-}
-
-/**
- * Check if a path contains a crypto library name
- */
-static bool is_crypto_library(const char *path) {
-    if (!path) {
-        return false;
-    }
-    
-    for (int i = 0; crypto_libraries[i] != NULL; i++) {
-        if (strstr(path, crypto_libraries[i]) != NULL) {
-            return true;
-        }
-    }
-    
-    return false;
-}
-
-/**
- * Check if a path is a crypto file based on extension
- */
-static bool is_crypto_file(const char *path) {
-    if (!path) {
-        return false;
-    }
-    
-    for (int i = 0; crypto_extensions[i] != NULL; i++) {
-        if (str_ends_with(path, crypto_extensions[i])) {
-            return true;
-        }
-    }
-    
-    return false;
-}
-
 /**
  * Extract library name from full path
  * Example: /usr/lib/x86_64-linux-gnu/libssl.so.1.1 -> libssl
@@ -134,17 +70,17 @@ static void extract_library_name(const char *path, char *name, size_t name_size)
 }
 
 /**
- * Read a file into a buffer
+ * Read a file relative to a /proc/[pid] directory into a buffer
  * Returns number of bytes read, or -1 on error
  */
-static ssize_t read_file(const char *path, char *buffer, size_t buffer_size) {
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
+static ssize_t read_file_at(int dirfd, const char *name, char *buffer, size_t buffer_size) {
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
         return -1;
     }
     
-    ssize_t bytes_read = fread(buffer, 1, buffer_size - 1, fp);
-    fclose(fp);
+    ssize_t bytes_read = read(fd, buffer, buffer_size - 1);
+    close(fd);
     
     if (bytes_read > 0) {
         buffer[bytes_read] = '\0';
@@ -154,13 +90,29 @@ static ssize_t read_file(const char *path, char *buffer, size_t buffer_size) {
 }
 
 /**
- * Read /proc/[pid]/comm
+ * Open a file relative to a /proc/[pid] directory as a stdio stream
  */
-static int read_proc_comm(pid_t pid, char *comm, size_t comm_size) {
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+static FILE *fopen_at(int dirfd, const char *name) {
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+    FILE *fp;
+    
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    fp = fdopen(fd, "r");
+    if (!fp) {
+        close(fd);
+    }
     
-    ssize_t bytes = read_file(path, comm, comm_size);
+    return fp;
+}
+
+/**
+ * Read /proc/[pid]/comm
+ */
+static int read_proc_comm(int pid_fd, char *comm, size_t comm_size) {
+    ssize_t bytes = read_file_at(pid_fd, "comm", comm, comm_size);
     if (bytes <= 0) {
         return -1;
     }
@@ -174,31 +126,28 @@ static int read_proc_comm(pid_t pid, char *comm, size_t comm_size) {
 }
 
 /**
- * Read /proc/[pid]/exe
+ * Read /proc/[pid]/exe into the arena
+ * Returns the path, or NULL on error
  */
-static int read_proc_exe(pid_t pid, char *exe, size_t exe_size) {
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%d/exe", pid);
-    
-    ssize_t bytes = readlink(path, exe, exe_size - 1);
+static const char *read_proc_exe(int pid_fd, string_arena_t *arena) {
+    char exe[MAX_PATH_LEN];
+    ssize_t bytes = readlinkat(pid_fd, "exe", exe, sizeof(exe) - 1);
     if (bytes <= 0) {
-        return -1;
+        return NULL;
     }
     
-    exe[bytes] = '\0';
-    return 0;
+    return string_arena_strndup(arena, exe, (size_t)bytes);
 }
 
 /**
- * Read /proc/[pid]/cmdline
+ * Read /proc/[pid]/cmdline into the arena
+ * Returns the command line, or NULL on error
  */
-static int read_proc_cmdline(pid_t pid, char *cmdline, size_t cmdline_size) {
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
-    
-    ssize_t bytes = read_file(path, cmdline, cmdline_size);
+static const char *read_proc_cmdline(int pid_fd, string_arena_t *arena) {
+    char cmdline[MAX_CMDLINE_LEN];
+    ssize_t bytes = read_file_at(pid_fd, "cmdline", cmdline, sizeof(cmdline));
     if (bytes <= 0) {
-        return -1;
+        return NULL;
     }
     
     /* Replace null bytes with spaces for readability */
@@ -208,19 +157,16 @@ static int read_proc_cmdline(pid_t pid, char *cmdline, size_t cmdline_size) {
         }
     }
     
-    return 0;
+    return string_arena_strndup(arena, cmdline, (size_t)bytes);
 }
 
 /**
  * Read /proc/[pid]/status to get UID and GID
  */
-static int read_proc_status(pid_t pid, uid_t *uid, gid_t *gid) {
-    char path[256];
+static int read_proc_status(int pid_fd, uid_t *uid, gid_t *gid) {
     char buffer[4096];
     
-    snprintf(path, sizeof(path), "/proc/%d/status", pid);
-    
-    FILE *fp = fopen(path, "r");
+    FILE *fp = fopen_at(pid_fd, "status");
     if (!fp) {
         return -1;
     }
@@ -257,13 +203,34 @@ static int read_proc_status(pid_t pid, uid_t *uid, gid_t *gid) {
 
 /* List management functions */
 
+/**
+ * Arena for a list's strings, created on first use if the list owns it
+ */
+static string_arena_t *list_arena(string_arena_t **arena, bool *owns_arena) {
+    if (!*arena) {
+        *arena = string_arena_create(LIST_ARENA_CHUNK);
+        *owns_arena = (*arena != NULL);
+    }
+    
+    return *arena;
+}
+
 void process_list_init(process_list_t *list) {
+    process_list_init_arena(list, NULL);
+}
+
+void process_list_init_arena(process_list_t *list, string_arena_t *arena) {
     list->processes = NULL;
     list->count = 0;
     list->capacity = 0;
+    list->arena = arena;
+    list->owns_arena = false;
 }
 
-int process_list_add(process_list_t *list, const process_info_t *info) {
+/**
+ * Append an entry whose strings already live in the list's arena
+ */
+static int process_list_append(process_list_t *list, const process_info_t *info) {
     if (list->count >= list->capacity) {
         size_t new_capacity = list->capacity == 0 ? INITIAL_CAPACITY : list->capacity * 2;
         process_info_t *new_processes = realloc(list->processes, 
@@ -279,23 +246,49 @@ int process_list_add(process_list_t *list, const process_info_t *info) {
     return 0;
 }
 
+int process_list_add(process_list_t *list, const process_info_t *info) {
+    string_arena_t *arena = list_arena(&list->arena, &list->owns_arena);
+    process_info_t copy = *info;
+    
+    if (!arena) {
+        return -1;
+    }
+    
+    copy.exe = string_arena_strdup(arena, info->exe);
+    copy.cmdline = string_arena_strdup(arena, info->cmdline);
+    if ((info->exe && !copy.exe) || (info->cmdline && !copy.cmdline)) {
+        return -1;
+    }
+    
+    return process_list_append(list, &copy);
+}
+
 void process_list_free(process_list_t *list) {
     free(list->processes);
-    list->processes = NULL;
-    list->count = 0;
-    list->capacity = 0;
+    if (list->owns_arena) {
+        string_arena_destroy(list->arena);
+    }
+    process_list_init(list);
 }
 
 void library_list_init(library_list_t *list) {
+    library_list_init_arena(list, NULL);
+}
+
+void library_list_init_arena(library_list_t *list, string_arena_t *arena) {
     list->libraries = NULL;
     list->count = 0;
     list->capacity = 0;
+    list->arena = arena;
+    list->owns_arena = false;
 }
 
 int library_list_add(library_list_t *list, const library_info_t *info) {
     /* Check for duplicates */
     for (size_t i = 0; i < list->count; i++) {
-        if (strcmp(list->libraries[i].path, info->path) == 0) {
+        const library_info_t *lib = &list->libraries[i];
+        if (info->interned && lib->interned ? lib->path_id == info->path_id
+                                            : strcmp(lib->path, info->path) == 0) {
             return 0;  /* Already in list */
         }
     }
@@ -311,21 +304,39 @@ int library_list_add(library_list_t *list, const library_info_t *info) {
         list->capacity = new_capacity;
     }
     
-    list->libraries[list->count++] = *info;
+    string_arena_t *arena = list_arena(&list->arena, &list->owns_arena);
+    library_info_t copy = {
+        .path = info->interned ? info->path : string_arena_strdup(arena, info->path),
+        .name = string_arena_strdup(arena, info->name),
+        .path_id = info->path_id,
+        .interned = info->interned,
+    };
+    if (!copy.path || !copy.name) {
+        return -1;
+    }
+    
+    list->libraries[list->count++] = copy;
     return 0;
 }
 
 void library_list_free(library_list_t *list) {
     free(list->libraries);
-    list->libraries = NULL;
-    list->count = 0;
-    list->capacity = 0;
+    if (list->owns_arena) {
+        string_arena_destroy(list->arena);
+    }
+    library_list_init(list);
 }
 
 void file_list_init(file_list_t *list) {
+    file_list_init_arena(list, NULL);
+}
+
+void file_list_init_arena(file_list_t *list, string_arena_t *arena) {
     list->files = NULL;
     list->count = 0;
     list->capacity = 0;
+    list->arena = arena;
+    list->owns_arena = false;
 }
 
 int file_list_add(file_list_t *list, const file_info_t *info) {
@@ -347,15 +358,24 @@ int file_list_add(file_list_t *list, const file_info_t *info) {
         list->capacity = new_capacity;
     }
     
-    list->files[list->count++] = *info;
+    file_info_t copy = {
+        .path = string_arena_strdup(list_arena(&list->arena, &list->owns_arena), info->path),
+        .fd = info->fd,
+    };
+    if (!copy.path) {
+        return -1;
+    }
+    
+    list->files[list->count++] = copy;
     return 0;
 }
 
 void file_list_free(file_list_t *list) {
     free(list->files);
-    list->files = NULL;
-    list->count = 0;
-    list->capacity = 0;
+    if (list->owns_arena) {
+        string_arena_destroy(list->arena);
+    }
+    file_list_init(list);
 }
 
 /* Proc scanner functions */
@@ -367,15 +387,51 @@ proc_scanner_t *proc_scanner_create(void) {
     }
     
     scanner->verbose = false;
+    scanner->classifier = crypto_classifier_default();
+    scanner->libraries = path_intern_create();
+    if (!scanner->libraries) {
+        free(scanner);
+        return NULL;
+    }
     return scanner;
 }
 
 void proc_scanner_destroy(proc_scanner_t *scanner) {
+    if (!scanner) {
+        return;
+    }
+    
+    path_intern_destroy(scanner->libraries);
     free(scanner);
 }
 
-int proc_scanner_scan_processes(proc_scanner_t *scanner, process_list_t *processes) {
-    if (!scanner || !processes) {
+path_intern_t *proc_scanner_library_table(proc_scanner_t *scanner) {
+    return scanner ? scanner->libraries : NULL;
+}
+
+/**
+ * Parse a /proc directory entry name as a PID
+ * Returns the PID, or 0 for non-process entries
+ */
+static pid_t parse_pid(const char *name) {
+    char *endptr;
+    long pid_long;
+    
+    /* Skip non-numeric entries */
+    if (!isdigit((unsigned char)name[0])) {
+        return 0;
+    }
+    
+    pid_long = strtol(name, &endptr, 10);
+    if (*endptr != '\0' || pid_long <= 0 || pid_long > INT_MAX) {
+        return 0;
+    }
+    
+    return (pid_t)pid_long;
+}
+
+int proc_scanner_list_pids(proc_scanner_t *scanner, pid_t **pids, size_t *count) {
+    if (!scanner || !pids || !count) {
         return -1;
     }
     
@@ -384,27 +440,73 @@ int proc_scanner_scan_processes(proc_scanner_t *scanner, process_list_t *process
         return -1;
     }
     
+    pid_t *list = NULL;
+    size_t list_count = 0;
+    size_t list_capacity = 0;
     struct dirent *entry;
+    
     while ((entry = readdir(proc_dir)) != NULL) {
-        /* Skip non-numeric entries */
-        if (!isdigit(entry->d_name[0])) {
+        pid_t pid = parse_pid(entry->d_name);
+        if (pid == 0) {
             continue;
         }
         
-        /* Parse PID */
-        char *endptr;
-        long pid_long = strtol(entry->d_name, &endptr, 10);
-        if (*endptr != '\0' || pid_long <= 0 || pid_long > INT_MAX) {
+        if (list_count >= list_capacity) {
+            size_t new_capacity = list_capacity == 0 ? INITIAL_CAPACITY * 64 : list_capacity * 2;
+            pid_t *new_list = realloc(list, new_capacity * sizeof(pid_t));
+            if (!new_list) {
+                free(list);
+                closedir(proc_dir);
+                return -1;
+            }
+            list = new_list;
+            list_capacity = new_capacity;
+        }
+        
+        list[list_count++] = pid;
+    }
+    
+    closedir(proc_dir);
+    
+    *pids = list;
+    *count = list_count;
+    return 0;
+}
+
+int proc_scanner_scan_processes(proc_scanner_t *scanner, process_list_t *processes) {
+    if (!scanner || !processes) {
+        return -1;
+    }
+    
+    string_arena_t *arena = list_arena(&processes->arena, &processes->owns_arena);
+    if (!arena) {
+        return -1;
+    }
+    
+    DIR *proc_dir = opendir("/proc");
+    if (!proc_dir) {
+        return -1;
+    }
+    
+    struct dirent *entry;
+    while ((entry = readdir(proc_dir)) != NULL) {
+        pid_t pid = parse_pid(entry->d_name);
+        if (pid == 0) {
             continue;
         }
         
-        pid_t pid = (pid_t)pid_long;
         process_info_t info;
+        int pid_fd = proc_scanner_open_pid(dirfd(proc_dir), pid);
+        if (pid_fd < 0) {
+            continue;  /* Process exited since readdir */
+        }
         
-        /* Get process information - handle errors gracefully (Requirement 15.2) */
-        if (proc_scanner_get_process_info(scanner, pid, &info) == 0) {
-            process_list_add(processes, &info);
+        /* Get process information - handle errors gracefully (Requirement 15.2)
+         * Strings are read straight into the list's arena */
+        if (proc_scanner_get_process_info_at(scanner, pid_fd, pid, &info, arena) == 0) {
+            process_list_append(processes, &info);
         }
+        close(pid_fd);
         /* Continue scanning even if one process fails */
     }
     
@@ -412,7 +514,44 @@ int proc_scanner_scan_processes(proc_scanner_t *scanner, process_list_t *process
     return 0;
 }
 
-int proc_scanner_get_process_info(proc_scanner_t *scanner, pid_t pid, process_info_t *info) {
+/**
+ * Open /proc/[pid] by absolute path (single-process lookups)
+ */
+static int open_pid_dir(pid_t pid) {
+    char path[32];
+    
+    snprintf(path, sizeof(path), "/proc/%d", pid);
+    return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+int proc_scanner_open_pid(int proc_fd, pid_t pid) {
+    char name[16];
+    
+    snprintf(name, sizeof(name), "%d", pid);
+    return openat(proc_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+int proc_scanner_get_process_info(proc_scanner_t *scanner, pid_t pid, process_info_t *info,
+                                  string_arena_t *arena) {
+    if (!scanner || !info) {
+        return -1;
+    }
+    
+    int pid_fd = open_pid_dir(pid);
+    if (pid_fd < 0) {
+        /* Leave info describing a missing process */
+        memset(info, 0, sizeof(process_info_t));
+        info->pid = pid;
+        return -1;
+    }
+    
+    int ret = proc_scanner_get_process_info_at(scanner, pid_fd, pid, info, arena);
+    close(pid_fd);
+    return ret;
+}
+
+int proc_scanner_get_process_info_at(proc_scanner_t *scanner, int pid_fd, pid_t pid,
+                                     process_info_t *info, string_arena_t *arena) {
     if (!scanner || !info) {
         return -1;
     }
@@ -421,22 +560,26 @@ int proc_scanner_get_process_info(proc_scanner_t *scanner, pid_t pid, process_in
     info->pid = pid;
     
     /* Read comm - required */
-    if (read_proc_comm(pid, info->comm, sizeof(info->comm)) != 0) {
+    if (read_proc_comm(pid_fd, info->comm, sizeof(info->comm)) != 0) {
         return -1;  /* Process likely doesn't exist or we don't have permission */
     }
     
-    /* Read exe - optional (may fail for kernel threads) */
-    if (read_proc_exe(pid, info->exe, sizeof(info->exe)) != 0) {
-        strcpy(info->exe, "[unknown]");
-    }
-    
-    /* Read cmdline - optional */
-    if (read_proc_cmdline(pid, info->cmdline, sizeof(info->cmdline)) != 0) {
-        strcpy(info->cmdline, "");
+    /* Read exe and cmdline - optional, and skipped without an arena */
+    if (arena) {
+        /* exe may fail for kernel threads */
+        info->exe = read_proc_exe(pid_fd, arena);
+        if (!info->exe) {
+            info->exe = "[unknown]";
+        }
+        
+        info->cmdline = read_proc_cmdline(pid_fd, arena);
+        if (!info->cmdline) {
+            info->cmdline = "";
+        }
     }
     
     /* Read UID/GID - optional */
-    if (read_proc_status(pid, &info->uid, &info->gid) != 0) {
+    if (read_proc_status(pid_fd, &info->uid, &info->gid) != 0) {
         info->uid = (uid_t)-1;
         info->gid = (gid_t)-1;
     }
@@ -449,54 +592,177 @@ int proc_scanner_get_loaded_libraries(proc_scanner_t *scanner, pid_t pid, librar
         return -1;
     }
     
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%d/maps", pid);
+    int pid_fd = open_pid_dir(pid);
+    if (pid_fd < 0) {
+        return -1;  /* Process doesn't exist or no permission */
+    }
     
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
+    int ret = proc_scanner_get_loaded_libraries_at(scanner, pid_fd, libs);
+    close(pid_fd);
+    return ret;
+}
+
+/**
+ * Skip a maps field and the spaces after it
+ */
+static char *skip_maps_field(char *p, const char *end) {
+    while (p < end && *p != ' ') {
+        p++;
+    }
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Split a /proc/[pid]/maps line (without its newline)
+ * Format: address perms offset dev inode pathname
+ * Example: 7f1234567000-7f1234568000 r-xp 00000000 08:01 12345 /usr/lib/libssl.so.1.1
+ * Returns 0 and sets dev (major:minor as hex digits), inode and the
+ * pathname, or -1 on a malformed line
+ */
+static int parse_maps_line(char *line, char *end, uint64_t *dev, uint64_t *inode,
+                           char **pathname) {
+    char *p = line;
+    
+    for (int field = 0; field < 3; field++) {
+        p = skip_maps_field(p, end);
+    }
+    
+    /* dev: fold major:minor hex digits into one number */
+    *dev = 0;
+    for (; p < end && *p != ' '; p++) {
+        if (*p != ':') {
+            *dev = (*dev << 4) | (uint64_t)(isdigit((unsigned char)*p) ? *p - '0'
+                                                                     : (*p | 0x20) - 'a' + 10);
+        }
+    }
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    
+    *inode = 0;
+    if (p >= end || !isdigit((unsigned char)*p)) {
+        return -1;
+    }
+    for (; p < end && isdigit((unsigned char)*p); p++) {
+        *inode = *inode * 10 + (uint64_t)(*p - '0');
+    }
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    
+    *pathname = p;
+    return 0;
+}
+
+/**
+ * Record a crypto library mapping
+ */
+static void add_library_mapping(proc_scanner_t *scanner, library_list_t *libs, const char *pathname) {
+    char lib_name[256];
+    library_info_t lib_info = { .path = pathname, .name = lib_name };
+    
+    /* Every mapping of a library shares the table's copy of its path */
+    lib_info.path_id = path_intern_add(scanner->libraries, pathname, &lib_info.path);
+    lib_info.interned = lib_info.path_id != PATH_INTERN_INVALID;
+    if (!lib_info.interned) {
+        lib_info.path = pathname;
+    }
+    
+    extract_library_name(pathname, lib_name, sizeof(lib_name));
+    
+    library_list_add(libs, &lib_info);
+}
+
+/**
+ * Check one maps line (end points at its newline or the end of data)
+ */
+static void scan_maps_line(proc_scanner_t *scanner, library_list_t *libs, char *line, char *end,
+                           uint64_t *prev_dev, uint64_t *prev_inode) {
+    uint64_t dev, inode;
+    char *pathname;
+    
+    if (parse_maps_line(line, end, &dev, &inode, &pathname) != 0 || inode == 0 ||
+        (dev == *prev_dev && inode == *prev_inode)) {
+        return;
+    }
+    *prev_dev = dev;
+    *prev_inode = inode;
+    
+    /* Check if this is a crypto library */
+    *end = '\0';
+    if (pathname < end && crypto_classifier_is_library(scanner->classifier, pathname)) {
+        add_library_mapping(scanner, libs, pathname);
+    }
+}
+
+/**
+ * Scan /proc/[pid]/maps for crypto libraries
+ * The file is read in large chunks and split in place. A library is
+ * mapped as several consecutive segments of one file, so lines whose
+ * dev:inode matches the previous line are skipped before the path is
+ * looked at; anonymous and pseudo mappings (inode 0) are skipped too.
+ */
+int proc_scanner_get_loaded_libraries_at(proc_scanner_t *scanner, int pid_fd, library_list_t *libs) {
+    uint64_t prev_dev = 0, prev_inode = 0;
+    size_t buffered = 0;
+    ssize_t bytes_read;
+    char *buffer;
+    int fd;
+    
+    if (!scanner || !libs) {
+        return -1;
+    }
+    
+    fd = openat(pid_fd, "maps", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
         return -1;  /* Process doesn't exist or no permission */
     }
     
-    char line[MAX_PATH_LEN];
-    while (fgets(line, sizeof(line), fp)) {
-        /* Parse maps line format:
-         * address perms offset dev inode pathname
-         * Example: 7f1234567000-7f1234568000 r-xp 00000000 08:01 12345 /usr/lib/libssl.so.1.1
-         */
-        
-        /* Find the pathname (after the 5th whitespace) */
-        char *pathname = line;
-        int spaces = 0;
-        while (*pathname && spaces < 5) {
-            if (isspace(*pathname)) {
-                spaces++;
-                while (isspace(*pathname)) {
-                    pathname++;
-                }
-            } else {
-                pathname++;
-            }
+    buffer = malloc(MAPS_READ_CHUNK);
+    if (!buffer) {
+        close(fd);
+        return -1;
+    }
+    
+    for (;;) {
+        bytes_read = read(fd, buffer + buffered, MAPS_READ_CHUNK - 1 - buffered);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            break;
         }
+        buffered += (size_t)bytes_read;
+        
+        char *line = buffer;
+        char *buffer_end = buffer + buffered;
+        char *newline;
         
-        /* Remove trailing newline */
-        size_t len = strlen(pathname);
-        if (len > 0 && pathname[len - 1] == '\n') {
-            pathname[len - 1] = '\0';
+        while ((newline = memchr(line, '\n', (size_t)(buffer_end - line))) != NULL) {
+            scan_maps_line(scanner, libs, line, newline, &prev_dev, &prev_inode);
+            line = newline + 1;
         }
         
-        /* Check if this is a crypto library */
-        if (strlen(pathname) > 0 && is_crypto_library(pathname)) {
-            library_info_t lib_info;
-            strncpy(lib_info.path, pathname, sizeof(lib_info.path) - 1);
-            lib_info.path[sizeof(lib_info.path) - 1] = '\0';
-            
-            extract_library_name(pathname, lib_info.name, sizeof(lib_info.name));
-            
-            library_list_add(libs, &lib_info);
+        /* Keep the partial last line (with room for its terminator); drop a
+         * line too long for the buffer */
+        buffered = (size_t)(buffer_end - line);
+        if (buffered >= MAPS_READ_CHUNK - 1) {
+            buffered = 0;
+        } else if (line != buffer) {
+            memmove(buffer, line, buffered);
         }
     }
     
-    fclose(fp);
+    /* Last line without a trailing newline */
+    if (buffered > 0) {
+        scan_maps_line(scanner, libs, buffer, buffer + buffered, &prev_dev, &prev_inode);
+    }
+    
+    free(buffer);
+    close(fd);
     return 0;
 }
 
@@ -505,38 +771,51 @@ int proc_scanner_get_open_files(proc_scanner_t *scanner, pid_t pid, file_list_t
         return -1;
     }
     
-    char fd_dir_path[256];
-    snprintf(fd_dir_path, sizeof(fd_dir_path), "/proc/%d/fd", pid);
+    int pid_fd = open_pid_dir(pid);
+    if (pid_fd < 0) {
+        return -1;  /* Process doesn't exist or no permission */
+    }
     
-    DIR *fd_dir = opendir(fd_dir_path);
-    if (!fd_dir) {
+    int ret = proc_scanner_get_open_files_at(scanner, pid_fd, files);
+    close(pid_fd);
+    return ret;
+}
+
+int proc_scanner_get_open_files_at(proc_scanner_t *scanner, int pid_fd, file_list_t *files) {
+    if (!scanner || !files) {
+        return -1;
+    }
+    
+    int fd_dirfd = openat(pid_fd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd_dirfd < 0) {
         return -1;  /* Process doesn't exist or no permission */
     }
     
+    /* fdopendir takes ownership of fd_dirfd */
+    DIR *fd_dir = fdopendir(fd_dirfd);
+    if (!fd_dir) {
+        close(fd_dirfd);
+        return -1;
+    }
+    
     struct dirent *entry;
     while ((entry = readdir(fd_dir)) != NULL) {
         /* Skip . and .. */
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        if (entry->d_name[0] == '.') {
             continue;
         }
         
-        /* Build path to fd symlink */
-        char fd_link_path[512];
-        snprintf(fd_link_path, sizeof(fd_link_path), "%s/%s", fd_dir_path, entry->d_name);
-        
-        /* Read the symlink to get the actual file path */
+        /* Read the symlink relative to the fd directory to get the actual file path */
         char file_path[MAX_PATH_LEN];
-        ssize_t link_len = readlink(fd_link_path, file_path, sizeof(file_path) - 1);
+        ssize_t link_len = readlinkat(fd_dirfd, entry->d_name, file_path, sizeof(file_path) - 1);
         if (link_len <= 0) {
             continue;  /* Failed to read symlink */
         }
         file_path[link_len] = '\0';
         
         /* Check if this is a crypto file */
-        if (is_crypto_file(file_path)) {
-            file_info_t file_info;
-            strncpy(file_info.path, file_path, sizeof(file_info.path) - 1);
-            file_info.path[sizeof(file_info.path) - 1] = '\0';
+        if (crypto_classifier_file_type(scanner->classifier, file_path) != FILE_TYPE_UNKNOWN) {
+            file_info_t file_info = { .path = file_path };
             
             /* Parse FD number */
             char *endptr;
@@ -554,3 +833,34 @@ int proc_scanner_get_open_files(proc_scanner_t *scanner, pid_t pid, file_list_t
     closedir(fd_dir);
     return 0;
 }
+
+/**
+ * Add a mapped file found by another backend if it is a crypto library
+ *
+ * @return 1 if the path is a crypto library, 0 if not
+ */
+int proc_scanner_add_library_path(proc_scanner_t *scanner, library_list_t *libs, const char *path) {
+    if (!scanner || !libs || !path || !crypto_classifier_is_library(scanner->classifier, path)) {
+        return 0;
+    }
+    
+    add_library_mapping(scanner, libs, path);
+    return 1;
+}
+
+/**
+ * Add an open file found by another backend if it is a crypto file
+ *
+ * @return 1 if the path is a crypto file, 0 if not
+ */
+int proc_scanner_add_file_path(proc_scanner_t *scanner, file_list_t *files, const char *path, int fd) {
+    file_info_t file_info = { .path = path, .fd = fd };
+    
+    if (!scanner || !files || !path ||
+        crypto_classifier_file_type(scanner->classifier, path) == FILE_TYPE_UNKNOWN) {
+        return 0;
+    }
+    
+    file_list_add(files, &file_info);
+    return 1;
+}
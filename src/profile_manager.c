@@ -14,22 +14,28 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <time.h>
 #include <sys/types.h>
 #include "profile_manager.h"
 #include "crypto_tracer.h"
 #include "output_formatter.h"
 #include "event_processor.h"
+#include "privacy_filter.h"
+#include "handshake_latency.h"
 
-/* Maximum number of tracked profiles */
-#define MAX_TRACKED_PROFILES 1000
+/* Initial PID index size (power of two); the index doubles as needed */
+#define PROFILE_INDEX_INITIAL 64
+
+/* Initial size of a profile's key index (power of two) */
+#define KEY_INDEX_INITIAL 16
 
 /* Internal library entry */
 typedef struct library_entry {
     char *name;
     char *path;
     char *load_time;
-    struct library_entry *next;
+    bool flushed;              /* Included in a delta already */
 } library_entry_t;
 
 /* Internal file entry */
@@ -40,20 +46,44 @@ typedef struct file_entry {
     char *first_access;
     char *last_access;
     char *mode;
-    struct file_entry *next;
+    int delta_count;           /* Accesses since the last delta */
 } file_entry_t;
 
 /* Internal API call entry */
 typedef struct api_call_entry {
     char *function_name;
     int count;
-    struct api_call_entry *next;
+    int delta_count;           /* Calls since the last delta */
 } api_call_entry_t;
 
+/* Handshake functions a profile keeps latencies for (SSL_connect,
+ * SSL_accept, SSL_do_handshake) */
+#define PROFILE_HANDSHAKE_FUNCTIONS 3
+
+/* Internal handshake latency entry */
+typedef struct handshake_entry {
+    handshake_latency_t total;
+    handshake_latency_t delta;     /* Since the last delta */
+} handshake_entry_t;
+
+/* Open-addressing index from a string key to a position in an entry
+ * array. Keys are the entries' own copies, so the index keeps only a
+ * pointer and the hash. */
+typedef struct {
+    const char *key;
+    uint64_t hash;
+    uint32_t pos;
+} key_slot_t;
+
+typedef struct {
+    key_slot_t *slots;         /* key == NULL marks an empty slot */
+    size_t mask;               /* Slot count - 1 (slots == NULL until first insert) */
+    size_t count;
+} key_index_t;
+
 /* Internal profile tracking structure */
 typedef struct tracked_profile {
     pid_t pid;
-    bool active;
     time_t last_update;
     
     /* Process metadata */
@@ -64,30 +94,143 @@ typedef struct tracked_profile {
     uint32_t gid;
     char *start_time;
     
-    /* Aggregated data (linked lists for dynamic growth) */
+    /* Aggregated data: arrays in arrival order, each indexed by its key */
     library_entry_t *libraries;
     size_t library_count;
+    size_t library_capacity;
+    key_index_t library_index;     /* By path */
     
     file_entry_t *files;
     size_t file_count;
+    size_t file_capacity;
+    key_index_t file_index;        /* By path */
     
     api_call_entry_t *api_calls;
     size_t api_call_count;
+    size_t api_call_capacity;
+    key_index_t api_call_index;    /* By function name */
+    
+    handshake_entry_t handshakes[PROFILE_HANDSHAKE_FUNCTIONS];
+    size_t handshake_count;
     
     /* Statistics */
     int total_events;
     int libraries_loaded;
     int files_accessed;
     int api_calls_made;
+    
+    /* Activity since the last delta flush */
+    bool changed;
+    int delta_events;
+    int delta_libraries;
+    int delta_files;
+    int delta_api_calls;
+    
+    struct tracked_profile *next;  /* Retired list link */
 } tracked_profile_t;
 
-/* Profile manager structure */
+/* Profile manager structure
+ * Live profiles are found through an open-addressing PID index. When a
+ * process exits its profile leaves the index, so its slot is reused and
+ * a recycled PID starts a fresh profile, and moves to the retired list
+ * where it can still be retrieved or finalized. */
 struct profile_manager {
-    tracked_profile_t *profiles;
-    size_t count;
-    size_t capacity;
+    tracked_profile_t **slots;     /* PID index, NULL = empty */
+    size_t mask;                   /* Slot count - 1 */
+    size_t count;                  /* Live profiles */
+    tracked_profile_t *retired;    /* Exited profiles, most recent first */
 };
 
+static void free_tracked_profile(tracked_profile_t *profile);
+
+/**
+ * FNV-1a hash of a key
+ */
+static uint64_t hash_key(const char *key) {
+    uint64_t hash = 14695981039346656037ULL;
+    
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Find a key; returns its entry position or -1
+ */
+static long key_index_find(const key_index_t *index, const char *key, uint64_t hash) {
+    if (!index->slots) {
+        return -1;
+    }
+    
+    for (size_t slot = hash & index->mask; index->slots[slot].key;
+         slot = (slot + 1) & index->mask) {
+        if (index->slots[slot].hash == hash && strcmp(index->slots[slot].key, key) == 0) {
+            return index->slots[slot].pos;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Place a slot into a slot array (key known to be absent)
+ */
+static void key_index_place(key_slot_t *slots, size_t mask, key_slot_t entry) {
+    size_t slot = entry.hash & mask;
+    
+    while (slots[slot].key) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = entry;
+}
+
+/**
+ * Insert a key that is known to be absent, growing at 3/4 load
+ */
+static int key_index_insert(key_index_t *index, const char *key, uint64_t hash, size_t pos) {
+    key_slot_t entry = { key, hash, (uint32_t)pos };
+    
+    if (!index->slots || (index->count + 1) * 4 > (index->mask + 1) * 3) {
+        size_t new_size = index->slots ? (index->mask + 1) * 2 : KEY_INDEX_INITIAL;
+        key_slot_t *slots = calloc(new_size, sizeof(*slots));
+        if (!slots) {
+            return -1;
+        }
+        if (index->slots) {
+            for (size_t i = 0; i <= index->mask; i++) {
+                if (index->slots[i].key) {
+                    key_index_place(slots, new_size - 1, index->slots[i]);
+                }
+            }
+            free(index->slots);
+        }
+        index->slots = slots;
+        index->mask = new_size - 1;
+    }
+    
+    key_index_place(index->slots, index->mask, entry);
+    index->count++;
+    return 0;
+}
+
+/**
+ * Make room for one more entry in an entry array
+ * Returns the (possibly moved) array, or NULL on failure
+ */
+static void *reserve_entry(void *entries, size_t count, size_t *capacity, size_t size) {
+    if (count < *capacity) {
+        return entries;
+    }
+    
+    size_t new_capacity = *capacity ? *capacity * 2 : 8;
+    void *grown = realloc(entries, new_capacity * size);
+    if (grown) {
+        *capacity = new_capacity;
+    }
+    return grown;
+}
+
 /**
  * Create a new profile manager
  */
@@ -97,46 +240,158 @@ profile_manager_t *profile_manager_create(void) {
         return NULL;
     }
     
-    mgr->capacity = MAX_TRACKED_PROFILES;
-    mgr->profiles = calloc(mgr->capacity, sizeof(tracked_profile_t));
-    if (!mgr->profiles) {
+    mgr->slots = calloc(PROFILE_INDEX_INITIAL, sizeof(*mgr->slots));
+    if (!mgr->slots) {
         free(mgr);
         return NULL;
     }
     
+    mgr->mask = PROFILE_INDEX_INITIAL - 1;
     mgr->count = 0;
     return mgr;
 }
 
+/* Home slot of a PID (Fibonacci hashing spreads sequential PIDs) */
+static size_t pid_slot(const profile_manager_t *mgr, pid_t pid) {
+    return (size_t)(((uint64_t)(uint32_t)pid * 11400714819323198485ULL) >> 32) & mgr->mask;
+}
+
+/**
+ * Find the slot holding a live profile, or -1
+ */
+static long find_pid_slot(const profile_manager_t *mgr, pid_t pid) {
+    for (size_t slot = pid_slot(mgr, pid); mgr->slots[slot]; slot = (slot + 1) & mgr->mask) {
+        if (mgr->slots[slot]->pid == pid) {
+            return (long)slot;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Double the PID index
+ */
+static int grow_pid_index(profile_manager_t *mgr) {
+    size_t old_size = mgr->mask + 1;
+    tracked_profile_t **old = mgr->slots;
+    tracked_profile_t **slots = calloc(old_size * 2, sizeof(*slots));
+    
+    if (!slots) {
+        return -1;
+    }
+    
+    mgr->slots = slots;
+    mgr->mask = old_size * 2 - 1;
+    for (size_t i = 0; i < old_size; i++) {
+        if (old[i]) {
+            size_t slot = pid_slot(mgr, old[i]->pid);
+            while (mgr->slots[slot]) {
+                slot = (slot + 1) & mgr->mask;
+            }
+            mgr->slots[slot] = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * Remove the profile in a PID index slot
+ * Backward-shift deletion keeps probe chains intact without tombstones
+ */
+static tracked_profile_t *remove_pid_slot(profile_manager_t *mgr, size_t slot) {
+    tracked_profile_t *profile = mgr->slots[slot];
+    size_t hole = slot;
+    
+    mgr->slots[hole] = NULL;
+    for (size_t next = (hole + 1) & mgr->mask; mgr->slots[next]; next = (next + 1) & mgr->mask) {
+        size_t home = pid_slot(mgr, mgr->slots[next]->pid);
+        /* Move the entry back if the hole lies between its home and it */
+        if (((next - home) & mgr->mask) >= ((next - hole) & mgr->mask)) {
+            mgr->slots[hole] = mgr->slots[next];
+            mgr->slots[next] = NULL;
+            hole = next;
+        }
+    }
+    mgr->count--;
+    return profile;
+}
+
 /**
  * Find or create a tracked profile for a given PID
  */
 static tracked_profile_t *find_or_create_profile(profile_manager_t *mgr, pid_t pid) {
+    long found;
+    size_t slot;
+    
     if (!mgr) {
         return NULL;
     }
     
     /* Search for existing profile */
-    for (size_t i = 0; i < mgr->count; i++) {
-        if (mgr->profiles[i].pid == pid && mgr->profiles[i].active) {
-            return &mgr->profiles[i];
-        }
+    found = find_pid_slot(mgr, pid);
+    if (found >= 0) {
+        return mgr->slots[found];
     }
     
-    /* Create new profile if space available */
-    if (mgr->count >= mgr->capacity) {
-        return NULL;  /* No space for new profiles */
+    /* Keep the load factor under 3/4 */
+    if ((mgr->count + 1) * 4 > (mgr->mask + 1) * 3 && grow_pid_index(mgr) != 0) {
+        return NULL;
     }
     
-    tracked_profile_t *profile = &mgr->profiles[mgr->count++];
-    memset(profile, 0, sizeof(tracked_profile_t));
+    tracked_profile_t *profile = calloc(1, sizeof(tracked_profile_t));
+    if (!profile) {
+        return NULL;
+    }
     profile->pid = pid;
-    profile->active = true;
     profile->last_update = time(NULL);
     
+    slot = pid_slot(mgr, pid);
+    while (mgr->slots[slot]) {
+        slot = (slot + 1) & mgr->mask;
+    }
+    mgr->slots[slot] = profile;
+    mgr->count++;
+    
     return profile;
 }
 
+/**
+ * Retire a live profile when its process exits
+ */
+static void retire_profile(profile_manager_t *mgr, pid_t pid) {
+    long slot = find_pid_slot(mgr, pid);
+    
+    if (slot >= 0) {
+        tracked_profile_t *profile = remove_pid_slot(mgr, (size_t)slot);
+        profile->next = mgr->retired;
+        mgr->retired = profile;
+    }
+}
+
+/**
+ * Find a profile by PID: the live one, else the most recently retired
+ * If unlink is set, the profile is removed from the manager.
+ */
+static tracked_profile_t *lookup_profile(profile_manager_t *mgr, pid_t pid, bool unlink) {
+    long slot = find_pid_slot(mgr, pid);
+    
+    if (slot >= 0) {
+        return unlink ? remove_pid_slot(mgr, (size_t)slot) : mgr->slots[slot];
+    }
+    
+    for (tracked_profile_t **link = &mgr->retired; *link; link = &(*link)->next) {
+        tracked_profile_t *profile = *link;
+        if (profile->pid == pid) {
+            if (unlink) {
+                *link = profile->next;
+            }
+            return profile;
+        }
+    }
+    return NULL;
+}
+
 /**
  * Add a library to the profile (deduplicate by path)
  */
@@ -146,112 +401,136 @@ static int add_library(tracked_profile_t *profile, const char *name, const char
     }
     
     /* Check if library already exists */
-    library_entry_t *entry = profile->libraries;
-    while (entry) {
-        if (strcmp(entry->path, path) == 0) {
-            return 0;  /* Already exists, skip */
-        }
-        entry = entry->next;
+    uint64_t hash = hash_key(path);
+    if (key_index_find(&profile->library_index, path, hash) >= 0) {
+        return 0;  /* Already exists, skip */
     }
     
     /* Create new library entry */
-    entry = calloc(1, sizeof(library_entry_t));
-    if (!entry) {
+    library_entry_t *libraries = reserve_entry(profile->libraries, profile->library_count,
+                                               &profile->library_capacity, sizeof(*libraries));
+    if (!libraries) {
         return -1;
     }
+    profile->libraries = libraries;
     
-    entry->name = name ? strdup(name) : NULL;
+    library_entry_t *entry = &libraries[profile->library_count];
     entry->path = strdup(path);
+    if (!entry->path ||
+        key_index_insert(&profile->library_index, entry->path, hash, profile->library_count) != 0) {
+        free(entry->path);
+        return -1;
+    }
+    entry->name = name ? strdup(name) : NULL;
     entry->load_time = timestamp ? strdup(timestamp) : NULL;
     
-    /* Add to front of list */
-    entry->next = profile->libraries;
-    profile->libraries = entry;
+    entry->flushed = false;
+    
     profile->library_count++;
     profile->libraries_loaded++;
+    profile->delta_libraries++;
+    profile->changed = true;
     
     return 0;
 }
 
 /**
  * Add or update a file in the profile
+ * accesses is the number of opens the event stands for
  */
 static int add_or_update_file(tracked_profile_t *profile, const char *path, const char *type, 
-                               const char *timestamp, const char *mode) {
+                               const char *timestamp, const char *mode, int accesses) {
     if (!profile || !path) {
         return -1;
     }
     
     /* Check if file already exists */
-    file_entry_t *entry = profile->files;
-    while (entry) {
-        if (strcmp(entry->path, path) == 0) {
-            /* Update existing entry */
-            entry->access_count++;
-            if (entry->last_access) {
-                free(entry->last_access);
-            }
-            entry->last_access = timestamp ? strdup(timestamp) : NULL;
-            return 0;
-        }
-        entry = entry->next;
+    uint64_t hash = hash_key(path);
+    long pos = key_index_find(&profile->file_index, path, hash);
+    if (pos >= 0) {
+        /* Update existing entry */
+        file_entry_t *entry = &profile->files[pos];
+        entry->access_count += accesses;
+        entry->delta_count += accesses;
+        profile->changed = true;
+        free(entry->last_access);
+        entry->last_access = timestamp ? strdup(timestamp) : NULL;
+        return 0;
     }
     
     /* Create new file entry */
-    entry = calloc(1, sizeof(file_entry_t));
-    if (!entry) {
+    file_entry_t *files = reserve_entry(profile->files, profile->file_count,
+                                        &profile->file_capacity, sizeof(*files));
+    if (!files) {
         return -1;
     }
+    profile->files = files;
     
+    file_entry_t *entry = &files[profile->file_count];
     entry->path = strdup(path);
+    if (!entry->path ||
+        key_index_insert(&profile->file_index, entry->path, hash, profile->file_count) != 0) {
+        free(entry->path);
+        return -1;
+    }
     entry->type = type ? strdup(type) : strdup("unknown");
-    entry->access_count = 1;
+    entry->access_count = accesses;
     entry->first_access = timestamp ? strdup(timestamp) : NULL;
     entry->last_access = timestamp ? strdup(timestamp) : NULL;
     entry->mode = mode ? strdup(mode) : NULL;
+    entry->delta_count = accesses;
     
-    /* Add to front of list */
-    entry->next = profile->files;
-    profile->files = entry;
     profile->file_count++;
     profile->files_accessed++;
+    profile->delta_files++;
+    profile->changed = true;
     
     return 0;
 }
 
 /**
- * Add or update an API call in the profile
+ * Add calls of an API function to the profile
  */
-static int add_or_update_api_call(tracked_profile_t *profile, const char *function_name) {
+static int add_or_update_api_call(tracked_profile_t *profile, const char *function_name,
+                                  int calls) {
     if (!profile || !function_name) {
         return -1;
     }
     
     /* Check if API call already exists */
-    api_call_entry_t *entry = profile->api_calls;
-    while (entry) {
-        if (strcmp(entry->function_name, function_name) == 0) {
-            /* Update existing entry */
-            entry->count++;
-            return 0;
-        }
-        entry = entry->next;
+    uint64_t hash = hash_key(function_name);
+    long pos = key_index_find(&profile->api_call_index, function_name, hash);
+    if (pos >= 0) {
+        /* Update existing entry */
+        profile->api_calls[pos].count += calls;
+        profile->api_calls[pos].delta_count += calls;
+        profile->changed = true;
+        return 0;
     }
     
     /* Create new API call entry */
-    entry = calloc(1, sizeof(api_call_entry_t));
-    if (!entry) {
+    api_call_entry_t *api_calls = reserve_entry(profile->api_calls, profile->api_call_count,
+                                                &profile->api_call_capacity, sizeof(*api_calls));
+    if (!api_calls) {
         return -1;
     }
+    profile->api_calls = api_calls;
     
+    api_call_entry_t *entry = &api_calls[profile->api_call_count];
     entry->function_name = strdup(function_name);
-    entry->count = 1;
+    if (!entry->function_name ||
+        key_index_insert(&profile->api_call_index, entry->function_name, hash,
+                         profile->api_call_count) != 0) {
+        free(entry->function_name);
+        return -1;
+    }
+    entry->count = calls;
+    entry->delta_count = calls;
     
-    /* Add to front of list */
-    entry->next = profile->api_calls;
-    profile->api_calls = entry;
     profile->api_call_count++;
     profile->api_calls_made++;
+    profile->delta_api_calls++;
+    profile->changed = true;
     
     return 0;
 }
@@ -264,59 +543,143 @@ int profile_manager_add_event(profile_manager_t *mgr, processed_event_t *event)
         return -1;
     }
     
+    /* Event strings are borrowed for the callback only; everything kept
+     * in the profile is copied below, paths as apply_privacy_filter()
+     * asked for them to be written */
+    char timestamp_buf[ISO8601_TIMESTAMP_SIZE];
+    char path_buf[REDACTED_PATH_MAX];
+    const char *timestamp = NULL;
+    const char *path;
+    
+    if (event->timestamp_ns) {
+        timestamp = format_timestamp_iso8601_r(event->timestamp_ns, timestamp_buf,
+                                               sizeof(timestamp_buf));
+    }
+    
     tracked_profile_t *profile = find_or_create_profile(mgr, event->pid);
     if (!profile) {
         return -1;  /* Failed to find or create profile */
     }
     
+    /* Kernel-aggregated API calls, coalesced opens and events kept by
+     * sampling or rate limiting carry the number of events they stand for */
+    int calls = event->count > INT_MAX ? INT_MAX : event->count > 1 ? (int)event->count : 1;
+    
     /* Update last update time */
     profile->last_update = time(NULL);
-    profile->total_events++;
+    profile->total_events += calls;
+    profile->delta_events += calls;
     
     /* Update process metadata if not set */
     if (!profile->process_name && event->process) {
         profile->process_name = strdup(event->process);
     }
     if (!profile->exe && event->exe) {
-        profile->exe = strdup(event->exe);
+        path = privacy_redact_path_into(event->exe, event->redact_paths, path_buf, sizeof(path_buf));
+        profile->exe = path ? strdup(path) : NULL;
     }
     if (!profile->cmdline && event->cmdline) {
         profile->cmdline = strdup(event->cmdline);
     }
-    if (!profile->start_time && event->timestamp) {
-        profile->start_time = strdup(event->timestamp);
+    if (!profile->start_time && timestamp) {
+        profile->start_time = strdup(timestamp);
     }
     
     profile->uid = event->uid;
     
     /* Process event based on type */
-    if (event->event_type) {
-        if (strcmp(event->event_type, "lib_load") == 0) {
-            /* Library load event */
-            if (event->library) {
-                add_library(profile, event->library_name, event->library, event->timestamp);
+    switch (processed_event_kind(event)) {
+        case EVENT_LIB_LOAD:
+            path = privacy_redact_path_into(event->library, event->redact_paths, path_buf,
+                                            sizeof(path_buf));
+            if (path) {
+                add_library(profile, event->library_name, path, timestamp);
             }
-        } else if (strcmp(event->event_type, "file_open") == 0) {
-            /* File open event */
-            if (event->file) {
+            break;
+        
+        case EVENT_FILE_OPEN:
+            path = privacy_redact_path_into(event->file, event->redact_paths, path_buf,
+                                            sizeof(path_buf));
+            if (path) {
                 const char *file_type_str = file_type_to_string(event->file_type);
-                add_or_update_file(profile, event->file, file_type_str, event->timestamp, event->flags);
+                add_or_update_file(profile, path, file_type_str, timestamp, event->flags, calls);
             }
-        } else if (strcmp(event->event_type, "api_call") == 0) {
-            /* API call event */
+            break;
+        
+        case EVENT_API_CALL:
             if (event->function_name) {
-                add_or_update_api_call(profile, event->function_name);
+                add_or_update_api_call(profile, event->function_name, calls);
+            }
+            break;
+        
+        case EVENT_PROCESS_EXIT:
+            /* The PID may be reused from now on, once the leader exits;
+             * another thread exiting leaves the process running */
+            if (processed_event_ends_process(event)) {
+                retire_profile(mgr, profile->pid);
             }
+            break;
+        
+        default:
+            break;
+    }
+    
+    return 0;
+}
+
+/**
+ * Add TLS handshake latencies measured in the kernel to a profile
+ */
+int profile_manager_add_handshakes(profile_manager_t *mgr, pid_t pid,
+                                   const handshake_latency_t *latency) {
+    handshake_entry_t *entry = NULL;
+    
+    if (!mgr || !latency || !latency->function_name) {
+        return -1;
+    }
+    
+    /* Handshakes are read after the exit of their process was seen */
+    tracked_profile_t *profile = lookup_profile(mgr, pid, false);
+    if (!profile) {
+        profile = find_or_create_profile(mgr, pid);
+        if (!profile) {
+            return -1;
+        }
+    }
+    if (!profile->process_name && latency->comm[0]) {
+        profile->process_name = strndup(latency->comm, sizeof(latency->comm));
+    }
+    
+    for (size_t i = 0; i < profile->handshake_count; i++) {
+        if (strcmp(profile->handshakes[i].total.function_name, latency->function_name) == 0) {
+            entry = &profile->handshakes[i];
+            break;
+        }
+    }
+    if (!entry) {
+        if (profile->handshake_count == PROFILE_HANDSHAKE_FUNCTIONS) {
+            return -1;
         }
+        entry = &profile->handshakes[profile->handshake_count++];
+        entry->total.pid = entry->delta.pid = (uint32_t)pid;
+        entry->total.function_name = entry->delta.function_name = latency->function_name;
     }
     
+    handshake_latency_merge(&entry->total, latency);
+    handshake_latency_merge(&entry->delta, latency);
+    profile->last_update = time(NULL);
+    profile->changed = true;
+    
     return 0;
 }
 
 /**
  * Convert internal profile to external profile_t structure
+ * With delta set, only activity since the last flush is included: new
+ * libraries, and files and API calls with their counts for the interval.
  */
-static profile_t *convert_to_profile_t(tracked_profile_t *tracked, int duration_seconds) {
+static profile_t *convert_to_profile_t(tracked_profile_t *tracked, int duration_seconds,
+                                       bool delta) {
     if (!tracked) {
         return NULL;
     }
@@ -340,64 +703,95 @@ static profile_t *convert_to_profile_t(tracked_profile_t *tracked, int duration_
     profile->process.gid = tracked->gid;
     profile->process.start_time = tracked->start_time ? strdup(tracked->start_time) : NULL;
     
-    /* Convert libraries */
-    profile->library_count = tracked->library_count;
-    if (profile->library_count > 0) {
-        profile->libraries = calloc(profile->library_count, sizeof(profile->libraries[0]));
+    /* Convert libraries, most recent first */
+    if (tracked->library_count > 0) {
+        profile->libraries = calloc(tracked->library_count, sizeof(profile->libraries[0]));
         if (profile->libraries) {
-            library_entry_t *lib = tracked->libraries;
-            size_t idx = 0;
-            while (lib && idx < profile->library_count) {
-                profile->libraries[idx].name = lib->name ? strdup(lib->name) : NULL;
-                profile->libraries[idx].path = lib->path ? strdup(lib->path) : NULL;
-                profile->libraries[idx].load_time = lib->load_time ? strdup(lib->load_time) : NULL;
-                lib = lib->next;
-                idx++;
+            size_t n = 0;
+            for (size_t idx = tracked->library_count; idx-- > 0;) {
+                library_entry_t *lib = &tracked->libraries[idx];
+                if (delta && lib->flushed) {
+                    continue;
+                }
+                profile->libraries[n].name = lib->name ? strdup(lib->name) : NULL;
+                profile->libraries[n].path = lib->path ? strdup(lib->path) : NULL;
+                profile->libraries[n].load_time = lib->load_time ? strdup(lib->load_time) : NULL;
+                n++;
             }
+            profile->library_count = n;
         }
     }
     
     /* Convert files */
-    profile->file_count = tracked->file_count;
-    if (profile->file_count > 0) {
-        profile->files_accessed = calloc(profile->file_count, sizeof(profile->files_accessed[0]));
+    if (tracked->file_count > 0) {
+        profile->files_accessed = calloc(tracked->file_count, sizeof(profile->files_accessed[0]));
         if (profile->files_accessed) {
-            file_entry_t *file = tracked->files;
-            size_t idx = 0;
-            while (file && idx < profile->file_count) {
-                profile->files_accessed[idx].path = file->path ? strdup(file->path) : NULL;
-                profile->files_accessed[idx].type = file->type ? strdup(file->type) : NULL;
-                profile->files_accessed[idx].access_count = file->access_count;
-                profile->files_accessed[idx].first_access = file->first_access ? strdup(file->first_access) : NULL;
-                profile->files_accessed[idx].last_access = file->last_access ? strdup(file->last_access) : NULL;
-                profile->files_accessed[idx].mode = file->mode ? strdup(file->mode) : NULL;
-                file = file->next;
-                idx++;
+            size_t n = 0;
+            for (size_t idx = tracked->file_count; idx-- > 0;) {
+                file_entry_t *file = &tracked->files[idx];
+                if (delta && file->delta_count == 0) {
+                    continue;
+                }
+                profile->files_accessed[n].path = file->path ? strdup(file->path) : NULL;
+                profile->files_accessed[n].type = file->type ? strdup(file->type) : NULL;
+                profile->files_accessed[n].access_count = delta ? file->delta_count : file->access_count;
+                profile->files_accessed[n].first_access = file->first_access ? strdup(file->first_access) : NULL;
+                profile->files_accessed[n].last_access = file->last_access ? strdup(file->last_access) : NULL;
+                profile->files_accessed[n].mode = file->mode ? strdup(file->mode) : NULL;
+                n++;
             }
+            profile->file_count = n;
         }
     }
     
     /* Convert API calls */
-    profile->api_call_count = tracked->api_call_count;
-    if (profile->api_call_count > 0) {
-        profile->api_calls = calloc(profile->api_call_count, sizeof(profile->api_calls[0]));
+    if (tracked->api_call_count > 0) {
+        profile->api_calls = calloc(tracked->api_call_count, sizeof(profile->api_calls[0]));
         if (profile->api_calls) {
-            api_call_entry_t *api = tracked->api_calls;
-            size_t idx = 0;
-            while (api && idx < profile->api_call_count) {
-                profile->api_calls[idx].function_name = api->function_name ? strdup(api->function_name) : NULL;
-                profile->api_calls[idx].count = api->count;
-                api = api->next;
-                idx++;
+            size_t n = 0;
+            for (size_t idx = tracked->api_call_count; idx-- > 0;) {
+                api_call_entry_t *api = &tracked->api_calls[idx];
+                if (delta && api->delta_count == 0) {
+                    continue;
+                }
+                profile->api_calls[n].function_name = api->function_name ? strdup(api->function_name) : NULL;
+                profile->api_calls[n].count = delta ? api->delta_count : api->count;
+                n++;
             }
+            profile->api_call_count = n;
+        }
+    }
+    
+    /* Copy handshake latencies */
+    if (tracked->handshake_count > 0) {
+        profile->tls_handshakes = calloc(tracked->handshake_count, sizeof(profile->tls_handshakes[0]));
+        if (profile->tls_handshakes) {
+            size_t n = 0;
+            for (size_t idx = 0; idx < tracked->handshake_count; idx++) {
+                const handshake_latency_t *latency = delta ? &tracked->handshakes[idx].delta
+                                                           : &tracked->handshakes[idx].total;
+                if (delta && latency->errors == 0 && handshake_latency_count(latency) == 0) {
+                    continue;
+                }
+                profile->tls_handshakes[n] = *latency;
+                n++;
+            }
+            profile->tls_handshake_count = n;
         }
     }
     
     /* Set statistics */
-    profile->statistics.total_events = tracked->total_events;
-    profile->statistics.libraries_loaded = tracked->libraries_loaded;
-    profile->statistics.files_accessed = tracked->files_accessed;
-    profile->statistics.api_calls_made = tracked->api_calls_made;
+    if (delta) {
+        profile->statistics.total_events = tracked->delta_events;
+        profile->statistics.libraries_loaded = tracked->delta_libraries;
+        profile->statistics.files_accessed = tracked->delta_files;
+        profile->statistics.api_calls_made = tracked->delta_api_calls;
+    } else {
+        profile->statistics.total_events = tracked->total_events;
+        profile->statistics.libraries_loaded = tracked->libraries_loaded;
+        profile->statistics.files_accessed = tracked->files_accessed;
+        profile->statistics.api_calls_made = tracked->api_calls_made;
+    }
     
     return profile;
 }
@@ -410,14 +804,7 @@ profile_t *profile_manager_get_profile(profile_manager_t *mgr, pid_t pid) {
         return NULL;
     }
     
-    /* Find the profile */
-    for (size_t i = 0; i < mgr->count; i++) {
-        if (mgr->profiles[i].pid == pid && mgr->profiles[i].active) {
-            return convert_to_profile_t(&mgr->profiles[i], 0);
-        }
-    }
-    
-    return NULL;
+    return convert_to_profile_t(lookup_profile(mgr, pid, false), 0, false);
 }
 
 /**
@@ -428,16 +815,100 @@ profile_t *profile_manager_finalize_profile(profile_manager_t *mgr, pid_t pid, i
         return NULL;
     }
     
-    /* Find the profile */
-    for (size_t i = 0; i < mgr->count; i++) {
-        if (mgr->profiles[i].pid == pid && mgr->profiles[i].active) {
-            profile_t *profile = convert_to_profile_t(&mgr->profiles[i], duration_seconds);
-            mgr->profiles[i].active = false;  /* Mark as finalized */
-            return profile;
+    /* Finalizing hands the data over; the profile leaves the manager */
+    tracked_profile_t *tracked = lookup_profile(mgr, pid, true);
+    profile_t *profile = convert_to_profile_t(tracked, duration_seconds, false);
+    
+    free_tracked_profile(tracked);
+    return profile;
+}
+
+/**
+ * Mark everything in a profile as reported
+ */
+static void reset_delta(tracked_profile_t *tracked) {
+    for (size_t i = 0; i < tracked->library_count; i++) {
+        tracked->libraries[i].flushed = true;
+    }
+    for (size_t i = 0; i < tracked->file_count; i++) {
+        tracked->files[i].delta_count = 0;
+    }
+    for (size_t i = 0; i < tracked->api_call_count; i++) {
+        tracked->api_calls[i].delta_count = 0;
+    }
+    for (size_t i = 0; i < tracked->handshake_count; i++) {
+        handshake_latency_t *latency = &tracked->handshakes[i].delta;
+        memset(latency->buckets, 0, sizeof(latency->buckets));
+        latency->errors = 0;
+        latency->total_ns = 0;
+    }
+    
+    tracked->changed = false;
+    tracked->delta_events = 0;
+    tracked->delta_libraries = 0;
+    tracked->delta_files = 0;
+    tracked->delta_api_calls = 0;
+}
+
+/**
+ * Emit the delta of one profile if it has activity to report
+ */
+static int flush_profile_delta(tracked_profile_t *tracked, int duration_seconds,
+                               profile_delta_fn emit, void *ctx) {
+    profile_t *delta;
+    
+    if (!tracked->changed) {
+        return 0;
+    }
+    
+    delta = convert_to_profile_t(tracked, duration_seconds, true);
+    if (!delta) {
+        return -1;
+    }
+    
+    emit(delta, ctx);
+    profile_free(delta);
+    reset_delta(tracked);
+    return 1;
+}
+
+/**
+ * Emit what changed in every profile since the last flush
+ *
+ * Profiles without new libraries, file accesses or API calls are
+ * skipped. Retired profiles get their last delta and are then freed, so
+ * a system-wide profile only holds state for live processes.
+ *
+ * @param mgr Profile manager
+ * @param duration_seconds Interval covered by the deltas
+ * @param emit Called once per changed profile; the delta is freed after it returns
+ * @param ctx Passed to emit
+ * @return Number of deltas emitted, or -1 on error
+ */
+int profile_manager_flush_deltas(profile_manager_t *mgr, int duration_seconds,
+                                 profile_delta_fn emit, void *ctx) {
+    int emitted = 0;
+    
+    if (!mgr || !emit) {
+        return -1;
+    }
+    
+    for (size_t i = 0; i <= mgr->mask; i++) {
+        if (mgr->slots[i] && flush_profile_delta(mgr->slots[i], duration_seconds, emit, ctx) > 0) {
+            emitted++;
         }
     }
     
-    return NULL;
+    while (mgr->retired) {
+        tracked_profile_t *next = mgr->retired->next;
+        if (flush_profile_delta(mgr->retired, duration_seconds, emit, ctx) > 0) {
+            emitted++;
+        }
+        free_tracked_profile(mgr->retired);
+        mgr->retired = next;
+    }
+    
+    return emitted;
 }
 
 /**
@@ -488,6 +959,7 @@ void profile_free(profile_t *profile) {
         free(profile->api_calls);
     }
     
+    free(profile->tls_handshakes);
     free(profile);
 }
 
@@ -506,37 +978,33 @@ static void free_tracked_profile(tracked_profile_t *profile) {
     free(profile->start_time);
     
     /* Free libraries */
-    library_entry_t *lib = profile->libraries;
-    while (lib) {
-        library_entry_t *next = lib->next;
-        free(lib->name);
-        free(lib->path);
-        free(lib->load_time);
-        free(lib);
-        lib = next;
+    for (size_t i = 0; i < profile->library_count; i++) {
+        free(profile->libraries[i].name);
+        free(profile->libraries[i].path);
+        free(profile->libraries[i].load_time);
     }
+    free(profile->libraries);
+    free(profile->library_index.slots);
     
     /* Free files */
-    file_entry_t *file = profile->files;
-    while (file) {
-        file_entry_t *next = file->next;
-        free(file->path);
-        free(file->type);
-        free(file->first_access);
-        free(file->last_access);
-        free(file->mode);
-        free(file);
-        file = next;
+    for (size_t i = 0; i < profile->file_count; i++) {
+        free(profile->files[i].path);
+        free(profile->files[i].type);
+        free(profile->files[i].first_access);
+        free(profile->files[i].last_access);
+        free(profile->files[i].mode);
     }
+    free(profile->files);
+    free(profile->file_index.slots);
     
     /* Free API calls */
-    api_call_entry_t *api = profile->api_calls;
-    while (api) {
-        api_call_entry_t *next = api->next;
-        free(api->function_name);
-        free(api);
-        api = next;
+    for (size_t i = 0; i < profile->api_call_count; i++) {
+        free(profile->api_calls[i].function_name);
     }
+    free(profile->api_calls);
+    free(profile->api_call_index.slots);
+    
+    free(profile);
 }
 
 /**
@@ -547,12 +1015,16 @@ void profile_manager_destroy(profile_manager_t *mgr) {
         return;
     }
     
-    /* Free all tracked profiles */
-    if (mgr->profiles) {
-        for (size_t i = 0; i < mgr->count; i++) {
-            free_tracked_profile(&mgr->profiles[i]);
-        }
-        free(mgr->profiles);
+    /* Free all tracked profiles, live and retired */
+    for (size_t i = 0; i <= mgr->mask; i++) {
+        free_tracked_profile(mgr->slots[i]);
+    }
+    free(mgr->slots);
+    
+    while (mgr->retired) {
+        tracked_profile_t *next = mgr->retired->next;
+        free_tracked_profile(mgr->retired);
+        mgr->retired = next;
     }
     
     free(mgr);
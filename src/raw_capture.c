@@ -0,0 +1,534 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * raw_capture.c - Raw ring buffer record capture and replay
+ * The reader maps the whole file and indexes its PROC frames up front,
+ * so replay hands out records straight from the mapping and enrichment
+ * finds a process's recorded /proc reads with a binary search.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/raw_capture.h"
+#include "include/logger.h"
+
+#define PROC_FIXED_SIZE 16         /* pid, flags, start time */
+#define PROC_STRINGS 3             /* comm, exe, cmdline */
+
+struct raw_writer {
+    FILE *output;
+    pthread_mutex_t lock;
+    int error;                     /* A write failed; reported on close */
+};
+
+/* One PROC frame, by payload offset in the mapping */
+typedef struct {
+    uint32_t pid;
+    uint64_t start_time_ns;
+    size_t offset;
+} proc_frame_t;
+
+/* The PROC frames of one (pid, start time), frames[begin, end) */
+typedef struct {
+    uint32_t pid;
+    uint64_t start_time_ns;
+    size_t begin;
+    size_t end;
+    size_t next;                   /* Next frame to hand out */
+} proc_group_t;
+
+struct raw_reader {
+    const uint8_t *map;
+    size_t size;
+    size_t pos;                    /* Next frame */
+    int64_t boot_offset;
+    proc_frame_t *frames;
+    proc_group_t *groups;
+    size_t group_count;
+};
+
+static size_t padded(size_t size) {
+    return (size + RAW_FRAME_ALIGN - 1) & ~(size_t)(RAW_FRAME_ALIGN - 1);
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    uint32_t v;
+    
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t read_u64(const uint8_t *p) {
+    uint64_t v;
+    
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * Create a capture file and write its header
+ *
+ * @param path File to create (truncated if it exists)
+ * @param boot_to_realtime_ns Offset replay converts record timestamps with
+ * @return Writer, or NULL on failure
+ */
+raw_writer_t *raw_writer_create(const char *path, int64_t boot_to_realtime_ns) {
+    uint8_t header[RAW_HEADER_SIZE] = {0};
+    uint16_t version = RAW_VERSION;
+    raw_writer_t *writer;
+    
+    if (!path) {
+        return NULL;
+    }
+    
+    writer = calloc(1, sizeof(*writer));
+    if (!writer) {
+        return NULL;
+    }
+    
+    writer->output = fopen(path, "wb");
+    if (!writer->output) {
+        log_error("Failed to open raw capture file: %s", path);
+        log_system_error("fopen");
+        free(writer);
+        return NULL;
+    }
+    pthread_mutex_init(&writer->lock, NULL);
+    
+    memcpy(header, RAW_MAGIC, 4);
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 8, &boot_to_realtime_ns, sizeof(boot_to_realtime_ns));
+    if (fwrite(header, sizeof(header), 1, writer->output) != 1) {
+        writer->error = errno;
+    }
+    
+    return writer;
+}
+
+/* Frame header and padding around a payload written by the caller; lock held */
+static void write_frame_header(raw_writer_t *writer, uint8_t kind, uint8_t source, size_t size) {
+    uint8_t header[RAW_FRAME_HEADER_SIZE] = { kind, source, 0, 0 };
+    uint32_t length = (uint32_t)size;
+    
+    memcpy(header + 4, &length, sizeof(length));
+    if (fwrite(header, sizeof(header), 1, writer->output) != 1) {
+        writer->error = errno;
+    }
+}
+
+static void write_bytes(raw_writer_t *writer, const void *data, size_t size) {
+    if (size > 0 && fwrite(data, size, 1, writer->output) != 1) {
+        writer->error = errno;
+    }
+}
+
+static void write_padding(raw_writer_t *writer, size_t size) {
+    static const uint8_t zeros[RAW_FRAME_ALIGN];
+    
+    write_bytes(writer, zeros, padded(size) - size);
+}
+
+/**
+ * Append a ring buffer record
+ *
+ * @return 0 on success, -1 on failure
+ */
+int raw_writer_write_record(raw_writer_t *writer, uint8_t source, const void *data, size_t size) {
+    if (!writer || !data || size > UINT32_MAX) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&writer->lock);
+    write_frame_header(writer, RAW_FRAME_RECORD, source, size);
+    write_bytes(writer, data, size);
+    write_padding(writer, size);
+    pthread_mutex_unlock(&writer->lock);
+    
+    return writer->error ? -1 : 0;
+}
+
+/**
+ * Append the result of a /proc read
+ *
+ * @return 0 on success, -1 on failure
+ */
+int raw_writer_write_proc(raw_writer_t *writer, pid_t pid, uint64_t start_time_ns,
+                          unsigned int flags, const proc_cache_entry_t *entry) {
+    const char *strings[PROC_STRINGS];
+    uint32_t lengths[PROC_STRINGS];
+    uint8_t fixed[PROC_FIXED_SIZE];
+    uint32_t pid32 = (uint32_t)pid;
+    uint32_t flags32 = flags;
+    size_t size = sizeof(fixed);
+    
+    if (!writer || !entry) {
+        return -1;
+    }
+    
+    strings[0] = entry->comm;
+    strings[1] = entry->exe;
+    strings[2] = entry->cmdline;
+    for (int i = 0; i < PROC_STRINGS; i++) {
+        lengths[i] = strings[i] ? (uint32_t)strlen(strings[i]) : RAW_STRING_NULL;
+        size += sizeof(uint32_t) + (strings[i] ? lengths[i] : 0);
+    }
+    
+    memcpy(fixed, &pid32, sizeof(pid32));
+    memcpy(fixed + 4, &flags32, sizeof(flags32));
+    memcpy(fixed + 8, &start_time_ns, sizeof(start_time_ns));
+    
+    pthread_mutex_lock(&writer->lock);
+    write_frame_header(writer, RAW_FRAME_PROC, 0, size);
+    write_bytes(writer, fixed, sizeof(fixed));
+    for (int i = 0; i < PROC_STRINGS; i++) {
+        write_bytes(writer, &lengths[i], sizeof(lengths[i]));
+        if (strings[i]) {
+            write_bytes(writer, strings[i], lengths[i]);
+        }
+    }
+    write_padding(writer, size);
+    pthread_mutex_unlock(&writer->lock);
+    
+    return writer->error ? -1 : 0;
+}
+
+/**
+ * Flush and close a capture file
+ *
+ * @return 0 on success, -1 if any write failed
+ */
+int raw_writer_close(raw_writer_t *writer) {
+    int ret;
+    
+    if (!writer) {
+        return 0;
+    }
+    
+    if (fclose(writer->output) != 0 && !writer->error) {
+        writer->error = errno;
+    }
+    ret = writer->error ? -1 : 0;
+    if (ret != 0) {
+        log_error("Failed to write raw capture: %s", strerror(writer->error));
+    }
+    
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+    return ret;
+}
+
+/**
+ * Read the frame at pos
+ * Returns 1 with the frame, 0 at end of file or -1 if it is truncated
+ */
+static int frame_at(const raw_reader_t *reader, size_t pos, uint8_t *kind, uint8_t *source,
+                    size_t *payload, size_t *size) {
+    uint32_t length;
+    
+    if (pos == reader->size) {
+        return 0;
+    }
+    if (reader->size - pos < RAW_FRAME_HEADER_SIZE) {
+        return -1;
+    }
+    
+    length = read_u32(reader->map + pos + 4);
+    if (reader->size - pos - RAW_FRAME_HEADER_SIZE < length) {
+        return -1;
+    }
+    
+    *kind = reader->map[pos];
+    *source = reader->map[pos + 1];
+    *payload = pos + RAW_FRAME_HEADER_SIZE;
+    *size = length;
+    return 1;
+}
+
+/* Check that a PROC payload's string lengths fit inside it */
+static bool proc_frame_valid(const uint8_t *p, size_t size) {
+    size_t pos = PROC_FIXED_SIZE;
+    
+    if (size < PROC_FIXED_SIZE) {
+        return false;
+    }
+    
+    for (int i = 0; i < PROC_STRINGS; i++) {
+        uint32_t length;
+        
+        if (size - pos < sizeof(uint32_t)) {
+            return false;
+        }
+        length = read_u32(p + pos);
+        pos += sizeof(uint32_t);
+        if (length != RAW_STRING_NULL) {
+            if (size - pos < length) {
+                return false;
+            }
+            pos += length;
+        }
+    }
+    return true;
+}
+
+static int compare_proc_frames(const void *a, const void *b) {
+    const proc_frame_t *x = a;
+    const proc_frame_t *y = b;
+    
+    if (x->pid != y->pid) {
+        return x->pid < y->pid ? -1 : 1;
+    }
+    if (x->start_time_ns != y->start_time_ns) {
+        return x->start_time_ns < y->start_time_ns ? -1 : 1;
+    }
+    /* File order within a process */
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+/**
+ * Validate every frame and index the PROC frames by process
+ */
+static int index_frames(raw_reader_t *reader) {
+    size_t count = 0, capacity = 0;
+    size_t pos = RAW_HEADER_SIZE;
+    size_t payload, size;
+    uint8_t kind, source;
+    int status;
+    
+    while ((status = frame_at(reader, pos, &kind, &source, &payload, &size)) > 0) {
+        if (kind == RAW_FRAME_PROC) {
+            if (!proc_frame_valid(reader->map + payload, size)) {
+                log_error("Malformed /proc frame at offset %zu", pos);
+                return -1;
+            }
+            if (count == capacity) {
+                size_t new_capacity = capacity ? capacity * 2 : 256;
+                proc_frame_t *grown = realloc(reader->frames, new_capacity * sizeof(*grown));
+                
+                if (!grown) {
+                    return -1;
+                }
+                reader->frames = grown;
+                capacity = new_capacity;
+            }
+            reader->frames[count].pid = read_u32(reader->map + payload);
+            reader->frames[count].start_time_ns = read_u64(reader->map + payload + 8);
+            reader->frames[count].offset = payload;
+            count++;
+        }
+        
+        pos = payload + size;
+        if (reader->size - pos < padded(size) - size) {
+            break;
+        }
+        pos += padded(size) - size;
+    }
+    if (status < 0 || pos != reader->size) {
+        log_error("Truncated raw capture frame at offset %zu", pos);
+        return -1;
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    qsort(reader->frames, count, sizeof(*reader->frames), compare_proc_frames);
+    reader->groups = malloc(count * sizeof(*reader->groups));
+    if (!reader->groups) {
+        return -1;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        proc_group_t *group = reader->group_count ? &reader->groups[reader->group_count - 1] : NULL;
+        
+        if (group && group->pid == reader->frames[i].pid &&
+            group->start_time_ns == reader->frames[i].start_time_ns) {
+            group->end = i + 1;
+            continue;
+        }
+        group = &reader->groups[reader->group_count++];
+        group->pid = reader->frames[i].pid;
+        group->start_time_ns = reader->frames[i].start_time_ns;
+        group->begin = i;
+        group->end = i + 1;
+        group->next = i;
+    }
+    
+    return 0;
+}
+
+/**
+ * Open and map a capture file
+ *
+ * @return Reader, or NULL on failure (logged)
+ */
+raw_reader_t *raw_reader_open(const char *path) {
+    raw_reader_t *reader;
+    struct stat st;
+    uint16_t version;
+    void *map;
+    int fd;
+    
+    if (!path) {
+        return NULL;
+    }
+    
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_error("Failed to open raw capture: %s", path);
+        log_system_error("open");
+        return NULL;
+    }
+    
+    if (fstat(fd, &st) != 0 || st.st_size < RAW_HEADER_SIZE) {
+        log_error("Not a raw capture (too short): %s", path);
+        close(fd);
+        return NULL;
+    }
+    
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_system_error("mmap");
+        return NULL;
+    }
+    
+    reader = calloc(1, sizeof(*reader));
+    if (!reader) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    reader->map = map;
+    reader->size = (size_t)st.st_size;
+    reader->pos = RAW_HEADER_SIZE;
+    
+    memcpy(&version, reader->map + 4, sizeof(version));
+    if (memcmp(reader->map, RAW_MAGIC, 4) != 0 || version != RAW_VERSION) {
+        log_error("Not a raw capture, or unsupported version: %s", path);
+        raw_reader_close(reader);
+        return NULL;
+    }
+    memcpy(&reader->boot_offset, reader->map + 8, sizeof(reader->boot_offset));
+    
+    if (index_frames(reader) != 0) {
+        raw_reader_close(reader);
+        return NULL;
+    }
+    
+    return reader;
+}
+
+int64_t raw_reader_boot_offset(const raw_reader_t *reader) {
+    return reader ? reader->boot_offset : 0;
+}
+
+/**
+ * Get the next record
+ * Frames were validated when the file was opened
+ *
+ * @return 1 with a record, 0 at end of file, -1 on failure
+ */
+int raw_reader_next(raw_reader_t *reader, uint8_t *source, const void **data, size_t *size) {
+    size_t payload, length;
+    uint8_t kind, src;
+    int status;
+    
+    if (!reader || !source || !data || !size) {
+        return -1;
+    }
+    
+    while ((status = frame_at(reader, reader->pos, &kind, &src, &payload, &length)) > 0) {
+        reader->pos = payload + padded(length);
+        if (kind == RAW_FRAME_RECORD) {
+            *source = src;
+            *data = reader->map + payload;
+            *size = length;
+            return 1;
+        }
+    }
+    
+    return status;
+}
+
+static int compare_group_key(const void *key, const void *elem) {
+    const proc_group_t *x = key;
+    const proc_group_t *y = elem;
+    
+    if (x->pid != y->pid) {
+        return x->pid < y->pid ? -1 : 1;
+    }
+    return x->start_time_ns < y->start_time_ns ? -1 : x->start_time_ns > y->start_time_ns;
+}
+
+/**
+ * Hand out the next recorded /proc read of a process
+ *
+ * @return 0 with entry filled (caller frees the strings), -1 if not recorded
+ */
+int raw_reader_proc_lookup(raw_reader_t *reader, pid_t pid, uint64_t start_time_ns,
+                           proc_cache_entry_t *entry) {
+    proc_group_t key = { .pid = (uint32_t)pid, .start_time_ns = start_time_ns };
+    const char **fields[PROC_STRINGS];
+    const proc_frame_t *frame;
+    proc_group_t *group;
+    size_t pos;
+    
+    if (!reader || !entry) {
+        return -1;
+    }
+    memset(entry, 0, sizeof(*entry));
+    
+    group = reader->group_count
+        ? bsearch(&key, reader->groups, reader->group_count, sizeof(*group), compare_group_key)
+        : NULL;
+    if (!group) {
+        return -1;
+    }
+    
+    frame = &reader->frames[group->next];
+    if (group->next + 1 < group->end) {
+        group->next++;
+    }
+    
+    fields[0] = &entry->comm;
+    fields[1] = &entry->exe;
+    fields[2] = &entry->cmdline;
+    pos = frame->offset + PROC_FIXED_SIZE;
+    for (int i = 0; i < PROC_STRINGS; i++) {
+        uint32_t length = read_u32(reader->map + pos);
+        
+        pos += sizeof(uint32_t);
+        if (length != RAW_STRING_NULL) {
+            *fields[i] = strndup((const char *)reader->map + pos, length);
+            pos += length;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * Unmap a capture file and free the reader
+ */
+void raw_reader_close(raw_reader_t *reader) {
+    if (!reader) {
+        return;
+    }
+    
+    munmap((void *)reader->map, reader->size);
+    free(reader->frames);
+    free(reader->groups);
+    free(reader);
+}
@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * snapshot_iter.c - BPF iterator snapshot backend implementation
+ * Loads snapshot_iter, points its extension prefilter at the classifier's
+ * rules, and drains each iterator with read() into one buffer. The
+ * iterators only need CAP_BPF/CAP_PERFMON (or root) and a 5.12+ kernel
+ * with BTF; anything else is reported as unavailable and libbpf's
+ * complaints go to the debug log, since /proc is the expected path then.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#include "include/snapshot_iter.h"
+#include "include/logger.h"
+#include "ebpf/common.h"
+#include "snapshot_iter.skel.h"
+
+/* Initial iterator output buffer; grows by doubling */
+#define ITER_BUFFER_INITIAL (256 * 1024)
+
+static int quiet_libbpf_print(enum libbpf_print_level level, const char *format, va_list args) {
+    char buffer[1024];
+    size_t len;
+    
+    (void)level;
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    len = strlen(buffer);
+    if (len > 0 && buffer[len - 1] == '\n') {
+        buffer[len - 1] = '\0';
+    }
+    log_debug("libbpf: %s", buffer);
+    return 0;
+}
+
+/**
+ * Fill the kernel extension table from the classifier's rules
+ * Rules that do not fit the table leave it empty, which turns the
+ * prefilter off: every open file is resolved and classified in
+ * user-space instead of missing a crypto file
+ */
+static void configure_extensions(struct snapshot_iter_bpf *skel,
+                                 const crypto_classifier_t *classifier) {
+    struct ct_crypto_extension entries[MAX_CRYPTO_EXTENSIONS];
+    int count = crypto_classifier_kernel_extensions(classifier, entries);
+    int map_fd = bpf_map__fd(skel->maps.crypto_extensions);
+    
+    if (count < 0 || map_fd < 0) {
+        log_debug("Extension rules do not fit the iterator prefilter, disabling it");
+        return;
+    }
+    
+    for (__u32 i = 0; i < (__u32)count; i++) {
+        if (bpf_map_update_elem(map_fd, &i, &entries[i], BPF_ANY) != 0) {
+            struct ct_crypto_extension empty = {0};
+            __u32 first = 0;
+            
+            log_debug("Failed to configure iterator prefilter, disabling it");
+            bpf_map_update_elem(map_fd, &first, &empty, BPF_ANY);
+            return;
+        }
+    }
+}
+
+/**
+ * Run one iterator and append its output to result->data
+ */
+static int run_iterator(struct bpf_program *prog, snapshot_iter_result_t *result,
+                        size_t *capacity) {
+    struct bpf_link *link;
+    ssize_t n;
+    int iter_fd;
+    int ret = 0;
+    
+    link = bpf_program__attach_iter(prog, NULL);
+    if (!link) {
+        log_debug("Failed to attach %s iterator: %s", bpf_program__name(prog), strerror(errno));
+        return -1;
+    }
+    
+    iter_fd = bpf_iter_create(bpf_link__fd(link));
+    if (iter_fd < 0) {
+        log_debug("Failed to create %s iterator: %s", bpf_program__name(prog), strerror(errno));
+        bpf_link__destroy(link);
+        return -1;
+    }
+    
+    for (;;) {
+        if (*capacity - result->data_len < ITER_BUFFER_INITIAL / 4) {
+            size_t new_capacity = *capacity ? *capacity * 2 : ITER_BUFFER_INITIAL;
+            char *data = realloc(result->data, new_capacity);
+            if (!data) {
+                log_error("Failed to allocate iterator buffer");
+                ret = -1;
+                break;
+            }
+            result->data = data;
+            *capacity = new_capacity;
+        }
+        
+        n = read(iter_fd, result->data + result->data_len, *capacity - result->data_len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            log_debug("Failed to read %s iterator: %s", bpf_program__name(prog), strerror(errno));
+            ret = -1;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        result->data_len += (size_t)n;
+    }
+    
+    close(iter_fd);
+    bpf_link__destroy(link);
+    return ret;
+}
+
+/**
+ * Collect every process's candidate libraries and files
+ *
+ * @param classifier Rules for the kernel-side extension prefilter
+ * @param result Filled with the sorted records (free with snapshot_iter_result_free)
+ * @return 0 on success, -1 if the iterators are unavailable
+ */
+int snapshot_iter_collect(const crypto_classifier_t *classifier, snapshot_iter_result_t *result) {
+    struct snapshot_iter_bpf *skel;
+    libbpf_print_fn_t previous_print;
+    size_t capacity = 0;
+    int ret = -1;
+    
+    if (!result) {
+        return -1;
+    }
+    memset(result, 0, sizeof(*result));
+    
+    previous_print = libbpf_set_print(quiet_libbpf_print);
+    
+    skel = snapshot_iter_bpf__open_and_load();
+    if (!skel) {
+        log_debug("BPF iterators unavailable: %s", strerror(errno));
+        goto out;
+    }
+    
+    configure_extensions(skel, classifier);
+    
+    if (run_iterator(skel->progs.dump_task_vma, result, &capacity) != 0 ||
+        run_iterator(skel->progs.dump_task_file, result, &capacity) != 0) {
+        goto out;
+    }
+    
+    if (snapshot_iter_parse(result) != 0) {
+        log_warn("Malformed BPF iterator output, falling back to /proc");
+        goto out;
+    }
+    ret = 0;
+    
+out:
+    snapshot_iter_bpf__destroy(skel);
+    libbpf_set_print(previous_print);
+    if (ret != 0) {
+        snapshot_iter_result_free(result);
+    }
+    return ret;
+}
+
+/* Order by pid, then kind; records of one kind keep their kernel order */
+static int compare_records(const void *a, const void *b) {
+    const snapshot_iter_record_t *ra = a, *rb = b;
+    
+    if (ra->pid != rb->pid) {
+        return ra->pid < rb->pid ? -1 : 1;
+    }
+    if (ra->kind != rb->kind) {
+        return ra->kind < rb->kind ? -1 : 1;
+    }
+    return ra->path < rb->path ? -1 : ra->path > rb->path;
+}
+
+/**
+ * Split the raw iterator output into records
+ * Paths are referenced in place; each is NUL-terminated by the kernel.
+ */
+int snapshot_iter_parse(snapshot_iter_result_t *result) {
+    struct ct_iter_record rec;
+    size_t count = 0;
+    size_t pos;
+    
+    if (!result) {
+        return -1;
+    }
+    
+    /* Validate and count first so the array is sized exactly */
+    for (pos = 0; pos < result->data_len; count++) {
+        if (result->data_len - pos < sizeof(rec)) {
+            return -1;
+        }
+        memcpy(&rec, result->data + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (rec.path_len == 0 || rec.path_len > result->data_len - pos ||
+            result->data[pos + rec.path_len - 1] != '\0' ||
+            (rec.kind != CT_ITER_LIBRARY && rec.kind != CT_ITER_FILE)) {
+            return -1;
+        }
+        pos += rec.path_len;
+    }
+    
+    free(result->records);
+    result->records = NULL;
+    result->count = 0;
+    if (count == 0) {
+        return 0;
+    }
+    
+    result->records = malloc(count * sizeof(*result->records));
+    if (!result->records) {
+        log_error("Failed to allocate iterator records");
+        return -1;
+    }
+    
+    for (pos = 0; pos < result->data_len; result->count++) {
+        snapshot_iter_record_t *out = &result->records[result->count];
+        
+        memcpy(&rec, result->data + pos, sizeof(rec));
+        pos += sizeof(rec);
+        out->pid = (pid_t)rec.pid;
+        out->kind = (int)rec.kind;
+        out->fd = rec.fd;
+        out->ino = rec.ino;
+        out->path = result->data + pos;
+        pos += rec.path_len;
+    }
+    
+    /* Paths increase with the output position, which keeps the sort stable */
+    qsort(result->records, result->count, sizeof(*result->records), compare_records);
+    return 0;
+}
+
+void snapshot_iter_result_free(snapshot_iter_result_t *result) {
+    if (!result) {
+        return;
+    }
+    
+    free(result->records);
+    free(result->data);
+    memset(result, 0, sizeof(*result));
+}
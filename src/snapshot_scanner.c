@@ -0,0 +1,666 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * snapshot_scanner.c - Parallel system-wide snapshot engine implementation
+ * The PID list is split into chunks that worker threads claim from a
+ * shared cursor. Each worker holds /proc open and reads every process
+ * through its /proc/[pid] directory fd. Results land in one slot per PID,
+ * so workers never contend, and the merge compacts the slots in /proc order.
+ * comm/exe/status are only read for processes that use cryptography.
+ * Every string is bump-allocated from the worker's arena and referenced
+ * by the snapshot as is; the arenas are merged into snapshot->arena.
+ * Library paths are interned in the scanner's library table instead, so
+ * each distinct library is stored once however many processes map it.
+ *
+ * An incremental scan reads each process's identity and signature first
+ * (snapshot_state.h) and copies the previous run's entry when neither
+ * changed, so only new and changed processes have their maps and fds read.
+ *
+ * When asked to, the scan first tries the BPF iterator backend, which
+ * gets every process's executable mappings and candidate crypto files
+ * from the kernel in a few read() calls; its records go through the
+ * same classification and slot merge as the /proc results.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "include/snapshot_scanner.h"
+#include "include/snapshot_iter.h"
+#include "include/crypto_classifier.h"
+#include "include/string_arena.h"
+#include "include/privacy_filter.h"
+#include "include/logger.h"
+#include "ebpf/common.h"
+
+/* PIDs claimed per cursor update */
+#define SCAN_CHUNK_SIZE 32
+
+/* State shared by all workers */
+typedef struct {
+    proc_scanner_t *scanner;
+    const snapshot_scan_config_t *config;
+    int proc_fd;
+    const pid_t *pids;
+    size_t pid_count;
+    path_intern_t *library_table;
+    snapshot_process_t *slots;     /* One per PID; name == NULL = not listed */
+    atomic_size_t next;            /* First PID of the next unclaimed chunk */
+    atomic_bool timed_out;
+    uint64_t deadline_ns;
+} scan_shared_t;
+
+/* Per-thread state and results */
+typedef struct {
+    scan_shared_t *shared;
+    string_arena_t *arena;         /* Strings of this worker's entries */
+    pthread_t thread;
+    bool started;
+    uint64_t maps_ns;
+    uint64_t fds_ns;
+    uint64_t info_ns;
+    size_t scanned;
+    size_t reused;
+} scan_worker_t;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Path to report for a scanned path, applying privacy filtering
+ * Requirement 6.1, 6.2, 6.3
+ * The scanned string is referenced as is unless redaction changes it.
+ */
+static char *snapshot_path(string_arena_t *arena, const char *path, bool redact) {
+    redacted_path_t view;
+    size_t suffix_len;
+    char *result;
+    
+    if (!privacy_redact_path(path, redact, &view)) {
+        return (char *)path;
+    }
+    
+    suffix_len = strlen(view.suffix);
+    result = string_arena_alloc(arena, view.prefix_len + suffix_len + 1);
+    if (!result) {
+        return (char *)path;
+    }
+    memcpy(result, view.prefix, view.prefix_len);
+    memcpy(result + view.prefix_len, view.suffix, suffix_len + 1);
+    return result;
+}
+
+/**
+ * Fill a snapshot entry from a process's scan results
+ * Returns 0 on success, -1 if the arena is exhausted
+ */
+static int fill_snapshot_process(snapshot_process_t *proc, string_arena_t *arena,
+                                 path_intern_t *library_table, const process_info_t *info,
+                                 const library_list_t *libs, const file_list_t *files,
+                                 bool redact) {
+    char running_as_buf[32];
+    
+    proc->pid = info->pid;
+    proc->exe = snapshot_path(arena, info->exe, redact);
+    
+    /* Format running_as (UID) */
+    snprintf(running_as_buf, sizeof(running_as_buf), "uid:%u", info->uid);
+    proc->running_as = string_arena_strdup(arena, running_as_buf);
+    
+    /* Reference libraries by their interned paths */
+    if (libs->count > 0) {
+        proc->libraries = string_arena_alloc(arena, libs->count * sizeof(char *));
+        proc->library_ids = string_arena_alloc(arena, libs->count * sizeof(uint32_t));
+        if (!proc->libraries || !proc->library_ids) {
+            return -1;
+        }
+        for (size_t j = 0; j < libs->count; j++) {
+            const library_info_t *lib = &libs->libraries[j];
+            const char *path = snapshot_path(arena, lib->path, redact);
+            uint32_t id = lib->path_id;
+            
+            /* A redacted path is a different library table entry */
+            if (!lib->interned || path != lib->path) {
+                id = path_intern_add(library_table, path, &path);
+                if (id == PATH_INTERN_INVALID) {
+                    return -1;
+                }
+            }
+            proc->libraries[j] = (char *)path;
+            proc->library_ids[j] = id;
+        }
+        proc->library_count = libs->count;
+    }
+    
+    /* Reference open crypto files */
+    if (files->count > 0) {
+        proc->open_crypto_files = string_arena_alloc(arena, files->count * sizeof(char *));
+        if (!proc->open_crypto_files) {
+            return -1;
+        }
+        for (size_t j = 0; j < files->count; j++) {
+            proc->open_crypto_files[j] = snapshot_path(arena, files->files[j].path, redact);
+        }
+        proc->file_count = files->count;
+    }
+    
+    /* Set last: a non-NULL name marks the slot as listed */
+    proc->name = string_arena_strdup(arena, info->comm);
+    return (proc->name && proc->running_as) ? 0 : -1;
+}
+
+/**
+ * Fill a snapshot entry from the previous run's entry of the process
+ * The strings are the state's; libraries are interned again so the
+ * entry has ids like the scanned ones
+ * Returns 0 on success, -1 if the arena is exhausted
+ */
+static int reuse_snapshot_process(snapshot_process_t *proc, string_arena_t *arena,
+                                  path_intern_t *library_table, const snapshot_process_t *prev) {
+    const char *path;
+    
+    *proc = *prev;
+    proc->library_ids = NULL;
+    if (prev->library_count > 0) {
+        proc->libraries = string_arena_alloc(arena, prev->library_count * sizeof(char *));
+        proc->library_ids = string_arena_alloc(arena, prev->library_count * sizeof(uint32_t));
+        if (!proc->libraries || !proc->library_ids) {
+            return -1;
+        }
+        for (size_t j = 0; j < prev->library_count; j++) {
+            proc->library_ids[j] = path_intern_add(library_table, prev->libraries[j], &path);
+            if (proc->library_ids[j] == PATH_INTERN_INVALID) {
+                return -1;
+            }
+            proc->libraries[j] = (char *)path;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Copy a process the state has unchanged into its slot
+ * Returns true if it was copied
+ */
+static bool reuse_pid(scan_worker_t *worker, size_t index, int pid_fd,
+                      snapshot_process_key_t *key) {
+    scan_shared_t *shared = worker->shared;
+    snapshot_state_t *state = shared->config->state;
+    const snapshot_state_entry_t *prev;
+    snapshot_process_t *slot = &shared->slots[index];
+    
+    if (snapshot_state_read_key(pid_fd, shared->pids[index], key) != 0) {
+        return false;
+    }
+    prev = snapshot_state_unchanged(state, key);
+    if (!prev) {
+        return false;
+    }
+    
+    if (prev->process.name &&
+        reuse_snapshot_process(slot, worker->arena, shared->library_table, &prev->process) != 0) {
+        memset(slot, 0, sizeof(*slot));
+        return false;
+    }
+    snapshot_state_record(state, index, key, prev->process.name ? slot : NULL);
+    worker->reused++;
+    return true;
+}
+
+/**
+ * Scan one process into its slot
+ */
+static void scan_pid(scan_worker_t *worker, size_t index) {
+    scan_shared_t *shared = worker->shared;
+    snapshot_state_t *state = shared->config->state;
+    snapshot_process_key_t key;
+    library_list_t libs;
+    file_list_t files;
+    process_info_t info;
+    uint64_t t0, t1, t2;
+    int pid_fd;
+    
+    pid_fd = proc_scanner_open_pid(shared->proc_fd, shared->pids[index]);
+    if (pid_fd < 0) {
+        return;  /* Process exited since the listing */
+    }
+    
+    if (state && reuse_pid(worker, index, pid_fd, &key)) {
+        close(pid_fd);
+        return;
+    }
+    
+    library_list_init_arena(&libs, worker->arena);
+    file_list_init_arena(&files, worker->arena);
+    
+    /* Requirement 3.2: Get loaded crypto libraries */
+    t0 = monotonic_ns();
+    proc_scanner_get_loaded_libraries_at(shared->scanner, pid_fd, &libs);
+    
+    /* Requirement 3.3: Get open crypto files */
+    t1 = monotonic_ns();
+    proc_scanner_get_open_files_at(shared->scanner, pid_fd, &files);
+    t2 = monotonic_ns();
+    
+    worker->maps_ns += t1 - t0;
+    worker->fds_ns += t2 - t1;
+    
+    /* Only include processes that have crypto libraries or files */
+    if (libs.count > 0 || files.count > 0) {
+        if (proc_scanner_get_process_info_at(shared->scanner, pid_fd, shared->pids[index],
+                                             &info, worker->arena) == 0 &&
+            fill_snapshot_process(&shared->slots[index], worker->arena, shared->library_table,
+                                  &info, &libs, &files, shared->config->redact) != 0) {
+            memset(&shared->slots[index], 0, sizeof(shared->slots[index]));
+        }
+        worker->info_ns += monotonic_ns() - t2;
+    }
+    
+    /* A process found using cryptography is only recorded once its
+     * entry is filled, so a failed one is scanned again next time */
+    if (state && (shared->slots[index].name || (libs.count == 0 && files.count == 0))) {
+        snapshot_state_record(state, index, &key,
+                              shared->slots[index].name ? &shared->slots[index] : NULL);
+    }
+    
+    worker->scanned++;
+    
+    library_list_free(&libs);
+    file_list_free(&files);
+    close(pid_fd);
+}
+
+/**
+ * Worker loop: claim chunks of the PID list until it is exhausted or the
+ * deadline passes
+ */
+static void *scan_worker_main(void *arg) {
+    scan_worker_t *worker = arg;
+    scan_shared_t *shared = worker->shared;
+    size_t start, end;
+    
+    for (;;) {
+        start = atomic_fetch_add(&shared->next, SCAN_CHUNK_SIZE);
+        if (start >= shared->pid_count) {
+            break;
+        }
+        end = start + SCAN_CHUNK_SIZE < shared->pid_count ? start + SCAN_CHUNK_SIZE : shared->pid_count;
+        
+        for (size_t i = start; i < end; i++) {
+            if (atomic_load_explicit(&shared->timed_out, memory_order_relaxed)) {
+                return NULL;
+            }
+            if (monotonic_ns() >= shared->deadline_ns) {
+                atomic_store(&shared->timed_out, true);
+                return NULL;
+            }
+            
+            scan_pid(worker, i);
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Keep the previous run's entries of the processes the deadline left
+ * unscanned, so that an incremental run that times out neither reports
+ * them as gone nor forgets them
+ */
+static void carry_over_unscanned(scan_shared_t *shared, string_arena_t *arena) {
+    snapshot_state_t *state = shared->config->state;
+    const snapshot_state_entry_t *prev;
+    
+    for (size_t i = 0; i < shared->pid_count; i++) {
+        if (snapshot_state_recorded(state, i) || shared->slots[i].name) {
+            continue;
+        }
+        prev = snapshot_state_find(state, (uint32_t)shared->pids[i]);
+        if (!prev) {
+            continue;
+        }
+        if (prev->process.name &&
+            reuse_snapshot_process(&shared->slots[i], arena, shared->library_table,
+                                   &prev->process) != 0) {
+            memset(&shared->slots[i], 0, sizeof(shared->slots[i]));
+            continue;
+        }
+        snapshot_state_record(state, i, &prev->key, prev->process.name ? &shared->slots[i] : NULL);
+    }
+}
+
+/**
+ * Pick the worker count: one per online CPU, capped, and never more
+ * than there are chunks to claim
+ */
+static unsigned int scan_thread_count(unsigned int requested, size_t pid_count) {
+    size_t chunks = (pid_count + SCAN_CHUNK_SIZE - 1) / SCAN_CHUNK_SIZE;
+    long cpus;
+    
+    if (requested == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        requested = cpus > 0 ? (unsigned int)cpus : 1;
+    }
+    if (requested > SNAPSHOT_MAX_THREADS) {
+        requested = SNAPSHOT_MAX_THREADS;
+    }
+    if (requested > chunks) {
+        requested = chunks > 0 ? (unsigned int)chunks : 1;
+    }
+    
+    return requested;
+}
+
+/**
+ * Compact the listed slots in place, in /proc order, and total them up
+ */
+static void merge_slots(snapshot_t *snapshot, snapshot_process_t *slots, size_t slot_count) {
+    size_t count = 0;
+    
+    snapshot->summary.total_processes = 0;
+    snapshot->summary.total_libraries = 0;
+    snapshot->summary.total_files = 0;
+    
+    for (size_t i = 0; i < slot_count; i++) {
+        if (!slots[i].name) {
+            continue;
+        }
+        if (count != i) {
+            slots[count] = slots[i];
+        }
+        
+        snapshot->summary.total_libraries += (int)slots[count].library_count;
+        snapshot->summary.total_files += (int)slots[count].file_count;
+        count++;
+    }
+    
+    /* Give back the slots of processes that were not listed */
+    if (count > 0 && count < slot_count) {
+        snapshot_process_t *shrunk = realloc(slots, count * sizeof(*slots));
+        if (shrunk) {
+            slots = shrunk;
+        }
+    }
+    
+    snapshot->processes = slots;
+    snapshot->process_count = count;
+    snapshot->summary.total_processes = (int)count;
+}
+
+/**
+ * Classify one process's iterator records into its slot
+ * comm/exe/status are still read from /proc, for matching processes only
+ */
+static void scan_iter_process(proc_scanner_t *scanner, const snapshot_scan_config_t *config,
+                              int proc_fd, string_arena_t *arena, path_intern_t *library_table,
+                              const snapshot_iter_record_t *records, size_t count,
+                              snapshot_process_t *slot) {
+    library_list_t libs;
+    file_list_t files;
+    process_info_t info;
+    int pid_fd;
+    
+    library_list_init_arena(&libs, arena);
+    file_list_init_arena(&files, arena);
+    
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].kind == CT_ITER_LIBRARY) {
+            proc_scanner_add_library_path(scanner, &libs, records[i].path);
+        } else {
+            proc_scanner_add_file_path(scanner, &files, records[i].path, records[i].fd);
+        }
+    }
+    
+    if (libs.count > 0 || files.count > 0) {
+        pid_fd = proc_scanner_open_pid(proc_fd, records[0].pid);
+        if (pid_fd >= 0) {
+            if (proc_scanner_get_process_info_at(scanner, pid_fd, records[0].pid, &info, arena) == 0 &&
+                fill_snapshot_process(slot, arena, library_table, &info, &libs, &files,
+                                      config->redact) != 0) {
+                memset(slot, 0, sizeof(*slot));
+            }
+            close(pid_fd);
+        }
+    }
+    
+    library_list_free(&libs);
+    file_list_free(&files);
+}
+
+/**
+ * Scan with the BPF iterator backend: one slot per process in the
+ * records, which are sorted by pid
+ * Returns 0 on success, -1 if the iterators are unavailable
+ */
+static int scan_with_iterators(proc_scanner_t *scanner, const snapshot_scan_config_t *config,
+                               snapshot_t *snapshot, snapshot_scan_stats_t *stats) {
+    snapshot_iter_result_t result;
+    snapshot_process_t *slots;
+    path_intern_t *library_table;
+    size_t groups = 0;
+    uint64_t t0, t1, t2;
+    int proc_fd;
+    
+    t0 = monotonic_ns();
+    if (snapshot_iter_collect(crypto_classifier_default(), &result) != 0) {
+        return -1;
+    }
+    t1 = monotonic_ns();
+    
+    for (size_t i = 0; i < result.count; i++) {
+        if (i == 0 || result.records[i].pid != result.records[i - 1].pid) {
+            groups++;
+        }
+    }
+    
+    proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    slots = calloc(groups > 0 ? groups : 1, sizeof(*slots));
+    snapshot->arena = string_arena_create(0);
+    if (proc_fd < 0 || !slots || !snapshot->arena) {
+        log_error("Failed to set up snapshot scan");
+        if (proc_fd >= 0) {
+            close(proc_fd);
+        }
+        free(slots);
+        string_arena_destroy(snapshot->arena);
+        snapshot->arena = NULL;
+        snapshot_iter_result_free(&result);
+        return -1;
+    }
+    
+    library_table = proc_scanner_library_table(scanner);
+    snapshot->library_table = library_table;
+    
+    for (size_t start = 0, slot = 0; start < result.count; slot++) {
+        size_t end = start + 1;
+        
+        while (end < result.count && result.records[end].pid == result.records[start].pid) {
+            end++;
+        }
+        scan_iter_process(scanner, config, proc_fd, snapshot->arena, library_table,
+                          &result.records[start], end - start, &slots[slot]);
+        start = end;
+    }
+    t2 = monotonic_ns();
+    
+    merge_slots(snapshot, slots, groups);
+    
+    stats->list_ns = t1 - t0;
+    stats->scan_ns = t2 - t1;
+    stats->merge_ns = monotonic_ns() - t2;
+    stats->pids_listed = groups;
+    stats->pids_scanned = groups;
+    stats->threads = 1;
+    stats->arena_bytes = string_arena_bytes_reserved(snapshot->arena);
+    stats->bpf_iter = true;
+    
+    close(proc_fd);
+    snapshot_iter_result_free(&result);
+    return 0;
+}
+
+/**
+ * Scan all processes for crypto libraries and open crypto files
+ * Requirements: 3.1, 3.2, 3.3, 3.5
+ *
+ * @param scanner Proc scanner instance
+ * @param config Scan configuration (NULL = defaults)
+ * @param snapshot Snapshot whose process list and summary to fill
+ * @param stats Output timings and counters (optional)
+ * @return 0 on success, -1 on failure
+ */
+int snapshot_scan(proc_scanner_t *scanner, const snapshot_scan_config_t *config,
+                  snapshot_t *snapshot, snapshot_scan_stats_t *stats) {
+    static const snapshot_scan_config_t default_config = { .redact = true };
+    snapshot_scan_stats_t local_stats;
+    scan_worker_t workers[SNAPSHOT_MAX_THREADS];
+    scan_shared_t shared;
+    pid_t *pids = NULL;
+    size_t pid_count = 0;
+    unsigned int threads;
+    uint64_t t0, t1, t2;
+    int timeout_ms;
+    
+    if (!scanner || !snapshot) {
+        return -1;
+    }
+    if (!config) {
+        config = &default_config;
+    }
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    
+    if (config->bpf_iter && !config->state) {
+        if (scan_with_iterators(scanner, config, snapshot, stats) == 0) {
+            return 0;
+        }
+        log_debug("Falling back to scanning /proc");
+    }
+    
+    /* Requirement 3.1: Scan all running processes */
+    t0 = monotonic_ns();
+    if (proc_scanner_list_pids(scanner, &pids, &pid_count) != 0) {
+        log_error("Failed to list processes");
+        return -1;
+    }
+    
+    memset(&shared, 0, sizeof(shared));
+    shared.proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    shared.slots = calloc(pid_count > 0 ? pid_count : 1, sizeof(*shared.slots));
+    snapshot->arena = string_arena_create(0);
+    if (shared.proc_fd < 0 || !shared.slots || !snapshot->arena) {
+        log_error("Failed to set up snapshot scan");
+        if (shared.proc_fd >= 0) {
+            close(shared.proc_fd);
+        }
+        free(shared.slots);
+        string_arena_destroy(snapshot->arena);
+        snapshot->arena = NULL;
+        free(pids);
+        return -1;
+    }
+    if (config->state && snapshot_state_begin(config->state, pid_count) != 0) {
+        log_error("Failed to set up snapshot state");
+        close(shared.proc_fd);
+        free(shared.slots);
+        string_arena_destroy(snapshot->arena);
+        snapshot->arena = NULL;
+        free(pids);
+        return -1;
+    }
+    
+    timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : SNAPSHOT_DEFAULT_TIMEOUT_MS;
+    shared.scanner = scanner;
+    shared.library_table = proc_scanner_library_table(scanner);
+    snapshot->library_table = shared.library_table;
+    shared.config = config;
+    shared.pids = pids;
+    shared.pid_count = pid_count;
+    atomic_init(&shared.next, 0);
+    atomic_init(&shared.timed_out, false);
+    shared.deadline_ns = t0 + (uint64_t)timeout_ms * 1000000ULL;
+    
+    threads = scan_thread_count(config->threads, pid_count);
+    log_debug("Scanning %zu processes with %u threads", pid_count, threads);
+    
+    /* The calling thread is worker 0; a worker that fails to start only
+     * leaves more chunks for the others */
+    t1 = monotonic_ns();
+    memset(workers, 0, sizeof(workers));
+    for (unsigned int i = 0; i < threads; i++) {
+        workers[i].shared = &shared;
+        /* Worker 0 fills the snapshot's arena directly */
+        workers[i].arena = i == 0 ? snapshot->arena : string_arena_create(0);
+        if (i > 0 && workers[i].arena) {
+            workers[i].started = pthread_create(&workers[i].thread, NULL,
+                                                scan_worker_main, &workers[i]) == 0;
+        }
+    }
+    scan_worker_main(&workers[0]);
+    
+    for (unsigned int i = 0; i < threads; i++) {
+        if (workers[i].started) {
+            pthread_join(workers[i].thread, NULL);
+        }
+        stats->maps_ns += workers[i].maps_ns;
+        stats->fds_ns += workers[i].fds_ns;
+        stats->info_ns += workers[i].info_ns;
+        stats->pids_scanned += workers[i].scanned;
+        stats->pids_reused += workers[i].reused;
+        if (i > 0) {
+            string_arena_merge(snapshot->arena, workers[i].arena);
+            string_arena_destroy(workers[i].arena);
+        }
+    }
+    t2 = monotonic_ns();
+    
+    stats->timed_out = atomic_load(&shared.timed_out);
+    if (config->state && stats->timed_out) {
+        carry_over_unscanned(&shared, snapshot->arena);
+    }
+    merge_slots(snapshot, shared.slots, pid_count);
+    
+    stats->list_ns = t1 - t0;
+    stats->scan_ns = t2 - t1;
+    stats->merge_ns = monotonic_ns() - t2;
+    stats->pids_listed = pid_count;
+    stats->threads = threads;
+    stats->arena_bytes = string_arena_bytes_reserved(snapshot->arena);
+    
+    close(shared.proc_fd);
+    free(pids);
+    
+    return 0;
+}
+
+/**
+ * Free the process entries of a snapshot and the arena holding their strings
+ */
+void snapshot_free_processes(snapshot_t *snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    
+    free(snapshot->processes);
+    string_arena_destroy(snapshot->arena);
+    snapshot->processes = NULL;
+    snapshot->process_count = 0;
+    snapshot->arena = NULL;
+    snapshot->library_table = NULL;
+}
@@ -0,0 +1,611 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * snapshot_state.c - Per-process state carried between incremental snapshots
+ * The state file is line based:
+ *
+ *   crypto-tracer-snapshot-state 1 redact=1
+ *   generated_at 2024-11-18T12:34:56Z
+ *   p <pid> <start> <exe dev> <exe ino> <vsize> <fds>
+ *   c <pid> <start> <exe dev> <exe ino> <vsize> <fds> <libs> <files> <name> <exe> <running as>
+ *   l <library path>
+ *   f <file path>
+ *
+ * with tab-separated fields. "p" is a process that uses no cryptography;
+ * "c" one that does, followed by its "l" and "f" lines. Strings have '%',
+ * tab and newline percent-escaped. Loaded entries are kept sorted by pid
+ * and their strings in one arena.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "include/snapshot_state.h"
+#include "include/string_arena.h"
+#include "include/logger.h"
+
+#define STATE_MAGIC "crypto-tracer-snapshot-state"
+#define STATE_VERSION 1
+
+/* Fields of a "c" line */
+#define STATE_PROCESS_FIELDS 12
+
+struct snapshot_state {
+    bool redact;
+    string_arena_t *arena;             /* Strings and arrays of loaded entries */
+    snapshot_state_entry_t *previous;  /* Sorted by pid */
+    size_t previous_count;
+    char *since;                       /* generated_at of the previous run */
+    snapshot_state_entry_t *current;   /* One per listed PID of this run */
+    size_t current_count;
+};
+
+static int compare_entries(const void *a, const void *b) {
+    uint32_t x = ((const snapshot_state_entry_t *)a)->key.pid;
+    uint32_t y = ((const snapshot_state_entry_t *)b)->key.pid;
+    
+    return x < y ? -1 : x > y;
+}
+
+static bool same_process(const snapshot_process_key_t *a, const snapshot_process_key_t *b) {
+    return a->pid == b->pid && a->start_time == b->start_time &&
+           a->exe_dev == b->exe_dev && a->exe_ino == b->exe_ino;
+}
+
+/**
+ * Undo the escaping of a string field in place
+ */
+static void unescape(char *str) {
+    char *out = str;
+    unsigned int byte;
+    
+    for (; *str; str++) {
+        if (*str == '%' && sscanf(str + 1, "%2x", &byte) == 1 && str[1] && str[2]) {
+            *out++ = (char)byte;
+            str += 2;
+        } else {
+            *out++ = *str;
+        }
+    }
+    *out = '\0';
+}
+
+static void write_escaped(FILE *fp, const char *str) {
+    for (; str && *str; str++) {
+        if (*str == '%' || *str == '\t' || *str == '\n') {
+            fprintf(fp, "%%%02X", (unsigned char)*str);
+        } else {
+            fputc(*str, fp);
+        }
+    }
+}
+
+/**
+ * Split a line into its tab-separated fields
+ * @return Number of fields
+ */
+static size_t split_fields(char *line, char **fields, size_t max) {
+    size_t count = 0;
+    char *tab;
+    
+    line[strcspn(line, "\n")] = '\0';
+    while (count < max) {
+        fields[count++] = line;
+        tab = strchr(line, '\t');
+        if (!tab) {
+            break;
+        }
+        *tab = '\0';
+        line = tab + 1;
+    }
+    return count;
+}
+
+static int parse_key(char **fields, snapshot_process_key_t *key) {
+    char *end;
+    uint64_t values[6];
+    
+    for (int i = 0; i < 6; i++) {
+        errno = 0;
+        values[i] = strtoull(fields[i], &end, 10);
+        if (errno || end == fields[i] || *end) {
+            return -1;
+        }
+    }
+    key->pid = (uint32_t)values[0];
+    key->start_time = values[1];
+    key->exe_dev = values[2];
+    key->exe_ino = values[3];
+    key->vsize = values[4];
+    key->fd_count = (uint32_t)values[5];
+    return 0;
+}
+
+static char *arena_field(string_arena_t *arena, char *field) {
+    unescape(field);
+    return string_arena_strdup(arena, field);
+}
+
+/**
+ * Parse the process lines of a state file
+ * @return 0 on success, -1 if malformed or out of memory
+ */
+static int parse_entries(snapshot_state_t *state, FILE *fp) {
+    snapshot_state_entry_t *entry = NULL;
+    size_t capacity = 0, libs = 0, files = 0;
+    size_t line_cap = 0;
+    char *fields[STATE_PROCESS_FIELDS];
+    char *line = NULL;
+    size_t count;
+    int ret = 0;
+    
+    while (ret == 0 && getline(&line, &line_cap, fp) > 0) {
+        count = split_fields(line, fields, STATE_PROCESS_FIELDS);
+        
+        if (strcmp(fields[0], "l") == 0 || strcmp(fields[0], "f") == 0) {
+            snapshot_process_t *proc = entry ? &entry->process : NULL;
+            bool lib = fields[0][0] == 'l';
+            
+            if (count != 2 || !proc || (lib ? libs >= proc->library_count : files >= proc->file_count)) {
+                ret = -1;
+            } else if (lib) {
+                proc->libraries[libs] = arena_field(state->arena, fields[1]);
+                ret = proc->libraries[libs++] ? 0 : -1;
+            } else {
+                proc->open_crypto_files[files] = arena_field(state->arena, fields[1]);
+                ret = proc->open_crypto_files[files++] ? 0 : -1;
+            }
+            continue;
+        }
+        
+        /* A new process: the previous one must have all its lines */
+        if (entry && (libs != entry->process.library_count || files != entry->process.file_count)) {
+            ret = -1;
+            break;
+        }
+        if (state->previous_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            entry = realloc(state->previous, capacity * sizeof(*entry));
+            if (!entry) {
+                ret = -1;
+                break;
+            }
+            state->previous = entry;
+        }
+        entry = &state->previous[state->previous_count];
+        memset(entry, 0, sizeof(*entry));
+        libs = files = 0;
+        
+        if (strcmp(fields[0], "p") == 0 && count == 7) {
+            ret = parse_key(&fields[1], &entry->key);
+        } else if (strcmp(fields[0], "c") == 0 && count == STATE_PROCESS_FIELDS) {
+            snapshot_process_t *proc = &entry->process;
+            char *end1, *end2;
+            
+            proc->library_count = strtoul(fields[7], &end1, 10);
+            proc->file_count = strtoul(fields[8], &end2, 10);
+            if (parse_key(&fields[1], &entry->key) != 0 || *end1 || *end2 ||
+                proc->library_count > 65536 || proc->file_count > 65536) {
+                ret = -1;
+                break;
+            }
+            proc->pid = entry->key.pid;
+            proc->name = arena_field(state->arena, fields[9]);
+            proc->exe = arena_field(state->arena, fields[10]);
+            proc->running_as = arena_field(state->arena, fields[11]);
+            proc->libraries = string_arena_alloc(state->arena,
+                                                 (proc->library_count + 1) * sizeof(char *));
+            proc->open_crypto_files = string_arena_alloc(state->arena,
+                                                         (proc->file_count + 1) * sizeof(char *));
+            if (!proc->name || !proc->exe || !proc->running_as || !proc->libraries ||
+                !proc->open_crypto_files) {
+                ret = -1;
+            }
+        } else {
+            ret = -1;
+        }
+        entry = ret == 0 ? entry : NULL;
+        state->previous_count += ret == 0;
+    }
+    
+    if (ret == 0 && entry &&
+        (libs != entry->process.library_count || files != entry->process.file_count)) {
+        ret = -1;
+    }
+    free(line);
+    return ret;
+}
+
+/**
+ * Load the state of the previous run
+ */
+snapshot_state_t *snapshot_state_load(const char *path, bool redact) {
+    snapshot_state_t *state;
+    char header[256];
+    char since[128];
+    int version, file_redact;
+    FILE *fp;
+    
+    state = calloc(1, sizeof(*state));
+    if (!state) {
+        return NULL;
+    }
+    state->redact = redact;
+    state->arena = string_arena_create(0);
+    if (!state->arena) {
+        free(state);
+        return NULL;
+    }
+    
+    fp = path ? fopen(path, "r") : NULL;
+    if (!fp) {
+        if (path && errno != ENOENT) {
+            log_warn("Cannot read snapshot state %s: %s", path, strerror(errno));
+        }
+        return state;
+    }
+    
+    if (!fgets(header, sizeof(header), fp) ||
+        sscanf(header, STATE_MAGIC " %d redact=%d", &version, &file_redact) != 2 ||
+        version != STATE_VERSION || !fgets(header, sizeof(header), fp) ||
+        sscanf(header, "generated_at %127s", since) != 1) {
+        log_warn("Ignoring snapshot state %s: unknown format", path);
+    } else if (file_redact != (int)redact) {
+        log_info("Snapshot state %s was written with redaction %s, scanning every process",
+                 path, file_redact ? "on" : "off");
+    } else if (parse_entries(state, fp) != 0) {
+        log_warn("Ignoring snapshot state %s: malformed", path);
+        state->previous_count = 0;
+    } else {
+        state->since = string_arena_strdup(state->arena, since);
+        qsort(state->previous, state->previous_count, sizeof(*state->previous), compare_entries);
+    }
+    
+    fclose(fp);
+    return state;
+}
+
+void snapshot_state_destroy(snapshot_state_t *state) {
+    if (!state) {
+        return;
+    }
+    
+    free(state->previous);
+    free(state->current);
+    string_arena_destroy(state->arena);
+    free(state);
+}
+
+/**
+ * Count the open fds of a process
+ * stat() of /proc/[pid]/fd reports the count as its size since Linux 6.2;
+ * older kernels report 0 and the directory is listed instead, which still
+ * reads no link
+ */
+static uint32_t count_fds(int pid_fd) {
+    struct dirent *entry;
+    struct stat st;
+    uint32_t count = 0;
+    DIR *dir;
+    int fd;
+    
+    if (fstatat(pid_fd, "fd", &st, 0) != 0) {
+        return 0;
+    }
+    if (st.st_size > 0) {
+        return (uint32_t)st.st_size;
+    }
+    
+    fd = openat(pid_fd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (!dir) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        count += entry->d_name[0] != '.';
+    }
+    closedir(dir);
+    return count;
+}
+
+/**
+ * Read a process's identity and signature
+ * starttime and vsize are fields 22 and 23 of /proc/[pid]/stat, counted
+ * after the parenthesized comm, which may itself hold spaces
+ */
+int snapshot_state_read_key(int pid_fd, pid_t pid, snapshot_process_key_t *key) {
+    char buf[1024];
+    struct stat st;
+    char *fields;
+    ssize_t len;
+    int fd;
+    
+    memset(key, 0, sizeof(*key));
+    fd = openat(pid_fd, "stat", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    
+    fields = strrchr(buf, ')');
+    if (!fields || sscanf(fields + 1,
+                          " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d"
+                          " %*d %*d %" SCNu64 " %" SCNu64, &key->start_time, &key->vsize) != 2) {
+        return -1;
+    }
+    
+    key->pid = (uint32_t)pid;
+    if (fstatat(pid_fd, "exe", &st, 0) == 0) {
+        key->exe_dev = (uint64_t)st.st_dev;
+        key->exe_ino = (uint64_t)st.st_ino;
+    }
+    key->fd_count = count_fds(pid_fd);
+    return 0;
+}
+
+const snapshot_state_entry_t *snapshot_state_find(const snapshot_state_t *state, uint32_t pid) {
+    snapshot_state_entry_t probe;
+    
+    if (!state || state->previous_count == 0) {
+        return NULL;
+    }
+    probe.key.pid = pid;
+    return bsearch(&probe, state->previous, state->previous_count, sizeof(probe), compare_entries);
+}
+
+const snapshot_state_entry_t *snapshot_state_unchanged(const snapshot_state_t *state,
+                                                       const snapshot_process_key_t *key) {
+    const snapshot_state_entry_t *entry = snapshot_state_find(state, key->pid);
+    
+    if (!entry || !same_process(&entry->key, key) || entry->key.vsize != key->vsize ||
+        entry->key.fd_count != key->fd_count) {
+        return NULL;
+    }
+    return entry;
+}
+
+int snapshot_state_begin(snapshot_state_t *state, size_t count) {
+    free(state->current);
+    state->current = calloc(count > 0 ? count : 1, sizeof(*state->current));
+    state->current_count = state->current ? count : 0;
+    return state->current ? 0 : -1;
+}
+
+void snapshot_state_record(snapshot_state_t *state, size_t index,
+                           const snapshot_process_key_t *key, const snapshot_process_t *process) {
+    snapshot_state_entry_t *entry;
+    
+    if (!state || index >= state->current_count) {
+        return;
+    }
+    entry = &state->current[index];
+    entry->key = *key;
+    if (process) {
+        entry->process = *process;
+    } else {
+        memset(&entry->process, 0, sizeof(entry->process));
+    }
+    entry->recorded = true;
+}
+
+bool snapshot_state_recorded(const snapshot_state_t *state, size_t index) {
+    return state && index < state->current_count && state->current[index].recorded;
+}
+
+/**
+ * Write this run's processes
+ */
+int snapshot_state_save(snapshot_state_t *state, const char *path, const char *generated_at) {
+    char tmp_path[4096];
+    FILE *fp;
+    int ret;
+    
+    if (!state || !path) {
+        return -1;
+    }
+    
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+    fp = fopen(tmp_path, "w");
+    if (!fp) {
+        log_error("Cannot write snapshot state %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+    
+    fprintf(fp, STATE_MAGIC " %d redact=%d\n", STATE_VERSION, state->redact ? 1 : 0);
+    fprintf(fp, "generated_at %s\n", generated_at ? generated_at : "unknown");
+    for (size_t i = 0; i < state->current_count; i++) {
+        const snapshot_state_entry_t *entry = &state->current[i];
+        const snapshot_process_key_t *key = &entry->key;
+        const snapshot_process_t *proc = &entry->process;
+        
+        if (!entry->recorded) {
+            continue;
+        }
+        fprintf(fp, "%c\t%" PRIu32 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu32,
+                proc->name ? 'c' : 'p', key->pid, key->start_time, key->exe_dev, key->exe_ino,
+                key->vsize, key->fd_count);
+        if (!proc->name) {
+            fputc('\n', fp);
+            continue;
+        }
+        fprintf(fp, "\t%zu\t%zu\t", proc->library_count, proc->file_count);
+        write_escaped(fp, proc->name);
+        fputc('\t', fp);
+        write_escaped(fp, proc->exe);
+        fputc('\t', fp);
+        write_escaped(fp, proc->running_as);
+        fputc('\n', fp);
+        for (size_t j = 0; j < proc->library_count; j++) {
+            fputs("l\t", fp);
+            write_escaped(fp, proc->libraries[j]);
+            fputc('\n', fp);
+        }
+        for (size_t j = 0; j < proc->file_count; j++) {
+            fputs("f\t", fp);
+            write_escaped(fp, proc->open_crypto_files[j]);
+            fputc('\n', fp);
+        }
+    }
+    
+    ret = ferror(fp) ? -1 : 0;
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    if (ret == 0 && rename(tmp_path, path) != 0) {
+        ret = -1;
+    }
+    if (ret != 0) {
+        log_error("Cannot write snapshot state %s: %s", path, strerror(errno));
+        unlink(tmp_path);
+    }
+    return ret;
+}
+
+/**
+ * Strings of from that are not in minus, in from's order
+ * Lists are a process's libraries or files: short, so compared pairwise
+ * @return Number of strings put in *out, or -1 when out of memory
+ */
+static long subtract(string_arena_t *arena, char **from, size_t from_count,
+                     char **minus, size_t minus_count, char ***out) {
+    long count = 0;
+    
+    *out = NULL;
+    for (size_t i = 0; i < from_count; i++) {
+        bool found = false;
+        
+        for (size_t j = 0; j < minus_count && !found; j++) {
+            found = strcmp(from[i], minus[j]) == 0;
+        }
+        if (found) {
+            continue;
+        }
+        if (!*out) {
+            *out = string_arena_alloc(arena, from_count * sizeof(char *));
+            if (!*out) {
+                return -1;
+            }
+        }
+        (*out)[count++] = from[i];
+    }
+    return count;
+}
+
+/**
+ * Add the part of a process in a - b to a diff, if any
+ * @return 0 on success, -1 when out of memory
+ */
+static int add_difference(snapshot_t *diff, const snapshot_process_t *a,
+                          const snapshot_process_t *b) {
+    snapshot_process_t *proc = &diff->processes[diff->process_count];
+    long libs, files;
+    
+    memset(proc, 0, sizeof(*proc));
+    libs = subtract(diff->arena, a->libraries, a->library_count,
+                    b ? b->libraries : NULL, b ? b->library_count : 0, &proc->libraries);
+    files = subtract(diff->arena, a->open_crypto_files, a->file_count,
+                     b ? b->open_crypto_files : NULL, b ? b->file_count : 0,
+                     &proc->open_crypto_files);
+    if (libs < 0 || files < 0) {
+        return -1;
+    }
+    if (b && libs == 0 && files == 0) {
+        return 0;
+    }
+    
+    proc->pid = a->pid;
+    proc->name = a->name;
+    proc->exe = a->exe;
+    proc->running_as = a->running_as;
+    proc->library_count = (size_t)libs;
+    proc->file_count = (size_t)files;
+    diff->process_count++;
+    diff->summary.total_processes++;
+    diff->summary.total_libraries += (int)libs;
+    diff->summary.total_files += (int)files;
+    return 0;
+}
+
+/**
+ * Compare this run with the previous one
+ * Processes are matched by identity, so a reused pid is a removed
+ * process and an added one
+ */
+int snapshot_state_diff(snapshot_state_t *state, snapshot_t *added, snapshot_t *removed) {
+    bool *matched;
+    int ret = 0;
+    
+    if (!state || !added || !removed) {
+        return -1;
+    }
+    
+    matched = calloc(state->previous_count + 1, sizeof(*matched));
+    added->processes = calloc(state->current_count + 1, sizeof(*added->processes));
+    removed->processes = calloc(state->current_count + state->previous_count + 1,
+                                sizeof(*removed->processes));
+    added->arena = string_arena_create(0);
+    removed->arena = string_arena_create(0);
+    if (!matched || !added->processes || !removed->processes || !added->arena || !removed->arena) {
+        free(matched);
+        return -1;
+    }
+    
+    for (size_t i = 0; i < state->current_count && ret == 0; i++) {
+        const snapshot_state_entry_t *entry = &state->current[i];
+        const snapshot_state_entry_t *prev;
+        
+        if (!entry->recorded || !entry->process.name) {
+            continue;
+        }
+        prev = snapshot_state_find(state, entry->key.pid);
+        if (prev && (!prev->process.name || !same_process(&prev->key, &entry->key))) {
+            prev = NULL;
+        }
+        if (prev) {
+            matched[prev - state->previous] = true;
+        }
+        
+        ret = add_difference(added, &entry->process, prev ? &prev->process : NULL);
+        if (ret == 0 && prev) {
+            ret = add_difference(removed, &prev->process, &entry->process);
+        }
+    }
+    
+    for (size_t i = 0; i < state->previous_count && ret == 0; i++) {
+        if (state->previous[i].process.name && !matched[i]) {
+            ret = add_difference(removed, &state->previous[i].process, NULL);
+        }
+    }
+    
+    free(matched);
+    return ret;
+}
+
+const char *snapshot_state_since(const snapshot_state_t *state) {
+    return state ? state->since : NULL;
+}
+
+size_t snapshot_state_previous_count(const snapshot_state_t *state) {
+    return state ? state->previous_count : 0;
+}
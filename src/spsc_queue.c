@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * spsc_queue.c - Bounded single-producer/single-consumer queue implementation
+ * Lock-free ring of pointers: the producer owns tail, the consumer owns
+ * head, and each index lives on its own cache line. The mutex and
+ * condition variable are only used when the consumer has gone idle.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "include/spsc_queue.h"
+#include "include/logger.h"
+
+#define CACHE_LINE_SIZE 64
+
+/* Largest supported capacity */
+#define SPSC_MAX_CAPACITY (1U << 24)
+
+struct spsc_queue {
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;   /* Next slot to pop (consumer) */
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;   /* Next slot to push (producer) */
+    _Alignas(CACHE_LINE_SIZE) atomic_bool consumer_waiting;
+    bool woken;                                      /* Protected by lock */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t mask;
+    void **slots;
+};
+
+/**
+ * Create a queue
+ *
+ * @param capacity Minimum number of items the queue can hold
+ * @return Pointer to queue, or NULL on failure
+ */
+spsc_queue_t *spsc_queue_create(size_t capacity) {
+    spsc_queue_t *queue;
+    size_t size = 1;
+    
+    if (capacity == 0 || capacity > SPSC_MAX_CAPACITY) {
+        log_error("Invalid queue capacity: %zu", capacity);
+        return NULL;
+    }
+    
+    while (size < capacity) {
+        size <<= 1;
+    }
+    
+    queue = aligned_alloc(CACHE_LINE_SIZE, sizeof(*queue));
+    if (!queue) {
+        log_error("Failed to allocate event queue");
+        return NULL;
+    }
+    memset(queue, 0, sizeof(*queue));
+    
+    queue->slots = calloc(size, sizeof(*queue->slots));
+    if (!queue->slots) {
+        log_error("Failed to allocate event queue slots");
+        free(queue);
+        return NULL;
+    }
+    
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->consumer_waiting, false);
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    queue->mask = size - 1;
+    
+    log_debug("Event queue created with capacity: %zu", size);
+    
+    return queue;
+}
+
+/**
+ * Destroy a queue
+ * Items still queued are not freed; the caller owns them.
+ */
+void spsc_queue_destroy(spsc_queue_t *queue) {
+    if (!queue) {
+        return;
+    }
+    
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->slots);
+    free(queue);
+}
+
+/**
+ * Wake the consumer if it is sleeping in spsc_queue_wait
+ */
+static void notify_consumer(spsc_queue_t *queue) {
+    /* Pairs with the fence in spsc_queue_wait: either the consumer sees
+     * the new tail, or we see that it is waiting */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&queue->consumer_waiting, memory_order_relaxed)) {
+        return;
+    }
+    
+    pthread_mutex_lock(&queue->lock);
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Append an item (producer thread only)
+ *
+ * @return true on success, false if the queue is full
+ */
+bool spsc_queue_push(spsc_queue_t *queue, void *item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    
+    if (tail - head > queue->mask) {
+        return false;
+    }
+    
+    queue->slots[tail & queue->mask] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    
+    notify_consumer(queue);
+    
+    return true;
+}
+
+/**
+ * Remove the oldest item (consumer thread only)
+ *
+ * @return Item, or NULL if the queue is empty
+ */
+void *spsc_queue_pop(spsc_queue_t *queue) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    void *item;
+    
+    if (head == tail) {
+        return NULL;
+    }
+    
+    item = queue->slots[head & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    
+    return item;
+}
+
+/**
+ * Sleep until the producer pushes, spsc_queue_wake is called or the
+ * timeout expires (consumer thread only)
+ */
+void spsc_queue_wait(spsc_queue_t *queue, int timeout_ms) {
+    struct timespec deadline;
+    
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    
+    pthread_mutex_lock(&queue->lock);
+    atomic_store_explicit(&queue->consumer_waiting, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    
+    while (!queue->woken && spsc_queue_size(queue) == 0) {
+        if (pthread_cond_timedwait(&queue->cond, &queue->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    
+    queue->woken = false;
+    atomic_store_explicit(&queue->consumer_waiting, false, memory_order_relaxed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Wake the consumer regardless of the queue state
+ */
+void spsc_queue_wake(spsc_queue_t *queue) {
+    if (!queue) {
+        return;
+    }
+    
+    pthread_mutex_lock(&queue->lock);
+    queue->woken = true;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+size_t spsc_queue_size(spsc_queue_t *queue) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    
+    return tail - head;
+}
+
+size_t spsc_queue_capacity(spsc_queue_t *queue) {
+    return queue->mask + 1;
+}
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * string_arena.c - Bump allocator for short-lived strings
+ * Allocations are bumped out of the current chunk; a full chunk is
+ * replaced by a fresh one. Requests larger than a quarter chunk get a
+ * dedicated chunk so they do not waste the rest of the current one.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "include/string_arena.h"
+#include "include/logger.h"
+
+/* Allocation alignment (arrays of pointers are carved out of the arena too) */
+#define ARENA_ALIGN sizeof(void *)
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGN) char data[];
+} arena_chunk_t;
+
+struct string_arena {
+    arena_chunk_t *head;       /* Current chunk, followed by full ones */
+    size_t chunk_size;
+    size_t bytes_used;
+    size_t bytes_reserved;
+};
+
+/**
+ * Create an arena
+ *
+ * @param chunk_size Bytes per chunk (0 = default)
+ * @return Pointer to arena, or NULL on failure
+ */
+string_arena_t *string_arena_create(size_t chunk_size) {
+    string_arena_t *arena = calloc(1, sizeof(*arena));
+    
+    if (!arena) {
+        log_error("Failed to allocate string arena");
+        return NULL;
+    }
+    
+    arena->chunk_size = chunk_size ? chunk_size : STRING_ARENA_DEFAULT_CHUNK;
+    return arena;
+}
+
+/**
+ * Destroy an arena and every string allocated from it
+ */
+void string_arena_destroy(string_arena_t *arena) {
+    arena_chunk_t *chunk, *next;
+    
+    if (!arena) {
+        return;
+    }
+    
+    for (chunk = arena->head; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    
+    free(arena);
+}
+
+static arena_chunk_t *new_chunk(string_arena_t *arena, size_t size) {
+    arena_chunk_t *chunk = malloc(sizeof(*chunk) + size);
+    
+    if (!chunk) {
+        log_error("Failed to allocate string arena chunk");
+        return NULL;
+    }
+    
+    chunk->size = size;
+    chunk->used = 0;
+    arena->bytes_reserved += size;
+    return chunk;
+}
+
+/**
+ * Allocate size bytes from the arena
+ */
+void *string_arena_alloc(string_arena_t *arena, size_t size) {
+    arena_chunk_t *chunk;
+    void *ptr;
+    
+    if (!arena || size > SIZE_MAX - ARENA_ALIGN) {
+        return NULL;
+    }
+    
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    chunk = arena->head;
+    
+    if (!chunk || chunk->size - chunk->used < size) {
+        if (size > arena->chunk_size / 4) {
+            /* Dedicated chunk, kept behind the current one */
+            chunk = new_chunk(arena, size);
+            if (!chunk) {
+                return NULL;
+            }
+            if (arena->head) {
+                chunk->next = arena->head->next;
+                arena->head->next = chunk;
+            } else {
+                chunk->next = NULL;
+                arena->head = chunk;
+            }
+        } else {
+            chunk = new_chunk(arena, arena->chunk_size);
+            if (!chunk) {
+                return NULL;
+            }
+            chunk->next = arena->head;
+            arena->head = chunk;
+        }
+    }
+    
+    ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->bytes_used += size;
+    
+    return ptr;
+}
+
+/**
+ * Copy at most len bytes of a string into the arena
+ */
+char *string_arena_strndup(string_arena_t *arena, const char *str, size_t len) {
+    char *copy;
+    
+    if (!str) {
+        return NULL;
+    }
+    
+    len = strnlen(str, len);
+    copy = string_arena_alloc(arena, len + 1);
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    
+    return copy;
+}
+
+/**
+ * Copy a string into the arena
+ */
+char *string_arena_strdup(string_arena_t *arena, const char *str) {
+    return str ? string_arena_strndup(arena, str, strlen(str)) : NULL;
+}
+
+/**
+ * Drop every allocation at once
+ * The current chunk is kept (emptied) unless it is a dedicated one, so
+ * an arena that is reset per use stops allocating once warm.
+ */
+void string_arena_reset(string_arena_t *arena) {
+    arena_chunk_t *chunk, *next;
+    arena_chunk_t *keep;
+    
+    if (!arena || !arena->head) {
+        return;
+    }
+    
+    keep = arena->head->size == arena->chunk_size ? arena->head : NULL;
+    for (chunk = keep ? keep->next : arena->head; chunk; chunk = next) {
+        next = chunk->next;
+        arena->bytes_reserved -= chunk->size;
+        free(chunk);
+    }
+    
+    arena->head = keep;
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arena->bytes_used = 0;
+}
+
+/**
+ * Move all chunks of src into dst
+ * dst keeps bumping from its own current chunk; src stays usable.
+ */
+void string_arena_merge(string_arena_t *dst, string_arena_t *src) {
+    arena_chunk_t *tail;
+    
+    if (!dst || !src || dst == src || !src->head) {
+        return;
+    }
+    
+    for (tail = src->head; tail->next; tail = tail->next) {
+        /* Find the last chunk of src */
+    }
+    
+    if (dst->head) {
+        tail->next = dst->head->next;
+        dst->head->next = src->head;
+    } else {
+        dst->head = src->head;
+    }
+    
+    dst->bytes_used += src->bytes_used;
+    dst->bytes_reserved += src->bytes_reserved;
+    
+    src->head = NULL;
+    src->bytes_used = 0;
+    src->bytes_reserved = 0;
+}
+
+size_t string_arena_bytes_used(const string_arena_t *arena) {
+    return arena ? arena->bytes_used : 0;
+}
+
+size_t string_arena_bytes_reserved(const string_arena_t *arena) {
+    return arena ? arena->bytes_reserved : 0;
+}
@@ -0,0 +1,612 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * symbol_cache.c - ELF symbol to file offset resolution, cached on disk
+ * Files are mapped read-only and every header, table and string is
+ * bounds-checked against the mapping before use: libraries come from
+ * container images and are not trusted to be well formed.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <elf.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/symbol_cache.h"
+#include "include/logger.h"
+
+/* Initial hash table size (power of two) */
+#define SYMBOL_TABLE_INITIAL 256
+
+/* Longest build id read (GNU ld emits 20 bytes) */
+#define BUILD_ID_MAX 32
+
+/* Longest cache file line read */
+#define SYMBOL_LINE_MAX 512
+
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t offset;
+    char id[SYMBOL_FILE_ID_LEN];
+    char name[SYMBOL_NAME_MAX];
+} symbol_entry_t;
+
+struct symbol_cache {
+    char *path;                    /* NULL = memory only */
+    pthread_mutex_t lock;
+    symbol_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;               /* Entry index + 1 (0 = empty), open addressing */
+    size_t mask;
+    symbol_cache_stats_t stats;
+    bool append_failed;            /* Stop retrying a cache file we cannot write */
+};
+
+/* A mapped ELF file, validated up to its header tables */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    const Elf64_Ehdr *ehdr;
+    const Elf64_Phdr *phdrs;
+    const Elf64_Shdr *shdrs;
+} elf_image_t;
+
+/**
+ * Map an ELF file and check its class, byte order and header tables
+ */
+static int elf_map(int fd, elf_image_t *img) {
+    struct stat st;
+    const Elf64_Ehdr *ehdr;
+    void *data;
+    
+    memset(img, 0, sizeof(*img));
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(Elf64_Ehdr)) {
+        return -1;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    img->data = data;
+    img->size = (size_t)st.st_size;
+    ehdr = data;
+    
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        ehdr->e_ident[EI_DATA] != ELFDATA2LSB
+#else
+        ehdr->e_ident[EI_DATA] != ELFDATA2MSB
+#endif
+        ) {
+        goto invalid;
+    }
+    if (ehdr->e_phnum > 0) {
+        if (ehdr->e_phentsize != sizeof(Elf64_Phdr) || ehdr->e_phoff > img->size ||
+            (img->size - ehdr->e_phoff) / sizeof(Elf64_Phdr) < ehdr->e_phnum) {
+            goto invalid;
+        }
+        img->phdrs = (const Elf64_Phdr *)(img->data + ehdr->e_phoff);
+    }
+    if (ehdr->e_shnum > 0) {
+        if (ehdr->e_shentsize != sizeof(Elf64_Shdr) || ehdr->e_shoff > img->size ||
+            (img->size - ehdr->e_shoff) / sizeof(Elf64_Shdr) < ehdr->e_shnum) {
+            goto invalid;
+        }
+        img->shdrs = (const Elf64_Shdr *)(img->data + ehdr->e_shoff);
+    }
+    img->ehdr = ehdr;
+    return 0;
+
+invalid:
+    munmap((void *)img->data, img->size);
+    img->data = NULL;
+    return -1;
+}
+
+static void elf_unmap(elf_image_t *img) {
+    if (img->data) {
+        munmap((void *)img->data, img->size);
+        img->data = NULL;
+    }
+}
+
+/* Whether [offset, offset + size) lies inside the file */
+static bool elf_contains(const elf_image_t *img, uint64_t offset, uint64_t size) {
+    return offset <= img->size && size <= img->size - offset;
+}
+
+/**
+ * Find the GNU build id note and write it in hex
+ */
+static bool elf_build_id(const elf_image_t *img, char *hex) {
+    const Elf64_Ehdr *ehdr = img->ehdr;
+    
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        const Elf64_Phdr *ph = &img->phdrs[i];
+        uint64_t align = ph->p_align == 8 ? 8 : 4;
+        uint64_t off = ph->p_offset;
+        uint64_t end;
+        
+        if (ph->p_type != PT_NOTE || !elf_contains(img, ph->p_offset, ph->p_filesz)) {
+            continue;
+        }
+        end = ph->p_offset + ph->p_filesz;
+        
+        while (end - off >= sizeof(Elf64_Nhdr)) {
+            const Elf64_Nhdr *note = (const Elf64_Nhdr *)(img->data + off);
+            uint64_t name_off = off + sizeof(*note);
+            uint64_t desc_off = name_off + ((note->n_namesz + align - 1) & ~(align - 1));
+            uint64_t next = desc_off + ((note->n_descsz + align - 1) & ~(align - 1));
+            
+            if (desc_off > end || note->n_descsz > end - desc_off) {
+                break;
+            }
+            if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 &&
+                memcmp(img->data + name_off, "GNU", 4) == 0 &&
+                note->n_descsz > 0 && note->n_descsz <= BUILD_ID_MAX) {
+                for (uint32_t j = 0; j < note->n_descsz; j++) {
+                    sprintf(hex + 2 * j, "%02x", img->data[desc_off + j]);
+                }
+                return true;
+            }
+            if (next <= off) {
+                break;
+            }
+            off = next;
+        }
+    }
+    return false;
+}
+
+int elf_file_id(int fd, char *id) {
+    elf_image_t img;
+    struct stat st;
+    bool found;
+    
+    if (elf_map(fd, &img) != 0) {
+        return -1;
+    }
+    found = elf_build_id(&img, id);
+    elf_unmap(&img);
+    
+    /* Without a build id, a rewritten file must still look different */
+    if (!found) {
+        if (fstat(fd, &st) != 0) {
+            return -1;
+        }
+        snprintf(id, SYMBOL_FILE_ID_LEN, "m%" PRIu64 "-%" PRIu64, (uint64_t)st.st_size,
+                 (uint64_t)(st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec));
+    }
+    return 0;
+}
+
+/**
+ * File offset of a virtual address, through the loadable segment holding it
+ */
+static uint64_t elf_vaddr_offset(const elf_image_t *img, uint64_t vaddr) {
+    for (int i = 0; i < img->ehdr->e_phnum; i++) {
+        const Elf64_Phdr *ph = &img->phdrs[i];
+        
+        if (ph->p_type == PT_LOAD && vaddr >= ph->p_vaddr && vaddr - ph->p_vaddr < ph->p_filesz) {
+            return vaddr - ph->p_vaddr + ph->p_offset;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Look the names up in one symbol table section
+ * A name defined in several versions (dlopen@GLIBC_2.2.5 and the default
+ * dlopen@@GLIBC_2.34) resolves to the default one, which is what the
+ * dynamic linker binds new callers to.
+ *
+ * @return Number of names still unresolved or only found hidden
+ */
+static size_t elf_scan_symbols(const elf_image_t *img, const Elf64_Shdr *sh,
+                               const char *const *names, size_t count,
+                               uint64_t *vaddrs, bool *hidden) {
+    const Elf64_Shdr *strtab_sh;
+    const Elf64_Sym *syms;
+    const uint16_t *versym = NULL;
+    const char *strtab;
+    size_t nsyms;
+    size_t pending = 0;
+    
+    if (sh->sh_entsize != sizeof(Elf64_Sym) || !elf_contains(img, sh->sh_offset, sh->sh_size) ||
+        sh->sh_link >= img->ehdr->e_shnum) {
+        return count;
+    }
+    strtab_sh = &img->shdrs[sh->sh_link];
+    if (!elf_contains(img, strtab_sh->sh_offset, strtab_sh->sh_size) || strtab_sh->sh_size == 0) {
+        return count;
+    }
+    syms = (const Elf64_Sym *)(img->data + sh->sh_offset);
+    nsyms = sh->sh_size / sizeof(Elf64_Sym);
+    strtab = (const char *)(img->data + strtab_sh->sh_offset);
+    
+    if (sh->sh_type == SHT_DYNSYM) {
+        for (int i = 0; i < img->ehdr->e_shnum; i++) {
+            const Elf64_Shdr *vs = &img->shdrs[i];
+            
+            if (vs->sh_type == SHT_GNU_versym && elf_contains(img, vs->sh_offset, vs->sh_size) &&
+                vs->sh_size / sizeof(uint16_t) >= nsyms) {
+                versym = (const uint16_t *)(img->data + vs->sh_offset);
+                break;
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < nsyms; i++) {
+        const Elf64_Sym *sym = &syms[i];
+        const char *name;
+        size_t max_len;
+        bool is_hidden;
+        
+        if (ELF64_ST_TYPE(sym->st_info) != STT_FUNC || sym->st_shndx == SHN_UNDEF ||
+            sym->st_value == 0 || sym->st_name >= strtab_sh->sh_size) {
+            continue;
+        }
+        name = strtab + sym->st_name;
+        max_len = strtab_sh->sh_size - sym->st_name;
+        if (!memchr(name, '\0', max_len)) {
+            continue;
+        }
+        is_hidden = versym && (versym[i] & 0x8000);
+        
+        for (size_t j = 0; j < count; j++) {
+            if (name[0] == names[j][0] && strcmp(name, names[j]) == 0 &&
+                (vaddrs[j] == 0 || (hidden[j] && !is_hidden))) {
+                vaddrs[j] = sym->st_value;
+                hidden[j] = is_hidden;
+            }
+        }
+    }
+    
+    for (size_t j = 0; j < count; j++) {
+        pending += vaddrs[j] == 0 || hidden[j];
+    }
+    return pending;
+}
+
+int elf_symbol_offsets(int fd, const char *const *names, size_t count, uint64_t *offsets) {
+    elf_image_t img;
+    uint64_t *vaddrs;
+    bool *hidden;
+    size_t pending = count;
+    
+    if (count > 0) {
+        memset(offsets, 0, count * sizeof(*offsets));
+    }
+    if (elf_map(fd, &img) != 0) {
+        return -1;
+    }
+    vaddrs = calloc(count ? count : 1, sizeof(*vaddrs));
+    hidden = calloc(count ? count : 1, sizeof(*hidden));
+    if (!vaddrs || !hidden) {
+        free(vaddrs);
+        free(hidden);
+        elf_unmap(&img);
+        return -1;
+    }
+    
+    /* Exported functions are in .dynsym; .symtab, when not stripped,
+     * only adds the local ones */
+    for (int pass = 0; pass < 2 && pending > 0; pass++) {
+        uint32_t type = pass == 0 ? SHT_DYNSYM : SHT_SYMTAB;
+        
+        for (int i = 0; i < img.ehdr->e_shnum && pending > 0; i++) {
+            if (img.shdrs[i].sh_type == type) {
+                pending = elf_scan_symbols(&img, &img.shdrs[i], names, count, vaddrs, hidden);
+            }
+        }
+    }
+    
+    for (size_t j = 0; j < count; j++) {
+        offsets[j] = vaddrs[j] ? elf_vaddr_offset(&img, vaddrs[j]) : 0;
+    }
+    
+    free(vaddrs);
+    free(hidden);
+    elf_unmap(&img);
+    return 0;
+}
+
+static size_t slot_of(const symbol_cache_t *cache, uint64_t dev, uint64_t ino, const char *name) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (dev * 0x9E3779B97F4A7C15ULL) ^ ino;
+    
+    for (const char *p = name; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 0x100000001b3ULL;
+    }
+    return (size_t)(hash ^ (hash >> 32)) & cache->mask;
+}
+
+/* Slot holding (dev, ino, name), or the empty slot where it would go */
+static size_t find_slot(const symbol_cache_t *cache, uint64_t dev, uint64_t ino, const char *name) {
+    size_t i = slot_of(cache, dev, ino, name);
+    
+    while (cache->slots[i]) {
+        const symbol_entry_t *entry = &cache->entries[cache->slots[i] - 1];
+        
+        if (entry->dev == dev && entry->ino == ino && strcmp(entry->name, name) == 0) {
+            break;
+        }
+        i = (i + 1) & cache->mask;
+    }
+    return i;
+}
+
+static int grow_slots(symbol_cache_t *cache) {
+    uint32_t *old = cache->slots;
+    size_t old_size = cache->mask + 1;
+    
+    cache->slots = calloc(old_size * 2, sizeof(*cache->slots));
+    if (!cache->slots) {
+        cache->slots = old;
+        return -1;
+    }
+    cache->mask = old_size * 2 - 1;
+    
+    for (size_t i = 0; i < cache->count; i++) {
+        const symbol_entry_t *entry = &cache->entries[i];
+        
+        cache->slots[find_slot(cache, entry->dev, entry->ino, entry->name)] = (uint32_t)i + 1;
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * Add or update a symbol (lock held)
+ * A newer identity replaces an older one: the inode now holds another file.
+ */
+static int store_symbol(symbol_cache_t *cache, uint64_t dev, uint64_t ino, const char *id,
+                        const char *name, uint64_t offset) {
+    symbol_entry_t *entry;
+    size_t slot;
+    
+    if (strlen(name) >= SYMBOL_NAME_MAX || strlen(id) >= SYMBOL_FILE_ID_LEN) {
+        return -1;
+    }
+    
+    slot = find_slot(cache, dev, ino, name);
+    if (cache->slots[slot]) {
+        entry = &cache->entries[cache->slots[slot] - 1];
+    } else {
+        if (cache->count >= SYMBOL_CACHE_MAX_ENTRIES) {
+            return -1;
+        }
+        if ((cache->count + 1) * 2 > cache->mask + 1) {
+            if (grow_slots(cache) != 0) {
+                return -1;
+            }
+            slot = find_slot(cache, dev, ino, name);
+        }
+        if (cache->count == cache->capacity) {
+            size_t capacity = cache->capacity ? cache->capacity * 2 : 64;
+            symbol_entry_t *entries = realloc(cache->entries, capacity * sizeof(*entries));
+            
+            if (!entries) {
+                return -1;
+            }
+            cache->entries = entries;
+            cache->capacity = capacity;
+        }
+        entry = &cache->entries[cache->count];
+        entry->dev = dev;
+        entry->ino = ino;
+        snprintf(entry->name, sizeof(entry->name), "%s", name);
+        cache->slots[slot] = (uint32_t)++cache->count;
+    }
+    
+    snprintf(entry->id, sizeof(entry->id), "%s", id);
+    entry->offset = offset;
+    return 0;
+}
+
+/**
+ * Read the cache file; later lines override earlier ones
+ */
+static void load_cache_file(symbol_cache_t *cache) {
+    char line[SYMBOL_LINE_MAX];
+    char id[SYMBOL_FILE_ID_LEN];
+    char name[SYMBOL_NAME_MAX];
+    uint64_t dev, ino, offset;
+    size_t loaded = 0;
+    FILE *fp;
+    
+    fp = fopen(cache->path, "re");
+    if (!fp) {
+        if (errno != ENOENT) {
+            log_debug("Cannot read symbol cache %s: %s", cache->path, strerror(errno));
+        }
+        return;
+    }
+    
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%" SCNu64 " %" SCNu64 " %71s %127s %" SCNx64,
+                   &dev, &ino, id, name, &offset) == 5 &&
+            store_symbol(cache, dev, ino, id, name, offset) == 0) {
+            loaded++;
+        }
+    }
+    fclose(fp);
+    
+    log_debug("Loaded %zu cached symbol offsets from %s", loaded, cache->path);
+}
+
+/**
+ * Append lines to the cache file, creating it (and its directory) if needed
+ * One write per library, so concurrent tracers do not interleave lines.
+ */
+static void append_cache_file(symbol_cache_t *cache, const char *text, size_t len) {
+    char *dir;
+    char *slash;
+    int fd;
+    
+    if (!cache->path || cache->append_failed || len == 0) {
+        return;
+    }
+    
+    fd = open(cache->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == ENOENT && (dir = strdup(cache->path)) != NULL) {
+        slash = strrchr(dir, '/');
+        if (slash && slash != dir) {
+            *slash = '\0';
+            mkdir(dir, 0755);
+        }
+        free(dir);
+        fd = open(cache->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    }
+    if (fd < 0 || write(fd, text, len) != (ssize_t)len) {
+        log_debug("Cannot write symbol cache %s: %s", cache->path, strerror(errno));
+        cache->append_failed = true;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+symbol_cache_t *symbol_cache_create(const char *path) {
+    symbol_cache_t *cache = calloc(1, sizeof(*cache));
+    
+    if (!cache) {
+        return NULL;
+    }
+    cache->slots = calloc(SYMBOL_TABLE_INITIAL, sizeof(*cache->slots));
+    cache->mask = SYMBOL_TABLE_INITIAL - 1;
+    cache->path = path ? strdup(path) : NULL;
+    if (!cache->slots || (path && !cache->path)) {
+        free(cache->slots);
+        free(cache->path);
+        free(cache);
+        return NULL;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    
+    if (cache->path) {
+        load_cache_file(cache);
+    }
+    return cache;
+}
+
+void symbol_cache_destroy(symbol_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->slots);
+    free(cache->path);
+    free(cache);
+}
+
+/**
+ * Resolve symbols, parsing the file only for names the cache lacks
+ * Offsets found are cached (and appended to the cache file) along with
+ * names the file does not define, so a miss is not parsed again either.
+ */
+int symbol_cache_resolve(symbol_cache_t *cache, const char *path, const char *const *names,
+                         size_t count, uint64_t *offsets) {
+    char id[SYMBOL_FILE_ID_LEN];
+    uint64_t *parsed = NULL;
+    char *text = NULL;
+    size_t text_len = 0;
+    size_t missing = 0;
+    struct stat st;
+    bool *cached;
+    int ret = -1;
+    int fd;
+    
+    if (!cache || !path || (!names && count > 0) || (!offsets && count > 0)) {
+        return -1;
+    }
+    
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    cached = calloc(count ? count : 1, sizeof(*cached));
+    if (!cached || fstat(fd, &st) != 0 || elf_file_id(fd, id) != 0) {
+        goto out;
+    }
+    
+    pthread_mutex_lock(&cache->lock);
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = find_slot(cache, (uint64_t)st.st_dev, (uint64_t)st.st_ino, names[i]);
+        const symbol_entry_t *entry = cache->slots[slot] ? &cache->entries[cache->slots[slot] - 1]
+                                                         : NULL;
+        
+        if (entry && strcmp(entry->id, id) == 0) {
+            offsets[i] = entry->offset;
+            cached[i] = true;
+            cache->stats.hits++;
+        } else {
+            missing++;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    
+    if (missing == 0) {
+        ret = 0;
+        goto out;
+    }
+    
+    parsed = calloc(count, sizeof(*parsed));
+    text = malloc(missing * (SYMBOL_LINE_MAX));
+    if (!parsed || !text || elf_symbol_offsets(fd, names, count, parsed) != 0) {
+        goto out;
+    }
+    
+    pthread_mutex_lock(&cache->lock);
+    cache->stats.files_parsed++;
+    for (size_t i = 0; i < count; i++) {
+        if (cached[i]) {
+            continue;
+        }
+        offsets[i] = parsed[i];
+        cache->stats.resolved++;
+        if (strpbrk(names[i], " \t\n") == NULL &&
+            store_symbol(cache, (uint64_t)st.st_dev, (uint64_t)st.st_ino, id, names[i],
+                         parsed[i]) == 0) {
+            text_len += (size_t)snprintf(text + text_len, SYMBOL_LINE_MAX,
+                                         "%" PRIu64 " %" PRIu64 " %s %s %" PRIx64 "\n",
+                                         (uint64_t)st.st_dev, (uint64_t)st.st_ino, id, names[i],
+                                         parsed[i]);
+        }
+    }
+    append_cache_file(cache, text, text_len);
+    pthread_mutex_unlock(&cache->lock);
+    ret = 0;
+
+out:
+    free(parsed);
+    free(text);
+    free(cached);
+    close(fd);
+    return ret;
+}
+
+void symbol_cache_get_stats(symbol_cache_t *cache, symbol_cache_stats_t *stats) {
+    if (!cache || !stats) {
+        return;
+    }
+    
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
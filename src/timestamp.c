@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * timestamp.c - Kernel timestamp conversion and ISO 8601 formatting
+ * The offset is shared by every thread and only ever replaced whole, so
+ * it is a relaxed atomic; two threads re-measuring it at once just both
+ * store a good value. The formatting cache is per thread.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "include/timestamp.h"
+
+/* Measurements kept to pick the tightest one from */
+#define RESYNC_SAMPLES 3
+
+static _Atomic int64_t boot_to_realtime_ns;
+static _Atomic uint64_t synced_at_boot_ns;   /* 0 = never measured */
+static _Atomic bool offset_pinned;
+
+/* Formatted "YYYY-MM-DDTHH:MM:SS" of the last second this thread formatted */
+static _Thread_local struct {
+    uint64_t second;
+    size_t len;
+    char prefix[TIMESTAMP_ISO8601_LEN];
+} prefix_cache = { UINT64_MAX, 0, "" };
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t timestamp_boot_ns(void) {
+    return clock_ns(CLOCK_BOOTTIME);
+}
+
+/**
+ * Measure the boot-to-realtime offset
+ * Reads CLOCK_REALTIME between two CLOCK_BOOTTIME reads and keeps the
+ * sample with the shortest gap, so preemption between the reads does
+ * not skew the offset by more than the gap
+ */
+void timestamp_resync(void) {
+    uint64_t best_gap = UINT64_MAX;
+    uint64_t synced = 0;
+    int64_t offset = 0;
+    
+    for (int i = 0; i < RESYNC_SAMPLES; i++) {
+        uint64_t before = clock_ns(CLOCK_BOOTTIME);
+        uint64_t real = clock_ns(CLOCK_REALTIME);
+        uint64_t after = clock_ns(CLOCK_BOOTTIME);
+        
+        if (after - before < best_gap) {
+            best_gap = after - before;
+            synced = before + (after - before) / 2;
+            offset = (int64_t)(real - synced);
+        }
+    }
+    
+    atomic_store_explicit(&boot_to_realtime_ns, offset, memory_order_relaxed);
+    atomic_store_explicit(&synced_at_boot_ns, synced ? synced : 1, memory_order_relaxed);
+}
+
+/**
+ * Convert a CLOCK_BOOTTIME timestamp to Unix time
+ * Re-measures the offset first when it is older than TIMESTAMP_RESYNC_NS
+ * at boot_ns; records older than the last measurement use it as is
+ */
+uint64_t timestamp_from_boot_ns(uint64_t boot_ns) {
+    uint64_t synced = atomic_load_explicit(&synced_at_boot_ns, memory_order_relaxed);
+    
+    if (boot_ns == 0) {
+        return 0;
+    }
+    
+    if ((synced == 0 || boot_ns > synced + TIMESTAMP_RESYNC_NS) &&
+        !atomic_load_explicit(&offset_pinned, memory_order_relaxed)) {
+        timestamp_resync();
+    }
+    
+    return boot_ns + (uint64_t)atomic_load_explicit(&boot_to_realtime_ns, memory_order_relaxed);
+}
+
+int64_t timestamp_boot_offset(void) {
+    if (atomic_load_explicit(&synced_at_boot_ns, memory_order_relaxed) == 0) {
+        timestamp_resync();
+    }
+    return atomic_load_explicit(&boot_to_realtime_ns, memory_order_relaxed);
+}
+
+void timestamp_pin_offset(int64_t offset_ns) {
+    atomic_store_explicit(&offset_pinned, true, memory_order_relaxed);
+    atomic_store_explicit(&boot_to_realtime_ns, offset_ns, memory_order_relaxed);
+    atomic_store_explicit(&synced_at_boot_ns, 1, memory_order_relaxed);
+}
+
+uint64_t timestamp_now_ns(void) {
+    return timestamp_from_boot_ns(clock_ns(CLOCK_BOOTTIME));
+}
+
+/**
+ * Format Unix nanoseconds as ISO 8601 with microsecond precision
+ *
+ * @param unix_ns Unix time in nanoseconds
+ * @param buf Output buffer (TIMESTAMP_ISO8601_LEN bytes through year 9999)
+ * @param buf_size Size of buf
+ * @return buf on success, or NULL on failure
+ */
+char *timestamp_format_iso8601(uint64_t unix_ns, char *buf, size_t buf_size) {
+    uint64_t second = unix_ns / 1000000000ULL;
+    uint32_t micros = (uint32_t)((unix_ns % 1000000000ULL) / 1000ULL);
+    char *p;
+    
+    if (!buf) {
+        return NULL;
+    }
+    
+    if (second != prefix_cache.second) {
+        time_t seconds = (time_t)second;
+        struct tm tm_info;
+        int len;
+        
+        if (gmtime_r(&seconds, &tm_info) == NULL) {
+            return NULL;
+        }
+        len = snprintf(prefix_cache.prefix, sizeof(prefix_cache.prefix),
+                       "%04d-%02d-%02dT%02d:%02d:%02d",
+                       tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday,
+                       tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec);
+        if (len < 0 || (size_t)len + 9 > sizeof(prefix_cache.prefix)) {
+            prefix_cache.second = UINT64_MAX;
+            return NULL;
+        }
+        prefix_cache.len = (size_t)len;
+        prefix_cache.second = second;
+    }
+    
+    /* Prefix, then ".ssssssZ" and the NUL */
+    if (buf_size < prefix_cache.len + 9) {
+        return NULL;
+    }
+    memcpy(buf, prefix_cache.prefix, prefix_cache.len);
+    p = buf + prefix_cache.len;
+    *p++ = '.';
+    for (int i = 5; i >= 0; i--) {
+        p[i] = (char)('0' + micros % 10);
+        micros /= 10;
+    }
+    p += 6;
+    *p++ = 'Z';
+    *p = '\0';
+    
+    return buf;
+}
@@ -0,0 +1,639 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * topk_summary.c - Streaming top-K summary of a capture in fixed memory
+ * Each dimension has a Space-Saving table (counters in a min-heap on
+ * their count, found through an open addressing index on the key hash)
+ * and a Count-Min sketch with conservative update. Counters hold the
+ * sketch estimate from the moment a key enters the table, so a count
+ * never underestimates and its error is what the sketch added.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "include/topk_summary.h"
+#include "include/output_formatter.h"
+#include "include/privacy_filter.h"
+#include "include/handshake_latency.h"
+
+/* Counters per reported key: the slack that keeps the top K exact unless
+ * the distribution is nearly flat */
+#define TOPK_COUNTERS_PER_K 4
+
+/* Count-Min rows, and columns per counter (rounded up to a power of two) */
+#define TOPK_SKETCH_DEPTH 4
+#define TOPK_SKETCH_COLUMNS_PER_COUNTER 16
+#define TOPK_SKETCH_MIN_WIDTH 1024
+
+typedef struct {
+    char key[TOPK_KEY_MAX];
+    uint64_t hash;
+    uint64_t count;
+    uint64_t error;
+    uint32_t heap_pos;
+} topk_counter_t;
+
+typedef struct {
+    topk_counter_t *counters;
+    uint32_t *heap;                /* Counter indices, min-heap on count */
+    int32_t *index;                /* Open addressing on the hash, -1 = empty */
+    uint32_t used;
+    uint64_t *sketch;              /* TOPK_SKETCH_DEPTH rows of sketch_width */
+} topk_table_t;
+
+struct topk_summary {
+    pthread_mutex_t lock;
+    unsigned int k;
+    uint32_t capacity;             /* Counters per table */
+    uint32_t index_mask;
+    uint32_t sketch_width;
+    uint64_t events;
+    uint32_t *order;               /* Scratch for topk_summary_top */
+    topk_table_t tables[TOPK_DIMENSIONS];
+    bool handshakes_enabled;
+    handshake_latency_t *handshakes;   /* By process name and function; the last is "(other)" */
+    uint32_t handshake_used;
+};
+
+static const char *const dimension_names[TOPK_DIMENSIONS] = {
+    "processes", "private_key_readers", "files", "libraries", "api_functions"
+};
+
+static const char *const dimension_titles[TOPK_DIMENSIONS] = {
+    "Processes", "Private key readers", "Files", "Libraries", "API functions"
+};
+
+const char *topk_dimension_name(topk_dimension_t dim) {
+    return dim < TOPK_DIMENSIONS ? dimension_names[dim] : "unknown";
+}
+
+static uint32_t round_pow2(uint32_t n) {
+    uint32_t p = 1;
+    
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/* FNV-1a over the (truncated) key, finished with a 64-bit mix */
+static uint64_t hash_key(const char *key, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+topk_summary_t *topk_summary_create(unsigned int k) {
+    topk_summary_t *summary;
+    uint32_t index_size;
+    
+    if (k == 0 || k > TOPK_MAX_K) {
+        return NULL;
+    }
+    
+    summary = calloc(1, sizeof(*summary));
+    if (!summary) {
+        return NULL;
+    }
+    pthread_mutex_init(&summary->lock, NULL);
+    summary->k = k;
+    summary->capacity = k * TOPK_COUNTERS_PER_K;
+    index_size = round_pow2(summary->capacity * 2);
+    summary->index_mask = index_size - 1;
+    summary->sketch_width = round_pow2(summary->capacity * TOPK_SKETCH_COLUMNS_PER_COUNTER);
+    if (summary->sketch_width < TOPK_SKETCH_MIN_WIDTH) {
+        summary->sketch_width = TOPK_SKETCH_MIN_WIDTH;
+    }
+    
+    summary->order = calloc(summary->capacity, sizeof(*summary->order));
+    summary->handshakes = calloc(summary->capacity, sizeof(*summary->handshakes));
+    if (!summary->order || !summary->handshakes) {
+        topk_summary_destroy(summary);
+        return NULL;
+    }
+    for (int d = 0; d < TOPK_DIMENSIONS; d++) {
+        topk_table_t *table = &summary->tables[d];
+        
+        table->counters = calloc(summary->capacity, sizeof(*table->counters));
+        table->heap = calloc(summary->capacity, sizeof(*table->heap));
+        table->index = malloc(index_size * sizeof(*table->index));
+        table->sketch = calloc((size_t)TOPK_SKETCH_DEPTH * summary->sketch_width,
+                               sizeof(*table->sketch));
+        if (!table->counters || !table->heap || !table->index || !table->sketch) {
+            topk_summary_destroy(summary);
+            return NULL;
+        }
+        memset(table->index, 0xff, index_size * sizeof(*table->index));
+    }
+    
+    return summary;
+}
+
+void topk_summary_destroy(topk_summary_t *summary) {
+    if (!summary) {
+        return;
+    }
+    
+    for (int d = 0; d < TOPK_DIMENSIONS; d++) {
+        free(summary->tables[d].counters);
+        free(summary->tables[d].heap);
+        free(summary->tables[d].index);
+        free(summary->tables[d].sketch);
+    }
+    free(summary->order);
+    free(summary->handshakes);
+    pthread_mutex_destroy(&summary->lock);
+    free(summary);
+}
+
+/**
+ * Count a key in the sketch with conservative update: only rows below the
+ * new estimate are raised, which keeps collisions from inflating it
+ * @return The key's estimate including this weight
+ */
+static uint64_t sketch_add(const topk_summary_t *summary, topk_table_t *table,
+                           uint64_t hash, uint64_t weight) {
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    uint32_t mask = summary->sketch_width - 1;
+    uint64_t *cells[TOPK_SKETCH_DEPTH];
+    uint64_t estimate = UINT64_MAX;
+    
+    for (uint32_t row = 0; row < TOPK_SKETCH_DEPTH; row++) {
+        cells[row] = &table->sketch[(size_t)row * summary->sketch_width + ((h1 + row * h2) & mask)];
+        if (*cells[row] < estimate) {
+            estimate = *cells[row];
+        }
+    }
+    estimate += weight;
+    for (uint32_t row = 0; row < TOPK_SKETCH_DEPTH; row++) {
+        if (*cells[row] < estimate) {
+            *cells[row] = estimate;
+        }
+    }
+    return estimate;
+}
+
+static void heap_swap(topk_table_t *table, uint32_t a, uint32_t b) {
+    uint32_t tmp = table->heap[a];
+    
+    table->heap[a] = table->heap[b];
+    table->heap[b] = tmp;
+    table->counters[table->heap[a]].heap_pos = a;
+    table->counters[table->heap[b]].heap_pos = b;
+}
+
+static void heap_sift_up(topk_table_t *table, uint32_t pos) {
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
+        
+        if (table->counters[table->heap[parent]].count <= table->counters[table->heap[pos]].count) {
+            break;
+        }
+        heap_swap(table, parent, pos);
+        pos = parent;
+    }
+}
+
+static void heap_sift_down(topk_table_t *table, uint32_t pos) {
+    for (;;) {
+        uint32_t smallest = pos, left = pos * 2 + 1, right = pos * 2 + 2;
+        
+        if (left < table->used &&
+            table->counters[table->heap[left]].count < table->counters[table->heap[smallest]].count) {
+            smallest = left;
+        }
+        if (right < table->used &&
+            table->counters[table->heap[right]].count < table->counters[table->heap[smallest]].count) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        heap_swap(table, pos, smallest);
+        pos = smallest;
+    }
+}
+
+static int32_t index_find(const topk_summary_t *summary, const topk_table_t *table,
+                          const char *key, uint64_t hash) {
+    uint32_t i = (uint32_t)hash & summary->index_mask;
+    
+    while (table->index[i] >= 0) {
+        const topk_counter_t *counter = &table->counters[table->index[i]];
+        
+        if (counter->hash == hash && strcmp(counter->key, key) == 0) {
+            return table->index[i];
+        }
+        i = (i + 1) & summary->index_mask;
+    }
+    return -1;
+}
+
+static void index_insert(const topk_summary_t *summary, topk_table_t *table, uint32_t counter) {
+    uint32_t i = (uint32_t)table->counters[counter].hash & summary->index_mask;
+    
+    while (table->index[i] >= 0) {
+        i = (i + 1) & summary->index_mask;
+    }
+    table->index[i] = (int32_t)counter;
+}
+
+/* Remove a counter from the index, shifting back the entries after it
+ * that would no longer be found past the hole */
+static void index_remove(const topk_summary_t *summary, topk_table_t *table, uint32_t counter) {
+    uint32_t mask = summary->index_mask;
+    uint32_t hole = (uint32_t)table->counters[counter].hash & mask;
+    uint32_t next;
+    
+    while (table->index[hole] != (int32_t)counter) {
+        hole = (hole + 1) & mask;
+    }
+    for (next = (hole + 1) & mask; table->index[next] >= 0; next = (next + 1) & mask) {
+        uint32_t home = (uint32_t)table->counters[table->index[next]].hash & mask;
+        
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table->index[hole] = table->index[next];
+            hole = next;
+        }
+    }
+    table->index[hole] = -1;
+}
+
+static void table_add(topk_summary_t *summary, topk_table_t *table,
+                      const char *key, uint64_t weight) {
+    char truncated[TOPK_KEY_MAX];
+    size_t len = strlen(key);
+    topk_counter_t *counter;
+    uint64_t hash, estimate;
+    int32_t found;
+    uint32_t slot;
+    
+    if (len >= TOPK_KEY_MAX) {
+        len = TOPK_KEY_MAX - 1;
+        memcpy(truncated, key, len);
+        truncated[len] = '\0';
+        key = truncated;
+    }
+    hash = hash_key(key, len);
+    estimate = sketch_add(summary, table, hash, weight);
+    
+    found = index_find(summary, table, key, hash);
+    if (found >= 0) {
+        counter = &table->counters[found];
+        counter->count += weight;
+        heap_sift_down(table, counter->heap_pos);
+        return;
+    }
+    
+    if (table->used < summary->capacity) {
+        slot = table->used++;
+        table->heap[slot] = slot;
+        table->counters[slot].heap_pos = slot;
+    } else {
+        /* Full: the key only replaces the smallest counter once heavier */
+        slot = table->heap[0];
+        if (estimate <= table->counters[slot].count) {
+            return;
+        }
+        index_remove(summary, table, slot);
+    }
+    
+    counter = &table->counters[slot];
+    memcpy(counter->key, key, len + 1);
+    counter->hash = hash;
+    counter->count = estimate;
+    counter->error = estimate - weight;
+    index_insert(summary, table, slot);
+    heap_sift_up(table, counter->heap_pos);
+    heap_sift_down(table, counter->heap_pos);
+}
+
+void topk_summary_add(topk_summary_t *summary, topk_dimension_t dim,
+                      const char *key, uint64_t weight) {
+    if (!summary || dim >= TOPK_DIMENSIONS || !key || weight == 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&summary->lock);
+    table_add(summary, &summary->tables[dim], key, weight);
+    pthread_mutex_unlock(&summary->lock);
+}
+
+void topk_summary_add_event(topk_summary_t *summary, const processed_event_t *event) {
+    char redacted[REDACTED_PATH_MAX];
+    uint64_t weight;
+    event_kind_t kind;
+    const char *key;
+    
+    if (!summary || !event || !event->event_type) {
+        return;
+    }
+    weight = event->count > 0 ? event->count : 1;
+    kind = processed_event_kind(event);
+    
+    pthread_mutex_lock(&summary->lock);
+    summary->events += weight;
+    if (event->process) {
+        table_add(summary, &summary->tables[TOPK_PROCESSES], event->process, weight);
+    }
+    
+    if (kind == EVENT_FILE_OPEN && event->file) {
+        key = privacy_redact_path_into(event->file, event->redact_paths,
+                                       redacted, sizeof(redacted));
+        if (key) {
+            table_add(summary, &summary->tables[TOPK_FILES], key, weight);
+        }
+        if (event->file_type == FILE_TYPE_PRIVATE_KEY && event->process) {
+            table_add(summary, &summary->tables[TOPK_PRIVATE_KEY_READERS], event->process, weight);
+        }
+    } else if (kind == EVENT_LIB_LOAD) {
+        key = event->library_name;
+        if (!key && event->library) {
+            key = privacy_redact_path_into(event->library, event->redact_paths,
+                                           redacted, sizeof(redacted));
+        }
+        if (key) {
+            table_add(summary, &summary->tables[TOPK_LIBRARIES], key, weight);
+        }
+    } else if (kind == EVENT_API_CALL && event->function_name) {
+        table_add(summary, &summary->tables[TOPK_API_FUNCTIONS], event->function_name, weight);
+    }
+    pthread_mutex_unlock(&summary->lock);
+}
+
+void topk_summary_enable_handshakes(topk_summary_t *summary) {
+    if (summary) {
+        summary->handshakes_enabled = true;
+    }
+}
+
+void topk_summary_add_handshakes(topk_summary_t *summary, const handshake_latency_t *latency) {
+    handshake_latency_t *entry = NULL;
+    uint32_t other;
+    
+    if (!summary || !latency || !latency->function_name) {
+        return;
+    }
+    
+    pthread_mutex_lock(&summary->lock);
+    other = summary->capacity - 1;
+    for (uint32_t i = 0; i < summary->handshake_used; i++) {
+        handshake_latency_t *h = &summary->handshakes[i];
+        
+        if (strncmp(h->comm, latency->comm, sizeof(h->comm)) == 0 &&
+            strcmp(h->function_name, latency->function_name) == 0) {
+            entry = h;
+            break;
+        }
+    }
+    if (!entry && summary->handshake_used < other) {
+        entry = &summary->handshakes[summary->handshake_used++];
+        memcpy(entry->comm, latency->comm, sizeof(entry->comm));
+        entry->comm[sizeof(entry->comm) - 1] = '\0';
+        entry->function_name = latency->function_name;
+    } else if (!entry) {
+        entry = &summary->handshakes[other];
+        if (!entry->function_name) {
+            snprintf(entry->comm, sizeof(entry->comm), "(other)");
+            entry->function_name = "all";
+        }
+    }
+    handshake_latency_merge(entry, latency);
+    pthread_mutex_unlock(&summary->lock);
+}
+
+static const topk_table_t *sort_table;
+
+static int compare_counts(const void *a, const void *b) {
+    const topk_counter_t *ca = &sort_table->counters[*(const uint32_t *)a];
+    const topk_counter_t *cb = &sort_table->counters[*(const uint32_t *)b];
+    
+    if (ca->count != cb->count) {
+        return ca->count > cb->count ? -1 : 1;
+    }
+    return strcmp(ca->key, cb->key);
+}
+
+size_t topk_summary_top(topk_summary_t *summary, topk_dimension_t dim,
+                        topk_entry_t *out, size_t max) {
+    const topk_table_t *table;
+    size_t n;
+    
+    if (!summary || dim >= TOPK_DIMENSIONS || !out) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&summary->lock);
+    table = &summary->tables[dim];
+    for (uint32_t i = 0; i < table->used; i++) {
+        summary->order[i] = i;
+    }
+    /* qsort has no context argument; the lock also covers sort_table */
+    sort_table = table;
+    qsort(summary->order, table->used, sizeof(*summary->order), compare_counts);
+    
+    n = table->used < summary->k ? table->used : summary->k;
+    if (n > max) {
+        n = max;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const topk_counter_t *counter = &table->counters[summary->order[i]];
+        
+        memcpy(out[i].key, counter->key, sizeof(out[i].key));
+        out[i].count = counter->count;
+        out[i].error = counter->error;
+    }
+    pthread_mutex_unlock(&summary->lock);
+    
+    return n;
+}
+
+uint64_t topk_summary_events(topk_summary_t *summary) {
+    uint64_t events;
+    
+    if (!summary) {
+        return 0;
+    }
+    pthread_mutex_lock(&summary->lock);
+    events = summary->events;
+    pthread_mutex_unlock(&summary->lock);
+    return events;
+}
+
+static void write_table(FILE *fp, topk_dimension_t dim, const topk_entry_t *entries, size_t n) {
+    fprintf(fp, "\n%s\n", dimension_titles[dim]);
+    if (n == 0) {
+        fprintf(fp, "  (none)\n");
+    }
+    for (size_t i = 0; i < n; i++) {
+        fprintf(fp, "  %12" PRIu64 "  %s", entries[i].count, entries[i].key);
+        if (entries[i].error > 0) {
+            fprintf(fp, "  (+/-%" PRIu64 ")", entries[i].error);
+        }
+        fputc('\n', fp);
+    }
+}
+
+static void write_json(FILE *fp, topk_dimension_t dim, const topk_entry_t *entries, size_t n,
+                       bool pretty) {
+    fprintf(fp, "%s\"%s\": [", pretty ? ",\n  " : ", ", dimension_names[dim]);
+    for (size_t i = 0; i < n; i++) {
+        char *key = json_escape_string(entries[i].key);
+        
+        fprintf(fp, "%s%s{\"key\": \"%s\", \"count\": %" PRIu64 ", \"error\": %" PRIu64 "}",
+                i > 0 ? "," : "", pretty ? "\n    " : (i > 0 ? " " : ""),
+                key ? key : "", entries[i].count, entries[i].error);
+        free(key);
+    }
+    fputs(pretty && n > 0 ? "\n  ]" : "]", fp);
+}
+
+static int compare_handshakes(const void *a, const void *b) {
+    const handshake_latency_t *ha = a;
+    const handshake_latency_t *hb = b;
+    uint64_t ca = handshake_latency_count(ha) + ha->errors;
+    uint64_t cb = handshake_latency_count(hb) + hb->errors;
+    int cmp;
+    
+    if (ca != cb) {
+        return ca > cb ? -1 : 1;
+    }
+    cmp = strncmp(ha->comm, hb->comm, sizeof(ha->comm));
+    return cmp != 0 ? cmp : strcmp(ha->function_name, hb->function_name);
+}
+
+/* Copy the handshake table, busiest first
+ * @return Entries written (at most k), or 0 if not enabled */
+static size_t top_handshakes(topk_summary_t *summary, handshake_latency_t *out) {
+    size_t n = 0;
+    
+    pthread_mutex_lock(&summary->lock);
+    for (uint32_t i = 0; i < summary->capacity; i++) {
+        if (summary->handshakes[i].function_name) {
+            out[n++] = summary->handshakes[i];
+        }
+    }
+    pthread_mutex_unlock(&summary->lock);
+    
+    qsort(out, n, sizeof(*out), compare_handshakes);
+    return n < summary->k ? n : summary->k;
+}
+
+static void write_handshake_table(FILE *fp, const handshake_latency_t *entries, size_t n) {
+    fprintf(fp, "\nTLS handshakes\n");
+    if (n == 0) {
+        fprintf(fp, "  (none)\n");
+    }
+    for (size_t i = 0; i < n; i++) {
+        const handshake_latency_t *h = &entries[i];
+        
+        fprintf(fp, "  %12" PRIu64 "  %s %s  (p50 %" PRIu64 "us, p99 %" PRIu64 "us, "
+                "mean %" PRIu64 "us, %" PRIu64 " failed)\n",
+                handshake_latency_count(h), h->comm, h->function_name,
+                handshake_latency_percentile_us(h, 50), handshake_latency_percentile_us(h, 99),
+                handshake_latency_mean_us(h), h->errors);
+    }
+}
+
+static void write_handshake_json(FILE *fp, const handshake_latency_t *entries, size_t n,
+                                 bool pretty) {
+    char histogram[HANDSHAKE_LATENCY_JSON_MAX];
+    
+    fprintf(fp, "%s\"tls_handshakes\": [", pretty ? ",\n  " : ", ");
+    for (size_t i = 0; i < n; i++) {
+        const handshake_latency_t *h = &entries[i];
+        char *comm = json_escape_string(h->comm);
+        
+        if (handshake_latency_format_histogram(h, histogram, sizeof(histogram)) < 0) {
+            snprintf(histogram, sizeof(histogram), "{}");
+        }
+        fprintf(fp, "%s%s{\"process\": \"%s\", \"function\": \"%s\", \"count\": %" PRIu64
+                ", \"errors\": %" PRIu64 ", \"mean_us\": %" PRIu64 ", \"p50_us\": %" PRIu64
+                ", \"p90_us\": %" PRIu64 ", \"p99_us\": %" PRIu64 ", \"histogram_us\": %s}",
+                i > 0 ? "," : "", pretty ? "\n    " : (i > 0 ? " " : ""),
+                comm ? comm : "", h->function_name, handshake_latency_count(h), h->errors,
+                handshake_latency_mean_us(h), handshake_latency_percentile_us(h, 50),
+                handshake_latency_percentile_us(h, 90), handshake_latency_percentile_us(h, 99),
+                histogram);
+        free(comm);
+    }
+    fputs(pretty && n > 0 ? "\n  ]" : "]", fp);
+}
+
+int topk_summary_write(topk_summary_t *summary, FILE *fp, output_format_t format,
+                       const char *generated_at, uint64_t elapsed_s) {
+    topk_entry_t *entries;
+    bool pretty = (format == FORMAT_JSON_PRETTY);
+    bool text = (format == FORMAT_SUMMARY);
+    uint64_t events;
+    
+    if (!summary || !fp) {
+        return -1;
+    }
+    entries = malloc(summary->k * sizeof(*entries));
+    if (!entries) {
+        return -1;
+    }
+    events = topk_summary_events(summary);
+    
+    if (text) {
+        /* A terminal shows one refreshed table rather than a scrolling log */
+        if (isatty(fileno(fp))) {
+            fputs("\033[H\033[2J", fp);
+        }
+        fprintf(fp, "crypto-tracer summary at %s: %" PRIu64 " events in %" PRIu64 "s (top %u)\n",
+                generated_at ? generated_at : "", events, elapsed_s, summary->k);
+    } else {
+        const char *sep = pretty ? ",\n  " : ", ";
+        
+        fprintf(fp, "%s\"type\": \"summary\"%s\"generated_at\": \"%s\"%s"
+                "\"elapsed_seconds\": %" PRIu64 "%s\"events\": %" PRIu64 "%s\"k\": %u",
+                pretty ? "{\n  " : "{", sep, generated_at ? generated_at : "", sep,
+                elapsed_s, sep, events, sep, summary->k);
+    }
+    
+    for (int d = 0; d < TOPK_DIMENSIONS; d++) {
+        size_t n = topk_summary_top(summary, (topk_dimension_t)d, entries, summary->k);
+        
+        if (text) {
+            write_table(fp, (topk_dimension_t)d, entries, n);
+        } else {
+            write_json(fp, (topk_dimension_t)d, entries, n, pretty);
+        }
+    }
+    if (summary->handshakes_enabled) {
+        handshake_latency_t *handshakes = malloc(summary->capacity * sizeof(*handshakes));
+        
+        if (handshakes) {
+            size_t n = top_handshakes(summary, handshakes);
+            
+            if (text) {
+                write_handshake_table(fp, handshakes, n);
+            } else {
+                write_handshake_json(fp, handshakes, n, pretty);
+            }
+            free(handshakes);
+        }
+    }
+    fputs(text ? "\n" : (pretty ? "\n}\n" : "}\n"), fp);
+    free(entries);
+    
+    fflush(fp);
+    return ferror(fp) ? -1 : 0;
+}
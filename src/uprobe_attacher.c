@@ -0,0 +1,377 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * uprobe_attacher.c - Incremental uprobe attachment across libraries
+ * Maps lines are filtered by file name first and by (dev, inode) second,
+ * both without a syscall, so rescanning a process whose libraries are
+ * all known costs one read of its maps.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include "include/uprobe_attacher.h"
+#include "include/logger.h"
+
+/* Longest /proc/[pid]/maps line handled (longer ones are skipped) */
+#define MAPS_LINE_MAX 4352
+
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+} library_key_t;
+
+typedef struct {
+    pid_t pid;
+    uint64_t queued_ns;
+} pending_pid_t;
+
+struct uprobe_attacher {
+    uprobe_target_t targets[UPROBE_MAX_TARGETS];
+    size_t target_count;
+    symbol_cache_t *symbols;
+    uprobe_attach_fn attach;
+    void *ctx;
+    
+    /* Libraries seen, open addressing on (dev, ino); protected by lock */
+    pthread_mutex_t lock;
+    library_key_t *seen;
+    size_t seen_mask;
+    size_t seen_count;
+    bool full_warned;
+    uprobe_attacher_stats_t stats;
+    
+    /* Processes to scan, oldest first; protected by queue_lock */
+    pthread_mutex_t queue_lock;
+    pending_pid_t pending[UPROBE_PENDING_MAX];
+    size_t pending_head;
+    size_t pending_count;
+    
+    /* Held by the thread scanning the queue */
+    pthread_mutex_t scan_lock;
+};
+
+/* Targets whose library prefix the file name at path starts with */
+static uint64_t library_targets(const uprobe_attacher_t *attacher, const char *path) {
+    const char *name = strrchr(path, '/');
+    uint64_t mask = 0;
+    
+    name = name ? name + 1 : path;
+    for (size_t i = 0; i < attacher->target_count; i++) {
+        const char *prefix = attacher->targets[i].library;
+        
+        if (strncmp(name, prefix, strlen(prefix)) == 0) {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
+}
+
+static size_t seen_slot(const uprobe_attacher_t *attacher, uint64_t dev, uint64_t ino) {
+    uint64_t hash = (ino * 0x9E3779B97F4A7C15ULL) ^ (dev * 0xC2B2AE3D27D4EB4FULL);
+    size_t i = (size_t)(hash >> 32) & attacher->seen_mask;
+    
+    while (attacher->seen[i].ino != 0 &&
+           (attacher->seen[i].dev != dev || attacher->seen[i].ino != ino)) {
+        i = (i + 1) & attacher->seen_mask;
+    }
+    return i;
+}
+
+/**
+ * Attach every target of a library not seen before (lock held)
+ * The library is marked seen even if nothing attaches, so a broken or
+ * stripped copy is not parsed again on every scan.
+ */
+static unsigned int attach_library(uprobe_attacher_t *attacher, const char *path,
+                                   uint64_t dev, uint64_t ino, uint64_t mask) {
+    const char *names[UPROBE_MAX_TARGETS];
+    uint64_t offsets[UPROBE_MAX_TARGETS];
+    size_t index[UPROBE_MAX_TARGETS];
+    unsigned int attached = 0;
+    size_t count = 0;
+    size_t slot;
+    
+    slot = seen_slot(attacher, dev, ino);
+    if (attacher->seen[slot].ino != 0) {
+        return 0;
+    }
+    if (attacher->seen_count >= UPROBE_MAX_LIBRARIES) {
+        if (!attacher->full_warned) {
+            log_warn("More than %d libraries to probe, further ones are not traced",
+                     UPROBE_MAX_LIBRARIES);
+            attacher->full_warned = true;
+        }
+        return 0;
+    }
+    attacher->seen[slot].dev = dev;
+    attacher->seen[slot].ino = ino;
+    attacher->seen_count++;
+    
+    for (size_t i = 0; i < attacher->target_count; i++) {
+        if (mask & (1ULL << i)) {
+            index[count] = i;
+            names[count++] = attacher->targets[i].symbol;
+        }
+    }
+    
+    if (symbol_cache_resolve(attacher->symbols, path, names, count, offsets) != 0) {
+        log_debug("Cannot read symbols of %s", path);
+        attacher->stats.failures += count;
+        return 0;
+    }
+    attacher->stats.libraries++;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (offsets[i] == 0) {
+            log_debug("%s not defined in %s", names[i], path);
+            attacher->stats.failures++;
+        } else if (attacher->attach(index[i], path, offsets[i], attacher->ctx) != 0) {
+            log_debug("Failed to attach %s in %s", names[i], path);
+            attacher->stats.failures++;
+        } else {
+            attached++;
+        }
+    }
+    attacher->stats.probes += attached;
+    
+    if (attached > 0) {
+        log_debug("Attached %u probe(s) in %s", attached, path);
+    }
+    return attached;
+}
+
+uprobe_attacher_t *uprobe_attacher_create(const uprobe_target_t *targets, size_t count,
+                                          symbol_cache_t *symbols, uprobe_attach_fn attach,
+                                          void *ctx) {
+    uprobe_attacher_t *attacher;
+    size_t slots = 1;
+    
+    if (!targets || count == 0 || count > UPROBE_MAX_TARGETS || !symbols || !attach) {
+        return NULL;
+    }
+    
+    attacher = calloc(1, sizeof(*attacher));
+    if (!attacher) {
+        return NULL;
+    }
+    
+    /* Never more than half full */
+    while (slots < UPROBE_MAX_LIBRARIES * 2) {
+        slots <<= 1;
+    }
+    attacher->seen = calloc(slots, sizeof(*attacher->seen));
+    if (!attacher->seen) {
+        free(attacher);
+        return NULL;
+    }
+    attacher->seen_mask = slots - 1;
+    
+    memcpy(attacher->targets, targets, count * sizeof(*targets));
+    attacher->target_count = count;
+    attacher->symbols = symbols;
+    attacher->attach = attach;
+    attacher->ctx = ctx;
+    pthread_mutex_init(&attacher->lock, NULL);
+    pthread_mutex_init(&attacher->queue_lock, NULL);
+    pthread_mutex_init(&attacher->scan_lock, NULL);
+    
+    return attacher;
+}
+
+void uprobe_attacher_destroy(uprobe_attacher_t *attacher) {
+    if (!attacher) {
+        return;
+    }
+    
+    pthread_mutex_destroy(&attacher->lock);
+    pthread_mutex_destroy(&attacher->queue_lock);
+    pthread_mutex_destroy(&attacher->scan_lock);
+    free(attacher->seen);
+    free(attacher);
+}
+
+unsigned int uprobe_attacher_add_library(uprobe_attacher_t *attacher, const char *path) {
+    unsigned int attached;
+    struct stat st;
+    uint64_t mask;
+    
+    if (!attacher || !path || (mask = library_targets(attacher, path)) == 0 ||
+        stat(path, &st) != 0 || st.st_ino == 0) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&attacher->lock);
+    attached = attach_library(attacher, path, (uint64_t)st.st_dev, (uint64_t)st.st_ino, mask);
+    pthread_mutex_unlock(&attacher->lock);
+    return attached;
+}
+
+/**
+ * Split a maps line: "start-end perms offset major:minor inode   path"
+ * @return true for a file mapping, with its device, inode and path
+ */
+static bool parse_maps_line(char *line, uint64_t *dev, uint64_t *ino, char **path) {
+    unsigned int major, minor;
+    int path_start = 0;
+    size_t len;
+    
+    if (sscanf(line, "%*s %*s %*s %x:%x %" SCNu64 " %n", &major, &minor, ino, &path_start) != 3 ||
+        path_start == 0 || *ino == 0 || line[path_start] != '/') {
+        return false;
+    }
+    *dev = (uint64_t)makedev(major, minor);
+    *path = line + path_start;
+    
+    len = strcspn(*path, "\n");
+    (*path)[len] = '\0';
+    return len < 10 || strcmp(*path + len - 10, " (deleted)") != 0;
+}
+
+unsigned int uprobe_attacher_scan_pid(uprobe_attacher_t *attacher, pid_t pid) {
+    char line[MAPS_LINE_MAX];
+    char root_path[MAPS_LINE_MAX + 32];
+    uint64_t prev_dev = 0, prev_ino = 0;
+    unsigned int attached = 0;
+    FILE *maps;
+    
+    if (!attacher || pid <= 0) {
+        return 0;
+    }
+    
+    snprintf(line, sizeof(line), "/proc/%d/maps", (int)pid);
+    maps = fopen(line, "re");
+    if (!maps) {
+        return 0;  /* Already gone */
+    }
+    
+    while (fgets(line, sizeof(line), maps)) {
+        uint64_t dev, ino, mask;
+        char *path;
+        
+        /* A library is mapped as several consecutive segments */
+        if (!strchr(line, '\n') || !parse_maps_line(line, &dev, &ino, &path) ||
+            (dev == prev_dev && ino == prev_ino)) {
+            continue;
+        }
+        prev_dev = dev;
+        prev_ino = ino;
+        
+        mask = library_targets(attacher, path);
+        if (mask == 0) {
+            continue;
+        }
+        
+        /* The path is in the process's mount namespace */
+        snprintf(root_path, sizeof(root_path), "/proc/%d/root%s", (int)pid, path);
+        pthread_mutex_lock(&attacher->lock);
+        attached += attach_library(attacher, root_path, dev, ino, mask);
+        pthread_mutex_unlock(&attacher->lock);
+    }
+    fclose(maps);
+    
+    pthread_mutex_lock(&attacher->lock);
+    attacher->stats.processes_scanned++;
+    pthread_mutex_unlock(&attacher->lock);
+    return attached;
+}
+
+unsigned int uprobe_attacher_scan_all(uprobe_attacher_t *attacher) {
+    unsigned int attached = 0;
+    struct dirent *de;
+    DIR *proc;
+    
+    if (!attacher) {
+        return 0;
+    }
+    
+    proc = opendir("/proc");
+    if (!proc) {
+        return 0;
+    }
+    while ((de = readdir(proc)) != NULL) {
+        if (isdigit((unsigned char)de->d_name[0])) {
+            attached += uprobe_attacher_scan_pid(attacher, (pid_t)atoi(de->d_name));
+        }
+    }
+    closedir(proc);
+    
+    return attached;
+}
+
+void uprobe_attacher_queue_pid(uprobe_attacher_t *attacher, pid_t pid, uint64_t now_ns) {
+    size_t tail;
+    
+    if (!attacher || pid <= 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&attacher->queue_lock);
+    tail = (attacher->pending_head + attacher->pending_count) % UPROBE_PENDING_MAX;
+    
+    /* An exec followed by dlopens queues the same process in a row */
+    if (attacher->pending_count > 0 &&
+        attacher->pending[(tail + UPROBE_PENDING_MAX - 1) % UPROBE_PENDING_MAX].pid == pid) {
+        pthread_mutex_unlock(&attacher->queue_lock);
+        return;
+    }
+    if (attacher->pending_count == UPROBE_PENDING_MAX) {
+        pthread_mutex_unlock(&attacher->queue_lock);
+        pthread_mutex_lock(&attacher->lock);
+        attacher->stats.pending_dropped++;
+        pthread_mutex_unlock(&attacher->lock);
+        return;
+    }
+    attacher->pending[tail].pid = pid;
+    attacher->pending[tail].queued_ns = now_ns;
+    attacher->pending_count++;
+    pthread_mutex_unlock(&attacher->queue_lock);
+}
+
+unsigned int uprobe_attacher_process_pending(uprobe_attacher_t *attacher, uint64_t now_ns) {
+    unsigned int attached = 0;
+    pending_pid_t next;
+    
+    if (!attacher || pthread_mutex_trylock(&attacher->scan_lock) != 0) {
+        return 0;
+    }
+    
+    for (int scanned = 0; scanned < UPROBE_SCAN_BUDGET; scanned++) {
+        pthread_mutex_lock(&attacher->queue_lock);
+        next = attacher->pending[attacher->pending_head];
+        if (attacher->pending_count == 0 || now_ns < next.queued_ns + UPROBE_SCAN_DELAY_NS) {
+            pthread_mutex_unlock(&attacher->queue_lock);
+            break;
+        }
+        attacher->pending_head = (attacher->pending_head + 1) % UPROBE_PENDING_MAX;
+        attacher->pending_count--;
+        pthread_mutex_unlock(&attacher->queue_lock);
+        
+        attached += uprobe_attacher_scan_pid(attacher, next.pid);
+    }
+    
+    pthread_mutex_unlock(&attacher->scan_lock);
+    return attached;
+}
+
+void uprobe_attacher_get_stats(uprobe_attacher_t *attacher, uprobe_attacher_stats_t *stats) {
+    if (!attacher || !stats) {
+        return;
+    }
+    
+    pthread_mutex_lock(&attacher->lock);
+    *stats = attacher->stats;
+    pthread_mutex_unlock(&attacher->lock);
+}
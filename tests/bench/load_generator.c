@@ -0,0 +1,400 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * load_generator.c - Paced, multi-threaded crypto activity for benchmarks
+ * Each thread runs the configured operations at its share of the total
+ * rate until the duration is up, then the totals are printed as one JSON
+ * object on stdout. Operations:
+ *   open    open() + close() of a generated file; --crypto-ratio percent
+ *           of them are .pem/.key/.crt files, the rest .txt/.log/.dat
+ *   dlopen  dlopen() + dlclose() of libcrypto (crypto) or libz (not)
+ *   exec    fork() + exec of /bin/true
+ *   ssl     SSL_CTX_new() + SSL_connect() against a socketpair peer that
+ *           never answers, so each attempt sends one ClientHello
+ * libssl is looked up with dlopen() so the generator builds without
+ * OpenSSL headers; ssl is skipped with a warning when it is missing.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define MAX_THREADS 256
+
+enum {
+    OP_OPEN = 0,
+    OP_DLOPEN,
+    OP_EXEC,
+    OP_SSL,
+    OP_COUNT
+};
+
+static const char *op_names[OP_COUNT] = { "open", "dlopen", "exec", "ssl" };
+
+/* libssl entry points, resolved at start-up */
+static struct {
+    const void *(*client_method)(void);
+    void *(*ctx_new)(const void *method);
+    void (*ctx_free)(void *ctx);
+    void *(*ssl_new)(void *ctx);
+    int (*set_fd)(void *ssl, int fd);
+    int (*connect)(void *ssl);
+    void (*ssl_free)(void *ssl);
+} ssl_api;
+
+static struct {
+    int duration;
+    int threads;
+    double rate[OP_COUNT];          /* Operations per second, all threads */
+    int crypto_ratio;               /* Percent of open/dlopen ops on crypto targets */
+    char dir[64];
+} config = { 10, 4, { 1000, 50, 10, 50 }, 50, "" };
+
+static atomic_ulong op_counts[OP_COUNT];
+static atomic_ulong crypto_counts[OP_COUNT];
+static atomic_ulong op_errors;
+
+static const char *crypto_files[] = { "bench.pem", "bench.key", "bench.crt" };
+static const char *plain_files[] = { "bench.txt", "bench.log", "bench.dat" };
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t deadline_ns) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(deadline_ns / 1000000000ULL),
+        .tv_nsec = (long)(deadline_ns % 1000000000ULL),
+    };
+    
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+/* xorshift: cheap per-thread choice of crypto vs. plain targets */
+static bool pick_crypto(uint64_t *state) {
+    uint64_t x = *state;
+    
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (int)(x % 100) < config.crypto_ratio;
+}
+
+static int do_open(bool crypto, unsigned long n) {
+    const char *name = crypto ? crypto_files[n % 3] : plain_files[n % 3];
+    char path[128];
+    int fd;
+    
+    snprintf(path, sizeof(path), "%s/%s", config.dir, name);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+static int do_dlopen(bool crypto) {
+    void *handle = dlopen(crypto ? "libcrypto.so.3" : "libz.so.1", RTLD_NOW | RTLD_LOCAL);
+    
+    if (!handle) {
+        return -1;
+    }
+    dlclose(handle);
+    return 0;
+}
+
+static int do_exec(void) {
+    pid_t pid = fork();
+    int status;
+    
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        execl("/bin/true", "true", (char *)NULL);
+        _exit(127);
+    }
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int do_ssl(void) {
+    int fds[2];
+    void *ctx, *ssl;
+    
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0) {
+        return -1;
+    }
+    
+    ctx = ssl_api.ctx_new(ssl_api.client_method());
+    ssl = ctx ? ssl_api.ssl_new(ctx) : NULL;
+    if (ssl) {
+        ssl_api.set_fd(ssl, fds[0]);
+        /* Writes the ClientHello, then fails with WANT_READ */
+        ssl_api.connect(ssl);
+        ssl_api.ssl_free(ssl);
+    }
+    if (ctx) {
+        ssl_api.ctx_free(ctx);
+    }
+    
+    close(fds[0]);
+    close(fds[1]);
+    return ssl ? 0 : -1;
+}
+
+static bool load_ssl_api(void) {
+    void *lib = dlopen("libssl.so.3", RTLD_NOW | RTLD_GLOBAL);
+    
+    if (!lib) {
+        lib = dlopen("libssl.so", RTLD_NOW | RTLD_GLOBAL);
+    }
+    if (!lib) {
+        return false;
+    }
+    
+    *(void **)&ssl_api.client_method = dlsym(lib, "TLS_client_method");
+    *(void **)&ssl_api.ctx_new = dlsym(lib, "SSL_CTX_new");
+    *(void **)&ssl_api.ctx_free = dlsym(lib, "SSL_CTX_free");
+    *(void **)&ssl_api.ssl_new = dlsym(lib, "SSL_new");
+    *(void **)&ssl_api.set_fd = dlsym(lib, "SSL_set_fd");
+    *(void **)&ssl_api.connect = dlsym(lib, "SSL_connect");
+    *(void **)&ssl_api.ssl_free = dlsym(lib, "SSL_free");
+    
+    return ssl_api.client_method && ssl_api.ctx_new && ssl_api.ctx_free &&
+           ssl_api.ssl_new && ssl_api.set_fd && ssl_api.connect && ssl_api.ssl_free;
+}
+
+/**
+ * Worker: run whichever operation is due next, sleeping between them
+ * Deadlines advance by a fixed interval, so a slow operation is caught
+ * up on rather than stretching the schedule
+ */
+static void *worker(void *arg) {
+    uint64_t seed = 0x9e3779b97f4a7c15ULL * ((uintptr_t)arg + 1);
+    uint64_t interval[OP_COUNT];
+    uint64_t next[OP_COUNT];
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)config.duration * 1000000000ULL;
+    
+    for (int op = 0; op < OP_COUNT; op++) {
+        interval[op] = config.rate[op] > 0
+            ? (uint64_t)(1e9 * config.threads / config.rate[op]) : 0;
+        /* Stagger threads so their operations do not land together */
+        next[op] = interval[op] ? start + interval[op] * (uintptr_t)arg / config.threads : UINT64_MAX;
+    }
+    
+    for (;;) {
+        int op = 0;
+        unsigned long n;
+        bool crypto = false;
+        int ret;
+        
+        for (int i = 1; i < OP_COUNT; i++) {
+            if (next[i] < next[op]) {
+                op = i;
+            }
+        }
+        if (next[op] >= end) {
+            break;
+        }
+        sleep_until(next[op]);
+        next[op] += interval[op];
+        
+        n = atomic_fetch_add_explicit(&op_counts[op], 1, memory_order_relaxed);
+        switch (op) {
+            case OP_OPEN:
+                crypto = pick_crypto(&seed);
+                ret = do_open(crypto, n);
+                break;
+            case OP_DLOPEN:
+                crypto = pick_crypto(&seed);
+                ret = do_dlopen(crypto);
+                break;
+            case OP_EXEC:
+                ret = do_exec();
+                break;
+            default:
+                crypto = true;
+                ret = do_ssl();
+                break;
+        }
+        if (crypto) {
+            atomic_fetch_add_explicit(&crypto_counts[op], 1, memory_order_relaxed);
+        }
+        if (ret != 0) {
+            atomic_fetch_add_explicit(&op_errors, 1, memory_order_relaxed);
+        }
+    }
+    
+    return NULL;
+}
+
+static int create_files(void) {
+    const char **lists[2] = { crypto_files, plain_files };
+    char path[128];
+    
+    snprintf(config.dir, sizeof(config.dir), "/tmp/ct-bench-XXXXXX");
+    if (!mkdtemp(config.dir)) {
+        perror("mkdtemp");
+        return -1;
+    }
+    
+    for (int l = 0; l < 2; l++) {
+        for (int i = 0; i < 3; i++) {
+            int fd;
+            
+            snprintf(path, sizeof(path), "%s/%s", config.dir, lists[l][i]);
+            fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                perror(path);
+                return -1;
+            }
+            close(fd);
+        }
+    }
+    return 0;
+}
+
+static void remove_files(void) {
+    const char **lists[2] = { crypto_files, plain_files };
+    char path[128];
+    
+    for (int l = 0; l < 2; l++) {
+        for (int i = 0; i < 3; i++) {
+            snprintf(path, sizeof(path), "%s/%s", config.dir, lists[l][i]);
+            unlink(path);
+        }
+    }
+    rmdir(config.dir);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --duration SECONDS   Run time (default: 10)\n"
+            "  --threads N          Worker threads (default: 4)\n"
+            "  --open-rate N        File opens per second (default: 1000)\n"
+            "  --dlopen-rate N      dlopen() calls per second (default: 50)\n"
+            "  --exec-rate N        Process executions per second (default: 10)\n"
+            "  --ssl-rate N         SSL_connect() attempts per second (default: 50)\n"
+            "  --crypto-ratio PCT   Percent of opens/dlopens on crypto targets (default: 50)\n"
+            "A rate of 0 disables the operation.\n", prog);
+}
+
+int main(int argc, char **argv) {
+    static struct option long_options[] = {
+        {"duration",     required_argument, 0, 'd'},
+        {"threads",      required_argument, 0, 't'},
+        {"open-rate",    required_argument, 0, 'o'},
+        {"dlopen-rate",  required_argument, 0, 'l'},
+        {"exec-rate",    required_argument, 0, 'e'},
+        {"ssl-rate",     required_argument, 0, 's'},
+        {"crypto-ratio", required_argument, 0, 'c'},
+        {"help",         no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    pthread_t threads[MAX_THREADS];
+    uint64_t start, elapsed;
+    int opt;
+    
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'd':
+                config.duration = atoi(optarg);
+                break;
+            case 't':
+                config.threads = atoi(optarg);
+                break;
+            case 'o':
+                config.rate[OP_OPEN] = atof(optarg);
+                break;
+            case 'l':
+                config.rate[OP_DLOPEN] = atof(optarg);
+                break;
+            case 'e':
+                config.rate[OP_EXEC] = atof(optarg);
+                break;
+            case 's':
+                config.rate[OP_SSL] = atof(optarg);
+                break;
+            case 'c':
+                config.crypto_ratio = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    
+    if (config.duration <= 0 || config.threads <= 0 || config.threads > MAX_THREADS ||
+        config.crypto_ratio < 0 || config.crypto_ratio > 100) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (config.rate[op] < 0) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (config.rate[OP_SSL] > 0 && !load_ssl_api()) {
+        fprintf(stderr, "Warning: libssl not found, ssl operations disabled\n");
+        config.rate[OP_SSL] = 0;
+    }
+    if (create_files() != 0) {
+        return 1;
+    }
+    
+    start = now_ns();
+    for (int i = 0; i < config.threads; i++) {
+        if (pthread_create(&threads[i], NULL, worker, (void *)(uintptr_t)i) != 0) {
+            fprintf(stderr, "Failed to start worker %d\n", i);
+            config.threads = i;
+            break;
+        }
+    }
+    for (int i = 0; i < config.threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = now_ns() - start;
+    remove_files();
+    
+    printf("{\"elapsed_ns\":%lu,\"threads\":%d,\"crypto_ratio\":%d,\"errors\":%lu,\"ops\":{",
+           (unsigned long)elapsed, config.threads, config.crypto_ratio,
+           atomic_load(&op_errors));
+    for (int op = 0; op < OP_COUNT; op++) {
+        printf("%s\"%s\":{\"rate\":%.0f,\"count\":%lu,\"crypto\":%lu}", op ? "," : "",
+               op_names[op], config.rate[op], atomic_load(&op_counts[op]),
+               atomic_load(&crypto_counts[op]));
+    }
+    printf("}}\n");
+    
+    return 0;
+}
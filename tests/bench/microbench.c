@@ -0,0 +1,691 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * microbench.c - Microbenchmarks for the per-event user-space functions
+ * Each benchmark calls one hot function over a corpus of realistic inputs
+ * for a fixed time, --repeat times, and reports the median ns/op and the
+ * heap allocations per op. Allocations are counted by interposing malloc,
+ * calloc and realloc, so they include those made inside libc (strdup ...).
+ *
+ * The built-in corpora are typical certificate, key and configuration
+ * paths and the library paths of a TLS server's /proc/PID/maps. Real ones
+ * can be used instead:
+ *   find / -name '*.pem' -o -name '*.crt' -o -name '*.key' > paths.txt
+ *   for pid in /proc/[0-9]*; do cat $pid/maps; done > maps.txt 2>/dev/null
+ *   microbench --paths paths.txt --libs maps.txt
+ *
+ * --json FILE writes the results as one JSON object per line; --baseline
+ * FILE compares against such a file and exits with 1 when a benchmark got
+ * more than --max-regression percent slower or allocates more per op.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <time.h>
+#include "../../src/include/crypto_tracer.h"
+#include "../../src/include/event_processor.h"
+#include "../../src/include/output_formatter.h"
+#include "../../src/include/privacy_filter.h"
+#include "../../src/include/profile_manager.h"
+
+#define MAX_BENCHMARKS 32
+#define MAX_CORPUS 65536
+#define MAX_LINE 4096
+
+/* Allocation counting
+ * The bench thread counts its own allocations; other threads (the log
+ * writer) do not disturb the figures. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static __thread uint64_t thread_allocs;
+
+void *malloc(size_t size) {
+    thread_allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    thread_allocs++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    thread_allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+/* Corpora */
+typedef struct {
+    char **items;
+    size_t count;
+} corpus_t;
+
+static const char *builtin_paths[] = {
+    "/etc/ssl/certs/ca-certificates.crt",
+    "/etc/ssl/certs/ISRG_Root_X1.pem",
+    "/etc/ssl/private/ssl-cert-snakeoil.key",
+    "/etc/ssl/openssl.cnf",
+    "/etc/pki/tls/certs/ca-bundle.crt",
+    "/etc/pki/tls/private/localhost.key",
+    "/etc/pki/ca-trust/extracted/pem/tls-ca-bundle.pem",
+    "/etc/letsencrypt/live/example.com/fullchain.pem",
+    "/etc/letsencrypt/live/example.com/privkey.pem",
+    "/etc/nginx/nginx.conf",
+    "/etc/nginx/conf.d/default.conf",
+    "/etc/nginx/ssl/server.crt",
+    "/etc/nginx/ssl/server.key",
+    "/etc/hosts",
+    "/etc/resolv.conf",
+    "/etc/nsswitch.conf",
+    "/etc/ld.so.cache",
+    "/etc/localtime",
+    "/usr/share/ca-certificates/mozilla/DigiCert_Global_Root_CA.crt",
+    "/usr/share/zoneinfo/Europe/Berlin",
+    "/usr/lib/locale/locale-archive",
+    "/usr/lib/jvm/java-17-openjdk/lib/security/cacerts",
+    "/opt/app/config/keystore.jks",
+    "/opt/app/config/truststore.p12",
+    "/opt/app/logs/access.log",
+    "/home/alice/.ssh/id_ed25519",
+    "/home/alice/.ssh/known_hosts",
+    "/home/alice/.config/app/settings.json",
+    "/home/bob/certs/client.pfx",
+    "/root/.gnupg/pubring.kbx",
+    "/root/.ssh/authorized_keys",
+    "/var/lib/kubelet/pki/kubelet-client-current.pem",
+    "/var/run/secrets/kubernetes.io/serviceaccount/ca.crt",
+    "/var/lib/docker/overlay2/3f1d2c9e8b7a/merged/etc/ssl/cert.pem",
+    "/var/log/nginx/access.log",
+    "/proc/self/status",
+    "/proc/1234/cmdline",
+    "/sys/fs/cgroup/memory.max",
+    "/dev/urandom",
+    "/tmp/tmp.XYZ123/session.der",
+    "/run/systemd/journal/socket",
+    "relative/path/server.pem",
+};
+
+static const char *builtin_libs[] = {
+    "/usr/sbin/nginx",
+    "/usr/lib/x86_64-linux-gnu/libcrypt.so.1.1.0",
+    "/usr/lib/x86_64-linux-gnu/libpcre2-8.so.0.11.2",
+    "/usr/lib/x86_64-linux-gnu/libssl.so.3",
+    "/usr/lib/x86_64-linux-gnu/libcrypto.so.3",
+    "/usr/lib/x86_64-linux-gnu/libz.so.1.2.13",
+    "/usr/lib/x86_64-linux-gnu/libc.so.6",
+    "/usr/lib/x86_64-linux-gnu/libm.so.6",
+    "/usr/lib/x86_64-linux-gnu/libgcc_s.so.1",
+    "/usr/lib/x86_64-linux-gnu/libstdc++.so.6.0.32",
+    "/usr/lib/x86_64-linux-gnu/libgnutls.so.30.34.3",
+    "/usr/lib/x86_64-linux-gnu/libnettle.so.8.6",
+    "/usr/lib/x86_64-linux-gnu/libhogweed.so.6.6",
+    "/usr/lib/x86_64-linux-gnu/libgcrypt.so.20.4.1",
+    "/usr/lib/x86_64-linux-gnu/libsodium.so.23.3.0",
+    "/usr/lib/x86_64-linux-gnu/libnss3.so",
+    "/usr/lib/x86_64-linux-gnu/libsystemd.so.0.35.0",
+    "/usr/lib/x86_64-linux-gnu/libnss_files.so.2",
+    "/usr/lib/x86_64-linux-gnu/gconv/gconv-modules.cache",
+    "/usr/lib/locale/C.utf8/LC_CTYPE",
+    "/usr/lib64/libssl.so.1.1.1k",
+    "/usr/lib64/libcrypto.so.1.1.1k",
+    "/usr/lib64/ld-linux-x86-64.so.2",
+    "/usr/lib/jvm/java-17-openjdk/lib/libjava.so",
+    "/opt/app/lib/libboringssl.so",
+    "/lib/x86_64-linux-gnu/libwolfssl.so.35.5.1",
+    "/lib/x86_64-linux-gnu/libmbedcrypto.so.7",
+    "libcrypto.so.3",
+};
+
+/* Strings as they occur in JSON output: paths, names and command lines */
+static const char *builtin_strings[] = {
+    "nginx: worker process",
+    "/usr/bin/python3 -c \"import ssl; print(ssl.OPENSSL_VERSION)\"",
+    "openssl\ts_client\t-connect\texample.com:443",
+    "curl -H 'Authorization: Bearer ...' https://api.example.com/v1",
+    "java -Djavax.net.ssl.trustStore=C:\\certs\\truststore.jks -jar app.jar",
+    "SSL_CTX_new",
+    "libcrypto",
+};
+
+static corpus_t path_corpus;
+static corpus_t lib_corpus;
+static corpus_t string_corpus;
+
+static int corpus_add(corpus_t *corpus, const char *item) {
+    char *copy;
+    
+    if (corpus->count >= MAX_CORPUS) {
+        return 0;
+    }
+    if (!corpus->items) {
+        corpus->items = calloc(MAX_CORPUS, sizeof(char *));
+        if (!corpus->items) {
+            return -1;
+        }
+    }
+    copy = strdup(item);
+    if (!copy) {
+        return -1;
+    }
+    corpus->items[corpus->count++] = copy;
+    return 0;
+}
+
+static int corpus_add_builtin(corpus_t *corpus, const char **items, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (corpus_add(corpus, items[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Load one path per line. Lines in /proc/PID/maps format contribute their
+ * pathname column; anonymous mappings are skipped, as are repeats of the
+ * previous path (the segments of one mapped file).
+ */
+static int corpus_load(corpus_t *corpus, const char *path) {
+    char line[MAX_LINE];
+    char previous[MAX_LINE] = "";
+    FILE *fp = fopen(path, "r");
+    
+    if (!fp) {
+        fprintf(stderr, "Error: cannot open corpus %s\n", path);
+        return -1;
+    }
+    
+    while (fgets(line, sizeof(line), fp)) {
+        char *item;
+        
+        line[strcspn(line, "\n")] = '\0';
+        item = line[0] == '/' ? line : strchr(line, '/');
+        if (!item || item[0] == '\0' || strcmp(item, previous) == 0) {
+            continue;
+        }
+        if (corpus_add(corpus, item) != 0) {
+            fclose(fp);
+            return -1;
+        }
+        snprintf(previous, sizeof(previous), "%s", item);
+    }
+    fclose(fp);
+    
+    if (corpus->count == 0) {
+        fprintf(stderr, "Error: corpus %s has no paths\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static void corpus_free(corpus_t *corpus) {
+    for (size_t i = 0; i < corpus->count; i++) {
+        free(corpus->items[i]);
+    }
+    free(corpus->items);
+    corpus->items = NULL;
+    corpus->count = 0;
+}
+
+/* Benchmarks
+ * run() performs op number i, cycling through its corpus; results are
+ * folded into sink so the calls are not optimized away. */
+static volatile uintptr_t sink;
+
+typedef struct {
+    const char *name;
+    const corpus_t *corpus;
+    int (*setup)(void);
+    void (*run)(size_t i);
+    void (*teardown)(void);
+} benchmark_t;
+
+static inline const char *corpus_item(const corpus_t *corpus, size_t i) {
+    return corpus->items[i % corpus->count];
+}
+
+static void run_classify_crypto_file(size_t i) {
+    sink += (uintptr_t)classify_crypto_file(corpus_item(&path_corpus, i));
+}
+
+static void run_extract_library_name(size_t i) {
+    char *name = extract_library_name(corpus_item(&lib_corpus, i));
+    
+    sink += (uintptr_t)name;
+    free(name);
+}
+
+static void run_library_name_span(size_t i) {
+    size_t len = 0;
+    
+    sink += (uintptr_t)library_name_span(corpus_item(&lib_corpus, i), &len) + len;
+}
+
+static void run_json_escape_string(size_t i) {
+    char *escaped = json_escape_string(corpus_item(&string_corpus, i));
+    
+    sink += (uintptr_t)escaped;
+    free(escaped);
+}
+
+static void run_privacy_filter_path(size_t i) {
+    char *redacted = privacy_filter_path(corpus_item(&path_corpus, i), true);
+    
+    sink += (uintptr_t)redacted;
+    free(redacted);
+}
+
+static void run_privacy_redact_path(size_t i) {
+    redacted_path_t view;
+    
+    sink += privacy_redact_path(corpus_item(&path_corpus, i), true, &view);
+}
+
+/* Patterns of the forms users pass to --file and --library */
+static const char *glob_patterns[] = { "*.pem", "/etc/ssl/*", "*/private/*.key", "*.p12" };
+static const char *substring_patterns[] = { "ssl", "private", "letsencrypt", "crypto" };
+
+static void run_glob_match(size_t i) {
+    sink += glob_match(glob_patterns[i % 4], corpus_item(&path_corpus, i / 4));
+}
+
+static void run_substring_match(size_t i) {
+    sink += substring_match(substring_patterns[i % 4], corpus_item(&path_corpus, i / 4));
+}
+
+static event_buffer_pool_t *bench_pool;
+
+static int setup_event_pool(void) {
+    bench_pool = event_buffer_pool_create(1024);
+    return bench_pool ? 0 : -1;
+}
+
+/* Acquire and release one event, as the consumer does per record */
+static void run_event_pool(size_t i) {
+    processed_event_t *event = event_buffer_pool_acquire(bench_pool);
+    
+    (void)i;
+    sink += (uintptr_t)event;
+    event_buffer_pool_release(bench_pool, event);
+}
+
+/* Acquire a small batch first, so the free list is exercised beyond its head */
+static void run_event_pool_batch(size_t i) {
+    processed_event_t *events[16];
+    
+    (void)i;
+    for (int j = 0; j < 16; j++) {
+        events[j] = event_buffer_pool_acquire(bench_pool);
+    }
+    for (int j = 0; j < 16; j++) {
+        sink += (uintptr_t)events[j];
+        event_buffer_pool_release(bench_pool, events[j]);
+    }
+}
+
+static void teardown_event_pool(void) {
+    event_buffer_pool_destroy(bench_pool);
+    bench_pool = NULL;
+}
+
+#define PROFILE_PIDS 64
+
+static profile_manager_t *bench_profiles;
+
+static int setup_profile_manager(void) {
+    bench_profiles = profile_manager_create();
+    return bench_profiles ? 0 : -1;
+}
+
+/* Events of a steady state: a fixed set of processes opening and loading
+ * the corpus paths again and again, as a profile --all run sees them */
+static void run_profile_manager_add_event(size_t i) {
+    processed_event_t event;
+    char library_name[256];
+    size_t name_len = 0;
+    
+    memset(&event, 0, sizeof(event));
+    event.pid = 1000 + (uint32_t)(i % PROFILE_PIDS);
+    event.timestamp_ns = 1700000000000000000ULL + i;
+    event.process = "nginx";
+    event.exe = "/usr/sbin/nginx";
+    
+    if (i % 4 == 3) {
+        event.event_type = "lib_load";
+        event.library = corpus_item(&lib_corpus, i / PROFILE_PIDS);
+        const char *name = library_name_span(event.library, &name_len);
+        snprintf(library_name, sizeof(library_name), "%.*s", (int)name_len, name ? name : "");
+        event.library_name = library_name;
+    } else {
+        event.event_type = "file_open";
+        event.file = corpus_item(&path_corpus, i / PROFILE_PIDS);
+        event.file_type = classify_crypto_file(event.file);
+        event.flags = "O_RDONLY";
+    }
+    sink += (uintptr_t)profile_manager_add_event(bench_profiles, &event);
+}
+
+static void teardown_profile_manager(void) {
+    profile_manager_destroy(bench_profiles);
+    bench_profiles = NULL;
+}
+
+static const benchmark_t benchmarks[] = {
+    { "classify_crypto_file", &path_corpus, NULL, run_classify_crypto_file, NULL },
+    { "extract_library_name", &lib_corpus, NULL, run_extract_library_name, NULL },
+    { "library_name_span", &lib_corpus, NULL, run_library_name_span, NULL },
+    { "json_escape_string", &string_corpus, NULL, run_json_escape_string, NULL },
+    { "privacy_filter_path", &path_corpus, NULL, run_privacy_filter_path, NULL },
+    { "privacy_redact_path", &path_corpus, NULL, run_privacy_redact_path, NULL },
+    { "glob_match", &path_corpus, NULL, run_glob_match, NULL },
+    { "substring_match", &path_corpus, NULL, run_substring_match, NULL },
+    { "event_pool_acquire_release", NULL, setup_event_pool, run_event_pool, teardown_event_pool },
+    { "event_pool_batch16", NULL, setup_event_pool, run_event_pool_batch, teardown_event_pool },
+    { "profile_manager_add_event", &path_corpus, setup_profile_manager,
+      run_profile_manager_add_event, teardown_profile_manager },
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/* Harness */
+typedef struct {
+    const char *name;
+    double ns_per_op;
+    double allocs_per_op;
+    uint64_t ops;
+} result_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    
+    return (x > y) - (x < y);
+}
+
+/**
+ * Run one benchmark: a warm-up pass over the corpus, an estimate of the
+ * ops that fit in run_ms, then repeat timed runs of that many ops
+ */
+static int run_benchmark(const benchmark_t *bench, int run_ms, int repeat, result_t *result) {
+    double samples[64];
+    double allocs = 0;
+    uint64_t ops = 0;
+    uint64_t warmup;
+    uint64_t start;
+    size_t next = 0;
+    
+    if (bench->setup && bench->setup() != 0) {
+        fprintf(stderr, "Error: setup of %s failed\n", bench->name);
+        return -1;
+    }
+    
+    /* Warm-up: fills caches and lets lazily built state settle */
+    warmup = bench->corpus ? bench->corpus->count * 4 : 1024;
+    if (warmup < 1024) {
+        warmup = 1024;
+    }
+    for (uint64_t i = 0; i < warmup; i++) {
+        bench->run(next++);
+    }
+    
+    /* Calibrate: double the op count until one run takes a tenth of run_ms */
+    for (uint64_t n = 256;; n *= 2) {
+        start = now_ns();
+        for (uint64_t i = 0; i < n; i++) {
+            bench->run(next++);
+        }
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed * 10 >= (uint64_t)run_ms * 1000000ULL || n >= (1ULL << 32)) {
+            ops = n * ((uint64_t)run_ms * 1000000ULL) / (elapsed ? elapsed : 1);
+            break;
+        }
+    }
+    if (ops == 0) {
+        ops = 1;
+    }
+    
+    for (int r = 0; r < repeat; r++) {
+        uint64_t allocs_before = thread_allocs;
+        
+        start = now_ns();
+        for (uint64_t i = 0; i < ops; i++) {
+            bench->run(next++);
+        }
+        samples[r] = (double)(now_ns() - start) / (double)ops;
+        allocs += (double)(thread_allocs - allocs_before);
+    }
+    
+    if (bench->teardown) {
+        bench->teardown();
+    }
+    
+    qsort(samples, (size_t)repeat, sizeof(samples[0]), compare_double);
+    result->name = bench->name;
+    result->ns_per_op = samples[repeat / 2];
+    result->allocs_per_op = allocs / ((double)ops * repeat);
+    result->ops = ops;
+    return 0;
+}
+
+static int write_results(const char *path, const result_t *results, size_t count) {
+    FILE *fp = fopen(path, "w");
+    
+    if (!fp) {
+        fprintf(stderr, "Error: cannot write %s\n", path);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        fprintf(fp, "{\"name\":\"%s\",\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"ops\":%" PRIu64 "}\n",
+                results[i].name, results[i].ns_per_op, results[i].allocs_per_op, results[i].ops);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/**
+ * Compare results against a file written by --json
+ * Returns the number of regressions; benchmarks missing from either side
+ * are reported but do not count.
+ */
+static int compare_baseline(const char *path, const result_t *results, size_t count,
+                            double max_regression) {
+    char line[512];
+    int regressions = 0;
+    FILE *fp = fopen(path, "r");
+    
+    if (!fp) {
+        fprintf(stderr, "Error: cannot open baseline %s\n", path);
+        return -1;
+    }
+    
+    printf("\n%-30s %12s %12s %9s\n", "vs baseline", "ns/op", "baseline", "change");
+    while (fgets(line, sizeof(line), fp)) {
+        char name[128];
+        double ns, allocs;
+        const result_t *result = NULL;
+        
+        if (sscanf(line, "{\"name\":\"%127[^\"]\",\"ns_per_op\":%lf,\"allocs_per_op\":%lf",
+                   name, &ns, &allocs) != 3) {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(results[i].name, name) == 0) {
+                result = &results[i];
+            }
+        }
+        if (!result) {
+            continue;
+        }
+            
+        double change = ns > 0 ? (result->ns_per_op - ns) * 100.0 / ns : 0;
+        bool slower = change > max_regression;
+        /* Allocation counts are exact; allow for rounding in the file only */
+        bool allocates = result->allocs_per_op > allocs + 0.0005;
+            
+        printf("%-30s %12.2f %12.2f %+8.1f%%%s%s\n", name, result->ns_per_op, ns, change,
+               slower ? "  SLOWER" : "", allocates ? "  MORE ALLOCATIONS" : "");
+        if (slower || allocates) {
+            regressions++;
+        }
+    }
+    fclose(fp);
+    return regressions;
+}
+    
+static void print_bench_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --time MS             Duration of each timed run (default: 200)\n");
+    printf("  --repeat N            Timed runs per benchmark, median reported (default: 5)\n");
+    printf("  --filter TEXT         Only run benchmarks whose name contains TEXT\n");
+    printf("  --paths FILE          File path corpus, one path per line\n");
+    printf("  --libs FILE           Library path corpus: paths or /proc/PID/maps contents\n");
+    printf("  --json FILE           Write results as JSON lines to FILE\n");
+    printf("  --baseline FILE       Compare against a --json file, exit 1 on regression\n");
+    printf("  --max-regression PCT  Allowed slowdown against the baseline (default: 25)\n");
+}
+    
+int main(int argc, char **argv) {
+    static struct option long_options[] = {
+        {"time", required_argument, 0, 't'},
+        {"repeat", required_argument, 0, 'r'},
+        {"filter", required_argument, 0, 'f'},
+        {"paths", required_argument, 0, 'p'},
+        {"libs", required_argument, 0, 'l'},
+        {"json", required_argument, 0, 'j'},
+        {"baseline", required_argument, 0, 'b'},
+        {"max-regression", required_argument, 0, 'm'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    result_t results[MAX_BENCHMARKS];
+    const char *filter = NULL;
+    const char *paths_file = NULL;
+    const char *libs_file = NULL;
+    const char *json_file = NULL;
+    const char *baseline_file = NULL;
+    double max_regression = 25.0;
+    size_t result_count = 0;
+    int run_ms = 200;
+    int repeat = 5;
+    int status = 0;
+    int opt;
+        
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                run_ms = atoi(optarg);
+                break;
+            case 'r':
+                repeat = atoi(optarg);
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            case 'p':
+                paths_file = optarg;
+                break;
+            case 'l':
+                libs_file = optarg;
+                break;
+            case 'j':
+                json_file = optarg;
+                break;
+            case 'b':
+                baseline_file = optarg;
+                break;
+            case 'm':
+                max_regression = atof(optarg);
+                break;
+            case 'h':
+                print_bench_usage(argv[0]);
+                return 0;
+            default:
+                print_bench_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (run_ms <= 0 || repeat <= 0 || repeat > 64 || max_regression < 0) {
+        fprintf(stderr, "Error: --time and --repeat (1-64) must be positive\n");
+        return 2;
+    }
+        
+    if ((paths_file ? corpus_load(&path_corpus, paths_file)
+                    : corpus_add_builtin(&path_corpus, builtin_paths,
+                                         sizeof(builtin_paths) / sizeof(builtin_paths[0]))) != 0 ||
+        (libs_file ? corpus_load(&lib_corpus, libs_file)
+                   : corpus_add_builtin(&lib_corpus, builtin_libs,
+                                        sizeof(builtin_libs) / sizeof(builtin_libs[0]))) != 0 ||
+        corpus_add_builtin(&string_corpus, builtin_strings,
+                           sizeof(builtin_strings) / sizeof(builtin_strings[0])) != 0) {
+        return 1;
+    }
+    /* Paths are the most common JSON strings */
+    for (size_t i = 0; i < path_corpus.count; i++) {
+        if (corpus_add(&string_corpus, path_corpus.items[i]) != 0) {
+            return 1;
+        }
+    }
+        
+    printf("Corpora: %zu paths, %zu library paths, %zu strings\n\n",
+           path_corpus.count, lib_corpus.count, string_corpus.count);
+    printf("%-30s %12s %12s %12s\n", "benchmark", "ns/op", "allocs/op", "ops/run");
+        
+    for (size_t i = 0; i < BENCHMARK_COUNT; i++) {
+        result_t *result = &results[result_count];
+            
+        if (filter && !strstr(benchmarks[i].name, filter)) {
+            continue;
+        }
+        if (run_benchmark(&benchmarks[i], run_ms, repeat, result) != 0) {
+            status = 1;
+            continue;
+        }
+        printf("%-30s %12.2f %12.3f %12" PRIu64 "\n", result->name, result->ns_per_op,
+               result->allocs_per_op, result->ops);
+        result_count++;
+    }
+        
+    if (json_file && write_results(json_file, results, result_count) != 0) {
+        status = 1;
+    }
+    if (baseline_file) {
+        int regressions = compare_baseline(baseline_file, results, result_count, max_regression);
+            
+        if (regressions > 0) {
+            printf("\n%d regression%s against %s\n", regressions, regressions == 1 ? "" : "s",
+                   baseline_file);
+        }
+        if (regressions != 0) {
+            status = 1;
+        }
+    }
+        
+    corpus_free(&path_corpus);
+    corpus_free(&lib_corpus);
+    corpus_free(&string_corpus);
+    return status;
+}
+    
\ No newline at end of file
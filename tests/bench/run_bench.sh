@@ -0,0 +1,119 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-3.0-or-later
+# Copyright (c) 2025 Graziano Labs Corp.
+
+# Throughput benchmark: run crypto-tracer monitor against the load
+# generator and write one JSON result object (default: build/bench-result.json)
+#
+# Usage: sudo tests/bench/run_bench.sh [load generator options]
+#   e.g. sudo tests/bench/run_bench.sh --duration 30 --open-rate 20000
+#
+# Environment:
+#   TRACER       crypto-tracer binary (default: ./build/crypto-tracer)
+#   GENERATOR    load generator binary (default: ./build/bench-load-generator)
+#   TRACER_ARGS  extra monitor options, e.g. "--lazy-wakeup --coalesce 1s"
+#   RESULT       result file (default: ./build/bench-result.json)
+
+set -e
+
+TRACER="${TRACER:-./build/crypto-tracer}"
+GENERATOR="${GENERATOR:-./build/bench-load-generator}"
+RESULT="${RESULT:-./build/bench-result.json}"
+
+if [ "$EUID" -ne 0 ]; then
+    echo "Error: This script must be run as root (sudo)" >&2
+    exit 1
+fi
+
+for binary in "$TRACER" "$GENERATOR"; do
+    if [ ! -x "$binary" ]; then
+        echo "Error: $binary not found (run 'make bench')" >&2
+        exit 1
+    fi
+done
+
+WORK_DIR=$(mktemp -d /tmp/ct-bench-run-XXXXXX)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# Print one numeric field of a flat-enough JSON object
+json_field() {
+    grep -o "\"$2\":[0-9.]*" "$1" | tail -1 | cut -d: -f2
+}
+
+# Tracer peak RSS (kB) and CPU time (clock ticks) from /proc
+sample_tracer() {
+    local hwm ticks
+    hwm=$(awk '/^VmHWM:/ { print $2 }' "/proc/$1/status" 2>/dev/null) || return 0
+    ticks=$(awk '{ print $14 + $15 }' "/proc/$1/stat" 2>/dev/null) || return 0
+    if [ -n "$hwm" ] && [ -n "$ticks" ]; then
+        echo "$hwm $ticks" > "$WORK_DIR/sample"
+    fi
+}
+
+# shellcheck disable=SC2086
+"$TRACER" monitor --output /dev/null --stats-file "$WORK_DIR/stats.json" $TRACER_ARGS \
+    2> "$WORK_DIR/tracer.log" &
+TRACER_PID=$!
+
+# Wait for the probes to be attached before generating load
+for _ in $(seq 100); do
+    if grep -q "monitoring started" "$WORK_DIR/tracer.log"; then
+        break
+    fi
+    if ! kill -0 "$TRACER_PID" 2>/dev/null; then
+        echo "Error: crypto-tracer exited during start-up:" >&2
+        cat "$WORK_DIR/tracer.log" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+
+"$GENERATOR" "$@" > "$WORK_DIR/generator.json"
+
+# Give the consumer time to drain, then take the last /proc sample
+sleep 1
+sample_tracer "$TRACER_PID"
+kill -INT "$TRACER_PID"
+wait "$TRACER_PID" || true
+
+if [ ! -s "$WORK_DIR/stats.json" ]; then
+    echo "Error: crypto-tracer wrote no statistics:" >&2
+    cat "$WORK_DIR/tracer.log" >&2
+    exit 1
+fi
+
+read -r RSS_KB CPU_TICKS < "$WORK_DIR/sample" || true
+ELAPSED_NS=$(json_field "$WORK_DIR/generator.json" elapsed_ns)
+PROCESSED=$(json_field "$WORK_DIR/stats.json" events_processed)
+RECEIVED=$(grep -o '"events_received":[0-9]*' "$WORK_DIR/stats.json" | cut -d: -f2 |
+           awk '{ sum += $1 } END { print sum + 0 }')
+KERNEL_DROPPED=$(json_field "$WORK_DIR/stats.json" kernel_dropped)
+USER_DROPPED=$(json_field "$WORK_DIR/stats.json" user_dropped)
+P50_NS=$(json_field "$WORK_DIR/stats.json" latency_p50_ns)
+P99_NS=$(json_field "$WORK_DIR/stats.json" latency_p99_ns)
+
+SUMMARY=$(awk -v elapsed="$ELAPSED_NS" -v processed="$PROCESSED" -v received="$RECEIVED" \
+              -v kdrop="$KERNEL_DROPPED" -v udrop="$USER_DROPPED" -v rss="${RSS_KB:-0}" \
+              -v ticks="${CPU_TICKS:-0}" -v hz="$(getconf CLK_TCK)" \
+              -v p50="$P50_NS" -v p99="$P99_NS" 'BEGIN {
+    offered = received + kdrop
+    cpu = ticks / hz
+    printf "{\"events_per_sec\":%.1f,\"kernel_dropped\":%d,\"user_dropped\":%d,", \
+           processed / (elapsed / 1e9), kdrop, udrop
+    printf "\"drop_rate\":%.6f,\"rss_max_kb\":%d,\"cpu_seconds\":%.2f,", \
+           offered > 0 ? (kdrop + udrop) / offered : 0, rss, cpu
+    printf "\"cpu_us_per_event\":%.3f,\"latency_p50_us\":%.1f,\"latency_p99_us\":%.1f}", \
+           processed > 0 ? cpu * 1e6 / processed : 0, p50 / 1000, p99 / 1000
+}')
+
+mkdir -p "$(dirname "$RESULT")"
+{
+    printf '{"version":"%s","kernel":"%s","cpus":%d,' \
+           "$("$TRACER" --version | awk 'NR == 1 { print $NF }')" "$(uname -r)" "$(nproc)"
+    printf '"tracer_args":"%s","summary":%s,' "$TRACER_ARGS" "$SUMMARY"
+    printf '"generator":%s,"tracer":%s}\n' \
+           "$(cat "$WORK_DIR/generator.json")" "$(cat "$WORK_DIR/stats.json")"
+} > "$RESULT"
+
+echo "Benchmark result written to $RESULT"
+echo "$SUMMARY"
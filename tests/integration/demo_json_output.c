@@ -15,6 +15,9 @@
 #include "src/include/output_formatter.h"
 #include "src/include/event_processor.h"
 
+/* Sample event timestamp: 2021-01-01T00:00:00.000000Z */
+#define SAMPLE_TIMESTAMP_NS 1609459200000000000ULL
+
 /* Helper to create a sample timestamp */
 char *create_sample_timestamp(void) {
     return format_timestamp_iso8601(1609459200000000000ULL); /* 2021-01-01T00:00:00.000000Z */
@@ -30,7 +33,7 @@ void demo_json_stream(void) {
     /* File open event */
     processed_event_t event1 = {
         .event_type = "file_open",
-        .timestamp = create_sample_timestamp(),
+        .timestamp_ns = SAMPLE_TIMESTAMP_NS,
         .pid = 1234,
         .uid = 1000,
         .process = "nginx",
@@ -41,12 +44,11 @@ void demo_json_stream(void) {
         .result = 3
     };
     output_formatter_write_event(fmt, &event1);
-    free(event1.timestamp);
     
     /* Library load event */
     processed_event_t event2 = {
         .event_type = "lib_load",
-        .timestamp = create_sample_timestamp(),
+        .timestamp_ns = SAMPLE_TIMESTAMP_NS,
         .pid = 1234,
         .uid = 1000,
         .process = "nginx",
@@ -55,7 +57,6 @@ void demo_json_stream(void) {
         .library_name = "libssl"
     };
     output_formatter_write_event(fmt, &event2);
-    free(event2.timestamp);
     
     output_formatter_destroy(fmt);
     printf("\n");
@@ -71,7 +72,7 @@ void demo_json_array(void) {
     /* Process exec event */
     processed_event_t event1 = {
         .event_type = "process_exec",
-        .timestamp = create_sample_timestamp(),
+        .timestamp_ns = SAMPLE_TIMESTAMP_NS,
         .pid = 5678,
         .uid = 1000,
         .process = "openssl",
@@ -79,12 +80,11 @@ void demo_json_array(void) {
         .cmdline = "openssl s_client -connect example.com:443"
     };
     output_formatter_write_event(fmt, &event1);
-    free(event1.timestamp);
     
     /* API call event */
     processed_event_t event2 = {
         .event_type = "api_call",
-        .timestamp = create_sample_timestamp(),
+        .timestamp_ns = SAMPLE_TIMESTAMP_NS,
         .pid = 5678,
         .uid = 1000,
         .process = "openssl",
@@ -93,19 +93,17 @@ void demo_json_array(void) {
         .library = "libssl"
     };
     output_formatter_write_event(fmt, &event2);
-    free(event2.timestamp);
     
     /* Process exit event */
     processed_event_t event3 = {
         .event_type = "process_exit",
-        .timestamp = create_sample_timestamp(),
+        .timestamp_ns = SAMPLE_TIMESTAMP_NS,
         .pid = 5678,
         .uid = 1000,
         .process = "openssl",
         .exit_code = 0
     };
     output_formatter_write_event(fmt, &event3);
-    free(event3.timestamp);
     
     output_formatter_destroy(fmt);
     printf("\n");
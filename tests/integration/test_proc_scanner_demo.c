@@ -28,8 +28,9 @@ int main(void) {
     printf("------------------------------------\n");
     pid_t self_pid = getpid();
     process_info_t self_info;
+    string_arena_t *arena = string_arena_create(0);
     
-    if (proc_scanner_get_process_info(scanner, self_pid, &self_info) == 0) {
+    if (proc_scanner_get_process_info(scanner, self_pid, &self_info, arena) == 0) {
         printf("PID: %d\n", self_info.pid);
         printf("Name: %s\n", self_info.comm);
         printf("Executable: %s\n", self_info.exe);
@@ -38,6 +39,7 @@ int main(void) {
     } else {
         printf("Failed to get process info\n");
     }
+    string_arena_destroy(arena);
     printf("\n");
     
     /* Test 2: Scan all processes */
@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_binary_format.c - Unit tests for the binary event format
+ * Tests varint encoding, event kind names, and that a decoded capture
+ * formats to the same JSON as the events it was written from
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../src/include/binary_format.h"
+#include "../../src/include/output_formatter.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+#define EVENT_COUNT 6
+
+static char long_cmdline[BINARY_DICT_MAX_LEN + 100];
+
+/**
+ * Events covering every type, repeated strings, NULL fields, negative
+ * values, a timestamp going backwards, a string too long for the
+ * dictionary and a file open resolved to its inode
+ */
+static void make_events(processed_event_t *events) {
+    memset(events, 0, EVENT_COUNT * sizeof(*events));
+    memset(long_cmdline, 'a', sizeof(long_cmdline) - 1);
+    long_cmdline[sizeof(long_cmdline) - 1] = '\0';
+    
+    events[0] = (processed_event_t){ .event_type = "file_open", .timestamp_ns = 1700000000123456000ULL,
+        .pid = 1234, .uid = 1000, .process = "nginx", .exe = "/usr/sbin/nginx",
+        .file = "/etc/ssl/certs/server.crt", .file_type = FILE_TYPE_CERTIFICATE,
+        .flags = "O_RDONLY", .result = -13 };
+    events[1] = (processed_event_t){ .event_type = "lib_load", .timestamp_ns = 1700000000223456000ULL,
+        .pid = 1234, .uid = 1000, .process = "nginx", .exe = "/usr/sbin/nginx",
+        .library = "/usr/lib/libssl.so.3", .library_name = "libssl", .count = 300,
+        .cgroup_id = 4242, .container = "3f2a9c1b7d4e", .pod = "0f1e2d3c-4b5a-6978-8796-a5b4c3d2e1f0" };
+    events[2] = (processed_event_t){ .event_type = "process_exec", .timestamp_ns = 1700000000023456000ULL,
+        .pid = 99, .process = "sh", .cmdline = long_cmdline };
+    events[3] = (processed_event_t){ .event_type = "process_exit", .timestamp_ns = 0,
+        .pid = 99, .tid = 101, .process = "sh", .exit_code = -2147483647 - 1 };
+    events[4] = (processed_event_t){ .event_type = "api_call", .timestamp_ns = 1700000001000000000ULL,
+        .pid = 1234, .uid = 1000, .process = "nginx", .exe = "/usr/sbin/nginx",
+        .function_name = "SSL_connect", .library = "/usr/lib/libssl.so.3" };
+    events[5] = events[0];
+    events[5].process = "tab\tand \"quote\"";
+    events[5].inode = 1835017;
+    events[5].dev = 0x10303;
+}
+
+static size_t read_all(FILE *file, char *buf, size_t size) {
+    size_t n;
+    
+    rewind(file);
+    n = fread(buf, 1, size - 1, file);
+    buf[n] = '\0';
+    return n;
+}
+
+/**
+ * Test: Varints and zigzag round-trip at the edges
+ */
+static int test_varint(void) {
+    TEST("test_varint");
+    
+    uint64_t values[] = { 0, 1, 127, 128, 16383, 16384, UINT32_MAX, UINT64_MAX };
+    uint8_t buf[BINARY_VARINT_MAX];
+    
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        size_t n = binary_put_varint(buf, values[i]);
+        ASSERT(n == binary_varint_size(values[i]) && n <= BINARY_VARINT_MAX, "Size mismatch");
+    }
+    ASSERT(binary_varint_size(127) == 1 && binary_varint_size(128) == 2, "Boundary sizes");
+    
+    ASSERT(binary_zigzag(0) == 0 && binary_zigzag(-1) == 1 && binary_zigzag(1) == 2,
+           "Zigzag small values");
+    ASSERT(binary_unzigzag(binary_zigzag(INT64_MIN)) == INT64_MIN &&
+           binary_unzigzag(binary_zigzag(INT64_MAX)) == INT64_MAX, "Zigzag extremes");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Event kinds and their event_type names map to each other
+ */
+static int test_event_kinds(void) {
+    TEST("test_event_kinds");
+    
+    processed_event_t event;
+    
+    for (int kind = EVENT_NONE + 1; kind < EVENT_KIND_COUNT; kind++) {
+        const char *name = event_kind_name((event_kind_t)kind);
+        ASSERT(name != NULL && event_kind_from_name(name) == (event_kind_t)kind, "Name round-trip");
+    }
+    ASSERT(event_kind_name(EVENT_NONE) == NULL && event_kind_name(EVENT_KIND_COUNT) == NULL,
+           "No name outside the schema");
+    ASSERT(event_kind_from_name("file_opened") == EVENT_NONE &&
+           event_kind_from_name(NULL) == EVENT_NONE, "Unknown names");
+    
+    memset(&event, 0, sizeof(event));
+    event.event_type = "process_exit";
+    ASSERT(processed_event_kind(&event) == EVENT_PROCESS_EXIT, "Kind from event_type");
+    processed_event_set_kind(&event, EVENT_API_CALL);
+    ASSERT(event.kind == EVENT_API_CALL && strcmp(event.event_type, "api_call") == 0, "Set kind");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: A capture decodes to exactly the JSON of the original events
+ */
+static int test_round_trip(void) {
+    TEST("test_round_trip");
+    
+    processed_event_t events[EVENT_COUNT];
+    processed_event_t decoded;
+    static char expected[32768];
+    static char actual[32768];
+    size_t binary_size;
+    int count = 0;
+    int status;
+    
+    make_events(events);
+    
+    FILE *capture = tmpfile();
+    FILE *direct = tmpfile();
+    FILE *converted = tmpfile();
+    ASSERT(capture && direct && converted, "Failed to create temp files");
+    
+    output_formatter_t *bin = output_formatter_create(FORMAT_BINARY, capture);
+    output_formatter_t *json = output_formatter_create(FORMAT_JSON_STREAM, direct);
+    ASSERT(bin && json, "Failed to create formatters");
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        ASSERT(output_formatter_write_event(bin, &events[i]) == 0, "Binary write failed");
+        ASSERT(output_formatter_write_event(json, &events[i]) == 0, "JSON write failed");
+    }
+    output_formatter_destroy(bin);
+    output_formatter_destroy(json);
+    
+    binary_size = (size_t)ftell(capture);
+    
+    rewind(capture);
+    binary_decoder_t *dec = binary_decoder_create(capture);
+    ASSERT(dec != NULL, "Failed to open capture");
+    json = output_formatter_create(FORMAT_JSON_STREAM, converted);
+    ASSERT(json != NULL, "Failed to create formatter");
+    while ((status = binary_decoder_next(dec, &decoded)) > 0) {
+        ASSERT(decoded.kind == processed_event_kind(&events[count]), "Decoded kind differs");
+        ASSERT(decoded.inode == events[count].inode && decoded.dev == events[count].dev,
+               "Decoded inode differs");
+        ASSERT(decoded.tid == events[count].tid, "Decoded thread differs");
+        ASSERT(output_formatter_write_event(json, &decoded) == 0, "Decoded write failed");
+        count++;
+    }
+    ASSERT(status == 0, "Decoder reported an error");
+    ASSERT(count == EVENT_COUNT, "Wrong number of decoded events");
+    output_formatter_destroy(json);
+    binary_decoder_destroy(dec);
+    
+    size_t json_size = read_all(direct, expected, sizeof(expected));
+    read_all(converted, actual, sizeof(actual));
+    ASSERT(strcmp(expected, actual) == 0, "Decoded JSON differs from the original");
+    ASSERT(binary_size < json_size, "Binary capture should be smaller than JSON");
+    
+    fclose(capture);
+    fclose(direct);
+    fclose(converted);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Foreign and truncated input is rejected
+ */
+static int test_malformed(void) {
+    TEST("test_malformed");
+    
+    processed_event_t events[EVENT_COUNT];
+    processed_event_t decoded;
+    static char data[32768];
+    size_t size;
+    int status;
+    
+    FILE *text = tmpfile();
+    ASSERT(text != NULL, "Failed to create temp file");
+    fputs("{\"event_type\":\"file_open\"}\n", text);
+    rewind(text);
+    ASSERT(binary_decoder_create(text) == NULL, "JSON input should be rejected");
+    fclose(text);
+    
+    /* Write a capture, then keep all but its last byte */
+    make_events(events);
+    FILE *capture = tmpfile();
+    ASSERT(capture != NULL, "Failed to create temp file");
+    output_formatter_t *bin = output_formatter_create(FORMAT_BINARY, capture);
+    ASSERT(bin != NULL, "Failed to create formatter");
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        output_formatter_write_event(bin, &events[i]);
+    }
+    output_formatter_destroy(bin);
+    rewind(capture);
+    size = fread(data, 1, sizeof(data), capture);
+    fclose(capture);
+    
+    FILE *truncated = tmpfile();
+    ASSERT(truncated != NULL && size > BINARY_HEADER_SIZE, "Failed to build truncated capture");
+    fwrite(data, 1, size - 1, truncated);
+    rewind(truncated);
+    
+    binary_decoder_t *dec = binary_decoder_create(truncated);
+    ASSERT(dec != NULL, "Valid header should be accepted");
+    while ((status = binary_decoder_next(dec, &decoded)) > 0) {
+    }
+    ASSERT(status < 0, "Truncated record should be an error");
+    binary_decoder_destroy(dec);
+    fclose(truncated);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Binary Format Unit Tests ===\n\n");
+    
+    test_varint();
+    test_event_kinds();
+    test_round_trip();
+    test_malformed();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_cgroup_cache.c - Unit tests for the cgroup attribution cache
+ * Tests container and pod parsing of cgroup names, selector matching, and
+ * a cache built over a directory tree laid out like a cgroup hierarchy
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../../src/include/cgroup_cache.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+#define CONTAINER_HEX "3F2A9C1B7D4E5f60718293a4b5c6d7e8f90112233445566778899aabbccddeef"
+#define POD_UID "0f1e2d3c-4b5a-6978-8796-a5b4c3d2e1f0"
+#define POD_SLICE "kubepods-besteffort-pod0f1e2d3c_4b5a_6978_8796_a5b4c3d2e1f0.slice"
+
+/**
+ * Test: Container ids and pod UIDs are found in runtime cgroup names
+ */
+static int test_parse_component(void) {
+    TEST("test_parse_component");
+    
+    char container[CGROUP_CONTAINER_ID_LEN + 1];
+    char pod[CGROUP_POD_UID_MAX + 1];
+    
+    ASSERT(cgroup_parse_component("docker-" CONTAINER_HEX ".scope", container, pod),
+           "docker scope should parse");
+    ASSERT(strcmp(container, "3f2a9c1b7d4e") == 0 && pod[0] == '\0',
+           "Container id should be short and lower-case");
+    
+    ASSERT(cgroup_parse_component("cri-containerd-" CONTAINER_HEX ".scope", container, pod) &&
+           strcmp(container, "3f2a9c1b7d4e") == 0, "cri-containerd scope should parse");
+    ASSERT(cgroup_parse_component(CONTAINER_HEX, container, pod) &&
+           strcmp(container, "3f2a9c1b7d4e") == 0, "cgroupfs driver name should parse");
+    ASSERT(!cgroup_parse_component("crio-conmon-" CONTAINER_HEX ".scope", container, pod),
+           "conmon scope is not the container");
+    
+    ASSERT(cgroup_parse_component(POD_SLICE, container, pod), "Pod slice should parse");
+    ASSERT(container[0] == '\0' && strcmp(pod, POD_UID) == 0,
+           "Pod UID should get its dashes back");
+    ASSERT(cgroup_parse_component("pod" POD_UID, container, pod) && strcmp(pod, POD_UID) == 0,
+           "cgroupfs pod name should parse");
+    
+    ASSERT(!cgroup_parse_component("system.slice", container, pod), "Plain slice");
+    ASSERT(!cgroup_parse_component("sshd.service", container, pod), "Plain service");
+    ASSERT(!cgroup_parse_component("docker-3f2a9c.scope", container, pod), "Short hex");
+    ASSERT(!cgroup_parse_component("kubepods-podman.slice", container, pod), "Not a pod UID");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Selector paths are normalized; paths and ids select subtrees
+ */
+static int test_selector(void) {
+    TEST("test_selector");
+    
+    cgroup_info_t docker = { .id = 10, .path = "/system.slice/docker-x.scope",
+                             .container = "3f2a9c1b7d4e" };
+    cgroup_info_t pod = { .id = 11, .path = "/kubepods.slice/p/c", .container = "0123456789ab",
+                          .pod = POD_UID };
+    cgroup_info_t sibling = { .id = 12, .path = "/system.slice-extra" };
+    cgroup_selector_t *sel;
+    
+    sel = cgroup_selector_create("/sys/fs/cgroup/system.slice/", NULL);
+    ASSERT(sel != NULL && strcmp(sel->path, "/system.slice") == 0,
+           "Mount prefix and trailing slash should be dropped");
+    ASSERT(cgroup_selector_matches(sel, &docker), "Descendant should match");
+    ASSERT(!cgroup_selector_matches(sel, &sibling), "Prefix of a name is not a parent");
+    cgroup_selector_destroy(sel);
+    
+    sel = cgroup_selector_create("/sys/fs/cgroup", NULL);
+    ASSERT(sel != NULL && strcmp(sel->path, "/") == 0, "Mount should select the root");
+    ASSERT(cgroup_selector_matches(sel, &sibling), "Root should match everything");
+    cgroup_selector_destroy(sel);
+    
+    sel = cgroup_selector_create(NULL, "3F2A9C");
+    ASSERT(sel != NULL, "Container selector");
+    ASSERT(cgroup_selector_matches(sel, &docker), "Id prefix should match any case");
+    ASSERT(!cgroup_selector_matches(sel, &pod), "Other containers should not match");
+    ASSERT(!cgroup_selector_matches(sel, &sibling), "Non-containers should not match");
+    cgroup_selector_destroy(sel);
+    
+    sel = cgroup_selector_create(NULL, CONTAINER_HEX);
+    ASSERT(sel != NULL && cgroup_selector_matches(sel, &docker), "Full id should match");
+    cgroup_selector_destroy(sel);
+    
+    sel = cgroup_selector_create("kubepods.slice", POD_UID);
+    ASSERT(sel != NULL && cgroup_selector_matches(sel, &pod), "Pod UID should match");
+    ASSERT(!cgroup_selector_matches(sel, &docker), "Both path and container must match");
+    cgroup_selector_destroy(sel);
+    
+    TEST_PASS();
+}
+
+/**
+ * Make a directory and return its inode (the cgroup id on cgroupfs)
+ */
+static uint64_t make_dir(const char *root, const char *path) {
+    char full[512];
+    struct stat st;
+    
+    snprintf(full, sizeof(full), "%s%s", root, path);
+    if (mkdir(full, 0700) != 0 || stat(full, &st) != 0) {
+        return 0;
+    }
+    return (uint64_t)st.st_ino;
+}
+
+/**
+ * Test: A walk caches every cgroup, children inherit their container and
+ * pod, and a selection returns only the outermost matching cgroups
+ */
+static int test_cache_tree(void) {
+    TEST("test_cache_tree");
+    
+    char root[64];
+    char cmd[128];
+    uint64_t kubepods, pod_slice, container, nested, system_slice, other;
+    uint64_t ids[4];
+    const cgroup_info_t *info;
+    cgroup_selector_t *sel;
+    cgroup_cache_t *cache;
+    
+    snprintf(root, sizeof(root), "/tmp/test_cgroup_cache.%d", (int)getpid());
+    ASSERT(mkdir(root, 0700) == 0, "mkdir root");
+    kubepods = make_dir(root, "/kubepods.slice");
+    pod_slice = make_dir(root, "/kubepods.slice/" POD_SLICE);
+    container = make_dir(root, "/kubepods.slice/" POD_SLICE "/cri-containerd-" CONTAINER_HEX ".scope");
+    nested = make_dir(root, "/kubepods.slice/" POD_SLICE "/cri-containerd-" CONTAINER_HEX ".scope/app");
+    system_slice = make_dir(root, "/system.slice");
+    ASSERT(kubepods && pod_slice && container && nested && system_slice, "mkdir tree");
+    
+    cache = cgroup_cache_create(root);
+    ASSERT(cache != NULL, "Cache should be created on an explicit root");
+    
+    ASSERT(cgroup_cache_lookup(cache, 0) == NULL, "Id 0 is never a cgroup");
+    
+    info = cgroup_cache_lookup(cache, kubepods);
+    ASSERT(info && strcmp(info->path, "/kubepods.slice") == 0 && !info->container && !info->pod,
+           "Slice should be cached without attribution");
+    
+    info = cgroup_cache_lookup(cache, pod_slice);
+    ASSERT(info && !info->container && info->pod && strcmp(info->pod, POD_UID) == 0,
+           "Pod slice should carry the pod UID");
+    
+    info = cgroup_cache_lookup(cache, nested);
+    ASSERT(info && strcmp(info->path, "/kubepods.slice/" POD_SLICE "/cri-containerd-"
+                          CONTAINER_HEX ".scope/app") == 0, "Nested path");
+    ASSERT(info->container && strcmp(info->container, "3f2a9c1b7d4e") == 0 &&
+           info->pod && strcmp(info->pod, POD_UID) == 0,
+           "Nested cgroup should inherit container and pod");
+    
+    /* The container matches; its nested cgroup passes through it */
+    sel = cgroup_selector_create(NULL, "3f2a9c1b");
+    ASSERT(sel != NULL, "Selector");
+    ASSERT(cgroup_cache_select(cache, sel, ids, 4) == 1 && ids[0] == container,
+           "Only the outermost container cgroup should be selected");
+    cgroup_selector_destroy(sel);
+    
+    sel = cgroup_selector_create(NULL, POD_UID);
+    ASSERT(sel != NULL, "Selector");
+    ASSERT(cgroup_cache_select(cache, sel, ids, 4) == 1 && ids[0] == pod_slice,
+           "A pod should be selected by its slice");
+    cgroup_selector_destroy(sel);
+    
+    /* A selection rescans, so cgroups created since are found */
+    other = make_dir(root, "/system.slice/sshd.service");
+    sel = cgroup_selector_create("/system.slice/sshd.service", NULL);
+    ASSERT(other && sel != NULL, "Selector");
+    ASSERT(cgroup_cache_select(cache, sel, ids, 4) == 1 && ids[0] == other,
+           "New cgroup should be selected after a rescan");
+    ASSERT(cgroup_cache_select(cache, sel, ids, 0) == 1, "Count should not be bounded by max");
+    cgroup_selector_destroy(sel);
+    
+    cgroup_cache_destroy(cache);
+    
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+    ASSERT(system(cmd) == 0, "cleanup");
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== cgroup Cache Unit Tests ===\n\n");
+    
+    test_parse_component();
+    test_selector();
+    test_cache_tree();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
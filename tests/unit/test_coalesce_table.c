@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_coalesce_table.c - Unit tests for the coalesced record table
+ * Tests record replacement, per-process visits, removal and growth
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../src/include/coalesce_table.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Visitor state: entries seen, and a PID whose entries are dropped */
+typedef struct {
+    int seen;
+    uint32_t drop_pid;
+} visit_ctx_t;
+
+static bool visit(coalesce_entry_t *entry, void *arg) {
+    visit_ctx_t *ctx = arg;
+    
+    ctx->seen++;
+    return entry->key.pid == ctx->drop_pid;
+}
+
+/**
+ * Test: A key keeps its delivered count when its record is replaced
+ */
+static int test_put_replaces_record(void) {
+    TEST("test_put_replaces_record");
+    
+    coalesce_table_t *table = coalesce_table_create();
+    ASSERT(table != NULL, "Failed to create table");
+    
+    coalesce_key_t key = { .pid = 42, .event_type = 1, .path_hash = 0x1234 };
+    coalesce_key_t other = { .pid = 42, .event_type = 2, .path_hash = 0x1234 };
+    char first[] = "first record";
+    char second[] = "a longer second record";
+    
+    ASSERT(coalesce_table_find(table, &key) == NULL, "Empty table should find nothing");
+    ASSERT(coalesce_table_put(table, &key, first, sizeof(first)) == 0, "Put failed");
+    
+    coalesce_entry_t *entry = coalesce_table_find(table, &key);
+    ASSERT(entry != NULL && entry->size == sizeof(first), "Entry should hold the record");
+    ASSERT(memcmp(entry->record, first, sizeof(first)) == 0 && entry->record != (void *)first,
+           "Record should be copied");
+    entry->delivered = 7;
+    
+    ASSERT(coalesce_table_put(table, &key, second, sizeof(second)) == 0, "Replace failed");
+    entry = coalesce_table_find(table, &key);
+    ASSERT(entry != NULL && entry->size == sizeof(second) &&
+           memcmp(entry->record, second, sizeof(second)) == 0, "Record should be replaced");
+    ASSERT(entry->delivered == 7, "Delivered count should survive a replacement");
+    ASSERT(coalesce_table_count(table) == 1, "Replacement should not add a key");
+    
+    ASSERT(coalesce_table_find(table, &other) == NULL, "Event type is part of the key");
+    ASSERT(coalesce_table_put(table, &key, NULL, 0) == -1, "Empty record should be rejected");
+    
+    coalesce_table_destroy(table);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Visits by process and removal from inside a visit
+ */
+static int test_visit_and_remove(void) {
+    TEST("test_visit_and_remove");
+    
+    coalesce_table_t *table = coalesce_table_create();
+    ASSERT(table != NULL, "Failed to create table");
+    
+    char record[] = "record";
+    for (uint32_t pid = 1; pid <= 3; pid++) {
+        for (uint64_t path = 1; path <= 4; path++) {
+            coalesce_key_t key = { .pid = pid, .event_type = 1, .path_hash = path };
+            ASSERT(coalesce_table_put(table, &key, record, sizeof(record)) == 0, "Put failed");
+        }
+    }
+    ASSERT(coalesce_table_count(table) == 12, "Count should be 12");
+    
+    visit_ctx_t ctx = { 0, 0 };
+    coalesce_table_for_each_pid(table, 2, visit, &ctx);
+    ASSERT(ctx.seen == 4, "Per-process visit should see that process's keys only");
+    
+    ctx = (visit_ctx_t){ 0, 2 };
+    coalesce_table_for_each_pid(table, 2, visit, &ctx);
+    ASSERT(ctx.seen == 4 && coalesce_table_count(table) == 8, "Visitor should drop PID 2");
+    
+    ctx = (visit_ctx_t){ 0, 3 };
+    coalesce_table_for_each(table, visit, &ctx);
+    ASSERT(ctx.seen == 8 && coalesce_table_count(table) == 4, "Visitor should drop PID 3");
+    
+    coalesce_key_t gone = { .pid = 3, .event_type = 1, .path_hash = 1 };
+    coalesce_key_t kept = { .pid = 1, .event_type = 1, .path_hash = 1 };
+    ASSERT(coalesce_table_find(table, &gone) == NULL, "Dropped key should be gone");
+    ASSERT(coalesce_table_find(table, &kept) != NULL, "Other keys should stay");
+    
+    coalesce_table_remove(table, &kept);
+    coalesce_table_remove(table, &kept);
+    ASSERT(coalesce_table_find(table, &kept) == NULL && coalesce_table_count(table) == 3,
+           "Remove should drop one key, once");
+    
+    ctx = (visit_ctx_t){ 0, 0 };
+    coalesce_table_for_each_pid(table, 1, visit, &ctx);
+    ASSERT(ctx.seen == 3, "Removed key should leave the per-process index");
+    
+    coalesce_table_destroy(table);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Keys stay reachable both ways across growth
+ */
+static int test_growth(void) {
+    TEST("test_growth");
+    
+    coalesce_table_t *table = coalesce_table_create();
+    ASSERT(table != NULL, "Failed to create table");
+    
+    for (uint32_t i = 0; i < 5000; i++) {
+        coalesce_key_t key = { .pid = i % 10, .event_type = 1, .path_hash = i };
+        ASSERT(coalesce_table_put(table, &key, &i, sizeof(i)) == 0, "Put failed");
+    }
+    ASSERT(coalesce_table_count(table) == 5000, "Count should be 5000");
+    
+    for (uint32_t i = 0; i < 5000; i++) {
+        coalesce_key_t key = { .pid = i % 10, .event_type = 1, .path_hash = i };
+        coalesce_entry_t *entry = coalesce_table_find(table, &key);
+        ASSERT(entry != NULL && memcmp(entry->record, &i, sizeof(i)) == 0,
+               "Record lost after growth");
+    }
+    
+    visit_ctx_t ctx = { 0, 0 };
+    coalesce_table_for_each_pid(table, 7, visit, &ctx);
+    ASSERT(ctx.seen == 500, "Per-process index lost entries after growth");
+    
+    coalesce_table_destroy(table);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Coalesce Table Unit Tests ===\n\n");
+    
+    test_put_replaces_record();
+    test_visit_and_remove();
+    test_growth();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_crypto_classifier.c - Unit tests for the crypto classifier
+ * Tests the built-in rules, overlapping library names, rule files and the
+ * kernel prefilter table built from them
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include "../../src/include/crypto_classifier.h"
+#include "../../src/ebpf/common.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/**
+ * Write a rule file for the load tests
+ */
+static int write_rules(const char *path, const char *rules) {
+    FILE *fp = fopen(path, "w");
+    
+    if (!fp) {
+        return -1;
+    }
+    fputs(rules, fp);
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * Test: Built-in extension rules
+ */
+static int test_builtin_file_types(void) {
+    TEST("test_builtin_file_types");
+    
+    crypto_classifier_t *classifier = crypto_classifier_create();
+    ASSERT(classifier != NULL, "Failed to create classifier");
+    
+    ASSERT(crypto_classifier_file_type(classifier, "/etc/ssl/certs/ca.pem") == FILE_TYPE_CERTIFICATE,
+           ".pem should be a certificate");
+    ASSERT(crypto_classifier_file_type(classifier, "/etc/ssl/server.CRT") == FILE_TYPE_CERTIFICATE,
+           "Extensions should match case-insensitively");
+    ASSERT(crypto_classifier_file_type(classifier, "/etc/ssl/private/server.key") == FILE_TYPE_PRIVATE_KEY,
+           ".key should be a private key");
+    ASSERT(crypto_classifier_file_type(classifier, "/opt/app/store.keystore") == FILE_TYPE_KEYSTORE,
+           ".keystore should be a keystore");
+    ASSERT(crypto_classifier_file_type(classifier, "/opt/app/id.p12") == FILE_TYPE_KEYSTORE,
+           ".p12 should be a keystore");
+    ASSERT(crypto_classifier_file_type(classifier, "/etc/ssl/ca.pem.bak") == FILE_TYPE_UNKNOWN,
+           "Extension must be a suffix");
+    ASSERT(crypto_classifier_file_type(classifier, "pem") == FILE_TYPE_UNKNOWN,
+           "Partial suffix must not match");
+    ASSERT(crypto_classifier_file_type(classifier, "") == FILE_TYPE_UNKNOWN, "Empty path");
+    ASSERT(crypto_classifier_file_type(classifier, NULL) == FILE_TYPE_UNKNOWN, "NULL path");
+    
+    crypto_classifier_destroy(classifier);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Built-in library rules, including names that overlap a partial match
+ */
+static int test_builtin_libraries(void) {
+    TEST("test_builtin_libraries");
+    
+    const crypto_classifier_t *classifier = crypto_classifier_default();
+    ASSERT(classifier != NULL, "Default classifier missing");
+    
+    ASSERT(crypto_classifier_is_library(classifier, "/usr/lib/x86_64-linux-gnu/libssl.so.3"),
+           "libssl should match");
+    ASSERT(crypto_classifier_is_library(classifier, "/usr/lib/libnss3.so"), "libnss3 should match");
+    /* "libcr" + "libcrypto": the automaton must fall back mid-match */
+    ASSERT(crypto_classifier_is_library(classifier, "/opt/libcrlibcrypto.so"),
+           "Match after a failed prefix");
+    ASSERT(crypto_classifier_is_library(classifier, "/opt/liblibsodium.so"),
+           "Match overlapping a failed prefix");
+    ASSERT(!crypto_classifier_is_library(classifier, "/usr/lib/libz.so.1"), "libz is not crypto");
+    ASSERT(!crypto_classifier_is_library(classifier, "/usr/lib/libss.so"), "Prefix only");
+    ASSERT(!crypto_classifier_is_library(classifier, "/usr/lib/LIBSSL.so"),
+           "Library names are case-sensitive");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Rule files replace the built-in rules
+ */
+static int test_load_rules(void) {
+    TEST("test_load_rules");
+    
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/ct_rules_test_%d", (int)getpid());
+    ASSERT(write_rules(path,
+                       "# custom rules\n"
+                       "library libwolfssl\n"
+                       "\n"
+                       "extension .der   certificate   # binary certs\n"
+                       "extension .tar.gz keystore\n"
+                       "extension .gz private_key\n") == 0, "Failed to write rules");
+    
+    crypto_classifier_t *classifier = crypto_classifier_load(path);
+    unlink(path);
+    ASSERT(classifier != NULL, "Failed to load rules");
+    
+    ASSERT(crypto_classifier_is_library(classifier, "/usr/lib/libwolfssl.so.35"), "Custom library");
+    ASSERT(!crypto_classifier_is_library(classifier, "/usr/lib/libssl.so.3"),
+           "Built-in libraries should be replaced");
+    ASSERT(crypto_classifier_file_type(classifier, "/etc/ca.DER") == FILE_TYPE_CERTIFICATE,
+           "Custom extension");
+    ASSERT(crypto_classifier_file_type(classifier, "/etc/ca.pem") == FILE_TYPE_UNKNOWN,
+           "Built-in extensions should be replaced");
+    ASSERT(crypto_classifier_file_type(classifier, "/backup/keys.tar.gz") == FILE_TYPE_KEYSTORE,
+           "Longest suffix should win");
+    ASSERT(crypto_classifier_file_type(classifier, "/backup/key.gz") == FILE_TYPE_PRIVATE_KEY,
+           "Shorter suffix should still match");
+    
+    crypto_classifier_destroy(classifier);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Malformed rule files are rejected
+ */
+static int test_load_invalid_rules(void) {
+    TEST("test_load_invalid_rules");
+    
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/ct_rules_test_%d", (int)getpid());
+    
+    ASSERT(write_rules(path, "extension .pem certificat\n") == 0, "Failed to write rules");
+    ASSERT(crypto_classifier_load(path) == NULL, "Unknown type should be rejected");
+    
+    ASSERT(write_rules(path, "library\n") == 0, "Failed to write rules");
+    ASSERT(crypto_classifier_load(path) == NULL, "Missing name should be rejected");
+    
+    ASSERT(write_rules(path, "suffix .pem certificate\n") == 0, "Failed to write rules");
+    ASSERT(crypto_classifier_load(path) == NULL, "Unknown keyword should be rejected");
+    
+    unlink(path);
+    ASSERT(crypto_classifier_load(path) == NULL, "Missing file should be rejected");
+    
+    TEST_PASS();
+}
+
+/* Collects enumerated extensions */
+typedef struct {
+    char suffixes[16][16];
+    file_type_t types[16];
+    int count;
+} extension_capture_t;
+
+static void capture_extension(const char *suffix, file_type_t type, void *ctx) {
+    extension_capture_t *capture = ctx;
+    
+    if (capture->count < 16) {
+        snprintf(capture->suffixes[capture->count], sizeof(capture->suffixes[0]), "%s", suffix);
+        capture->types[capture->count] = type;
+        capture->count++;
+    }
+}
+
+/**
+ * Test: Extension rules can be enumerated
+ */
+static int test_for_each_extension(void) {
+    TEST("test_for_each_extension");
+    
+    char path[64];
+    crypto_classifier_t *classifier;
+    extension_capture_t capture = {0};
+    bool saw_pem = false, saw_keys = false;
+    
+    snprintf(path, sizeof(path), "/tmp/ct_rules_test_%d", (int)getpid());
+    ASSERT(write_rules(path, "extension .PEM certificate\n"
+                             "extension .keys.tar keystore\n") == 0, "Failed to write rules");
+    classifier = crypto_classifier_load(path);
+    unlink(path);
+    ASSERT(classifier != NULL, "Rules should load");
+    
+    crypto_classifier_for_each_extension(classifier, capture_extension, &capture);
+    ASSERT(capture.count == 2, "Each rule should be reported once");
+    for (int i = 0; i < capture.count; i++) {
+        if (strcmp(capture.suffixes[i], ".pem") == 0 && capture.types[i] == FILE_TYPE_CERTIFICATE) {
+            saw_pem = true;
+        }
+        if (strcmp(capture.suffixes[i], ".keys.tar") == 0 && capture.types[i] == FILE_TYPE_KEYSTORE) {
+            saw_keys = true;
+        }
+    }
+    ASSERT(saw_pem, "Suffix should be reported lower-cased with its type");
+    ASSERT(saw_keys, "Multi-part suffix should be reported in order");
+    
+    crypto_classifier_destroy(classifier);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: The kernel prefilter table follows the loaded rules, and rules
+ * that do not fit it are reported so the prefilter stays off
+ */
+static int test_kernel_extensions(void) {
+    TEST("test_kernel_extensions");
+    
+    struct ct_crypto_extension table[MAX_CRYPTO_EXTENSIONS];
+    char path[64], rules[2048];
+    crypto_classifier_t *classifier;
+    size_t len = 0;
+    int count;
+    
+    snprintf(path, sizeof(path), "/tmp/ct_rules_test_%d", (int)getpid());
+    ASSERT(write_rules(path, "extension .DER certificate\n") == 0, "Failed to write rules");
+    classifier = crypto_classifier_load(path);
+    unlink(path);
+    ASSERT(classifier != NULL, "Rules should load");
+    count = crypto_classifier_kernel_extensions(classifier, table);
+    ASSERT(count == 1, "Only the custom extension should be in the table");
+    ASSERT(table[0].len == 4 && memcmp(table[0].suffix, ".der", 4) == 0,
+           "Custom extension should be stored lower-cased");
+    crypto_classifier_destroy(classifier);
+    
+    classifier = crypto_classifier_create();
+    ASSERT(classifier != NULL, "Built-in rules should compile");
+    count = crypto_classifier_kernel_extensions(classifier, table);
+    ASSERT(count > 0 && count <= MAX_CRYPTO_EXTENSIONS, "Built-in rules should fit");
+    crypto_classifier_destroy(classifier);
+    
+    /* One extension more than the table holds */
+    for (int i = 0; i <= MAX_CRYPTO_EXTENSIONS; i++) {
+        len += (size_t)snprintf(rules + len, sizeof(rules) - len,
+                                "extension .k%d private_key\n", i);
+    }
+    ASSERT(write_rules(path, rules) == 0, "Failed to write rules");
+    classifier = crypto_classifier_load(path);
+    unlink(path);
+    ASSERT(classifier != NULL, "Rules should load");
+    ASSERT(crypto_classifier_kernel_extensions(classifier, table) == -1,
+           "Too many extensions should not fit");
+    crypto_classifier_destroy(classifier);
+    
+    ASSERT(write_rules(path, "extension .averyverylongsuffix keystore\n") == 0,
+           "Failed to write rules");
+    classifier = crypto_classifier_load(path);
+    unlink(path);
+    ASSERT(classifier != NULL, "Rules should load");
+    ASSERT(crypto_classifier_kernel_extensions(classifier, table) == -1,
+           "An extension longer than the table's should not fit");
+    crypto_classifier_destroy(classifier);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Crypto Classifier Unit Tests ===\n\n");
+    
+    test_builtin_file_types();
+    test_builtin_libraries();
+    test_load_rules();
+    test_load_invalid_rules();
+    test_for_each_extension();
+    test_kernel_extensions();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_daemon.c - Unit tests for the daemon event fan-out
+ * Tests the request encoding, which events a request selects, and that a
+ * connected client receives only its events in the binary format
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../src/include/daemon.h"
+#include "../../src/include/binary_format.h"
+#include "../../src/include/ebpf_manager.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/**
+ * Test: A request survives formatting and parsing; bad ones are rejected
+ */
+static int test_request_round_trip(void) {
+    TEST("test_request_round_trip");
+    
+    daemon_request_t req = { .sources = EBPF_SOURCE_BIT(EBPF_SOURCE_FILE_OPEN), .pid = 42 };
+    daemon_request_t parsed;
+    char buf[DAEMON_REQUEST_MAX];
+    
+    snprintf(req.comm, sizeof(req.comm), "nginx");
+    ASSERT(daemon_request_format(&req, buf, sizeof(buf)) > 0, "Request should format");
+    ASSERT(daemon_request_parse(buf, &parsed) == 0, "Formatted request should parse");
+    ASSERT(parsed.sources == req.sources && parsed.pid == 42 &&
+           strcmp(parsed.comm, "nginx") == 0, "Parsed request should match");
+    
+    ASSERT(daemon_request_format(&req, buf, 8) == -1, "Short buffer should be rejected");
+    
+    ASSERT(daemon_request_parse("\n", &parsed) == 0, "Empty request should parse");
+    ASSERT(parsed.sources == EBPF_SOURCES_ALL && parsed.pid == 0 && parsed.comm[0] == '\0',
+           "Empty request should ask for everything");
+    ASSERT(daemon_request_parse("future 1\nsources 2\n\n", &parsed) == 0 && parsed.sources == 2,
+           "Unknown keys should be skipped");
+    
+    ASSERT(daemon_request_parse("sources 2\n", &parsed) != 0, "Unterminated request");
+    ASSERT(daemon_request_parse("pid x\n\n", &parsed) != 0, "Non-numeric PID");
+    ASSERT(daemon_request_parse("pid\n\n", &parsed) != 0, "Missing value");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Event types, PID and process name select events
+ */
+static int test_request_matches(void) {
+    TEST("test_request_matches");
+    
+    daemon_request_t req = { .sources = EBPF_SOURCE_BIT(EBPF_SOURCE_LIB_LOAD) };
+    processed_event_t lib = { .event_type = "lib_load", .pid = 7, .process = "Nginx" };
+    processed_event_t file = { .event_type = "file_open", .pid = 7, .process = "nginx" };
+    processed_event_t unnamed = { .event_type = "lib_load", .pid = 8 };
+    
+    ASSERT(daemon_request_matches(&req, &lib), "Requested type should match");
+    ASSERT(!daemon_request_matches(&req, &file), "Other types should not match");
+    
+    req.pid = 8;
+    ASSERT(!daemon_request_matches(&req, &lib), "Other PIDs should not match");
+    ASSERT(daemon_request_matches(&req, &unnamed), "Requested PID should match");
+    
+    req.pid = 0;
+    snprintf(req.comm, sizeof(req.comm), "ngin");
+    ASSERT(daemon_request_matches(&req, &lib), "Name substring should match any case");
+    ASSERT(daemon_request_matches(&req, &unnamed), "Unenriched events are left to the client");
+    lib.process = "sshd";
+    ASSERT(!daemon_request_matches(&req, &lib), "Other names should not match");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: A client receives the events it asked for, decodable as a capture
+ */
+static int test_server_round_trip(void) {
+    TEST("test_server_round_trip");
+    
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 1000000 };
+    daemon_request_t req = { .sources = EBPF_SOURCE_BIT(EBPF_SOURCE_FILE_OPEN) };
+    processed_event_t wanted = { .event_type = "file_open", .timestamp_ns = 1700000000000000000ULL,
+        .pid = 1234, .process = "nginx", .file = "/etc/ssl/certs/server.crt",
+        .file_type = FILE_TYPE_CERTIFICATE };
+    processed_event_t other = { .event_type = "lib_load", .timestamp_ns = 1700000000000000001ULL,
+        .pid = 1234, .process = "nginx", .library = "/usr/lib/libssl.so.3" };
+    processed_event_t decoded;
+    binary_decoder_t *dec;
+    daemon_server_t *server;
+    char path[64];
+    FILE *input;
+    int fd;
+    
+    snprintf(path, sizeof(path), "/tmp/test_daemon.%d.sock", (int)getpid());
+    server = daemon_server_start(path);
+    ASSERT(server != NULL, "Server should start");
+    
+    fd = daemon_connect(path, &req);
+    ASSERT(fd >= 0, "Client should connect");
+    for (int i = 0; i < 2000 && daemon_server_client_count(server) == 0; i++) {
+        nanosleep(&pause, NULL);
+    }
+    ASSERT(daemon_server_client_count(server) == 1, "Server should accept the client");
+    
+    daemon_server_publish(server, &other);
+    daemon_server_publish(server, &wanted);
+    daemon_server_flush(server);
+    
+    /* Stopping closes the stream after the flushed events */
+    daemon_server_stop(server);
+    ASSERT(access(path, F_OK) != 0, "Socket should be removed on stop");
+    
+    input = fdopen(fd, "rb");
+    ASSERT(input != NULL, "fdopen");
+    dec = binary_decoder_create(input);
+    ASSERT(dec != NULL, "Stream should start with the format header");
+    
+    ASSERT(binary_decoder_next(dec, &decoded) == 1, "Requested event should arrive");
+    ASSERT(strcmp(decoded.event_type, "file_open") == 0 && decoded.pid == 1234 &&
+           strcmp(decoded.file, wanted.file) == 0, "Event should decode unchanged");
+    ASSERT(binary_decoder_next(dec, &decoded) == 0, "Other event types should not be sent");
+    
+    binary_decoder_destroy(dec);
+    fclose(input);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Daemon Unit Tests ===\n\n");
+    
+    test_request_round_trip();
+    test_request_matches();
+    test_server_round_trip();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/capability.h>
 
@@ -160,6 +161,251 @@ static void test_get_stats(void)
     }
 }
 
+/**
+ * Test: Per-source statistics
+ */
+static void test_get_source_stats(void)
+{
+    TEST("test_get_source_stats");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_source_stats_t stats;
+        int all_idle = 1;
+        
+        for (int source = 0; source < EBPF_SOURCE_COUNT; source++) {
+            memset(&stats, 0xff, sizeof(stats));
+            if (ebpf_manager_get_source_stats(mgr, (ebpf_source_t)source, &stats) != 0 ||
+                stats.attached || stats.events_received != 0) {
+                all_idle = 0;
+            }
+        }
+        ASSERT(all_idle, "All sources start detached with zero events");
+        
+        ASSERT(ebpf_manager_get_source_stats(mgr, EBPF_SOURCE_COUNT, &stats) == -EINVAL,
+               "Out-of-range source rejected");
+        ASSERT(ebpf_manager_get_source_stats(mgr, EBPF_SOURCE_FILE_OPEN, NULL) == -EINVAL,
+               "NULL stats rejected");
+        ASSERT(strcmp(ebpf_source_name(EBPF_SOURCE_LIB_LOAD), "lib_load_trace") == 0,
+               "Source name resolves to program name");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
+/**
+ * Test: Kernel-side process filter
+ */
+static void test_set_process_filter(void)
+{
+    TEST("test_set_process_filter");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_process_filter_t filter = { .pid = 1, .follow_children = true };
+        
+        ASSERT(ebpf_manager_set_process_filter(mgr, NULL) == -EINVAL,
+               "NULL filter rejected");
+        ASSERT(ebpf_manager_set_process_filter(NULL, &filter) == -EINVAL,
+               "NULL manager rejected");
+        ASSERT(ebpf_manager_set_process_filter(mgr, &filter) == -1,
+               "Filter rejected before programs are loaded");
+        ASSERT(!ebpf_manager_follows_children(mgr),
+               "Children not followed without a kernel filter");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
+/**
+ * Test: Ring buffer configuration
+ */
+static void test_set_ringbuf_config(void)
+{
+    TEST("test_set_ringbuf_config");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_ringbuf_config_t config = { .size = 4 << 20, .lazy_wakeup = true };
+        ebpf_ringbuf_config_t bad_size = { .size = 3 << 20 };
+        ebpf_ringbuf_config_t defaults = { 0 };
+        uint64_t events_dropped = 1;
+        
+        ASSERT(ebpf_manager_set_ringbuf_config(mgr, NULL) == -EINVAL,
+               "NULL config rejected");
+        ASSERT(ebpf_manager_set_ringbuf_config(mgr, &bad_size) == -EINVAL,
+               "Non power-of-two size rejected");
+        ASSERT(ebpf_manager_set_ringbuf_config(mgr, &config) == 0,
+               "4 MB lazy-wakeup ring accepted");
+        ASSERT(ebpf_manager_set_ringbuf_config(mgr, &defaults) == 0,
+               "Zero size selects the default");
+        
+        ebpf_manager_get_stats(mgr, NULL, &events_dropped);
+        ASSERT(events_dropped == 0, "No kernel-side drops before load");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
+/**
+ * Test: Event source selection
+ */
+static void test_set_sources(void)
+{
+    TEST("test_set_sources");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_source_stats_t stats;
+        
+        ASSERT(ebpf_manager_set_sources(NULL, EBPF_SOURCES_ALL) == -EINVAL,
+               "NULL manager rejected");
+        ASSERT(ebpf_manager_set_sources(mgr, 1U << EBPF_SOURCE_COUNT) == -EINVAL,
+               "Unknown source rejected");
+        ASSERT(ebpf_manager_set_sources(mgr, EBPF_SOURCE_BIT(EBPF_SOURCE_LIB_LOAD)) == 0,
+               "Single source accepted");
+        ASSERT(ebpf_manager_set_sources(mgr, 0) == 0, "Zero selects every source");
+        
+        ASSERT(ebpf_manager_get_source_stats(mgr, EBPF_SOURCE_LIB_LOAD, &stats) == 0 &&
+               stats.load_ns == 0 && stats.attach_ns == 0,
+               "No load or attach time before load");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
+/**
+ * Test: Coalescing window setter
+ */
+static void test_set_coalesce_window(void)
+{
+    TEST("test_set_coalesce_window");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_source_stats_t stats;
+        
+        ASSERT(ebpf_manager_set_coalesce_window(NULL, 1000) == -EINVAL,
+               "NULL manager rejected");
+        ASSERT(ebpf_manager_set_coalesce_window(mgr, 5000) == 0, "Window accepted");
+        ASSERT(ebpf_manager_set_coalesce_window(mgr, 0) == 0, "Coalescing turned off");
+        ASSERT(ebpf_manager_set_coalesce_window(mgr, 250) == 0, "Window accepted again");
+        ASSERT(ebpf_manager_flush_coalesced(mgr) == 0, "Flush before polling is a no-op");
+        ASSERT(ebpf_manager_flush_coalesced(NULL) == -EINVAL, "NULL manager rejected by flush");
+        
+        ASSERT(ebpf_manager_get_source_stats(mgr, EBPF_SOURCE_FILE_OPEN, &stats) == 0 &&
+               stats.coalesced == 0,
+               "Nothing coalesced before load");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
+/**
+ * Test: Rate limits need loaded programs and a valid source
+ */
+static void test_set_rate_limit(void)
+{
+    TEST("test_set_rate_limit");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_rate_limit_t limit = { .rate = 1000, .sample_every = 10 };
+        ebpf_source_stats_t stats;
+        
+        ASSERT(ebpf_manager_set_rate_limit(NULL, EBPF_SOURCE_FILE_OPEN, &limit) == -EINVAL,
+               "NULL manager rejected");
+        ASSERT(ebpf_manager_set_rate_limit(mgr, EBPF_SOURCE_COUNT, &limit) == -EINVAL,
+               "Invalid source rejected");
+        ASSERT(ebpf_manager_set_rate_limit(mgr, EBPF_SOURCE_FILE_OPEN, &limit) == -1,
+               "Rate limit rejected before load");
+        
+        ASSERT(ebpf_manager_get_source_stats(mgr, EBPF_SOURCE_FILE_OPEN, &stats) == 0 &&
+               stats.sampled_out == 0 && stats.rate_limited == 0,
+               "Nothing suppressed before load");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
+/**
+ * Test: Drain policy and consumer statistics
+ */
+static void test_poll_config(void)
+{
+    TEST("test_poll_config");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_poll_config_t config = { .budget = 64, .idle_timeout_ms = 50 };
+        ebpf_poll_config_t bad_timeout = { .idle_timeout_ms = -1 };
+        ebpf_consumer_stats_t stats;
+        
+        ASSERT(ebpf_manager_set_poll_config(mgr, NULL) == -EINVAL,
+               "NULL poll config rejected");
+        ASSERT(ebpf_manager_set_poll_config(mgr, &bad_timeout) == -EINVAL,
+               "Negative idle timeout rejected");
+        ASSERT(ebpf_manager_set_poll_config(mgr, &config) == 0,
+               "Poll config accepted");
+        
+        memset(&stats, 0xff, sizeof(stats));
+        ASSERT(ebpf_manager_get_consumer_stats(mgr, &stats) == 0 &&
+               stats.events == 0 && stats.latency_p99_ns == 0 && stats.batches == 0,
+               "Consumer stats start empty");
+        ASSERT(ebpf_manager_get_consumer_stats(mgr, NULL) == -EINVAL,
+               "NULL consumer stats rejected");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
+/**
+ * Test: Stop, drain and shutdown statistics without loaded programs
+ */
+static void test_shutdown(void)
+{
+    TEST("test_shutdown");
+    
+    struct ebpf_manager *mgr = ebpf_manager_create();
+    ASSERT(mgr != NULL, "eBPF manager created");
+    
+    if (mgr) {
+        ebpf_shutdown_stats_t stats;
+        
+        ASSERT(ebpf_manager_stop_events(NULL) == -EINVAL, "NULL manager rejected by stop");
+        ASSERT(ebpf_manager_stop_events(mgr) == 0, "Nothing to stop before load");
+        ASSERT(ebpf_manager_drain(NULL, NULL, NULL, 100) == -EINVAL,
+               "NULL manager rejected by drain");
+        ASSERT(ebpf_manager_drain(mgr, NULL, NULL, 100) == 0, "Nothing to drain before load");
+        ASSERT(ebpf_manager_drain_consumer(mgr, 0, NULL, NULL, 100) == -EINVAL,
+               "No consumers to drain");
+        
+        ebpf_manager_cleanup(mgr);
+        memset(&stats, 0xff, sizeof(stats));
+        ASSERT(ebpf_manager_get_shutdown_stats(mgr, &stats) == 0 &&
+               stats.drain_events == 0 && stats.drain_left_bytes == 0 && stats.teardown_ns == 0,
+               "Nothing drained or detached");
+        ASSERT(ebpf_manager_get_shutdown_stats(mgr, NULL) == -EINVAL,
+               "NULL shutdown stats rejected");
+        
+        ebpf_manager_destroy(mgr);
+    }
+}
+
 /**
  * Test: Cleanup without load
  */
@@ -188,6 +434,14 @@ int main(void)
     /* Run tests */
     test_create_destroy();
     test_get_stats();
+    test_get_source_stats();
+    test_set_process_filter();
+    test_set_ringbuf_config();
+    test_set_sources();
+    test_set_coalesce_window();
+    test_set_rate_limit();
+    test_poll_config();
+    test_shutdown();
     test_cleanup_without_load();
     test_load_programs();
     test_attach_programs();
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include "../../src/include/crypto_tracer.h"
 
 /* Test counter */
@@ -219,7 +220,8 @@ void test_event_cleared_on_acquire(void) {
     }
     
     /* Set some data */
-    event->event_type = strdup("test_event");
+    event->event_type = "test_event";
+    processed_event_set_string(event, EVENT_OWNS_FILE, strdup("/etc/ssl/cert.pem"));
     event->pid = 1234;
     event->uid = 5678;
     
@@ -251,6 +253,65 @@ void test_event_cleared_on_acquire(void) {
     PASS();
 }
 
+/**
+ * Test: Borrowed strings are left alone, owned strings are freed
+ */
+void test_borrowed_and_owned_strings(void) {
+    TEST("borrowed_and_owned_strings");
+    
+    event_buffer_pool_t *pool = event_buffer_pool_create(10);
+    if (!pool) {
+        FAIL("Failed to create pool");
+        return;
+    }
+    
+    processed_event_t *event = event_buffer_pool_acquire(pool);
+    if (!event) {
+        FAIL("Failed to acquire event");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    /* Borrowed fields must survive release untouched */
+    static const char comm[] = "nginx";
+    event->process = comm;
+    event->library = "/usr/lib/libssl.so.3";
+    
+    processed_event_set_string(event, EVENT_OWNS_EXE, strdup("/usr/sbin/nginx"));
+    if (!(event->owned & EVENT_OWNS_EXE) || strcmp(event->exe, "/usr/sbin/nginx") != 0) {
+        FAIL("Owned string not recorded");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    /* Replacing a borrowed field takes ownership of the new value */
+    processed_event_set_string(event, EVENT_OWNS_LIBRARY, strdup("/usr/lib/libcrypto.so.3"));
+    if (!(event->owned & EVENT_OWNS_LIBRARY) || (event->owned & EVENT_OWNS_PROCESS)) {
+        FAIL("Ownership bits incorrect after replace");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    /* Replacing an owned field frees the old value (checked under valgrind/ASan) */
+    processed_event_set_string(event, EVENT_OWNS_EXE, NULL);
+    if (event->exe != NULL || (event->owned & EVENT_OWNS_EXE)) {
+        FAIL("Clearing an owned string should drop ownership");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    event_buffer_pool_release(pool, event);
+    
+    if (strcmp(comm, "nginx") != 0) {
+        FAIL("Borrowed string modified on release");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    event_buffer_pool_destroy(pool);
+    PASS();
+}
+
 /**
  * Test: Default capacity
  */
@@ -319,6 +380,271 @@ void test_large_pool(void) {
     PASS();
 }
 
+/**
+ * Test: Record copies survive release and reuse their buffer
+ */
+void test_copy_record(void) {
+    TEST("copy_record");
+    
+    event_buffer_pool_t *pool = event_buffer_pool_create(1);
+    processed_event_t *event;
+    const char record[] = "raw record bytes";
+    char *copy;
+    char *first_buffer;
+    
+    if (!pool || !(event = event_buffer_pool_acquire(pool))) {
+        FAIL("Failed to create pool");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    copy = processed_event_copy_record(event, record, sizeof(record), 16);
+    if (!copy || memcmp(copy, record, sizeof(record)) != 0 ||
+        event->record_capacity < sizeof(record) + 16) {
+        FAIL("Record should be copied with scratch space");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    first_buffer = event->record;
+    
+    /* The buffer is kept across release/acquire and not reallocated */
+    event_buffer_pool_release(pool, event);
+    event = event_buffer_pool_acquire(pool);
+    if (!event || event->record != first_buffer) {
+        FAIL("Record buffer should be kept when the event is recycled");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    copy = processed_event_copy_record(event, record, 4, 0);
+    if (copy != first_buffer) {
+        FAIL("Smaller copy should reuse the buffer");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    event_buffer_pool_release(pool, event);
+    event_buffer_pool_destroy(pool);
+    PASS();
+}
+
+/**
+ * Test: The pool grows slab by slab up to its capacity
+ */
+void test_growth_across_slabs(void) {
+    TEST("growth_across_slabs");
+    
+    size_t capacity = EVENT_POOL_SLAB_EVENTS * 2 + 10;
+    event_buffer_pool_t *pool = event_buffer_pool_create(capacity);
+    processed_event_t **events = calloc(capacity, sizeof(*events));
+    event_pool_stats_t stats;
+    size_t i;
+    
+    if (!pool || !events) {
+        FAIL("Failed to create pool");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    event_buffer_pool_get_stats(pool, &stats);
+    if (stats.allocated > EVENT_POOL_SLAB_EVENTS) {
+        FAIL("Pool should start with at most one slab");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    for (i = 0; i < capacity; i++) {
+        events[i] = event_buffer_pool_acquire(pool);
+        if (!events[i]) {
+            FAIL("Pool should grow up to its capacity");
+            free(events);
+            event_buffer_pool_destroy(pool);
+            return;
+        }
+    }
+    
+    if (event_buffer_pool_acquire(pool) != NULL) {
+        FAIL("Pool should not grow past its capacity");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    event_buffer_pool_get_stats(pool, &stats);
+    if (stats.allocated != capacity || stats.in_use != capacity ||
+        stats.high_water != capacity || stats.capacity != capacity) {
+        FAIL("Stats should show the pool fully grown and in use");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    for (i = 0; i < capacity; i++) {
+        event_buffer_pool_release(pool, events[i]);
+    }
+    
+    event_buffer_pool_get_stats(pool, &stats);
+    if (stats.in_use != 0 || stats.high_water != capacity) {
+        FAIL("High water should be kept after release");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    free(events);
+    event_buffer_pool_destroy(pool);
+    PASS();
+}
+
+/**
+ * Test: Stored strings go inline first, then to the overflow arena
+ */
+void test_store_string(void) {
+    TEST("store_string");
+    
+    event_buffer_pool_t *pool = event_buffer_pool_create(4);
+    processed_event_t *event;
+    processed_event_t stack_event;
+    char long_name[EVENT_INLINE_STRINGS * 2];
+    const char *stored;
+    
+    if (!pool || !(event = event_buffer_pool_acquire(pool))) {
+        FAIL("Failed to create pool");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    stored = processed_event_store_string(event, EVENT_OWNS_LIBRARY_NAME, "libssl.so.3xyz", 11);
+    if (!stored || strcmp(event->library_name, "libssl.so.3") != 0 ||
+        stored < event->inline_strings ||
+        stored >= event->inline_strings + sizeof(event->inline_strings)) {
+        FAIL("Short string should be stored inline");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    memset(long_name, 'a', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    stored = processed_event_store_string(event, EVENT_OWNS_EXE, long_name, strlen(long_name));
+    if (!stored || strcmp(event->exe, long_name) != 0 ||
+        (stored >= event->inline_strings &&
+         stored < event->inline_strings + sizeof(event->inline_strings))) {
+        FAIL("Long string should go to the overflow arena");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    if (strcmp(event->library_name, "libssl.so.3") != 0) {
+        FAIL("Inline string should survive an overflow store");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    /* Released events start with empty string storage */
+    event_buffer_pool_release(pool, event);
+    event = event_buffer_pool_acquire(pool);
+    if (!event || event->inline_used != 0 || event->library_name || event->exe) {
+        FAIL("Reused event should have empty string storage");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    event_buffer_pool_release(pool, event);
+    
+    /* Events outside a pool own a heap copy (checked under valgrind/ASan) */
+    memset(&stack_event, 0, sizeof(stack_event));
+    stored = processed_event_store_string(&stack_event, EVENT_OWNS_EXE, long_name, strlen(long_name));
+    if (!stored || !(stack_event.owned & EVENT_OWNS_EXE)) {
+        FAIL("Event without a pool should own its long strings");
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    processed_event_free_strings(&stack_event);
+    
+    event_buffer_pool_destroy(pool);
+    PASS();
+}
+
+struct release_args {
+    event_buffer_pool_t *pool;
+    processed_event_t **events;
+    size_t count;
+};
+
+static void *release_thread(void *arg) {
+    struct release_args *args = arg;
+    
+    for (size_t i = 0; i < args->count; i++) {
+        event_buffer_pool_release(args->pool, args->events[i]);
+    }
+    return NULL;
+}
+
+/**
+ * Test: Events released on another thread come back to the pool
+ * The releasing thread caches them and hands its cache back on exit
+ */
+void test_cross_thread_release(void) {
+    TEST("cross_thread_release");
+    
+    size_t capacity = EVENT_POOL_SLAB_EVENTS;
+    event_buffer_pool_t *pool = event_buffer_pool_create(capacity);
+    processed_event_t **events = calloc(capacity, sizeof(*events));
+    struct release_args args = { pool, events, capacity };
+    pthread_t thread;
+    size_t i;
+    
+    if (!pool || !events) {
+        FAIL("Failed to create pool");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    for (i = 0; i < capacity; i++) {
+        events[i] = event_buffer_pool_acquire(pool);
+        if (!events[i]) {
+            FAIL("Failed to acquire event");
+            free(events);
+            event_buffer_pool_destroy(pool);
+            return;
+        }
+    }
+    
+    if (pthread_create(&thread, NULL, release_thread, &args) != 0) {
+        FAIL("Failed to start release thread");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    pthread_join(thread, NULL);
+    
+    if (pool->in_use_count != 0) {
+        FAIL("in_use_count should be 0 after a cross-thread release");
+        free(events);
+        event_buffer_pool_destroy(pool);
+        return;
+    }
+    
+    /* Every event is reachable again, including the exited thread's cache */
+    for (i = 0; i < capacity; i++) {
+        events[i] = event_buffer_pool_acquire(pool);
+        if (!events[i]) {
+            FAIL("Events cached by an exited thread should be returned");
+            free(events);
+            event_buffer_pool_destroy(pool);
+            return;
+        }
+    }
+    for (i = 0; i < capacity; i++) {
+        event_buffer_pool_release(pool, events[i]);
+    }
+    
+    free(events);
+    event_buffer_pool_destroy(pool);
+    PASS();
+}
+
 int main(void) {
     printf("=== Event Buffer Pool Unit Tests ===\n\n");
     
@@ -327,8 +653,13 @@ int main(void) {
     test_acquire_multiple();
     test_pool_exhaustion();
     test_event_cleared_on_acquire();
+    test_borrowed_and_owned_strings();
     test_default_capacity();
     test_large_pool();
+    test_copy_record();
+    test_growth_across_slabs();
+    test_store_string();
+    test_cross_thread_release();
     
     printf("\n=== Test Results ===\n");
     printf("Passed: %d\n", tests_passed);
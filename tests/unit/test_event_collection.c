@@ -82,7 +82,7 @@ static int test_event_callback(struct processed_event *event, void *ctx)
         (*count)++;
         
         /* Verify event has required fields */
-        if (event->event_type && event->timestamp && event->process) {
+        if (event->event_type && event->timestamp_ns && event->process) {
             /* Event looks valid */
         }
     }
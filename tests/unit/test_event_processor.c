@@ -16,8 +16,10 @@
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <fnmatch.h>
 #include "../../src/include/crypto_tracer.h"
 #include "../../src/include/event_processor.h"
+#include "../../src/include/proc_cache.h"
 
 /* Test counter */
 static int tests_run = 0;
@@ -34,11 +36,15 @@ static int test_library_filter(void);
 static int test_file_path_filter(void);
 static int test_multiple_filters_and_logic(void);
 static int test_empty_filter_set(void);
+static int test_glob_matches_fnmatch(void);
+static int test_filter_verdicts(void);
 static int test_event_processor_create(void);
 static int test_enrich_process_name(void);
 static int test_enrich_executable_path(void);
 static int test_enrich_cmdline(void);
 static int test_enrich_event(void);
+static int test_enrich_retained_event(void);
+static int test_enrich_thread_exit(void);
 static int test_classify_crypto_file(void);
 static int test_file_type_to_string(void);
 static int test_extract_library_name(void);
@@ -209,7 +215,7 @@ static int test_pid_filter(void) {
     /* Create test event */
     processed_event_t event = {0};
     event.pid = 1234;
-    event.process = strdup("test");
+    event.process = "test";
     
     /* Should match */
     ASSERT(filter_set_matches(set, &event), 
@@ -220,7 +226,6 @@ static int test_pid_filter(void) {
     ASSERT(!filter_set_matches(set, &event), 
            "Event with non-matching PID should fail filter");
     
-    free(event.process);
     filter_set_destroy(set);
     
     TEST_PASS();
@@ -239,28 +244,24 @@ static int test_process_name_filter(void) {
     processed_event_t event = {0};
     
     /* Should match - exact */
-    event.process = strdup("nginx");
+    event.process = "nginx";
     ASSERT(filter_set_matches(set, &event), 
            "Event with exact process name should pass filter");
-    free(event.process);
     
     /* Should match - substring */
-    event.process = strdup("/usr/sbin/nginx");
+    event.process = "/usr/sbin/nginx";
     ASSERT(filter_set_matches(set, &event), 
            "Event with process name substring should pass filter");
-    free(event.process);
     
     /* Should match - case insensitive */
-    event.process = strdup("NGINX");
+    event.process = "NGINX";
     ASSERT(filter_set_matches(set, &event), 
            "Event with case-insensitive match should pass filter");
-    free(event.process);
     
     /* Should not match */
-    event.process = strdup("apache");
+    event.process = "apache";
     ASSERT(!filter_set_matches(set, &event), 
            "Event with non-matching process name should fail filter");
-    free(event.process);
     
     filter_set_destroy(set);
     
@@ -280,24 +281,21 @@ static int test_library_filter(void) {
     processed_event_t event = {0};
     
     /* Should match - library path */
-    event.library = strdup("/usr/lib/libssl.so.1.1");
+    event.library = "/usr/lib/libssl.so.1.1";
     ASSERT(filter_set_matches(set, &event), 
            "Event with matching library path should pass filter");
-    free(event.library);
     event.library = NULL;
     
     /* Should match - library name */
-    event.library_name = strdup("libssl");
+    event.library_name = "libssl";
     ASSERT(filter_set_matches(set, &event), 
            "Event with matching library name should pass filter");
-    free(event.library_name);
     event.library_name = NULL;
     
     /* Should not match */
-    event.library = strdup("/usr/lib/libcrypto.so");
+    event.library = "/usr/lib/libcrypto.so";
     ASSERT(!filter_set_matches(set, &event), 
            "Event with non-matching library should fail filter");
-    free(event.library);
     
     filter_set_destroy(set);
     
@@ -317,26 +315,22 @@ static int test_file_path_filter(void) {
     processed_event_t event = {0};
     
     /* Should match */
-    event.file = strdup("/etc/ssl/cert.pem");
+    event.file = "/etc/ssl/cert.pem";
     ASSERT(filter_set_matches(set, &event), 
            "Event with matching file path should pass filter");
-    free(event.file);
     
-    event.file = strdup("/etc/ssl/key.pem");
+    event.file = "/etc/ssl/key.pem";
     ASSERT(filter_set_matches(set, &event), 
            "Event with matching file path (different file) should pass filter");
-    free(event.file);
     
     /* Should not match */
-    event.file = strdup("/etc/ssl/cert.crt");
+    event.file = "/etc/ssl/cert.crt";
     ASSERT(!filter_set_matches(set, &event), 
            "Event with non-matching extension should fail filter");
-    free(event.file);
     
-    event.file = strdup("/var/ssl/cert.pem");
+    event.file = "/var/ssl/cert.pem";
     ASSERT(!filter_set_matches(set, &event), 
            "Event with non-matching directory should fail filter");
-    free(event.file);
     
     filter_set_destroy(set);
     
@@ -359,31 +353,27 @@ static int test_multiple_filters_and_logic(void) {
     
     /* Both filters match - should pass */
     event.pid = 1234;
-    event.process = strdup("nginx");
+    event.process = "nginx";
     ASSERT(filter_set_matches(set, &event), 
            "Event matching all filters should pass");
-    free(event.process);
     
     /* Only PID matches - should fail */
     event.pid = 1234;
-    event.process = strdup("apache");
+    event.process = "apache";
     ASSERT(!filter_set_matches(set, &event), 
            "Event matching only one filter should fail (AND logic)");
-    free(event.process);
     
     /* Only process name matches - should fail */
     event.pid = 5678;
-    event.process = strdup("nginx");
+    event.process = "nginx";
     ASSERT(!filter_set_matches(set, &event), 
            "Event matching only one filter should fail (AND logic, reversed)");
-    free(event.process);
     
     /* Neither matches - should fail */
     event.pid = 5678;
-    event.process = strdup("apache");
+    event.process = "apache";
     ASSERT(!filter_set_matches(set, &event), 
            "Event matching no filters should fail");
-    free(event.process);
     
     filter_set_destroy(set);
     
@@ -401,13 +391,85 @@ static int test_empty_filter_set(void) {
     /* Create test event */
     processed_event_t event = {0};
     event.pid = 1234;
-    event.process = strdup("nginx");
+    event.process = "nginx";
     
     /* Empty filter set should match everything */
     ASSERT(filter_set_matches(set, &event), 
            "Empty filter set should match any event");
     
-    free(event.process);
+    filter_set_destroy(set);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test compiled globs against fnmatch(FNM_PATHNAME)
+ */
+static int test_glob_matches_fnmatch(void) {
+    TEST("glob_matches_fnmatch");
+    
+    static const char *patterns[] = {
+        "*", "*.pem", "/etc/*", "/etc/*.pem", "/etc/*/*.pem", "/etc/ssl/*",
+        "/etc/s?l/*.p[ae]m", "/etc/ssl/[!c]*", "/etc/ssl/[^c]*", "*/ssl/*",
+        "/etc/ssl/cert.pem", "/etc/ssl/cert*", "/etc/ssl/**.pem", "/etc/[a-t]sl/*",
+        "/etc/ssl/\\*", "/etc/ssl/[", "/etc/ssl/[]]*", "/etc/[[:alpha:]]sl/*",
+        "/home/*/.ssh/id_*", "*a*b*c", "/etc/ssl/*.key", "",
+    };
+    static const char *strings[] = {
+        "/etc/ssl/cert.pem", "/etc/ssl/key.pem", "/etc/ssl/cert.crt", "/var/ssl/cert.pem",
+        "/etc/ssl/private/key.pem", "cert.pem", "/etc/sal/x.pam", "/etc/ssl/*",
+        "/etc/ssl/[", "/etc/ssl/]x", "/home/alice/.ssh/id_rsa", "xaybzc", "abc/xc",
+        "/etc/ssl/", "",
+    };
+    
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        for (size_t j = 0; j < sizeof(strings) / sizeof(strings[0]); j++) {
+            bool expected = fnmatch(patterns[i], strings[j], FNM_PATHNAME) == 0;
+            if (glob_match(patterns[i], strings[j]) != expected) {
+                printf("  pattern '%s', string '%s': expected %d\n",
+                       patterns[i], strings[j], expected);
+                ASSERT(false, "Compiled glob should agree with fnmatch");
+            }
+        }
+    }
+    
+    TEST_PASS();
+}
+
+/**
+ * Test pre-enrichment verdicts: a missing process name is undecided
+ */
+static int test_filter_verdicts(void) {
+    TEST("filter_verdicts");
+    
+    filter_set_t *set = filter_set_create();
+    int pid = 1234;
+    filter_set_add(set, FILTER_TYPE_PROCESS_NAME, "nginx");
+    filter_set_add(set, FILTER_TYPE_FILE_PATH, "/etc/ssl/*.pem");
+    filter_set_add(set, FILTER_TYPE_PID, &pid);
+    
+    processed_event_t event = {0};
+    event.pid = 1234;
+    event.file = "/etc/ssl/cert.pem";
+    
+    ASSERT(filter_set_evaluate(set, &event) == FILTER_UNDECIDED,
+           "Missing process name should leave the verdict open");
+    ASSERT(!filter_set_matches(set, &event),
+           "Missing process name should not match");
+    
+    event.process = "nginx-worker";
+    ASSERT(filter_set_evaluate(set, &event) == FILTER_MATCH, "All filters should match");
+    
+    event.process = NULL;
+    event.pid = 99;
+    ASSERT(filter_set_evaluate(set, &event) == FILTER_REJECT,
+           "A failed PID filter should reject without the process name");
+    
+    event.pid = 1234;
+    event.file = "/etc/ssl/cert.crt";
+    ASSERT(filter_set_evaluate(set, &event) == FILTER_REJECT,
+           "A failed path filter should reject without the process name");
+    
     filter_set_destroy(set);
     
     TEST_PASS();
@@ -469,6 +531,8 @@ int main(void) {
     /* Multiple filter tests */
     test_multiple_filters_and_logic();
     test_empty_filter_set();
+    test_glob_matches_fnmatch();
+    test_filter_verdicts();
     
     /* Event processor tests */
     test_event_processor_create();
@@ -478,6 +542,8 @@ int main(void) {
     test_enrich_executable_path();
     test_enrich_cmdline();
     test_enrich_event();
+    test_enrich_retained_event();
+    test_enrich_thread_exit();
     
     /* Classification tests */
     test_classify_crypto_file();
@@ -603,7 +669,7 @@ static int test_enrich_event(void) {
     
     /* Set up event with PID */
     event.pid = my_pid;
-    event.event_type = strdup("file_open");
+    event.event_type = "file_open";
     
     /* Enrich event */
     ASSERT(enrich_event(&event) == 0, 
@@ -616,9 +682,7 @@ static int test_enrich_event(void) {
            "Executable path should be enriched");
     
     /* Clean up */
-    free(event.event_type);
-    free(event.process);
-    free(event.exe);
+    processed_event_free_strings(&event);
     
     /* Test with invalid PID (should not crash) */
     memset(&event, 0, sizeof(event));
@@ -741,3 +805,118 @@ static int test_extract_library_name(void) {
     
     TEST_PASS();
 }
+
+/**
+ * Loader standing in for /proc: every process is "worker-<pid>"
+ */
+static void fake_proc_loader(pid_t pid, uint64_t start_time_ns, unsigned int flags,
+                             proc_cache_entry_t *entry, void *ctx) {
+    char buf[64];
+    
+    (void)start_time_ns;
+    (void)flags;
+    (void)ctx;
+    snprintf(buf, sizeof(buf), "worker-%d", (int)pid);
+    entry->comm = strdup(buf);
+    snprintf(buf, sizeof(buf), "/usr/bin/worker-%d", (int)pid);
+    entry->exe = strdup(buf);
+}
+
+/* Whether a string was copied into the event rather than borrowed */
+static bool event_holds_string(const processed_event_t *event, const char *str) {
+    return str >= event->inline_strings &&
+           str < event->inline_strings + sizeof(event->inline_strings);
+}
+
+/**
+ * Test that an event kept past a later lookup which evicts its cache slot
+ * still holds its enriched strings (events queued to the merge thread)
+ */
+static int test_enrich_retained_event(void) {
+    TEST("enrich_retained_event");
+    
+    cli_args_t args = {0};
+    processed_event_t kept = {0};
+    processed_event_t later = {0};
+    
+    event_processor_t *proc = event_processor_create(&args);
+    ASSERT(proc != NULL, "Event processor creation should succeed");
+    
+    /* One slot: the second process evicts the first */
+    proc_cache_destroy(proc->cache);
+    proc->cache = proc_cache_create(1);
+    ASSERT(proc->cache != NULL, "Cache creation should succeed");
+    proc_cache_set_loader(proc->cache, fake_proc_loader, NULL);
+    proc->copy_enrichment = true;
+    
+    processed_event_set_kind(&kept, EVENT_FILE_OPEN);
+    kept.pid = 100;
+    ASSERT(event_processor_enrich(proc, &kept) == 0, "Enrichment should succeed");
+    
+    processed_event_set_kind(&later, EVENT_FILE_OPEN);
+    later.pid = 200;
+    ASSERT(event_processor_enrich(proc, &later) == 0, "Enrichment should succeed");
+    ASSERT(later.exe && strcmp(later.exe, "/usr/bin/worker-200") == 0,
+           "Later event should be enriched");
+    
+    ASSERT(event_holds_string(&kept, kept.process) && event_holds_string(&kept, kept.exe),
+           "Kept event should hold copies of its strings");
+    ASSERT(kept.process && strcmp(kept.process, "worker-100") == 0,
+           "Kept process name should survive the eviction");
+    ASSERT(kept.exe && strcmp(kept.exe, "/usr/bin/worker-100") == 0,
+           "Kept executable path should survive the eviction");
+    
+    processed_event_free_strings(&kept);
+    processed_event_free_strings(&later);
+    event_processor_destroy(proc);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test that only the thread group leader's exit evicts a process from the
+ * cache; a worker thread exiting leaves it cached
+ */
+static int test_enrich_thread_exit(void) {
+    TEST("enrich_thread_exit");
+    
+    cli_args_t args = {0};
+    processed_event_t event = {0};
+    processed_event_t exit_event = {0};
+    proc_cache_stats_t stats;
+    
+    event_processor_t *proc = event_processor_create(&args);
+    ASSERT(proc != NULL, "Event processor creation should succeed");
+    ASSERT(proc->cache != NULL, "Event processor should have a cache");
+    proc_cache_set_loader(proc->cache, fake_proc_loader, NULL);
+    
+    processed_event_set_kind(&event, EVENT_FILE_OPEN);
+    event.pid = 300;
+    ASSERT(event_processor_enrich(proc, &event) == 0, "Enrichment should succeed");
+    
+    /* A worker thread exits */
+    processed_event_set_kind(&exit_event, EVENT_PROCESS_EXIT);
+    exit_event.pid = 300;
+    exit_event.tid = 305;
+    ASSERT(event_processor_enrich(proc, &exit_event) == 0, "Enrichment should succeed");
+    event.exe = NULL;
+    event.process = NULL;
+    ASSERT(event_processor_enrich(proc, &event) == 0, "Enrichment should succeed");
+    proc_cache_get_stats(proc->cache, &stats);
+    ASSERT(stats.misses == 1 && stats.invalidations == 0, "Thread exit should keep the entry");
+    
+    /* The leader exits */
+    exit_event.tid = 300;
+    exit_event.exe = NULL;
+    exit_event.process = NULL;
+    ASSERT(event_processor_enrich(proc, &exit_event) == 0, "Enrichment should succeed");
+    event.exe = NULL;
+    event.process = NULL;
+    ASSERT(event_processor_enrich(proc, &event) == 0, "Enrichment should succeed");
+    proc_cache_get_stats(proc->cache, &stats);
+    ASSERT(stats.misses == 2 && stats.invalidations == 1, "Leader exit should evict the entry");
+    
+    event_processor_destroy(proc);
+    
+    TEST_PASS();
+}
@@ -0,0 +1,357 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_exporter.c - Unit tests for the batched collector exporter
+ * Tests address parsing, that framed and compressed batches add up to what
+ * was written, that batches spooled while the collector is away reach it
+ * in order on the next run, and that the spool bound drops batches
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <dirent.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "../../src/include/exporter.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Writes just over half a block, so each one becomes a batch of its own */
+#define RECORD_SIZE (OUTPUT_SINK_BLOCK_SIZE / 2 + 4096)
+#define RECORD_COUNT 3
+
+static char spool_dir[64];
+
+/* A socket on a free loopback port; listening or just bound (refusing) */
+static int loopback_socket(bool listening, char *port, size_t size) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        (listening && listen(fd, 4) != 0) ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        return -1;
+    }
+    snprintf(port, size, "%u", ntohs(addr.sin_port));
+    return fd;
+}
+
+static uint32_t get_be32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+/**
+ * Accept the exporter's connection and decode every frame until it hangs
+ * up: the payloads, decompressed, one after the other
+ * @return Frames read, or -1 on a malformed frame
+ */
+static int collect(int listen_fd, char **out, size_t *out_len) {
+    struct pollfd pfd = { .fd = listen_fd, .events = POLLIN };
+    unsigned char header[EXPORT_FRAME_HEADER_SIZE];
+    FILE *stream = open_memstream(out, out_len);
+    int frames = 0;
+    int fd;
+    
+    if (poll(&pfd, 1, 5000) != 1 || (fd = accept(listen_fd, NULL, NULL)) < 0) {
+        fclose(stream);
+        return -1;
+    }
+    
+    while (recv(fd, header, sizeof(header), MSG_WAITALL) == (ssize_t)sizeof(header)) {
+        uint32_t raw_len = get_be32(header + 24), len = get_be32(header + 28);
+        unsigned char *payload = malloc(len), *raw = malloc(raw_len);
+        uLongf dest_len = raw_len;
+        z_stream zs = {0};
+        
+        if (memcmp(header, EXPORT_FRAME_MAGIC, 4) != 0 || header[4] != EXPORT_FRAME_VERSION ||
+            !(header[5] & EXPORT_FLAG_GZIP) || !payload || !raw ||
+            recv(fd, payload, len, MSG_WAITALL) != (ssize_t)len) {
+            frames = -1;
+        } else {
+            zs.next_in = payload;
+            zs.avail_in = len;
+            zs.next_out = raw;
+            zs.avail_out = (uInt)dest_len;
+            if (inflateInit2(&zs, 15 + 16) != Z_OK || inflate(&zs, Z_FINISH) != Z_STREAM_END ||
+                zs.total_out != raw_len) {
+                frames = -1;
+            }
+            inflateEnd(&zs);
+        }
+        if (frames >= 0) {
+            fwrite(raw, 1, raw_len, stream);
+            frames++;
+        }
+        free(payload);
+        free(raw);
+        if (frames < 0) {
+            break;
+        }
+    }
+    close(fd);
+    fclose(stream);
+    return frames;
+}
+
+/* Write RECORD_COUNT records of 'a' + first, 'a' + first + 1, ... */
+static int write_records(output_sink_t *sink, int first) {
+    char *record = malloc(RECORD_SIZE);
+    int ret = 0;
+    
+    if (!record) {
+        return -1;
+    }
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        memset(record, 'a' + first + i, RECORD_SIZE);
+        if (fwrite(record, 1, RECORD_SIZE, output_sink_stream(sink)) != RECORD_SIZE) {
+            ret = -1;
+        }
+    }
+    free(record);
+    return ret;
+}
+
+static bool records_in_order(const char *data, size_t len, int first, int count) {
+    if (len != (size_t)count * RECORD_SIZE) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (data[(size_t)i * RECORD_SIZE] != 'a' + first + i ||
+            data[(size_t)(i + 1) * RECORD_SIZE - 1] != 'a' + first + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Test: HOST:PORT and [IPV6]:PORT split, anything else is refused
+ */
+static int test_parse_address(void) {
+    TEST("test_parse_address");
+    
+    char host[64], port[8];
+    
+    ASSERT(exporter_parse_address("collector.example:4317", host, sizeof(host),
+                                  port, sizeof(port)) == 0 &&
+           strcmp(host, "collector.example") == 0 && strcmp(port, "4317") == 0, "Host name");
+    ASSERT(exporter_parse_address("[::1]:9000", host, sizeof(host), port, sizeof(port)) == 0 &&
+           strcmp(host, "::1") == 0 && strcmp(port, "9000") == 0, "IPv6");
+    ASSERT(exporter_parse_address("::1:9000", host, sizeof(host), port, sizeof(port)) != 0,
+           "Bare IPv6");
+    ASSERT(exporter_parse_address("collector", host, sizeof(host), port, sizeof(port)) != 0,
+           "No port");
+    ASSERT(exporter_parse_address(":9000", host, sizeof(host), port, sizeof(port)) != 0,
+           "No host");
+    ASSERT(exporter_parse_address("host:http", host, sizeof(host), port, sizeof(port)) != 0 &&
+           exporter_parse_address("host:70000", host, sizeof(host), port, sizeof(port)) != 0,
+           "Bad port");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Batches sent to a listening collector decode to what was written
+ */
+static int test_send(void) {
+    TEST("test_send");
+    
+    exporter_config_t config = { .host = "127.0.0.1", .gzip_level = 6 };
+    exporter_stats_t stats;
+    exporter_t *exporter;
+    output_sink_t *sink;
+    char port[8], *data = NULL;
+    size_t len = 0;
+    int listen_fd, frames;
+    
+    listen_fd = loopback_socket(true, port, sizeof(port));
+    ASSERT(listen_fd >= 0, "Listening socket");
+    config.port = port;
+    
+    exporter = exporter_create(&config);
+    ASSERT(exporter != NULL, "Create");
+    sink = output_sink_open_backend(&exporter_backend, exporter);
+    ASSERT(sink != NULL, "Open sink");
+    ASSERT(write_records(sink, 0) == 0, "Write");
+    ASSERT(output_sink_close(sink, NULL) == 0, "Close");
+    
+    exporter_get_stats(exporter, &stats);
+    ASSERT(stats.connects == 1 && stats.batches_sent >= RECORD_COUNT &&
+           stats.batches_spooled == 0 && stats.batches_dropped == 0, "Sent directly");
+    ASSERT(stats.bytes_sent * 100 < (uint64_t)RECORD_COUNT * RECORD_SIZE, "Compressed");
+    exporter_destroy(exporter);
+    
+    frames = collect(listen_fd, &data, &len);
+    ASSERT(frames == (int)stats.batches_sent, "Every batch framed");
+    ASSERT(records_in_order(data, len, 0, RECORD_COUNT), "Records in order");
+    free(data);
+    
+    close(listen_fd);
+    TEST_PASS();
+}
+
+/**
+ * Test: Batches spooled while the collector refuses connections are sent
+ * first, in order, by the next run
+ */
+static int test_spool_and_replay(void) {
+    TEST("test_spool_and_replay");
+    
+    exporter_config_t config = { .host = "127.0.0.1", .gzip_level = 1, .spool_dir = spool_dir };
+    exporter_stats_t stats;
+    exporter_t *exporter;
+    output_sink_t *sink;
+    char port[8], *data = NULL;
+    size_t len = 0;
+    int refusing_fd, listen_fd;
+    
+    refusing_fd = loopback_socket(false, port, sizeof(port));
+    ASSERT(refusing_fd >= 0, "Bound socket");
+    config.port = port;
+    
+    exporter = exporter_create(&config);
+    ASSERT(exporter != NULL, "Create");
+    sink = output_sink_open_backend(&exporter_backend, exporter);
+    ASSERT(sink != NULL, "Open sink");
+    ASSERT(write_records(sink, 0) == 0, "Write");
+    ASSERT(output_sink_close(sink, NULL) == 0, "Close");
+    exporter_get_stats(exporter, &stats);
+    ASSERT(stats.connects == 0 && stats.batches_sent == 0 && stats.batches_dropped == 0,
+           "Nothing sent");
+    ASSERT(stats.batches_spooled >= RECORD_COUNT && stats.spool_batches == stats.batches_spooled,
+           "Spooled");
+    exporter_destroy(exporter);
+    close(refusing_fd);
+    
+    /* Next run: the collector is up */
+    listen_fd = loopback_socket(true, port, sizeof(port));
+    ASSERT(listen_fd >= 0, "Listening socket");
+    exporter = exporter_create(&config);
+    ASSERT(exporter != NULL, "Create again");
+    exporter_get_stats(exporter, &stats);
+    ASSERT(stats.spool_batches >= RECORD_COUNT, "Earlier spool found");
+    sink = output_sink_open_backend(&exporter_backend, exporter);
+    ASSERT(sink != NULL, "Open sink again");
+    ASSERT(write_records(sink, RECORD_COUNT) == 0, "Write again");
+    ASSERT(output_sink_close(sink, NULL) == 0, "Close again");
+    exporter_get_stats(exporter, &stats);
+    ASSERT(stats.spool_batches == 0 && stats.spool_bytes == 0, "Spool emptied");
+    ASSERT(stats.batches_replayed >= RECORD_COUNT && stats.batches_dropped == 0, "Replayed");
+    exporter_destroy(exporter);
+    
+    ASSERT(collect(listen_fd, &data, &len) > 0, "Collected");
+    ASSERT(records_in_order(data, len, 0, 2 * RECORD_COUNT), "Both runs, in order");
+    free(data);
+    
+    close(listen_fd);
+    TEST_PASS();
+}
+
+/**
+ * Test: Batches that do not fit the spool are dropped and counted
+ */
+static int test_spool_bound(void) {
+    TEST("test_spool_bound");
+    
+    exporter_config_t config = { .host = "127.0.0.1", .spool_dir = spool_dir,
+                                 .spool_max_bytes = RECORD_SIZE + 2 * EXPORT_FRAME_HEADER_SIZE };
+    exporter_stats_t stats;
+    exporter_t *exporter;
+    output_sink_t *sink;
+    struct dirent *entry;
+    char port[8];
+    int refusing_fd, files = 0;
+    DIR *dir;
+    
+    refusing_fd = loopback_socket(false, port, sizeof(port));
+    ASSERT(refusing_fd >= 0, "Bound socket");
+    config.port = port;
+    
+    exporter = exporter_create(&config);
+    ASSERT(exporter != NULL, "Create");
+    sink = output_sink_open_backend(&exporter_backend, exporter);
+    ASSERT(sink != NULL, "Open sink");
+    ASSERT(write_records(sink, 0) == 0, "Write");
+    ASSERT(output_sink_close(sink, NULL) == 0, "Close");
+    exporter_get_stats(exporter, &stats);
+    ASSERT(stats.spool_batches == 1 && stats.spool_bytes <= config.spool_max_bytes,
+           "Spool bounded");
+    ASSERT(stats.batches_dropped == stats.batches_spooled - 1, "Oldest dropped");
+    exporter_destroy(exporter);
+    close(refusing_fd);
+    
+    dir = opendir(spool_dir);
+    ASSERT(dir != NULL, "Spool directory");
+    while ((entry = readdir(dir)) != NULL) {
+        char name[PATH_MAX];
+        
+        if (entry->d_name[0] != '.') {
+            snprintf(name, sizeof(name), "%s/%s", spool_dir, entry->d_name);
+            unlink(name);
+            files++;
+        }
+    }
+    closedir(dir);
+    ASSERT(files == 1, "One spool file");
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Exporter Unit Tests ===\n\n");
+    
+    snprintf(spool_dir, sizeof(spool_dir), "/tmp/test_exporter.%d", (int)getpid());
+    
+    test_parse_address();
+    test_send();
+    test_spool_and_replay();
+    test_spool_bound();
+    
+    rmdir(spool_dir);
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_handshake_latency.c - Unit tests for TLS handshake latency histograms
+ * Tests counts, merging, the mean and percentiles, and the JSON histogram
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../src/include/handshake_latency.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/**
+ * Test: Percentiles land on the upper bound of their bucket
+ */
+static int test_percentiles(void) {
+    TEST("test_percentiles");
+    
+    handshake_latency_t h = { 0 };
+    
+    ASSERT(handshake_latency_count(&h) == 0, "Empty");
+    ASSERT(handshake_latency_percentile_us(&h, 50) == 0, "No percentile when empty");
+    ASSERT(handshake_latency_mean_us(&h) == 0, "No mean when empty");
+    
+    /* 90 handshakes of 1-2ms (bucket 10), 10 of 64-128ms (bucket 16) */
+    h.buckets[10] = 90;
+    h.buckets[16] = 10;
+    h.total_ns = 90 * 1500000ULL + 10 * 100000000ULL;
+    
+    ASSERT(handshake_latency_count(&h) == 100, "Count");
+    ASSERT(handshake_latency_bucket_us(0) == 2 && handshake_latency_bucket_us(10) == 2048,
+           "Bucket bounds");
+    ASSERT(handshake_latency_percentile_us(&h, 0) == 2048, "Minimum");
+    ASSERT(handshake_latency_percentile_us(&h, 50) == 2048, "Median");
+    ASSERT(handshake_latency_percentile_us(&h, 90) == 2048, "p90 is the last fast one");
+    ASSERT(handshake_latency_percentile_us(&h, 99) == 131072, "p99");
+    ASSERT(handshake_latency_percentile_us(&h, 100) == 131072, "Maximum");
+    ASSERT(handshake_latency_mean_us(&h) == 11350, "Mean");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Merging adds buckets, errors and durations
+ */
+static int test_merge(void) {
+    TEST("test_merge");
+    
+    handshake_latency_t total = { 0 }, delta = { 0 };
+    
+    delta.buckets[3] = 2;
+    delta.errors = 1;
+    delta.total_ns = 20000;
+    handshake_latency_merge(&total, &delta);
+    handshake_latency_merge(&total, &delta);
+    
+    ASSERT(total.buckets[3] == 4 && handshake_latency_count(&total) == 4, "Buckets");
+    ASSERT(total.errors == 2 && total.total_ns == 40000, "Errors and durations");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: The JSON histogram lists the non-empty buckets in order
+ */
+static int test_format_histogram(void) {
+    TEST("test_format_histogram");
+    
+    handshake_latency_t h = { 0 };
+    char buf[HANDSHAKE_LATENCY_JSON_MAX];
+    
+    ASSERT(handshake_latency_format_histogram(&h, buf, sizeof(buf)) == 2 &&
+           strcmp(buf, "{}") == 0, "Empty");
+    
+    h.buckets[0] = 5;
+    h.buckets[10] = 3;
+    ASSERT(handshake_latency_format_histogram(&h, buf, sizeof(buf)) > 0 &&
+           strcmp(buf, "{\"2\": 5, \"2048\": 3}") == 0, "Buckets");
+    ASSERT(handshake_latency_format_histogram(&h, buf, 8) == -1, "Too small");
+    
+    for (int i = 0; i < HANDSHAKE_LATENCY_BUCKETS; i++) {
+        h.buckets[i] = UINT64_MAX;
+    }
+    ASSERT(handshake_latency_format_histogram(&h, buf, sizeof(buf)) > 0, "Largest fits");
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Handshake Latency Unit Tests ===\n\n");
+    
+    test_percentiles();
+    test_merge();
+    test_format_histogram();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -200,6 +200,156 @@ void test_verbose_mode(void) {
     PASS();
 }
 
+/**
+ * Read a log file back: number of lines, and a copy of line `want`
+ */
+static int read_lines(FILE *file, int want, char *line_out, size_t line_size) {
+    char line[4096];
+    int lines = 0;
+    
+    fflush(file);
+    rewind(file);
+    while (fgets(line, sizeof(line), file)) {
+        if (lines == want && line_out) {
+            snprintf(line_out, line_size, "%s", line);
+        }
+        lines++;
+    }
+    return lines;
+}
+
+static void log_to(FILE *file, log_format_t format) {
+    logger_config_t config = {
+        .min_level = LOG_LEVEL_INFO,
+        .quiet = false,
+        .verbose = false,
+        .output = file,
+        .format = format
+    };
+    logger_init(&config);
+}
+
+/**
+ * Test per-call-site rate limiting and the shutdown summary
+ */
+void test_ratelimit(void) {
+    TEST("ratelimit");
+    
+    FILE *file = tmpfile();
+    char line[4096];
+    int lines;
+    
+    if (!file) {
+        FAIL("tmpfile failed");
+        return;
+    }
+    log_to(file, LOG_FORMAT_TEXT);
+    
+    for (int i = 0; i < LOG_RATELIMIT_BURST + 25; i++) {
+        log_warn_ratelimited("Hot path warning %d", i);
+    }
+    lines = read_lines(file, LOG_RATELIMIT_BURST - 1, line, sizeof(line));
+    
+    if (lines != LOG_RATELIMIT_BURST) {
+        FAIL("Only the burst should be written");
+    } else if (strcmp(line, "[WARN] Hot path warning 9\n") != 0) {
+        FAIL("Unexpected rate-limited line");
+    } else {
+        logger_shutdown();
+        lines = read_lines(file, LOG_RATELIMIT_BURST, line, sizeof(line));
+        if (lines != LOG_RATELIMIT_BURST + 1 ||
+            strcmp(line, "[WARN] Hot path warning 9 (25 similar messages suppressed)\n") != 0) {
+            FAIL("Shutdown should report the suppressed count");
+        } else {
+            PASS();
+        }
+    }
+    
+    log_to(stderr, LOG_FORMAT_TEXT);
+    fclose(file);
+}
+
+/**
+ * Test JSON lines, escaping included
+ */
+void test_json_format(void) {
+    TEST("json_format");
+    
+    FILE *file = tmpfile();
+    char line[4096];
+    
+    if (!file) {
+        FAIL("tmpfile failed");
+        return;
+    }
+    log_to(file, LOG_FORMAT_JSON);
+    
+    log_warn("Path \"%s\"\tfailed\n", "/etc/ssl\\x");
+    log_error_with_suggestion("Load failed", "Run as root");
+    
+    read_lines(file, 0, line, sizeof(line));
+    const char *message = strstr(line, "\"level\":\"warn\",\"message\":");
+    if (strncmp(line, "{\"timestamp\":\"", 14) != 0 || !message ||
+        strcmp(message, "\"level\":\"warn\",\"message\":"
+               "\"Path \\\"/etc/ssl\\\\x\\\"\\tfailed\\n\"}\n") != 0) {
+        FAIL("Unexpected JSON warning line");
+    } else if (read_lines(file, 1, line, sizeof(line)) != 2 ||
+               !strstr(line, "\"message\":\"Load failed\",\"suggestion\":\"Run as root\"}")) {
+        FAIL("Suggestion should be a field of the same line");
+    } else {
+        PASS();
+    }
+    
+    log_to(stderr, LOG_FORMAT_TEXT);
+    fclose(file);
+}
+
+/**
+ * Test that async logging keeps every message, in order
+ */
+void test_async_order(void) {
+    TEST("async_order");
+    
+    FILE *file = tmpfile();
+    char line[4096];
+    char expected[64];
+    int ok = 1;
+    
+    if (!file) {
+        FAIL("tmpfile failed");
+        return;
+    }
+    log_to(file, LOG_FORMAT_TEXT);
+    
+    if (logger_start_async() != 0) {
+        FAIL("Failed to start the writer thread");
+        fclose(file);
+        return;
+    }
+    
+    /* Fewer than the queue holds, so nothing may be dropped */
+    for (int i = 0; i < 200; i++) {
+        log_info("Queued message %d", i);
+    }
+    logger_flush();
+    logger_shutdown();
+    
+    for (int i = 0; i < 200 && ok; i++) {
+        snprintf(expected, sizeof(expected), "[INFO] Queued message %d\n", i);
+        read_lines(file, i, line, sizeof(line));
+        ok = strcmp(line, expected) == 0;
+    }
+    
+    if (read_lines(file, 0, NULL, 0) != 200 || !ok || logger_dropped() != 0) {
+        FAIL("Queued messages lost or reordered");
+    } else {
+        PASS();
+    }
+    
+    log_to(stderr, LOG_FORMAT_TEXT);
+    fclose(file);
+}
+
 int main(void) {
     printf("=== Logger Unit Tests ===\n\n");
     
@@ -214,6 +364,9 @@ int main(void) {
     test_system_error();
     test_quiet_mode_suppression();
     test_verbose_mode();
+    test_ratelimit();
+    test_json_format();
+    test_async_order();
     
     /* Print summary */
     printf("\n=== Test Summary ===\n");
@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_output_sink.c - Unit tests for the asynchronous output sink
+ * Tests that everything written reaches the file, that rotation neither
+ * splits writes nor overwrites the files of an earlier run, and that
+ * gzip output decompresses to what was written
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "../../src/include/output_sink.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Writes just over half a block, so each one queues the block before it */
+#define RECORD_SIZE (OUTPUT_SINK_BLOCK_SIZE / 2 + 4096)
+#define RECORD_COUNT 6
+
+static char base[64];
+
+static char *read_file(const char *path, size_t *len) {
+    FILE *fp = fopen(path, "r");
+    char *data = NULL;
+    long size;
+    
+    if (!fp) {
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        data = malloc((size_t)size + 1);
+        if (data && fread(data, 1, (size_t)size, fp) != (size_t)size) {
+            free(data);
+            data = NULL;
+        }
+        *len = (size_t)size;
+    }
+    fclose(fp);
+    return data;
+}
+
+/**
+ * Test: Small writes are gathered and all reach the file on close
+ */
+static int test_write_and_close(void) {
+    TEST("test_write_and_close");
+    
+    output_sink_config_t config = { .path = base };
+    output_sink_stats_t stats;
+    output_sink_t *sink;
+    char expected[32];
+    char *data;
+    size_t len = 0;
+    FILE *fp;
+    
+    sink = output_sink_open(&config);
+    ASSERT(sink != NULL, "Open");
+    fp = output_sink_stream(sink);
+    for (int i = 0; i < 10000; i++) {
+        ASSERT(fprintf(fp, "{\"event\": %d}\n", i) > 0, "Write");
+    }
+    ASSERT(output_sink_close(sink, &stats) == 0, "Close");
+    
+    data = read_file(base, &len);
+    ASSERT(data != NULL, "Read back");
+    ASSERT(stats.bytes_in == len && stats.bytes_out == len, "Stats");
+    ASSERT(strncmp(data, "{\"event\": 0}\n", 13) == 0, "First line");
+    snprintf(expected, sizeof(expected), "{\"event\": %d}\n", 9999);
+    ASSERT(len > strlen(expected) && strcmp(data + len - strlen(expected), expected) == 0,
+           "Last line");
+    free(data);
+    
+    config.path = "/nonexistent-dir/out.json";
+    ASSERT(output_sink_open(&config) == NULL, "Unwritable path");
+    
+    unlink(base);
+    TEST_PASS();
+}
+
+/**
+ * Test: Rotated files hold whole writes, in order, after the files an
+ * earlier run left
+ */
+static int test_rotation(void) {
+    TEST("test_rotation");
+    
+    output_sink_config_t config = { .path = base, .rotate_bytes = 1 };
+    output_sink_stats_t stats;
+    output_sink_t *sink;
+    char name[96], *record, *data;
+    size_t len, total = 0;
+    unsigned int files = 2;
+    int next = 0;
+    FILE *fp;
+    
+    snprintf(name, sizeof(name), "%s.1", base);
+    fp = fopen(name, "w");
+    ASSERT(fp != NULL, "Earlier run's file");
+    fputs("old\n", fp);
+    fclose(fp);
+    
+    record = malloc(RECORD_SIZE);
+    ASSERT(record != NULL, "malloc");
+    sink = output_sink_open(&config);
+    ASSERT(sink != NULL, "Open");
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        memset(record, 'a' + i, RECORD_SIZE);
+        ASSERT(fwrite(record, 1, RECORD_SIZE, output_sink_stream(sink)) == RECORD_SIZE, "Write");
+    }
+    ASSERT(output_sink_close(sink, &stats) == 0, "Close");
+    snprintf(name, sizeof(name), "%s.2", base);
+    ASSERT(access(name, F_OK) == 0, "Rotated at least once");
+    while (access(name, F_OK) == 0) {
+        snprintf(name, sizeof(name), "%s.%u", base, ++files);
+    }
+    
+    snprintf(name, sizeof(name), "%s.1", base);
+    data = read_file(name, &len);
+    ASSERT(data && len == 4 && memcmp(data, "old\n", 4) == 0, "Earlier file kept");
+    free(data);
+    
+    /* .2, .3, ... then the current file: every record once, in order */
+    for (unsigned int seq = 2; seq <= files; seq++) {
+        if (seq < files) {
+            snprintf(name, sizeof(name), "%s.%u", base, seq);
+        } else {
+            snprintf(name, sizeof(name), "%s", base);
+        }
+        data = read_file(name, &len);
+        ASSERT(data != NULL, "Rotated file");
+        ASSERT(len % RECORD_SIZE == 0, "Whole writes only");
+        for (size_t off = 0; off < len; off += RECORD_SIZE) {
+            ASSERT(data[off] == 'a' + next && data[off + RECORD_SIZE - 1] == 'a' + next,
+                   "Records in order");
+            next++;
+        }
+        total += len;
+        free(data);
+        unlink(name);
+    }
+    ASSERT(next == RECORD_COUNT && total == stats.bytes_in, "Every record once");
+    
+    snprintf(name, sizeof(name), "%s.1", base);
+    unlink(name);
+    free(record);
+    TEST_PASS();
+}
+
+/**
+ * Test: gzip output decompresses to what was written
+ */
+static int test_gzip(void) {
+    TEST("test_gzip");
+    
+    output_sink_config_t config = { .path = base, .gzip_level = 6 };
+    output_sink_stats_t stats;
+    output_sink_t *sink;
+    char line[64], buf[64];
+    gzFile gz;
+    
+    sink = output_sink_open(&config);
+    ASSERT(sink != NULL, "Open");
+    for (int i = 0; i < 50000; i++) {
+        fprintf(output_sink_stream(sink), "{\"event_type\": \"file_open\", \"n\": %d}\n", i);
+    }
+    ASSERT(output_sink_close(sink, &stats) == 0, "Close");
+    ASSERT(stats.bytes_out > 0 && stats.bytes_out * 5 < stats.bytes_in, "Compressed");
+    
+    gz = gzopen(base, "r");
+    ASSERT(gz != NULL, "gzopen");
+    for (int i = 0; i < 50000; i++) {
+        snprintf(line, sizeof(line), "{\"event_type\": \"file_open\", \"n\": %d}\n", i);
+        ASSERT(gzgets(gz, buf, sizeof(buf)) != NULL && strcmp(buf, line) == 0, "Line");
+    }
+    ASSERT(gzgets(gz, buf, sizeof(buf)) == NULL, "Nothing more");
+    gzclose(gz);
+    
+    unlink(base);
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Output Sink Unit Tests ===\n\n");
+    
+    snprintf(base, sizeof(base), "/tmp/test_output_sink.%d", (int)getpid());
+    
+    test_write_and_close();
+    test_rotation();
+    test_gzip();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_path_intern.c - Unit tests for the interned path table
+ * Tests deduplication, id assignment and table growth
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../src/include/path_intern.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/**
+ * Test: Equal paths share one id and one copy
+ */
+static int test_dedupe(void) {
+    TEST("test_dedupe");
+    
+    path_intern_t *table = path_intern_create();
+    ASSERT(table != NULL, "Failed to create table");
+    
+    char path[] = "/usr/lib/x86_64-linux-gnu/libcrypto.so.3";
+    const char *first = NULL;
+    const char *second = NULL;
+    uint32_t a = path_intern_add(table, path, &first);
+    uint32_t b = path_intern_add(table, "/usr/lib/x86_64-linux-gnu/libssl.so.3", NULL);
+    uint32_t c = path_intern_add(table, "/usr/lib/x86_64-linux-gnu/libcrypto.so.3", &second);
+    
+    ASSERT(a == 0 && b == 1, "Ids should be dense in insertion order");
+    ASSERT(c == a, "Equal paths should share an id");
+    ASSERT(first == second && first != path, "Equal paths should share the table's copy");
+    path[0] = 'X';
+    ASSERT(strcmp(path_intern_get(table, a), "/usr/lib/x86_64-linux-gnu/libcrypto.so.3") == 0,
+           "Interned copy changed with the source");
+    ASSERT(path_intern_count(table) == 2, "Count should be 2");
+    ASSERT(path_intern_get(table, 2) == NULL, "Out of range id should return NULL");
+    ASSERT(path_intern_add(table, NULL, NULL) == PATH_INTERN_INVALID, "NULL path should fail");
+    ASSERT(path_intern_find(table, "/usr/lib/x86_64-linux-gnu/libssl.so.3") == b,
+           "find should return the existing id");
+    ASSERT(path_intern_find(table, "/usr/lib/libgnutls.so.30") == PATH_INTERN_INVALID &&
+           path_intern_count(table) == 2, "find should not intern a missing path");
+    
+    path_intern_destroy(table);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Ids and strings survive the table growing
+ */
+static int test_growth(void) {
+    TEST("test_growth");
+    
+    path_intern_t *table = path_intern_create();
+    ASSERT(table != NULL, "Failed to create table");
+    
+    char path[64];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(path, sizeof(path), "/opt/lib%d/libssl.so", i);
+        ASSERT(path_intern_add(table, path, NULL) == (uint32_t)i, "Unexpected id");
+    }
+    ASSERT(path_intern_count(table) == 1000, "Count should be 1000");
+    
+    for (int i = 0; i < 1000; i++) {
+        snprintf(path, sizeof(path), "/opt/lib%d/libssl.so", i);
+        ASSERT(path_intern_add(table, path, NULL) == (uint32_t)i, "Id changed after growth");
+        ASSERT(strcmp(path_intern_get(table, (uint32_t)i), path) == 0, "Path changed after growth");
+    }
+    ASSERT(path_intern_count(table) == 1000, "Lookups should not add entries");
+    
+    path_intern_destroy(table);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Path Intern Unit Tests ===\n\n");
+    
+    test_dedupe();
+    test_growth();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_pipeline_stats.c - Unit tests for the pipeline stage histograms
+ * Tests that timing stays off until enabled, and the counts, sums and
+ * percentiles of a stage snapshot
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "../../src/include/pipeline_stats.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/**
+ * Test: Nothing is recorded before pipeline_stats_enable()
+ */
+static int test_disabled_by_default(void) {
+    TEST("test_disabled_by_default");
+    
+    stage_snapshot_t snap;
+    
+    ASSERT(!pipeline_stats_enabled, "Timing should start off");
+    ASSERT(stage_begin() == 0, "stage_begin() should return 0 while off");
+    stage_end(STAGE_DECODE, stage_begin());
+    
+    ASSERT(pipeline_stats_snapshot(STAGE_DECODE, &snap) == 0, "Snapshot should succeed");
+    ASSERT(snap.count == 0, "No durations should be recorded while off");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Counts, ordering of percentiles and the maximum
+ */
+static int test_snapshot_percentiles(void) {
+    TEST("test_snapshot_percentiles");
+    
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 5000000 };
+    stage_snapshot_t snap;
+    
+    pipeline_stats_enable();
+    /* Give the tick rate measurement something to go on */
+    nanosleep(&pause, NULL);
+    
+    for (int i = 0; i < 990; i++) {
+        pipeline_stats_record(STAGE_ENRICH, 100);
+    }
+    for (int i = 0; i < 10; i++) {
+        pipeline_stats_record(STAGE_ENRICH, 1000000);
+    }
+    
+    ASSERT(pipeline_stats_snapshot(STAGE_ENRICH, &snap) == 0, "Snapshot should succeed");
+    ASSERT(snap.count == 1000, "Every duration should be counted");
+    ASSERT(snap.p50_ns == snap.p90_ns && snap.p90_ns == snap.p99_ns,
+           "p50 to p99 should share the bucket of the common duration");
+    ASSERT(snap.p999_ns > snap.p99_ns * 1000, "p99.9 should land in the slow bucket");
+    ASSERT(snap.p999_ns <= snap.max_ns, "No percentile should exceed the maximum");
+    ASSERT(snap.sum_ns >= snap.max_ns * 10, "Sum should include every slow duration");
+    
+    /* 100 ticks fall in [96, 112): the bound is within 25% of the value */
+    ASSERT(snap.p99_ns * 8000 < snap.max_ns && snap.p99_ns * 10000 > snap.max_ns,
+           "Bucket bound should be close to the durations in it");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Stages are kept apart and recorded through stage_begin/stage_end
+ */
+static int test_stage_begin_end(void) {
+    TEST("test_stage_begin_end");
+    
+    stage_snapshot_t snap;
+    uint64_t begin;
+    
+    begin = stage_begin();
+    ASSERT(begin != 0, "stage_begin() should return a tick count once enabled");
+    stage_end(STAGE_WRITE, begin);
+    
+    ASSERT(pipeline_stats_snapshot(STAGE_WRITE, &snap) == 0 && snap.count == 1,
+           "One write should be recorded");
+    ASSERT(pipeline_stats_snapshot(STAGE_FORMAT, &snap) == 0 && snap.count == 0,
+           "Other stages should be untouched");
+    
+    ASSERT(pipeline_stats_snapshot(STAGE_COUNT, &snap) != 0, "Invalid stage should be rejected");
+    ASSERT(pipeline_stats_snapshot(STAGE_DRAIN, NULL) != 0, "NULL snapshot should be rejected");
+    ASSERT(strcmp(pipeline_stage_name(STAGE_CLASSIFY), "classify") == 0, "Wrong stage name");
+    ASSERT(strcmp(pipeline_stage_name(STAGE_COUNT), "unknown") == 0, "Invalid stage name");
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Pipeline Stats Unit Tests ===\n\n");
+    
+    test_disabled_by_default();
+    test_snapshot_percentiles();
+    test_stage_begin_end();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -306,6 +306,60 @@ void test_multiple_path_components(void) {
     TEST_PASS();
 }
 
+/**
+ * Test: Redaction as a view into the original path
+ * The suffix must point into the caller's string, and unchanged paths
+ * must report no redaction at all
+ */
+void test_redaction_view(void) {
+    TEST("test_redaction_view");
+    
+    const char *path = "/home/alice/.ssh/id_rsa";
+    const char *system_path = "/usr/lib/libssl.so.3";
+    char buf[REDACTED_PATH_MAX];
+    redacted_path_t view;
+    
+    if (!privacy_redact_path(path, true, &view) || view.suffix != path + 11 ||
+        view.prefix_len != strlen("/home/USER") ||
+        strncmp(view.prefix, "/home/USER", view.prefix_len) != 0) {
+        printf("  FAILED: Expected /home/USER + suffix view of the original\n");
+        tests_failed++;
+        return;
+    }
+    
+    if (!privacy_redact_path("/root", true, &view) || view.suffix[0] != '\0') {
+        printf("  FAILED: Expected /root to be redacted to the bare prefix\n");
+        tests_failed++;
+        return;
+    }
+    
+    if (privacy_redact_path("/rootfs/etc/ssl/key.pem", true, &view) ||
+        privacy_redact_path("/etc/ssl/certs/ca.pem", true, &view) ||
+        privacy_redact_path("relative/home/alice", true, &view) ||
+        privacy_redact_path(path, false, &view) ||
+        privacy_redact_path(NULL, true, &view)) {
+        printf("  FAILED: Expected no redaction\n");
+        tests_failed++;
+        return;
+    }
+    
+    /* Caller buffer form: unchanged paths come back as is */
+    if (privacy_redact_path_into(system_path, true, buf, sizeof(buf)) != system_path) {
+        printf("  FAILED: Expected the unchanged path itself\n");
+        tests_failed++;
+        return;
+    }
+    ASSERT_STR_EQ(privacy_redact_path_into(path, true, buf, sizeof(buf)), "/home/USER/.ssh/id_rsa");
+    
+    if (privacy_redact_path_into(path, true, buf, 8) != NULL) {
+        printf("  FAILED: Expected a short buffer to be rejected\n");
+        tests_failed++;
+        return;
+    }
+    
+    TEST_PASS();
+}
+
 /**
  * Main test runner
  */
@@ -321,6 +375,7 @@ int main(void) {
     test_null_input_handling();
     test_edge_cases();
     test_multiple_path_components();
+    test_redaction_view();
     
     /* Print summary */
     printf("\n=== Test Summary ===\n");
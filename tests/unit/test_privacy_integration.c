@@ -16,6 +16,7 @@
 #include <string.h>
 #include <assert.h>
 #include "../../src/include/event_processor.h"
+#include "../../src/include/output_formatter.h"
 #include "../../src/include/crypto_tracer.h"
 
 /* Test counter */
@@ -46,12 +47,45 @@ static int tests_failed = 0;
         } \
     } while (0)
 
+#define ASSERT_CONTAINS(haystack, needle) \
+    do { \
+        if (!(haystack) || !strstr(haystack, needle)) { \
+            printf("  FAILED: Expected '%s' in '%s'\n", needle, haystack ? haystack : "(null)"); \
+            tests_failed++; \
+            return; \
+        } \
+    } while (0)
+
 #define TEST_PASS() \
     do { \
         printf("  PASSED\n"); \
         tests_passed++; \
     } while (0)
 
+/**
+ * Write an event as one json-stream line (caller must free)
+ * Redaction is applied as the paths are written, not to the event; the
+ * writer escapes '/' as '\/' 
+ */
+static char *write_event_json(processed_event_t *event) {
+    output_formatter_t *fmt;
+    char *text = NULL;
+    size_t len = 0;
+    FILE *fp;
+    
+    fp = open_memstream(&text, &len);
+    if (!fp) {
+        return NULL;
+    }
+    fmt = output_formatter_create(FORMAT_JSON_STREAM, fp);
+    if (fmt) {
+        output_formatter_write_event(fmt, event);
+        output_formatter_destroy(fmt);
+    }
+    fclose(fp);
+    return text;
+}
+
 /**
  * Test: Privacy filter integration with file events
  */
@@ -60,9 +94,9 @@ void test_privacy_filter_file_event(void) {
     
     /* Create a mock event with home directory path */
     processed_event_t event = {0};
-    event.event_type = strdup("file_open");
-    event.file = strdup("/home/alice/documents/cert.pem");
-    event.exe = strdup("/home/alice/bin/myapp");
+    event.event_type = "file_open";
+    event.file = "/home/alice/documents/cert.pem";
+    event.exe = "/home/alice/bin/myapp";
     event.pid = 1234;
     event.uid = 1000;
     
@@ -70,17 +104,16 @@ void test_privacy_filter_file_event(void) {
     int result = apply_privacy_filter(&event, true);
     assert(result == 0);
     
-    /* Verify paths are redacted */
-    ASSERT_NOT_NULL(event.file);
-    ASSERT_STR_EQ(event.file, "/home/USER/documents/cert.pem");
+    /* Verify paths are redacted in the output, not in the event */
+    char *json = write_event_json(&event);
+    ASSERT_CONTAINS(json, "\"file\":\"\\/home\\/USER\\/documents\\/cert.pem\"");
     
-    ASSERT_NOT_NULL(event.exe);
-    ASSERT_STR_EQ(event.exe, "/home/USER/bin/myapp");
+    ASSERT_CONTAINS(json, "\"exe\":\"\\/home\\/USER\\/bin\\/myapp\"");
+    ASSERT_STR_EQ(event.file, "/home/alice/documents/cert.pem");
     
     /* Cleanup */
-    free(event.event_type);
-    free(event.file);
-    free(event.exe);
+    free(json);
+    processed_event_free_strings(&event);
     
     TEST_PASS();
 }
@@ -93,9 +126,9 @@ void test_privacy_filter_library_event(void) {
     
     /* Create a mock event with root directory path */
     processed_event_t event = {0};
-    event.event_type = strdup("lib_load");
-    event.library = strdup("/root/custom-libs/libcrypto.so");
-    event.exe = strdup("/root/bin/server");
+    event.event_type = "lib_load";
+    event.library = "/root/custom-libs/libcrypto.so";
+    event.exe = "/root/bin/server";
     event.pid = 5678;
     event.uid = 0;
     
@@ -103,17 +136,15 @@ void test_privacy_filter_library_event(void) {
     int result = apply_privacy_filter(&event, true);
     assert(result == 0);
     
-    /* Verify paths are redacted */
-    ASSERT_NOT_NULL(event.library);
-    ASSERT_STR_EQ(event.library, "/home/ROOT/custom-libs/libcrypto.so");
+    /* Verify paths are redacted in the output, not in the event */
+    char *json = write_event_json(&event);
+    ASSERT_CONTAINS(json, "\"library\":\"\\/home\\/ROOT\\/custom-libs\\/libcrypto.so\"");
     
-    ASSERT_NOT_NULL(event.exe);
-    ASSERT_STR_EQ(event.exe, "/home/ROOT/bin/server");
+    ASSERT_CONTAINS(json, "\"exe\":\"\\/home\\/ROOT\\/bin\\/server\"");
     
     /* Cleanup */
-    free(event.event_type);
-    free(event.library);
-    free(event.exe);
+    free(json);
+    processed_event_free_strings(&event);
     
     TEST_PASS();
 }
@@ -126,9 +157,9 @@ void test_privacy_filter_system_paths(void) {
     
     /* Create a mock event with system paths */
     processed_event_t event = {0};
-    event.event_type = strdup("file_open");
-    event.file = strdup("/etc/ssl/certs/ca-certificates.crt");
-    event.exe = strdup("/usr/bin/openssl");
+    event.event_type = "file_open";
+    event.file = "/etc/ssl/certs/ca-certificates.crt";
+    event.exe = "/usr/bin/openssl";
     event.pid = 9999;
     event.uid = 0;
     
@@ -137,16 +168,14 @@ void test_privacy_filter_system_paths(void) {
     assert(result == 0);
     
     /* Verify system paths are preserved */
-    ASSERT_NOT_NULL(event.file);
-    ASSERT_STR_EQ(event.file, "/etc/ssl/certs/ca-certificates.crt");
+    char *json = write_event_json(&event);
+    ASSERT_CONTAINS(json, "\"file\":\"\\/etc\\/ssl\\/certs\\/ca-certificates.crt\"");
     
-    ASSERT_NOT_NULL(event.exe);
-    ASSERT_STR_EQ(event.exe, "/usr/bin/openssl");
+    ASSERT_CONTAINS(json, "\"exe\":\"\\/usr\\/bin\\/openssl\"");
     
     /* Cleanup */
-    free(event.event_type);
-    free(event.file);
-    free(event.exe);
+    free(json);
+    processed_event_free_strings(&event);
     
     TEST_PASS();
 }
@@ -159,9 +188,9 @@ void test_privacy_filter_disabled(void) {
     
     /* Create a mock event with home directory path */
     processed_event_t event = {0};
-    event.event_type = strdup("file_open");
-    event.file = strdup("/home/bob/secrets/private.key");
-    event.exe = strdup("/home/bob/app");
+    event.event_type = "file_open";
+    event.file = "/home/bob/secrets/private.key";
+    event.exe = "/home/bob/app";
     event.pid = 1111;
     event.uid = 1001;
     
@@ -170,16 +199,14 @@ void test_privacy_filter_disabled(void) {
     assert(result == 0);
     
     /* Verify paths are NOT redacted */
-    ASSERT_NOT_NULL(event.file);
-    ASSERT_STR_EQ(event.file, "/home/bob/secrets/private.key");
+    char *json = write_event_json(&event);
+    ASSERT_CONTAINS(json, "\"file\":\"\\/home\\/bob\\/secrets\\/private.key\"");
     
-    ASSERT_NOT_NULL(event.exe);
-    ASSERT_STR_EQ(event.exe, "/home/bob/app");
+    ASSERT_CONTAINS(json, "\"exe\":\"\\/home\\/bob\\/app\"");
     
     /* Cleanup */
-    free(event.event_type);
-    free(event.file);
-    free(event.exe);
+    free(json);
+    processed_event_free_strings(&event);
     
     TEST_PASS();
 }
@@ -192,9 +219,9 @@ void test_privacy_filter_cmdline(void) {
     
     /* Create a mock event with command line */
     processed_event_t event = {0};
-    event.event_type = strdup("process_exec");
-    event.cmdline = strdup("openssl s_client -connect example.com:443");
-    event.exe = strdup("/usr/bin/openssl");
+    event.event_type = "process_exec";
+    event.cmdline = "openssl s_client -connect example.com:443";
+    event.exe = "/usr/bin/openssl";
     event.pid = 2222;
     event.uid = 1000;
     
@@ -207,9 +234,7 @@ void test_privacy_filter_cmdline(void) {
     ASSERT_STR_EQ(event.cmdline, "openssl s_client -connect example.com:443");
     
     /* Cleanup */
-    free(event.event_type);
-    free(event.cmdline);
-    free(event.exe);
+    processed_event_free_strings(&event);
     
     TEST_PASS();
 }
@@ -222,7 +247,7 @@ void test_privacy_filter_null_fields(void) {
     
     /* Create a mock event with some NULL fields */
     processed_event_t event = {0};
-    event.event_type = strdup("process_exit");
+    event.event_type = "process_exit";
     event.file = NULL;
     event.library = NULL;
     event.exe = NULL;
@@ -241,7 +266,7 @@ void test_privacy_filter_null_fields(void) {
     assert(event.cmdline == NULL);
     
     /* Cleanup */
-    free(event.event_type);
+    processed_event_free_strings(&event);
     
     TEST_PASS();
 }
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_proc_cache.c - Unit tests for the /proc enrichment cache
+ * Tests hits, PID reuse detection, exec/exit invalidation and eviction
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../../src/include/crypto_tracer.h"
+#include "../../src/include/event_processor.h"
+#include "../../src/include/proc_cache.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Arbitrary start time used as the cache key */
+#define TEST_START_TIME 12345ULL
+
+/**
+ * Test that a second lookup is served from the cache
+ */
+static int test_lookup_hit(void) {
+    TEST("proc_cache_lookup_hit");
+    
+    proc_cache_t *cache = proc_cache_create(8);
+    const proc_cache_entry_t *entry;
+    proc_cache_stats_t stats;
+    pid_t my_pid = getpid();
+    
+    ASSERT(cache != NULL, "Cache creation should succeed");
+    
+    entry = proc_cache_lookup(cache, my_pid, TEST_START_TIME, 0);
+    ASSERT(entry != NULL && entry->comm != NULL, "First lookup should read /proc");
+    ASSERT(entry->exe != NULL, "Executable path should be cached");
+    ASSERT(entry->cmdline == NULL, "Cmdline should not be read unless requested");
+    
+    entry = proc_cache_lookup(cache, my_pid, TEST_START_TIME, 0);
+    ASSERT(entry != NULL && entry->comm != NULL, "Second lookup should return the entry");
+    
+    entry = proc_cache_lookup(cache, my_pid, TEST_START_TIME, PROC_CACHE_NEED_CMDLINE);
+    ASSERT(entry != NULL && entry->cmdline != NULL, "Cmdline should be loaded on demand");
+    
+    proc_cache_get_stats(cache, &stats);
+    ASSERT(stats.hits == 1, "One lookup should hit");
+    ASSERT(stats.misses == 2, "First lookup and cmdline load should miss");
+    ASSERT(stats.entries == 1, "One entry should be cached");
+    
+    proc_cache_destroy(cache);
+    TEST_PASS();
+}
+
+/**
+ * Test that a different start time (PID reuse) or exec reloads the entry
+ */
+static int test_lookup_invalidation(void) {
+    TEST("proc_cache_lookup_invalidation");
+    
+    proc_cache_t *cache = proc_cache_create(8);
+    proc_cache_stats_t stats;
+    pid_t my_pid = getpid();
+    
+    ASSERT(cache != NULL, "Cache creation should succeed");
+    
+    proc_cache_lookup(cache, my_pid, TEST_START_TIME, 0);
+    ASSERT(proc_cache_lookup(cache, my_pid, TEST_START_TIME + 1, 0) != NULL,
+           "Lookup with new start time should succeed");
+    ASSERT(proc_cache_lookup(cache, my_pid, TEST_START_TIME + 1, PROC_CACHE_REFRESH) != NULL,
+           "Refresh lookup should succeed");
+    
+    proc_cache_get_stats(cache, &stats);
+    ASSERT(stats.hits == 0, "Stale entries should never hit");
+    ASSERT(stats.misses == 3, "Every lookup should read /proc");
+    ASSERT(stats.invalidations == 2, "Both reloads should count as invalidations");
+    ASSERT(stats.entries == 1, "The entry should be reused in place");
+    
+    proc_cache_destroy(cache);
+    TEST_PASS();
+}
+
+/**
+ * Test that an exited process is dropped after its last event
+ */
+static int test_last_use(void) {
+    TEST("proc_cache_last_use");
+    
+    proc_cache_t *cache = proc_cache_create(8);
+    const proc_cache_entry_t *entry;
+    proc_cache_stats_t stats;
+    pid_t my_pid = getpid();
+    
+    ASSERT(cache != NULL, "Cache creation should succeed");
+    
+    proc_cache_lookup(cache, my_pid, TEST_START_TIME, 0);
+    entry = proc_cache_lookup(cache, my_pid, TEST_START_TIME, PROC_CACHE_LAST_USE);
+    ASSERT(entry != NULL && entry->comm != NULL,
+           "Last use should still return the cached entry");
+    
+    proc_cache_get_stats(cache, &stats);
+    ASSERT(stats.hits == 1, "Last use should hit");
+    
+    proc_cache_lookup(cache, my_pid, TEST_START_TIME, 0);
+    proc_cache_get_stats(cache, &stats);
+    ASSERT(stats.misses == 2, "Entry should be gone after last use");
+    
+    proc_cache_invalidate(cache, my_pid);
+    proc_cache_get_stats(cache, &stats);
+    ASSERT(stats.entries == 0, "Invalidate should drop the entry");
+    
+    proc_cache_destroy(cache);
+    TEST_PASS();
+}
+
+/**
+ * Test that a full cache evicts instead of growing
+ */
+static int test_capacity_eviction(void) {
+    TEST("proc_cache_capacity_eviction");
+    
+    proc_cache_t *cache = proc_cache_create(2);
+    proc_cache_stats_t stats;
+    pid_t my_pid = getpid();
+    pid_t parent_pid = getppid();
+    
+    ASSERT(cache != NULL, "Cache creation should succeed");
+    
+    /* Missing processes are cached too, so any PID works as a key */
+    proc_cache_lookup(cache, my_pid, TEST_START_TIME, 0);
+    proc_cache_lookup(cache, parent_pid, TEST_START_TIME, 0);
+    ASSERT(proc_cache_lookup(cache, 999999, TEST_START_TIME, 0) != NULL,
+           "Lookup in a full cache should evict and succeed");
+    
+    proc_cache_get_stats(cache, &stats);
+    ASSERT(stats.evictions == 1, "One entry should be evicted");
+    ASSERT(stats.entries == 2, "Entry count should stay at capacity");
+    ASSERT(stats.capacity == 2, "Capacity should be reported");
+    
+    /* Invalid arguments */
+    ASSERT(proc_cache_lookup(cache, 0, TEST_START_TIME, 0) == NULL,
+           "PID 0 should not be cached");
+    ASSERT(proc_cache_lookup(NULL, my_pid, TEST_START_TIME, 0) == NULL,
+           "NULL cache should fail");
+    
+    proc_cache_destroy(cache);
+    TEST_PASS();
+}
+
+/**
+ * Test cached event enrichment through the event processor
+ */
+static int test_event_processor_enrich(void) {
+    TEST("event_processor_enrich");
+    
+    cli_args_t args = {0};
+    event_processor_t *proc = event_processor_create(&args);
+    processed_event_t event = {0};
+    proc_cache_stats_t stats;
+    
+    ASSERT(proc != NULL && proc->cache != NULL, "Processor should own a cache");
+    
+    event.pid = getpid();
+    event.event_type = "file_open";
+    ASSERT(event_processor_enrich(proc, &event) == 0, "Enrichment should succeed");
+    ASSERT(event.process != NULL && event.exe != NULL, "Process fields should be enriched");
+    ASSERT(event.owned == 0, "Enriched fields should be borrowed from the cache");
+    
+    memset(&event, 0, sizeof(event));
+    event.pid = getpid();
+    event.event_type = "process_exec";
+    ASSERT(event_processor_enrich(proc, &event) == 0, "Exec enrichment should succeed");
+    ASSERT(event.cmdline != NULL, "Exec events should get a cmdline");
+    
+    proc_cache_get_stats(proc->cache, &stats);
+    ASSERT(stats.invalidations == 1, "Exec should refresh the entry");
+    
+    /* exe and cmdline captured by the kernel need no /proc read */
+    memset(&event, 0, sizeof(event));
+    event.pid = getpid();
+    event.event_type = "process_exec";
+    event.process = "openssl";
+    event.exe = "/usr/bin/openssl";
+    event.cmdline = "openssl version";
+    ASSERT(event_processor_enrich(proc, &event) == 0, "Kernel-captured exec should succeed");
+    ASSERT(strcmp(event.cmdline, "openssl version") == 0, "Kernel cmdline should be kept");
+    
+    proc_cache_get_stats(proc->cache, &stats);
+    ASSERT(stats.misses == 2, "Kernel-captured exec should not read /proc");
+    ASSERT(stats.entries == 0, "Stale pre-exec entry should be dropped");
+    
+    ASSERT(event_processor_enrich(proc, NULL) != 0, "NULL event should fail");
+    
+    event_processor_destroy(proc);
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Proc Cache Unit Tests ===\n\n");
+    
+    test_lookup_hit();
+    test_lookup_invalidation();
+    test_last_use();
+    test_capacity_eviction();
+    test_event_processor_enrich();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
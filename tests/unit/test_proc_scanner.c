@@ -7,11 +7,14 @@
  * test_proc_scanner.c - Unit tests for proc scanner
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "proc_scanner.h"
 
 /* Test counter */
@@ -61,15 +64,20 @@ void test_get_process_info_self(void) {
     proc_scanner_t *scanner = proc_scanner_create();
     ASSERT(scanner != NULL, "Failed to create proc scanner");
     
+    string_arena_t *arena = string_arena_create(0);
+    ASSERT(arena != NULL, "Failed to create string arena");
+    
     pid_t self_pid = getpid();
     process_info_t info;
     
-    int ret = proc_scanner_get_process_info(scanner, self_pid, &info);
+    int ret = proc_scanner_get_process_info(scanner, self_pid, &info, arena);
     ASSERT(ret == 0, "Failed to get process info for self");
     ASSERT(info.pid == self_pid, "PID mismatch");
     ASSERT(strlen(info.comm) > 0, "Process name is empty");
-    ASSERT(strlen(info.exe) > 0, "Executable path is empty");
+    ASSERT(info.exe != NULL && strlen(info.exe) > 0, "Executable path is empty");
+    ASSERT(info.cmdline != NULL, "Command line is missing");
     
+    string_arena_destroy(arena);
     proc_scanner_destroy(scanner);
     
     TEST_PASS();
@@ -87,7 +95,7 @@ void test_get_process_info_invalid(void) {
     process_info_t info;
     
     /* Use a very high PID that's unlikely to exist */
-    int ret = proc_scanner_get_process_info(scanner, 999999, &info);
+    int ret = proc_scanner_get_process_info(scanner, 999999, &info, NULL);
     ASSERT(ret != 0, "Should fail for invalid PID");
     
     proc_scanner_destroy(scanner);
@@ -237,9 +245,11 @@ void test_library_list_operations(void) {
     
     /* Add some libraries */
     for (int i = 0; i < 10; i++) {
-        library_info_t info;
-        snprintf(info.path, sizeof(info.path), "/usr/lib/libtest%d.so", i);
-        snprintf(info.name, sizeof(info.name), "libtest%d", i);
+        char path[64];
+        char name[32];
+        library_info_t info = { .path = path, .name = name };
+        snprintf(path, sizeof(path), "/usr/lib/libtest%d.so", i);
+        snprintf(name, sizeof(name), "libtest%d", i);
         
         int ret = library_list_add(&list, &info);
         ASSERT(ret == 0, "Failed to add library to list");
@@ -247,10 +257,12 @@ void test_library_list_operations(void) {
     
     ASSERT(list.count == 10, "Count should be 10");
     
+    /* Entries own copies of the strings */
+    ASSERT(strcmp(list.libraries[3].path, "/usr/lib/libtest3.so") == 0, "Path mismatch");
+    ASSERT(strcmp(list.libraries[3].name, "libtest3") == 0, "Name mismatch");
+    
     /* Try to add duplicate - should not increase count */
-    library_info_t dup;
-    strcpy(dup.path, "/usr/lib/libtest0.so");
-    strcpy(dup.name, "libtest0");
+    library_info_t dup = { .path = "/usr/lib/libtest0.so", .name = "libtest0" };
     library_list_add(&list, &dup);
     ASSERT(list.count == 10, "Count should still be 10 after duplicate");
     
@@ -272,8 +284,9 @@ void test_file_list_operations(void) {
     
     /* Add some files */
     for (int i = 0; i < 10; i++) {
-        file_info_t info;
-        snprintf(info.path, sizeof(info.path), "/etc/ssl/cert%d.pem", i);
+        char path[64];
+        file_info_t info = { .path = path };
+        snprintf(path, sizeof(path), "/etc/ssl/cert%d.pem", i);
         info.fd = i + 3;  /* Start from fd 3 */
         
         int ret = file_list_add(&list, &info);
@@ -283,9 +296,7 @@ void test_file_list_operations(void) {
     ASSERT(list.count == 10, "Count should be 10");
     
     /* Try to add duplicate - should not increase count */
-    file_info_t dup;
-    strcpy(dup.path, "/etc/ssl/cert0.pem");
-    dup.fd = 3;
+    file_info_t dup = { .path = "/etc/ssl/cert0.pem", .fd = 3 };
     file_list_add(&list, &dup);
     ASSERT(list.count == 10, "Count should still be 10 after duplicate");
     
@@ -305,7 +316,7 @@ void test_permission_errors(void) {
     
     /* Try to get info for PID 1 (init) - may fail due to permissions */
     process_info_t info;
-    int ret = proc_scanner_get_process_info(scanner, 1, &info);
+    int ret = proc_scanner_get_process_info(scanner, 1, &info, NULL);
     
     /* Should either succeed or fail gracefully (not crash) */
     if (ret == 0) {
@@ -319,6 +330,62 @@ void test_permission_errors(void) {
     TEST_PASS();
 }
 
+/**
+ * Test: Parse a synthetic maps file through a directory fd
+ */
+void test_parse_maps_file(void) {
+    TEST("test_parse_maps_file");
+    
+    static const char maps[] =
+        "55d4c0000000-55d4c0001000 r--p 00000000 08:01 1001 /usr/bin/app\n"
+        "7f0000000000-7f0000001000 r--p 00000000 08:01 2002 /usr/lib/libssl.so.3\n"
+        "7f0000001000-7f0000002000 r-xp 00001000 08:01 2002 /usr/lib/libssl.so.3\n"
+        "7f0000002000-7f0000003000 rw-p 00000000 00:00 0 \n"
+        "7f0000003000-7f0000004000 r--p 00000000 08:01 2002 /usr/lib/libssl.so.3\n"
+        "7f0000004000-7f0000005000 r--p 00000000 fd:02 3003 /opt/app/lib path/libcrypto.so.3\n"
+        "7ffd00000000-7ffd00001000 rw-p 00000000 00:00 0                  [stack]\n"
+        "7f0000006000-7f0000007000 r--p 00000000 08:01 4004 /usr/lib/libz.so.1\n"
+        "7f0000007000-7f0000008000 r--p 00000000 08:01 5005 /usr/lib/libsodium.so.23";
+    char dir[64];
+    char path[96];
+    
+    snprintf(dir, sizeof(dir), "/tmp/ct_maps_test_%d", (int)getpid());
+    snprintf(path, sizeof(path), "%s/maps", dir);
+    ASSERT(mkdir(dir, 0700) == 0, "Failed to create test directory");
+    FILE *fp = fopen(path, "w");
+    ASSERT(fp != NULL, "Failed to create maps file");
+    fputs(maps, fp);
+    fclose(fp);
+    
+    proc_scanner_t *scanner = proc_scanner_create();
+    int dir_fd = open(dir, O_RDONLY | O_DIRECTORY);
+    library_list_t libs;
+    library_list_init(&libs);
+    
+    int ret = proc_scanner_get_loaded_libraries_at(scanner, dir_fd, &libs);
+    close(dir_fd);
+    unlink(path);
+    rmdir(dir);
+    
+    ASSERT(ret == 0, "Failed to parse maps file");
+    /* libssl's segments collapse (anonymous mappings in between do not
+     * count), libz is not crypto, and the path with a space and the
+     * unterminated last line are parsed */
+    ASSERT(libs.count == 3, "Expected libssl, libcrypto and libsodium");
+    ASSERT(strcmp(libs.libraries[0].path, "/usr/lib/libssl.so.3") == 0, "libssl path");
+    ASSERT(strcmp(libs.libraries[0].name, "libssl") == 0, "libssl name");
+    ASSERT(strcmp(libs.libraries[1].path, "/opt/app/lib path/libcrypto.so.3") == 0, "libcrypto path");
+    ASSERT(strcmp(libs.libraries[2].path, "/usr/lib/libsodium.so.23") == 0, "libsodium path");
+    ASSERT(libs.libraries[0].interned, "Library paths should be interned");
+    ASSERT(path_intern_count(proc_scanner_library_table(scanner)) == 3,
+           "Each distinct library should be interned once");
+    
+    library_list_free(&libs);
+    proc_scanner_destroy(scanner);
+    
+    TEST_PASS();
+}
+
 int main(void) {
     printf("Running proc_scanner unit tests...\n\n");
     
@@ -328,6 +395,7 @@ int main(void) {
     test_scan_processes();
     test_get_loaded_libraries();
     test_get_open_files();
+    test_parse_maps_file();
     test_process_list_operations();
     test_library_list_operations();
     test_file_list_operations();
@@ -16,6 +16,9 @@
 #include "../../src/include/crypto_tracer.h"
 #include "../../src/include/event_processor.h"
 
+/* Event timestamp: 2025-01-01T00:00:00Z plus the given seconds */
+#define TEST_TIMESTAMP_NS(sec) ((1735689600ULL + (sec)) * 1000000000ULL)
+
 /* Test result tracking */
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -43,6 +46,11 @@ static int test_profile_manager_get_profile(void);
 static int test_profile_manager_finalize_profile(void);
 static int test_profile_manager_multiple_processes(void);
 static int test_profile_free(void);
+static int test_profile_manager_many_processes(void);
+static int test_profile_manager_process_exit(void);
+static int test_profile_manager_thread_exit(void);
+static int test_profile_manager_flush_deltas(void);
+static int test_profile_manager_handshakes(void);
 
 /**
  * Test profile manager creation
@@ -71,7 +79,7 @@ static int test_profile_manager_add_event(void) {
     /* Create a test event */
     processed_event_t event = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -101,7 +109,7 @@ static int test_profile_manager_library_aggregation(void) {
     /* Add first library load event */
     processed_event_t event1 = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -114,7 +122,7 @@ static int test_profile_manager_library_aggregation(void) {
     /* Add second library load event (different library) */
     processed_event_t event2 = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:01.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -127,7 +135,7 @@ static int test_profile_manager_library_aggregation(void) {
     /* Add duplicate library load event (should be deduplicated) */
     processed_event_t event3 = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:02.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(2),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -162,7 +170,7 @@ static int test_profile_manager_file_aggregation(void) {
     /* Add first file open event */
     processed_event_t event1 = {
         .event_type = "file_open",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -176,7 +184,7 @@ static int test_profile_manager_file_aggregation(void) {
     /* Add second file open event (same file - should increment count) */
     processed_event_t event2 = {
         .event_type = "file_open",
-        .timestamp = "2025-01-01T00:00:01.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -190,7 +198,7 @@ static int test_profile_manager_file_aggregation(void) {
     /* Add third file open event (different file) */
     processed_event_t event3 = {
         .event_type = "file_open",
-        .timestamp = "2025-01-01T00:00:02.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(2),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -201,6 +209,13 @@ static int test_profile_manager_file_aggregation(void) {
     
     profile_manager_add_event(mgr, &event3);
     
+    /* Coalesced repeats of cert.pem counted in the kernel */
+    processed_event_t event4 = event2;
+    event4.timestamp_ns = TEST_TIMESTAMP_NS(3);
+    event4.count = 40;
+    
+    profile_manager_add_event(mgr, &event4);
+    
     /* Get profile and verify */
     profile_t *profile = profile_manager_get_profile(mgr, 1234);
     ASSERT(profile != NULL, "profile_manager_get_profile should return profile");
@@ -212,8 +227,8 @@ static int test_profile_manager_file_aggregation(void) {
     for (size_t i = 0; i < profile->file_count; i++) {
         if (strcmp(profile->files_accessed[i].path, "/etc/ssl/cert.pem") == 0) {
             found_cert = true;
-            ASSERT(profile->files_accessed[i].access_count == 2, 
-                   "cert.pem should have access_count of 2");
+            ASSERT(profile->files_accessed[i].access_count == 42, 
+                   "cert.pem should have access_count of 42");
             break;
         }
     }
@@ -238,7 +253,7 @@ static int test_profile_manager_api_call_aggregation(void) {
     /* Add first API call event */
     processed_event_t event1 = {
         .event_type = "api_call",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -250,7 +265,7 @@ static int test_profile_manager_api_call_aggregation(void) {
     /* Add second API call event (same function - should increment count) */
     processed_event_t event2 = {
         .event_type = "api_call",
-        .timestamp = "2025-01-01T00:00:01.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -262,7 +277,7 @@ static int test_profile_manager_api_call_aggregation(void) {
     /* Add third API call event (different function) */
     processed_event_t event3 = {
         .event_type = "api_call",
-        .timestamp = "2025-01-01T00:00:02.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(2),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -288,6 +303,19 @@ static int test_profile_manager_api_call_aggregation(void) {
         }
     }
     ASSERT(found_connect, "Should find SSL_connect in profile");
+    profile_free(profile);
+    
+    /* Calls counted in the kernel arrive as one event with a count */
+    event1.count = 1000;
+    profile_manager_add_event(mgr, &event1);
+    profile = profile_manager_get_profile(mgr, 1234);
+    ASSERT(profile != NULL, "profile_manager_get_profile should return profile");
+    for (size_t i = 0; i < profile->api_call_count; i++) {
+        if (strcmp(profile->api_calls[i].function_name, "SSL_connect") == 0) {
+            ASSERT(profile->api_calls[i].count == 1002, "Aggregated calls should add their count");
+        }
+    }
+    ASSERT(profile->statistics.total_events == 1003, "Aggregated calls should count as events");
     
     profile_free(profile);
     profile_manager_destroy(mgr);
@@ -308,7 +336,7 @@ static int test_profile_manager_get_profile(void) {
     /* Add event */
     processed_event_t event = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -353,7 +381,7 @@ static int test_profile_manager_finalize_profile(void) {
     /* Add event */
     processed_event_t event = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -394,7 +422,7 @@ static int test_profile_manager_multiple_processes(void) {
     /* Add event for process 1234 */
     processed_event_t event1 = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "process1",
@@ -407,7 +435,7 @@ static int test_profile_manager_multiple_processes(void) {
     /* Add event for process 5678 */
     processed_event_t event2 = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:01.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
         .pid = 5678,
         .uid = 1001,
         .process = "process2",
@@ -448,7 +476,7 @@ static int test_profile_free(void) {
     /* Add various events */
     processed_event_t event1 = {
         .event_type = "lib_load",
-        .timestamp = "2025-01-01T00:00:00.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -458,7 +486,7 @@ static int test_profile_free(void) {
     
     processed_event_t event2 = {
         .event_type = "file_open",
-        .timestamp = "2025-01-01T00:00:01.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -469,7 +497,7 @@ static int test_profile_free(void) {
     
     processed_event_t event3 = {
         .event_type = "api_call",
-        .timestamp = "2025-01-01T00:00:02.000000Z",
+        .timestamp_ns = TEST_TIMESTAMP_NS(2),
         .pid = 1234,
         .uid = 1000,
         .process = "test_process",
@@ -496,6 +524,370 @@ static int test_profile_free(void) {
     return 0;
 }
 
+/**
+ * Test that profiles are not capped and survive index growth and removal
+ */
+static int test_profile_manager_many_processes(void) {
+    printf("Running test: profile_manager_many_processes\n");
+    
+    profile_manager_t *mgr = profile_manager_create();
+    ASSERT(mgr != NULL, "profile_manager_create should succeed");
+    
+    char path[64];
+    processed_event_t event = {
+        .event_type = "file_open",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
+        .process = "worker",
+        .file = path,
+        .file_type = FILE_TYPE_CERTIFICATE,
+        .flags = "O_RDONLY"
+    };
+    
+    /* Far more processes than the old fixed table held */
+    int failures = 0;
+    for (uint32_t pid = 1; pid <= 5000; pid++) {
+        event.pid = pid;
+        snprintf(path, sizeof(path), "/etc/ssl/%u.pem", pid % 7);
+        failures += profile_manager_add_event(mgr, &event) != 0;
+    }
+    ASSERT(failures == 0, "add_event should succeed for every process");
+    
+    /* Finalize every other profile; the rest must still be found */
+    for (pid_t pid = 2; pid <= 5000; pid += 2) {
+        profile_t *profile = profile_manager_finalize_profile(mgr, pid, 0);
+        failures += !profile || profile->process.pid != (uint32_t)pid;
+        profile_free(profile);
+    }
+    ASSERT(failures == 0, "Should finalize each profile");
+    for (pid_t pid = 1; pid <= 5000; pid++) {
+        profile_t *profile = profile_manager_get_profile(mgr, pid);
+        failures += (pid % 2 == 0) != (profile == NULL);
+        profile_free(profile);
+    }
+    ASSERT(failures == 0, "Only unfinalized profiles should remain");
+    
+    /* Many distinct files in one profile, each seen twice */
+    event.pid = 1;
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 2000; i++) {
+            snprintf(path, sizeof(path), "/etc/ssl/private/%d.key", i);
+            profile_manager_add_event(mgr, &event);
+        }
+    }
+    profile_t *profile = profile_manager_get_profile(mgr, 1);
+    ASSERT(profile != NULL, "Should get profile for PID 1");
+    ASSERT(profile->file_count == 2001, "Files should be deduplicated by path");
+    int twice = 0;
+    for (size_t i = 0; i < profile->file_count; i++) {
+        twice += profile->files_accessed[i].access_count == 2;
+    }
+    ASSERT(twice == 2000, "Each repeated file should count both accesses");
+    profile_free(profile);
+    
+    profile_manager_destroy(mgr);
+    
+    printf("  PASSED\n");
+    return 0;
+}
+
+/**
+ * Test that a process exit retires the profile and frees its PID
+ */
+static int test_profile_manager_process_exit(void) {
+    printf("Running test: profile_manager_process_exit\n");
+    
+    profile_manager_t *mgr = profile_manager_create();
+    ASSERT(mgr != NULL, "profile_manager_create should succeed");
+    
+    processed_event_t load = {
+        .event_type = "lib_load",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
+        .pid = 4242,
+        .process = "old_process",
+        .library = "/usr/lib/libssl.so.3",
+        .library_name = "libssl"
+    };
+    processed_event_t exit_event = {
+        .event_type = "process_exit",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
+        .pid = 4242,
+        .process = "old_process",
+        .exit_code = 0
+    };
+    
+    profile_manager_add_event(mgr, &load);
+    profile_manager_add_event(mgr, &exit_event);
+    
+    /* The exited process' profile is still available */
+    profile_t *profile = profile_manager_get_profile(mgr, 4242);
+    ASSERT(profile != NULL, "Exited profile should still be retrievable");
+    ASSERT(profile->library_count == 1, "Exited profile should keep its data");
+    profile_free(profile);
+    
+    /* A new process reusing the PID starts a fresh profile */
+    load.process = "new_process";
+    load.library = "/usr/lib/libcrypto.so.3";
+    load.library_name = "libcrypto";
+    profile_manager_add_event(mgr, &load);
+    
+    profile = profile_manager_finalize_profile(mgr, 4242, 0);
+    ASSERT(profile != NULL, "Should finalize the live profile");
+    ASSERT(strcmp(profile->process.name, "new_process") == 0, "Live profile should win");
+    ASSERT(profile->library_count == 1 &&
+           strcmp(profile->libraries[0].name, "libcrypto") == 0, "New profile should start empty");
+    profile_free(profile);
+    
+    profile = profile_manager_finalize_profile(mgr, 4242, 0);
+    ASSERT(profile != NULL && strcmp(profile->process.name, "old_process") == 0,
+           "Retired profile should be finalized next");
+    profile_free(profile);
+    ASSERT(profile_manager_get_profile(mgr, 4242) == NULL, "No profile should remain");
+    
+    profile_manager_destroy(mgr);
+    
+    printf("  PASSED\n");
+    return 0;
+}
+
+/**
+ * Test that a worker thread exiting does not split the process's profile
+ */
+static int test_profile_manager_thread_exit(void) {
+    printf("Running test: profile_manager_thread_exit\n");
+    
+    profile_manager_t *mgr = profile_manager_create();
+    ASSERT(mgr != NULL, "profile_manager_create should succeed");
+    
+    processed_event_t load = {
+        .event_type = "lib_load",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
+        .pid = 4242,
+        .process = "nginx",
+        .library = "/usr/lib/libssl.so.3",
+        .library_name = "libssl"
+    };
+    processed_event_t thread_exit = {
+        .event_type = "process_exit",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
+        .pid = 4242,
+        .tid = 4250,
+        .process = "nginx",
+        .exit_code = 0
+    };
+    
+    profile_manager_add_event(mgr, &load);
+    profile_manager_add_event(mgr, &thread_exit);
+    
+    /* The process keeps running: later events add to the same profile */
+    load.timestamp_ns = TEST_TIMESTAMP_NS(2);
+    load.library = "/usr/lib/libcrypto.so.3";
+    load.library_name = "libcrypto";
+    profile_manager_add_event(mgr, &load);
+    
+    profile_t *profile = profile_manager_finalize_profile(mgr, 4242, 0);
+    ASSERT(profile != NULL, "Should finalize the profile");
+    ASSERT(profile->library_count == 2, "Profile should hold events from before and after");
+    profile_free(profile);
+    ASSERT(profile_manager_get_profile(mgr, 4242) == NULL, "No split profile should remain");
+    
+    profile_manager_destroy(mgr);
+    
+    printf("  PASSED\n");
+    return 0;
+}
+
+/* Collected deltas of one flush */
+typedef struct {
+    int count;
+    int pid;
+    size_t libraries;
+    size_t files;
+    int file_accesses;
+    int api_count;
+    int total_events;
+    uint64_t handshakes;
+    uint64_t handshake_errors;
+} delta_capture_t;
+
+static void capture_delta(profile_t *delta, void *ctx) {
+    delta_capture_t *capture = ctx;
+    
+    capture->count++;
+    capture->pid = delta->process.pid;
+    capture->libraries = delta->library_count;
+    capture->files = delta->file_count;
+    capture->file_accesses = delta->file_count ? delta->files_accessed[0].access_count : 0;
+    capture->api_count = delta->api_call_count ? delta->api_calls[0].count : 0;
+    capture->total_events = delta->statistics.total_events;
+}
+
+/**
+ * Test that flushes report only activity since the previous flush
+ */
+static int test_profile_manager_flush_deltas(void) {
+    printf("Running test: profile_manager_flush_deltas\n");
+    
+    profile_manager_t *mgr = profile_manager_create();
+    ASSERT(mgr != NULL, "profile_manager_create should succeed");
+    
+    processed_event_t load = {
+        .event_type = "lib_load",
+        .timestamp_ns = TEST_TIMESTAMP_NS(0),
+        .pid = 100,
+        .process = "server",
+        .library = "/usr/lib/libssl.so.3",
+        .library_name = "libssl"
+    };
+    processed_event_t open_event = {
+        .event_type = "file_open",
+        .timestamp_ns = TEST_TIMESTAMP_NS(1),
+        .pid = 100,
+        .process = "server",
+        .file = "/etc/ssl/certs/server.pem",
+        .file_type = FILE_TYPE_CERTIFICATE
+    };
+    processed_event_t api = {
+        .event_type = "api_call",
+        .timestamp_ns = TEST_TIMESTAMP_NS(2),
+        .pid = 100,
+        .process = "server",
+        .function_name = "SSL_connect"
+    };
+    processed_event_t exit_event = {
+        .event_type = "process_exit",
+        .timestamp_ns = TEST_TIMESTAMP_NS(3),
+        .pid = 100,
+        .process = "server"
+    };
+    delta_capture_t capture = {0};
+    
+    profile_manager_add_event(mgr, &load);
+    profile_manager_add_event(mgr, &open_event);
+    profile_manager_add_event(mgr, &open_event);
+    profile_manager_add_event(mgr, &api);
+    
+    ASSERT(profile_manager_flush_deltas(mgr, 60, capture_delta, &capture) == 1,
+           "First flush should emit one delta");
+    ASSERT(capture.pid == 100 && capture.libraries == 1 && capture.files == 1,
+           "First delta should hold everything");
+    ASSERT(capture.file_accesses == 2 && capture.api_count == 1 && capture.total_events == 4,
+           "First delta should count every event");
+    
+    /* Nothing happened: nothing to emit */
+    memset(&capture, 0, sizeof(capture));
+    ASSERT(profile_manager_flush_deltas(mgr, 60, capture_delta, &capture) == 0,
+           "Unchanged profiles should not be emitted");
+    
+    /* A reloaded library is not new; only interval counts are reported */
+    profile_manager_add_event(mgr, &load);
+    profile_manager_add_event(mgr, &open_event);
+    ASSERT(profile_manager_flush_deltas(mgr, 60, capture_delta, &capture) == 1,
+           "Changed profile should be emitted");
+    ASSERT(capture.libraries == 0 && capture.files == 1 && capture.file_accesses == 1,
+           "Delta should only hold this interval's accesses");
+    ASSERT(capture.api_count == 0 && capture.total_events == 2, "Delta should count this interval");
+    
+    /* The whole profile is still available */
+    profile_t *profile = profile_manager_get_profile(mgr, 100);
+    ASSERT(profile != NULL && profile->files_accessed[0].access_count == 3,
+           "Full profile should keep cumulative counts");
+    profile_free(profile);
+    
+    /* An exited process gets its last delta and is then dropped */
+    profile_manager_add_event(mgr, &api);
+    profile_manager_add_event(mgr, &exit_event);
+    memset(&capture, 0, sizeof(capture));
+    ASSERT(profile_manager_flush_deltas(mgr, 60, capture_delta, &capture) == 1,
+           "Exited profile should get a final delta");
+    ASSERT(capture.api_count == 1, "Final delta should hold the last calls");
+    ASSERT(profile_manager_get_profile(mgr, 100) == NULL, "Exited profile should be freed");
+    
+    /* A process that only exits never produces a delta */
+    exit_event.pid = 200;
+    profile_manager_add_event(mgr, &exit_event);
+    ASSERT(profile_manager_flush_deltas(mgr, 60, capture_delta, &capture) == 0,
+           "Exit without crypto activity should not be emitted");
+    ASSERT(profile_manager_get_profile(mgr, 200) == NULL, "Exit-only profile should be freed");
+    
+    profile_manager_destroy(mgr);
+    
+    printf("  PASSED\n");
+    return 0;
+}
+
+/* Handshakes in the single handshake entry of a delta */
+static void capture_handshakes(profile_t *delta, void *ctx) {
+    delta_capture_t *capture = ctx;
+    
+    capture->count++;
+    capture->pid = delta->process.pid;
+    if (delta->tls_handshake_count == 1) {
+        for (int i = 0; i < HANDSHAKE_LATENCY_BUCKETS; i++) {
+            capture->handshakes += delta->tls_handshakes[0].buckets[i];
+        }
+        capture->handshake_errors = delta->tls_handshakes[0].errors;
+    }
+}
+
+/**
+ * Test that handshake latencies accumulate per function and flush as deltas
+ */
+static int test_profile_manager_handshakes(void) {
+    printf("Running test: profile_manager_handshakes\n");
+    
+    profile_manager_t *mgr = profile_manager_create();
+    ASSERT(mgr != NULL, "profile_manager_create should succeed");
+    
+    handshake_latency_t latency = {
+        .pid = 300,
+        .comm = "client",
+        .function_name = "SSL_connect"
+    };
+    processed_event_t exit_event = {
+        .event_type = "process_exit",
+        .timestamp_ns = TEST_TIMESTAMP_NS(3),
+        .pid = 300,
+        .process = "client"
+    };
+    delta_capture_t capture = {0};
+    
+    latency.buckets[10] = 3;
+    latency.errors = 1;
+    latency.total_ns = 4500000;
+    ASSERT(profile_manager_add_handshakes(mgr, 300, &latency) == 0, "Add handshakes");
+    ASSERT(profile_manager_add_handshakes(mgr, 300, &latency) == 0, "Add more handshakes");
+    
+    ASSERT(profile_manager_flush_deltas(mgr, 60, capture_handshakes, &capture) == 1,
+           "Handshakes alone should make a delta");
+    ASSERT(capture.pid == 300 && capture.handshakes == 6 && capture.handshake_errors == 2,
+           "Delta should hold both intervals read");
+    
+    /* The process exits before its last handshakes are read */
+    profile_manager_add_event(mgr, &exit_event);
+    latency.errors = 0;
+    ASSERT(profile_manager_add_handshakes(mgr, 300, &latency) == 0, "Add after exit");
+    
+    profile_t *profile = profile_manager_get_profile(mgr, 300);
+    ASSERT(profile != NULL && strcmp(profile->process.name, "client") == 0,
+           "Profile should be named after the process");
+    ASSERT(profile->tls_handshake_count == 1 && profile->tls_handshakes[0].buckets[10] == 9 &&
+           profile->tls_handshakes[0].errors == 2 &&
+           strcmp(profile->tls_handshakes[0].function_name, "SSL_connect") == 0,
+           "Full profile should keep cumulative histograms");
+    profile_free(profile);
+    
+    memset(&capture, 0, sizeof(capture));
+    ASSERT(profile_manager_flush_deltas(mgr, 60, capture_handshakes, &capture) == 1 &&
+           capture.handshakes == 3 && capture.handshake_errors == 0,
+           "Exited profile's final delta should hold the last handshakes");
+    ASSERT(profile_manager_get_profile(mgr, 300) == NULL, "Exited profile should be freed");
+    
+    profile_manager_destroy(mgr);
+    
+    printf("  PASSED\n");
+    return 0;
+}
+
 /**
  * Main test runner
  */
@@ -512,6 +904,11 @@ int main(void) {
     test_profile_manager_finalize_profile();
     test_profile_manager_multiple_processes();
     test_profile_free();
+    test_profile_manager_many_processes();
+    test_profile_manager_process_exit();
+    test_profile_manager_thread_exit();
+    test_profile_manager_flush_deltas();
+    test_profile_manager_handshakes();
     
     /* Print summary */
     printf("\n=== Test Summary ===\n");
@@ -161,10 +161,174 @@ test2:
     output_formatter_destroy(fmt);
     fclose(output);
     
+    /* Test 3: Snapshot with a shared library table */
+    printf("Test 3: Snapshot library index layout\n");
+    output = tmpfile();
+    if (!output) {
+        printf("  FAIL: Could not create temp file\n");
+        tests_failed++;
+        goto done;
+    }
+    
+    fmt = output_formatter_create(FORMAT_JSON_STREAM, output);
+    if (!fmt) {
+        printf("  FAIL: Could not create formatter\n");
+        fclose(output);
+        tests_failed++;
+        goto done;
+    }
+    output_formatter_set_library_index(fmt, true);
+    
+    /* Two processes sharing libssl; no interned ids, so the writer numbers them */
+    char *libs_a[] = { "/usr/lib/libssl.so.3", "/usr/lib/libcrypto.so.3" };
+    char *libs_b[] = { "/usr/lib/libssl.so.3" };
+    snapshot_process_t procs[2] = {
+        { .pid = 10, .name = "a", .exe = "/bin/a", .running_as = "uid:0",
+          .libraries = libs_a, .library_count = 2 },
+        { .pid = 11, .name = "b", .exe = "/bin/b", .running_as = "uid:0",
+          .libraries = libs_b, .library_count = 1 },
+    };
+    snapshot.processes = procs;
+    snapshot.process_count = 2;
+    
+    if (output_formatter_write_snapshot(fmt, &snapshot) != 0) {
+        printf("  FAIL: Could not write snapshot\n");
+        tests_failed++;
+    } else {
+        rewind(output);
+        bytes_read = fread(buffer, 1, sizeof(buffer) - 1, output);
+        buffer[bytes_read] = '\0';
+        
+        char *first = strstr(buffer, "libssl.so.3");
+        if (strstr(buffer, "\"libraries\": [\"\\/usr\\/lib\\/libssl.so.3\", "
+                           "\"\\/usr\\/lib\\/libcrypto.so.3\"]") &&
+            first && !strstr(first + 1, "libssl.so.3") &&
+            strstr(buffer, "\"library_ids\": [0, 1]") &&
+            strstr(buffer, "\"library_ids\": [0]")) {
+            printf("  PASS: Libraries listed once and referenced by index\n");
+            tests_passed++;
+        } else {
+            printf("  FAIL: Unexpected library index layout\n%s\n", buffer);
+            tests_failed++;
+        }
+    }
+    
+    output_formatter_destroy(fmt);
+    fclose(output);
+    
+    /* Test 4: json-stream event escaping */
+    printf("Test 4: json-stream event escaping\n");
+    output = tmpfile();
+    if (!output) {
+        printf("  FAIL: Could not create temp file\n");
+        tests_failed++;
+        goto done;
+    }
+    
+    fmt = output_formatter_create(FORMAT_JSON_STREAM, output);
+    if (!fmt) {
+        printf("  FAIL: Could not create formatter\n");
+        fclose(output);
+        tests_failed++;
+        goto done;
+    }
+    
+    /* Long enough that the 8-byte scan sees clean and dirty blocks */
+    processed_event_t event = {
+        .event_type = "process_exit", .pid = 42, .uid = 0,
+        .process = "clean-block-name\"q\\/\x01\ttail", .exit_code = -1,
+    };
+    
+    if (output_formatter_write_event(fmt, &event) != 0) {
+        printf("  FAIL: Could not write event\n");
+        tests_failed++;
+    } else {
+        rewind(output);
+        bytes_read = fread(buffer, 1, sizeof(buffer) - 1, output);
+        buffer[bytes_read] = '\0';
+        
+        if (strcmp(buffer, "{\"event_type\":\"process_exit\",\"pid\":42,\"uid\":0,"
+                           "\"process\":\"clean-block-name\\\"q\\\\\\/\\u0001\\ttail\","
+                           "\"exit_code\":-1}\n") == 0) {
+            printf("  PASS: Event escaped and written unbuffered\n");
+            tests_passed++;
+        } else {
+            printf("  FAIL: Unexpected event output\n%s\n", buffer);
+            tests_failed++;
+        }
+    }
+    
+    output_formatter_destroy(fmt);
+    fclose(output);
+    
+    /* Test 5: Batched output is held until output_formatter_flush() */
+    printf("Test 5: Batched event output\n");
+    output = tmpfile();
+    if (!output) {
+        printf("  FAIL: Could not create temp file\n");
+        tests_failed++;
+        goto done;
+    }
+    
+    fmt = output_formatter_create(FORMAT_JSON_STREAM, output);
+    if (!fmt) {
+        printf("  FAIL: Could not create formatter\n");
+        fclose(output);
+        tests_failed++;
+        goto done;
+    }
+    output_formatter_set_batching(fmt, true);
+    
+    /* A field larger than any output buffer forces the buffer to grow */
+    size_t big_len = 4 * 1024 * 1024;
+    char *big = malloc(big_len + 1);
+    if (!big) {
+        printf("  FAIL: Could not allocate test string\n");
+        output_formatter_destroy(fmt);
+        fclose(output);
+        tests_failed++;
+        goto done;
+    }
+    memset(big, 'x', big_len);
+    big[big_len] = '\0';
+    
+    processed_event_t small = { .event_type = "process_exec", .pid = 1, .cmdline = "sh" };
+    processed_event_t large = { .event_type = "process_exec", .pid = 2, .cmdline = big };
+    long held, flushed;
+    
+    output_formatter_write_event(fmt, &small);
+    fflush(output);
+    held = ftell(output);
+    output_formatter_write_event(fmt, &large);
+    output_formatter_write_event(fmt, &small);
+    if (output_formatter_flush(fmt) != 0) {
+        printf("  FAIL: Flush failed\n");
+        tests_failed++;
+    } else {
+        flushed = ftell(output);
+        /* 3 events: two small lines plus the big cmdline line */
+        rewind(output);
+        bytes_read = fread(buffer, 1, sizeof(buffer) - 1, output);
+        buffer[bytes_read] = '\0';
+        if (held == 0 && flushed > (long)big_len &&
+            strncmp(buffer, "{\"event_type\":\"process_exec\",\"pid\":1,", 37) == 0) {
+            printf("  PASS: Events held until flush, oversized field written\n");
+            tests_passed++;
+        } else {
+            printf("  FAIL: held=%ld flushed=%ld\n", held, flushed);
+            tests_failed++;
+        }
+    }
+        
+    free(big);
+    output_formatter_destroy(fmt);
+    fclose(output);
+        
 done:
     printf("\n=== Test Results ===\n");
     printf("Passed: %d\n", tests_passed);
     printf("Failed: %d\n", tests_failed);
-    
+        
     return (tests_failed == 0) ? 0 : 1;
 }
+    
\ No newline at end of file
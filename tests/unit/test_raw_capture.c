@@ -0,0 +1,281 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_raw_capture.c - Unit tests for raw capture recording and replay
+ * Round-trips records and /proc reads through a capture file and replays
+ * one through the eBPF manager's record path without BPF
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "../../src/include/crypto_tracer.h"
+#include "../../src/include/raw_capture.h"
+#include "../../src/include/ebpf_manager.h"
+#include "../../src/include/timestamp.h"
+#include "../../src/ebpf/common.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+static char capture_path[64];
+
+static void make_capture_path(void) {
+    snprintf(capture_path, sizeof(capture_path), "/tmp/test_raw_capture_%d.raw", getpid());
+}
+
+/* A file_open record as the kernel would submit it */
+static size_t make_file_open(struct ct_file_open_event *event, uint32_t pid, uint64_t ts,
+                             const char *path) {
+    memset(event, 0, sizeof(*event));
+    event->header.timestamp_ns = ts;
+    event->header.start_time_ns = 1000;
+    event->header.pid = pid;
+    event->header.event_type = CT_EVENT_FILE_OPEN;
+    strcpy(event->header.comm, "nginx");
+    event->filename_len = (uint32_t)strlen(path) + 1;
+    memcpy(event->filename, path, event->filename_len);
+    return CT_RECORD_SIZE(struct ct_file_open_event, filename, event->filename_len);
+}
+
+/**
+ * Test: Records come back byte for byte, in order and aligned
+ */
+static int test_record_round_trip(void) {
+    TEST("test_record_round_trip");
+    
+    static const char *payloads[] = { "a", "twelve bytes", "an odd-sized payload!" };
+    raw_writer_t *writer = raw_writer_create(capture_path, -42);
+    proc_cache_entry_t entry = { "nginx", "/usr/sbin/nginx", NULL };
+    raw_reader_t *reader;
+    const void *data;
+    uint8_t source;
+    size_t size;
+    
+    ASSERT(writer != NULL, "Writer should be created");
+    for (int i = 0; i < 3; i++) {
+        ASSERT(raw_writer_write_record(writer, (uint8_t)i, payloads[i], strlen(payloads[i])) == 0,
+               "Record should be written");
+        /* /proc frames in between are skipped by the record iterator */
+        ASSERT(raw_writer_write_proc(writer, 10 + i, 5, 0, &entry) == 0, "Proc read should be written");
+    }
+    ASSERT(raw_writer_close(writer) == 0, "Writer should close cleanly");
+    
+    reader = raw_reader_open(capture_path);
+    ASSERT(reader != NULL, "Capture should open");
+    ASSERT(raw_reader_boot_offset(reader) == -42, "Boot offset should round-trip");
+    
+    for (int i = 0; i < 3; i++) {
+        ASSERT(raw_reader_next(reader, &source, &data, &size) == 1, "Record should be read");
+        ASSERT(source == i, "Source should round-trip");
+        ASSERT(size == strlen(payloads[i]) && memcmp(data, payloads[i], size) == 0,
+               "Record bytes should round-trip");
+        ASSERT((uintptr_t)data % RAW_FRAME_ALIGN == 0, "Records should be aligned for decoding");
+    }
+    ASSERT(raw_reader_next(reader, &source, &data, &size) == 0, "End of capture expected");
+    
+    raw_reader_close(reader);
+    unlink(capture_path);
+    TEST_PASS();
+}
+
+/**
+ * Test: A process's recorded /proc reads come back in recording order
+ */
+static int test_proc_lookup_order(void) {
+    TEST("test_proc_lookup_order");
+    
+    raw_writer_t *writer = raw_writer_create(capture_path, 0);
+    proc_cache_entry_t before = { "sh", "/bin/sh", NULL };
+    proc_cache_entry_t after = { "openssl", "/usr/bin/openssl", "openssl s_client" };
+    proc_cache_entry_t other = { "other", NULL, NULL };
+    proc_cache_entry_t entry;
+    raw_reader_t *reader;
+    int ok;
+    
+    ASSERT(writer != NULL, "Writer should be created");
+    raw_writer_write_proc(writer, 100, 7, 0, &before);
+    raw_writer_write_proc(writer, 200, 7, 0, &other);
+    raw_writer_write_proc(writer, 100, 7, PROC_CACHE_REFRESH | PROC_CACHE_NEED_CMDLINE, &after);
+    ASSERT(raw_writer_close(writer) == 0, "Writer should close cleanly");
+    
+    reader = raw_reader_open(capture_path);
+    ASSERT(reader != NULL, "Capture should open");
+    
+    ASSERT(raw_reader_proc_lookup(reader, 100, 7, &entry) == 0, "First read should be found");
+    ok = strcmp(entry.comm, "sh") == 0 && strcmp(entry.exe, "/bin/sh") == 0 && !entry.cmdline;
+    free((char *)entry.comm);
+    free((char *)entry.exe);
+    ASSERT(ok, "First read should be the pre-exec metadata");
+    
+    ASSERT(raw_reader_proc_lookup(reader, 100, 7, &entry) == 0, "Second read should be found");
+    ok = strcmp(entry.comm, "openssl") == 0 && strcmp(entry.cmdline, "openssl s_client") == 0;
+    free((char *)entry.comm);
+    free((char *)entry.exe);
+    free((char *)entry.cmdline);
+    ASSERT(ok, "Second read should be the post-exec metadata");
+    
+    ASSERT(raw_reader_proc_lookup(reader, 100, 7, &entry) == 0, "Extra read should reuse the last");
+    ok = strcmp(entry.comm, "openssl") == 0;
+    free((char *)entry.comm);
+    free((char *)entry.exe);
+    free((char *)entry.cmdline);
+    ASSERT(ok, "Extra read should get the last recorded metadata");
+    
+    ASSERT(raw_reader_proc_lookup(reader, 200, 7, &entry) == 0 && !entry.exe,
+           "Unreadable fields should stay NULL");
+    free((char *)entry.comm);
+    ASSERT(raw_reader_proc_lookup(reader, 100, 8, &entry) == -1,
+           "A reused PID should not get the old process's metadata");
+    ASSERT(raw_reader_proc_lookup(reader, 300, 7, &entry) == -1 && !entry.comm,
+           "Unrecorded process should not be found");
+    
+    raw_reader_close(reader);
+    unlink(capture_path);
+    TEST_PASS();
+}
+
+/**
+ * Test: Truncated and foreign files are rejected
+ */
+static int test_malformed_capture(void) {
+    TEST("test_malformed_capture");
+    
+    static const char foreign[] = "CTRB\001\000\000\000 not a raw capture";
+    raw_writer_t *writer = raw_writer_create(capture_path, 0);
+    FILE *fp;
+    long size;
+    
+    ASSERT(writer != NULL, "Writer should be created");
+    raw_writer_write_record(writer, 0, "0123456789abcdef", 16);
+    ASSERT(raw_writer_close(writer) == 0, "Writer should close cleanly");
+    
+    ASSERT(truncate(capture_path, RAW_HEADER_SIZE + RAW_FRAME_HEADER_SIZE + 8) == 0,
+           "truncate failed");
+    ASSERT(raw_reader_open(capture_path) == NULL, "Truncated capture should be rejected");
+    
+    fp = fopen(capture_path, "wb");
+    ASSERT(fp != NULL, "fopen failed");
+    fwrite(foreign, 1, sizeof(foreign) - 1, fp);
+    size = ftell(fp);
+    fclose(fp);
+    ASSERT(size > RAW_HEADER_SIZE, "Test file should be longer than a header");
+    ASSERT(raw_reader_open(capture_path) == NULL, "Foreign file should be rejected");
+    ASSERT(raw_reader_open("/nonexistent/capture.raw") == NULL, "Missing file should be rejected");
+    
+    unlink(capture_path);
+    TEST_PASS();
+}
+
+typedef struct {
+    int events;
+    int wrong;
+} replay_ctx_t;
+
+static int count_replayed(struct processed_event *event, void *arg) {
+    replay_ctx_t *ctx = arg;
+    char expected[32];
+    
+    snprintf(expected, sizeof(expected), "/etc/ssl/%d.pem", ctx->events);
+    if (event->pid != 4242 || !event->file || strcmp(event->file, expected) != 0 ||
+        strcmp(event->event_type, "file_open") != 0 ||
+        event->timestamp_ns != 5000000000ULL + 1000 + (uint64_t)ctx->events) {
+        ctx->wrong++;
+    }
+    ctx->events++;
+    return 0;
+}
+
+/**
+ * Test: A capture replays through the manager's record path without BPF
+ */
+static int test_replay_through_manager(void) {
+    TEST("test_replay_through_manager");
+    
+    struct ct_file_open_event event;
+    raw_writer_t *writer = raw_writer_create(capture_path, 5000000000LL);
+    replay_ctx_t ctx = {0};
+    struct ebpf_manager *mgr;
+    raw_reader_t *reader;
+    uint64_t processed = 0, dropped = 0;
+    char path[32];
+    int replayed;
+    
+    ASSERT(writer != NULL, "Writer should be created");
+    for (int i = 0; i < 600; i++) {
+        size_t size;
+        
+        snprintf(path, sizeof(path), "/etc/ssl/%d.pem", i);
+        size = make_file_open(&event, 4242, 1000 + (uint64_t)i, path);
+        ASSERT(raw_writer_write_record(writer, EBPF_SOURCE_FILE_OPEN, &event, size) == 0,
+               "Record should be written");
+    }
+    ASSERT(raw_writer_close(writer) == 0, "Writer should close cleanly");
+    
+    reader = raw_reader_open(capture_path);
+    mgr = ebpf_manager_create();
+    ASSERT(reader != NULL && mgr != NULL, "Setup failed");
+    
+    timestamp_pin_offset(raw_reader_boot_offset(reader));
+    replayed = ebpf_manager_replay(mgr, reader, count_replayed, &ctx);
+    ebpf_manager_get_stats(mgr, &processed, &dropped);
+    
+    ebpf_manager_destroy(mgr);
+    raw_reader_close(reader);
+    unlink(capture_path);
+    
+    ASSERT(replayed == 600, "Every record should be replayed");
+    ASSERT(ctx.events == 600 && ctx.wrong == 0, "Events should decode as recorded, in order");
+    ASSERT(processed == 600 && dropped == 0, "Manager statistics should count replayed records");
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Raw Capture Unit Tests ===\n\n");
+    
+    make_capture_path();
+    test_record_round_trip();
+    test_proc_lookup_order();
+    test_malformed_capture();
+    test_replay_through_manager();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_snapshot_scanner.c - Unit tests for the parallel snapshot engine
+ * Tests that the current process is found, that thread counts agree,
+ * that incremental scans reuse unchanged processes and that BPF iterator
+ * output is parsed
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "../../src/include/crypto_tracer.h"
+#include "../../src/include/proc_scanner.h"
+#include "../../src/include/snapshot_scanner.h"
+#include "../../src/include/snapshot_iter.h"
+#include "../../src/ebpf/common.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Crypto file held open for the duration of the tests */
+static char key_path[64];
+
+/**
+ * Find the current process in a snapshot
+ */
+static const snapshot_process_t *find_self(const snapshot_t *snapshot) {
+    for (size_t i = 0; i < snapshot->process_count; i++) {
+        if (snapshot->processes[i].pid == (uint32_t)getpid()) {
+            return &snapshot->processes[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Test that a process holding a crypto file is reported
+ */
+static int test_scan_finds_self(void) {
+    TEST("snapshot_scan_finds_self");
+    
+    proc_scanner_t *scanner = proc_scanner_create();
+    snapshot_scan_config_t config = { .threads = 4, .redact = false };
+    snapshot_scan_stats_t stats;
+    snapshot_t snapshot = {0};
+    const snapshot_process_t *self;
+    
+    ASSERT(scanner != NULL, "Scanner creation should succeed");
+    ASSERT(snapshot_scan(scanner, &config, &snapshot, &stats) == 0, "Scan should succeed");
+    
+    self = find_self(&snapshot);
+    ASSERT(self != NULL, "Current process should be listed");
+    ASSERT(self->name != NULL && self->running_as != NULL, "Process fields should be set");
+    ASSERT(self->file_count == 1 && strcmp(self->open_crypto_files[0], key_path) == 0,
+           "Open crypto file should be reported");
+    
+    ASSERT(snapshot.summary.total_processes == (int)snapshot.process_count,
+           "Summary should count listed processes");
+    ASSERT(stats.pids_listed > 0 && stats.pids_scanned <= stats.pids_listed,
+           "PID counters should be consistent");
+    ASSERT(stats.threads >= 1 && stats.threads <= 4, "Thread count should be capped");
+    ASSERT(!stats.timed_out, "Scan should finish before the deadline");
+    
+    snapshot_free_processes(&snapshot);
+    ASSERT(snapshot.processes == NULL && snapshot.process_count == 0,
+           "Free should reset the process list");
+    
+    proc_scanner_destroy(scanner);
+    TEST_PASS();
+}
+
+/**
+ * Test that a single-threaded scan finds the same process
+ */
+static int test_scan_single_thread(void) {
+    TEST("snapshot_scan_single_thread");
+    
+    proc_scanner_t *scanner = proc_scanner_create();
+    snapshot_scan_config_t config = { .threads = 1, .redact = true };
+    snapshot_scan_stats_t stats;
+    snapshot_t snapshot = {0};
+    
+    ASSERT(scanner != NULL, "Scanner creation should succeed");
+    ASSERT(snapshot_scan(scanner, &config, &snapshot, &stats) == 0, "Scan should succeed");
+    ASSERT(stats.threads == 1, "One thread should be used");
+    ASSERT(find_self(&snapshot) != NULL, "Current process should be listed");
+    
+    snapshot_free_processes(&snapshot);
+    
+    ASSERT(snapshot_scan(NULL, &config, &snapshot, &stats) != 0, "NULL scanner should fail");
+    
+    proc_scanner_destroy(scanner);
+    TEST_PASS();
+}
+
+/**
+ * Test that a scan asking for the BPF iterators still lists the current
+ * process, from whichever backend was available
+ */
+static int test_scan_bpf_iter_fallback(void) {
+    TEST("snapshot_scan_bpf_iter_fallback");
+    
+    proc_scanner_t *scanner = proc_scanner_create();
+    snapshot_scan_config_t config = { .redact = false, .bpf_iter = true };
+    snapshot_scan_stats_t stats;
+    snapshot_t snapshot = {0};
+    const snapshot_process_t *self;
+    
+    ASSERT(scanner != NULL, "Scanner creation should succeed");
+    ASSERT(snapshot_scan(scanner, &config, &snapshot, &stats) == 0, "Scan should succeed");
+    
+    self = find_self(&snapshot);
+    ASSERT(self != NULL, "Current process should be listed");
+    ASSERT(self->file_count == 1 && strcmp(self->open_crypto_files[0], key_path) == 0,
+           "Open crypto file should be reported");
+    
+    snapshot_free_processes(&snapshot);
+    proc_scanner_destroy(scanner);
+    TEST_PASS();
+}
+
+/**
+ * Test that a second incremental scan reuses the processes the first one
+ * recorded and still reports the current process
+ */
+static int test_scan_incremental(void) {
+    TEST("snapshot_scan_incremental");
+    
+    proc_scanner_t *scanner = proc_scanner_create();
+    snapshot_scan_config_t config = { .threads = 2, .redact = false };
+    snapshot_scan_stats_t stats;
+    snapshot_t snapshot = {0};
+    const snapshot_process_t *self;
+    char state_path[64];
+    
+    snprintf(state_path, sizeof(state_path), "/tmp/ct_snapshot_state_%d", (int)getpid());
+    ASSERT(scanner != NULL, "Scanner creation should succeed");
+    
+    config.state = snapshot_state_load(state_path, false);
+    ASSERT(config.state != NULL, "Missing state should load empty");
+    ASSERT(snapshot_scan(scanner, &config, &snapshot, &stats) == 0, "First scan should succeed");
+    ASSERT(stats.pids_reused == 0, "Nothing to reuse on the first run");
+    ASSERT(snapshot_state_save(config.state, state_path, "first") == 0, "State should be saved");
+    snapshot_free_processes(&snapshot);
+    snapshot_state_destroy(config.state);
+    
+    config.state = snapshot_state_load(state_path, false);
+    ASSERT(config.state != NULL && snapshot_state_previous_count(config.state) > 0,
+           "State should load");
+    ASSERT(snapshot_scan(scanner, &config, &snapshot, &stats) == 0, "Second scan should succeed");
+    ASSERT(stats.pids_reused > 0, "Unchanged processes should be reused");
+    
+    self = find_self(&snapshot);
+    ASSERT(self != NULL && self->file_count == 1 &&
+           strcmp(self->open_crypto_files[0], key_path) == 0,
+           "Current process should be reported either way");
+    
+    snapshot_free_processes(&snapshot);
+    snapshot_state_destroy(config.state);
+    unlink(state_path);
+    proc_scanner_destroy(scanner);
+    TEST_PASS();
+}
+
+/**
+ * Append one iterator record to a raw output buffer
+ */
+static size_t put_record(char *buf, size_t pos, __u32 pid, __u32 kind, __s32 fd, const char *path) {
+    struct ct_iter_record rec = {
+        .pid = pid,
+        .kind = kind,
+        .fd = fd,
+        .path_len = (__u32)strlen(path) + 1,
+        .ino = 42,
+    };
+    
+    memcpy(buf + pos, &rec, sizeof(rec));
+    memcpy(buf + pos + sizeof(rec), path, rec.path_len);
+    return pos + sizeof(rec) + rec.path_len;
+}
+
+/**
+ * Test that iterator output is split, sorted by pid and validated
+ */
+static int test_iter_parse(void) {
+    TEST("snapshot_iter_parse");
+    
+    snapshot_iter_result_t result = {0};
+    size_t len = 0;
+    
+    result.data = malloc(1024);
+    ASSERT(result.data != NULL, "Allocation should succeed");
+    
+    /* Mappings of both processes come before their files */
+    len = put_record(result.data, len, 20, CT_ITER_LIBRARY, -1, "/usr/lib/libssl.so.3");
+    len = put_record(result.data, len, 10, CT_ITER_LIBRARY, -1, "/usr/lib/libc.so.6");
+    len = put_record(result.data, len, 20, CT_ITER_FILE, 5, "/etc/ssl/a.pem");
+    len = put_record(result.data, len, 10, CT_ITER_FILE, 3, "/etc/ssl/b.key");
+    len = put_record(result.data, len, 20, CT_ITER_FILE, 7, "/etc/ssl/c.pem");
+    result.data_len = len;
+    
+    ASSERT(snapshot_iter_parse(&result) == 0, "Parse should succeed");
+    ASSERT(result.count == 5, "Every record should be parsed");
+    ASSERT(result.records[0].pid == 10 && result.records[0].kind == CT_ITER_LIBRARY,
+           "Lowest pid's mapping should come first");
+    ASSERT(result.records[1].pid == 10 && result.records[1].fd == 3 &&
+           strcmp(result.records[1].path, "/etc/ssl/b.key") == 0,
+           "File record fields should be kept");
+    ASSERT(result.records[2].pid == 20 && result.records[2].fd == -1, "Mapping should precede files");
+    ASSERT(strcmp(result.records[3].path, "/etc/ssl/a.pem") == 0 &&
+           strcmp(result.records[4].path, "/etc/ssl/c.pem") == 0,
+           "Files should keep their kernel order");
+    ASSERT(result.records[4].ino == 42, "Inode should be kept");
+    
+    /* Truncated output is rejected */
+    result.data_len = len - 1;
+    ASSERT(snapshot_iter_parse(&result) != 0, "Truncated path should be rejected");
+    result.data_len = sizeof(struct ct_iter_record) - 1;
+    ASSERT(snapshot_iter_parse(&result) != 0, "Truncated header should be rejected");
+    
+    result.data_len = 0;
+    ASSERT(snapshot_iter_parse(&result) == 0 && result.count == 0, "Empty output should parse");
+    
+    snapshot_iter_result_free(&result);
+    ASSERT(result.data == NULL && result.records == NULL, "Free should reset the result");
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    int fd;
+    
+    printf("=== Snapshot Scanner Unit Tests ===\n\n");
+    
+    snprintf(key_path, sizeof(key_path), "/tmp/ct_snapshot_test_%d.pem", (int)getpid());
+    fd = open(key_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        perror("open");
+        return 1;
+    }
+    
+    test_scan_finds_self();
+    test_scan_single_thread();
+    test_scan_bpf_iter_fallback();
+    test_scan_incremental();
+    test_iter_parse();
+    
+    close(fd);
+    unlink(key_path);
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
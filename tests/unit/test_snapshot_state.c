@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_snapshot_state.c - Unit tests for incremental snapshot state
+ * Tests reading a process's identity and signature, the state file round
+ * trip (escaping, redaction mismatch, malformed files) and the diff
+ * between two runs
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../../src/include/snapshot_state.h"
+#include "../../src/include/snapshot_scanner.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+static char state_path[64];
+
+static snapshot_process_key_t make_key(uint32_t pid, uint64_t start_time) {
+    snapshot_process_key_t key = { .pid = pid, .start_time = start_time,
+                                   .exe_dev = 8, .exe_ino = 1000 + pid,
+                                   .vsize = 4096 * pid, .fd_count = 3 };
+    return key;
+}
+
+static snapshot_process_t make_process(uint32_t pid, char **libs, size_t lib_count,
+                                       char **files, size_t file_count) {
+    snapshot_process_t proc = { .pid = pid, .name = "server", .exe = "/usr/bin/server",
+                                .running_as = "uid:0", .libraries = libs,
+                                .library_count = lib_count, .open_crypto_files = files,
+                                .file_count = file_count };
+    return proc;
+}
+
+static const snapshot_process_t *find_pid(const snapshot_t *snapshot, uint32_t pid) {
+    for (size_t i = 0; i < snapshot->process_count; i++) {
+        if (snapshot->processes[i].pid == pid) {
+            return &snapshot->processes[i];
+        }
+    }
+    return NULL;
+}
+
+static int write_file(const char *path, const char *content) {
+    FILE *fp = fopen(path, "w");
+    
+    if (!fp) {
+        return -1;
+    }
+    fputs(content, fp);
+    return fclose(fp);
+}
+
+/**
+ * Test: The current process's identity and signature are read from /proc
+ */
+static int test_read_key(void) {
+    TEST("test_read_key");
+    
+    snapshot_process_key_t key, again;
+    struct stat exe;
+    int pid_fd, fd;
+    
+    pid_fd = open("/proc/self", O_RDONLY | O_DIRECTORY);
+    ASSERT(pid_fd >= 0, "open /proc/self");
+    ASSERT(snapshot_state_read_key(pid_fd, getpid(), &key) == 0, "Read key");
+    ASSERT(stat("/proc/self/exe", &exe) == 0, "stat exe");
+    
+    ASSERT(key.pid == (uint32_t)getpid(), "pid");
+    ASSERT(key.start_time > 0 && key.vsize > 0, "Start time and size");
+    ASSERT(key.exe_ino == (uint64_t)exe.st_ino && key.exe_dev == (uint64_t)exe.st_dev,
+           "Executable identity");
+    ASSERT(key.fd_count >= 3, "Standard fds and the directory fd");
+    
+    fd = open("/dev/null", O_RDONLY);
+    ASSERT(snapshot_state_read_key(pid_fd, getpid(), &again) == 0, "Read key again");
+    ASSERT(again.fd_count == key.fd_count + 1, "Opening a file changes the signature");
+    ASSERT(again.start_time == key.start_time, "Identity is stable");
+    close(fd);
+    
+    close(pid_fd);
+    TEST_PASS();
+}
+
+/**
+ * Test: Processes saved by one run are found by the next, with their
+ * strings intact, and only while their signature is unchanged
+ */
+static int test_save_and_load(void) {
+    TEST("test_save_and_load");
+    
+    char *libs[] = { "/usr/lib/libssl.so.3", "/opt/odd\tname%/libcrypto.so" };
+    char *files[] = { "/etc/ssl/private/line\nbreak.key" };
+    snapshot_process_t proc = make_process(10, libs, 2, files, 1);
+    snapshot_process_key_t key10 = make_key(10, 500), key11 = make_key(11, 600);
+    const snapshot_state_entry_t *entry;
+    snapshot_state_t *state;
+    
+    state = snapshot_state_load(state_path, true);
+    ASSERT(state != NULL && snapshot_state_previous_count(state) == 0, "Missing file is empty");
+    ASSERT(snapshot_state_since(state) == NULL, "No previous run");
+    ASSERT(snapshot_state_begin(state, 3) == 0, "Begin");
+    snapshot_state_record(state, 0, &key10, &proc);
+    snapshot_state_record(state, 2, &key11, NULL);
+    ASSERT(snapshot_state_recorded(state, 0) && !snapshot_state_recorded(state, 1), "Recorded");
+    ASSERT(snapshot_state_save(state, state_path, "2024-11-18T12:34:56Z") == 0, "Save");
+    snapshot_state_destroy(state);
+    
+    state = snapshot_state_load(state_path, true);
+    ASSERT(state != NULL && snapshot_state_previous_count(state) == 2, "Both processes loaded");
+    ASSERT(strcmp(snapshot_state_since(state), "2024-11-18T12:34:56Z") == 0, "Previous run time");
+    
+    entry = snapshot_state_unchanged(state, &key10);
+    ASSERT(entry && entry->process.name && strcmp(entry->process.exe, "/usr/bin/server") == 0,
+           "Crypto process found");
+    ASSERT(entry->process.library_count == 2 &&
+           strcmp(entry->process.libraries[1], libs[1]) == 0 &&
+           entry->process.file_count == 1 &&
+           strcmp(entry->process.open_crypto_files[0], files[0]) == 0,
+           "Escaped strings survive");
+    entry = snapshot_state_unchanged(state, &key11);
+    ASSERT(entry && !entry->process.name, "Process without cryptography found");
+    
+    key10.vsize += 4096;
+    ASSERT(snapshot_state_unchanged(state, &key10) == NULL, "New mapping means rescan");
+    key11.start_time++;
+    ASSERT(snapshot_state_unchanged(state, &key11) == NULL, "Reused pid means rescan");
+    ASSERT(snapshot_state_find(state, 11) != NULL, "Found by pid regardless");
+    snapshot_state_destroy(state);
+    
+    state = snapshot_state_load(state_path, false);
+    ASSERT(state != NULL && snapshot_state_previous_count(state) == 0,
+           "Other redaction setting starts over");
+    snapshot_state_destroy(state);
+    
+    ASSERT(write_file(state_path, "crypto-tracer-snapshot-state 1 redact=1\n"
+                                  "generated_at x\nc\t1\t2\t3\t4\t5\t6\t2\t0\ta\tb\tc\nl\t/lib\n") == 0,
+           "Write truncated file");
+    state = snapshot_state_load(state_path, true);
+    ASSERT(state != NULL && snapshot_state_previous_count(state) == 0, "Truncated file ignored");
+    snapshot_state_destroy(state);
+    
+    unlink(state_path);
+    TEST_PASS();
+}
+
+/**
+ * Test: The diff lists new and gone processes whole, and what changed
+ * in the others; a pid reused by another process is both
+ */
+static int test_diff(void) {
+    TEST("test_diff");
+    
+    char *old_libs[] = { "/lib/libssl.so.3", "/lib/libcrypto.so.3" };
+    char *new_libs[] = { "/lib/libssl.so.3", "/lib/libgnutls.so.30" };
+    char *keys[] = { "/etc/ssl/server.key" };
+    snapshot_process_t p10 = make_process(10, old_libs, 2, keys, 1);
+    snapshot_process_t p11 = make_process(11, old_libs, 1, NULL, 0);
+    snapshot_process_t p12 = make_process(12, old_libs, 1, NULL, 0);
+    snapshot_process_key_t k10 = make_key(10, 1), k11 = make_key(11, 1), k12 = make_key(12, 1);
+    snapshot_process_key_t k12b = make_key(12, 2), k13 = make_key(13, 1);
+    snapshot_t added = {0}, removed = {0};
+    const snapshot_process_t *proc;
+    snapshot_state_t *state;
+    
+    state = snapshot_state_load(state_path, true);
+    ASSERT(state && snapshot_state_begin(state, 3) == 0, "Begin first run");
+    snapshot_state_record(state, 0, &k10, &p10);
+    snapshot_state_record(state, 1, &k11, &p11);
+    snapshot_state_record(state, 2, &k12, &p12);
+    ASSERT(snapshot_state_save(state, state_path, "first") == 0, "Save first run");
+    snapshot_state_destroy(state);
+    
+    /* 10 swaps libcrypto for libgnutls, 11 exits, 12 is another process, 13 starts */
+    state = snapshot_state_load(state_path, true);
+    ASSERT(state && snapshot_state_begin(state, 3) == 0, "Begin second run");
+    p10.libraries = new_libs;
+    snapshot_state_record(state, 0, &k10, &p10);
+    snapshot_state_record(state, 1, &k12b, &p12);
+    p11.pid = 13;
+    snapshot_state_record(state, 2, &k13, &p11);
+    ASSERT(snapshot_state_diff(state, &added, &removed) == 0, "Diff");
+    
+    ASSERT(added.process_count == 3 && removed.process_count == 3, "Process counts");
+    proc = find_pid(&added, 10);
+    ASSERT(proc && proc->library_count == 1 && strcmp(proc->libraries[0], new_libs[1]) == 0 &&
+           proc->file_count == 0, "Library started using");
+    proc = find_pid(&removed, 10);
+    ASSERT(proc && proc->library_count == 1 && strcmp(proc->libraries[0], old_libs[1]) == 0,
+           "Library stopped using");
+    ASSERT(find_pid(&removed, 11) && !find_pid(&added, 11), "Exited process");
+    ASSERT(find_pid(&added, 12) && find_pid(&removed, 12), "Reused pid");
+    proc = find_pid(&added, 13);
+    ASSERT(proc && proc->library_count == 1, "New process whole");
+    ASSERT(added.summary.total_libraries == 3 && removed.summary.total_libraries == 3 &&
+           removed.summary.total_files == 0, "Summary");
+    
+    snapshot_free_processes(&added);
+    snapshot_free_processes(&removed);
+    snapshot_state_destroy(state);
+    unlink(state_path);
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Snapshot State Unit Tests ===\n\n");
+    
+    snprintf(state_path, sizeof(state_path), "/tmp/test_snapshot_state.%d", (int)getpid());
+    
+    test_read_key();
+    test_save_and_load();
+    test_diff();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
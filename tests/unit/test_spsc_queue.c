@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_spsc_queue.c - Unit tests for the single-producer/single-consumer queue
+ * Tests ordering, capacity limits, wakeups and a two-thread transfer
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../../src/include/spsc_queue.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Items moved by the threaded test */
+#define TRANSFER_COUNT 200000
+
+/**
+ * Test FIFO order and the full/empty limits
+ */
+static int test_push_pop(void) {
+    TEST("spsc_queue_push_pop");
+    
+    spsc_queue_t *queue = spsc_queue_create(3);
+    uintptr_t i;
+    
+    ASSERT(queue != NULL, "Queue creation should succeed");
+    ASSERT(spsc_queue_capacity(queue) == 4, "Capacity should round up to a power of two");
+    ASSERT(spsc_queue_pop(queue) == NULL, "New queue should be empty");
+    
+    for (i = 1; i <= 4; i++) {
+        ASSERT(spsc_queue_push(queue, (void *)i), "Push below capacity should succeed");
+    }
+    ASSERT(!spsc_queue_push(queue, (void *)5), "Push to a full queue should fail");
+    ASSERT(spsc_queue_size(queue) == 4, "Size should count queued items");
+    
+    for (i = 1; i <= 4; i++) {
+        ASSERT(spsc_queue_pop(queue) == (void *)i, "Items should pop in push order");
+    }
+    ASSERT(spsc_queue_pop(queue) == NULL, "Drained queue should be empty");
+    
+    /* Indices keep increasing across wrap-around */
+    ASSERT(spsc_queue_push(queue, (void *)6), "Push after drain should succeed");
+    ASSERT(spsc_queue_pop(queue) == (void *)6, "Wrapped item should pop");
+    
+    ASSERT(spsc_queue_create(0) == NULL, "Zero capacity should fail");
+    
+    spsc_queue_destroy(queue);
+    TEST_PASS();
+}
+
+/**
+ * Test that waiting returns on timeout and after a wake
+ */
+static int test_wait_wake(void) {
+    TEST("spsc_queue_wait_wake");
+    
+    spsc_queue_t *queue = spsc_queue_create(4);
+    
+    ASSERT(queue != NULL, "Queue creation should succeed");
+    
+    /* Empty queue: returns after the timeout */
+    spsc_queue_wait(queue, 10);
+    
+    /* Pending wake or pending item: returns immediately */
+    spsc_queue_wake(queue);
+    spsc_queue_wait(queue, 10000);
+    
+    spsc_queue_push(queue, (void *)1);
+    spsc_queue_wait(queue, 10000);
+    ASSERT(spsc_queue_pop(queue) == (void *)1, "Queued item should be returned");
+    
+    spsc_queue_destroy(queue);
+    TEST_PASS();
+}
+
+static void *producer_main(void *arg) {
+    spsc_queue_t *queue = arg;
+    
+    for (uintptr_t i = 1; i <= TRANSFER_COUNT; i++) {
+        while (!spsc_queue_push(queue, (void *)i)) {
+            /* Full: spin until the consumer catches up */
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Test a producer and a consumer thread moving items concurrently
+ */
+static int test_threaded_transfer(void) {
+    TEST("spsc_queue_threaded_transfer");
+    
+    spsc_queue_t *queue = spsc_queue_create(64);
+    pthread_t producer;
+    uintptr_t expected = 1;
+    void *item;
+    
+    ASSERT(queue != NULL, "Queue creation should succeed");
+    ASSERT(pthread_create(&producer, NULL, producer_main, queue) == 0,
+           "Producer thread should start");
+    
+    while (expected <= TRANSFER_COUNT) {
+        item = spsc_queue_pop(queue);
+        if (!item) {
+            spsc_queue_wait(queue, 100);
+            continue;
+        }
+        ASSERT(item == (void *)expected, "Items should arrive in order without loss");
+        expected++;
+    }
+    
+    pthread_join(producer, NULL);
+    ASSERT(spsc_queue_pop(queue) == NULL, "Queue should be empty after the transfer");
+    
+    spsc_queue_destroy(queue);
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== SPSC Queue Unit Tests ===\n\n");
+    
+    test_push_pop();
+    test_wait_wake();
+    test_threaded_transfer();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
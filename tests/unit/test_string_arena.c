@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_string_arena.c - Unit tests for the string arena
+ * Tests allocation, alignment, oversized requests and merging
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../src/include/string_arena.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/**
+ * Test: Strings are copied and allocations are pointer-aligned
+ */
+static int test_alloc_strdup(void) {
+    TEST("test_alloc_strdup");
+    
+    string_arena_t *arena = string_arena_create(256);
+    ASSERT(arena != NULL, "Failed to create arena");
+    
+    char source[] = "/usr/lib/libssl.so.3";
+    char *copy = string_arena_strdup(arena, source);
+    ASSERT(copy != NULL && copy != source, "strdup should return a copy");
+    source[0] = 'X';
+    ASSERT(strcmp(copy, "/usr/lib/libssl.so.3") == 0, "Copy changed with the source");
+    
+    char *prefix = string_arena_strndup(arena, "libcrypto.so.3", 9);
+    ASSERT(prefix != NULL && strcmp(prefix, "libcrypto") == 0, "strndup mismatch");
+    
+    void *block = string_arena_alloc(arena, 3 * sizeof(char *));
+    ASSERT(block != NULL, "alloc failed");
+    ASSERT(((uintptr_t)block % sizeof(void *)) == 0, "alloc is not pointer-aligned");
+    
+    /* Fill past the first chunk; earlier strings must stay intact */
+    for (int i = 0; i < 100; i++) {
+        ASSERT(string_arena_strdup(arena, "/etc/ssl/certs/ca.pem") != NULL, "strdup failed");
+    }
+    ASSERT(strcmp(copy, "/usr/lib/libssl.so.3") == 0, "Earlier string overwritten");
+    ASSERT(string_arena_bytes_used(arena) <= string_arena_bytes_reserved(arena),
+           "Used bytes exceed reserved bytes");
+    
+    string_arena_destroy(arena);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Oversized requests get their own chunk without wasting the current one
+ */
+static int test_large_alloc(void) {
+    TEST("test_large_alloc");
+    
+    string_arena_t *arena = string_arena_create(256);
+    ASSERT(arena != NULL, "Failed to create arena");
+    
+    char *a = string_arena_strdup(arena, "before");
+    char *big = string_arena_alloc(arena, 4096);
+    ASSERT(big != NULL, "Large alloc failed");
+    memset(big, 'x', 4096);
+    char *b = string_arena_strdup(arena, "after");
+    
+    ASSERT(a != NULL && b != NULL, "Small allocs failed");
+    ASSERT(strcmp(a, "before") == 0 && strcmp(b, "after") == 0, "Strings corrupted");
+    /* "after" still fits in the first chunk */
+    ASSERT(b > a && b - a < 256, "Small alloc did not reuse the current chunk");
+    ASSERT(string_arena_bytes_reserved(arena) >= 4096 + 256, "Large chunk not counted");
+    
+    string_arena_destroy(arena);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Reset keeps the current chunk and frees the rest
+ */
+static int test_reset(void) {
+    TEST("test_reset");
+    
+    string_arena_t *arena = string_arena_create(256);
+    ASSERT(arena != NULL, "Failed to create arena");
+    
+    char *first = string_arena_strdup(arena, "first");
+    ASSERT(string_arena_alloc(arena, 4096) != NULL, "Large alloc failed");
+    ASSERT(string_arena_bytes_reserved(arena) >= 4096 + 256, "Large chunk not counted");
+    
+    string_arena_reset(arena);
+    ASSERT(string_arena_bytes_used(arena) == 0, "Reset should drop every allocation");
+    ASSERT(string_arena_bytes_reserved(arena) == 256, "Reset should keep only the current chunk");
+    
+    /* Allocation starts over at the beginning of the kept chunk */
+    char *again = string_arena_strdup(arena, "again");
+    ASSERT(again == first && strcmp(again, "again") == 0, "Kept chunk should be reused");
+    
+    string_arena_reset(arena);
+    string_arena_reset(arena);
+    ASSERT(string_arena_bytes_reserved(arena) == 256, "Repeated reset should be harmless");
+    
+    string_arena_destroy(arena);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Merging moves allocations and accounting to the destination
+ */
+static int test_merge(void) {
+    TEST("test_merge");
+    
+    string_arena_t *dst = string_arena_create(0);
+    string_arena_t *src = string_arena_create(0);
+    ASSERT(dst != NULL && src != NULL, "Failed to create arenas");
+    
+    char *d = string_arena_strdup(dst, "destination");
+    char *s = string_arena_strdup(src, "source");
+    size_t used = string_arena_bytes_used(dst) + string_arena_bytes_used(src);
+    size_t reserved = string_arena_bytes_reserved(dst) + string_arena_bytes_reserved(src);
+    
+    string_arena_merge(dst, src);
+    ASSERT(string_arena_bytes_used(dst) == used, "Used bytes not merged");
+    ASSERT(string_arena_bytes_reserved(dst) == reserved, "Reserved bytes not merged");
+    ASSERT(string_arena_bytes_reserved(src) == 0, "Source should be empty");
+    
+    /* The source can be destroyed; merged strings belong to dst */
+    string_arena_destroy(src);
+    ASSERT(strcmp(d, "destination") == 0 && strcmp(s, "source") == 0,
+           "Merged strings corrupted");
+    
+    /* Allocation continues in the destination's own chunk */
+    ASSERT(string_arena_strdup(dst, "more") != NULL, "Alloc after merge failed");
+    
+    string_arena_destroy(dst);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== String Arena Unit Tests ===\n\n");
+    
+    test_alloc_strdup();
+    test_large_alloc();
+    test_reset();
+    test_merge();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_symbol_cache.c - Unit tests for ELF symbol offset resolution
+ * Resolves a function of the test binary itself and checks the offset
+ * against where the running process has it mapped, then checks the
+ * cache file is written and answers a fresh cache without parsing
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../../src/include/symbol_cache.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Function whose offset is resolved */
+__attribute__((noinline)) int symbol_cache_test_marker(int x) {
+    return x * 3 + 1;
+}
+
+static const char *const marker_names[] = { "symbol_cache_test_marker", "no_such_function_here" };
+
+/**
+ * File offset the running process has a code address mapped from
+ */
+static uint64_t mapped_offset(uintptr_t addr) {
+    char line[4352];
+    uint64_t result = 0;
+    FILE *maps = fopen("/proc/self/maps", "r");
+    
+    while (maps && fgets(line, sizeof(line), maps)) {
+        uint64_t start, end, offset;
+        
+        if (sscanf(line, "%" SCNx64 "-%" SCNx64 " %*s %" SCNx64, &start, &end, &offset) == 3 &&
+            addr >= start && addr < end) {
+            result = addr - start + offset;
+            break;
+        }
+    }
+    if (maps) {
+        fclose(maps);
+    }
+    return result;
+}
+
+static int copy_file(const char *from, const char *to) {
+    char buf[65536];
+    ssize_t n;
+    int in = open(from, O_RDONLY);
+    int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0700);
+    int ret = in >= 0 && out >= 0 ? 0 : -1;
+    
+    while (ret == 0 && (n = read(in, buf, sizeof(buf))) > 0) {
+        ret = write(out, buf, (size_t)n) == n ? 0 : -1;
+    }
+    if (in >= 0) {
+        close(in);
+    }
+    if (out >= 0) {
+        close(out);
+    }
+    return ret;
+}
+
+/**
+ * Test: A function resolves to the file offset it is mapped from
+ */
+static int test_resolve_offsets(void) {
+    TEST("test_resolve_offsets");
+    
+    uint64_t offsets[2];
+    uint64_t expected;
+    char id[SYMBOL_FILE_ID_LEN];
+    int fd;
+    
+    ASSERT(symbol_cache_test_marker(1) == 4, "Marker");
+    expected = mapped_offset((uintptr_t)&symbol_cache_test_marker);
+    ASSERT(expected != 0, "Marker should be mapped from the executable");
+    
+    fd = open("/proc/self/exe", O_RDONLY);
+    ASSERT(fd >= 0, "open executable");
+    ASSERT(elf_symbol_offsets(fd, marker_names, 2, offsets) == 0, "Executable should parse");
+    ASSERT(offsets[0] == expected, "Offset should match the mapping");
+    ASSERT(offsets[1] == 0, "Undefined function should have no offset");
+    
+    ASSERT(elf_file_id(fd, id) == 0 && id[0] != '\0', "Executable should have an identity");
+    close(fd);
+    
+    fd = open("/proc/self/maps", O_RDONLY);
+    ASSERT(fd >= 0, "open maps");
+    ASSERT(elf_symbol_offsets(fd, marker_names, 2, offsets) == -1, "Non-ELF file");
+    ASSERT(elf_file_id(fd, id) == -1, "Non-ELF file has no identity");
+    close(fd);
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Offsets are cached in memory and on disk, and a fresh cache
+ * answers from the file without parsing the library
+ */
+static int test_cache_file(void) {
+    TEST("test_cache_file");
+    
+    symbol_cache_stats_t stats;
+    symbol_cache_t *cache;
+    uint64_t first[2], again[2];
+    char dir[64], lib[96], path[96], cmd[96];
+    FILE *fp;
+    
+    snprintf(dir, sizeof(dir), "/tmp/test_symbol_cache.%d", (int)getpid());
+    ASSERT(mkdir(dir, 0700) == 0, "mkdir");
+    snprintf(lib, sizeof(lib), "%s/libmarker.so", dir);
+    snprintf(path, sizeof(path), "%s/cache/offsets", dir);
+    ASSERT(copy_file("/proc/self/exe", lib) == 0, "copy executable");
+    
+    cache = symbol_cache_create(path);
+    ASSERT(cache != NULL, "Cache without a file yet");
+    ASSERT(symbol_cache_resolve(cache, lib, marker_names, 2, first) == 0, "Resolve");
+    ASSERT(first[0] != 0 && first[1] == 0, "Resolved offsets");
+    ASSERT(symbol_cache_resolve(cache, lib, marker_names, 2, again) == 0, "Resolve again");
+    ASSERT(again[0] == first[0] && again[1] == 0, "Cached offsets");
+    symbol_cache_get_stats(cache, &stats);
+    ASSERT(stats.files_parsed == 1 && stats.resolved == 2 && stats.hits == 2,
+           "Second lookup should not parse");
+    ASSERT(symbol_cache_resolve(cache, dir, marker_names, 2, again) == -1, "Directory");
+    symbol_cache_destroy(cache);
+    
+    ASSERT(access(path, R_OK) == 0, "Cache file and directory should be created");
+    fp = fopen(path, "a");
+    ASSERT(fp != NULL, "open cache file");
+    fputs("garbage line\n1 2\n", fp);
+    fclose(fp);
+    
+    cache = symbol_cache_create(path);
+    ASSERT(cache != NULL, "Cache from file");
+    ASSERT(symbol_cache_resolve(cache, lib, marker_names, 2, again) == 0, "Resolve from file");
+    ASSERT(again[0] == first[0] && again[1] == 0, "Offsets from file");
+    symbol_cache_get_stats(cache, &stats);
+    ASSERT(stats.files_parsed == 0 && stats.hits == 2, "File should answer without parsing");
+    symbol_cache_destroy(cache);
+    
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    ASSERT(system(cmd) == 0, "cleanup");
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Symbol Cache Unit Tests ===\n\n");
+    
+    test_resolve_offsets();
+    test_cache_file();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
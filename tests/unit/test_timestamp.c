@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_timestamp.c - Unit tests for timestamp conversion and formatting
+ * Tests the cached formatter against gmtime_r and the boot-time offset
+ * against CLOCK_REALTIME
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "../../src/include/timestamp.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Reference formatting: gmtime_r + snprintf for every call */
+static void reference_format(uint64_t unix_ns, char *buf, size_t buf_size) {
+    time_t seconds = (time_t)(unix_ns / 1000000000ULL);
+    struct tm tm_info;
+    
+    gmtime_r(&seconds, &tm_info);
+    snprintf(buf, buf_size, "%04d-%02d-%02dT%02d:%02d:%02d.%06luZ",
+             tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday,
+             tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec,
+             (unsigned long)((unix_ns % 1000000000ULL) / 1000ULL));
+}
+
+/**
+ * Test: Known timestamps and the buffer size contract
+ */
+static int test_format_known_values(void) {
+    TEST("test_format_known_values");
+    
+    char buf[TIMESTAMP_ISO8601_LEN];
+    
+    ASSERT(timestamp_format_iso8601(0, buf, sizeof(buf)) == buf, "Epoch should format");
+    ASSERT(strcmp(buf, "1970-01-01T00:00:00.000000Z") == 0, "Wrong epoch string");
+    
+    ASSERT(timestamp_format_iso8601(1731933296789012345ULL, buf, sizeof(buf)) != NULL,
+           "Timestamp should format");
+    ASSERT(strcmp(buf, "2024-11-18T12:34:56.789012Z") == 0, "Wrong timestamp string");
+    ASSERT(strlen(buf) + 1 == TIMESTAMP_ISO8601_LEN, "Length should match the constant");
+    
+    ASSERT(timestamp_format_iso8601(1731933296000000999ULL, buf, sizeof(buf)) != NULL &&
+           strcmp(buf, "2024-11-18T12:34:56.000000Z") == 0,
+           "Sub-microsecond digits should be dropped, leading zeros kept");
+    
+    ASSERT(timestamp_format_iso8601(1731933296789012345ULL, buf, sizeof(buf) - 1) == NULL,
+           "Short buffer should be rejected");
+    ASSERT(timestamp_format_iso8601(1731933296789012345ULL, NULL, sizeof(buf)) == NULL,
+           "NULL buffer should be rejected");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: The cached prefix follows second, minute, day and year boundaries
+ */
+static int test_format_matches_gmtime(void) {
+    TEST("test_format_matches_gmtime");
+    
+    char buf[TIMESTAMP_ISO8601_LEN];
+    char expected[64];
+    /* 2023-12-31T23:59:58Z: steps cross into the next second and year */
+    uint64_t base = 1704067198ULL * 1000000000ULL;
+    uint64_t steps[] = { 1, 999, 1000, 250000000ULL, 999999999ULL, 1000000000ULL, 1000000001ULL,
+                         2500000000ULL, 86400000000000ULL, 31536000000000000ULL };
+    
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        uint64_t ns = base + steps[i];
+        
+        ASSERT(timestamp_format_iso8601(ns, buf, sizeof(buf)) != NULL, "Format failed");
+        reference_format(ns, expected, sizeof(expected));
+        ASSERT(strcmp(buf, expected) == 0, "Cached format differs from gmtime_r");
+    }
+    
+    /* Going back to an earlier second must not reuse the cached prefix */
+    for (uint64_t ns = base + 5000000000ULL; ns > base; ns -= 700000001ULL) {
+        ASSERT(timestamp_format_iso8601(ns, buf, sizeof(buf)) != NULL, "Format failed");
+        reference_format(ns, expected, sizeof(expected));
+        ASSERT(strcmp(buf, expected) == 0, "Cached format differs from gmtime_r going back");
+    }
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Converted boot time lands on the current wall-clock time
+ */
+static int test_boot_conversion(void) {
+    TEST("test_boot_conversion");
+    
+    struct timespec ts;
+    uint64_t boot = timestamp_boot_ns();
+    uint64_t converted = timestamp_from_boot_ns(boot);
+    uint64_t real;
+    uint64_t diff;
+    
+    clock_gettime(CLOCK_REALTIME, &ts);
+    real = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    diff = real > converted ? real - converted : converted - real;
+    
+    ASSERT(boot > 0, "Boot time should be set");
+    ASSERT(diff < 100000000ULL, "Converted time should be within 100 ms of CLOCK_REALTIME");
+    ASSERT(timestamp_from_boot_ns(0) == 0, "Unknown timestamps should stay unknown");
+    
+    /* The offset is fixed between resyncs: conversion keeps the spacing */
+    ASSERT(timestamp_from_boot_ns(boot + 1000) - converted == 1000,
+           "Conversion should preserve differences");
+    
+    uint64_t now = timestamp_now_ns();
+    ASSERT(now >= converted && now - converted < 100000000ULL,
+           "Current time should follow the converted boot time");
+    
+    timestamp_resync();
+    converted = timestamp_from_boot_ns(timestamp_boot_ns());
+    diff = converted > now ? converted - now : now - converted;
+    ASSERT(diff < 100000000ULL, "Resync should keep the offset");
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Timestamp Unit Tests ===\n\n");
+    
+    test_format_known_values();
+    test_format_matches_gmtime();
+    test_boot_conversion();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_topk_summary.c - Unit tests for the streaming top-K summary
+ * Tests exact counts while the keys fit, heavy hitters surviving a long
+ * tail many times larger than the table, how events map to dimensions,
+ * TLS handshake latencies, and the table and JSON output
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../src/include/topk_summary.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/**
+ * Test: Counts are exact and ordered while every key has a counter
+ */
+static int test_exact_when_few_keys(void) {
+    TEST("test_exact_when_few_keys");
+    
+    topk_entry_t top[3];
+    topk_summary_t *summary;
+    char key[32];
+    size_t n;
+    
+    ASSERT(topk_summary_create(0) == NULL && topk_summary_create(TOPK_MAX_K + 1) == NULL,
+           "K out of range");
+    summary = topk_summary_create(3);
+    ASSERT(summary != NULL, "Create");
+    
+    for (int i = 1; i <= 6; i++) {
+        snprintf(key, sizeof(key), "process-%d", i);
+        topk_summary_add(summary, TOPK_PROCESSES, key, (uint64_t)i * 10);
+    }
+    topk_summary_add(summary, TOPK_PROCESSES, "process-2", 100);
+    
+    n = topk_summary_top(summary, TOPK_PROCESSES, top, 3);
+    ASSERT(n == 3, "Top 3");
+    ASSERT(strcmp(top[0].key, "process-2") == 0 && top[0].count == 120, "Heaviest first");
+    ASSERT(strcmp(top[1].key, "process-6") == 0 && top[1].count == 60, "Second");
+    ASSERT(strcmp(top[2].key, "process-5") == 0 && top[2].count == 50, "Third");
+    ASSERT(top[0].error == 0 && top[1].error == 0 && top[2].error == 0, "No error");
+    ASSERT(topk_summary_top(summary, TOPK_FILES, top, 3) == 0, "Other dimensions empty");
+    
+    topk_summary_destroy(summary);
+    TEST_PASS();
+}
+
+/**
+ * Test: Heavy keys stay on top of a tail of distinct keys a hundred times
+ * the table, with bounds that hold the true counts
+ */
+static int test_heavy_hitters(void) {
+    TEST("test_heavy_hitters");
+    
+    static const char *const heavy[] = { "/etc/ssl/a.key", "/etc/ssl/b.key", "/etc/ssl/c.key" };
+    const uint64_t heavy_counts[] = { 3000, 2000, 1000 };
+    uint64_t seen[3] = { 0 };
+    topk_entry_t top[3];
+    topk_summary_t *summary;
+    char key[64];
+    size_t n;
+    
+    summary = topk_summary_create(3);
+    ASSERT(summary != NULL, "Create");
+    
+    /* Heavy keys interleaved with 12000 keys seen once */
+    for (int i = 0; i < 12000; i++) {
+        snprintf(key, sizeof(key), "/tmp/once-%d", i);
+        topk_summary_add(summary, TOPK_FILES, key, 1);
+        for (int h = 0; h < 3; h++) {
+            if (seen[h] < heavy_counts[h] && i % (int)(12000 / heavy_counts[h]) == 0) {
+                topk_summary_add(summary, TOPK_FILES, heavy[h], 1);
+                seen[h]++;
+            }
+        }
+    }
+    
+    n = topk_summary_top(summary, TOPK_FILES, top, 3);
+    ASSERT(n == 3, "Top 3");
+    for (int h = 0; h < 3; h++) {
+        ASSERT(strcmp(top[h].key, heavy[h]) == 0, "Heavy keys in order");
+        ASSERT(top[h].count >= seen[h] && top[h].count - top[h].error <= seen[h],
+               "Bounds hold the true count");
+        ASSERT(top[h].count - seen[h] < 100, "Estimate close to the true count");
+    }
+    
+    topk_summary_destroy(summary);
+    TEST_PASS();
+}
+
+/**
+ * Test: Events count in every dimension they belong to, with their
+ * kernel-side weight and paths redacted like the event output
+ */
+static int test_add_event(void) {
+    TEST("test_add_event");
+    
+    processed_event_t open_key = { .event_type = "file_open", .process = "nginx",
+                                   .file = "/home/alice/server.key",
+                                   .file_type = FILE_TYPE_PRIVATE_KEY, .redact_paths = true,
+                                   .count = 4 };
+    processed_event_t open_cert = { .event_type = "file_open", .process = "curl",
+                                    .file = "/etc/ssl/cert.pem",
+                                    .file_type = FILE_TYPE_CERTIFICATE };
+    processed_event_t load = { .event_type = "lib_load", .process = "curl",
+                               .library = "/usr/lib/libssl.so.3", .library_name = "libssl" };
+    processed_event_t call = { .event_type = "api_call", .process = "curl",
+                               .function_name = "SSL_connect", .count = 2 };
+    topk_entry_t top[4];
+    topk_summary_t *summary;
+    
+    summary = topk_summary_create(4);
+    ASSERT(summary != NULL, "Create");
+    topk_summary_add_event(summary, &open_key);
+    topk_summary_add_event(summary, &open_cert);
+    topk_summary_add_event(summary, &load);
+    topk_summary_add_event(summary, &call);
+    
+    ASSERT(topk_summary_events(summary) == 8, "Events weighted by count");
+    ASSERT(topk_summary_top(summary, TOPK_PROCESSES, top, 4) == 2 &&
+           strcmp(top[0].key, "curl") == 0 && top[0].count == 4 &&
+           strcmp(top[1].key, "nginx") == 0 && top[1].count == 4, "Processes");
+    ASSERT(topk_summary_top(summary, TOPK_PRIVATE_KEY_READERS, top, 4) == 1 &&
+           strcmp(top[0].key, "nginx") == 0, "Only private key opens");
+    ASSERT(topk_summary_top(summary, TOPK_FILES, top, 4) == 2 &&
+           strcmp(top[0].key, "/home/USER/server.key") == 0, "Files redacted");
+    ASSERT(topk_summary_top(summary, TOPK_LIBRARIES, top, 4) == 1 &&
+           strcmp(top[0].key, "libssl") == 0, "Library names");
+    ASSERT(topk_summary_top(summary, TOPK_API_FUNCTIONS, top, 4) == 1 &&
+           top[0].count == 2, "API functions");
+    
+    topk_summary_destroy(summary);
+    TEST_PASS();
+}
+
+/**
+ * Test: The table and JSON outputs hold every dimension
+ */
+static int test_write(void) {
+    TEST("test_write");
+    
+    topk_summary_t *summary;
+    char *text = NULL;
+    size_t len = 0;
+    FILE *fp;
+    
+    summary = topk_summary_create(2);
+    ASSERT(summary != NULL, "Create");
+    topk_summary_add(summary, TOPK_FILES, "/etc/ssl/\"quoted\".pem", 5);
+    
+    fp = open_memstream(&text, &len);
+    ASSERT(fp != NULL, "open_memstream");
+    ASSERT(topk_summary_write(summary, fp, FORMAT_SUMMARY, "2024-11-18T12:34:56Z", 60) == 0,
+           "Write table");
+    fclose(fp);
+    ASSERT(strstr(text, "Private key readers\n  (none)") != NULL, "Empty dimension");
+    ASSERT(strstr(text, "5  /etc/ssl/\"quoted\".pem") != NULL, "Table row");
+    free(text);
+    
+    fp = open_memstream(&text, &len);
+    ASSERT(fp != NULL, "open_memstream");
+    ASSERT(topk_summary_write(summary, fp, FORMAT_JSON_STREAM, "2024-11-18T12:34:56Z", 60) == 0,
+           "Write JSON");
+    fclose(fp);
+    ASSERT(strncmp(text, "{\"type\": \"summary\"", 18) == 0, "JSON object");
+    ASSERT(strstr(text, "\"files\": [{\"key\": \"\\/etc\\/ssl\\/\\\"quoted\\\".pem\", "
+                        "\"count\": 5") != NULL, "Escaped key");
+    ASSERT(strstr(text, "\"api_functions\": []}\n") != NULL && strchr(text, '\n') == text + len - 1,
+           "One line");
+    free(text);
+    
+    topk_summary_destroy(summary);
+    TEST_PASS();
+}
+
+/**
+ * Test: Handshake latencies merge by process name and function, and keys
+ * past the table's size are counted under "(other)"
+ */
+static int test_handshakes(void) {
+    TEST("test_handshakes");
+    
+    static const char *const names[] = { "curl", "nginx", "wget", "python3", "java" };
+    handshake_latency_t latency = { .function_name = "SSL_connect" };
+    topk_summary_t *summary;
+    char *text = NULL;
+    size_t len = 0;
+    FILE *fp;
+    
+    summary = topk_summary_create(1);
+    ASSERT(summary != NULL, "Create");
+    topk_summary_enable_handshakes(summary);
+    
+    /* k = 1 keeps 4 histograms: 3 keys and "(other)" */
+    for (int i = 0; i < 5; i++) {
+        snprintf(latency.comm, sizeof(latency.comm), "%s", names[i]);
+        latency.pid = 100 + (uint32_t)i;
+        latency.buckets[10] = i == 0 ? 6 : 1;
+        latency.total_ns = latency.buckets[10] * 1500000ULL;
+        topk_summary_add_handshakes(summary, &latency);
+    }
+    latency.pid = 200;
+    latency.buckets[10] = 0;
+    latency.errors = 1;
+    latency.total_ns = 0;
+    snprintf(latency.comm, sizeof(latency.comm), "curl");
+    topk_summary_add_handshakes(summary, &latency);
+    
+    fp = open_memstream(&text, &len);
+    ASSERT(fp != NULL, "open_memstream");
+    ASSERT(topk_summary_write(summary, fp, FORMAT_JSON_STREAM, "2024-11-18T12:34:56Z", 60) == 0,
+           "Write JSON");
+    fclose(fp);
+    ASSERT(strstr(text, "\"tls_handshakes\": [{\"process\": \"curl\", \"function\": "
+                        "\"SSL_connect\", \"count\": 6, \"errors\": 1, \"mean_us\": 1500, "
+                        "\"p50_us\": 2048, \"p90_us\": 2048, \"p99_us\": 2048, "
+                        "\"histogram_us\": {\"2048\": 6}}]}\n") != NULL, "Busiest only (k = 1)");
+    free(text);
+    
+    fp = open_memstream(&text, &len);
+    ASSERT(fp != NULL, "open_memstream");
+    ASSERT(topk_summary_write(summary, fp, FORMAT_SUMMARY, "2024-11-18T12:34:56Z", 60) == 0,
+           "Write table");
+    fclose(fp);
+    ASSERT(strstr(text, "TLS handshakes\n             6  curl SSL_connect  (p50 2048us, "
+                        "p99 2048us, mean 1500us, 1 failed)\n") != NULL, "Table row");
+    free(text);
+    
+    topk_summary_destroy(summary);
+    
+    /* The fourth and fifth keys share "(other)", which outweighs the rest */
+    summary = topk_summary_create(1);
+    ASSERT(summary != NULL, "Create");
+    topk_summary_enable_handshakes(summary);
+    latency.errors = 0;
+    for (int i = 0; i < 5; i++) {
+        snprintf(latency.comm, sizeof(latency.comm), "%s", names[i]);
+        latency.buckets[10] = i < 3 ? 1 : 3;
+        latency.total_ns = latency.buckets[10] * 1500000ULL;
+        topk_summary_add_handshakes(summary, &latency);
+    }
+    fp = open_memstream(&text, &len);
+    ASSERT(fp != NULL, "open_memstream");
+    ASSERT(topk_summary_write(summary, fp, FORMAT_JSON_STREAM, "2024-11-18T12:34:56Z", 60) == 0,
+           "Write JSON");
+    fclose(fp);
+    ASSERT(strstr(text, "{\"process\": \"(other)\", \"function\": \"all\", \"count\": 6,") != NULL,
+           "Overflow key");
+    free(text);
+    topk_summary_destroy(summary);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Top-K Summary Unit Tests ===\n\n");
+    
+    test_exact_when_few_keys();
+    test_heavy_hitters();
+    test_add_event();
+    test_write();
+    test_handshakes();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}
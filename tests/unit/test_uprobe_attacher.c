@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * Copyright (c) 2025 Graziano Labs Corp.
+ */
+
+/**
+ * test_uprobe_attacher.c - Unit tests for incremental uprobe attachment
+ * Uses a recording attach callback: tests that each library is attached
+ * once however it is reached, that process maps are scanned through the
+ * process's root, and that queued processes wait before being scanned
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../../src/include/uprobe_attacher.h"
+
+/* Test counter */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s\n", name); \
+        tests_run++; \
+    } while (0)
+
+#define ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAILED: %s\n", message); \
+            return -1; \
+        } \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        printf("  PASSED\n"); \
+        tests_passed++; \
+        return 0; \
+    } while (0)
+
+/* Function probed in copies of the test binary */
+__attribute__((noinline)) int uprobe_attacher_test_marker(int x) {
+    return x + 7;
+}
+
+typedef struct {
+    int calls;
+    size_t target;
+    uint64_t offset;
+    char path[256];
+} attach_log_t;
+
+static int record_attach(size_t target, const char *path, uint64_t offset, void *ctx) {
+    attach_log_t *log = ctx;
+    
+    log->calls++;
+    log->target = target;
+    log->offset = offset;
+    snprintf(log->path, sizeof(log->path), "%s", path);
+    return 0;
+}
+
+static int copy_file(const char *from, const char *to) {
+    char buf[65536];
+    ssize_t n;
+    int in = open(from, O_RDONLY);
+    int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0700);
+    int ret = in >= 0 && out >= 0 ? 0 : -1;
+    
+    while (ret == 0 && (n = read(in, buf, sizeof(buf))) > 0) {
+        ret = write(out, buf, (size_t)n) == n ? 0 : -1;
+    }
+    if (in >= 0) {
+        close(in);
+    }
+    if (out >= 0) {
+        close(out);
+    }
+    return ret;
+}
+
+/**
+ * Test: A library is attached once, whatever the path it is reached by
+ */
+static int test_attach_once(void) {
+    TEST("test_attach_once");
+    
+    static const uprobe_target_t targets[] = {
+        { "libfake.so", "uprobe_attacher_test_marker" },
+        { "libfake.so", "no_such_function_here" },
+        { "libother.so", "uprobe_attacher_test_marker" },
+    };
+    uprobe_attacher_stats_t stats;
+    uprobe_attacher_t *attacher;
+    symbol_cache_t *symbols;
+    attach_log_t log = { 0 };
+    char dir[64], lib[96], link_path[96], unrelated[96], cmd[96];
+    
+    ASSERT(uprobe_attacher_test_marker(0) == 7, "Marker");
+    snprintf(dir, sizeof(dir), "/tmp/test_uprobe_attacher.%d", (int)getpid());
+    ASSERT(mkdir(dir, 0700) == 0, "mkdir");
+    snprintf(lib, sizeof(lib), "%s/libfake.so.1", dir);
+    snprintf(link_path, sizeof(link_path), "%s/libfake.so.2", dir);
+    snprintf(unrelated, sizeof(unrelated), "%s/libunrelated.so", dir);
+    ASSERT(copy_file("/proc/self/exe", lib) == 0 && link(lib, link_path) == 0 &&
+           copy_file("/proc/self/exe", unrelated) == 0, "library copies");
+    
+    symbols = symbol_cache_create(NULL);
+    attacher = uprobe_attacher_create(targets, 3, symbols, record_attach, &log);
+    ASSERT(symbols && attacher, "Create");
+    
+    ASSERT(uprobe_attacher_add_library(attacher, lib) == 1, "Defined target should attach");
+    ASSERT(log.calls == 1 && log.target == 0 && log.offset != 0 && strcmp(log.path, lib) == 0,
+           "Callback should get the target, path and offset");
+    
+    ASSERT(uprobe_attacher_add_library(attacher, lib) == 0, "Same path again");
+    ASSERT(uprobe_attacher_add_library(attacher, link_path) == 0, "Same inode, other name");
+    ASSERT(uprobe_attacher_add_library(attacher, unrelated) == 0, "No target for the name");
+    ASSERT(log.calls == 1, "Nothing else should attach");
+    
+    uprobe_attacher_get_stats(attacher, &stats);
+    ASSERT(stats.libraries == 1 && stats.probes == 1 && stats.failures == 1,
+           "One library, one probe, one undefined function");
+    
+    uprobe_attacher_destroy(attacher);
+    symbol_cache_destroy(symbols);
+    
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    ASSERT(system(cmd) == 0, "cleanup");
+    
+    TEST_PASS();
+}
+
+/**
+ * Test: Scanning a process attaches its libraries through its root, and
+ * queued processes are only scanned once old enough
+ */
+static int test_scan_and_queue(void) {
+    TEST("test_scan_and_queue");
+    
+    static const uprobe_target_t targets[] = {
+        { "libc.so", "getpid" },
+    };
+    uprobe_attacher_stats_t stats;
+    uprobe_attacher_t *attacher;
+    symbol_cache_t *symbols;
+    attach_log_t log = { 0 };
+    char root[64];
+    
+    symbols = symbol_cache_create(NULL);
+    attacher = uprobe_attacher_create(targets, 1, symbols, record_attach, &log);
+    ASSERT(symbols && attacher, "Create");
+    
+    ASSERT(uprobe_attacher_scan_pid(attacher, getpid()) == 1, "libc should be found in maps");
+    snprintf(root, sizeof(root), "/proc/%d/root/", (int)getpid());
+    ASSERT(strncmp(log.path, root, strlen(root)) == 0, "Path should go through the root");
+    ASSERT(uprobe_attacher_scan_pid(attacher, getpid()) == 0, "Known libraries are skipped");
+    
+    uprobe_attacher_queue_pid(attacher, getpid(), 1000);
+    uprobe_attacher_queue_pid(attacher, getpid(), 1001);
+    ASSERT(uprobe_attacher_process_pending(attacher, 1000) == 0, "Too young to scan");
+    uprobe_attacher_get_stats(attacher, &stats);
+    ASSERT(stats.processes_scanned == 2, "Nothing scanned yet");
+    
+    uprobe_attacher_process_pending(attacher, 1000 + UPROBE_SCAN_DELAY_NS);
+    uprobe_attacher_get_stats(attacher, &stats);
+    ASSERT(stats.processes_scanned == 3, "Repeated queueing should scan once");
+    ASSERT(stats.probes == 1 && log.calls == 1, "Still one probe");
+    
+    uprobe_attacher_destroy(attacher);
+    symbol_cache_destroy(symbols);
+    
+    TEST_PASS();
+}
+
+/**
+ * Main test runner
+ */
+int main(void) {
+    printf("=== Uprobe Attacher Unit Tests ===\n\n");
+    
+    test_attach_once();
+    test_scan_and_queue();
+    
+    printf("\n=== Test Summary ===\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    
+    return (tests_run == tests_passed) ? 0 : 1;
+}